@@ -39,7 +39,9 @@ check_include_file("netdb.h"             HAVE_NETDB_H)
 #cmake_pop_check_state()
 check_include_file("portaudio.h"         HAVE_PORTAUDIO_H)
 check_include_file("pwd.h"               HAVE_PWD_H)
+check_include_file("sys/eventfd.h"       HAVE_SYS_EVENTFD_H)
 check_include_file("sys/ioctl.h"         HAVE_SYS_IOCTL_H)
+check_include_file("sys/mman.h"          HAVE_SYS_MMAN_H)
 check_include_file("sys/param.h"         HAVE_SYS_PARAM_H)
 check_include_file("sys/select.h"        HAVE_SYS_SELECT_H)
 check_include_file("sys/socket.h"        HAVE_SYS_SOCKET_H)
@@ -111,6 +113,8 @@ if(HAVE_GETOPT_LONG)
 endif()
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
+check_function_exists("memfd_create"     HAVE_MEMFD_CREATE)
+check_function_exists("fopencookie"      HAVE_FOPENCOOKIE)
 check_function_exists("mkdtemp"          HAVE_MKDTEMP)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
 check_function_exists("popcount"         HAVE_POPCOUNT)
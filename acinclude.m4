@@ -2091,6 +2091,72 @@ AC_DEFUN([AC_WIRESHARK_LZ4_CHECK],
 	AC_WIRESHARK_POP_FLAGS
 ])
 
+#
+# AC_WIRESHARK_ZSTD_CHECK
+#
+AC_DEFUN([AC_WIRESHARK_ZSTD_CHECK],
+[
+	AC_WIRESHARK_PUSH_FLAGS
+
+	if test "x$zstd_dir" != "x"
+	then
+	  #
+	  # The user specified a directory in which zstd resides,
+	  # so add the "include" subdirectory of that directory to
+	  # the include file search path and the "lib" subdirectory
+	  # of that directory to the library search path.
+	  #
+	  ZSTD_CFLAGS="-I$zstd_dir/include"
+	  CPPFLAGS="$CPPFLAGS $ZSTD_CFLAGS"
+	  LDFLAGS="$LDFLAGS -L$zstd_dir/lib"
+	fi
+
+	#
+	# Make sure we have "zstd.h".  If we don't, it means we probably
+	# don't have zstd, so don't use it.
+	#
+	AC_CHECK_HEADER(zstd.h,,
+	  [
+	    if test "x$zstd_dir" != "x"
+	    then
+	      AC_MSG_ERROR([zstd header not found in directory specified in --with-zstd])
+	    else
+	      if test "x$want_zstd" = "xyes"
+	      then
+		AC_MSG_ERROR(Header file zstd.h not found.)
+	      else
+		want_zstd=no
+	      fi
+	    fi
+	  ])
+
+	if test "x$want_zstd" != "xno"
+	then
+		#
+		# Well, we at least have the zstd header file.
+		# Check for the streaming decompression API, which we
+		# need in order to read compressed capture files.
+		#
+		AC_CHECK_LIB(zstd, ZSTD_decompressStream,
+		  [
+			ZSTD_LIBS="-lzstd"
+			if test "x$zstd_dir" != "x"
+			then
+				ZSTD_LIBS="-L$zstd_dir/lib $ZSTD_LIBS"
+			fi
+			AC_DEFINE(HAVE_ZSTD, 1, [Define to use zstd library])
+		  ],[
+			if test "x$want_zstd" = "xyes"
+			then
+				AC_MSG_ERROR(zstd library not found.)
+			fi
+			want_zstd=no
+		  ])
+	fi
+
+	AC_WIRESHARK_POP_FLAGS
+])
+
 #
 # AC_WIRESHARK_SNAPPY_CHECK
 #
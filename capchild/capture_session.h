@@ -22,6 +22,7 @@ extern "C" {
 #include "capture_opts.h"
 
 #include <wsutil/processes.h>
+#include <wsutil/shm_ring.h>
 
 #ifdef HAVE_LIBPCAP
 /* Current state of capture engine. XXX - differentiate states */
@@ -46,6 +47,7 @@ typedef struct _capture_session {
 #ifndef _WIN32
     uid_t     owner;                      /**< owner of the cfile */
     gid_t     group;                      /**< group of the cfile */
+    ws_shm_ring_t *shm_ring;              /**< ring through which the child writes the cfile, or NULL */
 #endif
     gboolean  session_started;
     guint32   count;                      /**< Total number of frames captured */
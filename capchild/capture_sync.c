@@ -29,6 +29,10 @@
 # include <sys/wait.h>
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
 #include "caputils/capture-pcap-util.h"
 
 #ifndef _WIN32
@@ -104,6 +108,22 @@ static ssize_t pipe_read_block(int pipe_fd, char *indicator, int len, char *msg,
 
 static void (*fetch_dumpcap_pid)(ws_process_id) = NULL;
 
+#ifndef _WIN32
+/*
+ * Size of the ring through which dumpcap hands us the capture file as
+ * it writes it; we read packets from the ring unless we fall this far
+ * behind.
+ */
+#define CAPTURE_SHM_RING_SIZE (64 * 1024 * 1024)
+
+static void
+sync_pipe_free_shm_ring(capture_session *cap_session)
+{
+    ws_shm_ring_free(cap_session->shm_ring);
+    cap_session->shm_ring = NULL;
+}
+#endif
+
 
 void
 capture_session_init(capture_session *cap_session, capture_file *cf)
@@ -117,6 +137,7 @@ capture_session_init(capture_session *cap_session, capture_file *cf)
 #ifndef _WIN32
     cap_session->owner                           = getuid();
     cap_session->group                           = getgid();
+    cap_session->shm_ring                        = NULL;
 #endif
     cap_session->count                           = 0;
     cap_session->session_started                 = FALSE;
@@ -222,6 +243,8 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
     char errmsg[1024+1];
     int sync_pipe[2];                       /* pipe used to send messages from child to parent */
     enum PIPES { PIPE_READ, PIPE_WRITE };   /* Constants 0 and 1 for PIPE_READ and PIPE_WRITE */
+    char sshm_ring[ARGV_NUMBER_LEN * 2];
+    int shm_ring_fds[2] = { -1, -1 };       /* memfd and eventfd of the capture ring */
 #endif
     int sync_pipe_read_fd;
     int argc;
@@ -416,6 +439,30 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         argv = sync_pipe_add_arg(argv, &argc, "-w");
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->save_file);
     }
+
+#ifndef _WIN32
+    /*
+     * If dumpcap writes a single file, have it write the file through
+     * a ring we share with it, so we can read the packets from there.
+     */
+    sync_pipe_free_shm_ring(cap_session);
+    if (!capture_opts->multi_files_on &&
+        (capture_opts->save_file == NULL || strcmp(capture_opts->save_file, "-") != 0)) {
+        int err;
+
+        cap_session->shm_ring = ws_shm_ring_new(CAPTURE_SHM_RING_SIZE, &err);
+        if (cap_session->shm_ring != NULL) {
+            ws_shm_ring_get_fds(cap_session->shm_ring, &shm_ring_fds[0], &shm_ring_fds[1]);
+            g_snprintf(sshm_ring, ARGV_NUMBER_LEN * 2, "%d,%d", shm_ring_fds[0], shm_ring_fds[1]);
+            argv = sync_pipe_add_arg(argv, &argc, "--capture-ring");
+            argv = sync_pipe_add_arg(argv, &argc, sshm_ring);
+        } else if (err != ENOSYS) {
+            g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+                  "Couldn't create the capture ring: %s", g_strerror(err));
+        }
+    }
+#endif
+
     for (i = 0; i < argc; i++) {
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "argv[%d]: %s", i, argv[i]);
     }
@@ -570,6 +617,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
             g_free( (gpointer) argv[i]);
         }
         g_free(argv);
+        sync_pipe_free_shm_ring(cap_session);
         return FALSE;
     }
 
@@ -580,6 +628,11 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
          */
         dup2(sync_pipe[PIPE_WRITE], 2);
         ws_close(sync_pipe[PIPE_READ]);
+        /* Let dumpcap inherit the capture ring. */
+        if (shm_ring_fds[0] != -1) {
+            fcntl(shm_ring_fds[0], F_SETFD, 0);
+            fcntl(shm_ring_fds[1], F_SETFD, 0);
+        }
         execv(argv[0], argv);
         g_snprintf(errmsg, sizeof errmsg, "Couldn't run %s in child process: %s",
                    argv[0], g_strerror(errno));
@@ -625,6 +678,8 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         ws_close(sync_pipe_read_fd);
 #ifdef _WIN32
         ws_close(cap_session->signal_pipe_write_fd);
+#else
+        sync_pipe_free_shm_ring(cap_session);
 #endif
         return FALSE;
     }
@@ -1711,6 +1766,9 @@ sync_pipe_input_cb(gint source, gpointer user_data)
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_cb: cleaning extcap pipe");
         extcap_if_cleanup(cap_session->capture_opts, &primary_msg);
         capture_input_closed(cap_session, primary_msg);
+#ifndef _WIN32
+        sync_pipe_free_shm_ring(cap_session);
+#endif
         g_free(primary_msg);
         return FALSE;
     }
@@ -1739,6 +1797,9 @@ sync_pipe_input_cb(gint source, gpointer user_data)
                "standard output", as the capture file. */
             sync_pipe_stop(cap_session);
             capture_input_closed(cap_session, NULL);
+#ifndef _WIN32
+            sync_pipe_free_shm_ring(cap_session);
+#endif
             return FALSE;
         }
         break;
@@ -179,7 +179,7 @@ typedef enum {
 typedef struct _capture_info {
   const char    *filename;
   guint16        file_type;
-  gboolean       iscompressed;
+  wtap_compression_type compression_type;
   int            file_encap;
   int            file_tsprec;
   gint64         filesize;
@@ -583,9 +583,14 @@ print_stats(const gchar *filename, capture_info *cf_info)
   file_encap_string = wtap_encap_string(cf_info->file_encap);
 
   if (filename)           printf     ("File name:           %s\n", filename);
-  if (cap_file_type)      printf     ("File type:           %s%s\n",
-      file_type_string,
-      cf_info->iscompressed ? " (gzip compressed)" : "");
+  if (cap_file_type) {
+    if (cf_info->compression_type == WTAP_UNCOMPRESSED)
+      printf    ("File type:           %s\n", file_type_string);
+    else
+      printf    ("File type:           %s (%s compressed)\n",
+          file_type_string,
+          wtap_compression_type_description(cf_info->compression_type));
+  }
 
   if (cap_file_encap) {
     printf      ("File encapsulation:  %s\n", file_encap_string);
@@ -1101,6 +1106,9 @@ process_cap_file(wtap *wth, const char *filename)
   g_free(idb_info);
   idb_info = NULL;
 
+  /* Decode records on other threads while we tally them up. */
+  wtap_start_read_pipeline(wth, 0);
+
   /* Tally up data that we need to parse through the file to find */
   while (wtap_read(wth, &err, &err_info, &data_offset))  {
     rec = wtap_get_rec(wth);
@@ -1241,7 +1249,7 @@ process_cap_file(wtap *wth, const char *filename)
 
   /* File Type */
   cf_info.file_type = wtap_file_type_subtype(wth);
-  cf_info.iscompressed = wtap_iscompressed(wth);
+  cf_info.compression_type = wtap_get_compression_type(wth);
 
   /* File Encapsulation */
   cf_info.file_encap = wtap_file_encap(wth);
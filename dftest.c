@@ -16,6 +16,14 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
 #include <glib.h>
 
 #include <epan/epan.h>
@@ -32,6 +40,11 @@
 
 #include <wiretap/wtap.h>
 
+#ifndef HAVE_GETOPT_LONG
+#include "wsutil/wsgetopt.h"
+#endif
+
+#include "ui/failure_message.h"
 #include "ui/util.h"
 #include "epan/register.h"
 
@@ -41,6 +54,133 @@ static void open_failure_message(const char *filename, int err,
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
 
+/*
+ * The frames dftest keeps around while applying the filter to a capture
+ * file, for the dissectors that look at the time of other frames.
+ */
+struct packet_provider_data {
+	const frame_data *ref;
+	frame_data	*prev_dis;
+	frame_data	*prev_cap;
+};
+
+static frame_data ref_frame;
+static frame_data prev_dis_frame;
+static frame_data prev_cap_frame;
+
+static void
+print_usage(void)
+{
+	fprintf(stderr, "Usage: dftest [-p <capture file>] <filter>\n");
+	fprintf(stderr, "  -p <capture file>  apply the filter to every packet in the file and\n");
+	fprintf(stderr, "                     print the profiling counters of its \"matches\" tests\n");
+}
+
+static const nstime_t *
+dftest_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+{
+	if (prov->ref && prov->ref->num == frame_num)
+		return &prov->ref->abs_ts;
+
+	if (prov->prev_dis && prov->prev_dis->num == frame_num)
+		return &prov->prev_dis->abs_ts;
+
+	if (prov->prev_cap && prov->prev_cap->num == frame_num)
+		return &prov->prev_cap->abs_ts;
+
+	return NULL;
+}
+
+static const char *
+no_interface_name(struct packet_provider_data *prov _U_, guint32 interface_id _U_)
+{
+	return "";
+}
+
+/*
+ * Dissect every packet in the file, apply the filter to it with the
+ * filter's profiling counters enabled, and print the counters.
+ */
+static gboolean
+profile_filter(dfilter_t *df, const char *filename)
+{
+	static const struct packet_provider_funcs funcs = {
+		dftest_get_frame_ts,
+		no_interface_name,
+		NULL,
+		NULL,
+	};
+	struct packet_provider_data provider;
+	wtap		*wth;
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	int		err;
+	gchar		*err_info = NULL;
+	gint64		data_offset;
+	guint32		framenum = 0;
+	guint32		matched = 0;
+	guint32		cum_bytes = 0;
+	nstime_t	elapsed_time;
+	frame_data	fdata;
+
+	wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		cfile_open_failure_message("dftest", filename, err, err_info);
+		return FALSE;
+	}
+
+	memset(&provider, 0, sizeof(provider));
+	nstime_set_zero(&elapsed_time);
+	session = epan_new(&provider, &funcs);
+	edt = epan_dissect_new(session, TRUE, FALSE);
+
+	dfilter_set_profiling(df, TRUE);
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		wtap_rec *rec = wtap_get_rec(wth);
+		const guint8 *pd = wtap_get_buf_ptr(wth);
+
+		framenum++;
+		frame_data_init(&fdata, framenum, rec, data_offset, cum_bytes);
+		epan_dissect_prime_with_dfilter(edt, df);
+
+		frame_data_set_before_dissect(&fdata, &elapsed_time,
+					      &provider.ref, provider.prev_dis);
+		if (provider.ref == &fdata) {
+			ref_frame = fdata;
+			provider.ref = &ref_frame;
+		}
+
+		epan_dissect_run(edt, wtap_file_type_subtype(wth), rec,
+				 tvb_new_real_data(pd, rec->rec_header.packet_header.caplen,
+						   rec->rec_header.packet_header.len),
+				 &fdata, NULL);
+
+		if (dfilter_apply_edt(df, edt)) {
+			matched++;
+			frame_data_set_after_dissect(&fdata, &cum_bytes);
+			prev_dis_frame = fdata;
+			provider.prev_dis = &prev_dis_frame;
+		}
+		prev_cap_frame = fdata;
+		provider.prev_cap = &prev_cap_frame;
+
+		epan_dissect_reset(edt);
+		frame_data_destroy(&fdata);
+	}
+	if (err != 0)
+		cfile_read_failure_message("dftest", filename, err, err_info);
+
+	epan_dissect_free(edt);
+	epan_free(session);
+	wtap_close(wth);
+
+	printf("\n%u of %u packets matched\n\n", matched, framenum);
+	dfilter_dump_profile(df);
+
+	return err == 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -48,6 +188,9 @@ main(int argc, char **argv)
 	char		*text;
 	dfilter_t	*df;
 	gchar		*err_msg;
+	const char	*profile_file = NULL;
+	int		opt;
+	int		exit_status = 0;
 
 	/*
 	 * Get credential information for later use.
@@ -93,14 +236,27 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* "+" stops at the first non-option, so that a filter such as
+	   "tcp.window_size_scalefactor == -1" isn't taken for options. */
+	while ((opt = getopt(argc, argv, "+p:")) != -1) {
+		switch (opt) {
+		case 'p':
+			profile_file = optarg;
+			break;
+		default:
+			print_usage();
+			exit(1);
+		}
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (optind >= argc) {
+		print_usage();
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, optind);
 
 	printf("Filter: \"%s\"\n", text);
 
@@ -116,12 +272,15 @@ main(int argc, char **argv)
 
 	if (df == NULL)
 		printf("Filter is empty\n");
-	else
+	else {
 		dfilter_dump(df);
+		if (profile_file != NULL && !profile_filter(df, profile_file))
+			exit_status = 2;
+	}
 
 	dfilter_free(df);
 	epan_cleanup();
-	exit(0);
+	exit(exit_status);
 }
 
 /*
@@ -92,6 +92,7 @@
 #include "wsutil/file_util.h"
 #include "wsutil/cpu_info.h"
 #include "wsutil/os_version_info.h"
+#include "wsutil/shm_ring.h"
 #include "wsutil/str_util.h"
 #include "wsutil/inet_addr.h"
 #include "wsutil/time_util.h"
@@ -311,6 +312,8 @@ typedef struct _loop_data {
     int       save_file_fd;
     guint64   bytes_written;
     guint32   autostop_files;
+    gboolean  to_shm_ring;         /**< TRUE if pdh writes through the capture ring */
+    guint64   shm_ring_reported;   /**< Packets written through the ring and sent out to the sync_pipe */
 } loop_data;
 
 typedef struct _pcap_queue_element {
@@ -379,6 +382,11 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+static ws_shm_ring_t *shm_ring = NULL;  /* capture ring shared with our parent, if any */
+
+/* Hidden option with which our parent passes us the capture ring; the
+   values capture_opts.h uses for long options are all below 4096. */
+#define LONGOPT_CAPTURE_RING 4096
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -1081,6 +1089,7 @@ exit_main(int status)
 #endif /* _WIN32 */
 
     capture_opts_cleanup(&global_capture_opts);
+    ws_shm_ring_free(shm_ring);
     exit(status);
 }
 
@@ -2965,12 +2974,29 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     }
 
     /* Set up to write to the capture file. */
+    ld->to_shm_ring = FALSE;
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
     } else {
-        ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
+        if (shm_ring != NULL && !capture_opts->output_to_pipe) {
+            /* Write the file through the capture ring our parent gave
+               us, so that it can read the packets from there, and so
+               that we don't wait for the file system. */
+            ld->pdh = ws_shm_ring_fdopen(shm_ring, ld->save_file_fd);
+            if (ld->pdh != NULL) {
+                ld->to_shm_ring = TRUE;
+                ld->shm_ring_reported = 0;
+            } else {
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+                      "Can't write the capture file through the capture ring: %s",
+                      g_strerror(errno));
+            }
+        }
         if (ld->pdh == NULL) {
-            err = errno;
+            ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
+            if (ld->pdh == NULL) {
+                err = errno;
+            }
         }
     }
     if (ld->pdh) {
@@ -3035,6 +3061,13 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
             successful = libpcap_write_file_header(ld->pdh, pcap_src->linktype, pcap_src->snaplen,
                                                 pcap_src->ts_nsec, &ld->bytes_written, &err);
         }
+        if (successful && ld->to_shm_ring) {
+            /* Our parent opens the file itself, so get the header
+               blocks into it before we tell our parent about it. */
+            ws_shm_ring_commit(shm_ring, 0);
+            err = ws_shm_ring_sync(shm_ring);
+            successful = (err == 0);
+        }
         if (!successful) {
             fclose(ld->pdh);
             ld->pdh = NULL;
@@ -3117,6 +3150,35 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
     }
 }
 
+/* Send our parent a message saying how many more packets the capture
+   ring's writer thread has written to the capture file. */
+static void
+report_shm_ring_packet_count(loop_data *ld)
+{
+    guint64 written = ws_shm_ring_packets_written(shm_ring);
+
+    if (written != ld->shm_ring_reported) {
+        if (!quiet)
+            report_packet_count((unsigned int)(written - ld->shm_ring_reported));
+        ld->shm_ring_reported = written;
+    }
+    ld->inpkts_to_sync_pipe = 0;
+}
+
+/* The capture ring's stream is unbuffered, and fwrite() on it doesn't
+   return a short count when the ring refuses the bytes, e.g. because
+   writing the capture file failed; check its error indicator instead. */
+static gboolean
+shm_ring_write_ok(loop_data *ld, int *err)
+{
+    if (!ferror(ld->pdh))
+        return TRUE;
+    *err = ws_shm_ring_sync(shm_ring);
+    if (*err == 0)
+        *err = EIO;
+    return FALSE;
+}
+
 /* dispatch incoming packets (pcap or capture pipe)
  *
  * Waits for incoming packets to be available, and calls pcap_dispatch()
@@ -3922,7 +3984,11 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
 #endif
             /* Let the parent process know. */
-            if (global_ld.inpkts_to_sync_pipe) {
+            if (global_ld.to_shm_ring) {
+                /* The packets are written to the file in the background;
+                   only tell our parent about the ones that have been. */
+                report_shm_ring_packet_count(&global_ld);
+            } else if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
                 fflush(global_ld.pdh);
 
@@ -4074,7 +4140,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     /* there might be packets not yet notified to the parent */
     /* (do this after closing the file, so all packets are already flushed) */
-    if (global_ld.inpkts_to_sync_pipe) {
+    if (global_ld.to_shm_ring) {
+        report_shm_ring_packet_count(&global_ld);
+    } else if (global_ld.inpkts_to_sync_pipe) {
         if (!quiet)
             report_packet_count(global_ld.inpkts_to_sync_pipe);
         global_ld.inpkts_to_sync_pipe = 0;
@@ -4260,11 +4328,15 @@ capture_loop_write_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_he
                                        &global_ld.bytes_written, &err);
 
         fflush(global_ld.pdh);
+        if (successful && global_ld.to_shm_ring)
+            successful = shm_ring_write_ok(&global_ld, &err);
         if (!successful) {
             global_ld.go = FALSE;
             global_ld.err = err;
             pcap_src->dropped++;
         } else if (bh->block_type == BLOCK_TYPE_EPB || bh->block_type == BLOCK_TYPE_SPB) {
+            if (global_ld.to_shm_ring)
+                ws_shm_ring_commit(shm_ring, 1);
             /* count packet only if we actually have an EPB or SPB */
 #if defined(DEBUG_DUMPCAP) || defined(DEBUG_CHILD_DUMPCAP)
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
@@ -4277,6 +4349,8 @@ capture_loop_write_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_he
             if ((global_ld.packet_max > 0) && (global_ld.packet_count >= global_ld.packet_max)) {
                 global_ld.go = FALSE;
             }
+        } else if (global_ld.to_shm_ring) {
+            ws_shm_ring_commit(shm_ring, 0);
         }
     }
 }
@@ -4320,11 +4394,15 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
                                               pd,
                                               &global_ld.bytes_written, &err);
         }
+        if (successful && global_ld.to_shm_ring)
+            successful = shm_ring_write_ok(&global_ld, &err);
         if (!successful) {
             global_ld.go = FALSE;
             global_ld.err = err;
             pcap_src->dropped++;
         } else {
+            if (global_ld.to_shm_ring)
+                ws_shm_ring_commit(shm_ring, 1);
 #if defined(DEBUG_DUMPCAP) || defined(DEBUG_CHILD_DUMPCAP)
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
                   "Wrote a packet of length %d captured on interface %u.",
@@ -4543,6 +4621,7 @@ main(int argc, char *argv[])
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         LONGOPT_CAPTURE_COMMON
+        {"capture-ring", required_argument, NULL, LONGOPT_CAPTURE_RING},
         {0, 0, 0, 0 }
     };
 
@@ -4961,6 +5040,29 @@ main(int argc, char *argv[])
 #endif
             break;
 
+            /*** hidden option: capture ring shared with our parent ***/
+        case LONGOPT_CAPTURE_RING:
+        {
+            /*
+             * optarg = the ring's memfd and eventfd, which our parent
+             * has left open for us.
+             */
+            int mem_fd, event_fd, err;
+            char c;
+
+            if (sscanf(optarg, "%d,%d%c", &mem_fd, &event_fd, &c) != 2) {
+                cmdarg_err("Invalid capture ring \"%s\"", optarg);
+                exit_main(1);
+            }
+            ws_shm_ring_free(shm_ring);
+            shm_ring = ws_shm_ring_attach(mem_fd, event_fd, &err);
+            if (shm_ring == NULL) {
+                /* Just write the file the usual way. */
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+                      "Can't map the capture ring: %s", g_strerror(err));
+            }
+            break;
+        }
         case 'q':        /* Quiet */
             quiet = TRUE;
             break;
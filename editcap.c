@@ -99,19 +99,29 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The frames in the window are kept in a ring, fd_hash[], and are also
+ * chained into hash buckets on (len, digest), so finding a duplicate
+ * doesn't depend on the size of the window.
  */
 typedef struct _fd_hash_t {
-    guint8     digest[16];
+    guint64    digest;      /* hash of the frame data */
     guint32    len;
     nstime_t   frame_time;
+    int        prev;        /* neighbours in the same bucket, newest */
+    int        next;        /* first; -1 at either end */
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window (and maximum size of fd_hash[]) for de-duplication */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+static fd_hash_t *fd_hash       = NULL;
+static int       *fd_buckets    = NULL; /* newest entry in each bucket, or -1 */
+static guint      fd_bucket_mask = 0;
+static int        dup_window    = DEFAULT_DUP_DEPTH;
+static int        cur_dup_entry = 0;
+static int        dup_live      = 0;    /* frames currently in the window */
+static guint8     dup_md5[16];          /* MD5 of the last frame, for -v */
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
@@ -573,49 +583,160 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
+/*
+ * 64-bit xxHash (XXH64) of a buffer, used to index the duplicate
+ * detection window; it is far cheaper than MD5 per frame.
+ */
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT(11400714785074694791)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT(14029467366897019727)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT(1609587929392839161)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT(9650029242287828579)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT(2870177450012600261)
 
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
+#define XXH_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
 
-    if (len <= ignored_bytes) {
-        offset = 0;
+static inline guint64
+xxh64_round(guint64 acc, guint64 input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc  = XXH_ROTL64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round(guint64 acc, guint64 val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static guint64
+dup_hash64(const guint8 *p, guint32 len)
+{
+    const guint8 *end = p + len;
+    guint64 h;
+
+    if (len >= 32) {
+        const guint8 *limit = end - 32;
+        guint64 v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        guint64 v2 = XXH_PRIME64_2;
+        guint64 v3 = 0;
+        guint64 v4 = 0 - XXH_PRIME64_1;
+
+        do {
+            v1 = xxh64_round(v1, pletoh64(p));
+            v2 = xxh64_round(v2, pletoh64(p + 8));
+            v3 = xxh64_round(v3, pletoh64(p + 16));
+            v4 = xxh64_round(v4, pletoh64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = XXH_ROTL64(v1, 1) + XXH_ROTL64(v2, 7) +
+            XXH_ROTL64(v3, 12) + XXH_ROTL64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    } else {
+        h = XXH_PRIME64_5;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
+    h += len;
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, pletoh64(p));
+        h  = XXH_ROTL64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (guint64)pletoh32(p) * XXH_PRIME64_1;
+        h  = XXH_ROTL64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p++) * XXH_PRIME64_5;
+        h  = XXH_ROTL64(h, 11) * XXH_PRIME64_1;
+    }
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Set up an empty duplicate detection window of dup_window frames. */
+static void
+dup_init(void)
+{
+    guint num_buckets = 16;
+    guint i;
 
-    fd_hash[cur_dup_entry].len = len;
+    while (num_buckets < 2 * (guint)dup_window)
+        num_buckets <<= 1;
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+    fd_hash = g_new0(fd_hash_t, MAX(dup_window, 1));
+    fd_buckets = g_new(int, num_buckets);
+    fd_bucket_mask = num_buckets - 1;
+    for (i = 0; i < num_buckets; i++)
+        fd_buckets[i] = -1;
+    cur_dup_entry = 0;
+    dup_live = 0;
+}
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
+static void
+dup_cleanup(void)
+{
+    g_free(fd_hash);
+    fd_hash = NULL;
+    g_free(fd_buckets);
+    fd_buckets = NULL;
+}
 
-    return FALSE;
+static inline guint
+dup_bucket(guint64 digest, guint32 len)
+{
+    return ((guint)(digest >> 32) ^ (guint)digest ^ len) & fd_bucket_mask;
 }
 
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
+static void
+dup_link(int i)
+{
+    int *head = &fd_buckets[dup_bucket(fd_hash[i].digest, fd_hash[i].len)];
 
+    fd_hash[i].prev = -1;
+    fd_hash[i].next = *head;
+    if (*head != -1)
+        fd_hash[*head].prev = i;
+    *head = i;
+}
+
+static void
+dup_unlink(int i)
+{
+    if (fd_hash[i].prev != -1)
+        fd_hash[fd_hash[i].prev].next = fd_hash[i].next;
+    else
+        fd_buckets[dup_bucket(fd_hash[i].digest, fd_hash[i].len)] = fd_hash[i].next;
+    if (fd_hash[i].next != -1)
+        fd_hash[fd_hash[i].next].prev = fd_hash[i].prev;
+}
+
+/* Index of the oldest frame in the window; only valid if dup_live > 0. */
+static inline int
+dup_oldest(void)
+{
+    return (cur_dup_entry - dup_live + dup_window) % dup_window;
+}
+
+/*
+ * Hash the current frame into a new entry, and make room for it in the
+ * window.  Returns the slot to put it in, or -1 if the window is empty
+ * (-D 0), in which case the frame is only hashed.
+ */
+static int
+dup_hash_frame(guint8* fd, guint32 len, fd_hash_t *entry) {
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
     guint32 new_len;
@@ -628,60 +749,96 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
     new_fd  = &fd[offset];
     new_len = len - (offset);
 
+    /* Calculate our digest, and the MD5 hash we show the user */
+    entry->digest = dup_hash64(new_fd, new_len);
+    entry->len = len;
+    if (verbose)
+        gcry_md_hash_buffer(GCRY_MD_MD5, dup_md5, new_fd, new_len);
+
+    if (dup_window == 0)
+        return -1;
+
     cur_dup_entry++;
     if (cur_dup_entry >= dup_window)
         cur_dup_entry = 0;
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    /* If the window is full, the slot we're about to use is the oldest */
+    if (dup_live == dup_window) {
+        dup_unlink(cur_dup_entry);
+        dup_live--;
+    }
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    return cur_dup_entry;
+}
 
-    /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
-     */
+static void
+dup_add_frame(int slot, const fd_hash_t *entry)
+{
+    fd_hash[slot] = *entry;
+    dup_link(slot);
+    dup_live++;
+}
+
+static gboolean
+is_duplicate(guint8* fd, guint32 len) {
+    fd_hash_t entry;
+    int slot, i;
+    gboolean dup = FALSE;
 
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
+    if (dup_window == 0) {
+        /* Nothing to compare with; just get the MD5 hash for -v */
+        if (verbose)
+            dup_hash_frame(fd, len, &entry);
+        return FALSE;
+    }
 
-        if (i < 0)
-            i = dup_window - 1;
+    slot = dup_hash_frame(fd, len, &entry);
 
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
+    /* Look for duplicates among the previous dup_window - 1 frames */
+    for (i = fd_buckets[dup_bucket(entry.digest, len)]; i != -1; i = fd_hash[i].next) {
+        if (fd_hash[i].len == len && fd_hash[i].digest == entry.digest) {
+            dup = TRUE;
             break;
         }
+    }
 
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
+    dup_add_frame(slot, &entry);
+    return dup;
+}
+
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+    fd_hash_t entry;
+    nstime_t delta;
+    int slot, i;
+    gboolean dup = FALSE;
+
+    slot = dup_hash_frame(fd, len, &entry);
+    entry.frame_time = *current;
+
+    /*
+     * Drop the frames that are now beyond the dup time window.  This
+     * assumes that the input trace file is "well-formed" in the sense
+     * that the packet timestamps are in strict chronologically
+     * increasing order (which is NOT always the case!!); we stop at the
+     * first frame that is within the window, or that has a timestamp
+     * later than the current packet.
+     */
+    while (dup_live > 0) {
+        int oldest = dup_oldest();
+
+        nstime_delta(&delta, current, &fd_hash[oldest].frame_time);
+        if (delta.secs < 0 || delta.nsecs < 0 ||
+            nstime_cmp(&delta, &relative_time_window) <= 0)
             break;
-        }
+        dup_unlink(oldest);
+        dup_live--;
+    }
+
+    /* Look for relative time related duplicates. */
+    for (i = fd_buckets[dup_bucket(entry.digest, len)]; i != -1; i = fd_hash[i].next) {
+        if (fd_hash[i].len != len || fd_hash[i].digest != entry.digest)
+            continue;
 
         nstime_delta(&delta, current, &fd_hash[i].frame_time);
 
@@ -691,38 +848,20 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
              * has an absolute timestamp less than the cached packet
              * that it is being compared to.  This is NOT a normal
              * situation since trace files usually have packets in
-             * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
+             * chronological order (oldest to newest); skip the
+             * cached frame and keep looking.
              */
             continue;
         }
 
-        cmp = nstime_cmp(&delta, &relative_time_window);
-
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
+        if (nstime_cmp(&delta, &relative_time_window) <= 0) {
+            dup = TRUE;
             break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
         }
     }
 
-    return FALSE;
+    dup_add_frame(slot, &entry);
+    return dup;
 }
 
 static void
@@ -755,7 +894,7 @@ print_usage(FILE *output)
     fprintf(output, "  -a <framenum>:<comment> Add or replace comment for given frame number\n");
     fprintf(output, "\n");
     fprintf(output, "  -I <bytes to ignore>   ignore the specified number of bytes at the beginning\n");
-    fprintf(output, "                         of the frame during MD5 hash calculation, unless the\n");
+    fprintf(output, "                         of the frame during hash calculation, unless the\n");
     fprintf(output, "                         frame is too short, then the full frame is used.\n");
     fprintf(output, "                         Useful to remove duplicated packets taken on\n");
     fprintf(output, "                         several routers (different mac addresses for\n");
@@ -930,11 +1069,11 @@ editcap_dump_open(const char *filename, guint32 snaplen,
   if (strcmp(filename, "-") == 0) {
     /* Write to the standard output. */
     pdh = wtap_dump_open_stdout_ng(out_file_type_subtype, out_frame_type,
-                                   snaplen, FALSE /* compressed */,
+                                   snaplen, WTAP_UNCOMPRESSED,
                                    shb_hdrs, idb_inf, nrb_hdrs, write_err);
   } else {
     pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                            snaplen, FALSE /* compressed */,
+                            snaplen, wtap_name_to_compression_type(filename),
                             shb_hdrs, idb_inf, nrb_hdrs, write_err);
   }
   return pdh;
@@ -1362,11 +1501,7 @@ main(int argc, char *argv[])
             max_packet_number = G_MAXUINT;
 
         if (dup_detect || dup_detect_by_time) {
-            for (i = 0; i < dup_window; i++) {
-                memset(&fd_hash[i].digest, 0, 16);
-                fd_hash[i].len = 0;
-                nstime_set_unset(&fd_hash[i].frame_time);
-            }
+            dup_init();
         }
 
         /* Read all of the packets in turn */
@@ -1649,7 +1784,7 @@ main(int argc, char *argv[])
                                         rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            dup_md5[i]);
                                 fprintf(stderr, "\n");
                             }
                             duplicate_count++;
@@ -1662,7 +1797,7 @@ main(int argc, char *argv[])
                                         rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            dup_md5[i]);
                                 fprintf(stderr, "\n");
                             }
                         }
@@ -1685,7 +1820,7 @@ main(int argc, char *argv[])
                                             rec->rec_header.packet_header.caplen);
                                     for (i = 0; i < 16; i++)
                                         fprintf(stderr, "%02x",
-                                                (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                                dup_md5[i]);
                                     fprintf(stderr, "\n");
                                 }
                                 duplicate_count++;
@@ -1698,7 +1833,7 @@ main(int argc, char *argv[])
                                             rec->rec_header.packet_header.caplen);
                                     for (i = 0; i < 16; i++)
                                         fprintf(stderr, "%02x",
-                                                (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                                dup_md5[i]);
                                     fprintf(stderr, "\n");
                                 }
                             }
@@ -1885,6 +2020,7 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    dup_cleanup();
     wtap_block_array_free(shb_hdrs);
     wtap_block_array_free(nrb_hdrs);
     g_free(idb_inf);
@@ -52,6 +52,61 @@ static gboolean filters_enabled = TRUE;
  */
 static gboolean tmp_colors_set = FALSE;
 
+/* All the enabled filters in 'color_filter_list', compiled into a single
+ * program that finds the first one matching a packet, so that fields
+ * used by several rules are only looked up once per packet. It's built
+ * when first needed, and thrown away whenever the list changes;
+ * 'color_filter_group_rules' maps the index returned by
+ * dfilter_apply_edt_first() back to the rule. */
+static dfilter_t      *color_filter_group       = NULL;
+static color_filter_t **color_filter_group_rules = NULL;
+static gboolean        color_filter_group_valid = FALSE;
+
+static void
+color_filters_group_invalidate(void)
+{
+    dfilter_free(color_filter_group);
+    color_filter_group = NULL;
+    g_free(color_filter_group_rules);
+    color_filter_group_rules = NULL;
+    color_filter_group_valid = FALSE;
+}
+
+/* Compile the enabled filters in 'color_filter_list' into one program.
+ * If that fails, which it shouldn't as each of them compiled on its
+ * own, color_filter_group is left NULL and the rules are applied one
+ * by one. */
+static void
+color_filters_group_build(void)
+{
+    GPtrArray      *texts;
+    GPtrArray      *rules;
+    GSList         *curr;
+    color_filter_t *colorf;
+    gchar          *err_msg = NULL;
+
+    texts = g_ptr_array_new();
+    rules = g_ptr_array_new();
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if (!colorf->disabled && colorf->c_colorfilter != NULL) {
+            g_ptr_array_add(texts, colorf->filter_text);
+            g_ptr_array_add(rules, colorf);
+        }
+    }
+
+    if (dfilter_compile_group((const gchar **)texts->pdata, texts->len,
+                              &color_filter_group, &err_msg, NULL)) {
+        color_filter_group_rules = (color_filter_t **)g_ptr_array_free(rules, FALSE);
+    } else {
+        ws_g_warning("Could not compile the color filters together: %s", err_msg);
+        g_free(err_msg);
+        g_ptr_array_free(rules, TRUE);
+    }
+    g_ptr_array_free(texts, TRUE);
+    color_filter_group_valid = TRUE;
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -166,6 +221,7 @@ color_filters_set_tmp(guint8 filt_nr, const gchar *filter, gboolean disabled, gc
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
                 colorf->disabled = ((i!=filt_nr) ? TRUE : disabled);
+                color_filters_group_invalidate();
                 /* Remember that there are now temporary coloring filters set */
                 if( filter )
                     tmp_colors_set = TRUE;
@@ -328,6 +384,7 @@ gboolean
 color_filters_init(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
     /* delete all currently existing filters */
+    color_filters_group_invalidate();
     color_filter_list_delete(&color_filter_list);
 
     /* now try to construct the filters list */
@@ -337,6 +394,8 @@ color_filters_init(gchar** err_msg, color_filter_add_cb_func add_cb)
 gboolean
 color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
+    color_filters_group_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -431,6 +490,8 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, gchar** err_msg)
 
     *err_msg = NULL;
 
+    color_filters_group_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -488,7 +549,15 @@ prime_edt(gpointer data, gpointer user_data)
 void
 color_filters_prime_edt(epan_dissect_t *edt)
 {
-    if (color_filters_used())
+    if (!color_filters_used())
+        return;
+
+    if (!color_filter_group_valid)
+        color_filters_group_build();
+
+    if (color_filter_group != NULL)
+        epan_dissect_prime_with_dfilter(edt, color_filter_group);
+    else
         g_slist_foreach(color_filter_list, prime_edt, edt);
 }
 
@@ -498,9 +567,18 @@ color_filters_colorize_packet(epan_dissect_t *edt)
 {
     GSList         *curr;
     color_filter_t *colorf;
+    int             rule;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
+        if (!color_filter_group_valid)
+            color_filters_group_build();
+
+        if (color_filter_group != NULL) {
+            rule = dfilter_apply_edt_first(color_filter_group, edt);
+            return (rule >= 0) ? color_filter_group_rules[rule] : NULL;
+        }
+
         curr = color_filter_list;
 
         while(curr != NULL) {
@@ -33,15 +33,43 @@ struct endpoint {
 	guint options;
 };
 
+/*
+ * Number of 32-bit words in the packed form of a key: the endpoint and
+ * address types, two addresses of up to 128 bits, and two ports.
+ */
+#define CONV_PACKED_WORDS 11
+
 struct conversation_key {
-	struct conversation_key *next;
 	address	addr1;
 	address	addr2;
 	endpoint_type etype;
 	guint32	port1;
 	guint32	port2;
+	/*
+	 * If the addresses are IPv4, IPv6 or absent, which is the case for
+	 * nearly all conversations, the fields that the hash table holding
+	 * the key compares, packed into fixed-size words, which are hashed
+	 * and compared instead of going through the generic address code.
+	 */
+	gboolean packed;
+	guint32	words[CONV_PACKED_WORDS];
 };
 
+/*
+ * The conversations that share a key, sorted by setup frame; this is what
+ * the hash tables map keys to. The key is a copy of the conversations' key.
+ * Most keys only ever have one conversation, which is then stored in the
+ * chain itself.
+ */
+typedef struct {
+	struct conversation_key key;
+	conversation_t **convs;
+	guint count;
+	guint size;
+	guint latest_found;	/* index of the latest match, as a hint */
+	conversation_t *first;
+} conversation_chain_t;
+
 /*
  * Hash table for conversations with no wildcards.
  */
@@ -167,6 +195,66 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 	}
 }
 
+static inline gboolean
+conversation_address_packable(const address *addr)
+{
+	return (addr->type == AT_IPv4 && addr->len == 4) ||
+	    (addr->type == AT_IPv6 && addr->len == 16) ||
+	    (addr->type == AT_NONE && addr->len == 0);
+}
+
+/*
+ * Fill in the packed form of a key, leaving out address 2 and/or port 2
+ * if they are wildcarded (NO_ADDR2 and NO_PORT2 in "wildcards") in the
+ * hash table the key is for.
+ */
+static void
+conversation_key_pack(struct conversation_key *key, const guint wildcards)
+{
+	guint32 *words = key->words;
+
+	key->packed = FALSE;
+	if (!conversation_address_packable(&key->addr1))
+		return;
+	if (!(wildcards & NO_ADDR2) && !conversation_address_packable(&key->addr2))
+		return;
+
+	memset(words, 0, sizeof key->words);
+	words[0] = ((guint32)key->etype << 16) | ((guint32)key->addr1.type << 8);
+	if (key->addr1.len)
+		memcpy(&words[1], key->addr1.data, key->addr1.len);
+	words[9] = key->port1;
+	if (!(wildcards & NO_ADDR2)) {
+		words[0] |= (guint32)key->addr2.type;
+		if (key->addr2.len)
+			memcpy(&words[5], key->addr2.data, key->addr2.len);
+	}
+	if (!(wildcards & NO_PORT2))
+		words[10] = key->port2;
+	key->packed = TRUE;
+}
+
+static inline guint
+conversation_hash_packed(const struct conversation_key *key)
+{
+	guint32 hash_val = 0;
+	int i;
+
+	for (i = 0; i < CONV_PACKED_WORDS; i++) {
+		hash_val ^= key->words[i];
+		hash_val *= 0x9e3779b1;
+		hash_val ^= hash_val >> 15;
+	}
+
+	return hash_val;
+}
+
+static inline gboolean
+conversation_match_packed(const struct conversation_key *v1, const struct conversation_key *v2)
+{
+	return memcmp(v1->words, v2->words, sizeof v1->words) == 0;
+}
+
 /*
  * Compute the hash value for two given address/port pairs if the match
  * is to be exact.
@@ -181,6 +269,9 @@ conversation_hash_exact(gconstpointer v)
 	guint hash_val;
 	address tmp_addr;
 
+	if (key->packed)
+		return conversation_hash_packed(key);
+
 	hash_val = 0;
 	tmp_addr.len  = 4;
 
@@ -210,6 +301,13 @@ conversation_match_exact(gconstpointer v, gconstpointer w)
 	const conversation_key_t v1 = (const conversation_key_t)v;
 	const conversation_key_t v2 = (const conversation_key_t)w;
 
+	/*
+	 * Packed keys only hold one direction; the generic code below
+	 * also checks for the opposite one.
+	 */
+	if (v1->packed && v2->packed && conversation_match_packed(v1, v2))
+		return 1;
+
 	if (v1->etype != v2->etype)
 		return 0;	/* different types of port */
 
@@ -264,6 +362,9 @@ conversation_hash_no_addr2(gconstpointer v)
 	guint hash_val;
 	address tmp_addr;
 
+	if (key->packed)
+		return conversation_hash_packed(key);
+
 	hash_val = 0;
 	tmp_addr.len  = 4;
 
@@ -294,6 +395,9 @@ conversation_match_no_addr2(gconstpointer v, gconstpointer w)
 	const conversation_key_t v1 = (const conversation_key_t)v;
 	const conversation_key_t v2 = (const conversation_key_t)w;
 
+	if (v1->packed && v2->packed)
+		return conversation_match_packed(v1, v2);
+
 	if (v1->etype != v2->etype)
 		return 0;	/* different types of port */
 
@@ -329,6 +433,9 @@ conversation_hash_no_port2(gconstpointer v)
 	guint hash_val;
 	address tmp_addr;
 
+	if (key->packed)
+		return conversation_hash_packed(key);
+
 	hash_val = 0;
 	tmp_addr.len  = 4;
 
@@ -358,6 +465,9 @@ conversation_match_no_port2(gconstpointer v, gconstpointer w)
 	const conversation_key_t v1 = (const conversation_key_t)v;
 	const conversation_key_t v2 = (const conversation_key_t)w;
 
+	if (v1->packed && v2->packed)
+		return conversation_match_packed(v1, v2);
+
 	if (v1->etype != v2->etype)
 		return 0;	/* different types of port */
 
@@ -393,6 +503,9 @@ conversation_hash_no_addr2_or_port2(gconstpointer v)
 	guint hash_val;
 	address tmp_addr;
 
+	if (key->packed)
+		return conversation_hash_packed(key);
+
 	hash_val = 0;
 	tmp_addr.len  = 4;
 
@@ -420,6 +533,9 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 	const conversation_key_t v1 = (const conversation_key_t)v;
 	const conversation_key_t v2 = (const conversation_key_t)w;
 
+	if (v1->packed && v2->packed)
+		return conversation_match_packed(v1, v2);
+
 	if (v1->etype != v2->etype)
 		return 0;	/* different types of port */
 
@@ -483,120 +599,135 @@ void conversation_epan_reset(void)
 }
 
 /*
- * Does the right thing when inserting into one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
- *
- * Mostly adapted from the old conversation_new().
+ * The fields that are wildcarded in the keys of a hash table, as NO_ADDR2
+ * and NO_PORT2 flags.
+ */
+static guint
+conversation_table_wildcards(const wmem_map_t *hashtable)
+{
+	if (hashtable == conversation_hashtable_exact)
+		return 0;
+	if (hashtable == conversation_hashtable_no_addr2)
+		return NO_ADDR2;
+	if (hashtable == conversation_hashtable_no_port2)
+		return NO_PORT2;
+	return NO_ADDR2|NO_PORT2;
+}
+
+/*
+ * Index of the first conversation in a chain set up after frame_num.
+ */
+static guint
+conversation_chain_upper_bound(const conversation_chain_t *chain, const guint32 frame_num)
+{
+	guint low = 0, high = chain->count, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (chain->convs[mid]->setup_frame <= frame_num)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Adds a conversation to one of the conversation hash tables, after any
+ * conversation with the same key set up in the same frame or earlier.
  */
 static void
 conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
-	conversation_t *chain_head, *chain_tail, *cur, *prev;
+	conversation_chain_t *chain;
+	conversation_t **convs;
+	struct conversation_key key;
+	guint pos;
+
+	key = *conv->key_ptr;
+	conversation_key_pack(&key, conversation_table_wildcards(hashtable));
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, &key);
 
-	if (NULL==chain_head) {
+	if (NULL==chain) {
 		/* New entry */
-		conv->next = NULL;
-		conv->last = conv;
-		wmem_map_insert(hashtable, conv->key_ptr, conv);
+		chain = wmem_new0(wmem_file_scope(), conversation_chain_t);
+		chain->key = key;
+		chain->convs = &chain->first;
+		chain->size = 1;
+		wmem_map_insert(hashtable, &chain->key, chain);
 		DPRINT(("created a new conversation chain"));
 	}
 	else {
 		/* There's an existing chain for this key */
 		DPRINT(("there's an existing conversation chain"));
+	}
 
-		chain_tail = chain_head->last;
+	if (chain->count == chain->size) {
+		convs = wmem_alloc_array(wmem_file_scope(), conversation_t *, chain->size * 2);
+		memcpy(convs, chain->convs, chain->count * sizeof *convs);
+		if (chain->convs != &chain->first)
+			wmem_free(wmem_file_scope(), chain->convs);
+		chain->convs = convs;
+		chain->size *= 2;
+	}
 
-		if(conv->setup_frame >= chain_tail->setup_frame) {
-			/* This convo belongs at the end of the chain */
-			conv->next = NULL;
-			conv->last = NULL;
-			chain_tail->next = conv;
-			chain_head->last = conv;
-		}
-		else {
-			/* Loop through the chain to find the right spot */
-			cur = chain_head;
-			prev = NULL;
-
-			for (; (conv->setup_frame > cur->setup_frame) && cur->next; prev=cur, cur=cur->next)
-				;
-
-			if (NULL==prev) {
-				/* Changing the head of the chain */
-				conv->next = chain_head;
-				conv->last = chain_tail;
-				chain_head->last = NULL;
-				wmem_map_insert(hashtable, conv->key_ptr, conv);
-			}
-			else {
-				/* Inserting into the middle of the chain */
-				conv->next = cur;
-				conv->last = NULL;
-				prev->next = conv;
-			}
-		}
+	if (chain->count == 0 ||
+	    conv->setup_frame >= chain->convs[chain->count - 1]->setup_frame) {
+		/* This convo belongs at the end of the chain */
+		pos = chain->count;
 	}
+	else {
+		pos = conversation_chain_upper_bound(chain, conv->setup_frame);
+		memmove(&chain->convs[pos + 1], &chain->convs[pos],
+		    (chain->count - pos) * sizeof *chain->convs);
+	}
+	chain->convs[pos] = conv;
+	chain->count++;
 }
 
 /*
- * Does the right thing when removing from one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
+ * Removes a conversation from one of the conversation hash tables.
  */
 static void
 conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
-	conversation_t *chain_head, *cur, *prev;
-
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
-
-	if (conv == chain_head) {
-		/* We are currently the front of the chain */
-		if (NULL == conv->next) {
-			/* We are the only conversation in the chain, no need to
-			 * update next pointer, but do not call
-			 * wmem_map_remove() either because the conv data
-			 * will be re-inserted. */
-			wmem_map_steal(hashtable, conv->key_ptr);
-		}
-		else {
-			/* Update the head of the chain */
-			chain_head = conv->next;
-			chain_head->last = conv->last;
+	conversation_chain_t *chain;
+	struct conversation_key key;
+	guint pos;
 
-			if (conv->latest_found == conv)
-				chain_head->latest_found = NULL;
-			else
-				chain_head->latest_found = conv->latest_found;
+	key = *conv->key_ptr;
+	conversation_key_pack(&key, conversation_table_wildcards(hashtable));
 
-			wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
-		}
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, &key);
+	if (chain == NULL) {
+		/* XXX: Conversation not found. Wrong hashtable? */
+		return;
 	}
-	else {
-		/* We are not the front of the chain. Loop through to find us.
-		 * Start loop at chain_head->next rather than chain_head because
-		 * we already know we're not at the head. */
-		cur = chain_head->next;
-		prev = chain_head;
-
-		for (; (cur != conv) && cur->next; prev=cur, cur=cur->next)
-			;
-
-		if (cur != conv) {
-			/* XXX: Conversation not found. Wrong hashtable? */
-			return;
-		}
-
-		prev->next = conv->next;
-
-		if (NULL == conv->next) {
-			/* We're at the very end of the list. */
-			chain_head->last = prev;
-		}
 
-		if (chain_head->latest_found == conv)
-			chain_head->latest_found = prev;
+	/* Find us among the conversations set up in the same frame */
+	pos = conversation_chain_upper_bound(chain, conv->setup_frame);
+	while (pos > 0 && chain->convs[pos - 1]->setup_frame == conv->setup_frame &&
+	    chain->convs[pos - 1] != conv)
+		pos--;
+	if (pos == 0 || chain->convs[pos - 1] != conv) {
+		/* XXX: Conversation not found. Wrong hashtable? */
+		return;
+	}
+	pos--;
+
+	chain->count--;
+	memmove(&chain->convs[pos], &chain->convs[pos + 1],
+	    (chain->count - pos) * sizeof *chain->convs);
+	chain->latest_found = 0;
+
+	if (chain->count == 0) {
+		/* We were the only conversation in the chain */
+		wmem_map_remove(hashtable, &chain->key);
+		if (chain->convs != &chain->first)
+			wmem_free(wmem_file_scope(), chain->convs);
+		wmem_free(wmem_file_scope(), chain);
 	}
 }
 
@@ -652,6 +783,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	new_key->etype = etype;
 	new_key->port1 = port1;
 	new_key->port2 = port2;
+	new_key->packed = FALSE;
 
 	conversation = wmem_new(wmem_file_scope(), conversation_t);
 	memset(conversation, 0, sizeof(conversation_t));
@@ -760,11 +892,17 @@ static conversation_t *
 conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
     const endpoint_type etype, const guint32 port1, const guint32 port2)
 {
-	conversation_t* convo=NULL;
-	conversation_t* match=NULL;
-	conversation_t* chain_head=NULL;
+	conversation_chain_t* chain;
+	guint hint, pos;
 	struct conversation_key key;
 
+	/*
+	 * Most captures have few or no wildcarded conversations, so
+	 * don't bother building a key for an empty table.
+	 */
+	if (wmem_map_size(hashtable) == 0)
+		return NULL;
+
 	/*
 	 * We don't make a copy of the address data, we just copy the
 	 * pointer to it, as "key" disappears when we return.
@@ -782,29 +920,30 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 	key.etype = etype;
 	key.port1 = port1;
 	key.port2 = port2;
+	conversation_key_pack(&key, conversation_table_wildcards(hashtable));
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, &key);
+	chain = (conversation_chain_t *)wmem_map_lookup(hashtable, &key);
 
-	if (chain_head && (chain_head->setup_frame <= frame_num)) {
-		match = chain_head;
-
-		if((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
-			return chain_head->last;
+	if (chain == NULL || chain->convs[0]->setup_frame > frame_num)
+		return NULL;
 
-		if((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
-			match = chain_head->latest_found;
+	/* The latest conversation is the usual answer when going through
+	 * the file in order. */
+	if (chain->convs[chain->count - 1]->setup_frame <= frame_num)
+		return chain->convs[chain->count - 1];
 
-		for (convo = match; convo && convo->setup_frame <= frame_num; convo = convo->next) {
-			if (convo->setup_frame > match->setup_frame) {
-				match = convo;
-			}
-		}
-	}
+	/* Otherwise, when revisiting an older frame, try the previous
+	 * answer before searching the chain. */
+	hint = chain->latest_found;
+	if (hint + 1 < chain->count &&
+	    chain->convs[hint]->setup_frame <= frame_num &&
+	    chain->convs[hint + 1]->setup_frame > frame_num)
+		return chain->convs[hint];
 
-	if (match)
-		chain_head->latest_found = match;
+	pos = conversation_chain_upper_bound(chain, frame_num) - 1;
+	chain->latest_found = pos;
 
-	return match;
+	return chain->convs[pos];
 }
 
 
@@ -87,10 +87,6 @@ struct conversation_key;
 typedef struct conversation_key* conversation_key_t;
 
 typedef struct conversation {
-	struct conversation *next;	/** pointer to next conversation on hash chain */
-	struct conversation *last;	/** pointer to the last conversation on hash chain */
-	struct conversation *latest_found;
-								/** pointer to the last conversation on hash chain */
 	guint32	conv_index;				/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
 	/* Assume that setup_frame is also the lowest frame number for now. */
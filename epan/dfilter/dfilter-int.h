@@ -15,17 +15,44 @@
 #include <epan/proto.h>
 #include <stdio.h>
 
+/* What the values in a register have in common; lets the VM use a
+ * comparison loop specialized for that kind of value. */
+typedef enum {
+	DF_REG_GENERIC,		/* compare through the ftype's functions */
+	DF_REG_UINT32,		/* unsigned integers of up to 32 bits */
+	DF_REG_INT32		/* signed integers of up to 32 bits */
+} df_register_kind_t;
+
+/* A register of the display filter VM. The array of values is kept
+ * between runs of the filter and only grows, so once it is large enough
+ * for the packets being filtered no more memory is allocated. */
+typedef struct {
+	fvalue_t	**values;
+	guint		len;		/* number of values loaded in this run */
+	guint		size;		/* allocated length of values */
+	df_register_kind_t kind;	/* kind shared by all the values */
+	gboolean	free_values;	/* values were created by the VM itself */
+} df_register_t;
+
+/* Statistics kept for an instruction when profiling is enabled. */
+typedef struct {
+	guint64		evaluations;
+	guint64		matches;
+	gint64		elapsed;	/* microseconds */
+} df_insn_profile_t;
+
 /* Passed back to user */
 struct epan_dfilter {
 	GPtrArray	*insns;
 	GPtrArray	*consts;
 	guint		num_registers;
 	guint		max_registers;
-	GList		**registers;
+	df_register_t	*registers;
 	gboolean	*attempted_load;
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	df_insn_profile_t *profile;	/* one per instruction, or NULL */
 };
 
 typedef struct {
@@ -41,6 +68,7 @@ typedef struct {
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
+	GHashTable	*regexes;	/* pattern -> GRegex, for "matches" */
 } dfwork_t;
 
 /*
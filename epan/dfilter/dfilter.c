@@ -135,9 +135,7 @@ dfilter_free(dfilter_t *df)
 
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-		}
+		dfvm_register_free(&df->registers[i]);
 	}
 
 	if (df->deprecated) {
@@ -150,6 +148,7 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->registers);
 	g_free(df->attempted_load);
+	g_free(df->profile);
 	g_free(df);
 }
 
@@ -188,6 +187,10 @@ dfwork_free(dfwork_t *dfw)
 		free_insns(dfw->consts);
 	}
 
+	if (dfw->regexes) {
+		g_hash_table_destroy(dfw->regexes);
+	}
+
 	/*
 	 * We don't free the error message string; our caller will return
 	 * it to its caller.
@@ -195,55 +198,45 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
-gboolean
-dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+static void
+free_deprecated(GPtrArray *deprecated)
+{
+	guint i;
+
+	for (i = 0; i < deprecated->len; ++i) {
+		gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
+		g_free(depr);
+	}
+	g_ptr_array_free(deprecated, TRUE);
+}
+
+/* Parses a (macro-expanded) filter string and checks its semantics,
+ * leaving the syntax tree in dfw->st_root; that's NULL for an empty
+ * filter. On failure, dfw->error_message may be set. */
+static gboolean
+dfw_parse(dfwork_t *dfw, const gchar *expanded_text, GPtrArray *deprecated)
 {
-	gchar		*expanded_text;
 	int		token;
-	dfilter_t	*dfilter;
-	dfwork_t	*dfw;
 	df_scanner_state_t state;
 	yyscan_t	scanner;
 	YY_BUFFER_STATE in_buffer;
 	gboolean failure = FALSE;
 	const char	*depr_test;
 	guint		i;
-	/* XXX, GHashTable */
-	GPtrArray	*deprecated;
-
-	g_assert(dfp);
-
-	if (!text) {
-		*dfp = NULL;
-		if (err_msg != NULL)
-			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
-		return FALSE;
-	}
-
-	if ( !( expanded_text = dfilter_macro_apply(text, err_msg) ) ) {
-		return FALSE;
-	}
 
 	if (df_lex_init(&scanner) != 0) {
-		wmem_free(NULL, expanded_text);
-		*dfp = NULL;
-		if (err_msg != NULL)
-			*err_msg = g_strdup_printf("Can't initialize scanner: %s",
-			    g_strerror(errno));
+		dfw->error_message = g_strdup_printf("Can't initialize scanner: %s",
+		    g_strerror(errno));
 		return FALSE;
 	}
 
 	in_buffer = df__scan_string(expanded_text, scanner);
 
-	dfw = dfwork_new();
-
 	state.dfw = dfw;
 	state.quoted_string = NULL;
 
 	df_set_extra(&state, scanner);
 
-	deprecated = g_ptr_array_new();
-
 	while (1) {
 		df_lval = stnode_new(STTYPE_UNINITIALIZED, NULL);
 		token = df_lex(scanner);
@@ -313,51 +306,84 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	df_lex_destroy(scanner);
 
 	if (failure)
+		return FALSE;
+
+	/* Check semantics and do necessary type conversion*/
+	if (dfw->st_root != NULL && !dfw_semcheck(dfw, deprecated))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Tucks away the bytecode generated in dfw in a new dfilter_t, which
+ * takes ownership of the deprecated list. */
+static dfilter_t *
+dfilter_from_dfw(dfwork_t *dfw, GPtrArray *deprecated)
+{
+	dfilter_t	*dfilter;
+
+	dfilter = dfilter_new();
+	dfilter->insns = dfw->insns;
+	dfilter->consts = dfw->consts;
+	dfw->insns = NULL;
+	dfw->consts = NULL;
+	dfilter->interesting_fields = dfw_interesting_fields(dfw,
+		&dfilter->num_interesting_fields);
+
+	/* Initialize run-time space */
+	dfilter->num_registers = dfw->first_constant;
+	dfilter->max_registers = dfw->next_register;
+	dfilter->registers = g_new0(df_register_t, dfilter->max_registers);
+	dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
+
+	/* Initialize constants */
+	dfvm_init_const(dfilter);
+
+	/* Add any deprecated items */
+	dfilter->deprecated = deprecated;
+
+	return dfilter;
+}
+
+gboolean
+dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	gchar		*expanded_text;
+	dfwork_t	*dfw;
+	/* XXX, GHashTable */
+	GPtrArray	*deprecated;
+
+	g_assert(dfp);
+
+	if (!text) {
+		*dfp = NULL;
+		if (err_msg != NULL)
+			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
+		return FALSE;
+	}
+
+	if ( !( expanded_text = dfilter_macro_apply(text, err_msg) ) ) {
+		return FALSE;
+	}
+
+	dfw = dfwork_new();
+	deprecated = g_ptr_array_new();
+
+	if (!dfw_parse(dfw, expanded_text, deprecated))
 		goto FAILURE;
 
 	/* Success, but was it an empty filter? If so, discard
 	 * it and set *dfp to NULL */
 	if (dfw->st_root == NULL) {
 		*dfp = NULL;
-		for (i = 0; i < deprecated->len; ++i) {
-			gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
-			g_free(depr);
-		}
-		g_ptr_array_free(deprecated, TRUE);
+		free_deprecated(deprecated);
 	}
 	else {
-
-		/* Check semantics and do necessary type conversion*/
-		if (!dfw_semcheck(dfw, deprecated)) {
-			goto FAILURE;
-		}
-
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
-		/* Tuck away the bytecode in the dfilter_t */
-		dfilter = dfilter_new();
-		dfilter->insns = dfw->insns;
-		dfilter->consts = dfw->consts;
-		dfw->insns = NULL;
-		dfw->consts = NULL;
-		dfilter->interesting_fields = dfw_interesting_fields(dfw,
-			&dfilter->num_interesting_fields);
-
-		/* Initialize run-time space */
-		dfilter->num_registers = dfw->first_constant;
-		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
-		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
-
-		/* Initialize constants */
-		dfvm_init_const(dfilter);
-
-		/* Add any deprecated items */
-		dfilter->deprecated = deprecated;
-
 		/* And give it to the user. */
-		*dfp = dfilter;
+		*dfp = dfilter_from_dfw(dfw, deprecated);
 	}
 	/* SUCCESS */
 	global_dfw = NULL;
@@ -366,19 +392,13 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	return TRUE;
 
 FAILURE:
-	if (dfw) {
-		if (err_msg != NULL)
-			*err_msg = dfw->error_message;
-		else
-			g_free(dfw->error_message);
-		global_dfw = NULL;
-		dfwork_free(dfw);
-	}
-	for (i = 0; i < deprecated->len; ++i) {
-		gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
-		g_free(depr);
-	}
-	g_ptr_array_free(deprecated, TRUE);
+	if (err_msg != NULL)
+		*err_msg = dfw->error_message;
+	else
+		g_free(dfw->error_message);
+	global_dfw = NULL;
+	dfwork_free(dfw);
+	free_deprecated(deprecated);
 	if (err_msg != NULL) {
 		/*
 		 * Default error message.
@@ -394,6 +414,80 @@ FAILURE:
 	return FALSE;
 }
 
+gboolean
+dfilter_compile_group(const gchar **texts, guint num_texts, dfilter_t **dfp,
+		gchar **err_msg, guint *err_index)
+{
+	gchar		*expanded_text = NULL;
+	dfwork_t	*dfw;
+	GPtrArray	*deprecated;
+	stnode_t	**roots;
+	guint		i;
+
+	g_assert(dfp);
+
+	*dfp = NULL;
+	if (err_msg != NULL)
+		*err_msg = NULL;
+
+	dfw = dfwork_new();
+	deprecated = g_ptr_array_new();
+	roots = g_new0(stnode_t *, num_texts);
+
+	for (i = 0; i < num_texts; i++) {
+		if (texts[i] == NULL)
+			continue;
+
+		if (err_index != NULL)
+			*err_index = i;
+
+		if ( !( expanded_text = dfilter_macro_apply(texts[i], err_msg) ) )
+			goto FAILURE;
+
+		if (!dfw_parse(dfw, expanded_text, deprecated)) {
+			if (err_msg != NULL) {
+				*err_msg = dfw->error_message;
+				if (*err_msg == NULL)
+					*err_msg = g_strdup_printf("Unable to parse filter string \"%s\".", expanded_text);
+			}
+			else
+				g_free(dfw->error_message);
+			dfw->error_message = NULL;
+			goto FAILURE;
+		}
+		wmem_free(NULL, expanded_text);
+		expanded_text = NULL;
+
+		/* Keep the tree away from the next parse. */
+		roots[i] = dfw->st_root;
+		dfw->st_root = NULL;
+	}
+
+	/* Create bytecode */
+	dfw_gencode_group(dfw, roots, num_texts);
+	*dfp = dfilter_from_dfw(dfw, deprecated);
+
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i])
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
+	global_dfw = NULL;
+	dfwork_free(dfw);
+	return TRUE;
+
+FAILURE:
+	wmem_free(NULL, expanded_text);
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i])
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
+	global_dfw = NULL;
+	dfwork_free(dfw);
+	free_deprecated(deprecated);
+	return FALSE;
+}
 
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
@@ -407,6 +501,18 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+int
+dfilter_apply_first(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_apply_first(df, tree);
+}
+
+int
+dfilter_apply_edt_first(dfilter_t *df, epan_dissect_t* edt)
+{
+	return dfvm_apply_first(df, edt->tree);
+}
+
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
@@ -450,6 +556,23 @@ dfilter_dump(dfilter_t *df)
 	}
 }
 
+void
+dfilter_set_profiling(dfilter_t *df, gboolean enable)
+{
+	g_free(df->profile);
+	df->profile = NULL;
+
+	if (enable) {
+		df->profile = g_new0(df_insn_profile_t, df->insns->len);
+	}
+}
+
+void
+dfilter_dump_profile(dfilter_t *df)
+{
+	dfvm_dump_profile(stdout, df);
+}
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
@@ -49,6 +49,28 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg);
 
+/* Compiles a list of filter strings into a single program, for
+ * callers such as the coloring rules that need to know which of
+ * several filters is the first to match a packet. A field used by
+ * more than one of the filters is only looked up once per packet.
+ *
+ * NULL or all-blank strings are allowed, and never match.
+ *
+ * On success, sets *dfp to the newly-allocated dfilter_t,
+ * which is run with dfilter_apply_edt_first(); dfilter_apply_edt()
+ * tells whether any of the filters matches.
+ *
+ * On failure, *err_msg is set as with dfilter_compile(), and, if
+ * err_index isn't NULL, *err_index is set to the index of the
+ * string that failed to compile.
+ *
+ * Returns TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean
+dfilter_compile_group(const gchar **texts, guint num_texts, dfilter_t **dfp,
+		gchar **err_msg, guint *err_index);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -64,6 +86,16 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Apply a dfilter compiled with dfilter_compile_group(). Returns the
+ * index of the first filter that matches, or -1 if none does. */
+WS_DLL_PUBLIC
+int
+dfilter_apply_edt_first(dfilter_t *df, struct epan_dissect *edt);
+
+/* Apply a dfilter compiled with dfilter_compile_group(). */
+int
+dfilter_apply_first(dfilter_t *df, proto_tree *tree);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
@@ -81,6 +113,19 @@ WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* Start (TRUE) or stop (FALSE) counting how often each "matches" test
+ * of the filter is evaluated, how often it matches and how long the
+ * regular expression takes. Starting resets the counters. */
+WS_DLL_PUBLIC
+void
+dfilter_set_profiling(dfilter_t *df, gboolean enable);
+
+/* Print the counters kept by dfilter_set_profiling(), one line per
+ * "matches" test. */
+WS_DLL_PUBLIC
+void
+dfilter_dump_profile(dfilter_t *df);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
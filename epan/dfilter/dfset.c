@@ -0,0 +1,503 @@
+/* dfset.c
+ * Compiled sets of constant values for the display filter "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfset.h"
+
+#include <ftypes/ftypes-int.h>
+
+/* How the values of a set are turned into hash keys. */
+typedef enum {
+	SET_KEY_NONE,		/* not hashed; compared one by one */
+	SET_KEY_INTEGER,	/* 64-bit integer */
+	SET_KEY_BYTES		/* string of bytes */
+} set_key_type_t;
+
+typedef struct {
+	const guint8	*data;
+	guint		len;
+} set_bytes_key_t;
+
+typedef struct {
+	guint64		low;
+	guint64		high;
+} set_range_t;
+
+/* An element as written in the filter: a value, or a range if high
+ * is not NULL. */
+typedef struct {
+	fvalue_t	*low;
+	fvalue_t	*high;
+} set_element_t;
+
+struct _df_set_t {
+	ftenum_t	ftype;		/* ftype of the first element */
+	set_key_type_t	key_type;
+	GArray		*elements;	/* all the elements (set_element_t) */
+	GHashTable	*hash;		/* hashed values */
+	GArray		*ranges;	/* sorted, disjoint integer ranges (set_range_t) */
+	GArray		*linear;	/* elements compared one by one (set_element_t) */
+};
+
+/* Flipping the sign bit maps signed integers to unsigned ones
+ * in the same order. */
+#define SIGN_BIT	G_GUINT64_CONSTANT(0x8000000000000000)
+
+static set_key_type_t
+set_key_type(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+		case FT_FRAMENUM:
+		case FT_IPv4:
+			return SET_KEY_INTEGER;
+
+		case FT_IPv6:
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return SET_KEY_BYTES;
+
+		default:
+			return SET_KEY_NONE;
+	}
+}
+
+/* Returns FALSE if the value can't be represented by an integer key
+ * that compares the same way as the ftype's own comparison functions. */
+static gboolean
+integer_key(const fvalue_t *fv, guint64 *key)
+{
+	switch (fv->ftype->ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+			*key = fv->value.uinteger;
+			return TRUE;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+			*key = fv->value.uinteger64;
+			return TRUE;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			*key = (guint64)(gint64)fv->value.sinteger ^ SIGN_BIT;
+			return TRUE;
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			*key = (guint64)fv->value.sinteger64 ^ SIGN_BIT;
+			return TRUE;
+
+		case FT_IPv4:
+			/* A prefix matches more than one address. */
+			if (fv->value.ipv4.nmask != 0xffffffff)
+				return FALSE;
+			*key = fv->value.ipv4.addr;
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+/* Same as integer_key(), for values hashed as strings of bytes. The key
+ * points into the fvalue. */
+static gboolean
+bytes_key(const fvalue_t *fv, set_bytes_key_t *key)
+{
+	switch (fv->ftype->ftype) {
+		case FT_IPv6:
+			/* A prefix matches more than one address. */
+			if (fv->value.ipv6.prefix != 128)
+				return FALSE;
+			key->data = fv->value.ipv6.addr.bytes;
+			key->len = (guint)sizeof fv->value.ipv6.addr.bytes;
+			return TRUE;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+			key->data = fv->value.bytes->data;
+			key->len = fv->value.bytes->len;
+			return TRUE;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			key->data = (const guint8 *)fv->value.string;
+			key->len = (guint)strlen(fv->value.string);
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static guint
+bytes_key_hash(gconstpointer k)
+{
+	const set_bytes_key_t *key = (const set_bytes_key_t *)k;
+	guint	hash = 5381;
+	guint	i;
+
+	for (i = 0; i < key->len; i++)
+		hash = (hash << 5) + hash + key->data[i];
+
+	return hash;
+}
+
+static gboolean
+bytes_key_equal(gconstpointer k1, gconstpointer k2)
+{
+	const set_bytes_key_t *key1 = (const set_bytes_key_t *)k1;
+	const set_bytes_key_t *key2 = (const set_bytes_key_t *)k2;
+
+	return key1->len == key2->len &&
+		memcmp(key1->data, key2->data, key1->len) == 0;
+}
+
+df_set_t *
+df_set_new(void)
+{
+	df_set_t *set;
+
+	set = g_new0(df_set_t, 1);
+	set->ftype = FT_NONE;
+	set->key_type = SET_KEY_NONE;
+	set->elements = g_array_new(FALSE, FALSE, sizeof(set_element_t));
+	set->linear = g_array_new(FALSE, FALSE, sizeof(set_element_t));
+	return set;
+}
+
+static void
+add_to_linear(df_set_t *set, const set_element_t *element)
+{
+	g_array_append_vals(set->linear, element, 1);
+}
+
+static void
+add_integer(df_set_t *set, const set_element_t *element)
+{
+	guint64		*key;
+	set_range_t	range;
+
+	if (element->high == NULL) {
+		key = g_new(guint64, 1);
+		if (!integer_key(element->low, key)) {
+			g_free(key);
+			add_to_linear(set, element);
+			return;
+		}
+		g_hash_table_insert(set->hash, key, key);
+		return;
+	}
+
+	/* Only ranges of plain integers are kept sorted; an IPv4 range is
+	 * compared with the ftype's own ordering. */
+	if (element->low->ftype->ftype == FT_IPv4 ||
+	    !integer_key(element->low, &range.low) ||
+	    !integer_key(element->high, &range.high)) {
+		add_to_linear(set, element);
+		return;
+	}
+
+	/* An empty range never matches. */
+	if (range.low > range.high)
+		return;
+
+	if (set->ranges == NULL)
+		set->ranges = g_array_new(FALSE, FALSE, sizeof(set_range_t));
+	g_array_append_val(set->ranges, range);
+}
+
+static void
+add_bytes(df_set_t *set, const set_element_t *element)
+{
+	set_bytes_key_t	*key;
+
+	if (element->high != NULL) {
+		add_to_linear(set, element);
+		return;
+	}
+
+	key = g_new(set_bytes_key_t, 1);
+	if (!bytes_key(element->low, key)) {
+		g_free(key);
+		add_to_linear(set, element);
+		return;
+	}
+	g_hash_table_insert(set->hash, key, key);
+}
+
+void
+df_set_add(df_set_t *set, fvalue_t *low, fvalue_t *high)
+{
+	set_element_t element;
+
+	element.low = low;
+	element.high = high;
+	g_array_append_val(set->elements, element);
+
+	if (set->elements->len == 1) {
+		set->ftype = fvalue_type_ftenum(low);
+		set->key_type = set_key_type(set->ftype);
+		switch (set->key_type) {
+			case SET_KEY_INTEGER:
+				set->hash = g_hash_table_new_full(g_int64_hash,
+						g_int64_equal, g_free, NULL);
+				break;
+			case SET_KEY_BYTES:
+				set->hash = g_hash_table_new_full(bytes_key_hash,
+						bytes_key_equal, g_free, NULL);
+				break;
+			case SET_KEY_NONE:
+				break;
+		}
+	}
+
+	if (fvalue_type_ftenum(low) != set->ftype ||
+	    (high && fvalue_type_ftenum(high) != set->ftype)) {
+		add_to_linear(set, &element);
+		return;
+	}
+
+	switch (set->key_type) {
+		case SET_KEY_INTEGER:
+			add_integer(set, &element);
+			break;
+		case SET_KEY_BYTES:
+			add_bytes(set, &element);
+			break;
+		case SET_KEY_NONE:
+			add_to_linear(set, &element);
+			break;
+	}
+}
+
+static int
+range_compare(const void *a, const void *b)
+{
+	const set_range_t *range_a = (const set_range_t *)a;
+	const set_range_t *range_b = (const set_range_t *)b;
+
+	if (range_a->low < range_b->low)
+		return -1;
+	if (range_a->low > range_b->low)
+		return 1;
+	return 0;
+}
+
+void
+df_set_finish(df_set_t *set)
+{
+	set_range_t	*ranges;
+	guint		i, n;
+
+	if (set->ranges == NULL || set->ranges->len == 0)
+		return;
+
+	/* Sort the ranges and merge the ones that overlap or touch, so that
+	 * they can be searched with a binary search. */
+	ranges = (set_range_t *)(void *)set->ranges->data;
+	qsort(ranges, set->ranges->len, sizeof(set_range_t), range_compare);
+
+	n = 0;
+	for (i = 1; i < set->ranges->len; i++) {
+		if (ranges[i].low <= ranges[n].high ||
+		    ranges[i].low - 1 == ranges[n].high) {
+			if (ranges[i].high > ranges[n].high)
+				ranges[n].high = ranges[i].high;
+		}
+		else {
+			ranges[++n] = ranges[i];
+		}
+	}
+	g_array_set_size(set->ranges, n + 1);
+}
+
+static gboolean
+ranges_contain(const GArray *array, guint64 key)
+{
+	const set_range_t *ranges = (const set_range_t *)(void *)array->data;
+	guint	low = 0;
+	guint	high = array->len;
+	guint	mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (key < ranges[mid].low)
+			high = mid;
+		else if (key > ranges[mid].high)
+			low = mid + 1;
+		else
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+element_matches(const set_element_t *element, const fvalue_t *fv)
+{
+	if (element->high == NULL)
+		return fvalue_eq(fv, element->low);
+
+	return fvalue_ge(fv, element->low) && fvalue_le(fv, element->high);
+}
+
+static gboolean
+elements_match(const GArray *array, const fvalue_t *fv)
+{
+	const set_element_t *elements = (const set_element_t *)(void *)array->data;
+	guint	i;
+
+	for (i = 0; i < array->len; i++) {
+		if (element_matches(&elements[i], fv))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv)
+{
+	guint64		int_key;
+	set_bytes_key_t	key;
+
+	if (fv->ftype->ftype == set->ftype) {
+		switch (set->key_type) {
+			case SET_KEY_INTEGER:
+				if (!integer_key(fv, &int_key))
+					break;
+				if (g_hash_table_lookup(set->hash, &int_key))
+					return TRUE;
+				if (set->ranges && ranges_contain(set->ranges, int_key))
+					return TRUE;
+				return elements_match(set->linear, fv);
+
+			case SET_KEY_BYTES:
+				if (!bytes_key(fv, &key))
+					break;
+				if (g_hash_table_lookup(set->hash, &key))
+					return TRUE;
+				return elements_match(set->linear, fv);
+
+			case SET_KEY_NONE:
+				break;
+		}
+	}
+
+	/* Values that can't be looked up (e.g. of another field with the
+	 * same name but a different type) are compared with every element. */
+	return elements_match(set->elements, fv);
+}
+
+void
+df_set_dump(FILE *f, const df_set_t *set)
+{
+	const set_element_t *elements = (const set_element_t *)(void *)set->elements->data;
+	char	*low_str, *high_str;
+	guint	i;
+
+	/* Print the first few elements; a set may have thousands. */
+	fprintf(f, "{");
+	for (i = 0; i < set->elements->len && i < 8; i++) {
+		low_str = fvalue_to_string_repr(NULL, elements[i].low,
+				FTREPR_DFILTER, BASE_NONE);
+		if (elements[i].high) {
+			high_str = fvalue_to_string_repr(NULL, elements[i].high,
+					FTREPR_DFILTER, BASE_NONE);
+			fprintf(f, "%s%s..%s", i ? " " : "", low_str, high_str);
+			wmem_free(NULL, high_str);
+		}
+		else {
+			fprintf(f, "%s%s", i ? " " : "", low_str);
+		}
+		wmem_free(NULL, low_str);
+	}
+	if (i < set->elements->len)
+		fprintf(f, " ... %u more", set->elements->len - i);
+	fprintf(f, "} <%s> [hashed %u, ranges %u, linear %u]",
+		ftype_name(set->ftype),
+		set->hash ? g_hash_table_size(set->hash) : 0,
+		set->ranges ? set->ranges->len : 0,
+		set->linear->len);
+}
+
+void
+df_set_free(df_set_t *set)
+{
+	set_element_t	*elements;
+	guint		i;
+
+	if (set->hash)
+		g_hash_table_destroy(set->hash);
+	if (set->ranges)
+		g_array_free(set->ranges, TRUE);
+	g_array_free(set->linear, TRUE);
+
+	elements = (set_element_t *)(void *)set->elements->data;
+	for (i = 0; i < set->elements->len; i++) {
+		FVALUE_FREE(elements[i].low);
+		if (elements[i].high) {
+			FVALUE_FREE(elements[i].high);
+		}
+	}
+	g_array_free(set->elements, TRUE);
+	g_free(set);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,50 @@
+/* dfset.h
+ * Compiled sets of constant values for the display filter "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <stdio.h>
+
+#include <glib.h>
+#include <ftypes/ftypes.h>
+
+/* A set of constant values, built once when a filter is compiled.
+ *
+ * Values of integer, IPv4, IPv6, Ethernet, byte string and character
+ * string types are kept in a hash table; ranges of integers are kept in
+ * a sorted array and looked up with a binary search. Anything else
+ * (address prefixes, ranges of other types, values of other types) is
+ * compared one element at a time. */
+typedef struct _df_set_t df_set_t;
+
+df_set_t *
+df_set_new(void);
+
+/* Add a value (high is NULL) or a range of values [low, high] to the
+ * set. The set takes ownership of the fvalues. */
+void
+df_set_add(df_set_t *set, fvalue_t *low, fvalue_t *high);
+
+/* Must be called after the last df_set_add() and before the first
+ * df_set_contains(). */
+void
+df_set_finish(df_set_t *set);
+
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv);
+
+void
+df_set_dump(FILE *f, const df_set_t *set);
+
+void
+df_set_free(df_set_t *set);
+
+#endif
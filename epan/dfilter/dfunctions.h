@@ -12,9 +12,12 @@
 #include <glib.h>
 #include <ftypes/ftypes.h>
 #include "syntax-tree.h"
+#include "dfilter-int.h"
 
-/* The run-time logic of the dfilter function */
-typedef gboolean (*DFFuncType)(GList *arg1list, GList *arg2list, GList **retval);
+/* The run-time logic of the dfilter function. The function appends the
+ * fvalues it creates to retval with dfvm_register_append(); the VM frees
+ * them when the filter run is done. */
+typedef gboolean (*DFFuncType)(df_register_t *arg1, df_register_t *arg2, df_register_t *retval);
 
 /* The semantic check for the dfilter function */
 typedef void (*DFSemCheckType)(dfwork_t *dfw, int param_num, stnode_t *st_node);
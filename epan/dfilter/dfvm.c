@@ -36,6 +36,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			df_set_free(v->value.set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -118,8 +121,10 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
+			case RETURN_RULE:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -252,6 +257,13 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in ",
+					id, arg1->value.numeric);
+				df_set_dump(f, arg2->value.set);
+				fprintf(f, "\n");
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -260,6 +272,11 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				fprintf(f, "%05d RETURN\n", id);
 				break;
 
+			case RETURN_RULE:
+				fprintf(f, "%05d RETURN_RULE\t%u\n",
+						id, arg1->value.numeric);
+				break;
+
 			case IF_TRUE_GOTO:
 				fprintf(f, "%05d IF-TRUE-GOTO\t%u\n",
 						id, arg1->value.numeric);
@@ -277,6 +294,136 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	}
 }
 
+/* Returns the name of the field read into a register, if any. */
+static const char *
+register_field_name(dfilter_t *df, guint32 reg)
+{
+	dfvm_insn_t	*insn;
+	guint		id;
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		if (insn->op == READ_TREE && insn->arg2->value.numeric == reg)
+			return insn->arg1->value.hfinfo->abbrev;
+	}
+	return NULL;
+}
+
+void
+dfvm_dump_profile(FILE *f, dfilter_t *df)
+{
+	dfvm_insn_t		*insn;
+	df_insn_profile_t	*profile;
+	const df_register_t	*pattern_reg;
+	const char		*field;
+	char			*pattern;
+	guint			id;
+
+	if (!df->profile) {
+		fprintf(f, "Profiling is not enabled.\n");
+		return;
+	}
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		if (insn->op != ANY_MATCHES)
+			continue;
+
+		profile = &df->profile[id];
+		field = register_field_name(df, insn->arg1->value.numeric);
+		pattern_reg = &df->registers[insn->arg2->value.numeric];
+		pattern = NULL;
+		if (pattern_reg->len == 1) {
+			pattern = fvalue_to_string_repr(NULL, pattern_reg->values[0],
+					FTREPR_DFILTER, BASE_NONE);
+		}
+
+		fprintf(f, "%05u %s matches \"%s\": %" G_GINT64_MODIFIER "u evaluations, "
+			"%" G_GINT64_MODIFIER "u matches, %.3f ms",
+			id, field ? field : "<expression>",
+			pattern ? pattern : "?",
+			profile->evaluations, profile->matches,
+			profile->elapsed / 1000.0);
+		if (profile->evaluations) {
+			fprintf(f, " (%.3f us each)",
+				(double)profile->elapsed / profile->evaluations);
+		}
+		fprintf(f, "\n");
+		wmem_free(NULL, pattern);
+	}
+}
+
+/* Initial number of values a register can hold before it has to grow. */
+#define DF_REGISTER_INITIAL_SIZE	8
+
+static df_register_kind_t
+register_kind(const fvalue_t *fv)
+{
+	switch (fv->ftype->ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+			return DF_REG_UINT32;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return DF_REG_INT32;
+
+		default:
+			return DF_REG_GENERIC;
+	}
+}
+
+void
+dfvm_register_append(df_register_t *reg, fvalue_t *fv)
+{
+	df_register_kind_t kind;
+
+	if (reg->len == reg->size) {
+		reg->size = reg->size ? reg->size * 2 : DF_REGISTER_INITIAL_SIZE;
+		reg->values = g_renew(fvalue_t *, reg->values, reg->size);
+	}
+
+	kind = register_kind(fv);
+	if (reg->len == 0) {
+		reg->kind = kind;
+	}
+	else if (reg->kind != kind) {
+		reg->kind = DF_REG_GENERIC;
+	}
+
+	reg->values[reg->len++] = fv;
+}
+
+void
+dfvm_register_clear(df_register_t *reg)
+{
+	guint i;
+
+	if (reg->free_values) {
+		for (i = 0; i < reg->len; i++) {
+			FVALUE_FREE(reg->values[i]);
+		}
+		reg->free_values = FALSE;
+	}
+	reg->len = 0;
+	reg->kind = DF_REG_GENERIC;
+}
+
+void
+dfvm_register_free(df_register_t *reg)
+{
+	dfvm_register_clear(reg);
+	g_free(reg->values);
+	reg->values = NULL;
+	reg->size = 0;
+}
+
 /* Reads a field from the proto_tree and loads the fvalues into a register,
  * if that field has not already been read. */
 static gboolean
@@ -284,82 +431,200 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
-	int		i, len;
-	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
+	df_register_t	*r = &df->registers[reg];
+	guint		i;
 
 	/* Already loaded in this run of the dfilter? */
 	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
+		return r->len > 0;
 	}
 
 	df->attempted_load[reg] = TRUE;
 
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
-		if ((finfos == NULL) || (g_ptr_array_len(finfos) == 0)) {
-			hfinfo = hfinfo->same_name_next;
-			continue;
-		}
-		else {
-			found_something = TRUE;
-		}
-
-		len = finfos->len;
-		for (i = 0; i < len; i++) {
-			finfo = (field_info *)g_ptr_array_index(finfos, i);
-			fvalues = g_list_prepend(fvalues, &finfo->value);
+		if (finfos != NULL) {
+			for (i = 0; i < finfos->len; i++) {
+				finfo = (field_info *)g_ptr_array_index(finfos, i);
+				dfvm_register_append(r, &finfo->value);
+			}
 		}
 
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
-	}
-
-	df->registers[reg] = fvalues;
-	return TRUE;
+	return r->len > 0;
 }
 
 
 static gboolean
 put_fvalue(dfilter_t *df, fvalue_t *fv, int reg)
 {
-	df->registers[reg] = g_list_append(NULL, fv);
+	dfvm_register_append(&df->registers[reg], fv);
 	return TRUE;
 }
 
-typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
+static FvalueCmp
+cmp_func(const ftype_t *ftype, dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:
+			return ftype->cmp_eq;
+		case ANY_NE:
+			return ftype->cmp_ne;
+		case ANY_GT:
+			return ftype->cmp_gt;
+		case ANY_GE:
+			return ftype->cmp_ge;
+		case ANY_LT:
+			return ftype->cmp_lt;
+		case ANY_LE:
+			return ftype->cmp_le;
+		case ANY_BITWISE_AND:
+			return ftype->cmp_bitwise_and;
+		case ANY_CONTAINS:
+			return ftype->cmp_contains;
+		case ANY_MATCHES:
+			return ftype->cmp_matches;
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
 
+/* Compare every value of register a with every value of register b using
+ * the comparison function of a's ftype. The function is only looked up
+ * again when the ftype changes, which for fields loaded from the tree
+ * is normally never. */
 static gboolean
-any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
+any_test_generic(dfvm_opcode_t op, const df_register_t *a, const df_register_t *b)
 {
-	GList	*list_a, *list_b;
-
-	list_a = df->registers[reg1];
-
-	while (list_a) {
-		list_b = df->registers[reg2];
-		while (list_b) {
-			if (cmp((fvalue_t *)list_a->data, (fvalue_t *)list_b->data)) {
+	const ftype_t	*ftype = NULL;
+	FvalueCmp	cmp = NULL;
+	const fvalue_t	*fv_a;
+	guint		i, j;
+
+	for (i = 0; i < a->len; i++) {
+		fv_a = a->values[i];
+		if (fv_a->ftype != ftype) {
+			ftype = fv_a->ftype;
+			cmp = cmp_func(ftype, op);
+			g_assert(cmp);
+		}
+		for (j = 0; j < b->len; j++) {
+			if (cmp(fv_a, b->values[j])) {
 				return TRUE;
 			}
-			list_b = g_list_next(list_b);
 		}
-		list_a = g_list_next(list_a);
+	}
+	return FALSE;
+}
+
+/* Comparison loop for registers whose values are all integers stored in
+ * the same member of the fvalue union; the test is done inline instead
+ * of through a function pointer per pair. */
+#define ANY_TEST_INTEGER(type, member, test)				\
+	{								\
+		type va, vb;						\
+		for (i = 0; i < a->len; i++) {				\
+			va = a->values[i]->value.member;		\
+			for (j = 0; j < b->len; j++) {			\
+				vb = b->values[j]->value.member;	\
+				if (test) {				\
+					return TRUE;			\
+				}					\
+			}						\
+		}							\
+		return FALSE;						\
+	}
+
+static gboolean
+any_test_uint32(dfvm_opcode_t op, const df_register_t *a, const df_register_t *b)
+{
+	guint i, j;
+
+	switch (op) {
+		case ANY_EQ:
+			ANY_TEST_INTEGER(guint32, uinteger, va == vb);
+		case ANY_NE:
+			ANY_TEST_INTEGER(guint32, uinteger, va != vb);
+		case ANY_GT:
+			ANY_TEST_INTEGER(guint32, uinteger, va > vb);
+		case ANY_GE:
+			ANY_TEST_INTEGER(guint32, uinteger, va >= vb);
+		case ANY_LT:
+			ANY_TEST_INTEGER(guint32, uinteger, va < vb);
+		case ANY_LE:
+			ANY_TEST_INTEGER(guint32, uinteger, va <= vb);
+		case ANY_BITWISE_AND:
+			ANY_TEST_INTEGER(guint32, uinteger, (va & vb) != 0);
+		default:
+			return any_test_generic(op, a, b);
+	}
+}
+
+static gboolean
+any_test_int32(dfvm_opcode_t op, const df_register_t *a, const df_register_t *b)
+{
+	guint i, j;
+
+	switch (op) {
+		case ANY_EQ:
+			ANY_TEST_INTEGER(gint32, sinteger, va == vb);
+		case ANY_NE:
+			ANY_TEST_INTEGER(gint32, sinteger, va != vb);
+		case ANY_GT:
+			ANY_TEST_INTEGER(gint32, sinteger, va > vb);
+		case ANY_GE:
+			ANY_TEST_INTEGER(gint32, sinteger, va >= vb);
+		case ANY_LT:
+			ANY_TEST_INTEGER(gint32, sinteger, va < vb);
+		case ANY_LE:
+			ANY_TEST_INTEGER(gint32, sinteger, va <= vb);
+		case ANY_BITWISE_AND:
+			ANY_TEST_INTEGER(gint32, sinteger, (va & vb) != 0);
+		default:
+			return any_test_generic(op, a, b);
+	}
+}
+
+static gboolean
+any_test(dfilter_t *df, dfvm_opcode_t op, int reg1, int reg2)
+{
+	const df_register_t	*a = &df->registers[reg1];
+	const df_register_t	*b = &df->registers[reg2];
+
+	if (a->kind == b->kind) {
+		switch (a->kind) {
+			case DF_REG_UINT32:
+				return any_test_uint32(op, a, b);
+			case DF_REG_INT32:
+				return any_test_int32(op, a, b);
+			case DF_REG_GENERIC:
+				break;
+		}
+	}
+	return any_test_generic(op, a, b);
+}
+
+/* Returns true if any of the values in the register is in the set. */
+static gboolean
+any_in(dfilter_t *df, int reg, const df_set_t *set)
+{
+	const df_register_t	*a = &df->registers[reg];
+	guint			i;
+
+	for (i = 0; i < a->len; i++) {
+		if (df_set_contains(set, a->values[i]))
+			return TRUE;
 	}
 	return FALSE;
 }
 
 
-/* Free the list nodes w/o freeing the memory that each
- * list node points to. */
+/* Empty the registers used during this run of the filter. The value
+ * arrays are kept, so that the next run doesn't have to allocate them
+ * again; only fvalues created by the VM itself are freed. */
 static void
 free_register_overhead(dfilter_t* df)
 {
@@ -367,44 +632,40 @@ free_register_overhead(dfilter_t* df)
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-			df->registers[i] = NULL;
-		}
+		dfvm_register_clear(&df->registers[i]);
 	}
 }
 
-/* Takes the list of fvalue_t's in a register, uses fvalue_slice()
- * to make a new list of fvalue_t's (which are ranges, or byte-slices),
- * and puts the new list into a new register. */
+/* Takes the fvalue_t's in a register, uses fvalue_slice()
+ * to make new fvalue_t's (which are ranges, or byte-slices),
+ * and puts them into a new register. */
 static void
 mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 {
-	GList		*from_list, *to_list;
-	fvalue_t	*old_fv, *new_fv;
+	df_register_t	*from = &df->registers[from_reg];
+	df_register_t	*to = &df->registers[to_reg];
+	fvalue_t	*new_fv;
+	guint		i;
 
-	to_list = NULL;
-	from_list = df->registers[from_reg];
+	dfvm_register_clear(to);
+	to->free_values = TRUE;
 
-	while (from_list) {
-		old_fv = (fvalue_t*)from_list->data;
-		new_fv = fvalue_slice(old_fv, d_range);
+	for (i = 0; i < from->len; i++) {
+		new_fv = fvalue_slice(from->values[i], d_range);
 		/* Assert here because semcheck.c should have
 		 * already caught the cases in which a slice
 		 * cannot be made. */
 		g_assert(new_fv);
-		to_list = g_list_append(to_list, new_fv);
-
-		from_list = g_list_next(from_list);
+		dfvm_register_append(to, new_fv);
 	}
-
-	df->registers[to_reg] = to_list;
 }
 
 
 
-gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+/* Runs the program. If it was generated for a group of filters and one
+ * of them matches, stores the index of that filter in *rule. */
+static gboolean
+dfvm_run(dfilter_t *df, proto_tree *tree, int *rule)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -414,8 +675,10 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	dfvm_value_t	*arg3 = NULL;
 	dfvm_value_t	*arg4 = NULL;
 	header_field_info	*hfinfo;
-	GList		*param1;
-	GList		*param2;
+	df_register_t	*param1;
+	df_register_t	*param2;
+	df_register_t	*retval;
+	gint64		start;
 
 	g_assert(tree);
 
@@ -454,13 +717,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				param1 = NULL;
 				param2 = NULL;
 				if (arg3) {
-					param1 = df->registers[arg3->value.numeric];
+					param1 = &df->registers[arg3->value.numeric];
 				}
 				if (arg4) {
-					param2 = df->registers[arg4->value.numeric];
+					param2 = &df->registers[arg4->value.numeric];
 				}
+				retval = &df->registers[arg2->value.numeric];
+				dfvm_register_clear(retval);
+				retval->free_values = TRUE;
 				accum = arg1->value.funcdef->function(param1, param2,
-						&df->registers[arg2->value.numeric]);
+						retval);
 				break;
 
 			case MK_RANGE:
@@ -471,50 +737,65 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				break;
 
 			case ANY_EQ:
-				accum = any_test(df, fvalue_eq,
+				accum = any_test(df, ANY_EQ,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_NE:
-				accum = any_test(df, fvalue_ne,
+				accum = any_test(df, ANY_NE,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_GT:
-				accum = any_test(df, fvalue_gt,
+				accum = any_test(df, ANY_GT,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_GE:
-				accum = any_test(df, fvalue_ge,
+				accum = any_test(df, ANY_GE,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_LT:
-				accum = any_test(df, fvalue_lt,
+				accum = any_test(df, ANY_LT,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_LE:
-				accum = any_test(df, fvalue_le,
+				accum = any_test(df, ANY_LE,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_BITWISE_AND:
-				accum = any_test(df, fvalue_bitwise_and,
+				accum = any_test(df, ANY_BITWISE_AND,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_CONTAINS:
-				accum = any_test(df, fvalue_contains,
+				accum = any_test(df, ANY_CONTAINS,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
 			case ANY_MATCHES:
-				accum = any_test(df, fvalue_matches,
+				if (G_UNLIKELY(df->profile != NULL)) {
+					start = g_get_monotonic_time();
+					accum = any_test(df, ANY_MATCHES,
+							arg1->value.numeric, arg2->value.numeric);
+					df->profile[id].elapsed += g_get_monotonic_time() - start;
+					df->profile[id].evaluations++;
+					if (accum)
+						df->profile[id].matches++;
+					break;
+				}
+				accum = any_test(df, ANY_MATCHES,
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric,
+						arg2->value.set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -523,6 +804,14 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				free_register_overhead(df);
 				return accum;
 
+			case RETURN_RULE:
+				if (accum) {
+					*rule = arg1->value.numeric;
+					free_register_overhead(df);
+					return TRUE;
+				}
+				break;
+
 			case IF_TRUE_GOTO:
 				if (accum) {
 					id = arg1->value.numeric;
@@ -555,6 +844,23 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	int		rule;
+
+	return dfvm_run(df, tree, &rule);
+}
+
+int
+dfvm_apply_first(dfilter_t *df, proto_tree *tree)
+{
+	int		rule = -1;
+
+	dfvm_run(df, tree, &rule);
+	return rule;
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -589,8 +895,10 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
+			case RETURN_RULE:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -14,6 +14,7 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfset.h"
 
 typedef enum {
 	EMPTY,
@@ -23,7 +24,8 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET
 } dfvm_value_type_t;
 
 typedef struct {
@@ -35,6 +37,7 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		df_set_t		*set;
 	} value;
 
 } dfvm_value_t;
@@ -47,6 +50,7 @@ typedef enum {
 	CHECK_EXISTS,
 	NOT,
 	RETURN,
+	RETURN_RULE,
 	READ_TREE,
 	PUT_FVALUE,
 	ANY_EQ,
@@ -58,6 +62,7 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
 	MK_RANGE,
     CALL_FUNCTION
 
@@ -84,10 +89,28 @@ dfvm_value_new(dfvm_value_type_t type);
 void
 dfvm_dump(FILE *f, dfilter_t *df);
 
+void
+dfvm_dump_profile(FILE *f, dfilter_t *df);
+
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+int
+dfvm_apply_first(dfilter_t *df, proto_tree *tree);
+
 void
 dfvm_init_const(dfilter_t *df);
 
+/* Append an fvalue to a register, growing its value array if needed. */
+void
+dfvm_register_append(df_register_t *reg, fvalue_t *fv);
+
+/* Empty a register, keeping its value array for the next run. */
+void
+dfvm_register_clear(df_register_t *reg);
+
+/* Empty a register and release its value array. */
+void
+dfvm_register_free(df_register_t *reg);
+
 #endif
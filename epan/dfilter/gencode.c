@@ -277,8 +277,25 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
-/* Generate the code for the in operator.  It behaves much like an OR-ed
- * series of == tests, but without the redundant existence checks. */
+/* Generate an instruction that jumps to the end of the "in" test if the
+ * previous test matched; the jump is added to *jumplist to be fixed up. */
+static void
+gen_jump_if_true(dfwork_t *dfw, GSList **jumplist)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1;
+
+	insn = dfvm_insn_new(IF_TRUE_GOTO);
+	val1 = dfvm_value_new(INSN_NUMBER);
+	insn->arg1 = val1;
+	dfw_append_insn(dfw, insn);
+	*jumplist = g_slist_prepend(*jumplist, val1);
+}
+
+/* Generate the code for the in operator.  The constant elements of the
+ * set are compiled into a df_set_t that is tested with a single ANY_IN
+ * instruction; other elements (fields and functions) are tested like an
+ * OR-ed series of == tests, but without the redundant existence checks. */
 static void
 gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 {
@@ -286,15 +303,62 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	dfvm_value_t	*val1, *val2;
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
-	stnode_t	*node;
+	stnode_t	*node, *node_high;
 	GSList		*nodelist;
+	GSList		*others = NULL;
 	GSList		*jumplist = NULL;
+	df_set_t	*set = NULL;
 
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
-	/* Create code for the set on the RHS of the relation */
+	/* Collect the constant elements of the set on the RHS. The list
+	 * holds pairs of nodes; the second one is the upper bound of a
+	 * range, or NULL. */
 	nodelist = (GSList*)stnode_data(st_arg2);
+	while (nodelist) {
+		node = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node_high = (stnode_t*)nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (stnode_type_id(node) != STTYPE_FVALUE) {
+			/* Semantic checking only lets constants be the
+			 * bounds of a range. */
+			g_assert(node_high == NULL);
+			others = g_slist_prepend(others, node);
+			continue;
+		}
+
+		if (!set) {
+			set = df_set_new();
+		}
+		/* The set takes ownership of the fvalues. */
+		df_set_add(set, (fvalue_t*)stnode_data(node),
+			node_high ? (fvalue_t*)stnode_data(node_high) : NULL);
+	}
+	others = g_slist_reverse(others);
+
+	if (set) {
+		df_set_finish(set);
+
+		insn = dfvm_insn_new(ANY_IN);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg1;
+		val2 = dfvm_value_new(FVALUE_SET);
+		val2->value.set = set;
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+
+		/* Exit as soon as we find a match */
+		if (others) {
+			gen_jump_if_true(dfw, &jumplist);
+		}
+	}
+
+	/* Create code for the other elements */
+	nodelist = others;
 	while (nodelist) {
 		node = (stnode_t*)nodelist->data;
 		reg2 = gen_entity(dfw, node, &jmp2);
@@ -313,11 +377,7 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 
 		/* Exit as soon as we find a match */
 		if (nodelist) {
-			insn = dfvm_insn_new(IF_TRUE_GOTO);
-			val1 = dfvm_value_new(INSN_NUMBER);
-			insn->arg1 = val1;
-			dfw_append_insn(dfw, insn);
-			jumplist = g_slist_prepend(jumplist, val1);
+			gen_jump_if_true(dfw, &jumplist);
 		}
 
 		/* If an item is not present, just jump to the next item */
@@ -336,6 +396,7 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 
 	/* Clean up */
 	g_slist_free(jumplist);
+	g_slist_free(others);
 	nodelist = (GSList*)stnode_data(st_arg2);
 	set_nodelist_free(nodelist);
 }
@@ -509,19 +570,21 @@ gencode(dfwork_t *dfw, stnode_t *st_node)
 }
 
 
-void
-dfw_gencode(dfwork_t *dfw)
+static void
+gencode_init(dfwork_t *dfw)
 {
-	int		id, id1, length;
-	dfvm_insn_t	*insn, *insn1, *prev;
-	dfvm_value_t	*arg1;
-
 	dfw->insns = g_ptr_array_new();
 	dfw->consts = g_ptr_array_new();
 	dfw->loaded_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
 	dfw->interesting_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
-	gencode(dfw, dfw->st_root);
-	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+}
+
+static void
+gencode_finish(dfwork_t *dfw)
+{
+	int		id, id1, length;
+	dfvm_insn_t	*insn, *insn1, *prev;
+	dfvm_value_t	*arg1;
 
 	/* fixup goto */
 	length = dfw->insns->len;
@@ -596,6 +659,51 @@ dfw_gencode(dfwork_t *dfw)
 
 }
 
+void
+dfw_gencode(dfwork_t *dfw)
+{
+	gencode_init(dfw);
+	gencode(dfw, dfw->st_root);
+	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	gencode_finish(dfw);
+}
+
+void
+dfw_gencode_group(dfwork_t *dfw, stnode_t **roots, guint num_roots)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1;
+	guint		i;
+	gboolean	empty = TRUE;
+
+	gencode_init(dfw);
+
+	/* The filters share the work structure, so a field is read into
+	 * the same register by all of them, and only loaded once per
+	 * packet. Each filter's code is followed by an instruction that
+	 * returns its index if it matched; otherwise, the accumulator is
+	 * overwritten by the first test of the next filter. */
+	for (i = 0; i < num_roots; i++) {
+		if (roots[i] == NULL)
+			continue;
+
+		gencode(dfw, roots[i]);
+
+		insn = dfvm_insn_new(RETURN_RULE);
+		val1 = dfvm_value_new(INTEGER);
+		val1->value.numeric = i;
+		insn->arg1 = val1;
+		dfw_append_insn(dfw, insn);
+		empty = FALSE;
+	}
+
+	/* Nothing matched; make sure dfvm_apply() says so, too. */
+	if (empty)
+		dfw_append_insn(dfw, dfvm_insn_new(NOT));
+	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	gencode_finish(dfw);
+}
+
 
 
 typedef struct {
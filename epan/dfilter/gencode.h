@@ -13,6 +13,9 @@
 void
 dfw_gencode(dfwork_t *dfw);
 
+void
+dfw_gencode_group(dfwork_t *dfw, stnode_t **roots, guint num_roots);
+
 int*
 dfw_interesting_fields(dfwork_t *dfw, int *caller_num_fields);
 
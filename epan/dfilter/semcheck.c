@@ -140,10 +140,44 @@ compatible_ftypes(ftenum_t a, ftenum_t b)
 	return FALSE;
 }
 
+/* Compiles the pattern of a "matches" test, and sets the error message on
+ * failure. A pattern that appears more than once in the filter is only
+ * compiled once; the fvalues share the GRegex. */
+static fvalue_t*
+dfilter_fvalue_from_pcre(dfwork_t *dfw, const char *s)
+{
+	GRegex		*regex;
+	fvalue_t	*fv;
+
+	if (dfw->regexes == NULL) {
+		dfw->regexes = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify)g_regex_unref);
+	}
+
+	regex = (GRegex *)g_hash_table_lookup(dfw->regexes, s);
+	if (regex) {
+		fv = fvalue_new(FT_PCRE);
+		fv->value.re = g_regex_ref(regex);
+		return fv;
+	}
+
+	fv = fvalue_from_string(FT_PCRE, s,
+	    dfw->error_message == NULL ? &dfw->error_message : NULL);
+	if (fv) {
+		g_hash_table_insert(dfw->regexes, g_strdup(s),
+				g_regex_ref(fv->value.re));
+	}
+	return fv;
+}
+
 /* Gets an fvalue from a string, and sets the error message on failure. */
 static fvalue_t*
 dfilter_fvalue_from_unparsed(dfwork_t *dfw, ftenum_t ftype, const char *s, gboolean allow_partial_value)
 {
+	if (ftype == FT_PCRE) {
+		return dfilter_fvalue_from_pcre(dfw, s);
+	}
+
 	/*
 	 * Don't set the error message if it's already set.
 	 */
@@ -155,6 +189,10 @@ dfilter_fvalue_from_unparsed(dfwork_t *dfw, ftenum_t ftype, const char *s, gbool
 static fvalue_t*
 dfilter_fvalue_from_string(dfwork_t *dfw, ftenum_t ftype, const char *s)
 {
+	if (ftype == FT_PCRE) {
+		return dfilter_fvalue_from_pcre(dfw, s);
+	}
+
 	return fvalue_from_string(ftype, s,
 	    dfw->error_message == NULL ? &dfw->error_message : NULL);
 }
@@ -619,6 +657,44 @@ charconst_to_bytes(dfwork_t *dfw, char *s, gboolean allow_partial_value)
 	return (fvalue);
 }
 
+static void
+check_relation_LHS_FIELD(dfwork_t *dfw, const char *relation_string,
+		FtypeCanFunc can_func, gboolean allow_partial_value,
+		stnode_t *st_node, stnode_t *st_arg1, stnode_t *st_arg2);
+
+/* Check one element of a set tested against a FIELD, as if it were
+ * compared with the field on its own, and return the node that takes
+ * its place in the set. The caller stores that node in the element's
+ * link of the set's list, so checking a set takes a single pass over it.
+ */
+static stnode_t *
+check_set_element(dfwork_t *dfw, const char *relation_string,
+		FtypeCanFunc can_func, gboolean allow_partial_value,
+		stnode_t *st_arg1, stnode_t *st_elem)
+{
+	stnode_t	*st_test;
+	stnode_t	*st_new;
+
+	st_test = stnode_new(STTYPE_TEST, NULL);
+	sttype_test_set2(st_test, TEST_OP_EQ, st_arg1, st_elem);
+	TRY {
+		check_relation_LHS_FIELD(dfw, relation_string, can_func,
+				allow_partial_value, st_test, st_arg1, st_elem);
+	}
+	CATCH_ALL {
+		/* Neither node belongs to the test. */
+		sttype_test_set2_args(st_test, NULL, NULL);
+		stnode_free(st_test);
+		RETHROW;
+	}
+	ENDTRY;
+
+	sttype_test_get(st_test, NULL, NULL, &st_new);
+	sttype_test_set2_args(st_test, NULL, NULL);
+	stnode_free(st_test);
+	return st_new;
+}
+
 /* If the LHS of a relation test is a FIELD, run some checks
  * and possibly some modifications of syntax tree nodes. */
 static void
@@ -722,11 +798,7 @@ check_relation_LHS_FIELD(dfwork_t *dfw, const char *relation_string,
 		}
 
 		new_st = stnode_new(STTYPE_FVALUE, fvalue);
-		if (stnode_type_id(st_node) == STTYPE_TEST) {
-			sttype_test_set2_args(st_node, st_arg1, new_st);
-		} else {
-			sttype_set_replace_element(st_node, st_arg2, new_st);
-		}
+		sttype_test_set2_args(st_node, st_arg1, new_st);
 		stnode_free(st_arg2);
 	}
 	else if (type2 == STTYPE_RANGE) {
@@ -770,19 +842,47 @@ check_relation_LHS_FIELD(dfwork_t *dfw, const char *relation_string,
 		if (strcmp(relation_string, "in") != 0) {
 			g_assert_not_reached();
 		}
-		/* Attempt to interpret one element of the set at a time */
+		/* Attempt to interpret one element of the set at a time.
+		 * The elements are stored as pairs of nodes: a single
+		 * value followed by NULL, or the bounds of a range. */
 		nodelist = (GSList*)stnode_data(st_arg2);
 		while (nodelist) {
+			GSList *node_link = nodelist;
 			stnode_t *node = (stnode_t*)nodelist->data;
+			stnode_t *node_high;
+
+			nodelist = g_slist_next(nodelist);
+			g_assert(nodelist);
+			node_high = (stnode_t*)nodelist->data;
+			nodelist = g_slist_next(nodelist);
+
 			/* Don't let a range on the RHS affect the LHS field. */
-			if (stnode_type_id(node) == STTYPE_RANGE) {
+			if (stnode_type_id(node) == STTYPE_RANGE ||
+			    (node_high && stnode_type_id(node_high) == STTYPE_RANGE)) {
 				dfilter_fail(dfw, "A range may not appear inside a set.");
 				THROW(TypeError);
 				break;
 			}
-			check_relation_LHS_FIELD(dfw, "==", can_func,
-					allow_partial_value, st_arg2, st_arg1, node);
-			nodelist = g_slist_next(nodelist);
+			if (node_high == NULL) {
+				node_link->data = check_set_element(dfw, "==", can_func,
+						allow_partial_value, st_arg1, node);
+				continue;
+			}
+
+			/* The bounds of a range must be known when the
+			 * filter is compiled. */
+			if (stnode_type_id(node) == STTYPE_FIELD ||
+			    stnode_type_id(node) == STTYPE_FUNCTION ||
+			    stnode_type_id(node_high) == STTYPE_FIELD ||
+			    stnode_type_id(node_high) == STTYPE_FUNCTION) {
+				dfilter_fail(dfw, "Only constant values may be used as the bounds of a range in a set.");
+				THROW(TypeError);
+				break;
+			}
+			node_link->data = check_set_element(dfw, ">=", ftype_can_ge,
+					allow_partial_value, st_arg1, node);
+			node_link->next->data = check_set_element(dfw, "<=", ftype_can_le,
+					allow_partial_value, st_arg1, node_high);
 		}
 	}
 	else {
@@ -14,7 +14,10 @@
 static void
 slist_stnode_free(gpointer data, gpointer user_data _U_)
 {
-	stnode_free((stnode_t *)data);
+	/* The upper bound of a single value is NULL. */
+	if (data) {
+		stnode_free((stnode_t *)data);
+	}
 }
 
 void
@@ -24,20 +27,6 @@ set_nodelist_free(GSList *params)
 	g_slist_free(params);
 }
 
-void
-sttype_set_replace_element(stnode_t *node, stnode_t *oldnode, stnode_t *newnode)
-{
-	GSList	*nodelist = (GSList*)stnode_data(node);
-
-	while (nodelist) {
-		if (nodelist->data == oldnode) {
-			nodelist->data = newnode;
-			break;
-		}
-		nodelist = g_slist_next(nodelist);
-	}
-}
-
 void
 sttype_register_set(void)
 {
@@ -14,9 +14,6 @@
 
 #include "ws_attributes.h"
 
-void
-sttype_set_replace_element(stnode_t *node, stnode_t *oldnode, stnode_t *newnode);
-
 void
 set_nodelist_free(GSList *params);
 
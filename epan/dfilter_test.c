@@ -0,0 +1,326 @@
+/* dfilter_test.c
+ * Standalone program to test and benchmark the display filter engine
+ *
+ * The filters are applied to a synthetic protocol tree built directly
+ * with the proto_tree_add_* functions, so that only the cost of running
+ * the filter is measured and not that of dissecting a packet.
+ *
+ * Run with "-m perf" to get the per-packet cost of each filter, e.g.
+ *   ./dfilter_test -m perf --verbose
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/proto.h>
+#include <epan/tvbuff.h>
+#include <epan/register.h>
+#include <epan/dfilter/dfilter.h>
+#include <epan/dfilter/dfilter-int.h>
+
+#include <wsutil/time_util.h>
+
+#include <wiretap/wtap.h>
+
+/* Number of times each filter is applied by the benchmark. */
+#define DFILTER_PERF_ITERATIONS 1000000
+
+typedef struct {
+    const char *text;
+    gboolean    expected;
+} dfilter_test_t;
+
+static const dfilter_test_t dfilter_tests[] = {
+    { "ip.src == 192.168.0.1",                          TRUE  },
+    { "ip.src == 192.168.0.2",                          FALSE },
+    { "ip.dst == 10.0.0.0/8",                           TRUE  },
+    { "ip.ttl > 32 && ip.ttl <= 64",                    TRUE  },
+    { "ip.ttl < 64",                                    FALSE },
+    { "tcp.port == 80",                                 TRUE  },
+    { "tcp.port == 443",                                FALSE },
+    { "tcp.port != 80",                                 TRUE  },
+    { "tcp.srcport == tcp.dstport",                     FALSE },
+    { "tcp.srcport > tcp.dstport",                      TRUE  },
+    { "tcp.dstport & 0x10",                             TRUE  },
+    { "tcp.port in {22 80 443}",                        TRUE  },
+    { "tcp.port in {22 443}",                           FALSE },
+    { "tcp.port in {1000..2000 80}",                    TRUE  },
+    { "tcp.port in {1000..2000 49000..49999}",          FALSE },
+    { "tcp.port in {49152..49152}",                     TRUE  },
+    { "tcp.port in {22 tcp.dstport}",                   TRUE  },
+    { "ip.src in {10.0.0.1 192.168.0.1}",               TRUE  },
+    { "ip.dst in {10.0.0.0/8 172.16.0.0/12}",           TRUE  },
+    { "tcp.window_size_scalefactor in {-5..-1}",        TRUE  },
+    { "tcp.window_size_scalefactor in {0..14}",         FALSE },
+    { "frame.protocols in {\"eth:ip\" \"eth:ethertype:ip:tcp\"}", TRUE },
+    { "tcp.window_size_scalefactor == -1",              TRUE  },
+    { "tcp.window_size_scalefactor < 0",                TRUE  },
+    { "tcp.window_size_scalefactor > -2",               TRUE  },
+    { "tcp.window_size_scalefactor >= 0",               FALSE },
+    { "frame.protocols contains \"tcp\"",               TRUE  },
+    { "frame.protocols matches \"^eth:.*:tcp$\"",       TRUE  },
+    { "frame.protocols[0:3] == \"eth\"",                TRUE  },
+    { "len(frame.protocols) == 20",                     TRUE  },
+    { "count(tcp.port) == 2",                           TRUE  },
+    { "upper(frame.protocols) contains \"IP\"",         TRUE  },
+    { "udp.port == 53",                                 FALSE },
+    { "!udp && tcp.port == 80",                         TRUE  },
+};
+
+static guint8 packet_data[64];
+
+/* Adds the fields used by the test filters to the tree. */
+static void
+build_tree(epan_dissect_t *edt, tvbuff_t *tvb)
+{
+    proto_tree *tree = edt->tree;
+
+    proto_tree_add_string(tree, proto_registrar_get_id_byname("frame.protocols"),
+            tvb, 0, 0, "eth:ethertype:ip:tcp");
+    proto_tree_add_ipv4(tree, proto_registrar_get_id_byname("ip.src"),
+            tvb, 26, 4, g_htonl(0xc0a80001));
+    proto_tree_add_ipv4(tree, proto_registrar_get_id_byname("ip.dst"),
+            tvb, 30, 4, g_htonl(0x0a000002));
+    proto_tree_add_uint(tree, proto_registrar_get_id_byname("ip.ttl"),
+            tvb, 22, 1, 64);
+    proto_tree_add_uint(tree, proto_registrar_get_id_byname("tcp.srcport"),
+            tvb, 34, 2, 49152);
+    proto_tree_add_uint(tree, proto_registrar_get_id_byname("tcp.dstport"),
+            tvb, 36, 2, 80);
+    proto_tree_add_uint(tree, proto_registrar_get_id_byname("tcp.port"),
+            tvb, 34, 2, 49152);
+    proto_tree_add_uint(tree, proto_registrar_get_id_byname("tcp.port"),
+            tvb, 36, 2, 80);
+    proto_tree_add_int(tree, proto_registrar_get_id_byname("tcp.window_size_scalefactor"),
+            tvb, 0, 0, -1);
+}
+
+/* Returns a tree primed with the fields of a compiled filter. */
+static epan_dissect_t *
+prime(dfilter_t *df, tvbuff_t **tvbp)
+{
+    epan_dissect_t *edt;
+
+    edt = epan_dissect_new(NULL, TRUE, FALSE);
+    epan_dissect_prime_with_dfilter(edt, df);
+
+    *tvbp = tvb_new_real_data(packet_data, sizeof packet_data, sizeof packet_data);
+    build_tree(edt, *tvbp);
+
+    return edt;
+}
+
+/* Compiles a filter and returns a tree primed with its fields. */
+static epan_dissect_t *
+prepare(const char *text, dfilter_t **dfp, tvbuff_t **tvbp)
+{
+    gchar *err_msg = NULL;
+
+    if (!dfilter_compile(text, dfp, &err_msg)) {
+        g_test_message("%s: %s", text, err_msg);
+        g_free(err_msg);
+        g_assert_not_reached();
+    }
+    g_assert(*dfp != NULL);
+
+    return prime(*dfp, tvbp);
+}
+
+static void
+finish(epan_dissect_t *edt, dfilter_t *df, tvbuff_t *tvb)
+{
+    epan_dissect_free(edt);
+    tvb_free(tvb);
+    dfilter_free(df);
+}
+
+static void
+dfilter_test_apply(void)
+{
+    epan_dissect_t *edt;
+    dfilter_t      *df;
+    tvbuff_t       *tvb;
+    guint           i;
+
+    for (i = 0; i < G_N_ELEMENTS(dfilter_tests); i++) {
+        edt = prepare(dfilter_tests[i].text, &df, &tvb);
+
+        g_test_message("%s", dfilter_tests[i].text);
+        g_assert(dfilter_apply_edt(df, edt) == dfilter_tests[i].expected);
+        /* A second run must see the registers in the same state. */
+        g_assert(dfilter_apply_edt(df, edt) == dfilter_tests[i].expected);
+
+        finish(edt, df, tvb);
+    }
+}
+
+/* Compiles each filter after all the ones that don't match, plus an
+ * empty one, and checks that the group reports the right one. */
+static void
+dfilter_test_group(void)
+{
+    epan_dissect_t *edt;
+    dfilter_t      *df;
+    tvbuff_t       *tvb;
+    const gchar   **texts;
+    gchar          *err_msg = NULL;
+    guint           err_index;
+    guint           num_texts, i, j;
+
+    texts = g_new(const gchar *, G_N_ELEMENTS(dfilter_tests) + 2);
+
+    for (i = 0; i < G_N_ELEMENTS(dfilter_tests); i++) {
+        num_texts = 0;
+        texts[num_texts++] = NULL;
+        for (j = 0; j < G_N_ELEMENTS(dfilter_tests); j++) {
+            if (!dfilter_tests[j].expected)
+                texts[num_texts++] = dfilter_tests[j].text;
+        }
+        texts[num_texts++] = "";
+        texts[num_texts++] = dfilter_tests[i].text;
+
+        g_test_message("%s", dfilter_tests[i].text);
+        g_assert(dfilter_compile_group(texts, num_texts, &df, &err_msg, NULL));
+        edt = prime(df, &tvb);
+
+        g_assert_cmpint(dfilter_apply_edt_first(df, edt), ==,
+                dfilter_tests[i].expected ? (int)num_texts - 1 : -1);
+        g_assert(dfilter_apply_edt(df, edt) == dfilter_tests[i].expected);
+
+        finish(edt, df, tvb);
+    }
+
+    texts[0] = "tcp.port == 80";
+    texts[1] = "tcp.port ==";
+    g_assert(!dfilter_compile_group(texts, 2, &df, &err_msg, &err_index));
+    g_assert(df == NULL);
+    g_assert(err_msg != NULL);
+    g_assert_cmpuint(err_index, ==, 1);
+    g_free(err_msg);
+
+    g_free(texts);
+}
+
+/* Counts the evaluations of the "matches" tests of a filter. The same
+ * pattern appears twice, so that the compiled regex is shared. */
+static void
+dfilter_test_profile(void)
+{
+    epan_dissect_t *edt;
+    dfilter_t      *df;
+    tvbuff_t       *tvb;
+    guint64         evaluations = 0, matches = 0;
+    guint           i;
+
+    edt = prepare("frame.protocols matches \"^udp\" || "
+            "ip.src == 10.0.0.1 || frame.protocols matches \"^udp\" || "
+            "frame.protocols matches \"tcp$\"", &df, &tvb);
+
+    dfilter_set_profiling(df, TRUE);
+    for (i = 0; i < 10; i++) {
+        g_assert(dfilter_apply_edt(df, edt));
+    }
+    if (g_test_verbose()) {
+        dfilter_dump_profile(df);
+    }
+
+    for (i = 0; i < df->insns->len; i++) {
+        evaluations += df->profile[i].evaluations;
+        matches += df->profile[i].matches;
+    }
+    g_assert(evaluations == 30);
+    g_assert(matches == 10);
+
+    dfilter_set_profiling(df, FALSE);
+    g_assert(df->profile == NULL);
+    g_assert(dfilter_apply_edt(df, edt));
+
+    finish(edt, df, tvb);
+}
+
+#define RESOURCE_USAGE_START get_resource_usage(&start_utime, &start_stime)
+
+#define RESOURCE_USAGE_END \
+    get_resource_usage(&end_utime, &end_stime); \
+    utime_ms = (end_utime - start_utime) * 1000.0; \
+    stime_ms = (end_stime - start_stime) * 1000.0
+
+static void
+dfilter_test_perf(void)
+{
+    epan_dissect_t *edt;
+    dfilter_t      *df;
+    tvbuff_t       *tvb;
+    guint           i, j;
+    double          start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    for (i = 0; i < G_N_ELEMENTS(dfilter_tests); i++) {
+        edt = prepare(dfilter_tests[i].text, &df, &tvb);
+
+        RESOURCE_USAGE_START;
+        for (j = 0; j < DFILTER_PERF_ITERATIONS; j++) {
+            dfilter_apply_edt(df, edt);
+        }
+        RESOURCE_USAGE_END;
+
+        g_test_minimized_result(utime_ms + stime_ms,
+            "%-45s %7.1f ns/packet (u %.3f ms s %.3f ms)",
+            dfilter_tests[i].text,
+            (utime_ms + stime_ms) * 1000000.0 / DFILTER_PERF_ITERATIONS,
+            utime_ms, stime_ms);
+
+        finish(edt, df, tvb);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(FALSE);
+    if (!epan_init(register_all_protocols, register_all_protocol_handoffs,
+                NULL, NULL))
+        return 2;
+
+    if (g_test_perf()) {
+        g_test_add_func("/dfilter/perf", dfilter_test_perf);
+    }
+    else {
+        g_test_add_func("/dfilter/apply", dfilter_test_apply);
+        g_test_add_func("/dfilter/group", dfilter_test_group);
+        g_test_add_func("/dfilter/profile", dfilter_test_profile);
+    }
+
+    ret = g_test_run();
+
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
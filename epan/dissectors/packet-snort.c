@@ -1171,7 +1171,7 @@ snort_dissector(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data
                                                        pinfo->pkt_encap,
 >>>>>>> upstream/master-2.4
                                                        WTAP_MAX_PACKET_SIZE_STANDARD,
-                                                       FALSE,                 /* compressed */
+                                                       WTAP_UNCOMPRESSED,
                                                        &open_err);
                 if (!current_session.pdh) {
                     current_session.working = FALSE;
@@ -574,6 +574,14 @@ static dissector_handle_t sport_handle;
 static guint32 tcp_stream_count;
 static guint32 mptcp_stream_count;
 
+/*
+ * The frames of each TCP stream, indexed by stream number.  Each entry is
+ * a wmem_array_t of frame numbers in increasing order, filled in on the
+ * first pass, so that tools that look at one stream can retap only its
+ * frames.
+ */
+static wmem_array_t *tcp_stream_frames = NULL;
+
 
 
 /*
@@ -1574,6 +1582,68 @@ guint32 get_mptcp_stream_count(void)
     return mptcp_stream_count;
 }
 
+static void
+tcp_stream_add_frame(guint32 stream, guint32 frame)
+{
+    wmem_array_t *no_frames = NULL;
+    wmem_array_t **frames;
+    guint32 *raw;
+    guint32 count, lo, hi, mid;
+
+    while (wmem_array_get_count(tcp_stream_frames) <= stream) {
+        wmem_array_append_one(tcp_stream_frames, no_frames);
+    }
+    frames = (wmem_array_t **)wmem_array_index(tcp_stream_frames, stream);
+    if (!*frames) {
+        *frames = wmem_array_sized_new(wmem_file_scope(), sizeof(guint32), 16);
+    }
+
+    count = wmem_array_get_count(*frames);
+    raw = (guint32 *)wmem_array_get_raw(*frames);
+    if (count == 0 || raw[count - 1] < frame) {
+        wmem_array_append_one(*frames, frame);
+        return;
+    }
+
+    /* The first pass usually visits the frames in order, but not always,
+     * so find where this one goes. Stream graphs retap only these frames,
+     * so none can be left out. */
+    lo = 0;
+    hi = count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (raw[mid] < frame) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    /* A frame can hold more than one segment of the same stream. */
+    if (raw[lo] == frame) {
+        return;
+    }
+    wmem_array_append_one(*frames, frame);
+    raw = (guint32 *)wmem_array_get_raw(*frames);
+    memmove(&raw[lo + 1], &raw[lo], (count - lo) * sizeof raw[0]);
+    raw[lo] = frame;
+}
+
+/* Return the frames of a stream */
+const guint32 *get_tcp_stream_frames(guint32 stream, guint32 *num_frames)
+{
+    wmem_array_t *frames = NULL;
+
+    if (tcp_stream_frames && stream < wmem_array_get_count(tcp_stream_frames)) {
+        frames = *(wmem_array_t **)wmem_array_index(tcp_stream_frames, stream);
+    }
+    if (!frames) {
+        *num_frames = 0;
+        return NULL;
+    }
+    *num_frames = wmem_array_get_count(frames);
+    return (const guint32 *)wmem_array_get_raw(frames);
+}
+
 /* Calculate the timestamps relative to this conversation */
 static void
 tcp_calculate_timestamps(packet_info *pinfo, struct tcp_analysis *tcpd,
@@ -5906,6 +5976,10 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
          * to tap listeners.
          */
         tcph->th_stream = tcpd->stream;
+
+        if (!PINFO_FD_VISITED(pinfo)) {
+            tcp_stream_add_frame(tcpd->stream, pinfo->num);
+        }
     }
 
     /* Do we need to calculate timestamps relative to the tcp-stream? */
@@ -6530,12 +6604,20 @@ static void
 tcp_init(void)
 {
     tcp_stream_count = 0;
+    tcp_stream_frames = wmem_array_new(wmem_file_scope(), sizeof(wmem_array_t *));
 
     /* MPTCP init */
     mptcp_stream_count = 0;
     mptcp_tokens = wmem_tree_new(wmem_file_scope());
 }
 
+static void
+tcp_cleanup(void)
+{
+    /* It was in the file scope, which is gone now. */
+    tcp_stream_frames = NULL;
+}
+
 void
 proto_register_tcp(void)
 {
@@ -7535,6 +7617,7 @@ proto_register_tcp(void)
         &tcp_display_process_info);
 
     register_init_routine(tcp_init);
+    register_cleanup_routine(tcp_cleanup);
     reassembly_table_register(&tcp_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
 
@@ -499,6 +499,17 @@ WS_DLL_PUBLIC guint32 get_tcp_stream_count(void);
  */
 WS_DLL_PUBLIC guint32 get_mptcp_stream_count(void);
 
+/** Get the frames of a TCP stream
+ *
+ * The frames are recorded as they are first dissected.
+ *
+ * @param stream The stream index (tcp.stream)
+ * @param num_frames Set to the number of frames
+ * @return The frame numbers in increasing order, or NULL if the stream has
+ * none. They are valid until the capture file is closed.
+ */
+WS_DLL_PUBLIC const guint32 *get_tcp_stream_frames(guint32 stream, guint32 *num_frames);
+
 /* Follow Stream functionality shared with HTTP (and SSL?) */
 extern gchar* tcp_follow_conv_filter(packet_info* pinfo, int* stream);
 extern gchar* tcp_follow_index_filter(int stream);
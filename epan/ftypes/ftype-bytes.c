@@ -659,7 +659,7 @@ cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 	 * warned us. For the same reason (and because we're using g_malloc()),
 	 * fv_b->value.re is not NULL.
 	 */
-	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
+	if (fv_b->ftype->ftype != FT_PCRE) {
 		return FALSE;
 	}
 	if (! regex) {
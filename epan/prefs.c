@@ -2331,6 +2331,10 @@ gui_callback(void)
     /* Ensure there is at least one display filter entry */
     if (prefs.gui_recent_df_entries_max == 0)
       prefs.gui_recent_df_entries_max = 10;
+
+    /* A packet list cache smaller than this can't hold the rows on screen */
+    if (prefs.gui_packet_list_cache_size < 1)
+      prefs.gui_packet_list_cache_size = 1;
 }
 
 static void
@@ -3356,6 +3360,17 @@ prefs_register_modules(void)
                                    "Enable Packet Editor (Experimental)",
                                    &prefs.gui_packet_editor);
 
+    prefs_register_bool_preference(gui_module, "frame_index.enabled",
+                                   "Save and use frame index files",
+                                   "After reading a pcap or pcapng file for the first time, save an index "
+                                   "of its packets next to it, in a file with \".wsidx\" appended to its "
+                                   "name, and use that index the next time the file is opened instead of "
+                                   "reading the whole file before showing the packet list. Packets are "
+                                   "then dissected only as they're looked at, so analysis that depends on "
+                                   "earlier packets, such as TCP sequence analysis, may be incomplete "
+                                   "until the file is reloaded with this turned off.",
+                                   &prefs.gui_frame_index);
+
     prefs_register_enum_preference(gui_module, "packet_list_elide_mode",
                        "Elide mode",
                        "The position of \"...\" in packet list text.",
@@ -3371,6 +3386,13 @@ prefs_register_modules(void)
                                    "Show the intelligent scroll bar (a minimap of packet list colors in the scrollbar)",
                                    &prefs.gui_packet_list_show_minimap);
 
+    prefs_register_uint_preference(gui_module, "packet_list_cache_size",
+                                   "Packet list text cache size (MB)",
+                                   "The amount of memory used to keep packet list column text. "
+                                   "Rows that don't fit are dissected again when they're shown.",
+                                   10,
+                                   &prefs.gui_packet_list_cache_size);
+
 
     prefs_register_bool_preference(gui_module, "interfaces_show_hidden",
                                    "Show hidden interfaces",
@@ -4106,9 +4128,11 @@ pre_init_prefs(void)
     prefs.gui_layout_content_2       = layout_pane_content_pdetails;
     prefs.gui_layout_content_3       = layout_pane_content_pbytes;
     prefs.gui_packet_editor          = FALSE;
+    prefs.gui_frame_index            = FALSE;
     prefs.gui_packet_list_elide_mode = ELIDE_RIGHT;
     prefs.gui_packet_list_show_related = TRUE;
     prefs.gui_packet_list_show_minimap = TRUE;
+    prefs.gui_packet_list_cache_size = 128;
     g_free (prefs.gui_interfaces_hide_types);
     prefs.gui_interfaces_hide_types = g_strdup("");
     prefs.gui_interfaces_show_hidden = FALSE;
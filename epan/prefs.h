@@ -221,9 +221,11 @@ typedef struct _e_prefs {
   gboolean     gui_qt_show_selected_packet;
   gboolean     gui_qt_show_file_load_time;
   gboolean     gui_packet_editor; /* Enable Packet Editor */
+  gboolean     gui_frame_index; /* Save and use sidecar frame index files */
   elide_mode_e gui_packet_list_elide_mode;
   gboolean     gui_packet_list_show_related;
   gboolean     gui_packet_list_show_minimap;
+  guint        gui_packet_list_cache_size; /* MB of packet list column text to keep */
   gboolean     st_enable_burstinfo;
   gboolean     st_burst_showcount;
   gint         st_burst_resolution;
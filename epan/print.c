@@ -28,6 +28,8 @@
 #include <wsutil/filesystem.h>
 #include <version_info.h>
 #include <wsutil/utf8_entities.h>
+#include <wsutil/arrow_writer.h>
+#include <wsutil/pint.h>
 #include <ftypes/ftypes-int.h>
 #include <wsutil/glib-compat.h>
 
@@ -64,25 +66,40 @@ typedef struct {
     proto_node_children_grouper_func node_children_grouper;
 } write_json_data;
 
+/* A field to be written by write_specified_fields(), resolved to the
+ * hf ids and column it's taken from. */
 typedef struct {
-    output_fields_t *fields;
-    epan_dissect_t  *edt;
-} write_field_data_t;
+    guint         hfid_first;   /* index of the field's first hf id in hfids */
+    guint         hfid_count;   /* number of hf ids with the field's name */
+    gint          col;          /* column of a "_ws.col." field, or -1 */
+    guint         value_first;  /* index of the field's first value in value_offsets */
+    guint         value_count;  /* number of values in the current packet */
+    arrow_type_e  arrow_type;   /* of the field's Arrow column */
+    int           arrow_width;  /* of a fixed width Arrow column */
+} resolved_field_t;
 
 struct _output_fields {
-    gboolean      print_bom;
-    gboolean      print_header;
-    gchar         separator;
-    gchar         occurrence;
-    gchar         aggregator;
-    GPtrArray    *fields;
-    GHashTable   *field_indicies;
-    GPtrArray   **field_values;
-    gchar         quote;
-    gboolean      includes_col_fields;
+    gboolean          print_bom;
+    gboolean          print_header;
+    gchar             separator;
+    gchar             occurrence;
+    gchar             aggregator;
+    GPtrArray        *fields;
+    resolved_field_t *resolved;     /* one per field, NULL until resolved */
+    gboolean          cols_resolved;
+    gboolean          need_labels;  /* a field's value is an item's label */
+    GArray           *hfids;        /* hf ids of all fields, for priming */
+    GString          *values;       /* the current packet's values, NUL-separated */
+    GArray           *value_offsets;/* offset of each value in values */
+    GPtrArray        *finfos;       /* a field's field_infos, from the tree */
+    GString          *line;         /* the current packet's CSV output */
+    arrow_writer_t   *arrow;
+    gchar             quote;
+    gboolean          includes_col_fields;
 };
 
-static gchar *get_field_hex_value(GSList *src_list, field_info *fi);
+static gboolean append_field_value(GString *buf, field_info *fi, epan_dissect_t *edt);
+static gboolean append_field_hex_value(GString *buf, GSList *src_list, field_info *fi);
 static void proto_tree_print_node(proto_node *node, gpointer data);
 static void proto_tree_write_node_pdml(proto_node *node, gpointer data);
 static void proto_tree_write_node_ek(proto_node *node, write_json_data *data);
@@ -118,8 +135,6 @@ static const char *proto_node_to_json_key(proto_node *node);
 static void print_pdml_geninfo(epan_dissect_t *edt, FILE *fh);
 static void write_ek_summary(column_info *cinfo, FILE *fh);
 
-static void proto_tree_get_node_field_values(proto_node *node, gpointer data);
-
 static gboolean json_is_first;
 
 /* Cache the protocols and field handles that the print functionality needs
@@ -2071,6 +2086,18 @@ gsize output_fields_num_fields(output_fields_t* fields)
     }
 }
 
+static void output_fields_unresolve(output_fields_t* fields)
+{
+    g_free(fields->resolved);
+    fields->resolved = NULL;
+    fields->cols_resolved = FALSE;
+    fields->need_labels = FALSE;
+    if (NULL != fields->hfids) {
+        g_array_free(fields->hfids, TRUE);
+        fields->hfids = NULL;
+    }
+}
+
 void output_fields_free(output_fields_t* fields)
 {
     g_assert(fields);
@@ -2078,16 +2105,7 @@ void output_fields_free(output_fields_t* fields)
     if (NULL != fields->fields) {
         gsize i;
 
-        if (NULL != fields->field_indicies) {
-            /* Keys are stored in fields->fields, values are
-             * integers.
-             */
-            g_hash_table_destroy(fields->field_indicies);
-        }
-
-        if (NULL != fields->field_values) {
-            g_free(fields->field_values);
-        }
+        output_fields_unresolve(fields);
 
         for(i = 0; i < fields->fields->len; ++i) {
             gchar* field = (gchar *)g_ptr_array_index(fields->fields,i);
@@ -2096,6 +2114,18 @@ void output_fields_free(output_fields_t* fields)
         g_ptr_array_free(fields->fields, TRUE);
     }
 
+    arrow_writer_free(fields->arrow);
+
+    if (NULL != fields->finfos) {
+        g_ptr_array_free(fields->finfos, TRUE);
+    }
+
+    if (NULL != fields->values) {
+        g_string_free(fields->values, TRUE);
+        g_array_free(fields->value_offsets, TRUE);
+        g_string_free(fields->line, TRUE);
+    }
+
     g_free(fields);
 }
 
@@ -2121,6 +2151,101 @@ void output_fields_add(output_fields_t *fields, const gchar *field)
     if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
         fields->includes_col_fields = TRUE;
 
+    output_fields_unresolve(fields);
+}
+
+/*
+ * Look up the hf ids of the fields once, so that we can get their values
+ * straight from the protocol tree's interesting fields instead of
+ * searching the tree for them in every packet.
+ */
+static void output_fields_resolve(output_fields_t* fields)
+{
+    guint i;
+
+    if (NULL != fields->resolved) {
+        return;
+    }
+
+    fields->resolved = g_new0(resolved_field_t, fields->fields->len);
+    fields->hfids = g_array_new(FALSE, FALSE, sizeof(int));
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+        resolved_field_t *rf = &fields->resolved[i];
+        header_field_info *hfinfo = proto_registrar_get_byname(field);
+
+        rf->hfid_first = fields->hfids->len;
+        rf->col = -1;
+
+        if (hfinfo) {
+            /* Several fields may have the same name. Start with the first. */
+            while (hfinfo->same_name_prev_id != -1) {
+                hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+            }
+            for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+                g_array_append_val(fields->hfids, hfinfo->id);
+                /* Labels are only generated in a visible tree. */
+                if (hfinfo->type == FT_PROTOCOL || hfinfo->id == hf_text_only) {
+                    fields->need_labels = TRUE;
+                }
+            }
+        }
+        rf->hfid_count = fields->hfids->len - rf->hfid_first;
+    }
+}
+
+static void output_fields_resolve_cols(output_fields_t* fields, column_info *cinfo)
+{
+    const size_t prefix_len = strlen(COLUMN_FIELD_FILTER);
+    guint i;
+    gint  col;
+
+    if (fields->cols_resolved || !fields->includes_col_fields || NULL == cinfo) {
+        return;
+    }
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        if (strncmp(field, COLUMN_FIELD_FILTER, prefix_len) != 0) {
+            continue;
+        }
+        for (col = 0; col < cinfo->num_cols; col++) {
+            if (strcmp(field + prefix_len, cinfo->columns[col].col_title) == 0) {
+                fields->resolved[i].col = col;
+                break;
+            }
+        }
+    }
+    fields->cols_resolved = TRUE;
+}
+
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    g_assert(fields);
+    g_assert(edt);
+
+    if (NULL == fields->fields) {
+        return;
+    }
+
+    output_fields_resolve(fields);
+    if (fields->hfids->len > 0) {
+        epan_dissect_prime_with_hfid_array(edt, fields->hfids);
+    }
+}
+
+gboolean output_fields_need_visible_tree(output_fields_t* fields)
+{
+    g_assert(fields);
+
+    if (NULL == fields->fields) {
+        return FALSE;
+    }
+
+    output_fields_resolve(fields);
+    return fields->need_labels;
 }
 
 static void
@@ -2311,187 +2436,199 @@ void write_fields_preamble(output_fields_t* fields, FILE *fh)
     fputc('\n', fh);
 }
 
-static void format_field_values(output_fields_t* fields, gpointer field_index, const gchar* value)
+/*
+ * Add a value to a field, subject to the occurrence option. Values are
+ * stored in fields->values, each followed by a NUL, and a field's values
+ * are always at the end of the buffer while it's being gathered.
+ */
+static void add_field_value(output_fields_t* fields, resolved_field_t *rf, gsize start)
 {
-    guint      indx;
-    GPtrArray* fv_p;
-
-    if (NULL == value)
-        return;
+    guint offset;
 
-    /* Unwrap change made to disambiguiate zero / null */
-    indx = GPOINTER_TO_UINT(field_index) - 1;
+    g_string_append_c(fields->values, '\0');
 
-    if (fields->field_values[indx] == NULL) {
-        fields->field_values[indx] = g_ptr_array_new();
+    if (fields->occurrence == 'l' && fields->value_offsets->len > rf->value_first) {
+        /* Replace the previous value. */
+        offset = g_array_index(fields->value_offsets, guint, fields->value_offsets->len - 1);
+        memmove(fields->values->str + offset, fields->values->str + start,
+                fields->values->len - start);
+        g_string_truncate(fields->values, offset + (fields->values->len - start));
+        return;
     }
 
-    /* Essentially: fieldvalues[indx] is a 'GPtrArray *' with each array entry */
-    /*  pointing to a string which is (part of) the final output string.       */
+    offset = (guint)start;
+    g_array_append_val(fields->value_offsets, offset);
+}
 
-    fv_p = fields->field_values[indx];
+typedef struct {
+    output_fields_t  *fields;
+    resolved_field_t *rf;
+} find_field_data_t;
 
-    switch (fields->occurrence) {
-    case 'f':
-        /* print the value of only the first occurrence of the field */
-        if (g_ptr_array_len(fv_p) != 0)
-            return;
-        break;
-    case 'l':
-        /* print the value of only the last occurrence of the field */
-        g_ptr_array_set_size(fv_p, 0);
-        break;
-    case 'a':
-        /* print the value of all accurrences of the field */
-        /* If not the first, add the 'aggregator' */
-        if (g_ptr_array_len(fv_p) > 0) {
-            g_ptr_array_add(fv_p, (gpointer)g_strdup_printf("%c", fields->aggregator));
+static void find_field_nodes(proto_node *node, gpointer data)
+{
+    find_field_data_t *find_data = (find_field_data_t *)data;
+    resolved_field_t  *rf = find_data->rf;
+    field_info        *fi = PNODE_FINFO(node);
+    guint              h;
+
+    if (fi && fi->hfinfo) {
+        for (h = rf->hfid_first; h < rf->hfid_first + rf->hfid_count; h++) {
+            if (fi->hfinfo->id == g_array_index(find_data->fields->hfids, int, h)) {
+                g_ptr_array_add(find_data->fields->finfos, fi);
+                break;
+            }
         }
-        break;
-    default:
-        g_assert_not_reached();
-        break;
     }
 
-    g_ptr_array_add(fv_p, (gpointer)value);
+    if (node->first_child != NULL) {
+        proto_tree_children_foreach(node, find_field_nodes, data);
+    }
 }
 
-static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
+/*
+ * Get a field's field_infos in the current packet, in the order in which
+ * they appear in the tree, or NULL if it has none. If more than one of
+ * the field's hf ids is present, we have to walk the tree to find out how
+ * their items are interleaved.
+ */
+static GPtrArray *get_field_finfos(output_fields_t* fields, resolved_field_t *rf, epan_dissect_t *edt)
 {
-    write_field_data_t *call_data;
-    field_info *fi;
-    gpointer    field_index;
+    GPtrArray *found = NULL;
+    find_field_data_t find_data;
+    guint h;
 
-    call_data = (write_field_data_t *)data;
-    fi = PNODE_FINFO(node);
+    for (h = rf->hfid_first; h < rf->hfid_first + rf->hfid_count; h++) {
+        GPtrArray *finfos = proto_get_finfo_ptr_array(edt->tree, g_array_index(fields->hfids, int, h));
 
-    /* dissection with an invisible proto tree? */
-    g_assert(fi);
+        if (NULL == finfos || 0 == finfos->len) {
+            continue;
+        }
+        if (NULL == found) {
+            found = finfos;
+            continue;
+        }
 
-    field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
-    if (NULL != field_index) {
-        format_field_values(call_data->fields, field_index,
-                            get_node_field_value(fi, call_data->edt) /* g_ alloc'd string */
-            );
+        find_data.fields = fields;
+        find_data.rf = rf;
+        if (NULL == fields->finfos) {
+            fields->finfos = g_ptr_array_new();
+        }
+        g_ptr_array_set_size(fields->finfos, 0);
+        proto_tree_children_foreach(edt->tree, find_field_nodes, &find_data);
+        return fields->finfos;
     }
+    return found;
+}
 
-    /* Recurse here. */
-    if (node->first_child != NULL) {
-        proto_tree_children_foreach(node, proto_tree_get_node_field_values,
-                                    call_data);
+/* Gather the values of every field in the current packet. */
+static void gather_field_values(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo)
+{
+    guint i, j;
+
+    g_string_truncate(fields->values, 0);
+    g_array_set_size(fields->value_offsets, 0);
+
+    for (i = 0; i < fields->fields->len; i++) {
+        resolved_field_t *rf = &fields->resolved[i];
+
+        GPtrArray *finfos = get_field_finfos(fields, rf, edt);
+
+        rf->value_first = fields->value_offsets->len;
+
+        for (j = 0; NULL != finfos && j < finfos->len; j++) {
+            gsize start;
+
+            if (fields->occurrence == 'f' && fields->value_offsets->len > rf->value_first) {
+                break;
+            }
+            start = fields->values->len;
+            if (append_field_value(fields->values, (field_info *)g_ptr_array_index(finfos, j), edt)) {
+                add_field_value(fields, rf, start);
+            } else {
+                g_string_truncate(fields->values, start);
+            }
+        }
+
+        if (rf->col >= 0 && NULL != cinfo &&
+            !(fields->occurrence == 'f' && fields->value_offsets->len > rf->value_first)) {
+            gsize start = fields->values->len;
+            g_string_append(fields->values, cinfo->columns[rf->col].col_data);
+            add_field_value(fields, rf, start);
+        }
+
+        rf->value_count = fields->value_offsets->len - rf->value_first;
     }
 }
 
+static const gchar *field_value(output_fields_t* fields, resolved_field_t *rf, guint j)
+{
+    return fields->values->str + g_array_index(fields->value_offsets, guint, rf->value_first + j);
+}
+
 static void write_specified_fields(fields_format format, output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
 {
     gsize     i;
     gboolean first = TRUE;
-    gint      col;
-    gchar    *col_name;
-    gpointer  field_index;
-
-    write_field_data_t data;
 
     g_assert(fields);
     g_assert(fields->fields);
     g_assert(edt);
     g_assert(fh);
 
-    data.fields = fields;
-    data.edt = edt;
-
-    if (NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+    /* The caller must have primed the tree with output_fields_prime_edt(). */
+    output_fields_resolve(fields);
+    output_fields_resolve_cols(fields, cinfo);
 
-        i = 0;
-        while (i < fields->fields->len) {
-            gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-            /* Store field indicies +1 so that zero is not a valid value,
-             * and can be distinguished from NULL as a pointer.
-             */
-            ++i;
-            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
-        }
+    /* The buffers are reused for every packet. */
+    if (NULL == fields->values) {
+        fields->values = g_string_sized_new(1024);
+        fields->value_offsets = g_array_new(FALSE, FALSE, sizeof(guint));
+        fields->line = g_string_sized_new(1024);
     }
 
-    /* Array buffer to store values for this packet              */
-    /*  Allocate an array for the 'GPtrarray *' the first time   */
-    /*   ths function is invoked for a file;                     */
-    /*  Any and all 'GPtrArray *' are freed (after use) each     */
-    /*   time (each packet) this function is invoked for a flle. */
-    /* XXX: ToDo: use packet-scope'd memory & (if/when implemented) wmem ptr_array */
-    if (NULL == fields->field_values)
-        fields->field_values = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
-
-    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
-                                &data);
-
-    /* Add columns to fields */
-    if (fields->includes_col_fields) {
-        for (col = 0; col < cinfo->num_cols; col++) {
-            /* Prepend COLUMN_FIELD_FILTER as the field name */
-            col_name = g_strdup_printf("%s%s", COLUMN_FIELD_FILTER, cinfo->columns[col].col_title);
-            field_index = g_hash_table_lookup(fields->field_indicies, col_name);
-            g_free(col_name);
-
-            if (NULL != field_index) {
-                format_field_values(fields, field_index, g_strdup(cinfo->columns[col].col_data));
-            }
-        }
-    }
+    gather_field_values(fields, edt, cinfo);
 
     switch (format) {
     case FORMAT_CSV:
+        g_string_truncate(fields->line, 0);
         for(i = 0; i < fields->fields->len; ++i) {
+            resolved_field_t *rf = &fields->resolved[i];
+            guint j;
+
             if (0 != i) {
-                fputc(fields->separator, fh);
+                g_string_append_c(fields->line, fields->separator);
             }
-            if (NULL != fields->field_values[i]) {
-                GPtrArray *fv_p;
-                gchar * str;
-                gsize j;
-                fv_p = fields->field_values[i];
+            if (0 != rf->value_count) {
                 if (fields->quote != '\0') {
-                    fputc(fields->quote, fh);
+                    g_string_append_c(fields->line, fields->quote);
                 }
 
-                /* Output the array of (partial) field values */
-                for (j = 0; j < g_ptr_array_len(fv_p); j++ ) {
-                    str = (gchar *)g_ptr_array_index(fv_p, j);
-                    fputs(str, fh);
-                    g_free(str);
+                /* Output the values, separated by the aggregator */
+                for (j = 0; j < rf->value_count; j++) {
+                    if (0 != j) {
+                        g_string_append_c(fields->line, fields->aggregator);
+                    }
+                    g_string_append(fields->line, field_value(fields, rf, j));
                 }
                 if (fields->quote != '\0') {
-                    fputc(fields->quote, fh);
+                    g_string_append_c(fields->line, fields->quote);
                 }
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
             }
         }
+        fwrite(fields->line->str, 1, fields->line->len, fh);
         break;
     case FORMAT_XML:
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-
-            if (NULL != fields->field_values[i]) {
-                GPtrArray *fv_p;
-                gchar * str;
-                gsize j;
-                fv_p = fields->field_values[i];
-
-                /* Output the array of (partial) field values */
-                for (j = 0; j < (g_ptr_array_len(fv_p)); j+=2 ) {
-                    str = (gchar *)g_ptr_array_index(fv_p, j);
-
-                    fprintf(fh, "  <field name=\"%s\" value=", field);
-                    fputs("\"", fh);
-                    print_escaped_xml(fh, str);
-                    fputs("\"/>\n", fh);
-                    g_free(str);
-                }
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+            resolved_field_t *rf = &fields->resolved[i];
+            guint j;
+
+            for (j = 0; j < rf->value_count; j++) {
+                fprintf(fh, "  <field name=\"%s\" value=", field);
+                fputs("\"", fh);
+                print_escaped_xml(fh, field_value(fields, rf, j));
+                fputs("\"/>\n", fh);
             }
         }
         break;
@@ -2499,39 +2636,32 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
         fputs("{\n", fh);
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+            resolved_field_t *rf = &fields->resolved[i];
+            guint j;
 
-            if (NULL != fields->field_values[i]) {
-                GPtrArray *fv_p;
-                gchar * str;
-                gsize j;
-                fv_p = fields->field_values[i];
-
-                /* Output the array of (partial) field values */
-                for (j = 0; j < (g_ptr_array_len(fv_p)); j += 2) {
-                    str = (gchar *) g_ptr_array_index(fv_p, j);
-
-                    if (j == 0) {
-                        if (!first) {
-                            fputs(",\n", fh);
-                        }
-                        fprintf(fh, "        \"%s\": [", field);
-                    }
-                    fputs("\"", fh);
-                    print_escaped_json(fh, str);
-                    fputs("\"", fh);
-                    g_free(str);
+            if (0 == rf->value_count) {
+                continue;
+            }
 
-                    if (j + 2 < (g_ptr_array_len(fv_p))) {
-                        fputs(",", fh);
-                    } else {
-                        fputs("]", fh);
+            for (j = 0; j < rf->value_count; j++) {
+                if (j == 0) {
+                    if (!first) {
+                        fputs(",\n", fh);
                     }
+                    fprintf(fh, "        \"%s\": [", field);
                 }
+                fputs("\"", fh);
+                print_escaped_json(fh, field_value(fields, rf, j));
+                fputs("\"", fh);
 
-                first = FALSE;
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                if (j + 1 < rf->value_count) {
+                    fputs(",", fh);
+                } else {
+                    fputs("]", fh);
+                }
             }
+
+            first = FALSE;
         }
         fputc('\n',fh);
 
@@ -2540,43 +2670,34 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
     case FORMAT_EK:
         for(i = 0; i < fields->fields->len; ++i) {
             gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+            resolved_field_t *rf = &fields->resolved[i];
+            guint j;
 
-            if (NULL != fields->field_values[i]) {
-                GPtrArray *fv_p;
-                gchar * str;
-                gsize j;
-                fv_p = fields->field_values[i];
-
-                /* Output the array of (partial) field values */
-                for (j = 0; j < (g_ptr_array_len(fv_p)); j += 2) {
-                    str = (gchar *)g_ptr_array_index(fv_p, j);
-
-                    if (j == 0) {
-                        if (!first) {
-                            fputs(",", fh);
-                        }
-                        fputs("\"", fh);
-                        print_escaped_ek(fh, field);
-                        fputs("\": [", fh);
-                    }
-                    fputs("\"", fh);
-                    print_escaped_json(fh, str);
-                    fputs("\"", fh);
-                    g_free(str);
+            if (0 == rf->value_count) {
+                continue;
+            }
 
-                    if (j + 2 < (g_ptr_array_len(fv_p))) {
+            for (j = 0; j < rf->value_count; j++) {
+                if (j == 0) {
+                    if (!first) {
                         fputs(",", fh);
                     }
-                    else {
-                        fputs("]", fh);
-
-                        }
-                    }
+                    fputs("\"", fh);
+                    print_escaped_ek(fh, field);
+                    fputs("\": [", fh);
+                }
+                fputs("\"", fh);
+                print_escaped_json(fh, field_value(fields, rf, j));
+                fputs("\"", fh);
 
-                first = FALSE;
-                g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-                fields->field_values[i] = NULL;
+                if (j + 1 < rf->value_count) {
+                    fputs(",", fh);
+                } else {
+                    fputs("]", fh);
+                }
             }
+
+            first = FALSE;
         }
         break;
 
@@ -2592,89 +2713,365 @@ void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
     /* Nothing to do */
 }
 
+/*
+ * Arrow output. Each -e field is a column, typed according to the field's
+ * ftenum. A field that can occur more than once in a packet is a list
+ * column if all occurrences are wanted, which is the default.
+ */
+#define ARROW_BATCH_ROWS    65536
+#define ARROW_BATCH_BYTES   (64 * 1024 * 1024)
+
+static arrow_type_e arrow_type_of_field(const header_field_info *hfinfo, int *width)
+{
+    *width = 0;
+
+    if (hfinfo->id == proto_data) {
+        return ARROW_TYPE_BINARY;
+    }
+
+    switch (hfinfo->type) {
+    case FT_NONE:
+    case FT_BOOLEAN:
+        return ARROW_TYPE_BOOL;
+    case FT_CHAR:
+    case FT_UINT8:
+        return ARROW_TYPE_UINT8;
+    case FT_UINT16:
+        return ARROW_TYPE_UINT16;
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_IPXNET:
+    case FT_FRAMENUM:
+        return ARROW_TYPE_UINT32;
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+        return ARROW_TYPE_UINT64;
+    case FT_INT8:
+        return ARROW_TYPE_INT8;
+    case FT_INT16:
+        return ARROW_TYPE_INT16;
+    case FT_INT24:
+    case FT_INT32:
+        return ARROW_TYPE_INT32;
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        return ARROW_TYPE_INT64;
+    case FT_FLOAT:
+        return ARROW_TYPE_FLOAT;
+    case FT_DOUBLE:
+        return ARROW_TYPE_DOUBLE;
+    case FT_ABSOLUTE_TIME:
+        return ARROW_TYPE_TIMESTAMP_NS;
+    case FT_RELATIVE_TIME:
+        return ARROW_TYPE_DURATION_NS;
+    case FT_IPv4:
+        *width = 4;
+        return ARROW_TYPE_FIXED_BINARY;
+    case FT_IPv6:
+        *width = 16;
+        return ARROW_TYPE_FIXED_BINARY;
+    case FT_ETHER:
+        *width = FT_ETHER_LEN;
+        return ARROW_TYPE_FIXED_BINARY;
+    case FT_EUI64:
+        *width = FT_EUI64_LEN;
+        return ARROW_TYPE_FIXED_BINARY;
+    case FT_BYTES:
+    case FT_UINT_BYTES:
+        return ARROW_TYPE_BINARY;
+    default:
+        /* Strings, and anything else as its display representation. */
+        return ARROW_TYPE_STRING;
+    }
+}
+
+/* Fields with the same name usually have the same type. If they don't,
+ * their values are written as strings. */
+static void output_fields_resolve_arrow(output_fields_t* fields)
+{
+    guint i, h;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        resolved_field_t *rf = &fields->resolved[i];
+
+        rf->arrow_type = ARROW_TYPE_STRING;
+        rf->arrow_width = 0;
+
+        for (h = rf->hfid_first; h < rf->hfid_first + rf->hfid_count; h++) {
+            header_field_info *hfinfo = proto_registrar_get_nth(g_array_index(fields->hfids, int, h));
+            int width;
+            arrow_type_e type = arrow_type_of_field(hfinfo, &width);
+
+            if (h == rf->hfid_first) {
+                rf->arrow_type = type;
+                rf->arrow_width = width;
+            } else if (type != rf->arrow_type || width != rf->arrow_width) {
+                rf->arrow_type = ARROW_TYPE_STRING;
+                rf->arrow_width = 0;
+                break;
+            }
+        }
+    }
+}
+
+void write_arrow_preamble(output_fields_t* fields, FILE *fh)
+{
+    guint i;
+
+    g_assert(fields);
+    g_assert(fields->fields);
+    g_assert(fh);
+
+    output_fields_resolve(fields);
+    output_fields_resolve_arrow(fields);
+
+    if (NULL == fields->values) {
+        fields->values = g_string_sized_new(1024);
+        fields->value_offsets = g_array_new(FALSE, FALSE, sizeof(guint));
+        fields->line = g_string_sized_new(1024);
+    }
+
+    arrow_writer_free(fields->arrow);
+    fields->arrow = arrow_writer_new(fh, ARROW_BATCH_ROWS, ARROW_BATCH_BYTES);
+    for (i = 0; i < fields->fields->len; i++) {
+        resolved_field_t *rf = &fields->resolved[i];
+
+        arrow_writer_add_column(fields->arrow, (const char *)g_ptr_array_index(fields->fields, i),
+                                rf->arrow_type, rf->arrow_width, fields->occurrence == 'a');
+    }
+    arrow_writer_write_schema(fields->arrow);
+}
+
+static void write_arrow_value(output_fields_t* fields, int column, resolved_field_t *rf,
+                              field_info *fi, epan_dissect_t *edt)
+{
+    fvalue_t     *fv = &fi->value;
+    const guint8 *data;
+    guint8        bytes[8];
+    guint32       ipv4;
+    nstime_t     *ts;
+
+    switch (rf->arrow_type) {
+    case ARROW_TYPE_BOOL:
+        arrow_writer_append_bool(fields->arrow, column,
+                                 fi->hfinfo->type == FT_NONE || fvalue_get_uinteger64(fv) != 0);
+        break;
+    case ARROW_TYPE_UINT8:
+    case ARROW_TYPE_UINT16:
+    case ARROW_TYPE_UINT32:
+        arrow_writer_append_uint(fields->arrow, column, fvalue_get_uinteger(fv));
+        break;
+    case ARROW_TYPE_UINT64:
+        arrow_writer_append_uint(fields->arrow, column, fvalue_get_uinteger64(fv));
+        break;
+    case ARROW_TYPE_INT8:
+    case ARROW_TYPE_INT16:
+    case ARROW_TYPE_INT32:
+        arrow_writer_append_int(fields->arrow, column, fvalue_get_sinteger(fv));
+        break;
+    case ARROW_TYPE_INT64:
+        arrow_writer_append_int(fields->arrow, column, fvalue_get_sinteger64(fv));
+        break;
+    case ARROW_TYPE_FLOAT:
+    case ARROW_TYPE_DOUBLE:
+        arrow_writer_append_double(fields->arrow, column, fvalue_get_floating(fv));
+        break;
+    case ARROW_TYPE_TIMESTAMP_NS:
+    case ARROW_TYPE_DURATION_NS:
+        ts = (nstime_t *)fvalue_get(fv);
+        arrow_writer_append_int(fields->arrow, column, (gint64)ts->secs * 1000000000 + ts->nsecs);
+        break;
+    case ARROW_TYPE_FIXED_BINARY:
+        switch (fi->hfinfo->type) {
+        case FT_IPv4:
+            /* In network byte order */
+            ipv4 = fvalue_get_uinteger(fv);
+            arrow_writer_append_bytes(fields->arrow, column, (const guint8 *)&ipv4, 4);
+            break;
+        case FT_EUI64:
+            phton64(bytes, fvalue_get_uinteger64(fv));
+            arrow_writer_append_bytes(fields->arrow, column, bytes, FT_EUI64_LEN);
+            break;
+        default:
+            arrow_writer_append_bytes(fields->arrow, column, (const guint8 *)fvalue_get(fv), fvalue_length(fv));
+            break;
+        }
+        break;
+    case ARROW_TYPE_BINARY:
+        if (fi->hfinfo->id == proto_data) {
+            /* The Data protocol's value is the data itself. */
+            if (fi->ds_tvb && fi->length <= tvb_captured_length_remaining(fi->ds_tvb, fi->start) &&
+                (data = get_field_data(edt->pi.data_src, fi)) != NULL) {
+                arrow_writer_append_bytes(fields->arrow, column, data, fi->length);
+            }
+        } else {
+            arrow_writer_append_bytes(fields->arrow, column, (const guint8 *)fvalue_get(fv), fvalue_length(fv));
+        }
+        break;
+    case ARROW_TYPE_STRING:
+        g_string_truncate(fields->values, 0);
+        if (append_field_value(fields->values, fi, edt)) {
+            arrow_writer_append_bytes(fields->arrow, column, (const guint8 *)fields->values->str,
+                                      fields->values->len);
+        }
+        break;
+    }
+}
+
+void write_arrow_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh _U_)
+{
+    guint i, j;
+
+    g_assert(fields);
+    g_assert(fields->arrow);
+    g_assert(edt);
+
+    /* The caller must have primed the tree with output_fields_prime_edt(). */
+    output_fields_resolve_cols(fields, cinfo);
+
+    for (i = 0; i < fields->fields->len; i++) {
+        resolved_field_t *rf = &fields->resolved[i];
+        GPtrArray *finfos = get_field_finfos(fields, rf, edt);
+
+        if (NULL != finfos && 0 != finfos->len) {
+            if (fields->occurrence == 'f') {
+                write_arrow_value(fields, i, rf, (field_info *)g_ptr_array_index(finfos, 0), edt);
+            } else if (fields->occurrence == 'l') {
+                write_arrow_value(fields, i, rf, (field_info *)g_ptr_array_index(finfos, finfos->len - 1), edt);
+            } else {
+                for (j = 0; j < finfos->len; j++) {
+                    write_arrow_value(fields, i, rf, (field_info *)g_ptr_array_index(finfos, j), edt);
+                }
+            }
+        }
+
+        if (rf->col >= 0 && NULL != cinfo) {
+            const gchar *col_data = cinfo->columns[rf->col].col_data;
+            arrow_writer_append_bytes(fields->arrow, i, (const guint8 *)col_data, strlen(col_data));
+        }
+    }
+    arrow_writer_end_row(fields->arrow);
+}
+
+void write_arrow_finale(output_fields_t* fields, FILE *fh _U_)
+{
+    g_assert(fields);
+
+    if (NULL != fields->arrow) {
+        arrow_writer_finish(fields->arrow);
+        arrow_writer_free(fields->arrow);
+        fields->arrow = NULL;
+    }
+}
+
 /* Returns an g_malloced string */
 gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
+{
+    GString *buf = g_string_new(NULL);
+
+    if (!append_field_value(buf, fi, edt)) {
+        g_string_free(buf, TRUE);
+        return NULL;
+    }
+    return g_string_free(buf, FALSE);
+}
+
+/* Append the value of a field to buf. Returns FALSE if it has none. */
+static gboolean
+append_field_value(GString *buf, field_info *fi, epan_dissect_t *edt)
 {
     if (fi->hfinfo->id == hf_text_only) {
         /* Text label.
          * Get the text */
         if (fi->rep) {
-            return g_strdup(fi->rep->representation);
+            g_string_append(buf, fi->rep->representation);
+            return TRUE;
         }
         else {
-            return get_field_hex_value(edt->pi.data_src, fi);
+            return append_field_hex_value(buf, edt->pi.data_src, fi);
         }
     }
     else if (fi->hfinfo->id == proto_data) {
         /* Uninterpreted data, i.e., the "Data" protocol, is
          * printed as a field instead of a protocol. */
-        return get_field_hex_value(edt->pi.data_src, fi);
+        return append_field_hex_value(buf, edt->pi.data_src, fi);
     }
     else {
         /* Normal protocols and fields */
-        gchar      *dfilter_string;
+        fvalue_t *fv = &fi->value;
+        gsize     start;
+        int       len;
 
         switch (fi->hfinfo->type)
         {
         case FT_PROTOCOL:
             /* Print out the full details for the protocol. */
             if (fi->rep) {
-                return g_strdup(fi->rep->representation);
+                g_string_append(buf, fi->rep->representation);
             } else {
                 /* Just print out the protocol abbreviation */
-                return g_strdup(fi->hfinfo->abbrev);
+                g_string_append(buf, fi->hfinfo->abbrev);
             }
+            return TRUE;
         case FT_NONE:
             /* Return "1" so that the presence of a field of type
              * FT_NONE can be checked when using -T fields */
-            return g_strdup("1");
+            g_string_append_c(buf, '1');
+            return TRUE;
         default:
-            dfilter_string = fvalue_to_string_repr(NULL, &fi->value, FTREPR_DISPLAY, fi->hfinfo->display);
-            if (dfilter_string != NULL) {
-                gchar* ret = g_strdup(dfilter_string);
-                wmem_free(NULL, dfilter_string);
-                return ret;
+            /* Format the value in place rather than in a buffer of
+             * its own. The length is an upper bound for some types. */
+            if (fv->ftype->val_to_string_repr != NULL && fv->ftype->len_string_repr != NULL &&
+                (len = fvalue_string_repr_len(fv, FTREPR_DISPLAY, fi->hfinfo->display)) >= 0) {
+                start = buf->len;
+                g_string_set_size(buf, start + len);
+                buf->str[start] = '\0';
+                fv->ftype->val_to_string_repr(fv, FTREPR_DISPLAY, fi->hfinfo->display, buf->str + start, (unsigned int)len + 1);
+                g_string_truncate(buf, start + strlen(buf->str + start));
+                return TRUE;
             } else {
-                return get_field_hex_value(edt->pi.data_src, fi);
+                return append_field_hex_value(buf, edt->pi.data_src, fi);
             }
         }
     }
 }
 
-static gchar*
-get_field_hex_value(GSList *src_list, field_info *fi)
+static gboolean
+append_field_hex_value(GString *buf, GSList *src_list, field_info *fi)
 {
+    static const gchar hex[] = "0123456789abcdef";
     const guint8 *pd;
+    gchar        *p;
+    gint          i;
 
     if (!fi->ds_tvb)
-        return NULL;
+        return FALSE;
 
     if (fi->length > tvb_captured_length_remaining(fi->ds_tvb, fi->start)) {
-        return g_strdup("field length invalid!");
+        g_string_append(buf, "field length invalid!");
+        return TRUE;
     }
 
     /* Find the data for this field. */
     pd = get_field_data(src_list, fi);
 
     if (pd) {
-        int        i;
-        gchar     *buffer;
-        gchar     *p;
-        int        len;
-        const int  chars_per_byte = 2;
-
-        len    = chars_per_byte * fi->length;
-        buffer = (gchar *)g_malloc(sizeof(gchar)*(len + 1));
-        buffer[len] = '\0'; /* Ensure NULL termination in bad cases */
-        p = buffer;
+        gsize start = buf->len;
+
         /* Print a simple hex dump */
+        g_string_set_size(buf, start + 2 * fi->length);
+        p = buf->str + start;
         for (i = 0 ; i < fi->length; i++) {
-            g_snprintf(p, chars_per_byte+1, "%02x", pd[i]);
-            p += chars_per_byte;
+            *p++ = hex[pd[i] >> 4];
+            *p++ = hex[pd[i] & 0x0f];
         }
-        return buffer;
+        return TRUE;
     } else {
-        return NULL;
+        return FALSE;
     }
 }
 
@@ -2687,8 +3084,14 @@ output_fields_t* output_fields_new(void)
     fields->occurrence          = 'a';
     fields->aggregator          = ',';
     fields->fields              = NULL; /*Do lazy initialisation */
-    fields->field_indicies      = NULL;
-    fields->field_values        = NULL;
+    fields->resolved            = NULL;
+    fields->cols_resolved       = FALSE;
+    fields->need_labels         = FALSE;
+    fields->hfids               = NULL;
+    fields->values              = NULL;
+    fields->value_offsets       = NULL;
+    fields->line                = NULL;
+    fields->arrow               = NULL;
     fields->quote               ='\0';
     fields->includes_col_fields = FALSE;
     return fields;
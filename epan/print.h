@@ -70,6 +70,16 @@ WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* op
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
 
+/* The values of the fields are taken from the protocol tree's list of
+ * interesting fields, so every epan_dissect_t whose fields are written
+ * must be primed with them before each packet is dissected. */
+WS_DLL_PUBLIC void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
+
+/* Returns TRUE if the value of a field is an item's label, e.g. for a
+ * protocol or a text item. Labels are only generated for a visible tree;
+ * otherwise the fields can be written from a tree that holds only them. */
+WS_DLL_PUBLIC gboolean output_fields_need_visible_tree(output_fields_t* info);
+
 /*
  * Higher-level packet-printing code.
  */
@@ -124,6 +134,16 @@ WS_DLL_PUBLIC void write_fields_preamble(output_fields_t* fields, FILE *fh);
 WS_DLL_PUBLIC void write_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
 WS_DLL_PUBLIC void write_fields_finale(output_fields_t* fields, FILE *fh);
 
+/*
+ * Write the -e fields as an Apache Arrow IPC stream, one column per field,
+ * typed according to the field's type. All occurrences of a field make a
+ * list column; a single occurrence (see output_fields_set_option()) makes a
+ * plain column. Rows are written in batches, so memory use is bounded.
+ */
+WS_DLL_PUBLIC void write_arrow_preamble(output_fields_t* fields, FILE *fh);
+WS_DLL_PUBLIC void write_arrow_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
+WS_DLL_PUBLIC void write_arrow_finale(output_fields_t* fields, FILE *fh);
+
 WS_DLL_PUBLIC gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
 
 extern void print_cache_field_handles(void);
@@ -315,6 +315,194 @@ reassembled_key_free(gpointer ptr)
 	g_slice_free(reassembled_key, (reassembled_key *)ptr);
 }
 
+/*
+ * Index of the fragments of a reassembly that uses byte offsets.
+ *
+ * The fragments stay in the sorted list hanging off the reassembly head,
+ * which is what the dissectors walk; once there are more than a few of
+ * them, they are also kept in a sequence sorted by offset, so that a new
+ * fragment is linked in without walking the list.  The amount of data
+ * that is contiguous from offset 0 is tracked as the fragments are
+ * linked in, so that checking whether a reassembly is complete doesn't
+ * walk the list either.  The index is freed once the reassembly is
+ * complete; the fragments that overlap it after that are rare, and are
+ * linked in by walking the list.
+ */
+#define FRAGMENT_INDEX_MIN_FRAGS	16
+
+typedef struct _fragment_index {
+	GSequence *frags;		/* fragments sorted by offset, or NULL
+					 * while there are only a few */
+	guint32 num_frags;		/* number of fragments linked in */
+	fragment_item *contig_last;	/* last fragment of the run of
+					 * contiguous data at offset 0 */
+	guint32 contig_end;		/* end of that run of data */
+} fragment_index;
+
+static void
+fragment_index_free(fragment_head *fd_head)
+{
+	fragment_index *idx = fd_head->frag_index;
+
+	if (idx == NULL)
+		return;
+	if (idx->frags)
+		g_sequence_free(idx->frags);
+	g_slice_free(fragment_index, idx);
+	fd_head->frag_index = NULL;
+}
+
+/*
+ * Order fragments by offset; the fragment being linked in (new_fd) goes
+ * after the ones with the same offset, as in the list.
+ */
+static gint
+fragment_index_cmp(gconstpointer a, gconstpointer b, gpointer new_fd)
+{
+	const fragment_item *fd_a = (const fragment_item *)a;
+	const fragment_item *fd_b = (const fragment_item *)b;
+
+	if (fd_a->offset != fd_b->offset)
+		return fd_a->offset < fd_b->offset ? -1 : 1;
+	if (fd_a == fd_b)
+		return 0;
+	if (fd_a == new_fd)
+		return 1;
+	if (fd_b == new_fd)
+		return -1;
+	return 0;
+}
+
+/*
+ * Extend the run of contiguous data at offset 0 after linking in fd.
+ *
+ * This gives the same result as walking the whole list and extending
+ * the run with each fragment that starts within it: the fragments past
+ * the first gap can't extend it, and a fragment linked in before the end
+ * of the run starts within it.
+ */
+static void
+fragment_index_extend_contig(fragment_head *fd_head, fragment_index *idx,
+			     const fragment_item *fd)
+{
+	fragment_item *fd_i;
+
+	if (idx->contig_last && fd->offset < idx->contig_last->offset) {
+		if (fd->offset + fd->len > idx->contig_end)
+			idx->contig_end = fd->offset + fd->len;
+	}
+
+	fd_i = idx->contig_last ? idx->contig_last->next : fd_head->next;
+	for (; fd_i && fd_i->offset <= idx->contig_end; fd_i = fd_i->next) {
+		if (fd_i->offset + fd_i->len > idx->contig_end)
+			idx->contig_end = fd_i->offset + fd_i->len;
+		idx->contig_last = fd_i;
+	}
+}
+
+/*
+ * Add a fragment to the list of a reassembly that uses byte offsets,
+ * keeping it sorted, and to its index.
+ */
+static void
+fragment_index_link(fragment_head *fd_head, fragment_item *fd)
+{
+	fragment_index *idx = fd_head->frag_index;
+	fragment_item *fd_i;
+	GSequenceIter *iter;
+
+	if (fd_head->flags & FD_DEFRAGMENTED) {
+		for (fd_i = fd_head; fd_i->next; fd_i = fd_i->next) {
+			if (fd->offset < fd_i->next->offset)
+				break;
+		}
+		fd->next = fd_i->next;
+		fd_i->next = fd;
+		return;
+	}
+
+	if (idx == NULL) {
+		idx = g_slice_new0(fragment_index);
+		/* A reassembly can be continued after it was complete. */
+		for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next)
+			idx->num_frags++;
+		fd_head->frag_index = idx;
+	}
+
+	if (idx->frags) {
+		iter = g_sequence_insert_sorted(idx->frags, fd, fragment_index_cmp, fd);
+		if (g_sequence_iter_is_begin(iter))
+			fd_i = fd_head;
+		else
+			fd_i = (fragment_item *)g_sequence_get(g_sequence_iter_prev(iter));
+	} else {
+		for (fd_i = fd_head; fd_i->next; fd_i = fd_i->next) {
+			if (fd->offset < fd_i->next->offset)
+				break;
+		}
+	}
+	fd->next = fd_i->next;
+	fd_i->next = fd;
+
+	idx->num_frags++;
+	if (!idx->frags && idx->num_frags >= FRAGMENT_INDEX_MIN_FRAGS) {
+		idx->frags = g_sequence_new(NULL);
+		for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next)
+			g_sequence_append(idx->frags, fd_i);
+	}
+
+	fragment_index_extend_contig(fd_head, idx, fd);
+}
+
+/*
+ * Add the part of a fragment's data starting at offset and len bytes long
+ * to the composite tvbuff being built for a reassembly.  If the fragment
+ * has a tvbuff of its own holding exactly that data, the tvbuff is handed
+ * over to the composite tvbuff; otherwise the data is copied.
+ */
+static void
+fragment_composite_append(tvbuff_t *tvb_comp, fragment_item *fd,
+			  const guint32 offset, const guint32 len)
+{
+	if (len == 0)
+		return;
+
+	if (offset == 0 && !(fd->flags & FD_SUBSET_TVB) &&
+	    tvb_captured_length(fd->tvb_data) == len) {
+		tvb_composite_append(tvb_comp, fd->tvb_data);
+		fd->tvb_data = NULL;
+	} else {
+		tvb_composite_append(tvb_comp,
+		    tvb_clone_offset_len(fd->tvb_data, offset, len));
+	}
+}
+
+/*
+ * Finish the composite tvbuff for a reassembly to which len bytes have
+ * been added; if that is less than the datalen bytes of the reassembly
+ * (which is an error reported by the caller), the rest is zero-filled.
+ */
+static tvbuff_t *
+fragment_composite_finalize(tvbuff_t *tvb_comp, const guint32 len,
+			    const guint32 datalen)
+{
+	tvbuff_t *tvb_pad;
+	guint8 *data;
+
+	if (len < datalen) {
+		data = (guint8 *) g_malloc0(datalen - len);
+		tvb_pad = tvb_new_real_data(data, datalen - len, datalen - len);
+		tvb_set_free_cb(tvb_pad, g_free);
+		tvb_composite_append(tvb_comp, tvb_pad);
+	} else if (len == 0) {
+		tvb_free(tvb_comp);
+		return tvb_new_real_data((const guint8 *)"", 0, 0);
+	}
+
+	tvb_composite_finalize_owned(tvb_comp);
+	return tvb_comp;
+}
+
 /*
  * For a fragment hash table entry, free the associated fragments.
  * The entry value (fd_chain) is freed herein and the entry is freed
@@ -330,6 +518,7 @@ free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
 	/* g_hash_table_new_full() was used to supply a function
 	 * to free the key and anything to which it points
 	 */
+	fragment_index_free((fragment_head *)value);
 	for (fd_head = (fragment_head *)value; fd_head != NULL; fd_head = tmp_fd) {
 		tmp_fd=fd_head->next;
 
@@ -368,6 +557,13 @@ free_all_reassembled_fragments(gpointer key_arg _U_, gpointer value,
 	GPtrArray *allocated_fragments = (GPtrArray *) user_data;
 	fragment_head *fd_head;
 
+	/*
+	 * If the head has been seen through another entry, so have
+	 * all the fragments in its list; don't walk it again.
+	 */
+	if (((fragment_head *)value)->flags == FD_VISITED_FREE)
+		return TRUE;
+
 	for (fd_head = (fragment_head *)value; fd_head != NULL; fd_head = fd_head->next) {
 		/*
 		 * A reassembled packet is inserted into the
@@ -392,6 +588,7 @@ free_fragments(gpointer data, gpointer user_data _U_)
 {
 	fragment_item *fd_head = (fragment_item *) data;
 
+	fragment_index_free(fd_head);
 	if (fd_head->tvb_data)
 		tvb_free(fd_head->tvb_data);
 	g_slice_free(fragment_item, fd_head);
@@ -614,6 +811,7 @@ fragment_delete(reassembly_table *table, const packet_info *pinfo,
 		g_slice_free(fragment_item, fd);
 		fd=tmp_fd;
 	}
+	fragment_index_free(fd_head);
 	g_slice_free(fragment_head, fd_head);
 	g_hash_table_remove(table->fragment_table, key);
 
@@ -935,9 +1133,12 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 {
 	fragment_item *fd;
 	fragment_item *fd_i;
-	guint32 max, dfpos, fraglen;
+	guint32 max, dfpos, fraglen, cmp_len;
 	tvbuff_t *old_tvb_data;
-	guint8 *data;
+	tvbuff_t *tvb_comp;
+	GPtrArray *overlaps = NULL;
+	guint8 *cmp_data;
+	guint i;
 
 	/* create new fd describing this fragment */
 	fd = g_slice_new(fragment_item);
@@ -949,6 +1150,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->frag_index = NULL;
 
 	/*
 	 * Are we adding to an already-completed reassembly?
@@ -1077,7 +1279,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			fd_head->flags |= FD_OVERLAPCONFLICT;
 		}
 		/* it was just an overlap, link it and return */
-		LINK_FRAG(fd_head,fd);
+		fragment_index_link(fd_head,fd);
 		return TRUE;
 	}
 
@@ -1091,7 +1293,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		THROW(BoundsError);
 	}
 	fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
-	LINK_FRAG(fd_head,fd);
+	fragment_index_link(fd_head,fd);
 
 
 	if( !(fd_head->flags & FD_DATALEN_SET) ){
@@ -1104,21 +1306,14 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 	/*
 	 * Check if we have received the entire fragment.
-	 * This is easy since the list is sorted and the head is faked.
 	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
-	 * fragments that don't start before or at the end of the
-	 * previous fragment, i.e. fragments that have a gap between
-	 * them and the previous fragment.)
+	 * The amount of contiguous data that's available is kept
+	 * up to date by fragment_index_link().  (Fragments that don't
+	 * start before or at the end of the previous fragment, i.e.
+	 * fragments that have a gap between them and the previous
+	 * fragment, don't count.)
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
+	max = fd_head->frag_index->contig_end;
 
 	if (max < (fd_head->datalen)) {
 		/*
@@ -1134,15 +1329,13 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	tvb_comp = tvb_new_composite();
 
 	/* add all data fragments */
-	for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
+	for (dfpos=0,fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
 		if (fd_i->len) {
 			/*
-			 * The loop above that calculates max also
+			 * The contiguous data check above also
 			 * ensures that the only gaps that exist here
 			 * are ones where a fragment starts past the
 			 * end of the reassembled datagram, and there's
@@ -1156,7 +1349,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			 *
 			 * Note that the "overlap" compare must only be
 			 * done for fragments with (offset+len) <= fd_head->datalen
-			 * and thus within the newly g_malloc'd buffer.
+			 * and thus within the reassembled data.
 			 */
 			if (fd_i->offset + fd_i->len > dfpos) {
 				if (fd_i->offset >= fd_head->datalen) {
@@ -1184,7 +1377,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					 * already rejected fragments that
 					 * start past the end of the
 					 * reassembled datagram, and
-					 * the loop that calculated max
+					 * the contiguous data check
 					 * should have ruled out gaps,
 					 * but could fd_i->offset +
 					 * fd_i->len overflow?
@@ -1192,8 +1385,6 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					fd_head->error = "dfpos < offset";
 				} else if (dfpos - fd_i->offset > fd_i->len)
 					fd_head->error = "dfpos - offset > len";
-				else if (!fd_head->tvb_data)
-					fd_head->error = "no data";
 				else {
 					fraglen = fd_i->len;
 					if (fd_i->offset + fraglen > fd_head->datalen) {
@@ -1208,7 +1399,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 						 * added to the reassembly.
 						 *
 						 * Mark it as such, and only
-						 * copy from it what fits in
+						 * take from it what fits in
 						 * the packet.
 						 */
 						fd_i->flags    |= FD_TOOLONGFRAGMENT;
@@ -1216,17 +1407,19 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 						fraglen = fd_head->datalen - fd_i->offset;
 					}
 					if (fd_i->offset < dfpos) {
-						guint32 cmp_len = MIN(fd_i->len,(dfpos-fd_i->offset));
-
 						fd_i->flags    |= FD_OVERLAP;
 						fd_head->flags |= FD_OVERLAP;
-						if ( memcmp(data + fd_i->offset,
-								tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
-								cmp_len)
-								 ) {
-							fd_i->flags    |= FD_OVERLAPCONFLICT;
-							fd_head->flags |= FD_OVERLAPCONFLICT;
-						}
+						/*
+						 * The data it overlaps is compared
+						 * once the composite tvbuff is
+						 * finalized; this fragment's own
+						 * tvbuff is kept until then, as
+						 * it doesn't start at dfpos.
+						 */
+						if (!overlaps)
+							overlaps = g_ptr_array_new();
+						g_ptr_array_add(overlaps, fd_i);
+						g_ptr_array_add(overlaps, GUINT_TO_POINTER(MIN(fd_i->len,(dfpos-fd_i->offset))));
 					}
 					if (fraglen < dfpos - fd_i->offset) {
 						/*
@@ -1234,9 +1427,8 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 						 */
 						fd_head->error = "fraglen < dfpos - offset";
 					} else {
-						memcpy(data+dfpos,
-							tvb_get_ptr(fd_i->tvb_data, (dfpos-fd_i->offset), fraglen-(dfpos-fd_i->offset)),
-							fraglen-(dfpos-fd_i->offset));
+						fragment_composite_append(tvb_comp, fd_i,
+							dfpos-fd_i->offset, fraglen-(dfpos-fd_i->offset));
 						dfpos=MAX(dfpos, (fd_i->offset + fraglen));
 					}
 				}
@@ -1246,7 +1438,36 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					fd_head->error = "offset + len < offset";
 				}
 			}
+		}
+	}
 
+	/*
+	 * The pieces added to the composite tvbuff are contiguous, so
+	 * dfpos is the amount of data in it.
+	 */
+	fd_head->tvb_data = fragment_composite_finalize(tvb_comp, dfpos, fd_head->datalen);
+
+	if (overlaps) {
+		for (i = 0; i < overlaps->len; i += 2) {
+			fd_i = (fragment_item *)g_ptr_array_index(overlaps, i);
+			cmp_len = GPOINTER_TO_UINT(g_ptr_array_index(overlaps, i + 1));
+			cmp_data = (guint8 *)g_malloc(cmp_len);
+			tvb_memcpy(fd_head->tvb_data, cmp_data, fd_i->offset, cmp_len);
+			if ( memcmp(cmp_data,
+					tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
+					cmp_len)
+					 ) {
+				fd_i->flags    |= FD_OVERLAPCONFLICT;
+				fd_head->flags |= FD_OVERLAPCONFLICT;
+			}
+			g_free(cmp_data);
+		}
+		g_ptr_array_free(overlaps, TRUE);
+	}
+
+	/* the data has been handed over or copied, now free all fragments */
+	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
+		if (fd_i->len) {
 			if (fd_i->flags & FD_SUBSET_TVB)
 				fd_i->flags &= ~FD_SUBSET_TVB;
 			else if (fd_i->tvb_data)
@@ -1263,6 +1484,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd_head->flags |= FD_DEFRAGMENTED;
 	fd_head->reassembled_in=pinfo->num;
 	fd_head->reas_in_layer_num = pinfo->curr_layer_num;
+	fragment_index_free(fd_head);
 
 	/* we don't throw until here to avoid leaking old_data and others */
 	if (fd_head->error) {
@@ -1564,9 +1786,9 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 {
 	fragment_item *fd_i = NULL;
 	fragment_item *last_fd = NULL;
-	guint32  dfpos = 0, size = 0;
+	guint32  size = 0;
 	tvbuff_t *old_tvb_data = NULL;
-	guint8 *data;
+	tvbuff_t *tvb_comp;
 
 	for(fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
 		if(!last_fd || last_fd->offset!=fd_i->offset){
@@ -1577,33 +1799,36 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
 	fd_head->len = size;		/* record size for caller	*/
 
-	/* add all data fragments */
+	/* check the duplicates before any data is handed over */
 	last_fd=NULL;
 	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
-		if (fd_i->len) {
-			if(!last_fd || last_fd->offset != fd_i->offset) {
-				/* First fragment or in-sequence fragment */
-				memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
-				dfpos += fd_i->len;
-			} else {
-				/* duplicate/retransmission/overlap */
-				fd_i->flags    |= FD_OVERLAP;
-				fd_head->flags |= FD_OVERLAP;
-				if(last_fd->len != fd_i->len
-				   || tvb_memeql(last_fd->tvb_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
-					fd_i->flags    |= FD_OVERLAPCONFLICT;
-					fd_head->flags |= FD_OVERLAPCONFLICT;
-				}
+		if (fd_i->len && last_fd && last_fd->offset == fd_i->offset) {
+			/* duplicate/retransmission/overlap */
+			fd_i->flags    |= FD_OVERLAP;
+			fd_head->flags |= FD_OVERLAP;
+			if(last_fd->len != fd_i->len
+			   || tvb_memeql(last_fd->tvb_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
+				fd_i->flags    |= FD_OVERLAPCONFLICT;
+				fd_head->flags |= FD_OVERLAPCONFLICT;
 			}
 		}
 		last_fd=fd_i;
 	}
 
+	/* add all data fragments */
+	tvb_comp = tvb_new_composite();
+	last_fd=NULL;
+	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+		if (fd_i->len && (!last_fd || last_fd->offset != fd_i->offset)) {
+			/* First fragment or in-sequence fragment */
+			fragment_composite_append(tvb_comp, fd_i, 0, fd_i->len);
+		}
+		last_fd=fd_i;
+	}
+	fd_head->tvb_data = fragment_composite_finalize(tvb_comp, size, size);
+
 	/* we have defragmented the pdu, now free all fragments*/
 	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
 		if (fd_i->flags & FD_SUBSET_TVB)
@@ -1691,6 +1916,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->frag_index = NULL;
 
 	/* fd_head->frame is the maximum of the frame numbers of all the
 	 * fragments added to the reassembly. */
@@ -2448,6 +2674,7 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
 		fd_head->tvb_data = NULL;
 		fd_head->error = NULL;
+		fd_head->frag_index = NULL;
 
 		insert_fd_head(table, fd_head, pinfo, id, data);
 	}
@@ -83,6 +83,12 @@ typedef struct _fragment_item {
 	 * reassembly and for the fragments in a reassembly.
 	 */
 	const char *error;
+	/**
+	 * Only in the reassembly head, and only when offsets are byte
+	 * offsets (flags&FD_BLOCKSEQUENCE is not set): index of the
+	 * fragments list, private to reassemble.c.
+	 */
+	struct _fragment_index *frag_index;
 } fragment_item, fragment_head;
 
 
@@ -1511,6 +1511,336 @@ test_missing_data_fragment_add_seq_next_3(void)
 #endif
 
 
+/**********************************************************************************
+ *
+ * Reassemblies with many fragments
+ *
+ *********************************************************************************/
+
+#define MANY_FRAGS      4096
+#define MANY_FRAG_LEN   16
+
+static guint8 *many_data;
+static tvbuff_t *many_tvb;
+
+static void
+many_frags_setup(guint32 len)
+{
+    guint32 i;
+
+    many_data = (guint8 *)g_malloc(len);
+    for (i = 0; i < len; i++) {
+        many_data[i] = (guint8)((i * 7) ^ (i >> 8));
+    }
+    many_tvb = tvb_new_real_data(many_data, len, len);
+}
+
+static void
+many_frags_teardown(void)
+{
+    tvb_free(many_tvb);
+    many_tvb = NULL;
+    g_free(many_data);
+    many_data = NULL;
+}
+
+/* Fills order with a permutation of 0..n-1: in order, reversed or shuffled
+ * (with a fixed seed, so that failures are reproducible). */
+static void
+many_frags_order(guint32 *order, guint32 n, int how)
+{
+    guint32 i, j, tmp, seed = 12345;
+
+    for (i = 0; i < n; i++) {
+        order[i] = (how == 1) ? n - 1 - i : i;
+    }
+    if (how == 2) {
+        for (i = n - 1; i > 0; i--) {
+            seed = seed * 1103515245 + 12345;
+            j = (seed >> 8) % (i + 1);
+            tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+    }
+}
+
+/* Checks the reassembled data of fd_head against many_data, both in one go
+ * and in pieces that straddle the fragment boundaries. */
+static void
+many_frags_check_data(fragment_head *fd_head, guint32 len)
+{
+    guint8 buf[3 * MANY_FRAG_LEN];
+    const guint8 *ptr;
+    guint32 offset;
+
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    ASSERT_EQ(len,tvb_captured_length(fd_head->tvb_data));
+    for (offset = MANY_FRAG_LEN / 2; offset + sizeof buf <= len; offset += 5 * MANY_FRAG_LEN / 2) {
+        tvb_memcpy(fd_head->tvb_data, buf, offset, sizeof buf);
+        ASSERT(!memcmp(buf, many_data + offset, sizeof buf));
+        /* a range that spans fragments is copied once, and kept */
+        ptr = tvb_get_ptr(fd_head->tvb_data, offset, sizeof buf);
+        ASSERT(!memcmp(ptr, many_data + offset, sizeof buf));
+        ASSERT_EQ_POINTER(ptr,tvb_get_ptr(fd_head->tvb_data, offset, sizeof buf));
+    }
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,many_data,len));
+}
+
+/* Adds MANY_FRAGS fragments with fragment_add_check() in the given order;
+ * each fragment starts step bytes after the previous one and is len bytes
+ * long, so they overlap if len > step.
+ */
+static void
+test_fragment_add_check_many_work(int how, guint32 step, guint32 len)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint32 *order;
+    guint32 i, total, frag_len;
+
+    total = (MANY_FRAGS - 1) * step + len;
+    many_frags_setup(total);
+    order = g_new(guint32, MANY_FRAGS);
+    many_frags_order(order, MANY_FRAGS, how);
+
+    fd_head = NULL;
+    for (i = 0; i < MANY_FRAGS; i++) {
+        frag_len = len;
+        pinfo.num = i + 1;
+        fd_head=fragment_add_check(&test_reassembly_table, many_tvb, order[i] * step,
+                                   &pinfo, 12, NULL, order[i] * step, frag_len,
+                                   order[i] != MANY_FRAGS - 1);
+        if (i < MANY_FRAGS - 1) {
+            ASSERT_EQ_POINTER(NULL,fd_head);
+        }
+    }
+
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(MANY_FRAGS,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    /* check the contents of the structure */
+    ASSERT_EQ(MANY_FRAGS,fd_head->frame);  /* max frame we have */
+    ASSERT_EQ(total,fd_head->datalen);
+    ASSERT_EQ(MANY_FRAGS,fd_head->reassembled_in);
+    ASSERT_EQ_POINTER(NULL,fd_head->frag_index);
+    if (len > step) {
+        ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP,fd_head->flags);
+    } else {
+        ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    }
+
+    /* the fragments are in order, and their data has been released */
+    for (fd = fd_head->next, i = 0; fd != NULL; fd = fd->next, i++) {
+        ASSERT_EQ(i * step,fd->offset);
+        ASSERT_EQ(len,fd->len);
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+    ASSERT_EQ(MANY_FRAGS,i);
+
+    /* test the actual reassembly */
+    many_frags_check_data(fd_head, total);
+
+    g_free(order);
+    many_frags_teardown();
+}
+
+static void
+test_fragment_add_check_many_in_order(void)
+{
+    printf("Starting test test_fragment_add_check_many_in_order\n");
+    test_fragment_add_check_many_work(0, MANY_FRAG_LEN, MANY_FRAG_LEN);
+}
+
+static void
+test_fragment_add_check_many_reversed(void)
+{
+    printf("Starting test test_fragment_add_check_many_reversed\n");
+    test_fragment_add_check_many_work(1, MANY_FRAG_LEN, MANY_FRAG_LEN);
+}
+
+static void
+test_fragment_add_check_many_shuffled(void)
+{
+    printf("Starting test test_fragment_add_check_many_shuffled\n");
+    test_fragment_add_check_many_work(2, MANY_FRAG_LEN, MANY_FRAG_LEN);
+}
+
+static void
+test_fragment_add_check_many_overlapping(void)
+{
+    printf("Starting test test_fragment_add_check_many_overlapping\n");
+    test_fragment_add_check_many_work(2, MANY_FRAG_LEN, 3 * MANY_FRAG_LEN / 2);
+}
+
+/* Many fragments, one of which overlaps its neighbour with different data.
+ */
+static void
+test_fragment_add_check_many_conflict(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint32 *order;
+    tvbuff_t *conflict_tvb;
+    guint8 conflict_data[MANY_FRAG_LEN];
+    guint32 i, total, conflicting = 0;
+
+    printf("Starting test test_fragment_add_check_many_conflict\n");
+
+    total = MANY_FRAGS * MANY_FRAG_LEN;
+    many_frags_setup(total);
+    order = g_new(guint32, MANY_FRAGS);
+    many_frags_order(order, MANY_FRAGS, 2);
+
+    for (i = 0; i < MANY_FRAGS; i++) {
+        pinfo.num = i + 1;
+        fd_head=fragment_add_check(&test_reassembly_table, many_tvb, order[i] * MANY_FRAG_LEN,
+                                   &pinfo, 12, NULL, order[i] * MANY_FRAG_LEN, MANY_FRAG_LEN,
+                                   TRUE);
+        ASSERT_EQ_POINTER(NULL,fd_head);
+    }
+
+    /* a fragment straddling fragments 100 and 101, with different data
+     * where it overlaps fragment 100 */
+    memcpy(conflict_data, many_data + 100 * MANY_FRAG_LEN + MANY_FRAG_LEN / 2, MANY_FRAG_LEN);
+    conflict_data[0] ^= 0xFF;
+    conflict_tvb = tvb_new_real_data(conflict_data, MANY_FRAG_LEN, MANY_FRAG_LEN);
+    pinfo.num = MANY_FRAGS + 1;
+    fd_head=fragment_add_check(&test_reassembly_table, conflict_tvb, 0,
+                               &pinfo, 12, NULL, 100 * MANY_FRAG_LEN + MANY_FRAG_LEN / 2,
+                               MANY_FRAG_LEN, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+    tvb_free(conflict_tvb);
+
+    /* and the tail, which completes the datagram */
+    pinfo.num = MANY_FRAGS + 2;
+    fd_head=fragment_add_check(&test_reassembly_table, many_tvb, total - 1,
+                               &pinfo, 12, NULL, total - 1, 1, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    ASSERT_EQ(total,fd_head->datalen);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP|FD_OVERLAPCONFLICT,fd_head->flags);
+    for (fd = fd_head->next, i = 0; fd != NULL; fd = fd->next, i++) {
+        if (fd->flags & FD_OVERLAPCONFLICT) {
+            ASSERT_EQ(100 * MANY_FRAG_LEN + MANY_FRAG_LEN / 2,fd->offset);
+            conflicting++;
+        }
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+    ASSERT_EQ(MANY_FRAGS + 2,i);
+    ASSERT_EQ(1,conflicting);
+
+    /* the data of the fragment that came first is used where they overlap */
+    many_frags_check_data(fd_head, total);
+
+    g_free(order);
+    many_frags_teardown();
+}
+
+/* Partial reassembly with fragment_add(): many fragments are reassembled,
+ * then the reassembly is extended with as many more.
+ */
+static void
+test_fragment_add_many_partial_reassembly(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint32 *order;
+    guint32 i, round, total, num = 1;
+
+    printf("Starting test test_fragment_add_many_partial_reassembly\n");
+
+    total = 2 * MANY_FRAGS * MANY_FRAG_LEN;
+    many_frags_setup(total);
+    order = g_new(guint32, MANY_FRAGS);
+    many_frags_order(order, MANY_FRAGS, 2);
+
+    for (round = 0; round < 2; round++) {
+        if (round > 0) {
+            fragment_set_partial_reassembly(&test_reassembly_table, &pinfo, 12, NULL);
+        }
+        fd_head = NULL;
+        for (i = 0; i < MANY_FRAGS; i++) {
+            guint32 frag = round * MANY_FRAGS + order[i];
+
+            pinfo.num = num++;
+            fd_head=fragment_add(&test_reassembly_table, many_tvb, frag * MANY_FRAG_LEN,
+                                 &pinfo, 12, NULL, frag * MANY_FRAG_LEN, MANY_FRAG_LEN,
+                                 order[i] != MANY_FRAGS - 1);
+            if (i < MANY_FRAGS - 1) {
+                ASSERT_EQ_POINTER(NULL,fd_head);
+            }
+        }
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+        ASSERT_EQ((round + 1) * MANY_FRAGS * MANY_FRAG_LEN,fd_head->datalen);
+        ASSERT_EQ(pinfo.num,fd_head->reassembled_in);
+        ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+        ASSERT_EQ_POINTER(NULL,fd_head->frag_index);
+
+        for (fd = fd_head->next, i = 0; fd != NULL; fd = fd->next, i++) {
+            ASSERT_EQ(i * MANY_FRAG_LEN,fd->offset);
+            ASSERT_EQ(0,fd->flags);
+            ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+        }
+        ASSERT_EQ((round + 1) * MANY_FRAGS,i);
+
+        many_frags_check_data(fd_head, (round + 1) * MANY_FRAGS * MANY_FRAG_LEN);
+    }
+
+    g_free(order);
+    many_frags_teardown();
+}
+
+/* Many fragments in a block sequence, added out of order with
+ * fragment_add_seq_check().
+ */
+static void
+test_fragment_add_seq_check_many_shuffled(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint32 *order;
+    guint32 i, total;
+
+    printf("Starting test test_fragment_add_seq_check_many_shuffled\n");
+
+    total = MANY_FRAGS * MANY_FRAG_LEN;
+    many_frags_setup(total);
+    order = g_new(guint32, MANY_FRAGS);
+    many_frags_order(order, MANY_FRAGS, 2);
+
+    fd_head = NULL;
+    for (i = 0; i < MANY_FRAGS; i++) {
+        pinfo.num = i + 1;
+        fd_head=fragment_add_seq_check(&test_reassembly_table, many_tvb, order[i] * MANY_FRAG_LEN,
+                                       &pinfo, 12, NULL, order[i], MANY_FRAG_LEN,
+                                       order[i] != MANY_FRAGS - 1);
+        if (i < MANY_FRAGS - 1) {
+            ASSERT_EQ_POINTER(NULL,fd_head);
+        }
+    }
+
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(total,fd_head->len); /* the length of data we have */
+    ASSERT_EQ(MANY_FRAGS - 1,fd_head->datalen); /* seqno of the last fragment we have */
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_BLOCKSEQUENCE|FD_DATALEN_SET,fd_head->flags);
+
+    for (fd = fd_head->next, i = 0; fd != NULL; fd = fd->next, i++) {
+        ASSERT_EQ(i,fd->offset);  /* seqno */
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+    ASSERT_EQ(MANY_FRAGS,i);
+
+    many_frags_check_data(fd_head, total);
+
+    g_free(order);
+    many_frags_teardown();
+}
+
+
 /**********************************************************************************
  *
  * main
@@ -1535,6 +1865,13 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_802_11_0,
         test_fragment_add_seq_802_11_1,
         test_simple_fragment_add_seq_next,
+        test_fragment_add_check_many_in_order,     /* many fragments    */
+        test_fragment_add_check_many_reversed,
+        test_fragment_add_check_many_shuffled,
+        test_fragment_add_check_many_overlapping,
+        test_fragment_add_check_many_conflict,
+        test_fragment_add_many_partial_reassembly,
+        test_fragment_add_seq_check_many_shuffled,
 #if 0
         test_missing_data_fragment_add_seq_next,
         test_missing_data_fragment_add_seq_next_2,
@@ -95,6 +95,16 @@ typedef struct _tap_listener_t {
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/* If set, only this listener and dissector helpers are active. */
+static void *tap_exclusive_tapdata=NULL;
+
+static gboolean
+tap_listener_is_active(volatile tap_listener_t *tl)
+{
+	return !tap_exclusive_tapdata || tl->tapdata==tap_exclusive_tapdata
+	    || (tl->flags & TL_IS_DISSECTOR_HELPER);
+}
+
 #ifdef HAVE_PLUGINS
 static GSList *tap_plugins = NULL;
 
@@ -306,6 +316,9 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 	   for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
 		for(tl=tap_listener_queue;tl;tl=tl->next){
+			if(!tap_listener_is_active(tl)){
+				continue;
+			}
 			tp=&tap_packet_array[i];
 			/* Don't tap the packet if it's an "error" unless the listener tells us to */
 			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
@@ -377,6 +390,9 @@ reset_tap_listeners(void)
 	volatile tap_listener_t *tl;
 
 	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(!tap_listener_is_active(tl)){
+			continue;
+		}
 		if(tl->reset){
 			tl->reset(tl->tapdata);
 		}
@@ -399,6 +415,9 @@ draw_tap_listeners(gboolean draw_all)
 	volatile tap_listener_t *tl;
 
 	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(!tap_listener_is_active(tl)){
+			continue;
+		}
 		if(tl->needs_redraw || draw_all){
 			if(tl->draw){
 				tl->draw(tl->tapdata);
@@ -616,9 +635,18 @@ remove_tap_listener(void *tapdata)
 
 		}
 	}
+	if(tl && tl->tapdata==tap_exclusive_tapdata){
+		tap_exclusive_tapdata=NULL;
+	}
 	free_tap_listener(tl);
 }
 
+void
+set_tap_listener_exclusive(void *tapdata)
+{
+	tap_exclusive_tapdata=tapdata;
+}
+
 /*
  * Return TRUE if we have one or more tap listeners that require dissection,
  * FALSE otherwise.
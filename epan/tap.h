@@ -219,6 +219,16 @@ WS_DLL_PUBLIC void tap_listeners_dfilter_recompile(void);
 /** this function removes a tap listener */
 WS_DLL_PUBLIC void remove_tap_listener(void *tapdata);
 
+/**
+ * Make the tap listener registered with tapdata the only one that is reset,
+ * passed packets and drawn, apart from dissector helpers.  Pass NULL to make
+ * all of them active again.
+ *
+ * This is for retapping only some of the frames on behalf of one listener,
+ * so that the others don't lose the state they built from all of them.
+ */
+WS_DLL_PUBLIC void set_tap_listener_exclusive(void *tapdata);
+
 /**
  * Return TRUE if we have one or more tap listeners that require dissection,
  * FALSE otherwise.
@@ -0,0 +1,368 @@
+/* tcp_stream_test.c
+ * Tests for the per-stream frame lists kept by the TCP dissector, and
+ * for retapping only the frames of one stream
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/packet.h>
+#include <epan/register.h>
+#include <epan/tap.h>
+#include <epan/tvbuff.h>
+#include <epan/dissectors/packet-tcp.h>
+
+#include <wiretap/wtap.h>
+
+/*
+ * Frame i (counting from 1) is a TCP segment from 10.0.0.1 port
+ * SPORT_BASE + i % NUM_STREAMS to 10.0.0.2 port 80, so the streams are
+ * interleaved. NUM_FRAMES is prime so that FIRST_PASS_ORDER() visits
+ * each frame once, out of order.
+ */
+#define NUM_FRAMES      31
+#define NUM_STREAMS     3
+#define SPORT_BASE      40000
+#define PAYLOAD_LEN     10
+#define PACKET_LEN      (14 + 20 + 20 + PAYLOAD_LEN)
+
+#define FIRST_PASS_ORDER(i) ((guint32)((i) * 7 % NUM_FRAMES + 1))
+
+struct packet_provider_data {
+    frame_data frames[NUM_FRAMES + 1];
+};
+
+typedef struct {
+    guint32 stream_of_frame[NUM_FRAMES + 1];
+    guint32 frames[NUM_FRAMES];
+    guint32 num_frames;
+    guint num_resets;
+    guint num_draws;
+} tcp_stream_test_tap_t;
+
+static const nstime_t *
+tcp_stream_test_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+{
+    if (frame_num < 1 || frame_num > NUM_FRAMES)
+        return NULL;
+    return &prov->frames[frame_num].abs_ts;
+}
+
+static const struct packet_provider_funcs tcp_stream_test_funcs = {
+    tcp_stream_test_get_frame_ts,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static void
+build_packet(guint8 *pd, guint32 num)
+{
+    guint16 sport = SPORT_BASE + num % NUM_STREAMS;
+    guint32 seq = 1000 + (num / NUM_STREAMS) * PAYLOAD_LEN;
+    guint8 *ip = pd + 14;
+    guint8 *tcp = ip + 20;
+    guint i;
+
+    memset(pd, 0, PACKET_LEN);
+
+    /* Ethernet */
+    memcpy(pd, "\x00\x00\x5e\x00\x53\x02\x00\x00\x5e\x00\x53\x01\x08\x00", 14);
+
+    /* IPv4, no options */
+    ip[0] = 0x45;
+    ip[2] = (20 + 20 + PAYLOAD_LEN) >> 8;
+    ip[3] = (20 + 20 + PAYLOAD_LEN) & 0xff;
+    ip[8] = 64;
+    ip[9] = 6;
+    memcpy(ip + 12, "\x0a\x00\x00\x01\x0a\x00\x00\x02", 8);
+
+    /* TCP, PSH/ACK, no options */
+    tcp[0] = sport >> 8;
+    tcp[1] = sport & 0xff;
+    tcp[3] = 80;
+    tcp[4] = (guint8)(seq >> 24);
+    tcp[5] = (guint8)(seq >> 16);
+    tcp[6] = (guint8)(seq >> 8);
+    tcp[7] = (guint8)seq;
+    tcp[11] = 1;
+    tcp[12] = 0x50;
+    tcp[13] = 0x18;
+    tcp[14] = 0xff;
+    tcp[15] = 0xff;
+
+    for (i = 0; i < PAYLOAD_LEN; i++)
+        tcp[20 + i] = (guint8)(num + i);
+}
+
+static void
+init_frames(struct packet_provider_data *prov)
+{
+    wtap_rec rec;
+    nstime_t elapsed_time;
+    const frame_data *frame_ref = NULL;
+    guint32 num;
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS;
+    rec.tsprec = WTAP_TSPREC_USEC;
+    rec.rec_header.packet_header.caplen = PACKET_LEN;
+    rec.rec_header.packet_header.len = PACKET_LEN;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_ETHERNET;
+
+    nstime_set_zero(&elapsed_time);
+    for (num = 1; num <= NUM_FRAMES; num++) {
+        rec.ts.secs = 1000000000 + num;
+        frame_data_init(&prov->frames[num], num, &rec, 0, 0);
+        frame_data_set_before_dissect(&prov->frames[num], &elapsed_time, &frame_ref, NULL);
+    }
+}
+
+static void
+dissect_frame(struct packet_provider_data *prov, epan_dissect_t *edt, guint32 num)
+{
+    wtap_rec rec;
+    guint8 pd[PACKET_LEN];
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS;
+    rec.tsprec = WTAP_TSPREC_USEC;
+    rec.ts = prov->frames[num].abs_ts;
+    rec.rec_header.packet_header.caplen = PACKET_LEN;
+    rec.rec_header.packet_header.len = PACKET_LEN;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_ETHERNET;
+
+    build_packet(pd, num);
+    epan_dissect_run_with_taps(edt, WTAP_FILE_TYPE_SUBTYPE_PCAP, &rec,
+                               tvb_new_real_data(pd, PACKET_LEN, PACKET_LEN),
+                               &prov->frames[num], NULL);
+    epan_dissect_reset(edt);
+}
+
+static void
+tcp_stream_test_reset(void *tapdata)
+{
+    tcp_stream_test_tap_t *tap = (tcp_stream_test_tap_t *)tapdata;
+
+    tap->num_frames = 0;
+    tap->num_resets++;
+}
+
+static gboolean
+tcp_stream_test_packet(void *tapdata, packet_info *pinfo,
+                       epan_dissect_t *edt _U_, const void *data)
+{
+    tcp_stream_test_tap_t *tap = (tcp_stream_test_tap_t *)tapdata;
+    const struct tcpheader *tcph = (const struct tcpheader *)data;
+
+    g_assert(tap->num_frames < NUM_FRAMES);
+    g_assert(pinfo->num >= 1 && pinfo->num <= NUM_FRAMES);
+    tap->frames[tap->num_frames++] = pinfo->num;
+    tap->stream_of_frame[pinfo->num] = tcph->th_stream;
+    return TRUE;
+}
+
+static void
+tcp_stream_test_draw(void *tapdata)
+{
+    tcp_stream_test_tap_t *tap = (tcp_stream_test_tap_t *)tapdata;
+
+    tap->num_draws++;
+}
+
+static void
+add_listener(tcp_stream_test_tap_t *tap)
+{
+    GString *error_string;
+
+    memset(tap, 0, sizeof *tap);
+    error_string = register_tap_listener("tcp", tap, NULL, 0,
+                                         tcp_stream_test_reset,
+                                         tcp_stream_test_packet,
+                                         tcp_stream_test_draw);
+    g_assert(error_string == NULL);
+}
+
+/* Check the frame list of each stream against what was tapped. */
+static void
+check_stream_frames(const tcp_stream_test_tap_t *tap)
+{
+    const guint32 *frames;
+    guint32 num_frames, stream, num, i, total = 0;
+
+    g_assert(get_tcp_stream_count() == NUM_STREAMS);
+    for (stream = 0; stream < NUM_STREAMS; stream++) {
+        frames = get_tcp_stream_frames(stream, &num_frames);
+        g_assert(frames != NULL);
+        i = 0;
+        for (num = 1; num <= NUM_FRAMES; num++) {
+            if (tap->stream_of_frame[num] != stream)
+                continue;
+            g_assert(i < num_frames);
+            g_assert(frames[i] == num);
+            i++;
+        }
+        g_assert(i == num_frames);
+        total += num_frames;
+    }
+    g_assert(total == NUM_FRAMES);
+
+    frames = get_tcp_stream_frames(NUM_STREAMS, &num_frames);
+    g_assert(frames == NULL);
+    g_assert(num_frames == 0);
+}
+
+/* A first pass that visits the frames out of order mustn't leave any out. */
+static void
+tcp_stream_test_out_of_order(void)
+{
+    struct packet_provider_data *prov = g_new0(struct packet_provider_data, 1);
+    tcp_stream_test_tap_t tap;
+    epan_t *session;
+    epan_dissect_t *edt;
+    guint32 num_frames;
+    guint i;
+
+    init_frames(prov);
+    session = epan_new(prov, &tcp_stream_test_funcs);
+    add_listener(&tap);
+
+    edt = epan_dissect_new(session, FALSE, FALSE);
+    for (i = 0; i < NUM_FRAMES; i++)
+        dissect_frame(prov, edt, FIRST_PASS_ORDER(i));
+    g_assert(tap.num_frames == NUM_FRAMES);
+    check_stream_frames(&tap);
+
+    /* Dissecting the frames again doesn't add them twice. */
+    reset_tap_listeners();
+    for (i = NUM_FRAMES; i >= 1; i--)
+        dissect_frame(prov, edt, i);
+    check_stream_frames(&tap);
+    epan_dissect_free(edt);
+
+    remove_tap_listener(&tap);
+    epan_free(session);
+
+    /* The lists go with the file. */
+    g_assert(get_tcp_stream_frames(0, &num_frames) == NULL);
+    g_assert(num_frames == 0);
+
+    for (i = 1; i <= NUM_FRAMES; i++)
+        frame_data_destroy(&prov->frames[i]);
+    g_free(prov);
+}
+
+/*
+ * Retap the frames of one stream for one listener, the way
+ * cf_retap_frames() does for the TCP stream graphs, and check that the
+ * listener sees just those frames and that the others are left alone.
+ */
+static void
+tcp_stream_test_retap(void)
+{
+    struct packet_provider_data *prov = g_new0(struct packet_provider_data, 1);
+    tcp_stream_test_tap_t graph, other;
+    epan_t *session;
+    epan_dissect_t *edt;
+    const guint32 *frames;
+    guint32 num_frames, num, i;
+
+    init_frames(prov);
+    session = epan_new(prov, &tcp_stream_test_funcs);
+    add_listener(&graph);
+    add_listener(&other);
+
+    edt = epan_dissect_new(session, FALSE, FALSE);
+    for (num = 1; num <= NUM_FRAMES; num++)
+        dissect_frame(prov, edt, num);
+    g_assert(graph.num_frames == NUM_FRAMES);
+    g_assert(other.num_frames == NUM_FRAMES);
+
+    frames = get_tcp_stream_frames(1, &num_frames);
+    g_assert(frames != NULL);
+    g_assert(num_frames > 0 && num_frames < NUM_FRAMES);
+
+    set_tap_listener_exclusive(&graph);
+    reset_tap_listeners();
+    for (i = 0; i < num_frames; i++)
+        dissect_frame(prov, edt, frames[i]);
+    draw_tap_listeners(TRUE);
+    set_tap_listener_exclusive(NULL);
+    epan_dissect_free(edt);
+
+    g_assert(graph.num_resets == 1);
+    g_assert(graph.num_draws == 1);
+    g_assert(graph.num_frames == num_frames);
+    for (i = 0; i < num_frames; i++) {
+        g_assert(graph.frames[i] == frames[i]);
+        g_assert(graph.stream_of_frame[frames[i]] == 1);
+    }
+
+    g_assert(other.num_resets == 0);
+    g_assert(other.num_draws == 0);
+    g_assert(other.num_frames == NUM_FRAMES);
+    for (num = 1; num <= NUM_FRAMES; num++)
+        g_assert(other.frames[num - 1] == num);
+
+    /* With no exclusive listener, everyone is reset again. */
+    reset_tap_listeners();
+    g_assert(graph.num_resets == 2);
+    g_assert(other.num_resets == 1);
+
+    remove_tap_listener(&graph);
+    remove_tap_listener(&other);
+    epan_free(session);
+
+    for (num = 1; num <= NUM_FRAMES; num++)
+        frame_data_destroy(&prov->frames[num]);
+    g_free(prov);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(FALSE);
+    if (!epan_init(register_all_protocols, register_all_protocol_handoffs,
+                NULL, NULL))
+        return 2;
+
+    g_test_add_func("/tcp/stream_frames/out_of_order", tcp_stream_test_out_of_order);
+    g_test_add_func("/tcp/stream_frames/retap",        tcp_stream_test_retap);
+
+    ret = g_test_run();
+
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
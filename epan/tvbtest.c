@@ -21,6 +21,105 @@
 
 gboolean failed = FALSE;
 
+/* Returns the offset of the first occurrence of needle in data, or -1. */
+static gint
+find_expected(const guint8 *data, guint length, const guint8 *needle, guint needle_length)
+{
+	guint i;
+
+	for (i = 0; i + needle_length <= length; i++) {
+		if (memcmp(&data[i], needle, needle_length) == 0)
+			return (gint) i;
+	}
+	return -1;
+}
+
+/* Searches the tvbuff for needles taken from the expected data at every
+ * offset, which makes them straddle the members of composite tvbuffs.
+ * Returns TRUE if all tests succeeed, FALSE if any test fails */
+static gboolean
+test_find_tvb(tvbuff_t *tvb, const gchar* name,
+     guint8* expected_data, guint expected_length)
+{
+	tvbuff_t	*needle_tvb;
+	guint		needle_length, i;
+	gint		found, expected;
+
+	for (needle_length = 1; needle_length <= 8; needle_length++) {
+		for (i = 0; i + needle_length <= expected_length; i++) {
+			needle_tvb = tvb_new_real_data(&expected_data[i], needle_length, needle_length);
+
+			found = tvb_find_tvb(tvb, needle_tvb, 0);
+			expected = find_expected(expected_data, expected_length,
+					&expected_data[i], needle_length);
+			tvb_free(needle_tvb);
+
+			if (found != expected) {
+				printf("13: Failed TVB=%s Offset=%u Length=%u "
+						"tvb_find_tvb() returned %d instead of %d\n",
+						name, i, needle_length, found, expected);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* Searches the tvbuff, from every offset, for every byte of the expected
+ * data with tvb_find_guint8() and tvb_ws_mempbrk_pattern_guint8(), so
+ * that the searches start and end in every member of composite tvbuffs.
+ * Returns TRUE if all tests succeeed, FALSE if any test fails */
+static gboolean
+test_find_guint8(tvbuff_t *tvb, const gchar* name,
+     guint8* expected_data, guint expected_length)
+{
+	ws_mempbrk_pattern pattern;
+	gchar		needles[2];
+	guchar		found_needle;
+	guint		start, i;
+	gint		found, expected;
+
+	for (start = 0; start < expected_length; start++) {
+		for (i = start; i < expected_length; i++) {
+			expected = find_expected(&expected_data[start], expected_length - start,
+					&expected_data[i], 1);
+			expected += start;
+
+			found = tvb_find_guint8(tvb, start, -1, expected_data[i]);
+			if (found != expected) {
+				printf("14: Failed TVB=%s Offset=%u Needle=0x%02x "
+						"tvb_find_guint8() returned %d instead of %d\n",
+						name, start, expected_data[i], found, expected);
+				failed = TRUE;
+				return FALSE;
+			}
+
+			/* The pattern is an ASCII string, so it can't hold
+			 * a zero byte */
+			if (expected_data[i] == 0 || expected_data[i] >= 0x80)
+				continue;
+
+			needles[0] = (gchar) expected_data[i];
+			needles[1] = '\0';
+			memset(&pattern, 0, sizeof(pattern));
+			ws_mempbrk_compile(&pattern, needles);
+			found_needle = 0;
+			found = tvb_ws_mempbrk_pattern_guint8(tvb, start, -1, &pattern, &found_needle);
+			if (found != expected || found_needle != expected_data[i]) {
+				printf("15: Failed TVB=%s Offset=%u Needle=0x%02x "
+						"tvb_ws_mempbrk_pattern_guint8() returned %d instead of %d\n",
+						name, start, expected_data[i], found, expected);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
 /* Tests a tvbuff against the expected pattern/length.
  * Returns TRUE if all tests succeeed, FALSE if any test fails */
 gboolean
@@ -30,6 +129,7 @@ test(tvbuff_t *tvb, const gchar* name,
 	guint			length;
 	guint			reported_length;
 	guint8			*ptr;
+	const guint8		*cptr;
 	volatile gboolean	ex_thrown;
 	volatile guint32	val32;
 	guint32			expected32;
@@ -53,6 +153,14 @@ test(tvbuff_t *tvb, const gchar* name,
 		return FALSE;
 	}
 
+	if (!test_find_tvb(tvb, name, expected_data, length)) {
+		return FALSE;
+	}
+
+	if (!test_find_guint8(tvb, name, expected_data, length)) {
+		return FALSE;
+	}
+
 	/* Test boundary case. A BoundsError exception should be thrown. */
 	ex_thrown = FALSE;
 	TRY {
@@ -267,6 +375,29 @@ test(tvbuff_t *tvb, const gchar* name,
 	}
 	wmem_free(NULL, ptr);
 
+	/* Sweep across data in various sized increments checking
+	 * tvb_get_ptr().  Asking for the same range again must give
+	 * the same pointer, not another copy. */
+	for (incr = 1; incr < length; incr++) {
+		for (i = 0; i < length - incr; i += incr) {
+			cptr = tvb_get_ptr(tvb, i, incr);
+			if (memcmp(cptr, &expected_data[i], incr) != 0) {
+				printf("13: Failed TVB=%s Offset=%u Length=%u "
+						"Bad get_ptr\n",
+						name, i, incr);
+				failed = TRUE;
+				return FALSE;
+			}
+			if (tvb_get_ptr(tvb, i, incr) != cptr) {
+				printf("14: Failed TVB=%s Offset=%u Length=%u "
+						"get_ptr copied the range again\n",
+						name, i, incr);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
 
 	printf("Passed TVB=%s\n", name);
 
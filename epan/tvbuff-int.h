@@ -25,6 +25,8 @@ struct tvb_ops {
 	gint (*tvb_ws_mempbrk_pattern_guint8)(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle);
 
 	tvbuff_t *(*tvb_clone)(tvbuff_t *tvb, guint abs_offset, guint abs_length);
+
+	gint (*tvb_find_bytes)(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needle, guint needle_len);
 };
 
 /*
@@ -69,4 +71,8 @@ void tvb_add_to_chain(tvbuff_t *parent, tvbuff_t *child);
 guint tvb_offset_from_real_beginning_counter(const tvbuff_t *tvb, const guint counter);
 
 void tvb_check_offset_length(const tvbuff_t *tvb, const gint offset, gint const length_val, guint *offset_ptr, guint *length_ptr);
+
+/* Search for needle in the limit bytes at abs_offset without flattening
+ * the tvbuff; returns the offset of the first occurrence, or -1. */
+gint tvb_find_bytes(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needle, guint needle_len);
 #endif
@@ -32,6 +32,7 @@
 #include "wsutil/unicode-utils.h"
 #include "wsutil/nstime.h"
 #include "wsutil/time_util.h"
+#include "wsutil/ws_memmem.h"
 #include "tvbuff.h"
 #include "tvbuff-int.h"
 #include "strutil.h"
@@ -3585,15 +3586,38 @@ gchar *tvb_bytes_to_str(wmem_allocator_t *allocator, tvbuff_t *tvb,
 	return bytes_to_str(allocator, ensure_contiguous(tvb, offset, len), len);
 }
 
+gint
+tvb_find_bytes(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needle, guint needle_len)
+{
+	const guint8 *data;
+	const guint8 *location;
+
+	if (tvb->real_data) {
+		location = ws_memmem(tvb->real_data + abs_offset, limit, needle, needle_len);
+		if (location) {
+			return (gint) (location - tvb->real_data);
+		}
+		return -1;
+	}
+
+	if (tvb->ops->tvb_find_bytes)
+		return tvb->ops->tvb_find_bytes(tvb, abs_offset, limit, needle, needle_len);
+
+	data = ensure_contiguous(tvb, abs_offset, limit);
+	location = ws_memmem(data, limit, needle, needle_len);
+	if (location) {
+		return (gint) (abs_offset + (location - data));
+	}
+	return -1;
+}
+
 /* Find a needle tvbuff within a haystack tvbuff. */
 gint
 tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb, const gint haystack_offset)
 {
 	guint	      haystack_abs_offset = 0, haystack_abs_length = 0;
-	const guint8 *haystack_data;
 	const guint8 *needle_data;
 	const guint   needle_len = needle_tvb->length;
-	const guint8 *location;
 
 	DISSECTOR_ASSERT(haystack_tvb && haystack_tvb->initialized);
 
@@ -3601,21 +3625,16 @@ tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb, const gint haystack_o
 		return -1;
 	}
 
-	/* Get pointers to the tvbuffs' data. */
-	haystack_data = ensure_contiguous(haystack_tvb, 0, -1);
-	needle_data   = ensure_contiguous(needle_tvb, 0, -1);
+	/* The needle is usually short, but the haystack may be a large
+	 * composite tvbuff (e.g. a reassembled PDU), which is searched
+	 * without copying its data. */
+	needle_data = ensure_contiguous(needle_tvb, 0, -1);
 
 	check_offset_length(haystack_tvb, haystack_offset, -1,
 			&haystack_abs_offset, &haystack_abs_length);
 
-	location = epan_memmem(haystack_data + haystack_abs_offset, haystack_abs_length,
+	return tvb_find_bytes(haystack_tvb, haystack_abs_offset, haystack_abs_length,
 			needle_data, needle_len);
-
-	if (location) {
-		return (gint) (location - haystack_data);
-	}
-
-	return -1;
 }
 
 gint
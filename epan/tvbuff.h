@@ -208,6 +208,12 @@ WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
 
+/** Like tvb_composite_finalize(), but the composite tvbuff takes ownership
+ * of its members instead of being chained to the first one: they are
+ * freed, with their chains, when the composite tvbuff is freed. Each
+ * member must be the head of its own chain. */
+WS_DLL_PUBLIC void tvb_composite_finalize_owned(tvbuff_t *tvb);
+
 
 /* Get amount of captured data in the buffer (which is *NOT* necessarily the
  * length of the packet). You probably want tvb_reported_length instead. */
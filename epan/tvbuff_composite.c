@@ -15,8 +15,14 @@
 #include "tvbuff-int.h"
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
+#include <wsutil/ws_memmem.h>
+
 typedef struct {
-	GSList		*tvbs;
+	/* Members appended or prepended before the tvbuff is finalized */
+	GQueue		 pending;
+
+	tvbuff_t	**tvbs;
+	guint		 num_members;
 
 	/* Used for quick testing to see if this
 	 * is the tvbuff that a COMPOSITE is
@@ -24,8 +30,22 @@ typedef struct {
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* The members are freed with the composite tvbuff */
+	gboolean	 owns_members;
+
+	/* Ranges spanning members that have been copied, by offset and
+	 * length, or NULL if there are none */
+	GHashTable	*copies;
+
 } tvb_comp_t;
 
+/* A range spanning members, copied for the lifetime of the composite */
+typedef struct {
+	guint	 offset;
+	guint	 length;
+	guint8	*data;
+} tvb_comp_copy_t;
+
 struct tvb_composite {
 	struct tvbuff tvb;
 
@@ -37,59 +57,91 @@ composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
 
-	g_slist_free(composite->tvbs);
+	if (composite->owns_members) {
+		for (i = 0; i < composite->num_members; i++)
+			tvb_free(composite->tvbs[i]);
+	}
+	g_queue_clear(&composite->pending);
+	g_free(composite->tvbs);
 
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
-	if (tvb->real_data) {
-		/*
-		 * XXX - do this with a union?
-		 */
-		g_free((gpointer)tvb->real_data);
-	}
+	if (composite->copies)
+		g_hash_table_destroy(composite->copies);
+}
+
+static guint
+composite_copy_hash(gconstpointer key)
+{
+	const tvb_comp_copy_t *copy = (const tvb_comp_copy_t *) key;
+
+	return copy->offset * 31 + copy->length;
+}
+
+static gboolean
+composite_copy_equal(gconstpointer a, gconstpointer b)
+{
+	const tvb_comp_copy_t *copy_a = (const tvb_comp_copy_t *) a;
+	const tvb_comp_copy_t *copy_b = (const tvb_comp_copy_t *) b;
+
+	return copy_a->offset == copy_b->offset && copy_a->length == copy_b->length;
 }
 
 static guint
 composite_offset(const tvbuff_t *tvb, const guint counter)
 {
 	const struct tvb_composite *composite_tvb = (const struct tvb_composite *) tvb;
-	const tvbuff_t *member = (const tvbuff_t *)composite_tvb->composite.tvbs->data;
+	const tvbuff_t *member = composite_tvb->composite.tvbs[0];
 
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/*
+ * Find the member holding the byte at abs_offset, by a binary search
+ * of the end offsets; returns num_members if abs_offset is past the
+ * end of the last member.
+ */
+static guint
+composite_find_member(const tvb_comp_t *composite, const guint abs_offset)
+{
+	guint low = 0, high = composite->num_members, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (composite->end_offsets[mid] < abs_offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->tvbs[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -100,11 +152,33 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
 	else {
-		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
-		void *real_data = g_malloc(tvb->length);
-		tvb_memcpy(tvb, real_data, 0, tvb->length);
-		tvb->real_data = (const guint8 *)real_data;
-		return tvb->real_data + abs_offset;
+		/*
+		 * The range spans two or more members; copy just that
+		 * range.  The composite itself is never flattened, as it
+		 * may be far bigger than the range.  A reassembled
+		 * composite outlives the packet, and the pointer has to
+		 * stay valid as long as it does, so the copy is kept until
+		 * the composite is freed.  Dissecting the packet again
+		 * asks for the same ranges, so they're only copied once.
+		 */
+		tvb_comp_copy_t  key, *copy;
+
+		if (!composite->copies)
+			composite->copies = g_hash_table_new_full(composite_copy_hash,
+			    composite_copy_equal, g_free, NULL);
+
+		key.offset = abs_offset;
+		key.length = abs_length;
+		copy = (tvb_comp_copy_t *) g_hash_table_lookup(composite->copies, &key);
+		if (!copy) {
+			copy = (tvb_comp_copy_t *) g_malloc(sizeof(tvb_comp_copy_t) + abs_length);
+			copy->offset = abs_offset;
+			copy->length = abs_length;
+			copy->data = (guint8 *) (copy + 1);
+			tvb_memcpy(tvb, copy->data, abs_offset, abs_length);
+			g_hash_table_insert(composite->copies, copy, copy);
+		}
+		return copy->data;
 	}
 
 	DISSECTOR_ASSERT_NOT_REACHED();
@@ -116,63 +190,179 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
+	member_tvb = composite->tvbs[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
+
+	/* The requested data is non-contiguous inside
+	 * the member tvb. We have to memcpy() the part that's in the member tvb,
+	 * then iterate across the other member tvb's, copying their portions
+	 * until we have copied all data.
+	 */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->tvbs[i];
 		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
+		member_length = MIN(member_length, abs_length);
 
-		/* composite_memcpy() can't handle a member_length of zero. */
+		/* Members can't be empty, so this always makes progress. */
 		DISSECTOR_ASSERT(member_length > 0);
 
 		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
+		target		+= member_length;
 		abs_length	-= member_length;
+		member_offset	 = 0;
+		i++;
+	}
+
+	return _target;
+}
+
+static gint
+composite_find_bytes(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needle, guint needle_len)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	const guint end = abs_offset + limit;
+	guint8	   *window = NULL;
+	const guint8 *location;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_start, member_end, search_start, search_end;
+	guint	    window_start, window_len;
+	gint	    result = -1;
+
+	/* Search each member in turn, so that the data doesn't have to be
+	 * flattened; only the bytes around the boundaries between members
+	 * are copied, to find the occurrences that span two or more members. */
+	for (i = composite_find_member(composite, abs_offset); i < composite->num_members; i++) {
+		member_tvb = composite->tvbs[i];
+		member_start = composite->start_offsets[i];
+		member_end = composite->end_offsets[i] + 1;
+
+		if (member_end <= abs_offset)
+			continue;
+		if (member_start >= end)
+			break;
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
+		search_start = MAX(abs_offset, member_start);
+		search_end = MIN(member_end, end);
+
+		/* Occurrences within the member come first... */
+		if (search_end - search_start >= needle_len) {
+			result = tvb_find_bytes(member_tvb, search_start - member_start,
+					search_end - search_start, needle, needle_len);
+			if (result != -1) {
+				result += member_start;
+				break;
+			}
 		}
 
-		return target;
+		/* ...then the ones that start in its last needle_len - 1 bytes. */
+		if (needle_len > 1 && member_end < end) {
+			/* The needle may be longer than the member */
+			if (member_end - search_start > needle_len - 1)
+				window_start = member_end - (needle_len - 1);
+			else
+				window_start = search_start;
+			window_len = MIN(end, member_end + (needle_len - 1)) - window_start;
+			if (window_len >= needle_len) {
+				if (!window)
+					window = (guint8 *)g_malloc(2 * (needle_len - 1));
+				tvb_memcpy(tvb, window, window_start, window_len);
+				location = ws_memmem(window, window_len, needle, needle_len);
+				if (location) {
+					result = window_start + (gint) (location - window);
+					break;
+				}
+			}
+		}
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	g_free(window);
+	return result;
+}
+
+/*
+ * Find the first member overlapping [abs_offset, abs_offset + limit) and
+ * the part of it to search; used to search the members in turn, without
+ * copying their data.  Returns FALSE once there is nothing left to search.
+ */
+static gboolean
+composite_next_range(const tvb_comp_t *composite, guint *i, guint abs_offset, guint end,
+		guint *member_offset, guint *member_limit)
+{
+	guint member_start;
+
+	if (*i >= composite->num_members)
+		return FALSE;
+
+	member_start = composite->start_offsets[*i];
+	if (member_start >= end)
+		return FALSE;
+
+	*member_offset = MAX(abs_offset, member_start) - member_start;
+	*member_limit = MIN(composite->end_offsets[*i] + 1, end) - member_start - *member_offset;
+	return TRUE;
+}
+
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i, member_offset, member_limit;
+	gint	    result;
+
+	for (i = composite_find_member(composite, abs_offset);
+	     composite_next_range(composite, &i, abs_offset, abs_offset + limit, &member_offset, &member_limit);
+	     i++) {
+		result = tvb_find_guint8(composite->tvbs[i], member_offset, member_limit, needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
+	}
+
+	return -1;
+}
+
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i, member_offset, member_limit;
+	gint	    result;
+
+	for (i = composite_find_member(composite, abs_offset);
+	     composite_next_range(composite, &i, abs_offset, abs_offset + limit, &member_offset, &member_limit);
+	     i++) {
+		result = tvb_ws_mempbrk_pattern_guint8(composite->tvbs[i], member_offset, member_limit, pattern, found_needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
+	}
+
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -182,18 +372,23 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
+	composite_find_bytes, /* find_bytes */
 };
 
 /*
  * Composite tvb
  *
  *   1. A composite tvb is automatically chained to its first member when the
- *      tvb is finalized.
+ *      tvb is finalized with tvb_composite_finalize().
  *      This means that composite tvb members must all be in the same chain.
  *      ToDo: enforce this: By searching the chain?
+ *
+ *   2. A composite tvb finalized with tvb_composite_finalize_owned() isn't
+ *      chained to anything; it frees its members (and their chains) when
+ *      it is freed itself.
  */
 tvbuff_t *
 tvb_new_composite(void)
@@ -202,9 +397,13 @@ tvb_new_composite(void)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
+	g_queue_init(&composite->pending);
 	composite->tvbs		 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->owns_members	 = FALSE;
+	composite->copies	 = NULL;
 
 	return tvb;
 }
@@ -223,8 +422,8 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	 */
 	DISSECTOR_ASSERT(member->length);
 
-	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_append(composite->tvbs, member);
+	composite = &composite_tvb->composite;
+	g_queue_push_tail(&composite->pending, member);
 }
 
 void
@@ -241,19 +440,19 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	 */
 	DISSECTOR_ASSERT(member->length);
 
-	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_prepend(composite->tvbs, member);
+	composite = &composite_tvb->composite;
+	g_queue_push_head(&composite->pending, member);
 }
 
-void
-tvb_composite_finalize(tvbuff_t *tvb)
+static void
+composite_finalize_members(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	GSList	   *slist;
+	GList	   *item;
 	guint	    num_members;
 	tvbuff_t   *member_tvb;
 	tvb_comp_t *composite;
-	int	    i = 0;
+	guint	    i = 0;
 
 	DISSECTOR_ASSERT(tvb && !tvb->initialized);
 	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
@@ -261,7 +460,7 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	DISSECTOR_ASSERT(tvb->reported_length == 0);
 
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
+	num_members = g_queue_get_length(&composite->pending);
 
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
@@ -269,22 +468,44 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->tvbs = g_new(tvbuff_t *, num_members);
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
-	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
-		DISSECTOR_ASSERT((guint) i < num_members);
-		member_tvb = (tvbuff_t *)slist->data;
+	for (item = composite->pending.head; item != NULL; item = item->next) {
+		DISSECTOR_ASSERT(i < num_members);
+		member_tvb = (tvbuff_t *)item->data;
+		composite->tvbs[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
 		composite->end_offsets[i] = tvb->length - 1;
 		i++;
 	}
+	composite->num_members = num_members;
+	g_queue_clear(&composite->pending);
+}
+
+void
+tvb_composite_finalize(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	composite_finalize_members(tvb);
+
+	tvb_add_to_chain(composite_tvb->composite.tvbs[0], tvb); /* chain composite tvb to first member */
+	tvb->initialized = TRUE;
+	tvb->ds_tvb = tvb;
+}
+
+void
+tvb_composite_finalize_owned(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 
-	DISSECTOR_ASSERT(composite->tvbs);
+	composite_finalize_members(tvb);
 
-	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
+	composite_tvb->composite.owns_members = TRUE;
 	tvb->initialized = TRUE;
 	tvb->ds_tvb = tvb;
 }
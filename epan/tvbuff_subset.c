@@ -82,6 +82,19 @@ subset_clone(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 	return tvb_clone_offset_len(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, abs_length);
 }
 
+static gint
+subset_find_bytes(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needle, guint needle_len)
+{
+	struct tvb_subset *subset_tvb = (struct tvb_subset *) tvb;
+	gint result;
+
+	result = tvb_find_bytes(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, limit, needle, needle_len);
+	if (result == -1)
+		return -1;
+
+	return result - subset_tvb->subset.offset;
+}
+
 static const struct tvb_ops tvb_subset_ops = {
 	sizeof(struct tvb_subset), /* size */
 
@@ -92,6 +105,7 @@ static const struct tvb_ops tvb_subset_ops = {
 	subset_find_guint8,   /* find_guint8 */
 	subset_pbrk_guint8,   /* pbrk_guint8 */
 	subset_clone,         /* clone */
+	subset_find_bytes,    /* find_bytes */
 };
 
 static tvbuff_t *
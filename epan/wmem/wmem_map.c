@@ -35,10 +35,19 @@ wmem_init_hashing(void)
     postseed = g_random_int();
 }
 
+/* The map uses open addressing with Robin Hood linear probing: items live
+ * directly in the table, and an item is never further from its home slot
+ * than the item it would displace. That keeps probe sequences short even
+ * at high load, lets lookups stop as soon as they reach an item that is
+ * closer to its home than the key being looked for would be, and allows
+ * removal by shifting the following items back instead of leaving
+ * tombstones. The (mixed) hash of each key is stored with it, so most
+ * mismatches are rejected without calling eql_func, and growing the table
+ * never calls hash_func again. */
 typedef struct _wmem_map_item_t {
     const void *key;
     void *value;
-    struct _wmem_map_item_t *next;
+    guint32 hash; /* 0 if the slot is empty */
 } wmem_map_item_t;
 
 struct _wmem_map_t {
@@ -50,7 +59,11 @@ struct _wmem_map_t {
      * logarithms is expensive. */
     size_t capacity;
 
-    wmem_map_item_t **table;
+    wmem_map_item_t *table;
+
+    /* Number of items the table is sized for when it is (re)created, see
+     * wmem_map_reserve(). */
+    guint size_hint;
 
     GHashFunc  hash_func;
     GEqualFunc eql_func;
@@ -68,20 +81,47 @@ struct _wmem_map_t {
 
 /* Macro for calculating the real capacity of the map by using a left-shift to
  * do the 2^x operation. */
-#define CAPACITY(MAP) ((size_t)(1 << (MAP)->capacity))
+#define CAPACITY(MAP) (((size_t)1) << (MAP)->capacity)
+
+/* The number of items above which the table is grown: 7/8 of its capacity.
+ * This always leaves empty slots, which terminate the probe loops. */
+#define MAX_LOAD(MAP) (CAPACITY(MAP) - (CAPACITY(MAP) >> 3))
 
 /* Efficient universal integer hashing:
  * https://en.wikipedia.org/wiki/Universal_hashing#Avoiding_modular_arithmetic
+ * The full product is stored in the item; its top bits select the home slot.
+ * The lowest bit is forced to 1 so that 0 can mark an empty slot.
  */
 #define HASH(MAP, KEY) \
-    ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
+    ((guint32)((MAP)->hash_func(KEY) * x) | 1)
+
+#define SLOT(MAP, HASH) \
+    ((size_t)((HASH) >> (32 - (MAP)->capacity)))
+
+/* How far the item in slot I with hash HASH is from its home slot. */
+#define DISTANCE(MAP, HASH, I) \
+    (((I) - SLOT(MAP, HASH)) & (CAPACITY(MAP) - 1))
+
+/* The base-2 logarithm of the smallest capacity that holds size items
+ * without growing. */
+static size_t
+wmem_map_capacity_for(guint size)
+{
+    size_t capacity = WMEM_MAP_DEFAULT_CAPACITY;
+
+    while ((((size_t)1) << capacity) - ((((size_t)1) << capacity) >> 3) < size) {
+        capacity++;
+    }
+
+    return capacity;
+}
 
 static void
 wmem_map_init_table(wmem_map_t *map)
 {
     map->count     = 0;
-    map->capacity  = WMEM_MAP_DEFAULT_CAPACITY;
-    map->table     = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
+    map->capacity  = wmem_map_capacity_for(map->size_hint);
+    map->table     = wmem_alloc0_array(map->allocator, wmem_map_item_t, CAPACITY(map));
 }
 
 wmem_map_t *
@@ -98,6 +138,7 @@ wmem_map_new(wmem_allocator_t *allocator,
     map->allocator = allocator;
     map->count = 0;
     map->table = NULL;
+    map->size_hint = 0;
 
     return map;
 }
@@ -144,6 +185,7 @@ wmem_map_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave,
     map->allocator = slave;
     map->count = 0;
     map->table = NULL;
+    map->size_hint = 0;
 
     map->master_cb_id = wmem_register_callback(master, wmem_map_destroy_cb, map);
     map->slave_cb_id  = wmem_register_callback(slave, wmem_map_reset_cb, map);
@@ -151,31 +193,60 @@ wmem_map_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave,
     return map;
 }
 
+/* Places an item whose key is known not to be in the table yet. Going along
+ * the probe sequence, the item takes the slot of the first item that is
+ * closer to its own home slot, which then continues looking for a slot. */
 static inline void
-wmem_map_grow(wmem_map_t *map)
+wmem_map_place(wmem_map_t *map, guint32 hash, const void *key, void *value)
 {
-    wmem_map_item_t **old_table, *cur, *nxt;
-    size_t            old_cap, i;
-    guint             slot;
+    wmem_map_item_t *item, tmp;
+    size_t           mask, i, dist, item_dist;
+
+    mask = CAPACITY(map) - 1;
+    i    = SLOT(map, hash);
+
+    for (dist = 0; ; dist++, i = (i + 1) & mask) {
+        item = &map->table[i];
+
+        if (item->hash == 0) {
+            item->key   = key;
+            item->value = value;
+            item->hash  = hash;
+            return;
+        }
+
+        item_dist = DISTANCE(map, item->hash, i);
+        if (item_dist < dist) {
+            tmp = *item;
+            item->key   = key;
+            item->value = value;
+            item->hash  = hash;
+            key   = tmp.key;
+            value = tmp.value;
+            hash  = tmp.hash;
+            dist  = item_dist;
+        }
+    }
+}
+
+static void
+wmem_map_resize(wmem_map_t *map, size_t capacity)
+{
+    wmem_map_item_t *old_table;
+    size_t           old_cap, i;
 
     /* store the old table and capacity */
     old_table = map->table;
     old_cap   = CAPACITY(map);
 
-    /* double the size (capacity is base-2 logarithm, so this just means
-     * increment it) and allocate new table */
-    map->capacity++;
-    map->table = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
+    map->capacity = capacity;
+    map->table = wmem_alloc0_array(map->allocator, wmem_map_item_t, CAPACITY(map));
 
-    /* copy all the elements over from the old table */
+    /* copy all the elements over from the old table, reusing their hashes */
     for (i=0; i<old_cap; i++) {
-        cur = old_table[i];
-        while (cur) {
-            nxt              = cur->next;
-            slot             = HASH(map, cur->key);
-            cur->next        = map->table[slot];
-            map->table[slot] = cur;
-            cur              = nxt;
+        if (old_table[i].hash != 0) {
+            wmem_map_place(map, old_table[i].hash,
+                    old_table[i].key, old_table[i].value);
         }
     }
 
@@ -183,10 +254,61 @@ wmem_map_grow(wmem_map_t *map)
     wmem_free(map->allocator, old_table);
 }
 
+static inline wmem_map_item_t *
+wmem_map_find(wmem_map_t *map, const void *key, guint32 hash)
+{
+    wmem_map_item_t *item;
+    size_t           mask, i, dist;
+
+    mask = CAPACITY(map) - 1;
+    i    = SLOT(map, hash);
+
+    for (dist = 0; ; dist++, i = (i + 1) & mask) {
+        item = &map->table[i];
+
+        /* An empty slot, or an item that is closer to its home than the
+         * key would be, means that the key isn't in the table. */
+        if (item->hash == 0 || DISTANCE(map, item->hash, i) < dist) {
+            return NULL;
+        }
+        if (item->hash == hash && map->eql_func(key, item->key)) {
+            return item;
+        }
+    }
+}
+
+/* Removes an item by moving the following items of its probe sequence back
+ * by one slot, up to an empty slot or an item that is in its home slot. */
+static void
+wmem_map_delete_item(wmem_map_t *map, wmem_map_item_t *item)
+{
+    size_t mask, i, next;
+
+    mask = CAPACITY(map) - 1;
+    i    = (size_t)(item - map->table);
+
+    for (;;) {
+        next = (i + 1) & mask;
+        if (map->table[next].hash == 0 ||
+                DISTANCE(map, map->table[next].hash, next) == 0) {
+            break;
+        }
+        map->table[i] = map->table[next];
+        i = next;
+    }
+
+    map->table[i].key   = NULL;
+    map->table[i].value = NULL;
+    map->table[i].hash  = 0;
+
+    map->count--;
+}
+
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
-    wmem_map_item_t **item;
+    wmem_map_item_t *item;
+    guint32 hash;
     void *old_val;
 
     /* Make sure we have a table */
@@ -194,60 +316,55 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
         wmem_map_init_table(map);
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
+    hash = HASH(map, key);
 
-    /* check existing items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* replace and return old value for this key */
-            old_val = (*item)->value;
-            (*item)->value = value;
-            return old_val;
-        }
-        item = &((*item)->next);
+    /* check for an existing item */
+    item = wmem_map_find(map, key, hash);
+    if (item) {
+        /* replace and return old value for this key */
+        old_val = item->value;
+        item->value = value;
+        return old_val;
     }
 
-    /* insert new item */
-    (*item) = wmem_new(map->allocator, wmem_map_item_t);
-
-    (*item)->key   = key;
-    (*item)->value = value;
-    (*item)->next  = NULL;
-
-    map->count++;
-
     /* increase size if we are over-full */
-    if (map->count >= CAPACITY(map)) {
-        wmem_map_grow(map);
+    if (map->count >= MAX_LOAD(map)) {
+        wmem_map_resize(map, map->capacity + 1);
     }
 
+    /* insert new item */
+    wmem_map_place(map, hash, key, value);
+    map->count++;
+
     /* no previous entry, return NULL */
     return NULL;
 }
 
+void
+wmem_map_reserve(wmem_map_t *map, guint size)
+{
+    size_t capacity;
+
+    map->size_hint = size;
+
+    /* Otherwise the table is created with the right size when first needed */
+    if (map->table != NULL) {
+        capacity = wmem_map_capacity_for(size);
+        if (capacity > map->capacity) {
+            wmem_map_resize(map, capacity);
+        }
+    }
+}
+
 gboolean
 wmem_map_contains(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t *item;
-
     /* Make sure we have a table */
     if (map->table == NULL) {
         return FALSE;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return TRUE;
-        }
-        item = item->next;
-    }
-
-    return FALSE;
+    return wmem_map_find(map, key, HASH(map, key)) != NULL;
 }
 
 void *
@@ -260,18 +377,9 @@ wmem_map_lookup(wmem_map_t *map, const void *key)
         return NULL;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
+    item = wmem_map_find(map, key, HASH(map, key));
 
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return item->value;
-        }
-        item = item->next;
-    }
-
-    return NULL;
+    return item ? item->value : NULL;
 }
 
 gboolean
@@ -284,30 +392,24 @@ wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key
         return FALSE;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            if (orig_key) {
-                *orig_key = item->key;
-            }
-            if (value) {
-                *value = item->value;
-            }
-            return TRUE;
-        }
-        item = item->next;
+    item = wmem_map_find(map, key, HASH(map, key));
+    if (item == NULL) {
+        return FALSE;
     }
 
-    return FALSE;
+    if (orig_key) {
+        *orig_key = item->key;
+    }
+    if (value) {
+        *value = item->value;
+    }
+    return TRUE;
 }
 
 void *
 wmem_map_remove(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
+    wmem_map_item_t *item;
     void *value;
 
     /* Make sure we have a table */
@@ -315,61 +417,41 @@ wmem_map_remove(wmem_map_t *map, const void *key)
         return NULL;
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            value   = tmp->value;
-            (*item) = tmp->next;
-            wmem_free(map->allocator, tmp);
-            map->count--;
-            return value;
-        }
-        item = &((*item)->next);
+    item = wmem_map_find(map, key, HASH(map, key));
+    if (item == NULL) {
+        /* didn't find it */
+        return NULL;
     }
 
-    /* didn't find it */
-    return NULL;
+    value = item->value;
+    wmem_map_delete_item(map, item);
+    return value;
 }
 
 gboolean
 wmem_map_steal(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
+    wmem_map_item_t *item;
 
     /* Make sure we have a table */
     if (map->table == NULL) {
         return FALSE;
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            (*item) = tmp->next;
-            map->count--;
-            return TRUE;
-        }
-        item = &((*item)->next);
+    item = wmem_map_find(map, key, HASH(map, key));
+    if (item == NULL) {
+        /* didn't find it */
+        return FALSE;
     }
 
-    /* didn't find it */
-    return FALSE;
+    wmem_map_delete_item(map, item);
+    return TRUE;
 }
 
 wmem_list_t*
 wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 {
     size_t capacity, i;
-    wmem_map_item_t *cur;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
     if (map->table != NULL) {
@@ -377,10 +459,8 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 
         /* copy all the elements into the list over from table */
         for (i=0; i<capacity; i++) {
-            cur = map->table[i];
-            while (cur) {
-                wmem_list_prepend(list, (void*)cur->key);
-                cur = cur->next;
+            if (map->table[i].hash != 0) {
+                wmem_list_prepend(list, (void*)map->table[i].key);
             }
         }
     }
@@ -392,7 +472,7 @@ void
 wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
 {
     wmem_map_item_t *cur;
-    unsigned i;
+    size_t i;
 
     /* Make sure we have a table */
     if (map->table == NULL) {
@@ -400,10 +480,9 @@ wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
     }
 
     for (i = 0; i < CAPACITY(map); i++) {
-        cur = map->table[i];
-        while (cur) {
+        cur = &map->table[i];
+        if (cur->hash != 0) {
             foreach_func((gpointer)cur->key, (gpointer)cur->value, user_data);
-            cur = cur->next;
         }
     }
 }
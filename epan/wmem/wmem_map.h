@@ -26,9 +26,9 @@ extern "C" {
  *
  *    A hash map implementation on top of wmem. Provides insertion, deletion and
  *    lookup in expected amortized constant time. Uses universal hashing to map
- *    keys into buckets, and provides a generic strong hash function that makes
- *    it secure against algorithmic complexity attacks, and suitable for use
- *    even with untrusted data.
+ *    keys into an open-addressed table, and provides a generic strong hash
+ *    function that makes it secure against algorithmic complexity attacks, and
+ *    suitable for use even with untrusted data.
  *
  *    @{
  */
@@ -87,6 +87,18 @@ WS_DLL_PUBLIC
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value);
 
+/** Size the map for at least the given number of items, so that it doesn't
+ * have to grow while they are inserted. The hint is kept, and an autoreset
+ * map is created with that size again after each reset. It never shrinks
+ * the map.
+ *
+ * @param map The map to size.
+ * @param size The number of items expected.
+ */
+WS_DLL_PUBLIC
+void
+wmem_map_reserve(wmem_map_t *map, guint size);
+
 /** Check if a value is in the map.
  *
  * @param map The map to search in.
@@ -70,6 +70,12 @@ wmem_leave_packet_scope(void)
     packet_scope->in_scope = FALSE;
 }
 
+gboolean
+wmem_in_packet_scope(void)
+{
+    return packet_scope != NULL && packet_scope->in_scope;
+}
+
 /* File Scope */
 
 wmem_allocator_t *
@@ -38,6 +38,11 @@ WS_DLL_LOCAL
 void
 wmem_leave_packet_scope(void);
 
+/* TRUE between wmem_enter_packet_scope() and wmem_leave_packet_scope() */
+WS_DLL_LOCAL
+gboolean
+wmem_in_packet_scope(void);
+
 /* File Scope */
 
 WS_DLL_PUBLIC
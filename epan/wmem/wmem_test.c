@@ -968,10 +968,153 @@ wmem_test_map(void)
     }
     g_assert(wmem_map_size(map) == CONTAINER_ITERS);
 
+    /* test reserve, before and after the table exists */
+    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    g_assert(map);
+    wmem_map_reserve(map, CONTAINER_ITERS / 2);
+    for (i=0; i<CONTAINER_ITERS / 2; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    wmem_map_reserve(map, CONTAINER_ITERS * 4);
+    for (i=CONTAINER_ITERS / 2; i<CONTAINER_ITERS; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    g_assert(wmem_map_size(map) == CONTAINER_ITERS);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(wmem_map_lookup(map, GINT_TO_POINTER(i)) == GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS; i+=2) {
+        g_assert(wmem_map_remove(map, GINT_TO_POINTER(i)) == GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(wmem_map_contains(map, GINT_TO_POINTER(i)) == (i % 2 == 1));
+    }
+    g_assert(wmem_map_size(map) == CONTAINER_ITERS / 2);
+
     wmem_destroy_allocator(extra_allocator);
     wmem_destroy_allocator(allocator);
 }
 
+static void
+count_map_items(gpointer key _U_, gpointer val _U_, gpointer user_data)
+{
+    (*(guint *)user_data)++;
+}
+
+/* NOTE: You have to run "wmem_test --verbose" to see results. */
+static void
+wmem_test_mapperf(void)
+{
+#define MAP_PERF_ITEMS (1 * 1000 * 1000)
+    wmem_allocator_t   *allocator;
+    wmem_map_t         *map;
+    GHashTable         *table;
+    guint               i, count, pass;
+    gboolean            sized;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+    /* Keys are spread out like the addresses of allocated structures. The
+     * second pass pre-sizes the map. */
+    for (pass = 0; pass < 2; pass++) {
+        sized = (pass == 1);
+        map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+        if (sized) {
+            wmem_map_reserve(map, MAP_PERF_ITEMS);
+        }
+
+        RESOURCE_USAGE_START;
+        for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+            wmem_map_insert(map, GUINT_TO_POINTER(i * 48), GUINT_TO_POINTER(i));
+        }
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "wmem_map_insert%s: u %.3f ms s %.3f ms", sized ? " (reserved)" : "", utime_ms, stime_ms);
+
+        RESOURCE_USAGE_START;
+        for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+            wmem_map_lookup(map, GUINT_TO_POINTER(i * 48));
+        }
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "wmem_map_lookup hits%s: u %.3f ms s %.3f ms", sized ? " (reserved)" : "", utime_ms, stime_ms);
+
+        RESOURCE_USAGE_START;
+        for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+            wmem_map_lookup(map, GUINT_TO_POINTER(i * 48 + 1));
+        }
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "wmem_map_lookup misses%s: u %.3f ms s %.3f ms", sized ? " (reserved)" : "", utime_ms, stime_ms);
+
+        count = 0;
+        RESOURCE_USAGE_START;
+        wmem_map_foreach(map, count_map_items, &count);
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "wmem_map_foreach%s: u %.3f ms s %.3f ms", sized ? " (reserved)" : "", utime_ms, stime_ms);
+        g_assert(count == MAP_PERF_ITEMS);
+
+        RESOURCE_USAGE_START;
+        for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+            wmem_map_remove(map, GUINT_TO_POINTER(i * 48));
+        }
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "wmem_map_remove%s: u %.3f ms s %.3f ms", sized ? " (reserved)" : "", utime_ms, stime_ms);
+        g_assert(wmem_map_size(map) == 0);
+
+        wmem_free_all(allocator);
+    }
+
+    /* The same operations on a GHashTable, for reference. */
+    table = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        g_hash_table_insert(table, GUINT_TO_POINTER(i * 48), GUINT_TO_POINTER(i));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_insert: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        g_hash_table_lookup(table, GUINT_TO_POINTER(i * 48));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_lookup hits: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        g_hash_table_lookup(table, GUINT_TO_POINTER(i * 48 + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_lookup misses: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    count = 0;
+    RESOURCE_USAGE_START;
+    g_hash_table_foreach(table, count_map_items, &count);
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_foreach: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+    g_assert(count == MAP_PERF_ITEMS);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        g_hash_table_remove(table, GUINT_TO_POINTER(i * 48));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_remove: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    g_hash_table_destroy(table);
+    wmem_destroy_allocator(allocator);
+}
+
 static void
 wmem_test_queue(void)
 {
@@ -1407,6 +1550,7 @@ main(int argc, char **argv)
 
     if (!g_test_perf ()) {
         g_test_add_func("/wmem/utils/stringperf", wmem_test_stringperf);
+        g_test_add_func("/wmem/datastruct/mapperf", wmem_test_mapperf);
     }
 
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
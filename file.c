@@ -24,6 +24,7 @@
 #include <version_info.h>
 
 #include <wiretap/merge.h>
+#include <wiretap/frame_index.h>
 
 #include <epan/exceptions.h>
 #include <epan/epan.h>
@@ -76,7 +77,11 @@ gboolean auto_scroll_live; /* GTK+ only? */
 #endif
 
 static gboolean read_record(capture_file *cf, dfilter_t *dfcode,
-    epan_dissect_t *edt, column_info *cinfo, gint64 offset);
+    epan_dissect_t *edt, column_info *cinfo, gint64 offset,
+    wtap_rec *rec, const guint8 *buf);
+static gboolean read_indexed_record(capture_file *cf,
+    wtap_frame_index *frame_index, guint32 *index_pos, wtap_rec *rec,
+    Buffer *buf, int *err, gchar **err_info, gint64 *data_offset);
 
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
 
@@ -507,6 +512,11 @@ cf_read(capture_file *cf, gboolean reloading)
   guint                tap_flags;
   gboolean             compiled;
   volatile gboolean    is_read_aborted = FALSE;
+  wtap_frame_index    *frame_index = NULL;
+  wtap_frame_index    *new_frame_index = NULL;
+  guint32              index_pos = 0;
+  wtap_rec             index_rec;
+  Buffer               index_buf;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -537,6 +547,23 @@ cf_read(capture_file *cf, gboolean reloading)
 
   reset_tap_listeners();
 
+  /*
+   * If we've been asked to, and the first pass doesn't need protocol
+   * trees, see whether there's a saved index of the file we can read the
+   * records from instead of reading through it; if there isn't, see
+   * whether we can save one as we read through it.
+   *
+   * The records in the index still get dissected, in order, as stateful
+   * dissectors have to see them in order on the first pass.
+   */
+  if (prefs.gui_frame_index && !cf->is_tempfile) {
+    if (!create_proto_tree && cf->rfcode == NULL &&
+        !tap_listeners_require_dissection())
+      frame_index = wtap_frame_index_load(cf->provider.wth, cf->filename);
+    if (frame_index == NULL)
+      new_frame_index = wtap_frame_index_new(cf->provider.wth);
+  }
+
   name_ptr = g_filename_display_basename(cf->filename);
 
   if (reloading)
@@ -546,7 +573,7 @@ cf_read(capture_file *cf, gboolean reloading)
 
   /* Record whether the file is compressed.
      XXX - do we know this at open time? */
-  cf->iscompressed = wtap_iscompressed(cf->provider.wth);
+  cf->compression_type = wtap_get_compression_type(cf->provider.wth);
 
   /* The packet list window will be empty until the file is completly loaded */
   packet_list_freeze();
@@ -555,6 +582,8 @@ cf_read(capture_file *cf, gboolean reloading)
   g_get_current_time(&start_time);
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
+  wtap_rec_init(&index_rec);
+  ws_buffer_init(&index_buf, 1500);
 
   TRY {
     int     count             = 0;
@@ -576,10 +605,20 @@ cf_read(capture_file *cf, gboolean reloading)
 
     g_timer_start(prog_timer);
 
-    while ((wtap_read(cf->provider.wth, &err, &err_info, &data_offset))) {
+    /* Decode records on other threads while we dissect them. */
+    if (frame_index == NULL)
+      wtap_start_read_pipeline(cf->provider.wth, 0);
+
+    while (frame_index != NULL ?
+           read_indexed_record(cf, frame_index, &index_pos, &index_rec,
+                               &index_buf, &err, &err_info, &data_offset) :
+           wtap_read(cf->provider.wth, &err, &err_info, &data_offset)) {
       if (size >= 0) {
         count++;
-        file_pos = wtap_read_so_far(cf->provider.wth);
+        if (frame_index != NULL)
+          file_pos = data_offset;
+        else
+          file_pos = wtap_read_so_far(cf->provider.wth);
 
         /* Create the progress bar if necessary. */
         if (progress_is_slow(progbar, prog_timer, size, file_pos)) {
@@ -625,7 +664,15 @@ cf_read(capture_file *cf, gboolean reloading)
            hours even on fast machines) just to see that it was the wrong file. */
         break;
       }
-      read_record(cf, dfcode, &edt, cinfo, data_offset);
+      if (new_frame_index != NULL)
+        wtap_frame_index_add(new_frame_index, cf->provider.wth, data_offset);
+      if (frame_index != NULL)
+        read_record(cf, dfcode, &edt, cinfo, data_offset, &index_rec,
+                    ws_buffer_start_ptr(&index_buf));
+      else
+        read_record(cf, dfcode, &edt, cinfo, data_offset,
+                    wtap_get_rec(cf->provider.wth),
+                    wtap_get_buf_ptr(cf->provider.wth));
     }
   }
   CATCH(OutOfMemoryError) {
@@ -649,6 +696,8 @@ cf_read(capture_file *cf, gboolean reloading)
   dfilter_free(dfcode);
 
   epan_dissect_cleanup(&edt);
+  wtap_rec_cleanup(&index_rec);
+  ws_buffer_free(&index_buf);
 
   /* We're done reading the file; destroy the progress bar if it was created. */
   if (progbar != NULL)
@@ -658,6 +707,19 @@ cf_read(capture_file *cf, gboolean reloading)
   /* We're done reading sequentially through the file. */
   cf->state = FILE_READ_DONE;
 
+  if (new_frame_index != NULL) {
+    /* If we read the whole file, save the index of it. */
+    if (err == 0 && !cf->stop_flag && !is_read_aborted) {
+      int index_err;
+
+      wtap_frame_index_save(new_frame_index, cf->provider.wth, cf->filename,
+                            &index_err);
+    }
+    wtap_frame_index_free(new_frame_index);
+  }
+  if (frame_index != NULL)
+    wtap_frame_index_free(frame_index);
+
   /* Close the sequential I/O side, to free up memory it requires. */
   wtap_sequential_close(cf->provider.wth);
 
@@ -786,7 +848,9 @@ cf_continue_tail(capture_file *cf, volatile int to_read, int *err)
            aren't any packets left to read) exit. */
         break;
       }
-      if (read_record(cf, dfcode, &edt, (column_info *) cinfo, data_offset)) {
+      if (read_record(cf, dfcode, &edt, (column_info *) cinfo, data_offset,
+                      wtap_get_rec(cf->provider.wth),
+                      wtap_get_buf_ptr(cf->provider.wth))) {
         newly_displayed_packets++;
       }
       to_read--;
@@ -920,7 +984,9 @@ cf_finish_tail(capture_file *cf, int *err)
          aren't any packets left to read) exit. */
       break;
     }
-    read_record(cf, dfcode, &edt, cinfo, data_offset);
+    read_record(cf, dfcode, &edt, cinfo, data_offset,
+                wtap_get_rec(cf->provider.wth),
+                wtap_get_buf_ptr(cf->provider.wth));
   }
 
   /* Cleanup and release all dfilter resources */
@@ -1154,10 +1220,9 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
  */
 static gboolean
 read_record(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
-            column_info *cinfo, gint64 offset)
+            column_info *cinfo, gint64 offset, wtap_rec *rec,
+            const guint8 *buf)
 {
-  wtap_rec     *rec = wtap_get_rec(cf->provider.wth);
-  const guint8 *buf = wtap_get_buf_ptr(cf->provider.wth);
   frame_data    fdlocal;
   frame_data   *fdata;
   gboolean      passed = TRUE;
@@ -1209,6 +1274,27 @@ read_record(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
   return added;
 }
 
+/*
+ * Read the next record in a saved index of the file, in place of
+ * wtap_read(), from the offset the index has for it.
+ */
+static gboolean
+read_indexed_record(capture_file *cf, wtap_frame_index *frame_index,
+                    guint32 *index_pos, wtap_rec *rec, Buffer *buf,
+                    int *err, gchar **err_info, gint64 *data_offset)
+{
+  wtap_rec  index_rec;
+  gboolean  has_comment;
+
+  *err = 0;
+  if (!wtap_frame_index_get(frame_index, *index_pos, &index_rec, data_offset,
+                            &has_comment))
+    return FALSE;
+  (*index_pos)++;
+
+  return wtap_seek_read(cf->provider.wth, *data_offset, rec, buf, err, err_info);
+}
+
 
 typedef struct _callback_data_t {
   gpointer         pd_window;
@@ -1940,8 +2026,13 @@ typedef enum {
   PSP_FAILED
 } psp_return_t;
 
+/*
+ * Call callback for each record in range, or for each of the num_frames
+ * records in frames if it's non-NULL.
+ */
 static psp_return_t
 process_specified_records(capture_file *cf, packet_range_t *range,
+    const guint32 *frames, guint32 num_frames,
     const char *string1, const char *string2, gboolean terminate_is_stop,
     gboolean (*callback)(capture_file *, frame_data *,
                          wtap_rec *, const guint8 *, void *),
@@ -1949,6 +2040,8 @@ process_specified_records(capture_file *cf, packet_range_t *range,
     gboolean show_progress_bar)
 {
   guint32          framenum;
+  guint32          num_records;
+  guint32          i;
   frame_data      *fdata;
   Buffer           buf;
   psp_return_t     ret     = PSP_FINISHED;
@@ -1977,9 +2070,14 @@ process_specified_records(capture_file *cf, packet_range_t *range,
   if (range != NULL)
     packet_range_process_init(range);
 
+  num_records = frames ? num_frames : cf->count;
+
   /* Iterate through all the packets, printing the packets that
      were selected by the current display filter.  */
-  for (framenum = 1; framenum <= cf->count; framenum++) {
+  for (i = 0; i < num_records; i++) {
+    framenum = frames ? frames[i] : i + 1;
+    if (framenum > cf->count)
+      break;
     fdata = frame_data_sequence_find(cf->provider.frames, framenum);
 
     /* Create the progress bar if necessary.
@@ -2004,11 +2102,11 @@ process_specified_records(capture_file *cf, packet_range_t *range,
       /* let's not divide by zero. I should never be started
        * with count == 0, so let's assert that
        */
-      g_assert(cf->count > 0);
-      progbar_val = (gfloat) progbar_count / cf->count;
+      g_assert(num_records > 0);
+      progbar_val = (gfloat) progbar_count / num_records;
 
       g_snprintf(progbar_status_str, sizeof(progbar_status_str),
-                  "%4u of %u packets", progbar_count, cf->count);
+                  "%4u of %u packets", progbar_count, num_records);
       update_progress_dlg(progbar, progbar_val, progbar_status_str);
 
       g_timer_start(prog_timer);
@@ -2081,8 +2179,8 @@ retap_packet(capture_file *cf, frame_data *fdata, wtap_rec *rec,
   return TRUE;
 }
 
-cf_read_status_t
-cf_retap_packets(capture_file *cf)
+static cf_read_status_t
+retap_records(capture_file *cf, const guint32 *frames, guint32 num_frames)
 {
   packet_range_t        range;
   retap_callback_args_t callback_args;
@@ -2124,9 +2222,10 @@ cf_retap_packets(capture_file *cf)
   packet_range_init(&range, cf);
   packet_range_process_init(&range);
 
-  ret = process_specified_records(cf, &range, "Recalculating statistics on",
-                                  "all packets", TRUE, retap_packet,
-                                  &callback_args, TRUE);
+  ret = process_specified_records(cf, frames ? NULL : &range, frames, num_frames,
+                                  "Recalculating statistics on",
+                                  frames ? "selected packets" : "all packets",
+                                  TRUE, retap_packet, &callback_args, TRUE);
 
   epan_dissect_cleanup(&callback_args.edt);
 
@@ -2151,6 +2250,24 @@ cf_retap_packets(capture_file *cf)
   return CF_READ_OK;
 }
 
+cf_read_status_t
+cf_retap_packets(capture_file *cf)
+{
+  return retap_records(cf, NULL, 0);
+}
+
+cf_read_status_t
+cf_retap_frames(capture_file *cf, void *tapdata, const guint32 *frames,
+                guint32 num_frames)
+{
+  cf_read_status_t ret;
+
+  set_tap_listener_exclusive(tapdata);
+  ret = retap_records(cf, frames, num_frames);
+  set_tap_listener_exclusive(NULL);
+  return ret;
+}
+
 typedef struct {
   print_args_t *print_args;
   gboolean      print_header_line;
@@ -2452,7 +2569,7 @@ cf_print_packets(capture_file *cf, print_args_t *print_args,
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range, "Printing",
+  ret = process_specified_records(cf, &print_args->range, NULL, 0, "Printing",
                                   "selected packets", TRUE, print_packet,
                                   &callback_args, show_progress_bar);
   epan_dissect_cleanup(&callback_args.edt);
@@ -2545,7 +2662,7 @@ cf_write_pdml_packets(capture_file *cf, print_args_t *print_args)
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range, "Writing PDML",
+  ret = process_specified_records(cf, &print_args->range, NULL, 0, "Writing PDML",
                                   "selected packets", TRUE,
                                   write_pdml_packet, &callback_args, TRUE);
 
@@ -2629,7 +2746,7 @@ cf_write_psml_packets(capture_file *cf, print_args_t *print_args)
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range, "Writing PSML",
+  ret = process_specified_records(cf, &print_args->range, NULL, 0, "Writing PSML",
                                   "selected packets", TRUE,
                                   write_psml_packet, &callback_args, TRUE);
 
@@ -2711,7 +2828,7 @@ cf_write_csv_packets(capture_file *cf, print_args_t *print_args)
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range, "Writing CSV",
+  ret = process_specified_records(cf, &print_args->range, NULL, 0, "Writing CSV",
                                   "selected packets", TRUE,
                                   write_csv_packet, &callback_args, TRUE);
 
@@ -2776,7 +2893,7 @@ cf_write_carrays_packets(capture_file *cf, print_args_t *print_args)
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range,
+  ret = process_specified_records(cf, &print_args->range, NULL, 0,
                                   "Writing C Arrays",
                                   "selected packets", TRUE,
                                   carrays_write_packet, &callback_args, TRUE);
@@ -2843,7 +2960,7 @@ cf_write_json_packets(capture_file *cf, print_args_t *print_args)
 
   /* Iterate through the list of packets, printing the packets we were
      told to print. */
-  ret = process_specified_records(cf, &print_args->range, "Writing PDML",
+  ret = process_specified_records(cf, &print_args->range, NULL, 0, "Writing PDML",
                                   "selected packets", TRUE,
                                   write_json_packet, &callback_args, TRUE);
 
@@ -4196,7 +4313,7 @@ rescan_file(capture_file *cf, const char *fname, gboolean is_tempfile)
 
   /* Record whether the file is compressed.
      XXX - do we know this at open time? */
-  cf->iscompressed = wtap_iscompressed(cf->provider.wth);
+  cf->compression_type = wtap_get_compression_type(cf->provider.wth);
 
   /* Find the size of the file. */
   size = wtap_file_size(cf->provider.wth, NULL);
@@ -4299,7 +4416,7 @@ rescan_file(capture_file *cf, const char *fname, gboolean is_tempfile)
 
 cf_write_status_t
 cf_save_records(capture_file *cf, const char *fname, guint save_format,
-                gboolean compressed, gboolean discard_comments,
+                wtap_compression_type compression_type, gboolean discard_comments,
                 gboolean dont_reopen)
 {
   gchar           *err_info;
@@ -4324,7 +4441,7 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
 
   addr_lists = get_addrinfo_list();
 
-  if (save_format == cf->cd_t && compressed == cf->iscompressed
+  if (save_format == cf->cd_t && compression_type == cf->compression_type
       && !discard_comments && !cf->unsaved_changes
       && (wtap_addrinfo_list_empty(addr_lists) || !wtap_dump_has_name_resolution(save_format))) {
     /* We're saving in the format it's already in, and we're not discarding
@@ -4431,10 +4548,12 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
          from which we're reading the packets that we're writing!) */
       fname_new = g_strdup_printf("%s~", fname);
       pdh = wtap_dump_open_ng(fname_new, save_format, encap, cf->snap,
-                              compressed, shb_hdrs, idb_inf, nrb_hdrs, &err);
+                              compression_type,
+                              shb_hdrs, idb_inf, nrb_hdrs, &err);
     } else {
       pdh = wtap_dump_open_ng(fname, save_format, encap, cf->snap,
-                              compressed, shb_hdrs, idb_inf, nrb_hdrs, &err);
+                              compression_type,
+                              shb_hdrs, idb_inf, nrb_hdrs, &err);
     }
     g_free(idb_inf);
     idb_inf = NULL;
@@ -4451,7 +4570,7 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
     callback_args.pdh = pdh;
     callback_args.fname = fname;
     callback_args.file_type = save_format;
-    switch (process_specified_records(cf, NULL, "Saving", "packets",
+    switch (process_specified_records(cf, NULL, NULL, 0, "Saving", "packets",
                                       TRUE, save_record, &callback_args, TRUE)) {
 
     case PSP_FINISHED:
@@ -4652,7 +4771,7 @@ fail:
 cf_write_status_t
 cf_export_specified_packets(capture_file *cf, const char *fname,
                             packet_range_t *range, guint save_format,
-                            gboolean compressed)
+                            wtap_compression_type compression_type)
 {
   gchar                       *fname_new = NULL;
   int                          err;
@@ -4690,10 +4809,12 @@ cf_export_specified_packets(capture_file *cf, const char *fname,
        from which we're reading the packets that we're writing!) */
     fname_new = g_strdup_printf("%s~", fname);
     pdh = wtap_dump_open_ng(fname_new, save_format, encap, cf->snap,
-                            compressed, shb_hdrs, idb_inf, nrb_hdrs, &err);
+                            compression_type,
+                            shb_hdrs, idb_inf, nrb_hdrs, &err);
   } else {
     pdh = wtap_dump_open_ng(fname, save_format, encap, cf->snap,
-                            compressed, shb_hdrs, idb_inf, nrb_hdrs, &err);
+                            compression_type,
+                            shb_hdrs, idb_inf, nrb_hdrs, &err);
   }
   g_free(idb_inf);
   idb_inf = NULL;
@@ -4716,7 +4837,7 @@ cf_export_specified_packets(capture_file *cf, const char *fname,
   callback_args.pdh = pdh;
   callback_args.fname = fname;
   callback_args.file_type = save_format;
-  switch (process_specified_records(cf, range, "Writing", "specified records",
+  switch (process_specified_records(cf, range, NULL, 0, "Writing", "specified records",
                                     TRUE, save_record, &callback_args, TRUE)) {
 
   case PSP_FINISHED:
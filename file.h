@@ -241,7 +241,7 @@ gboolean cf_has_unsaved_data(capture_file *cf);
  * @param cf the capture file to save to
  * @param fname the filename to save to
  * @param save_format the format of the file to save (libpcap, ...)
- * @param compressed whether to gzip compress the file
+ * @param compression_type type of compression to use, or WTAP_UNCOMPRESSED
  * @param discard_comments TRUE if we should discard comments if the save
  * succeeds (because we saved in a format that doesn't support
  * comments)
@@ -250,7 +250,8 @@ gboolean cf_has_unsaved_data(capture_file *cf);
  * @return one of cf_write_status_t
  */
 cf_write_status_t cf_save_records(capture_file * cf, const char *fname,
-                                  guint save_format, gboolean compressed,
+                                  guint save_format,
+                                  wtap_compression_type compression_type,
                                   gboolean discard_comments,
                                   gboolean dont_reopen);
 
@@ -265,14 +266,14 @@ cf_write_status_t cf_save_records(capture_file * cf, const char *fname,
  * @param fname the filename to write to
  * @param range the range of packets to write
  * @param save_format the format of the file to write (libpcap, ...)
- * @param compressed whether to gzip compress the file
+ * @param compression_type type of compression to use, or WTAP_UNCOMPRESSED
  * @return one of cf_write_status_t
  */
 cf_write_status_t cf_export_specified_packets(capture_file *cf,
                                               const char *fname,
                                               packet_range_t *range,
                                               guint save_format,
-                                              gboolean compressed);
+                                              wtap_compression_type compression_type);
 
 /**
  * Get a displayable name of the capture file.
@@ -398,6 +399,20 @@ void cf_redissect_packets(capture_file *cf);
  */
 cf_read_status_t cf_retap_packets(capture_file *cf);
 
+/**
+ * Run only the frames in a list, and only through one tap listener.
+ * The other tap listeners are neither reset nor passed any packets, so
+ * they keep what they got from the last full retap.
+ *
+ * @param cf the capture file
+ * @param tapdata the tapdata the tap listener was registered with
+ * @param frames the frame numbers, in increasing order
+ * @param num_frames the number of frames
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_retap_frames(capture_file *cf, void *tapdata,
+                                 const guint32 *frames, guint32 num_frames);
+
 /**
  * Adjust timestamp precision if auto is selected.
  *
@@ -53,6 +53,8 @@
 
 #include "ui/failure_message.h"
 
+#define LONGOPT_READ_AHEAD (65536+1000)
+
 /*
  * Show the usage
  */
@@ -71,6 +73,9 @@ print_usage(FILE *output)
   fprintf(output, "                    an empty \"-F\" option will list the file types.\n");
   fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
   fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
+  fprintf(output, "  --read-ahead <records>\n");
+  fprintf(output, "                    read up to <records> records at a time from each input\n");
+  fprintf(output, "                    file; speeds up merging a large number of files.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
@@ -236,6 +241,7 @@ main(int argc, char *argv[])
   static const struct option long_options[] = {
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'V'},
+      {"read-ahead", required_argument, NULL, LONGOPT_READ_AHEAD},
       {0, 0, 0, 0 }
   };
   gboolean            do_append          = FALSE;
@@ -361,6 +367,10 @@ main(int argc, char *argv[])
       out_filename = optarg;
       break;
 
+    case LONGOPT_READ_AHEAD:
+      merge_set_read_ahead(get_guint32(optarg, "read-ahead record count"));
+      break;
+
     case '?':              /* Bad options if GNU getopt */
       switch(optopt) {
       case'F':
@@ -419,6 +429,7 @@ main(int argc, char *argv[])
   } else {
     /* merge the files to the outfile */
     status = merge_files(out_filename, file_type,
+                         wtap_name_to_compression_type(out_filename),
                          (const char *const *) &argv[optind], in_file_count,
                          do_append, mode, snaplen, "mergecap", verbose ? &cb : NULL,
                          &err, &err_info, &err_fileno, &err_framenum);
@@ -33,6 +33,7 @@
 #include <version_info.h>
 #include <wiretap/wtap_opttypes.h>
 #include <wiretap/pcapng.h>
+#include <wiretap/frame_index.h>
 
 #include <epan/decode_as.h>
 #include <epan/timestamp.h>
@@ -321,14 +322,39 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
   return passed;
 }
 
+/*
+ * Read the next record in a saved frame index, in place of wtap_read(),
+ * from the offset the index has for it.
+ */
+static gboolean
+read_indexed_record(capture_file *cf, wtap_frame_index *frame_index,
+                    guint32 *index_pos, wtap_rec *rec, Buffer *buf,
+                    int *err, gchar **err_info, gint64 *data_offset)
+{
+  wtap_rec       index_rec;
+  gboolean       has_comment;
+
+  *err = 0;
+  if (!wtap_frame_index_get(frame_index, *index_pos, &index_rec, data_offset,
+                            &has_comment))
+    return FALSE;
+  (*index_pos)++;
+
+  return wtap_seek_read(cf->provider.wth, *data_offset, rec, buf, err, err_info);
+}
 
 static int
 load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 {
-  int          err;
+  int          err = 0;
   gchar       *err_info = NULL;
   gint64       data_offset;
   epan_dissect_t *edt = NULL;
+  wtap_frame_index *frame_index = NULL;
+  wtap_frame_index *new_frame_index = NULL;
+  guint32      index_pos = 0;
+  wtap_rec     index_rec;
+  Buffer       index_buf;
 
   {
     /* Allocate a frame_data_sequence for all the frames. */
@@ -354,11 +380,45 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
       /* We're not going to display the protocol tree on this pass,
          so it's not going to be "visible". */
       edt = epan_dissect_new(cf->epan, create_proto_tree, FALSE);
+
+      /*
+       * If we're reading the whole file, read the records through a
+       * saved frame index if there is one and this pass doesn't need
+       * protocol trees, and otherwise build one as we read.  The records
+       * are dissected in order either way, as stateful dissectors have
+       * to see them in order on this pass.
+       */
+      if (prefs.gui_frame_index && !cf->is_tempfile &&
+          max_packet_count == 0 && max_byte_count == 0) {
+        if (!create_proto_tree)
+          frame_index = wtap_frame_index_load(cf->provider.wth, cf->filename);
+        if (frame_index == NULL)
+          new_frame_index = wtap_frame_index_new(cf->provider.wth);
+      }
     }
 
-    while (wtap_read(cf->provider.wth, &err, &err_info, &data_offset)) {
-      if (process_packet(cf, edt, data_offset, wtap_get_rec(cf->provider.wth),
-                         wtap_get_buf_ptr(cf->provider.wth))) {
+    wtap_rec_init(&index_rec);
+    ws_buffer_init(&index_buf, 1500);
+    if (frame_index == NULL)
+      wtap_start_read_pipeline(cf->provider.wth, 0);
+
+    while (frame_index != NULL ?
+           read_indexed_record(cf, frame_index, &index_pos, &index_rec,
+                               &index_buf, &err, &err_info, &data_offset) :
+           wtap_read(cf->provider.wth, &err, &err_info, &data_offset)) {
+      wtap_rec *rec;
+      const guint8 *pd;
+
+      if (frame_index != NULL) {
+        rec = &index_rec;
+        pd = ws_buffer_start_ptr(&index_buf);
+      } else {
+        rec = wtap_get_rec(cf->provider.wth);
+        pd = wtap_get_buf_ptr(cf->provider.wth);
+      }
+      if (new_frame_index != NULL)
+        wtap_frame_index_add(new_frame_index, cf->provider.wth, data_offset);
+      if (process_packet(cf, edt, data_offset, rec, pd)) {
         /* Stop reading if we have the maximum number of packets;
          * When the -c option has not been used, max_packet_count
          * starts at 0, which practically means, never stop reading.
@@ -371,6 +431,19 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
       }
     }
 
+    if (new_frame_index != NULL) {
+      int index_err;
+
+      /* Failing to save the index isn't an error reading the file. */
+      if (err == 0)
+        wtap_frame_index_save(new_frame_index, cf->provider.wth, cf->filename, &index_err);
+      wtap_frame_index_free(new_frame_index);
+    }
+    if (frame_index != NULL)
+      wtap_frame_index_free(frame_index);
+    wtap_rec_cleanup(&index_rec);
+    ws_buffer_free(&index_buf);
+
     if (edt) {
       epan_dissect_free(edt);
       edt = NULL;
@@ -694,8 +767,13 @@ sharkd_retap(void)
   return 0;
 }
 
+/*
+ * Find the frames that pass a display filter.  If candidates isn't NULL,
+ * only the frames in it are dissected, and the others are taken not to
+ * pass.
+ */
 int
-sharkd_filter(const char *dftext, guint8 **result)
+sharkd_filter(const char *dftext, const ws_bitmap *candidates, ws_bitmap **result)
 {
   dfilter_t  *dfcode = NULL;
 
@@ -706,8 +784,8 @@ sharkd_filter(const char *dftext, guint8 **result)
   int err;
   char *err_info = NULL;
 
-  guint8 *result_bits;
-  guint8  passed_bits;
+  ws_bitmap *passed;
+  ws_bitmap_iter iter;
 
   epan_dissect_t edt;
 
@@ -722,17 +800,20 @@ sharkd_filter(const char *dftext, guint8 **result)
   ws_buffer_init(&buf, 1500);
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
-  passed_bits = 0;
-  result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
+  passed = ws_bitmap_new();
+  if (candidates)
+    ws_bitmap_iter_init(&iter, candidates);
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
-    frame_data *fdata = sharkd_get_frame(framenum);
+    frame_data *fdata;
 
-    if ((framenum & 7) == 0) {
-      result_bits[(framenum / 8) - 1] = passed_bits;
-      passed_bits = 0;
+    if (candidates) {
+      if (!ws_bitmap_iter_next(&iter, &framenum) || framenum > frames_count)
+        break;
     }
 
+    fdata = sharkd_get_frame(framenum);
+
     if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
       break;
 
@@ -747,7 +828,7 @@ sharkd_filter(const char *dftext, guint8 **result)
                      fdata, NULL);
 
     if (dfilter_apply_edt(dfcode, &edt)) {
-      passed_bits |= (1 << (framenum % 8));
+      ws_bitmap_add(passed, framenum);
       prev_dis_num = framenum;
     }
 
@@ -756,17 +837,13 @@ sharkd_filter(const char *dftext, guint8 **result)
     epan_dissect_reset(&edt);
   }
 
-  if ((framenum & 7) == 0)
-      framenum--;
-  result_bits[framenum / 8] = passed_bits;
-
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
   dfilter_free(dfcode);
 
-  *result = result_bits;
+  *result = passed;
 
   return framenum;
 }
@@ -13,6 +13,12 @@
 #define __SHARKD_H
 
 #include <file.h>
+#include <wsutil/bitmap.h>
+
+#if !defined(_WIN32) && GLIB_CHECK_VERSION(2,32,0)
+/* One process can load a capture file and serve it to many sessions, each on its own thread */
+# define SHARKD_SHARED_SUPPORT
+#endif
 
 typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data);
 
@@ -20,7 +26,7 @@ typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, str
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *err);
 int sharkd_load_cap_file(void);
 int sharkd_retap(void);
-int sharkd_filter(const char *dftext, guint8 **result);
+int sharkd_filter(const char *dftext, const ws_bitmap *candidates, ws_bitmap **result);
 frame_data *sharkd_get_frame(guint32 framenum);
 int sharkd_dissect_columns(frame_data *fdata, guint32 frame_ref_num, guint32 prev_dis_num, column_info *cinfo, gboolean dissect_color);
 int sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num, guint32 prev_dis_num, sharkd_dissect_func_t cb, int dissect_bytes, int dissect_columns, int dissect_tree, void *data);
@@ -34,6 +40,10 @@ int sharkd_loop(void);
 
 /* sharkd_session.c */
 int sharkd_session_main(void);
+#ifdef SHARKD_SHARED_SUPPORT
+int sharkd_session_shared_load(const char *fname);
+void sharkd_session_shared_start(int fd);
+#endif
 
 #endif /* __SHARKD_H */
 
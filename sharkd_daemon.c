@@ -50,6 +50,9 @@
 
 static int _use_stdinout = 0;
 static socket_handle_t _server_fd = INVALID_SOCKET;
+#ifdef SHARKD_SHARED_SUPPORT
+static const char *_shared_file = NULL;
+#endif
 
 static socket_handle_t
 socket_init(char *path)
@@ -165,10 +168,27 @@ sharkd_init(int argc, char **argv)
 #endif
 	socket_handle_t fd;
 
+#ifdef SHARKD_SHARED_SUPPORT
+	if (argc == 3)
+	{
+		_shared_file = argv[2];
+		argc--;
+	}
+#endif
+
 	if (argc != 2)
 	{
+#ifdef SHARKD_SHARED_SUPPORT
+		fprintf(stderr, "Usage: %s <-|socket> [<capture file>]\n", argv[0]);
+		fprintf(stderr, "\n");
+
+		fprintf(stderr, "With a capture file, it's loaded once, and every connection is served\n");
+		fprintf(stderr, "from it on a thread of its own, rather than in a process of its own.\n");
+		fprintf(stderr, "\n");
+#else
 		fprintf(stderr, "Usage: %s <-|socket>\n", argv[0]);
 		fprintf(stderr, "\n");
+#endif
 
 		fprintf(stderr, "<socket> examples:\n");
 #ifdef SHARKD_UNIX_SUPPORT
@@ -185,6 +205,12 @@ sharkd_init(int argc, char **argv)
 	signal(SIGCHLD, SIG_IGN);
 #endif
 
+#ifdef SHARKD_SHARED_SUPPORT
+	/* A client going away mustn't take the other sessions with it. */
+	if (_shared_file)
+		signal(SIGPIPE, SIG_IGN);
+#endif
+
 	if (!strcmp(argv[1], "-"))
 	{
 		_use_stdinout = 1;
@@ -219,6 +245,19 @@ sharkd_init(int argc, char **argv)
 int
 sharkd_loop(void)
 {
+#ifdef SHARKD_SHARED_SUPPORT
+	if (_shared_file)
+	{
+		int err = sharkd_session_shared_load(_shared_file);
+
+		if (err != 0)
+		{
+			fprintf(stderr, "cannot load %s: error %d\n", _shared_file, err);
+			return 1;
+		}
+	}
+#endif
+
 	if (_use_stdinout)
 	{
 		return sharkd_session_main();
@@ -243,6 +282,15 @@ sharkd_loop(void)
 			continue;
 		}
 
+#ifdef SHARKD_SHARED_SUPPORT
+		if (_shared_file)
+		{
+			/* every session uses the same capture file, so it can be handled on a thread */
+			sharkd_session_shared_start(fd);
+			continue;
+		}
+#endif
+
 		/* wireshark is not ready for handling multiple capture files in single process, so fork(), and handle it in separate process */
 #ifndef _WIN32
 		pid = fork();
@@ -13,9 +13,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <glib.h>
 
 #include <wsutil/wsjsmn.h>
@@ -73,12 +78,127 @@
 
 #include "sharkd.h"
 
+/*
+ * Results of filters are kept in a cache of at most this many bytes,
+ * evicting the least recently used ones first.
+ */
+#define SHARKD_FILTER_CACHE_MAX (64 * 1024 * 1024)
+
 struct sharkd_filter_item
 {
-	guint8 *filtered;
+	char *filter;
+	ws_bitmap *filtered;
+	gsize size;
+	GList lru_link;
 };
 
 static GHashTable *filter_table = NULL;
+static GQueue filter_lru = G_QUEUE_INIT;
+static gsize filter_cache_size = 0;
+
+/*
+ * Replies are built up in a buffer, which is written out at the end of
+ * every reply, and whenever it reaches SHARKD_OUTPUT_CHUNK bytes, so
+ * that the client gets a big reply in pieces it can start on rather
+ * than all at once.  A session thread hands the pieces to a writer
+ * thread of its own instead of writing them itself, so that a slow
+ * client can't stall other sessions waiting for session_lock.
+ */
+#define SHARKD_OUTPUT_CHUNK (64 * 1024)
+
+struct sharkd_output
+{
+	FILE *fp;
+	GString *buf;
+	GAsyncQueue *chunks;	/* pieces for the writer thread, or NULL to write them ourselves */
+};
+
+static struct sharkd_output stdout_output;
+
+#ifdef SHARKD_SHARED_SUPPORT
+/*
+ * When sessions share a capture file, each runs on its own thread.
+ * Requests that only read the capture file hold session_lock for
+ * reading; anything else, including all dissection, which isn't
+ * thread-safe, holds it for writing.  filter_mtx also protects the
+ * filter cache, whose LRU list changes on every lookup.
+ */
+static GRWLock session_lock;
+static GMutex filter_mtx;
+static GPrivate session_out;
+static gboolean shared_capture = FALSE;
+#endif
+
+/* Where replies go; stdout, unless this is a session thread. */
+static struct sharkd_output *
+sharkd_session_out(void)
+{
+#ifdef SHARKD_SHARED_SUPPORT
+	struct sharkd_output *out = (struct sharkd_output *) g_private_get(&session_out);
+
+	if (out)
+		return out;
+#endif
+	if (!stdout_output.buf)
+	{
+		stdout_output.fp = stdout;
+		stdout_output.buf = g_string_sized_new(SHARKD_OUTPUT_CHUNK);
+	}
+	return &stdout_output;
+}
+
+static void
+sharkd_output_flush(struct sharkd_output *out)
+{
+#ifdef SHARKD_SHARED_SUPPORT
+	if (out->chunks)
+	{
+		if (out->buf->len)
+		{
+			g_async_queue_push(out->chunks, out->buf);
+			out->buf = g_string_sized_new(SHARKD_OUTPUT_CHUNK);
+		}
+		return;
+	}
+#endif
+	if (out->buf->len)
+	{
+		fwrite(out->buf->str, 1, out->buf->len, out->fp);
+		g_string_truncate(out->buf, 0);
+	}
+	fflush(out->fp);
+}
+
+static void
+sharkd_output_check(struct sharkd_output *out)
+{
+	if (out->buf->len >= SHARKD_OUTPUT_CHUNK)
+		sharkd_output_flush(out);
+}
+
+static void sharkd_printf(const char *format, ...) G_GNUC_PRINTF(1, 2);
+
+static void
+sharkd_printf(const char *format, ...)
+{
+	struct sharkd_output *out = sharkd_session_out();
+	va_list ap;
+
+	va_start(ap, format);
+	g_string_append_vprintf(out->buf, format, ap);
+	va_end(ap);
+
+	sharkd_output_check(out);
+}
+
+static void
+sharkd_putchar(int c)
+{
+	struct sharkd_output *out = sharkd_session_out();
+
+	g_string_append_c(out->buf, (gchar) c);
+	sharkd_output_check(out);
+}
 
 static gboolean
 json_unescape_str(char *input)
@@ -106,34 +226,37 @@ json_find_attr(const char *buf, const jsmntok_t *tokens, int count, const char *
 static void
 json_puts_string(const char *str)
 {
+	struct sharkd_output *out = sharkd_session_out();
+	GString *buf = out->buf;
 	int i;
 
 	if (str == NULL)
 		str = "";
 
-	putchar('"');
+	g_string_append_c(buf, '"');
 	for (i = 0; str[i]; i++)
 	{
 		switch (str[i])
 		{
 			case '\\':
 			case '"':
-				putchar('\\');
-				putchar(str[i]);
+				g_string_append_c(buf, '\\');
+				g_string_append_c(buf, str[i]);
 				break;
 
 			case '\n':
-				putchar('\\');
-				putchar('n');
+				g_string_append_c(buf, '\\');
+				g_string_append_c(buf, 'n');
 				break;
 
 			default:
-				putchar(str[i]);
+				g_string_append_c(buf, str[i]);
 				break;
 		}
 	}
 
-	putchar('"');
+	g_string_append_c(buf, '"');
+	sharkd_output_check(out);
 }
 
 static void
@@ -150,25 +273,38 @@ json_print_base64_step(const guint8 *data, int *state1, int *state2)
 	if (wrote > 0)
 	{
 		buf[wrote] = '\0';
-		printf("%s", buf);
+		sharkd_printf("%s", buf);
 	}
 }
 
 static void
 json_print_base64(const guint8 *data, size_t len)
 {
-	size_t i;
+	struct sharkd_output *out = sharkd_session_out();
 	int base64_state1 = 0;
 	int base64_state2 = 0;
+	gchar buf[(3072 / 3 + 1) * 4 + 4];
+	gsize block;
+	gsize wrote;
 
-	putchar('"');
+	g_string_append_c(out->buf, '"');
 
-	for (i = 0; i < len; i++)
-		json_print_base64_step(&data[i], &base64_state1, &base64_state2);
+	while (len > 0)
+	{
+		block = MIN(len, 3072);
+		wrote = g_base64_encode_step(data, block, FALSE, buf, &base64_state1, &base64_state2);
+		g_string_append_len(out->buf, buf, wrote);
+		sharkd_output_check(out);
 
-	json_print_base64_step(NULL, &base64_state1, &base64_state2);
+		data += block;
+		len -= block;
+	}
 
-	putchar('"');
+	wrote = g_base64_encode_close(FALSE, buf, &base64_state1, &base64_state2);
+	g_string_append_len(out->buf, buf, wrote);
+
+	g_string_append_c(out->buf, '"');
+	sharkd_output_check(out);
 }
 
 static void
@@ -176,34 +312,128 @@ sharkd_session_filter_free(gpointer data)
 {
 	struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
 
-	g_free(l->filtered);
+	ws_bitmap_free(l->filtered);
+	g_free(l->filter);
 	g_free(l);
 }
 
-static const guint8 *
+static void
+sharkd_session_filter_touch(struct sharkd_filter_item *l)
+{
+	g_queue_unlink(&filter_lru, &l->lru_link);
+	g_queue_push_head_link(&filter_lru, &l->lru_link);
+}
+
+/*
+ * Find the longest cached filter that the given filter refines, that is,
+ * which it starts with, followed by "&&" or "and".  "and" binds less
+ * tightly than anything else in a display filter, so "A && B" can only
+ * match frames that match A.
+ */
+static struct sharkd_filter_item *
+sharkd_session_filter_parent(const char *filter)
+{
+	struct sharkd_filter_item *parent = NULL;
+	struct sharkd_filter_item *l;
+	const char *op;
+	char *prefix;
+	int i;
+
+	for (i = 0; filter[i]; i++)
+	{
+		if (!g_ascii_isspace(filter[i]))
+			continue;
+
+		op = filter + i;
+		while (g_ascii_isspace(*op))
+			op++;
+
+		if (strncmp(op, "&&", 2) != 0 && !(g_ascii_strncasecmp(op, "and", 3) == 0 && g_ascii_isspace(op[3])))
+			continue;
+
+		prefix = g_strstrip(g_strndup(filter, i));
+		l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, prefix);
+		if (l)
+			parent = l;
+		g_free(prefix);
+	}
+
+	return parent;
+}
+
+static const ws_bitmap *
 sharkd_session_filter_data(const char *filter)
 {
 	struct sharkd_filter_item *l;
 
+#ifdef SHARKD_SHARED_SUPPORT
+	g_mutex_lock(&filter_mtx);
+#endif
 	l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
 	if (!l)
 	{
-		guint8 *filtered = NULL;
+		struct sharkd_filter_item *parent;
+		ws_bitmap *filtered = NULL;
 
-		int ret = sharkd_filter(filter, &filtered);
+		/* Only the frames that passed the filter being refined need dissecting. */
+		parent = sharkd_session_filter_parent(filter);
+		if (parent)
+			sharkd_session_filter_touch(parent);
 
-		if (ret == -1)
+		if (sharkd_filter(filter, parent ? parent->filtered : NULL, &filtered) == -1)
+		{
+#ifdef SHARKD_SHARED_SUPPORT
+			g_mutex_unlock(&filter_mtx);
+#endif
 			return NULL;
+		}
 
-		l = (struct sharkd_filter_item *) g_malloc(sizeof(struct sharkd_filter_item));
+		ws_bitmap_shrink(filtered);
+
+		l = g_new(struct sharkd_filter_item, 1);
+		l->filter = g_strdup(filter);
 		l->filtered = filtered;
+		l->size = sizeof(*l) + strlen(filter) + 1 + ws_bitmap_memory_size(filtered);
+		l->lru_link.data = l;
+		l->lru_link.prev = l->lru_link.next = NULL;
+
+		g_hash_table_insert(filter_table, l->filter, l);
+		g_queue_push_head_link(&filter_lru, &l->lru_link);
+		filter_cache_size += l->size;
+
+		/* Make room, but always keep the result we're about to return. */
+		while (filter_cache_size > SHARKD_FILTER_CACHE_MAX && filter_lru.tail != &l->lru_link)
+		{
+			struct sharkd_filter_item *old = (struct sharkd_filter_item *) filter_lru.tail->data;
 
-		g_hash_table_insert(filter_table, g_strdup(filter), l);
+			g_queue_unlink(&filter_lru, &old->lru_link);
+			filter_cache_size -= old->size;
+			g_hash_table_remove(filter_table, old->filter);
+		}
 	}
+	else
+		sharkd_session_filter_touch(l);
 
+#ifdef SHARKD_SHARED_SUPPORT
+	g_mutex_unlock(&filter_mtx);
+#endif
 	return l->filtered;
 }
 
+#ifdef SHARKD_SHARED_SUPPORT
+static gboolean
+sharkd_session_filter_cached(const char *filter)
+{
+	gboolean cached;
+
+	g_mutex_lock(&filter_mtx);
+	cached = (g_hash_table_lookup(filter_table, filter) != NULL);
+	g_mutex_unlock(&filter_mtx);
+
+	return cached;
+}
+#endif
+
 struct sharkd_rtp_match
 {
 	guint32 addr_src, addr_dst;
@@ -270,10 +500,10 @@ sharkd_session_process_info_nstat_cb(const void *key, void *value, void *userdat
 	stat_tap_table_ui *new_stat_tap = (stat_tap_table_ui *) value;
 	int *pi = (int *) userdata;
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"%s\"", new_stat_tap->title);
-		printf(",\"tap\":\"nstat:%s\"", (const char *) key);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"%s\"", new_stat_tap->title);
+		sharkd_printf(",\"tap\":\"nstat:%s\"", (const char *) key);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -289,20 +519,20 @@ sharkd_session_process_info_conv_cb(const void* key, void* value, void* userdata
 
 	if (get_conversation_packet_func(table))
 	{
-		printf("%s{", (*pi) ? "," : "");
-			printf("\"name\":\"Conversation List/%s\"", label);
-			printf(",\"tap\":\"conv:%s\"", label);
-		printf("}");
+		sharkd_printf("%s{", (*pi) ? "," : "");
+			sharkd_printf("\"name\":\"Conversation List/%s\"", label);
+			sharkd_printf(",\"tap\":\"conv:%s\"", label);
+		sharkd_printf("}");
 
 		*pi = *pi + 1;
 	}
 
 	if (get_hostlist_packet_func(table))
 	{
-		printf("%s{", (*pi) ? "," : "");
-			printf("\"name\":\"Endpoint/%s\"", label);
-			printf(",\"tap\":\"endpt:%s\"", label);
-		printf("}");
+		sharkd_printf("%s{", (*pi) ? "," : "");
+			sharkd_printf("\"name\":\"Endpoint/%s\"", label);
+			sharkd_printf(",\"tap\":\"endpt:%s\"", label);
+		sharkd_printf("}");
 
 		*pi = *pi + 1;
 	}
@@ -315,10 +545,10 @@ sharkd_session_seq_analysis_cb(const void *key, void *value, void *userdata)
 	register_analysis_t *analysis = (register_analysis_t *) value;
 	int *pi = (int *) userdata;
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"%s\"", sequence_analysis_get_ui_name(analysis));
-		printf(",\"tap\":\"seqa:%s\"", (const char *) key);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"%s\"", sequence_analysis_get_ui_name(analysis));
+		sharkd_printf(",\"tap\":\"seqa:%s\"", (const char *) key);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -334,10 +564,10 @@ sharkd_export_object_visit_cb(const void *key _U_, void *value, void *user_data)
 	const char *filter = proto_get_protocol_filter_name(proto_id);
 	const char *label  = proto_get_protocol_short_name(find_protocol_by_id(proto_id));
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"Export Object/%s\"", label);
-		printf(",\"tap\":\"eo:%s\"", filter);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"Export Object/%s\"", label);
+		sharkd_printf(",\"tap\":\"eo:%s\"", filter);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -353,10 +583,10 @@ sharkd_srt_visit_cb(const void *key _U_, void *value, void *user_data)
 	const char *filter = proto_get_protocol_filter_name(proto_id);
 	const char *label  = proto_get_protocol_short_name(find_protocol_by_id(proto_id));
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"Service Response Time/%s\"", label);
-		printf(",\"tap\":\"srt:%s\"", filter);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"Service Response Time/%s\"", label);
+		sharkd_printf(",\"tap\":\"srt:%s\"", filter);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -372,10 +602,10 @@ sharkd_rtd_visit_cb(const void *key _U_, void *value, void *user_data)
 	const char *filter = proto_get_protocol_filter_name(proto_id);
 	const char *label  = proto_get_protocol_short_name(find_protocol_by_id(proto_id));
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"Response Time Delay/%s\"", label);
-		printf(",\"tap\":\"rtd:%s\"", filter);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"Response Time Delay/%s\"", label);
+		sharkd_printf(",\"tap\":\"rtd:%s\"", filter);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -391,10 +621,10 @@ sharkd_follower_visit_cb(const void *key _U_, void *value, void *user_data)
 	const char *label  = proto_get_protocol_short_name(find_protocol_by_id(proto_id));
 	const char *filter = label; /* correct: get_follow_by_name() is registered by short name */
 
-	printf("%s{", (*pi) ? "," : "");
-		printf("\"name\":\"Follow/%s\"", label);
-		printf(",\"tap\":\"follow:%s\"", filter);
-	printf("}");
+	sharkd_printf("%s{", (*pi) ? "," : "");
+		sharkd_printf("\"name\":\"Follow/%s\"", label);
+		sharkd_printf(",\"tap\":\"follow:%s\"", filter);
+	sharkd_printf("}");
 
 	*pi = *pi + 1;
 	return FALSE;
@@ -449,20 +679,20 @@ sharkd_session_process_info(void)
 {
 	int i;
 
-	printf("{\"columns\":[");
+	sharkd_printf("{\"columns\":[");
 	for (i = 0; i < NUM_COL_FMTS; i++)
 	{
 		const char *col_format = col_format_to_string(i);
 		const char *col_descr  = col_format_desc(i);
 
-		printf("%s{", (i) ? "," : "");
-			printf("\"name\":\"%s\"", col_descr);
-			printf(",\"format\":\"%s\"", col_format);
-		printf("}");
+		sharkd_printf("%s{", (i) ? "," : "");
+			sharkd_printf("\"name\":\"%s\"", col_descr);
+			sharkd_printf(",\"format\":\"%s\"", col_format);
+		sharkd_printf("}");
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"stats\":[");
+	sharkd_printf(",\"stats\":[");
 	{
 		GList *cfg_list = stats_tree_get_cfg_list();
 		GList *l;
@@ -472,72 +702,72 @@ sharkd_session_process_info(void)
 		{
 			stats_tree_cfg *cfg = (stats_tree_cfg *) l->data;
 
-			printf("%s{", sepa);
-				printf("\"name\":\"%s\"", cfg->name);
-				printf(",\"tap\":\"stat:%s\"", cfg->abbr);
-			printf("}");
+			sharkd_printf("%s{", sepa);
+				sharkd_printf("\"name\":\"%s\"", cfg->name);
+				sharkd_printf(",\"tap\":\"stat:%s\"", cfg->abbr);
+			sharkd_printf("}");
 			sepa = ",";
 		}
 
 		g_list_free(cfg_list);
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"ftypes\":[");
+	sharkd_printf(",\"ftypes\":[");
 	for (i = 0; i < FT_NUM_TYPES; i++)
 	{
 		if (i)
-			printf(",");
+			sharkd_printf(",");
 		json_puts_string(ftype_name((ftenum_t) i));
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"version\":");
+	sharkd_printf(",\"version\":");
 	json_puts_string(sharkd_version());
 
-	printf(",\"nstat\":[");
+	sharkd_printf(",\"nstat\":[");
 	i = 0;
 	new_stat_tap_iterate_tables(sharkd_session_process_info_nstat_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"convs\":[");
+	sharkd_printf(",\"convs\":[");
 	i = 0;
 	conversation_table_iterate_tables(sharkd_session_process_info_conv_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"seqa\":[");
+	sharkd_printf(",\"seqa\":[");
 	i = 0;
 	sequence_analysis_table_iterate_tables(sharkd_session_seq_analysis_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"taps\":[");
+	sharkd_printf(",\"taps\":[");
 	{
-		printf("{\"name\":\"%s\",\"tap\":\"%s\"}", "RTP streams", "rtp-streams");
-		printf(",{\"name\":\"%s\",\"tap\":\"%s\"}", "Expert Information", "expert");
+		sharkd_printf("{\"name\":\"%s\",\"tap\":\"%s\"}", "RTP streams", "rtp-streams");
+		sharkd_printf(",{\"name\":\"%s\",\"tap\":\"%s\"}", "Expert Information", "expert");
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"eo\":[");
+	sharkd_printf(",\"eo\":[");
 	i = 0;
 	eo_iterate_tables(sharkd_export_object_visit_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"srt\":[");
+	sharkd_printf(",\"srt\":[");
 	i = 0;
 	srt_table_iterate_tables(sharkd_srt_visit_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"rtd\":[");
+	sharkd_printf(",\"rtd\":[");
 	i = 0;
 	rtd_table_iterate_tables(sharkd_rtd_visit_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"follow\":[");
+	sharkd_printf(",\"follow\":[");
 	i = 0;
 	follow_iterate_followers(sharkd_follower_visit_cb, &i);
-	printf("]");
+	sharkd_printf("]");
 
-	printf("}\n");
+	sharkd_printf("}\n");
 }
 
 /**
@@ -562,9 +792,18 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 	if (!tok_file)
 		return;
 
+#ifdef SHARKD_SHARED_SUPPORT
+	/* Other sessions are using the capture file. */
+	if (shared_capture)
+	{
+		sharkd_printf("{\"err\":%d}\n", EBUSY);
+		return;
+	}
+#endif
+
 	if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
 	{
-		printf("{\"err\":%d}\n", err);
+		sharkd_printf("{\"err\":%d}\n", err);
 		return;
 	}
 
@@ -579,7 +818,7 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 	}
 	ENDTRY;
 
-	printf("{\"err\":%d}\n", err);
+	sharkd_printf("{\"err\":%d}\n", err);
 }
 
 /**
@@ -596,15 +835,15 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 static void
 sharkd_session_process_status(void)
 {
-	printf("{\"frames\":%u", cfile.count);
+	sharkd_printf("{\"frames\":%u", cfile.count);
 
-	printf(",\"duration\":%.9f", nstime_to_sec(&cfile.elapsed_time));
+	sharkd_printf(",\"duration\":%.9f", nstime_to_sec(&cfile.elapsed_time));
 
 	if (cfile.filename)
 	{
 		char *name = g_path_get_basename(cfile.filename);
 
-		printf(",\"filename\":");
+		sharkd_printf(",\"filename\":");
 		json_puts_string(name);
 		g_free(name);
 	}
@@ -614,10 +853,10 @@ sharkd_session_process_status(void)
 		gint64 file_size = wtap_file_size(cfile.provider.wth, NULL);
 
 		if (file_size > 0)
-			printf(",\"filesize\":%" G_GINT64_FORMAT, file_size);
+			sharkd_printf(",\"filesize\":%" G_GINT64_FORMAT, file_size);
 	}
 
-	printf("}\n");
+	sharkd_printf("}\n");
 }
 
 struct sharkd_analyse_data
@@ -657,7 +896,7 @@ sharkd_session_process_analyse_cb(epan_dissect_t *edt, proto_tree *tree, struct
 				g_hash_table_insert(analyser->protocols_set, GUINT_TO_POINTER(proto_id), GUINT_TO_POINTER(proto_id));
 
 				if (g_hash_table_size(analyser->protocols_set) != 1)
-					printf(",");
+					sharkd_printf(",");
 				json_puts_string(proto_get_protocol_filter_name(proto_id));
 			}
 		}
@@ -686,20 +925,20 @@ sharkd_session_process_analyse(void)
 	analyser.last_time  = NULL;
 	analyser.protocols_set = g_hash_table_new(NULL /* g_direct_hash() */, NULL /* g_direct_equal */);
 
-	printf("{\"frames\":%u", cfile.count);
+	sharkd_printf("{\"frames\":%u", cfile.count);
 
-	printf(",\"protocols\":[");
+	sharkd_printf(",\"protocols\":[");
 	for (framenum = 1; framenum <= cfile.count; framenum++)
 		sharkd_dissect_request(framenum, (framenum != 1) ? 1 : 0, framenum - 1, &sharkd_session_process_analyse_cb, 0, 0, 0, &analyser);
-	printf("]");
+	sharkd_printf("]");
 
 	if (analyser.first_time)
-		printf(",\"first\":%.9f", nstime_to_sec(analyser.first_time));
+		sharkd_printf(",\"first\":%.9f", nstime_to_sec(analyser.first_time));
 
 	if (analyser.last_time)
-		printf(",\"last\":%.9f", nstime_to_sec(analyser.last_time));
+		sharkd_printf(",\"last\":%.9f", nstime_to_sec(analyser.last_time));
 
-	printf("}\n");
+	sharkd_printf("}\n");
 
 	g_hash_table_destroy(analyser.protocols_set);
 }
@@ -786,6 +1025,8 @@ sharkd_session_create_columns(column_info *cinfo, const char *buf, const jsmntok
  *                            If column0 is not specified default column set will be used.
  *   (o) filter - filter to be used
  *   (o) skip=N   - skip N frames
+ *   (o) cursor=N - start after frame N, usually the last frame of the previous page; unlike skip,
+ *                  this doesn't need the frames before it to be counted again.
  *   (o) limit=N  - show only N frames
  *   (o) refs  - list (comma separated) with sorted time reference frame numbers.
  *
@@ -804,10 +1045,11 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
 	const char *tok_column = json_find_attr(buf, tokens, count, "column0");
 	const char *tok_skip   = json_find_attr(buf, tokens, count, "skip");
+	const char *tok_cursor = json_find_attr(buf, tokens, count, "cursor");
 	const char *tok_limit  = json_find_attr(buf, tokens, count, "limit");
 	const char *tok_refs   = json_find_attr(buf, tokens, count, "refs");
 
-	const guint8 *filter_data = NULL;
+	const ws_bitmap *filter_data = NULL;
 
 	const char *frame_sepa = "";
 	int col;
@@ -815,6 +1057,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	guint32 framenum, prev_dis_num = 0;
 	guint32 current_ref_frame = 0, next_ref_frame = G_MAXUINT32;
 	guint32 skip;
+	guint32 cursor;
 	guint32 limit;
 
 	column_info *cinfo = &cfile.cinfo;
@@ -842,6 +1085,15 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 			return;
 	}
 
+	cursor = 0;
+	if (tok_cursor)
+	{
+		if (!ws_strtou32(tok_cursor, NULL, &cursor))
+			return;
+		if (cursor > cfile.count)
+			cursor = cfile.count;
+	}
+
 	limit = 0;
 	if (tok_limit)
 	{
@@ -855,13 +1107,16 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 			return;
 	}
 
-	printf("[");
-	for (framenum = 1; framenum <= cfile.count; framenum++)
+	/* The frame the cursor points at was the last one displayed. */
+	prev_dis_num = cursor;
+
+	sharkd_printf("[");
+	for (framenum = cursor + 1; framenum <= cfile.count; framenum++)
 	{
 		frame_data *fdata;
 		guint32 ref_frame = (framenum != 1) ? 1 : 0;
 
-		if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+		if (filter_data && !ws_bitmap_contains(filter_data, framenum))
 			continue;
 
 		if (skip)
@@ -899,44 +1154,44 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		fdata = sharkd_get_frame(framenum);
 		sharkd_dissect_columns(fdata, ref_frame, prev_dis_num, cinfo, (fdata->color_filter == NULL));
 
-		printf("%s{\"c\":[", frame_sepa);
+		sharkd_printf("%s{\"c\":[", frame_sepa);
 		for (col = 0; col < cinfo->num_cols; ++col)
 		{
 			const col_item_t *col_item = &cinfo->columns[col];
 
 			if (col)
-				printf(",");
+				sharkd_printf(",");
 
 			json_puts_string(col_item->col_data);
 		}
-		printf("],\"num\":%u", framenum);
+		sharkd_printf("],\"num\":%u", framenum);
 
 		if (fdata->flags.has_user_comment || fdata->flags.has_phdr_comment)
 		{
 			if (!fdata->flags.has_user_comment || sharkd_get_user_comment(fdata) != NULL)
-				printf(",\"ct\":true");
+				sharkd_printf(",\"ct\":true");
 		}
 
 		if (fdata->flags.ignored)
-			printf(",\"i\":true");
+			sharkd_printf(",\"i\":true");
 
 		if (fdata->flags.marked)
-			printf(",\"m\":true");
+			sharkd_printf(",\"m\":true");
 
 		if (fdata->color_filter)
 		{
-			printf(",\"bg\":\"%x\"", color_t_to_rgb(&fdata->color_filter->bg_color));
-			printf(",\"fg\":\"%x\"", color_t_to_rgb(&fdata->color_filter->fg_color));
+			sharkd_printf(",\"bg\":\"%x\"", color_t_to_rgb(&fdata->color_filter->bg_color));
+			sharkd_printf(",\"fg\":\"%x\"", color_t_to_rgb(&fdata->color_filter->fg_color));
 		}
 
-		printf("}");
+		sharkd_printf("}");
 		frame_sepa = ",";
 		prev_dis_num = framenum;
 
 		if (limit && --limit == 0)
 			break;
 	}
-	printf("]\n");
+	sharkd_printf("]\n");
 
 	if (cinfo != &cfile.cinfo)
 		col_cleanup(cinfo);
@@ -948,46 +1203,46 @@ sharkd_session_process_tap_stats_node_cb(const stat_node *n)
 	stat_node *node;
 	const char *sepa = "";
 
-	printf("[");
+	sharkd_printf("[");
 	for (node = n->children; node; node = node->next)
 	{
 		/* code based on stats_tree_get_values_from_node() */
-		printf("%s{\"name\":\"%s\"", sepa, node->name);
-		printf(",\"count\":%d", node->counter);
+		sharkd_printf("%s{\"name\":\"%s\"", sepa, node->name);
+		sharkd_printf(",\"count\":%d", node->counter);
 		if (node->counter && ((node->st_flags & ST_FLG_AVERAGE) || node->rng))
 		{
-			printf(",\"avg\":%.2f", ((float)node->total) / node->counter);
-			printf(",\"min\":%d", node->minvalue);
-			printf(",\"max\":%d", node->maxvalue);
+			sharkd_printf(",\"avg\":%.2f", ((float)node->total) / node->counter);
+			sharkd_printf(",\"min\":%d", node->minvalue);
+			sharkd_printf(",\"max\":%d", node->maxvalue);
 		}
 
 		if (node->st->elapsed)
-			printf(",\"rate\":%.4f",((float)node->counter) / node->st->elapsed);
+			sharkd_printf(",\"rate\":%.4f",((float)node->counter) / node->st->elapsed);
 
 		if (node->parent && node->parent->counter)
-			printf(",\"perc\":%.2f", (node->counter * 100.0) / node->parent->counter);
+			sharkd_printf(",\"perc\":%.2f", (node->counter * 100.0) / node->parent->counter);
 		else if (node->parent == &(node->st->root))
-			printf(",\"perc\":100");
+			sharkd_printf(",\"perc\":100");
 
 		if (prefs.st_enable_burstinfo && node->max_burst)
 		{
 			if (prefs.st_burst_showcount)
-				printf(",\"burstcount\":%d", node->max_burst);
+				sharkd_printf(",\"burstcount\":%d", node->max_burst);
 			else
-				printf(",\"burstrate\":%.4f", ((double)node->max_burst) / prefs.st_burst_windowlen);
+				sharkd_printf(",\"burstrate\":%.4f", ((double)node->max_burst) / prefs.st_burst_windowlen);
 
-			printf(",\"bursttime\":%.3f", ((double)node->burst_time / 1000.0));
+			sharkd_printf(",\"bursttime\":%.3f", ((double)node->burst_time / 1000.0));
 		}
 
 		if (node->children)
 		{
-			printf(",\"sub\":");
+			sharkd_printf(",\"sub\":");
 			sharkd_session_process_tap_stats_node_cb(node);
 		}
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
-	printf("]");
+	sharkd_printf("]");
 }
 
 /**
@@ -1016,11 +1271,11 @@ sharkd_session_process_tap_stats_cb(void *psp)
 {
 	stats_tree *st = (stats_tree *) psp;
 
-	printf("{\"tap\":\"stats:%s\",\"type\":\"stats\"", st->cfg->abbr);
+	sharkd_printf("{\"tap\":\"stats:%s\",\"type\":\"stats\"", st->cfg->abbr);
 
-	printf(",\"name\":\"%s\",\"stats\":", st->cfg->name);
+	sharkd_printf(",\"name\":\"%s\",\"stats\":", st->cfg->name);
 	sharkd_session_process_tap_stats_node_cb(&st->root);
-	printf("},");
+	sharkd_printf("},");
 }
 
 static void
@@ -1058,42 +1313,42 @@ sharkd_session_process_tap_expert_cb(void *tapdata)
 	GSList *list;
 	const char *sepa = "";
 
-	printf("{\"tap\":\"%s\",\"type\":\"%s\"", "expert", "expert");
+	sharkd_printf("{\"tap\":\"%s\",\"type\":\"%s\"", "expert", "expert");
 
-	printf(",\"details\":[");
+	sharkd_printf(",\"details\":[");
 	for (list = etd->details; list; list = list->next)
 	{
 		expert_info_t *ei = (expert_info_t *) list->data;
 		const char *tmp;
 
-		printf("%s{", sepa);
+		sharkd_printf("%s{", sepa);
 
-		printf("\"f\":%u,", ei->packet_num);
+		sharkd_printf("\"f\":%u,", ei->packet_num);
 
 		tmp = try_val_to_str(ei->severity, expert_severity_vals);
 		if (tmp)
-			printf("\"s\":\"%s\",", tmp);
+			sharkd_printf("\"s\":\"%s\",", tmp);
 
 		tmp = try_val_to_str(ei->group, expert_group_vals);
 		if (tmp)
-			printf("\"g\":\"%s\",", tmp);
+			sharkd_printf("\"g\":\"%s\",", tmp);
 
-		printf("\"m\":");
+		sharkd_printf("\"m\":");
 		json_puts_string(ei->summary);
-		printf(",");
+		sharkd_printf(",");
 
 		if (ei->protocol)
 		{
-			printf("\"p\":");
+			sharkd_printf("\"p\":");
 			json_puts_string(ei->protocol);
 		}
 
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf("},");
+	sharkd_printf("},");
 }
 
 static gboolean
@@ -1153,23 +1408,23 @@ sharkd_session_process_tap_flow_cb(void *tapdata)
 
 	sequence_analysis_get_nodes(graph_analysis);
 
-	printf("{\"tap\":\"seqa:%s\",\"type\":\"%s\"", graph_analysis->name, "flow");
+	sharkd_printf("{\"tap\":\"seqa:%s\",\"type\":\"%s\"", graph_analysis->name, "flow");
 
-	printf(",\"nodes\":[");
+	sharkd_printf(",\"nodes\":[");
 	for (i = 0; i < graph_analysis->num_nodes; i++)
 	{
 		char *addr_str;
 
 		if (i)
-			printf(",");
+			sharkd_printf(",");
 
 		addr_str = address_to_display(NULL, &(graph_analysis->nodes[i]));
 		json_puts_string(addr_str);
 		wmem_free(NULL, addr_str);
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"flows\":[");
+	sharkd_printf(",\"flows\":[");
 
 	flow_list = g_queue_peek_nth_link(graph_analysis->items, 0);
 	while (flow_list)
@@ -1181,25 +1436,25 @@ sharkd_session_process_tap_flow_cb(void *tapdata)
 		if (!sai->display)
 			continue;
 
-		printf("%s{", sepa);
+		sharkd_printf("%s{", sepa);
 
-		printf("\"t\":\"%s\"", sai->time_str);
-		printf(",\"n\":[%u,%u]", sai->src_node, sai->dst_node);
-		printf(",\"pn\":[%u,%u]", sai->port_src, sai->port_dst);
+		sharkd_printf("\"t\":\"%s\"", sai->time_str);
+		sharkd_printf(",\"n\":[%u,%u]", sai->src_node, sai->dst_node);
+		sharkd_printf(",\"pn\":[%u,%u]", sai->port_src, sai->port_dst);
 
 		if (sai->comment)
 		{
-			printf(",\"c\":");
+			sharkd_printf(",\"c\":");
 			json_puts_string(sai->comment);
 		}
 
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
 
-	printf("]");
+	sharkd_printf("]");
 
-	printf("},");
+	sharkd_printf("},");
 }
 
 static void
@@ -1275,7 +1530,7 @@ sharkd_session_geoip_addr(address *addr, const char *suffix)
 
 			if (geoip_key && (geoip_val = geoip_db_lookup_ipv4(dbnum, ip, NULL)))
 			{
-				printf(",\"%s%s\":", geoip_key, suffix);
+				sharkd_printf(",\"%s%s\":", geoip_key, suffix);
 				json_puts_string(geoip_val);
 				with_geoip = 1;
 			}
@@ -1330,7 +1585,7 @@ sharkd_session_geoip_addr(address *addr, const char *suffix)
 
 			if (geoip_key && (geoip_val = geoip_db_lookup_ipv6(dbnum, *ip6, NULL)))
 			{
-				printf(",\"%s%s\":", geoip_key, suffix);
+				sharkd_printf(",\"%s%s\":", geoip_key, suffix);
 				json_puts_string(geoip_val);
 				with_geoip = 1;
 			}
@@ -1457,71 +1712,71 @@ sharkd_session_process_tap_rtp_analyse_cb(void *tapdata)
 	const char *sepa = "";
 	GSList *l;
 
-	printf("{\"tap\":\"%s\",\"type\":\"rtp-analyse\"", rtp_req->tap_name);
+	sharkd_printf("{\"tap\":\"%s\",\"type\":\"rtp-analyse\"", rtp_req->tap_name);
 
-	printf(",\"ssrc\":%u", rtp_req->rtp.ssrc);
+	sharkd_printf(",\"ssrc\":%u", rtp_req->rtp.ssrc);
 
-	printf(",\"max_delta\":%f", statinfo->max_delta);
-	printf(",\"max_delta_nr\":%u", statinfo->max_nr);
-	printf(",\"max_jitter\":%f", statinfo->max_jitter);
-	printf(",\"mean_jitter\":%f", statinfo->mean_jitter);
-	printf(",\"max_skew\":%f", statinfo->max_skew);
-	printf(",\"total_nr\":%u", statinfo->total_nr);
-	printf(",\"seq_err\":%u", statinfo->sequence);
-	printf(",\"duration\":%f", statinfo->time - statinfo->start_time);
+	sharkd_printf(",\"max_delta\":%f", statinfo->max_delta);
+	sharkd_printf(",\"max_delta_nr\":%u", statinfo->max_nr);
+	sharkd_printf(",\"max_jitter\":%f", statinfo->max_jitter);
+	sharkd_printf(",\"mean_jitter\":%f", statinfo->mean_jitter);
+	sharkd_printf(",\"max_skew\":%f", statinfo->max_skew);
+	sharkd_printf(",\"total_nr\":%u", statinfo->total_nr);
+	sharkd_printf(",\"seq_err\":%u", statinfo->sequence);
+	sharkd_printf(",\"duration\":%f", statinfo->time - statinfo->start_time);
 
-	printf(",\"items\":[");
+	sharkd_printf(",\"items\":[");
 	for (l = rtp_req->packets; l; l = l->next)
 	{
 		struct sharkd_analyse_rtp_items *item = (struct sharkd_analyse_rtp_items *) l->data;
 
-		printf("%s{", sepa);
+		sharkd_printf("%s{", sepa);
 
-		printf("\"f\":%u", item->frame_num);
-		printf(",\"o\":%.9f", item->arrive_offset);
-		printf(",\"sn\":%u", item->sequence_num);
-		printf(",\"d\":%.2f", item->delta);
-		printf(",\"j\":%.2f", item->jitter);
-		printf(",\"sk\":%.2f", item->skew);
-		printf(",\"bw\":%.2f", item->bandwidth);
+		sharkd_printf("\"f\":%u", item->frame_num);
+		sharkd_printf(",\"o\":%.9f", item->arrive_offset);
+		sharkd_printf(",\"sn\":%u", item->sequence_num);
+		sharkd_printf(",\"d\":%.2f", item->delta);
+		sharkd_printf(",\"j\":%.2f", item->jitter);
+		sharkd_printf(",\"sk\":%.2f", item->skew);
+		sharkd_printf(",\"bw\":%.2f", item->bandwidth);
 
 		if (item->pt == PT_CN)
-			printf(",\"s\":\"%s\",\"t\":%d", "Comfort noise (PT=13, RFC 3389)", RTP_TYPE_CN);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Comfort noise (PT=13, RFC 3389)", RTP_TYPE_CN);
 		else if (item->pt == PT_CN_OLD)
-			printf(",\"s\":\"%s\",\"t\":%d", "Comfort noise (PT=19, reserved)", RTP_TYPE_CN);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Comfort noise (PT=19, reserved)", RTP_TYPE_CN);
 		else if (item->flags & STAT_FLAG_WRONG_SEQ)
-			printf(",\"s\":\"%s\",\"t\":%d", "Wrong sequence number", RTP_TYPE_ERROR);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Wrong sequence number", RTP_TYPE_ERROR);
 		else if (item->flags & STAT_FLAG_DUP_PKT)
-			printf(",\"s\":\"%s\",\"t\":%d", "Suspected duplicate (MAC address) only delta time calculated", RTP_TYPE_WARN);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Suspected duplicate (MAC address) only delta time calculated", RTP_TYPE_WARN);
 		else if (item->flags & STAT_FLAG_REG_PT_CHANGE)
-			printf(",\"s\":\"Payload changed to PT=%u%s\",\"t\":%d",
+			sharkd_printf(",\"s\":\"Payload changed to PT=%u%s\",\"t\":%d",
 				item->pt,
 				(item->flags & STAT_FLAG_PT_T_EVENT) ? " telephone/event" : "",
 				RTP_TYPE_WARN);
 		else if (item->flags & STAT_FLAG_WRONG_TIMESTAMP)
-			printf(",\"s\":\"%s\",\"t\":%d", "Incorrect timestamp", RTP_TYPE_WARN);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Incorrect timestamp", RTP_TYPE_WARN);
 		else if ((item->flags & STAT_FLAG_PT_CHANGE)
 			&&  !(item->flags & STAT_FLAG_FIRST)
 			&&  !(item->flags & STAT_FLAG_PT_CN)
 			&&  (item->flags & STAT_FLAG_FOLLOW_PT_CN)
 			&&  !(item->flags & STAT_FLAG_MARKER))
 		{
-			printf(",\"s\":\"%s\",\"t\":%d", "Marker missing?", RTP_TYPE_WARN);
+			sharkd_printf(",\"s\":\"%s\",\"t\":%d", "Marker missing?", RTP_TYPE_WARN);
 		}
 		else if (item->flags & STAT_FLAG_PT_T_EVENT)
-			printf(",\"s\":\"PT=%u telephone/event\",\"t\":%d", item->pt, RTP_TYPE_PT_EVENT);
+			sharkd_printf(",\"s\":\"PT=%u telephone/event\",\"t\":%d", item->pt, RTP_TYPE_PT_EVENT);
 		else if (item->flags & STAT_FLAG_MARKER)
-			printf(",\"t\":%d", RTP_TYPE_WARN);
+			sharkd_printf(",\"t\":%d", RTP_TYPE_WARN);
 
 		if (item->marker)
-			printf(",\"mark\":1");
+			sharkd_printf(",\"mark\":1");
 
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf("},");
+	sharkd_printf("},");
 }
 
 /**
@@ -1566,19 +1821,19 @@ sharkd_session_process_tap_conv_cb(void *arg)
 
 	if (!strncmp(iu->type, "conv:", 5))
 	{
-		printf("{\"tap\":\"%s\",\"type\":\"conv\"", iu->type);
-		printf(",\"convs\":[");
+		sharkd_printf("{\"tap\":\"%s\",\"type\":\"conv\"", iu->type);
+		sharkd_printf(",\"convs\":[");
 		proto = iu->type + 5;
 	}
 	else if (!strncmp(iu->type, "endpt:", 6))
 	{
-		printf("{\"tap\":\"%s\",\"type\":\"host\"", iu->type);
-		printf(",\"hosts\":[");
+		sharkd_printf("{\"tap\":\"%s\",\"type\":\"host\"", iu->type);
+		sharkd_printf(",\"hosts\":[");
 		proto = iu->type + 6;
 	}
 	else
 	{
-		printf("{\"tap\":\"%s\",\"type\":\"err\"", iu->type);
+		sharkd_printf("{\"tap\":\"%s\",\"type\":\"err\"", iu->type);
 		proto = "";
 	}
 
@@ -1593,33 +1848,33 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			char *src_port, *dst_port;
 			char *filter_str;
 
-			printf("%s{", i ? "," : "");
+			sharkd_printf("%s{", i ? "," : "");
 
-			printf("\"saddr\":\"%s\"",  (src_addr = get_conversation_address(NULL, &iui->src_address, iu->resolve_name)));
-			printf(",\"daddr\":\"%s\"", (dst_addr = get_conversation_address(NULL, &iui->dst_address, iu->resolve_name)));
+			sharkd_printf("\"saddr\":\"%s\"",  (src_addr = get_conversation_address(NULL, &iui->src_address, iu->resolve_name)));
+			sharkd_printf(",\"daddr\":\"%s\"", (dst_addr = get_conversation_address(NULL, &iui->dst_address, iu->resolve_name)));
 
 			if (proto_with_port)
 			{
-				printf(",\"sport\":\"%s\"", (src_port = get_conversation_port(NULL, iui->src_port, iui->etype, iu->resolve_port)));
-				printf(",\"dport\":\"%s\"", (dst_port = get_conversation_port(NULL, iui->dst_port, iui->etype, iu->resolve_port)));
+				sharkd_printf(",\"sport\":\"%s\"", (src_port = get_conversation_port(NULL, iui->src_port, iui->etype, iu->resolve_port)));
+				sharkd_printf(",\"dport\":\"%s\"", (dst_port = get_conversation_port(NULL, iui->dst_port, iui->etype, iu->resolve_port)));
 
 				wmem_free(NULL, src_port);
 				wmem_free(NULL, dst_port);
 			}
 
-			printf(",\"rxf\":%" G_GUINT64_FORMAT, iui->rx_frames);
-			printf(",\"rxb\":%" G_GUINT64_FORMAT, iui->rx_bytes);
+			sharkd_printf(",\"rxf\":%" G_GUINT64_FORMAT, iui->rx_frames);
+			sharkd_printf(",\"rxb\":%" G_GUINT64_FORMAT, iui->rx_bytes);
 
-			printf(",\"txf\":%" G_GUINT64_FORMAT, iui->tx_frames);
-			printf(",\"txb\":%" G_GUINT64_FORMAT, iui->tx_bytes);
+			sharkd_printf(",\"txf\":%" G_GUINT64_FORMAT, iui->tx_frames);
+			sharkd_printf(",\"txb\":%" G_GUINT64_FORMAT, iui->tx_bytes);
 
-			printf(",\"start\":%.9f", nstime_to_sec(&iui->start_time));
-			printf(",\"stop\":%.9f", nstime_to_sec(&iui->stop_time));
+			sharkd_printf(",\"start\":%.9f", nstime_to_sec(&iui->start_time));
+			sharkd_printf(",\"stop\":%.9f", nstime_to_sec(&iui->stop_time));
 
 			filter_str = get_conversation_filter(iui, CONV_DIR_A_TO_FROM_B);
 			if (filter_str)
 			{
-				printf(",\"filter\":\"%s\"", filter_str);
+				sharkd_printf(",\"filter\":\"%s\"", filter_str);
 				g_free(filter_str);
 			}
 
@@ -1631,7 +1886,7 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			if (sharkd_session_geoip_addr(&(iui->dst_address), "2"))
 				with_geoip = 1;
 
-			printf("}");
+			sharkd_printf("}");
 		}
 	}
 	else if (iu->hash.conv_array != NULL && !strncmp(iu->type, "endpt:", 6))
@@ -1642,27 +1897,27 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			char *host_str, *port_str;
 			char *filter_str;
 
-			printf("%s{", i ? "," : "");
+			sharkd_printf("%s{", i ? "," : "");
 
-			printf("\"host\":\"%s\"", (host_str = get_conversation_address(NULL, &host->myaddress, iu->resolve_name)));
+			sharkd_printf("\"host\":\"%s\"", (host_str = get_conversation_address(NULL, &host->myaddress, iu->resolve_name)));
 
 			if (proto_with_port)
 			{
-				printf(",\"port\":\"%s\"", (port_str = get_conversation_port(NULL, host->port, host->etype, iu->resolve_port)));
+				sharkd_printf(",\"port\":\"%s\"", (port_str = get_conversation_port(NULL, host->port, host->etype, iu->resolve_port)));
 
 				wmem_free(NULL, port_str);
 			}
 
-			printf(",\"rxf\":%" G_GUINT64_FORMAT, host->rx_frames);
-			printf(",\"rxb\":%" G_GUINT64_FORMAT, host->rx_bytes);
+			sharkd_printf(",\"rxf\":%" G_GUINT64_FORMAT, host->rx_frames);
+			sharkd_printf(",\"rxb\":%" G_GUINT64_FORMAT, host->rx_bytes);
 
-			printf(",\"txf\":%" G_GUINT64_FORMAT, host->tx_frames);
-			printf(",\"txb\":%" G_GUINT64_FORMAT, host->tx_bytes);
+			sharkd_printf(",\"txf\":%" G_GUINT64_FORMAT, host->tx_frames);
+			sharkd_printf(",\"txb\":%" G_GUINT64_FORMAT, host->tx_bytes);
 
 			filter_str = get_hostlist_filter(host);
 			if (filter_str)
 			{
-				printf(",\"filter\":\"%s\"", filter_str);
+				sharkd_printf(",\"filter\":\"%s\"", filter_str);
 				g_free(filter_str);
 			}
 
@@ -1670,11 +1925,11 @@ sharkd_session_process_tap_conv_cb(void *arg)
 
 			if (sharkd_session_geoip_addr(&(host->myaddress), ""))
 				with_geoip = 1;
-			printf("}");
+			sharkd_printf("}");
 		}
 	}
 
-	printf("],\"proto\":\"%s\",\"geoip\":%s},", proto, with_geoip ? "true" : "false");
+	sharkd_printf("],\"proto\":\"%s\",\"geoip\":%s},", proto, with_geoip ? "true" : "false");
 }
 
 static void
@@ -1714,40 +1969,40 @@ sharkd_session_process_tap_nstat_cb(void *arg)
 	new_stat_data_t *stat_data = (new_stat_data_t *) arg;
 	guint i, j, k;
 
-	printf("{\"tap\":\"nstat:%s\",\"type\":\"nstat\"", stat_data->stat_tap_data->cli_string);
+	sharkd_printf("{\"tap\":\"nstat:%s\",\"type\":\"nstat\"", stat_data->stat_tap_data->cli_string);
 
-	printf(",\"fields\":[");
+	sharkd_printf(",\"fields\":[");
 	for (i = 0; i < stat_data->stat_tap_data->nfields; i++)
 	{
 		stat_tap_table_item *field = &(stat_data->stat_tap_data->fields[i]);
 
 		if (i)
-			printf(",");
+			sharkd_printf(",");
 
-		printf("{");
+		sharkd_printf("{");
 
-		printf("\"c\":");
+		sharkd_printf("\"c\":");
 		json_puts_string(field->column_name);
 
-		printf("}");
+		sharkd_printf("}");
 	}
-	printf("]");
+	sharkd_printf("]");
 
-	printf(",\"tables\":[");
+	sharkd_printf(",\"tables\":[");
 	for (i = 0; i < stat_data->stat_tap_data->tables->len; i++)
 	{
 		stat_tap_table *table = g_array_index(stat_data->stat_tap_data->tables, stat_tap_table *, i);
 		const char *sepa = "";
 
 		if (i)
-			printf(",");
+			sharkd_printf(",");
 
-		printf("{");
+		sharkd_printf("{");
 
-		printf("\"t\":");
-		printf("\"%s\"", table->title);
+		sharkd_printf("\"t\":");
+		sharkd_printf("\"%s\"", table->title);
 
-		printf(",\"i\":[");
+		sharkd_printf(",\"i\":[");
 		for (j = 0; j < table->num_elements; j++)
 		{
 			stat_tap_table_item_type *field_data;
@@ -1756,22 +2011,22 @@ sharkd_session_process_tap_nstat_cb(void *arg)
 			if (field_data == NULL || field_data->type == TABLE_ITEM_NONE) /* Nothing for us here */
 				continue;
 
-			printf("%s[", sepa);
+			sharkd_printf("%s[", sepa);
 			for (k = 0; k < table->num_fields; k++)
 			{
 				field_data = new_stat_tap_get_field_data(table, j, k);
 
 				if (k)
-					printf(",");
+					sharkd_printf(",");
 
 				switch (field_data->type)
 				{
 					case TABLE_ITEM_UINT:
-						printf("%u", field_data->value.uint_value);
+						sharkd_printf("%u", field_data->value.uint_value);
 						break;
 
 					case TABLE_ITEM_INT:
-						printf("%d", field_data->value.int_value);
+						sharkd_printf("%d", field_data->value.int_value);
 						break;
 
 					case TABLE_ITEM_STRING:
@@ -1779,27 +2034,27 @@ sharkd_session_process_tap_nstat_cb(void *arg)
 						break;
 
 					case TABLE_ITEM_FLOAT:
-						printf("%f", field_data->value.float_value);
+						sharkd_printf("%f", field_data->value.float_value);
 						break;
 
 					case TABLE_ITEM_ENUM:
-						printf("%d", field_data->value.enum_value);
+						sharkd_printf("%d", field_data->value.enum_value);
 						break;
 
 					case TABLE_ITEM_NONE:
-						printf("null");
+						sharkd_printf("null");
 						break;
 				}
 			}
 
-			printf("]");
+			sharkd_printf("]");
 			sepa = ",";
 		}
-		printf("]");
-		printf("}");
+		sharkd_printf("]");
+		sharkd_printf("}");
 	}
 
-	printf("]},");
+	sharkd_printf("]},");
 }
 
 static void
@@ -1852,19 +2107,19 @@ sharkd_session_process_tap_rtd_cb(void *arg)
 	const value_string *vs = get_rtd_value_string(rtd);
 	const char *sepa = "";
 
-	printf("{\"tap\":\"rtd:%s\",\"type\":\"rtd\"", filter);
+	sharkd_printf("{\"tap\":\"rtd:%s\",\"type\":\"rtd\"", filter);
 
 	if (rtd_data->stat_table.num_rtds == 1)
 	{
 		const rtd_timestat *ms = &rtd_data->stat_table.time_stats[0];
 
-		printf(",\"open_req\":%u", ms->open_req_num);
-		printf(",\"disc_rsp\":%u", ms->disc_rsp_num);
-		printf(",\"req_dup\":%u", ms->req_dup_num);
-		printf(",\"rsp_dup\":%u", ms->rsp_dup_num);
+		sharkd_printf(",\"open_req\":%u", ms->open_req_num);
+		sharkd_printf(",\"disc_rsp\":%u", ms->disc_rsp_num);
+		sharkd_printf(",\"req_dup\":%u", ms->req_dup_num);
+		sharkd_printf(",\"rsp_dup\":%u", ms->rsp_dup_num);
 	}
 
-	printf(",\"stats\":[");
+	sharkd_printf(",\"stats\":[");
 	for (i = 0; i < rtd_data->stat_table.num_rtds; i++)
 	{
 		const rtd_timestat *ms = &rtd_data->stat_table.time_stats[i];
@@ -1876,36 +2131,36 @@ sharkd_session_process_tap_rtd_cb(void *arg)
 			if (ms->rtd[j].num == 0)
 				continue;
 
-			printf("%s{", sepa);
+			sharkd_printf("%s{", sepa);
 
 			if (rtd_data->stat_table.num_rtds == 1)
 				type_str = val_to_str_const(j, vs, "Other"); /* 1 table - description per row */
 			else
 				type_str = val_to_str_const(i, vs, "Other"); /* multiple table - description per table */
-			printf("\"type\":");
+			sharkd_printf("\"type\":");
 			json_puts_string(type_str);
 
-			printf(",\"num\":%u", ms->rtd[j].num);
-			printf(",\"min\":%.9f", nstime_to_sec(&(ms->rtd[j].min)));
-			printf(",\"max\":%.9f", nstime_to_sec(&(ms->rtd[j].max)));
-			printf(",\"tot\":%.9f", nstime_to_sec(&(ms->rtd[j].tot)));
-			printf(",\"min_frame\":%u", ms->rtd[j].min_num);
-			printf(",\"max_frame\":%u", ms->rtd[j].max_num);
+			sharkd_printf(",\"num\":%u", ms->rtd[j].num);
+			sharkd_printf(",\"min\":%.9f", nstime_to_sec(&(ms->rtd[j].min)));
+			sharkd_printf(",\"max\":%.9f", nstime_to_sec(&(ms->rtd[j].max)));
+			sharkd_printf(",\"tot\":%.9f", nstime_to_sec(&(ms->rtd[j].tot)));
+			sharkd_printf(",\"min_frame\":%u", ms->rtd[j].min_num);
+			sharkd_printf(",\"max_frame\":%u", ms->rtd[j].max_num);
 
 			if (rtd_data->stat_table.num_rtds != 1)
 			{
 				/* like in tshark, display it on every row */
-				printf(",\"open_req\":%u", ms->open_req_num);
-				printf(",\"disc_rsp\":%u", ms->disc_rsp_num);
-				printf(",\"req_dup\":%u", ms->req_dup_num);
-				printf(",\"rsp_dup\":%u", ms->rsp_dup_num);
+				sharkd_printf(",\"open_req\":%u", ms->open_req_num);
+				sharkd_printf(",\"disc_rsp\":%u", ms->disc_rsp_num);
+				sharkd_printf(",\"req_dup\":%u", ms->req_dup_num);
+				sharkd_printf(",\"rsp_dup\":%u", ms->rsp_dup_num);
 			}
 
-			printf("}");
+			sharkd_printf("}");
 			sepa = ",";
 		}
 	}
-	printf("]},");
+	sharkd_printf("]},");
 }
 
 static void
@@ -1946,9 +2201,9 @@ sharkd_session_process_tap_srt_cb(void *arg)
 
 	guint i;
 
-	printf("{\"tap\":\"srt:%s\",\"type\":\"srt\"", filter);
+	sharkd_printf("{\"tap\":\"srt:%s\",\"type\":\"srt\"", filter);
 
-	printf(",\"tables\":[");
+	sharkd_printf(",\"tables\":[");
 	for (i = 0; i < srt_data->srt_array->len; i++)
 	{
 		/* SRT table */
@@ -1958,30 +2213,30 @@ sharkd_session_process_tap_srt_cb(void *arg)
 		int j;
 
 		if (i)
-			printf(",");
-		printf("{");
+			sharkd_printf(",");
+		sharkd_printf("{");
 
-		printf("\"n\":");
+		sharkd_printf("\"n\":");
 		if (rst->name)
 			json_puts_string(rst->name);
 		else if (rst->short_name)
 			json_puts_string(rst->short_name);
 		else
-			printf("\"table%u\"", i);
+			sharkd_printf("\"table%u\"", i);
 
 		if (rst->filter_string)
 		{
-			printf(",\"f\":");
+			sharkd_printf(",\"f\":");
 			json_puts_string(rst->filter_string);
 		}
 
 		if (rst->proc_column_name)
 		{
-			printf(",\"c\":");
+			sharkd_printf(",\"c\":");
 			json_puts_string(rst->proc_column_name);
 		}
 
-		printf(",\"r\":[");
+		sharkd_printf(",\"r\":[");
 		for (j = 0; j < rst->num_procs; j++)
 		{
 			/* SRT row */
@@ -1990,27 +2245,27 @@ sharkd_session_process_tap_srt_cb(void *arg)
 			if (proc->stats.num == 0)
 				continue;
 
-			printf("%s{", sepa);
+			sharkd_printf("%s{", sepa);
 
-			printf("\"n\":");
+			sharkd_printf("\"n\":");
 			json_puts_string(proc->procedure);
 
 			if (rst->filter_string)
-				printf(",\"idx\":%d", proc->proc_index);
+				sharkd_printf(",\"idx\":%d", proc->proc_index);
 
-			printf(",\"num\":%u", proc->stats.num);
+			sharkd_printf(",\"num\":%u", proc->stats.num);
 
-			printf(",\"min\":%.9f", nstime_to_sec(&proc->stats.min));
-			printf(",\"max\":%.9f", nstime_to_sec(&proc->stats.max));
-			printf(",\"tot\":%.9f", nstime_to_sec(&proc->stats.tot));
+			sharkd_printf(",\"min\":%.9f", nstime_to_sec(&proc->stats.min));
+			sharkd_printf(",\"max\":%.9f", nstime_to_sec(&proc->stats.max));
+			sharkd_printf(",\"tot\":%.9f", nstime_to_sec(&proc->stats.tot));
 
-			printf("}");
+			sharkd_printf("}");
 			sepa = ",";
 		}
-		printf("]}");
+		sharkd_printf("]}");
 	}
 
-	printf("]},");
+	sharkd_printf("]},");
 }
 
 static void
@@ -2057,46 +2312,46 @@ sharkd_session_process_tap_eo_cb(void *tapdata)
 	GSList *slist;
 	int i = 0;
 
-	printf("{\"tap\":\"%s\",\"type\":\"eo\"", object_list->type);
-	printf(",\"proto\":\"%s\"", object_list->proto);
-	printf(",\"objects\":[");
+	sharkd_printf("{\"tap\":\"%s\",\"type\":\"eo\"", object_list->type);
+	sharkd_printf(",\"proto\":\"%s\"", object_list->proto);
+	sharkd_printf(",\"objects\":[");
 
 	for (slist = object_list->entries; slist; slist = slist->next)
 	{
 		const export_object_entry_t *eo_entry = (export_object_entry_t *) slist->data;
 
-		printf("%s{", i ? "," : "");
+		sharkd_printf("%s{", i ? "," : "");
 
-		printf("\"pkt\":%u", eo_entry->pkt_num);
+		sharkd_printf("\"pkt\":%u", eo_entry->pkt_num);
 
 		if (eo_entry->hostname)
 		{
-			printf(",\"hostname\":");
+			sharkd_printf(",\"hostname\":");
 			json_puts_string(eo_entry->hostname);
 		}
 
 		if (eo_entry->content_type)
 		{
-			printf(",\"type\":");
+			sharkd_printf(",\"type\":");
 			json_puts_string(eo_entry->content_type);
 		}
 
 		if (eo_entry->filename)
 		{
-			printf(",\"filename\":");
+			sharkd_printf(",\"filename\":");
 			json_puts_string(eo_entry->filename);
 		}
 
-		printf(",\"_download\":\"%s_%d\"", object_list->type, i);
+		sharkd_printf(",\"_download\":\"%s_%d\"", object_list->type, i);
 
-		printf(",\"len\":%" G_GINT64_FORMAT, eo_entry->payload_len);
+		sharkd_printf(",\"len\":%" G_GINT64_FORMAT, eo_entry->payload_len);
 
-		printf("}");
+		sharkd_printf("}");
 
 		i++;
 	}
 
-	printf("]},");
+	sharkd_printf("]},");
 }
 
 static void
@@ -2145,9 +2400,9 @@ sharkd_session_process_tap_rtp_cb(void *arg)
 	GList *listx;
 	const char *sepa = "";
 
-	printf("{\"tap\":\"%s\",\"type\":\"%s\"", "rtp-streams", "rtp-streams");
+	sharkd_printf("{\"tap\":\"%s\",\"type\":\"%s\"", "rtp-streams", "rtp-streams");
 
-	printf(",\"streams\":[");
+	sharkd_printf(",\"streams\":[");
 	for (listx = g_list_first(rtp_tapinfo->strinfo_list); listx; listx = listx->next)
 	{
 		rtp_stream_info_t *streaminfo = (rtp_stream_info_t *) listx->data;
@@ -2164,38 +2419,38 @@ sharkd_session_process_tap_rtp_cb(void *arg)
 		else
 			payload = val_to_str_ext_wmem(NULL, streaminfo->payload_type, &rtp_payload_type_short_vals_ext, "Unknown (%u)");
 
-		printf("%s{\"ssrc\":%u", sepa, streaminfo->ssrc);
-		printf(",\"payload\":\"%s\"", payload);
+		sharkd_printf("%s{\"ssrc\":%u", sepa, streaminfo->ssrc);
+		sharkd_printf(",\"payload\":\"%s\"", payload);
 
-		printf(",\"saddr\":\"%s\"", src_addr);
-		printf(",\"sport\":%u", streaminfo->src_port);
+		sharkd_printf(",\"saddr\":\"%s\"", src_addr);
+		sharkd_printf(",\"sport\":%u", streaminfo->src_port);
 
-		printf(",\"daddr\":\"%s\"", dst_addr);
-		printf(",\"dport\":%u", streaminfo->dest_port);
+		sharkd_printf(",\"daddr\":\"%s\"", dst_addr);
+		sharkd_printf(",\"dport\":%u", streaminfo->dest_port);
 
-		printf(",\"pkts\":%u", streaminfo->packet_count);
+		sharkd_printf(",\"pkts\":%u", streaminfo->packet_count);
 
-		printf(",\"max_delta\":%f", streaminfo->rtp_stats.max_delta);
-		printf(",\"max_jitter\":%f", streaminfo->rtp_stats.max_jitter);
-		printf(",\"mean_jitter\":%f", streaminfo->rtp_stats.mean_jitter);
+		sharkd_printf(",\"max_delta\":%f", streaminfo->rtp_stats.max_delta);
+		sharkd_printf(",\"max_jitter\":%f", streaminfo->rtp_stats.max_jitter);
+		sharkd_printf(",\"mean_jitter\":%f", streaminfo->rtp_stats.mean_jitter);
 
 		expected = (streaminfo->rtp_stats.stop_seq_nr + streaminfo->rtp_stats.cycles * 65536) - streaminfo->rtp_stats.start_seq_nr + 1;
-		printf(",\"expectednr\":%u", expected);
-		printf(",\"totalnr\":%u", streaminfo->rtp_stats.total_nr);
+		sharkd_printf(",\"expectednr\":%u", expected);
+		sharkd_printf(",\"totalnr\":%u", streaminfo->rtp_stats.total_nr);
 
-		printf(",\"problem\":%s", streaminfo->problem ? "true" : "false");
+		sharkd_printf(",\"problem\":%s", streaminfo->problem ? "true" : "false");
 
 		/* for filter */
-		printf(",\"ipver\":%d", (streaminfo->src_addr.type == AT_IPv6) ? 6 : 4);
+		sharkd_printf(",\"ipver\":%d", (streaminfo->src_addr.type == AT_IPv6) ? 6 : 4);
 
 		wmem_free(NULL, src_addr);
 		wmem_free(NULL, dst_addr);
 		wmem_free(NULL, payload);
 
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
-	printf("]},");
+	sharkd_printf("]},");
 }
 
 /**
@@ -2536,9 +2791,9 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 	if (taps_count == 0)
 		return;
 
-	printf("{\"taps\":[");
+	sharkd_printf("{\"taps\":[");
 	sharkd_retap();
-	printf("null],\"err\":0}\n");
+	sharkd_printf("null],\"err\":0}\n");
 
 	for (i = 0; i < taps_count; i++)
 	{
@@ -2611,33 +2866,33 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 
 	sharkd_retap();
 
-	printf("{");
+	sharkd_printf("{");
 
-	printf("\"err\":0");
+	sharkd_printf("\"err\":0");
 
 	/* Server information: hostname, port, bytes sent */
 	host = address_to_name(&follow_info->server_ip);
-	printf(",\"shost\":");
+	sharkd_printf(",\"shost\":");
 	json_puts_string(host);
 
 	port = get_follow_port_to_display(follower)(NULL, follow_info->server_port);
-	printf(",\"sport\":");
+	sharkd_printf(",\"sport\":");
 	json_puts_string(port);
 	wmem_free(NULL, port);
 
-	printf(",\"sbytes\":%u", follow_info->bytes_written[0]);
+	sharkd_printf(",\"sbytes\":%u", follow_info->bytes_written[0]);
 
 	/* Client information: hostname, port, bytes sent */
 	host = address_to_name(&follow_info->client_ip);
-	printf(",\"chost\":");
+	sharkd_printf(",\"chost\":");
 	json_puts_string(host);
 
 	port = get_follow_port_to_display(follower)(NULL, follow_info->client_port);
-	printf(",\"cport\":");
+	sharkd_printf(",\"cport\":");
 	json_puts_string(port);
 	wmem_free(NULL, port);
 
-	printf(",\"cbytes\":%u", follow_info->bytes_written[1]);
+	sharkd_printf(",\"cbytes\":%u", follow_info->bytes_written[1]);
 
 	if (follow_info->payload)
 	{
@@ -2645,30 +2900,30 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 		GList *cur;
 		const char *sepa = "";
 
-		printf(",\"payloads\":[");
+		sharkd_printf(",\"payloads\":[");
 
 		for (cur = follow_info->payload; cur; cur = g_list_next(cur))
 		{
 			follow_record = (follow_record_t *) cur->data;
 
-			printf("%s{", sepa);
+			sharkd_printf("%s{", sepa);
 
-			printf("\"n\":%u", follow_record->packet_num);
+			sharkd_printf("\"n\":%u", follow_record->packet_num);
 
-			printf(",\"d\":");
+			sharkd_printf(",\"d\":");
 			json_print_base64(follow_record->data->data, follow_record->data->len);
 
 			if (follow_record->is_server)
-				printf(",\"s\":%d", 1);
+				sharkd_printf(",\"s\":%d", 1);
 
-			printf("}");
+			sharkd_printf("}");
 			sepa = ",";
 		}
 
-		printf("]");
+		sharkd_printf("]");
 	}
 
-	printf("}\n");
+	sharkd_printf("}\n");
 
 	remove_tap_listener(follow_info);
 	follow_info_free(follow_info);
@@ -2680,7 +2935,7 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 	proto_node *node;
 	const char *sepa = "";
 
-	printf("[");
+	sharkd_printf("[");
 	for (node = tree->first_child; node; node = node->next)
 	{
 		field_info *finfo = PNODE_FINFO(node);
@@ -2692,9 +2947,9 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 		if (FI_GET_FLAG(finfo, FI_HIDDEN))
 			continue;
 
-		printf("%s{", sepa);
+		sharkd_printf("%s{", sepa);
 
-		printf("\"l\":");
+		sharkd_printf("\"l\":");
 		if (!finfo->rep)
 		{
 			char label_str[ITEM_LABEL_LENGTH];
@@ -2716,17 +2971,17 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 			{
 				if (tvbs[idx] == finfo->ds_tvb)
 				{
-					printf(",\"ds\":%d", idx);
+					sharkd_printf(",\"ds\":%d", idx);
 					break;
 				}
 			}
 		}
 
 		if (finfo->start >= 0 && finfo->length > 0)
-			printf(",\"h\":[%d,%d]", finfo->start, finfo->length);
+			sharkd_printf(",\"h\":[%d,%d]", finfo->start, finfo->length);
 
 		if (finfo->appendix_start >= 0 && finfo->appendix_length > 0)
-			printf(",\"i\":[%d,%d]", finfo->appendix_start, finfo->appendix_length);
+			sharkd_printf(",\"i\":[%d,%d]", finfo->appendix_start, finfo->appendix_length);
 
 
 		if (finfo->hfinfo)
@@ -2735,17 +2990,17 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 
 			if (finfo->hfinfo->type == FT_PROTOCOL)
 			{
-				printf(",\"t\":\"proto\"");
+				sharkd_printf(",\"t\":\"proto\"");
 			}
 			else if (finfo->hfinfo->type == FT_FRAMENUM)
 			{
-				printf(",\"t\":\"framenum\",\"fnum\":%u", finfo->value.value.uinteger);
+				sharkd_printf(",\"t\":\"framenum\",\"fnum\":%u", finfo->value.value.uinteger);
 			}
 			else if (FI_GET_FLAG(finfo, FI_URL) && IS_FT_STRING(finfo->hfinfo->type))
 			{
 				char *url = fvalue_to_string_repr(NULL, &finfo->value, FTREPR_DISPLAY, finfo->hfinfo->display);
 
-				printf(",\"t\":\"url\",\"url\":");
+				sharkd_printf(",\"t\":\"url\",\"url\":");
 				json_puts_string(url);
 				wmem_free(NULL, url);
 			}
@@ -2753,7 +3008,7 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 			filter = proto_construct_match_selected_string(finfo, edt);
 			if (filter)
 			{
-				printf(",\"f\":");
+				sharkd_printf(",\"f\":");
 				json_puts_string(filter);
 				wmem_free(NULL, filter);
 			}
@@ -2765,21 +3020,21 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 
 			g_assert(severity != NULL);
 
-			printf(",\"s\":\"%s\"", severity);
+			sharkd_printf(",\"s\":\"%s\"", severity);
 		}
 
 		if (((proto_tree *) node)->first_child)
 		{
 			if (finfo->tree_type != -1)
-				printf(",\"e\":%d", finfo->tree_type);
-			printf(",\"n\":");
+				sharkd_printf(",\"e\":%d", finfo->tree_type);
+			sharkd_printf(",\"n\":");
 			sharkd_session_process_frame_cb_tree(edt, (proto_tree *) node, tvbs);
 		}
 
-		printf("}");
+		sharkd_printf("}");
 		sepa = ",";
 	}
-	printf("]");
+	sharkd_printf("]");
 }
 
 static gboolean
@@ -2799,9 +3054,9 @@ sharkd_follower_visit_layers_cb(const void *key _U_, void *value, void *user_dat
 
 		follow_filter = get_follow_conv_func(follower)(pi, &ignore_stream);
 
-		printf(",[\"%s\",", layer_proto);
+		sharkd_printf(",[\"%s\",", layer_proto);
 		json_puts_string(follow_filter);
-		printf("]");
+		sharkd_printf("]");
 
 		g_free(follow_filter);
 	}
@@ -2818,9 +3073,9 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 
 	(void) data;
 
-	printf("{");
+	sharkd_printf("{");
 
-	printf("\"err\":0");
+	sharkd_printf("\"err\":0");
 
 	if (fdata->flags.has_user_comment)
 		pkt_comment = sharkd_get_user_comment(fdata);
@@ -2829,7 +3084,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 
 	if (pkt_comment)
 	{
-		printf(",\"comment\":");
+		sharkd_printf(",\"comment\":");
 		json_puts_string(pkt_comment);
 	}
 
@@ -2837,7 +3092,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 	{
 		tvbuff_t **tvbs = NULL;
 
-		printf(",\"tree\":");
+		sharkd_printf(",\"tree\":");
 
 		/* arrayize data src, to speedup searching for ds_tvb index */
 		if (data_src && data_src->next /* only needed if there are more than one data source */)
@@ -2866,14 +3121,14 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 	{
 		int col;
 
-		printf(",\"col\":[");
+		sharkd_printf(",\"col\":[");
 		for (col = 0; col < cinfo->num_cols; ++col)
 		{
 			const col_item_t *col_item = &cinfo->columns[col];
 
-			printf("%s\"%s\"", (col) ? "," : "", col_item->col_data);
+			sharkd_printf("%s\"%s\"", (col) ? "," : "", col_item->col_data);
 		}
-		printf("]");
+		sharkd_printf("]");
 	}
 
 	if (data_src)
@@ -2887,7 +3142,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 		tvb = get_data_source_tvb(src);
 		length = tvb_captured_length(tvb);
 
-		printf(",\"bytes\":");
+		sharkd_printf(",\"bytes\":");
 		if (length != 0)
 		{
 			const guchar *cp = tvb_get_ptr(tvb, 0, length);
@@ -2903,7 +3158,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 		data_src = data_src->next;
 		if (data_src)
 		{
-			printf(",\"ds\":[");
+			sharkd_printf(",\"ds\":[");
 			ds_sepa = "";
 		}
 
@@ -2914,7 +3169,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 			{
 				char *src_name = get_data_source_name(src);
 
-				printf("%s{\"name\":", ds_sepa);
+				sharkd_printf("%s{\"name\":", ds_sepa);
 				json_puts_string(src_name);
 				wmem_free(NULL, src_name);
 			}
@@ -2922,7 +3177,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 			tvb = get_data_source_tvb(src);
 			length = tvb_captured_length(tvb);
 
-			printf(",\"bytes\":");
+			sharkd_printf(",\"bytes\":");
 			if (length != 0)
 			{
 				const guchar *cp = tvb_get_ptr(tvb, 0, length);
@@ -2935,7 +3190,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 				json_print_base64("", 0);
 			}
 
-			printf("}");
+			sharkd_printf("}");
 			ds_sepa = ",";
 
 			data_src = data_src->next;
@@ -2943,14 +3198,14 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 
 		/* close ds, only if was opened */
 		if (ds_sepa != NULL)
-			printf("]");
+			sharkd_printf("]");
 	}
 
-	printf(",\"fol\":[0");
+	sharkd_printf(",\"fol\":[0");
 	follow_iterate_followers(sharkd_follower_visit_layers_cb, pi);
-	printf("]");
+	sharkd_printf("]");
 
-	printf("}\n");
+	sharkd_printf("}\n");
 }
 
 /**
@@ -2961,6 +3216,8 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
  * Input:
  *   (o) interval - interval time in ms, if not specified: 1000ms
  *   (o) filter   - filter for generating interval request
+ *   (o) cursor=N - start after frame N, the "next" of the previous page
+ *   (o) limit=N  - stop after N intervals
  *
  * Output object with attributes:
  *   (m) intervals - array of intervals, with indexes:
@@ -2971,6 +3228,7 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
  *   (m) last   - last interval number.
  *   (m) frames - total number of frames
  *   (m) bytes  - total number of bytes
+ *   (o) next   - if the limit was reached, the cursor for the next page; the totals are for this page only
  *
  * NOTE: If frames are not in order, there might be items with same interval index, or even negative one.
  */
@@ -2979,8 +3237,10 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 {
 	const char *tok_interval = json_find_attr(buf, tokens, count, "interval");
 	const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
+	const char *tok_cursor = json_find_attr(buf, tokens, count, "cursor");
+	const char *tok_limit = json_find_attr(buf, tokens, count, "limit");
 
-	const guint8 *filter_data = NULL;
+	const ws_bitmap *filter_data = NULL;
 
 	struct
 	{
@@ -2991,6 +3251,11 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 	nstime_t *start_ts;
 
 	guint32 interval_ms = 1000; /* default: one per second */
+	guint32 cursor = 0;
+	guint32 limit = 0;
+	guint32 num_intervals = 0;
+	guint32 last_frame = 0;
+	guint32 next_frame = 0;
 
 	const char *sepa = "";
 	unsigned int framenum;
@@ -3006,6 +3271,20 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 		}
 	}
 
+	if (tok_cursor)
+	{
+		if (!ws_strtou32(tok_cursor, NULL, &cursor))
+			return;
+		if (cursor > cfile.count)
+			cursor = cfile.count;
+	}
+
+	if (tok_limit)
+	{
+		if (!ws_strtou32(tok_limit, NULL, &limit))
+			return;
+	}
+
 	if (tok_filter)
 	{
 		filter_data = sharkd_session_filter_data(tok_filter);
@@ -3021,17 +3300,17 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 
 	idx = 0;
 
-	printf("{\"intervals\":[");
+	sharkd_printf("{\"intervals\":[");
 
 	start_ts = (cfile.count >= 1) ? &(sharkd_get_frame(1)->abs_ts) : NULL;
 
-	for (framenum = 1; framenum <= cfile.count; framenum++)
+	for (framenum = cursor + 1; framenum <= cfile.count; framenum++)
 	{
 		frame_data *fdata;
 		gint64 msec_rel;
 		gint64 new_idx;
 
-		if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+		if (filter_data && !ws_bitmap_contains(filter_data, framenum))
 			continue;
 
 		fdata = sharkd_get_frame(framenum);
@@ -3043,8 +3322,16 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 		{
 			if (st.frames != 0)
 			{
-				printf("%s[%" G_GINT64_FORMAT ",%u,%" G_GUINT64_FORMAT "]", sepa, idx, st.frames, st.bytes);
+				sharkd_printf("%s[%" G_GINT64_FORMAT ",%u,%" G_GUINT64_FORMAT "]", sepa, idx, st.frames, st.bytes);
 				sepa = ",";
+
+				if (limit && ++num_intervals == limit)
+				{
+					/* The next page starts after the last frame counted, with this one. */
+					next_frame = last_frame;
+					st.frames = 0;
+					break;
+				}
 			}
 
 			idx = new_idx;
@@ -3060,15 +3347,20 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 
 		st_total.frames += 1;
 		st_total.bytes  += fdata->pkt_len;
+
+		last_frame = framenum;
 	}
 
 	if (st.frames != 0)
 	{
-		printf("%s[%" G_GINT64_FORMAT ",%u,%" G_GUINT64_FORMAT "]", sepa, idx, st.frames, st.bytes);
+		sharkd_printf("%s[%" G_GINT64_FORMAT ",%u,%" G_GUINT64_FORMAT "]", sepa, idx, st.frames, st.bytes);
 		/* sepa = ","; */
 	}
 
-	printf("],\"last\":%" G_GINT64_FORMAT ",\"frames\":%u,\"bytes\":%" G_GUINT64_FORMAT "}\n", max_idx, st_total.frames, st_total.bytes);
+	sharkd_printf("],\"last\":%" G_GINT64_FORMAT ",\"frames\":%u,\"bytes\":%" G_GUINT64_FORMAT, max_idx, st_total.frames, st_total.bytes);
+	if (next_frame)
+		sharkd_printf(",\"next\":%u", next_frame);
+	sharkd_printf("}\n");
 }
 
 /**
@@ -3151,7 +3443,7 @@ sharkd_session_process_check(char *buf, const jsmntok_t *tokens, int count)
 {
 	const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
 
-	printf("{\"err\":0");
+	sharkd_printf("{\"err\":0");
 	if (tok_filter != NULL)
 	{
 		char *err_msg = NULL;
@@ -3164,18 +3456,18 @@ sharkd_session_process_check(char *buf, const jsmntok_t *tokens, int count)
 			if (dfilter_deprecated_tokens(dfp))
 				s = "warn";
 
-			printf(",\"filter\":\"%s\"", s);
+			sharkd_printf(",\"filter\":\"%s\"", s);
 			dfilter_free(dfp);
 		}
 		else
 		{
-			printf(",\"filter\":");
+			sharkd_printf(",\"filter\":");
 			json_puts_string(err_msg);
 			g_free(err_msg);
 		}
 	}
 
-	printf("}\n");
+	sharkd_printf("}\n");
 	return 0;
 }
 
@@ -3194,7 +3486,7 @@ sharkd_session_process_complete_pref_cb(module_t *module, gpointer d)
 	if (strncmp(data->pref, module->name, strlen(data->pref)) != 0)
 		return 0;
 
-	printf("%s{\"f\":\"%s\",\"d\":\"%s\"}", data->sepa, module->name, module->title);
+	sharkd_printf("%s{\"f\":\"%s\",\"d\":\"%s\"}", data->sepa, module->name, module->title);
 	data->sepa = ",";
 
 	return 0;
@@ -3210,7 +3502,7 @@ sharkd_session_process_complete_pref_option_cb(pref_t *pref, gpointer d)
 	if (strncmp(data->pref, pref_name, strlen(data->pref)) != 0)
 		return 0;
 
-	printf("%s{\"f\":\"%s.%s\",\"d\":\"%s\"}", data->sepa, data->module, pref_name, pref_title);
+	sharkd_printf("%s{\"f\":\"%s.%s\",\"d\":\"%s\"}", data->sepa, data->module, pref_name, pref_title);
 	data->sepa = ",";
 
 	return 0; /* continue */
@@ -3241,7 +3533,7 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 	const char *tok_field = json_find_attr(buf, tokens, count, "field");
 	const char *tok_pref  = json_find_attr(buf, tokens, count, "pref");
 
-	printf("{\"err\":0");
+	sharkd_printf("{\"err\":0");
 	if (tok_field != NULL && tok_field[0])
 	{
 		const size_t filter_length = strlen(tok_field);
@@ -3252,7 +3544,7 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 		int proto_id;
 		const char *sepa = "";
 
-		printf(",\"field\":[");
+		sharkd_printf(",\"field\":[");
 
 		for (proto_id = proto_get_first_protocol(&proto_cookie); proto_id != -1; proto_id = proto_get_next_protocol(&proto_cookie))
 		{
@@ -3269,15 +3561,15 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 
 			if (strlen(protocol_filter) >= filter_length && !g_ascii_strncasecmp(tok_field, protocol_filter, filter_length))
 			{
-				printf("%s{", sepa);
+				sharkd_printf("%s{", sepa);
 				{
-					printf("\"f\":");
+					sharkd_printf("\"f\":");
 					json_puts_string(protocol_filter);
-					printf(",\"t\":%d", FT_PROTOCOL);
-					printf(",\"n\":");
+					sharkd_printf(",\"t\":%d", FT_PROTOCOL);
+					sharkd_printf(",\"n\":");
 					json_puts_string(protocol_name);
 				}
-				printf("}");
+				sharkd_printf("}");
 				sepa = ",";
 			}
 
@@ -3291,26 +3583,26 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 
 				if (strlen(hfinfo->abbrev) >= filter_length && !g_ascii_strncasecmp(tok_field, hfinfo->abbrev, filter_length))
 				{
-					printf("%s{", sepa);
+					sharkd_printf("%s{", sepa);
 					{
-						printf("\"f\":");
+						sharkd_printf("\"f\":");
 						json_puts_string(hfinfo->abbrev);
 
 						/* XXX, skip displaying name, if there are multiple (to not confuse user) */
 						if (hfinfo->same_name_next == NULL)
 						{
-							printf(",\"t\":%d", hfinfo->type);
-							printf(",\"n\":");
+							sharkd_printf(",\"t\":%d", hfinfo->type);
+							sharkd_printf(",\"n\":");
 							json_puts_string(hfinfo->name);
 						}
 					}
-					printf("}");
+					sharkd_printf("}");
 					sepa = ",";
 				}
 			}
 		}
 
-		printf("]");
+		sharkd_printf("]");
 	}
 
 	if (tok_pref != NULL && tok_pref[0])
@@ -3322,7 +3614,7 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 		data.pref = tok_pref;
 		data.sepa = "";
 
-		printf(",\"pref\":[");
+		sharkd_printf(",\"pref\":[");
 
 		if ((dot_sepa = strchr(tok_pref, '.')))
 		{
@@ -3342,11 +3634,11 @@ sharkd_session_process_complete(char *buf, const jsmntok_t *tokens, int count)
 			prefs_modules_foreach(sharkd_session_process_complete_pref_cb, &data);
 		}
 
-		printf("]");
+		sharkd_printf("]");
 	}
 
 
-	printf("}\n");
+	sharkd_printf("}\n");
 	return 0;
 }
 
@@ -3380,7 +3672,7 @@ sharkd_session_process_setcomment(char *buf, const jsmntok_t *tokens, int count)
 		return;
 
 	ret = sharkd_set_user_comment(fdata, tok_comment);
-	printf("{\"err\":%d}\n", ret);
+	sharkd_printf("{\"err\":%d}\n", ret);
 }
 
 /**
@@ -3411,14 +3703,14 @@ sharkd_session_process_setconf(char *buf, const jsmntok_t *tokens, int count)
 	ws_snprintf(pref, sizeof(pref), "%s:%s", tok_name, tok_value);
 
 	ret = prefs_set_pref(pref, &errmsg);
-	printf("{\"err\":%d", ret);
+	sharkd_printf("{\"err\":%d", ret);
 	if (errmsg)
 	{
 		/* Add error message for some syntax errors. */
-		printf(",\"errmsg\":");
+		sharkd_printf(",\"errmsg\":");
 		json_puts_string(errmsg);
 	}
-	printf("}\n");
+	sharkd_printf("}\n");
 	g_free(errmsg);
 }
 
@@ -3434,26 +3726,26 @@ sharkd_session_process_dumpconf_cb(pref_t *pref, gpointer d)
 	struct sharkd_session_process_dumpconf_data *data = (struct sharkd_session_process_dumpconf_data *) d;
 	const char *pref_name = prefs_get_name(pref);
 
-	printf("%s\"%s.%s\":{", data->sepa, data->module->name, pref_name);
+	sharkd_printf("%s\"%s.%s\":{", data->sepa, data->module->name, pref_name);
 
 	switch (prefs_get_type(pref))
 	{
 		case PREF_UINT:
 		case PREF_DECODE_AS_UINT:
-			printf("\"u\":%u", prefs_get_uint_value_real(pref, pref_current));
+			sharkd_printf("\"u\":%u", prefs_get_uint_value_real(pref, pref_current));
 			if (prefs_get_uint_base(pref) != 10)
-				printf(",\"ub\":%u", prefs_get_uint_base(pref));
+				sharkd_printf(",\"ub\":%u", prefs_get_uint_base(pref));
 			break;
 
 		case PREF_BOOL:
-			printf("\"b\":%s", prefs_get_bool_value(pref, pref_current) ? "1" : "0");
+			sharkd_printf("\"b\":%s", prefs_get_bool_value(pref, pref_current) ? "1" : "0");
 			break;
 
 		case PREF_STRING:
 		case PREF_SAVE_FILENAME:
 		case PREF_OPEN_FILENAME:
 		case PREF_DIRNAME:
-			printf("\"s\":");
+			sharkd_printf("\"s\":");
 			json_puts_string(prefs_get_string_value(pref, pref_current));
 			break;
 
@@ -3462,21 +3754,21 @@ sharkd_session_process_dumpconf_cb(pref_t *pref, gpointer d)
 			const enum_val_t *enums;
 			const char *enum_sepa = "";
 
-			printf("\"e\":[");
+			sharkd_printf("\"e\":[");
 			for (enums = prefs_get_enumvals(pref); enums->name; enums++)
 			{
-				printf("%s{\"v\":%d", enum_sepa, enums->value);
+				sharkd_printf("%s{\"v\":%d", enum_sepa, enums->value);
 
 				if (enums->value == prefs_get_enum_value(pref, pref_current))
-					printf(",\"s\":1");
+					sharkd_printf(",\"s\":1");
 
-				printf(",\"d\":");
+				sharkd_printf(",\"d\":");
 				json_puts_string(enums->description);
 
-				printf("}");
+				sharkd_printf("}");
 				enum_sepa = ",";
 			}
-			printf("]");
+			sharkd_printf("]");
 			break;
 		}
 
@@ -3484,7 +3776,7 @@ sharkd_session_process_dumpconf_cb(pref_t *pref, gpointer d)
 		case PREF_DECODE_AS_RANGE:
 		{
 			char *range_str = range_convert_range(NULL, prefs_get_range_value_real(pref, pref_current));
-			printf("\"r\":\"%s\"", range_str);
+			sharkd_printf("\"r\":\"%s\"", range_str);
 			wmem_free(NULL, range_str);
 			break;
 		}
@@ -3494,31 +3786,31 @@ sharkd_session_process_dumpconf_cb(pref_t *pref, gpointer d)
 			uat_t *uat = prefs_get_uat_value(pref);
 			guint idx;
 
-			printf("\"t\":[");
+			sharkd_printf("\"t\":[");
 			for (idx = 0; idx < uat->raw_data->len; idx++)
 			{
 				void *rec = UAT_INDEX_PTR(uat, idx);
 				guint colnum;
 
 				if (idx)
-					printf(",");
+					sharkd_printf(",");
 
-				printf("[");
+				sharkd_printf("[");
 				for (colnum = 0; colnum < uat->ncols; colnum++)
 				{
 					char *str = uat_fld_tostr(rec, &(uat->fields[colnum]));
 
 					if (colnum)
-						printf(",");
+						sharkd_printf(",");
 
 					json_puts_string(str);
 					g_free(str);
 				}
 
-				printf("]");
+				sharkd_printf("]");
 			}
 
-			printf("]");
+			sharkd_printf("]");
 			break;
 		}
 
@@ -3531,11 +3823,11 @@ sharkd_session_process_dumpconf_cb(pref_t *pref, gpointer d)
 	}
 
 #if 0
-	printf(",\"t\":");
+	sharkd_printf(",\"t\":");
 	json_puts_string(prefs_get_title(pref));
 #endif
 
-	printf("}");
+	sharkd_printf("}");
 	data->sepa = ",";
 
 	return 0; /* continue */
@@ -3585,9 +3877,9 @@ sharkd_session_process_dumpconf(char *buf, const jsmntok_t *tokens, int count)
 		data.module = NULL;
 		data.sepa = "";
 
-		printf("{\"prefs\":{");
+		sharkd_printf("{\"prefs\":{");
 		prefs_modules_foreach(sharkd_session_process_dumpconf_mod_cb, &data);
-		printf("}}\n");
+		sharkd_printf("}}\n");
 		return;
 	}
 
@@ -3608,9 +3900,9 @@ sharkd_session_process_dumpconf(char *buf, const jsmntok_t *tokens, int count)
 			data.module = pref_mod;
 			data.sepa = "";
 
-			printf("{\"prefs\":{");
+			sharkd_printf("{\"prefs\":{");
 			sharkd_session_process_dumpconf_cb(pref, &data);
-			printf("}}\n");
+			sharkd_printf("}}\n");
 		}
 
 		return;
@@ -3624,9 +3916,9 @@ sharkd_session_process_dumpconf(char *buf, const jsmntok_t *tokens, int count)
 		data.module = pref_mod;
 		data.sepa = "";
 
-		printf("{\"prefs\":{");
+		sharkd_printf("{\"prefs\":{");
 		prefs_pref_foreach(pref_mod, sharkd_session_process_dumpconf_cb, &data);
-		printf("}}\n");
+		sharkd_printf("}}\n");
 	}
 }
 
@@ -3817,6 +4109,35 @@ sharkd_session_packet_download_tap_rtp_cb(void *tapdata, packet_info *pinfo, epa
 	return FALSE;
 }
 
+/*
+ * Print the part of a download's payload that was asked for with
+ * "offset" and "len", or all of it.
+ */
+static void
+sharkd_session_download_data(const char *buf, const jsmntok_t *tokens, int count, const guint8 *data, size_t size)
+{
+	const char *tok_offset = json_find_attr(buf, tokens, count, "offset");
+	const char *tok_len    = json_find_attr(buf, tokens, count, "len");
+	guint64 offset = 0;
+	guint64 len = G_MAXUINT64;
+
+	if (tok_offset && !ws_strtou64(tok_offset, NULL, &offset))
+		offset = 0;
+	if (tok_len && !ws_strtou64(tok_len, NULL, &len))
+		len = G_MAXUINT64;
+
+	if (offset > size)
+		offset = size;
+	if (len > size - offset)
+		len = size - offset;
+
+	if (tok_offset || tok_len)
+		sharkd_printf(",\"size\":%" G_GUINT64_FORMAT, (guint64) size);
+
+	sharkd_printf(",\"data\":");
+	json_print_base64(data + offset, (size_t) len);
+}
+
 /**
  * sharkd_session_process_download()
  *
@@ -3824,10 +4145,13 @@ sharkd_session_packet_download_tap_rtp_cb(void *tapdata, packet_info *pinfo, epa
  *
  * Input:
  *   (m) token  - token to download
+ *   (o) offset - for exported objects and secrets, where in the payload to start
+ *   (o) len    - for exported objects and secrets, how much of the payload to send
  *
  * Output object with attributes:
  *   (o) file - suggested name of file
  *   (o) mime - suggested content type
+ *   (o) size - size of the whole payload, if offset or len was given
  *   (o) data - payload base64 encoded
  */
 static void
@@ -3864,13 +4188,12 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			const char *mime     = (eo_entry->content_type) ? eo_entry->content_type : "application/octet-stream";
 			const char *filename = (eo_entry->filename) ? eo_entry->filename : tok_token;
 
-			printf("{\"file\":");
+			sharkd_printf("{\"file\":");
 			json_puts_string(filename);
-			printf(",\"mime\":");
+			sharkd_printf(",\"mime\":");
 			json_puts_string(mime);
-			printf(",\"data\":");
-			json_print_base64(eo_entry->payload_data, (size_t)(eo_entry->payload_len));
-			printf("}\n");
+			sharkd_session_download_data(buf, tokens, count, eo_entry->payload_data, (size_t)(eo_entry->payload_len));
+			sharkd_printf("}\n");
 		}
 	}
 	else if (!strcmp(tok_token, "ssl-secrets"))
@@ -3882,13 +4205,12 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			const char *mime     = "text/plain";
 			const char *filename = "keylog.txt";
 
-			printf("{\"file\":");
+			sharkd_printf("{\"file\":");
 			json_puts_string(filename);
-			printf(",\"mime\":");
+			sharkd_printf(",\"mime\":");
 			json_puts_string(mime);
-			printf(",\"data\":");
-			json_print_base64(str, strlen(str));
-			printf("}\n");
+			sharkd_session_download_data(buf, tokens, count, (const guint8 *) str, strlen(str));
+			sharkd_printf("}\n");
 		}
 		g_free(str);
 	}
@@ -3920,24 +4242,75 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			const char *mime     = "audio/x-wav";
 			const char *filename = tok_token;
 
-			printf("{\"file\":");
+			sharkd_printf("{\"file\":");
 			json_puts_string(filename);
-			printf(",\"mime\":");
+			sharkd_printf(",\"mime\":");
 			json_puts_string(mime);
 
-			printf(",\"data\":");
-			putchar('"');
+			sharkd_printf(",\"data\":");
+			sharkd_putchar('"');
 			sharkd_rtp_download_decode(&rtp_req);
-			putchar('"');
+			sharkd_putchar('"');
 
-			printf("}\n");
+			sharkd_printf("}\n");
 
 			g_slist_free_full(rtp_req.packets, sharkd_rtp_download_free_items);
 		}
 	}
 }
 
-static void
+#ifdef SHARKD_SHARED_SUPPORT
+/*
+ * Whether a request only reads the loaded capture file, and so can run
+ * alongside other sessions' requests.  This depends on the filter cache,
+ * so it's only settled while session_lock is held.
+ */
+static gboolean
+sharkd_session_request_is_shared(const char *tok_req, const char *buf, const jsmntok_t *tokens, int count)
+{
+	if (!strcmp(tok_req, "status") || !strcmp(tok_req, "info") ||
+	    !strcmp(tok_req, "complete") || !strcmp(tok_req, "dumpconf"))
+		return TRUE;
+
+	/* Frame times can be read without dissecting, unless the filter has to be run. */
+	if (!strcmp(tok_req, "intervals"))
+	{
+		const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
+
+		return (!tok_filter || sharkd_session_filter_cached(tok_filter));
+	}
+
+	return FALSE;
+}
+
+/*
+ * Take session_lock for a request, for reading if it can run alongside
+ * other sessions' requests.  Returns TRUE if it was taken for reading.
+ */
+static gboolean
+sharkd_session_lock(const char *tok_req, const char *buf, const jsmntok_t *tokens, int count)
+{
+	if (sharkd_session_request_is_shared(tok_req, buf, tokens, count))
+	{
+		g_rw_lock_reader_lock(&session_lock);
+
+		/*
+		 * Filters are only added to the cache, which is what evicts
+		 * others, by requests holding the lock for writing, so a
+		 * filter that's cached now stays cached until we're done.
+		 */
+		if (sharkd_session_request_is_shared(tok_req, buf, tokens, count))
+			return TRUE;
+		g_rw_lock_reader_unlock(&session_lock);
+	}
+
+	g_rw_lock_writer_lock(&session_lock);
+	return FALSE;
+}
+#endif
+
+/* Returns FALSE when the session is over. */
+static gboolean
 sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 {
 	int i;
@@ -3946,7 +4319,7 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 	if (count < 1 || tokens[0].type != JSMN_OBJECT)
 	{
 		fprintf(stderr, "sanity check(1): [0] not object\n");
-		return;
+		return TRUE;
 	}
 
 	/* don't need [0] token */
@@ -3956,7 +4329,7 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 	if (count & 1)
 	{
 		fprintf(stderr, "sanity check(2): %d not even\n", count);
-		return;
+		return TRUE;
 	}
 
 	for (i = 0; i < count; i += 2)
@@ -3964,13 +4337,13 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 		if (tokens[i].type != JSMN_STRING)
 		{
 			fprintf(stderr, "sanity check(3): [%d] not string\n", i);
-			return;
+			return TRUE;
 		}
 
 		if (tokens[i + 1].type != JSMN_STRING && tokens[i + 1].type != JSMN_PRIMITIVE)
 		{
 			fprintf(stderr, "sanity check(3a): [%d] wrong type\n", i + 1);
-			return;
+			return TRUE;
 		}
 
 		buf[tokens[i + 0].end] = '\0';
@@ -3980,19 +4353,29 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 		if (tokens[i + 1].type == JSMN_STRING && !json_unescape_str(&buf[tokens[i + 1].start]))
 		{
 			fprintf(stderr, "sanity check(3b): [%d] cannot unescape string\n", i + 1);
-			return;
+			return TRUE;
 		}
 	}
 
 	{
 		const char *tok_req = json_find_attr(buf, tokens, count, "req");
+#ifdef SHARKD_SHARED_SUPPORT
+		gboolean shared;
+#endif
 
 		if (!tok_req)
 		{
 			fprintf(stderr, "sanity check(4): no \"req\".\n");
-			return;
+			return TRUE;
 		}
 
+		if (!strcmp(tok_req, "bye"))
+			return FALSE;
+
+#ifdef SHARKD_SHARED_SUPPORT
+		shared = sharkd_session_lock(tok_req, buf, tokens, count);
+#endif
+
 		if (!strcmp(tok_req, "load"))
 			sharkd_session_process_load(buf, tokens, count);
 		else if (!strcmp(tok_req, "status"))
@@ -4023,16 +4406,21 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 			sharkd_session_process_dumpconf(buf, tokens, count);
 		else if (!strcmp(tok_req, "download"))
 			sharkd_session_process_download(buf, tokens, count);
-		else if (!strcmp(tok_req, "bye"))
-			exit(0);
 		else
 			fprintf(stderr, "::: req = %s\n", tok_req);
 
+#ifdef SHARKD_SHARED_SUPPORT
+		if (shared)
+			g_rw_lock_reader_unlock(&session_lock);
+		else
+			g_rw_lock_writer_unlock(&session_lock);
+#endif
+
 		/* reply for every command are 0+ lines of JSON reply (outputed above), finished by empty new line */
-		printf("\n");
+		sharkd_printf("\n");
 
 		/*
-		 * We do an explicit fflush after every line, because
+		 * We do an explicit flush after every reply, because
 		 * we want output to be written to the socket as soon
 		 * as the line is complete.
 		 *
@@ -4045,31 +4433,89 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 		 * which is too inefficient, and full buffering,
 		 * which is what you get if you request line buffering.
 		 */
-		fflush(stdout);
+		sharkd_output_flush(sharkd_session_out());
 	}
+
+	return TRUE;
 }
 
-int
-sharkd_session_main(void)
+static void
+sharkd_session_init(void)
 {
-	char buf[2 * 1024];
-	jsmntok_t *tokens = NULL;
-	int tokens_max = -1;
+	if (!filter_table)
+		filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, sharkd_session_filter_free);
+}
 
-	fprintf(stderr, "Hello in child.\n");
+/*
+ * Longest request we'll take; far more than any filter or column list
+ * needs, but small enough that a client can't make us buffer without
+ * limit.
+ */
+#define SHARKD_MAX_REQUEST_LEN (1024 * 1024)
 
-	filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
+/*
+ * Read a line of up to SHARKD_MAX_REQUEST_LEN bytes.  A longer line is
+ * read and thrown away, and *too_long is set.
+ */
+static gboolean
+sharkd_session_read_line(FILE *in, GString *line, gboolean *too_long)
+{
+	char chunk[2 * 1024];
+	gsize len = 0;
+
+	g_string_truncate(line, 0);
+	*too_long = FALSE;
+	while (fgets(chunk, sizeof(chunk), in))
+	{
+		gsize chunk_len = strlen(chunk);
+
+		len += chunk_len;
+		if (len > SHARKD_MAX_REQUEST_LEN)
+		{
+			*too_long = TRUE;
+			g_string_truncate(line, 0);
+		}
+		else
+			g_string_append_len(line, chunk, chunk_len);
+		if (chunk_len > 0 && chunk[chunk_len - 1] == '\n')
+			return TRUE;
+	}
+
+	return (len > 0);
+}
+
+/* Serve one session's requests, read from in; replies go to sharkd_session_out(). */
+static int
+sharkd_session_serve(FILE *in)
+{
+	GString *line = g_string_sized_new(2 * 1024);
+	char *buf;
+	jsmntok_t *tokens = NULL;
+	int tokens_max = -1;
+	int status = 0;
+	gboolean too_long;
 
-	while (fgets(buf, sizeof(buf), stdin))
+	while (sharkd_session_read_line(in, line, &too_long))
 	{
 		/* every command is line seperated JSON */
 		int ret;
 
+		if (too_long)
+		{
+			fprintf(stderr, "request longer than %d bytes -> rejecting\n", SHARKD_MAX_REQUEST_LEN);
+			sharkd_printf("{\"err\":%d}\n\n", E2BIG);
+			sharkd_output_flush(sharkd_session_out());
+			continue;
+		}
+
+		buf = line->str;
+
 		ret = wsjsmn_parse(buf, NULL, 0);
 		if (ret < 0)
 		{
 			fprintf(stderr, "invalid JSON -> closing\n");
-			return 1;
+			status = 1;
+			break;
 		}
 
 		/* fprintf(stderr, "JSON: %d tokens\n", ret); */
@@ -4087,18 +4533,130 @@ sharkd_session_main(void)
 		if (ret < 0)
 		{
 			fprintf(stderr, "invalid JSON(2) -> closing\n");
-			return 2;
+			status = 2;
+			break;
 		}
 
-		sharkd_session_process(buf, tokens, ret);
+		if (!sharkd_session_process(buf, tokens, ret))
+			break;
 	}
 
-	g_hash_table_destroy(filter_table);
 	g_free(tokens);
+	g_string_free(line, TRUE);
 
-	return 0;
+	return status;
+}
+
+int
+sharkd_session_main(void)
+{
+	int status;
+
+	fprintf(stderr, "Hello in child.\n");
+
+	sharkd_session_init();
+	status = sharkd_session_serve(stdin);
+	g_hash_table_destroy(filter_table);
+	filter_table = NULL;
+
+	return status;
+}
+
+#ifdef SHARKD_SHARED_SUPPORT
+int
+sharkd_session_shared_load(const char *fname)
+{
+	int err = 0;
+
+	sharkd_session_init();
+
+	if (sharkd_cf_open(fname, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
+		return (err != 0) ? err : EINVAL;
+
+	TRY
+	{
+		err = sharkd_load_cap_file();
+	}
+	CATCH(OutOfMemoryError)
+	{
+		err = ENOMEM;
+	}
+	ENDTRY;
+
+	if (err == 0)
+		shared_capture = TRUE;
+
+	return err;
 }
 
+/* Pushed by a session thread to stop its writer thread. */
+static GString sharkd_output_end;
+
+/* Write a session's replies to its client as the pieces come in. */
+static gpointer
+sharkd_session_writer(gpointer data)
+{
+	struct sharkd_output *out = (struct sharkd_output *) data;
+	GString *chunk;
+
+	while ((chunk = (GString *) g_async_queue_pop(out->chunks)) != &sharkd_output_end)
+	{
+		fwrite(chunk->str, 1, chunk->len, out->fp);
+		g_string_free(chunk, TRUE);
+		if (g_async_queue_length(out->chunks) <= 0)
+			fflush(out->fp);
+	}
+	fflush(out->fp);
+
+	return NULL;
+}
+
+static gpointer
+sharkd_session_thread(gpointer data)
+{
+	int fd = GPOINTER_TO_INT(data);
+	FILE *in = fdopen(fd, "r");
+	struct sharkd_output out;
+	GThread *writer;
+
+	out.fp = fdopen(dup(fd), "w");
+	out.buf = g_string_sized_new(SHARKD_OUTPUT_CHUNK);
+	out.chunks = NULL;
+
+	if (in && out.fp)
+	{
+		out.chunks = g_async_queue_new();
+		writer = g_thread_new("sharkd writer", sharkd_session_writer, &out);
+
+		g_private_set(&session_out, &out);
+		sharkd_session_serve(in);
+		g_private_set(&session_out, NULL);
+
+		sharkd_output_flush(&out);
+		g_async_queue_push(out.chunks, &sharkd_output_end);
+		g_thread_join(writer);
+		g_async_queue_unref(out.chunks);
+	}
+
+	g_string_free(out.buf, TRUE);
+	if (out.fp)
+		fclose(out.fp);
+	if (in)
+		fclose(in);
+	else
+		close(fd);
+
+	return NULL;
+}
+
+void
+sharkd_session_shared_start(int fd)
+{
+	g_thread_unref(g_thread_new("sharkd session", sharkd_session_thread, GINT_TO_POINTER(fd)));
+}
+#endif
+
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
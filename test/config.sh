@@ -69,6 +69,7 @@ TSHARK=$WS_BIN_PATH/tshark
 RAWSHARK=$WS_BIN_PATH/rawshark
 CAPINFOS=$WS_BIN_PATH/capinfos
 MERGECAP=$WS_BIN_PATH/mergecap
+EDITCAP=$WS_BIN_PATH/editcap
 TEXT2PCAP=$WS_BIN_PATH/text2pcap
 DUMPCAP=$WS_BIN_PATH/dumpcap
 
@@ -117,6 +118,12 @@ HAVE_LUA=$?
 echo "$TSHARK_VERSION" | grep -q "with nghttp2"
 HAVE_NGHTTP2=$?
 
+# Check which compressed file formats we can write and read back.
+echo "$TSHARK_VERSION" | grep -q "with Zstandard"
+HAVE_ZSTD=$?
+echo "$TSHARK_VERSION" | grep -q "with LZ4"
+HAVE_LZ4=$?
+
 # Check whether we need to skip a certain decryption test.
 # XXX What do we print for Nettle?
 echo "$TSHARK_VERSION" | egrep -q "with MIT Kerberos|with Heimdal Kerberos"
@@ -0,0 +1,23 @@
+----------------------------------------
+-- script-name: field_occurrence.lua
+-- Adds two fields with the same name to every packet, interleaved, so
+-- that the order of "-T fields" values can be checked. The values of
+-- "occ.value" are 1, 2, 3 and 4, in tree order.
+----------------------------------------
+
+local occ = Proto("occ", "Field occurrence test")
+
+local f_a = ProtoField.uint8("occ.value", "Value A")
+local f_b = ProtoField.uint8("occ.value", "Value B")
+
+occ.fields = { f_a, f_b }
+
+function occ.dissector(tvb, pinfo, tree)
+    local subtree = tree:add(occ, tvb(0, 1))
+    subtree:add(f_b, tvb(0, 1), 1)
+    local inner = subtree:add(f_a, tvb(0, 1), 2)
+    inner:add(f_b, tvb(0, 1), 3)
+    subtree:add(f_a, tvb(0, 1), 4)
+end
+
+register_postdissector(occ)
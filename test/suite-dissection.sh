@@ -42,8 +42,25 @@ dissection_http2_data_reassembly_test() {
 	return
 }
 
+# ip.addr is added for the source address and then the destination.
+dissection_fields_occurrence_test() {
+	local occurrence expected output
+	for occurrence in a:192.168.0.1,192.168.0.10 f:192.168.0.1 l:192.168.0.10 ; do
+		expected=${occurrence#*:}
+		occurrence=${occurrence%%:*}
+		output=$($TSHARK -r ${CAPTURE_DIR}/dhcp.pcap -Y frame.number==2 \
+			-T fields -e ip.addr -E occurrence=$occurrence 2>&1)
+		if [ $? -ne 0 ] || [ "$output" != "$expected" ]; then
+			test_step_failed "occurrence=$occurrence wrote \"$output\", expected \"$expected\""
+			return
+		fi
+	done
+	test_step_ok
+}
+
 dissection_suite() {
 	test_step_add "testing http2 data reassembly" dissection_http2_data_reassembly_test
+	test_step_add "testing -T fields occurrence" dissection_fields_occurrence_test
 }
 
 #
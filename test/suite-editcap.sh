@@ -0,0 +1,198 @@
+#!/bin/bash
+#
+# Run the editcap unit tests
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# Run editcap on testin.pcap and check the number of packets it kept.
+# arg 1 = expected number of packets in testout.pcap
+# remaining args = editcap options
+editcap_packet_count_check() {
+	local expected=$1
+	shift
+
+	$EDITCAP "$@" ./testin.pcap ./testout.pcap > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./testout.txt
+		test_step_failed "exit status of editcap: $RETURNVALUE"
+		return
+	fi
+
+	$CAPINFOS -c ./testout.pcap > ./capinfo_testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./capinfo_testout.txt
+		test_step_failed "exit status of capinfos: $RETURNVALUE"
+		return
+	fi
+
+	grep -Eiq "Number of packets:[[:blank:]]+$expected\$" ./capinfo_testout.txt
+	if [ $? -ne 0 ]; then
+		cat ./testout.txt
+		cat ./capinfo_testout.txt
+		test_step_failed "editcap $* did not keep $expected packets"
+		return
+	fi
+	test_step_ok
+}
+
+# dhcp.pcap twice over: 8 packets, each one repeated 4 packets later.
+editcap_dup_prepare() {
+	$MERGECAP -a -F pcap -w ./testin.pcap "${CAPTURE_DIR}dhcp.pcap" "${CAPTURE_DIR}dhcp.pcap" > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./testout.txt
+		test_step_failed "exit status of mergecap: $RETURNVALUE"
+		return 1
+	fi
+	return 0
+}
+
+# -D 5 compares each packet with the previous 4, so the repeats are dropped.
+editcap_step_dup_window() {
+	editcap_dup_prepare || return
+	editcap_packet_count_check 4 -D 5
+}
+
+# -D 4 compares each packet with the previous 3, so nothing is dropped.
+editcap_step_dup_window_short() {
+	editcap_dup_prepare || return
+	editcap_packet_count_check 8 -D 4
+}
+
+# -D 0 keeps no window at all; with -v it still hashes every packet.
+editcap_step_dup_window_zero() {
+	editcap_dup_prepare || return
+	editcap_packet_count_check 8 -v -D 0
+}
+
+# Write dhcp.pcap compressed, check that capinfos reports the compression,
+# then read it back and check that it's the same as writing it uncompressed.
+# arg 1 = compressed file name extension
+# arg 2 = compression type as capinfos reports it
+editcap_compression_round_trip() {
+	local extension=$1
+	local description=$2
+
+	$EDITCAP -F pcapng "${CAPTURE_DIR}dhcp.pcap" ./testout.pcapng > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./testout.txt
+		test_step_failed "exit status of editcap: $RETURNVALUE"
+		return
+	fi
+
+	$EDITCAP -F pcapng "${CAPTURE_DIR}dhcp.pcap" ./testout.pcapng.$extension > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./testout.txt
+		test_step_failed "exit status of editcap writing .$extension: $RETURNVALUE"
+		return
+	fi
+
+	$CAPINFOS -t -c ./testout.pcapng.$extension > ./capinfo_testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./capinfo_testout.txt
+		test_step_failed "exit status of capinfos: $RETURNVALUE"
+		return
+	fi
+	grep -q "($description compressed)" ./capinfo_testout.txt
+	if [ $? -ne 0 ]; then
+		cat ./capinfo_testout.txt
+		test_step_failed "capinfos didn't report $description compression"
+		return
+	fi
+	grep -Eiq "Number of packets:[[:blank:]]+4\$" ./capinfo_testout.txt
+	if [ $? -ne 0 ]; then
+		cat ./capinfo_testout.txt
+		test_step_failed "the .$extension file doesn't have 4 packets"
+		return
+	fi
+
+	$EDITCAP -F pcapng ./testout.pcapng.$extension ./testout_rt.pcapng > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat ./testout.txt
+		test_step_failed "exit status of editcap reading .$extension: $RETURNVALUE"
+		return
+	fi
+	cmp -s ./testout.pcapng ./testout_rt.pcapng
+	if [ $? -ne 0 ]; then
+		test_step_failed "the .$extension file didn't read back the same"
+		return
+	fi
+	test_step_ok
+}
+
+editcap_step_zstd_round_trip() {
+	if [ $HAVE_ZSTD -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+	editcap_compression_round_trip zst Zstandard
+}
+
+editcap_step_lz4_round_trip() {
+	if [ $HAVE_LZ4 -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+	editcap_compression_round_trip lz4 LZ4
+}
+
+editcap_cleanup_step() {
+	rm -f ./testin.pcap
+	rm -f ./testout.txt
+	rm -f ./capinfo_testout.txt
+	rm -f ./testout.pcap
+	rm -f ./testout.pcapng ./testout.pcapng.zst ./testout.pcapng.lz4
+	rm -f ./testout_rt.pcapng
+}
+
+editcap_suite() {
+	test_step_set_pre editcap_cleanup_step
+	test_step_set_post editcap_cleanup_step
+	test_step_add "Duplicate window -D 5" editcap_step_dup_window
+	test_step_add "Duplicate window -D 4" editcap_step_dup_window_short
+	test_step_add "Duplicate window -D 0" editcap_step_dup_window_zero
+	test_step_add "Zstandard round trip" editcap_step_zstd_round_trip
+	test_step_add "LZ4 round trip" editcap_step_lz4_round_trip
+}
+
+#
+# Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+#
+# Local variables:
+# sh-basic-offset: 8
+# tab-width: 8
+# indent-tabs-mode: t
+# End:
+#
+# vi: set shiftwidth=8 tabstop=8 noexpandtab:
+# :indentSize=8:tabSize=8:noTabs=false:
+#
@@ -222,12 +222,101 @@ mergecap_step_3_pcapng_any_pcapng_test() {
 	test_step_ok
 }
 
+# print a 32-bit value as little-endian printf escapes into variable $1
+# arg 1 = variable name
+# arg 2 = value
+mergecap_le32() {
+	printf -v $1 '\\x%02x\\x%02x\\x%02x\\x%02x' \
+		$(( $2 & 255 )) $(( ($2 >> 8) & 255 )) \
+		$(( ($2 >> 16) & 255 )) $(( ($2 >> 24) & 255 ))
+}
+
+# write a synthetic pcap whose time stamps interleave with those of every
+# other file written by this function
+# arg 1 = output file name
+# arg 2 = file number, 0-999
+# arg 3 = number of records
+# arg 4 = last byte of the source MAC address, 1 if not given
+mergecap_synthetic_pcap() {
+	local hdr usec secs len data src
+	local out='\xd4\xc3\xb2\xa1\x02\x00\x04\x00\x00\x00\x00\x00\x00\x00\x00\x00\xff\xff\x00\x00\x01\x00\x00\x00'
+	mergecap_le32 usec $(( $2 * 1000 ))
+	mergecap_le32 len 14
+	printf -v src '\\x%02x' ${4:-1}
+	data="\\xff\\xff\\xff\\xff\\xff\\xff\\x00\\x00\\x00\\x00\\x00$src\\x08\\x00"
+	for (( j = 0; j < $3; j++ )); do
+		mergecap_le32 secs $(( 1500000000 + j ))
+		out="$out$secs$usec$len$len$data"
+	done
+	printf '%b' "$out" > "$1"
+}
+
+# records with the same time stamp are written last file first
+mergecap_step_tie_pcap_pcap_test() {
+	local expected="00:00:00:00:00:03 00:00:00:00:00:02 00:00:00:00:00:01"
+	expected="$expected $expected"
+
+	mkdir -p ./mergecap_in
+	for (( i = 1; i <= 3; i++ )); do
+		mergecap_synthetic_pcap ./mergecap_in/tie$i.pcap 0 2 $i
+	done
+
+	for read_ahead in 0 8; do
+		$MERGECAP -vF pcap --read-ahead $read_ahead -w testout.pcap \
+			./mergecap_in/tie1.pcap ./mergecap_in/tie2.pcap ./mergecap_in/tie3.pcap > testout.txt 2>&1
+		RETURNVALUE=$?
+		mergecap_common_pcap_pkt $RETURNVALUE 6
+		ORDER=$( $TSHARK -r testout.pcap -T fields -e eth.src | tr -d '\r' | tr '\n' ' ' | sed 's/ $//' )
+		if [ "$ORDER" != "$expected" ]; then
+			echo "got:      $ORDER"
+			echo "expected: $expected"
+			test_step_failed "mergecap --read-ahead $read_ahead wrote tied records in the wrong order"
+			return
+		fi
+	done
+	test_step_ok
+}
+
+mergecap_step_1000_pcap_pcap_test() {
+	if [ $( ulimit -n ) != "unlimited" ] && [ $( ulimit -n ) -lt 1024 ]; then
+		test_step_skipped
+		return
+	fi
+
+	mkdir -p ./mergecap_in
+	for (( i = 0; i < 1000; i++ )); do
+		mergecap_synthetic_pcap ./mergecap_in/in$i.pcap $i 10
+	done
+
+	# check the result of a merge with read-ahead
+	$MERGECAP -vF pcap --read-ahead 8 -w testout.pcap ./mergecap_in/in*.pcap > testout.txt 2>&1
+	RETURNVALUE=$?
+	mergecap_common_pcap_pkt $RETURNVALUE 10000
+	$CAPINFOS -o ./testout.pcap > capinfo_testout.txt 2>&1
+	grep -Eiq "Strict time order:[[:blank:]]+True" capinfo_testout.txt
+	if [ $? -ne 0 ]; then
+		cat ./capinfo_testout.txt
+		test_step_failed "mergecap output is not in chronological order"
+		return
+	fi
+
+	# and time it against a merge without read-ahead
+	TIMEFORMAT=%R
+	{ time $MERGECAP -F pcap -w testout.pcap ./mergecap_in/in*.pcap ; } 2> testout.txt
+	test_remark_add "1000 files merged in $( tail -1 testout.txt )s"
+	{ time $MERGECAP -F pcap --read-ahead 64 -w testout.pcap ./mergecap_in/in*.pcap ; } 2> testout.txt
+	test_remark_add "1000 files merged with --read-ahead 64 in $( tail -1 testout.txt )s"
+	unset TIMEFORMAT
+	test_step_ok
+}
+
 
 mergecap_cleanup_step() {
 	rm -f ./testout.txt
 	rm -f ./capinfo_testout.txt
 	rm -f ./testout.pcap
 	rm -f ./testin.pcap
+	rm -rf ./mergecap_in
 }
 
 mergecap_suite() {
@@ -250,6 +339,9 @@ mergecap_suite() {
 	test_step_add "3 pcapngs in -> pcapng out; merge mode none" mergecap_step_3_pcapng_none_pcapng_test
 	test_step_add "3 pcapngs in -> pcapng out; merge mode all" mergecap_step_3_pcapng_all_pcapng_test
 	test_step_add "3 pcapngs in -> pcapng out; merge mode any" mergecap_step_3_pcapng_any_pcapng_test
+
+	test_step_add "3 pcaps with the same time stamps in -> pcap out" mergecap_step_tie_pcap_pcap_test
+	test_step_add "1000 pcaps in -> pcap out; read-ahead" mergecap_step_1000_pcap_pcap_test
 }
 
 #
@@ -38,6 +38,12 @@ TOOL_SEARCH_PATHS="
 	$SOURCE_DIR/epan
 	$WS_BIN_PATH/epan/wmem
 	$SOURCE_DIR/epan/wmem
+	$WS_BIN_PATH/ui
+	$SOURCE_DIR/ui
+	$WS_BIN_PATH/wiretap
+	$SOURCE_DIR/wiretap
+	$WS_BIN_PATH/wsutil
+	$SOURCE_DIR/wsutil
 	$WS_BIN_PATH/tools
 	$SOURCE_DIR/tools
 "
@@ -45,7 +51,7 @@ TOOL_SEARCH_PATHS="
 check_dut() {
 	TEST_EXE=""
 	# WS_BIN_PATH must be checked first, otherwise
-	# we'll find a non-functional program in epan or epan/wmem.
+	# we'll find a non-functional program in epan, epan/wmem, ui, wiretap or wsutil.
 	for TEST_PATH in $TOOL_SEARCH_PATHS ; do
 		if [ -x "$TEST_PATH/$1" ]; then
 			TEST_EXE=$TEST_PATH/$1
@@ -68,24 +74,78 @@ check_dut() {
 	fi
 }
 
+unittests_step_arrow_writer_test() {
+	check_dut arrow_writer_test || return
+	ARGS=$TESTS_DIR/baseline/arrow-writer.arrow
+	unittests_step_test
+}
+
+unittests_step_bitmap_test() {
+	check_dut bitmap_test || return
+	ARGS=
+	unittests_step_test
+}
+
+unittests_step_column_text_store_test() {
+	check_dut column_text_store_test || return
+	ARGS=
+	unittests_step_test
+}
+
+unittests_step_dfilter_test() {
+	check_dut dfilter_test || return
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	check_dut exntest || return
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_file_wrappers_test() {
+	check_dut file_wrappers_test || return
+	ARGS=
+	unittests_step_test
+}
+
+unittests_step_frame_index_test() {
+	check_dut frame_index_test || return
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_oids_test() {
 	check_dut oids_test || return
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_read_pipeline_test() {
+	check_dut read_pipeline_test || return
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_reassemble_test() {
 	check_dut reassemble_test || return
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_shm_ring_test() {
+	check_dut shm_ring_test || return
+	ARGS=
+	unittests_step_test
+}
+
+unittests_step_tcp_stream_test() {
+	check_dut tcp_stream_test || return
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_tvbtest() {
 	check_dut tvbtest || return
 	ARGS=
@@ -117,9 +177,18 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "arrow_writer_test" unittests_step_arrow_writer_test
+	test_step_add "bitmap_test" unittests_step_bitmap_test
+	test_step_add "column_text_store_test" unittests_step_column_text_store_test
+	test_step_add "dfilter_test" unittests_step_dfilter_test
 	test_step_add "exntest" unittests_step_exntest
+	test_step_add "file_wrappers_test" unittests_step_file_wrappers_test
+	test_step_add "frame_index_test" unittests_step_frame_index_test
 	test_step_add "oids_test" unittests_step_oids_test
+	test_step_add "read_pipeline_test" unittests_step_read_pipeline_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
+	test_step_add "shm_ring_test" unittests_step_shm_ring_test
+	test_step_add "tcp_stream_test" unittests_step_tcp_stream_test
 	test_step_add "tvbtest" unittests_step_tvbtest
 	test_step_add "wmem_test" unittests_step_wmem_test
 	test_step_add "ftsanity.py" unittests_step_ftsanity
@@ -159,6 +159,37 @@ wslua_step_field_test() {
 	fi
 }
 
+# Fields with the same name must be written in tree order.
+wslua_step_field_occurrence_test() {
+	if [ $HAVE_LUA -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+
+	local occurrence expected
+	for occurrence in a:1,2,3,4 f:1 l:4 ; do
+		expected=${occurrence#*:}
+		occurrence=${occurrence%%:*}
+		$TSHARK -r $CAPTURE_DIR/dhcp.pcap -c 1 \
+			-X lua_script:$TESTS_DIR/lua/field_occurrence.lua \
+			-T fields -e occ.value -E occurrence=$occurrence > testout.txt 2>&1
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			echo
+			cat ./testout.txt
+			test_step_failed "occurrence=$occurrence exit status of $DUT: $RETURNVALUE"
+			return
+		fi
+		if [ "$(cat testout.txt)" != "$expected" ]; then
+			echo
+			cat ./testout.txt
+			test_step_failed "occurrence=$occurrence wrote \"$(cat testout.txt)\", expected \"$expected\""
+			return
+		fi
+	done
+	test_step_ok
+}
+
 wslua_step_file_test() {
 	if [ $HAVE_LUA -ne 0 ]; then
 		test_step_skipped
@@ -499,6 +530,7 @@ wslua_suite() {
 	test_step_add "wslua dir" wslua_step_dir_test
 	test_step_add "wslua dissector" wslua_step_dissector_test
 	test_step_add "wslua field/fieldinfo" wslua_step_field_test
+	test_step_add "wslua field occurrence" wslua_step_field_occurrence_test
 	test_step_add "wslua file" wslua_step_file_test
 	test_step_add "wslua globals" wslua_step_globals_test
 	# GRegex tests are broken since PCRE 8.34, see bug 12997.
@@ -56,6 +56,7 @@ Usage: $THIS [-c] [-h] [-s <suite>]
       capture
       clopts
       decryption
+      editcap
       fileformats
       io
       nameres
@@ -110,6 +111,7 @@ source $TESTS_DIR/suite-decryption.sh
 source $TESTS_DIR/suite-nameres.sh
 source $TESTS_DIR/suite-wslua.sh
 source $TESTS_DIR/suite-mergecap.sh
+source $TESTS_DIR/suite-editcap.sh
 source $TESTS_DIR/suite-text2pcap.sh
 source $TESTS_DIR/suite-dissection.sh
 
@@ -172,6 +174,7 @@ test_suite() {
 	test_suite_add "Name Resolution" name_resolution_suite
 	test_suite_add "Lua API" wslua_suite
 	test_suite_add "Mergecap" mergecap_suite
+	test_suite_add "Editcap" editcap_suite
 	test_suite_add "File formats" fileformats_suite
 	test_suite_add "Text2pcap" text2pcap_suite
 	test_suite_add "Dissection" dissection_suite
@@ -205,6 +208,9 @@ if [ -n "$RUN_SUITE" ] ; then
 		"decryption")
 			test_suite_run "Decryption" decryption_suite
 			exit $? ;;
+		"editcap")
+			test_suite_run "Editcap" editcap_suite
+			exit $? ;;
 		"fileformats")
 			test_suite_run "File formats" fileformats_suite
 			exit $? ;;
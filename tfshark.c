@@ -1149,6 +1149,8 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -1592,6 +1594,8 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
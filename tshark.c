@@ -26,6 +26,8 @@
 
 #ifdef _WIN32
 # include <winsock2.h>
+# include <io.h>     /* for _setmode */
+# include <fcntl.h>  /* for O_BINARY */
 #endif
 
 #ifndef _WIN32
@@ -171,7 +173,8 @@ typedef enum {
   WRITE_FIELDS, /* User defined list of fields */
   WRITE_JSON,   /* JSON */
   WRITE_JSON_RAW,   /* JSON only raw hex */
-  WRITE_EK      /* JSON bulk insert to Elasticsearch */
+  WRITE_EK,     /* JSON bulk insert to Elasticsearch */
+  WRITE_ARROW   /* User defined list of fields, as Apache Arrow record batches */
   /* Add CSV and the like here */
 } output_action_e;
 
@@ -234,6 +237,7 @@ static char *output_file_name;
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, gboolean tree, gboolean visual);
+static gboolean print_tree_visible(void);
 static gboolean process_cap_file(capture_file *, char *, int, gboolean, int, gint64);
 static gboolean process_packet_single_pass(capture_file *cf,
     epan_dissect_t *edt, gint64 offset, wtap_rec *rec,
@@ -401,15 +405,15 @@ print_usage(FILE *output)
   fprintf(output, "  -P                       print packet summary even when writing to a file\n");
   fprintf(output, "  -S <separator>           the line separator to print between packets\n");
   fprintf(output, "  -x                       add output of hex and ASCII dump (Packet Bytes)\n");
-  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|?\n");
+  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|arrow|?\n");
   fprintf(output, "                           format of text output (def: text)\n");
   fprintf(output, "  -j <protocolfilter>      protocols layers filter if -T ek|pdml|json selected\n");
   fprintf(output, "                           (e.g. \"ip ip.flags text\", filter does not expand child\n");
   fprintf(output, "                           nodes, unless child is specified also in the filter)\n");
   fprintf(output, "  -J <protocolfilter>      top level protocol filter if -T ek|pdml|json selected\n");
   fprintf(output, "                           (e.g. \"http tcp\", filter which expands all child nodes)\n");
-  fprintf(output, "  -e <field>               field to print if -Tfields selected (e.g. tcp.port,\n");
-  fprintf(output, "                           _ws.col.Info)\n");
+  fprintf(output, "  -e <field>               field to print if -Tfields or -Tarrow selected\n");
+  fprintf(output, "                           (e.g. tcp.port, _ws.col.Info)\n");
   fprintf(output, "                           this option can be repeated to print multiple fields\n");
   fprintf(output, "  -E<fieldsoption>=<value> set options for output when -Tfields selected:\n");
   fprintf(output, "     bom=y|n               print a UTF-8 BOM\n");
@@ -1285,6 +1289,10 @@ main(int argc, char *argv[])
         output_action = WRITE_FIELDS;
         print_details = TRUE;   /* Need full tree info */
         print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(optarg, "arrow") == 0) {
+        output_action = WRITE_ARROW;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
       } else if (strcmp(optarg, "json") == 0) {
         output_action = WRITE_JSON;
         print_details = TRUE;   /* Need details */
@@ -1302,6 +1310,8 @@ main(int argc, char *argv[])
         cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", optarg);                   /* x */
         cmdarg_err_cont("\t\"fields\"  The values of fields specified with the -e option, in a form\n"
                         "\t          specified by the -E option.\n"
+                        "\t\"arrow\"   The values of fields specified with the -e option, as typed\n"
+                        "\t          columns in the Apache Arrow IPC streaming format.\n"
                         "\t\"pdml\"    Packet Details Markup Language, an XML-based format for the\n"
                         "\t          details of a decoded packet. This information is equivalent to\n"
                         "\t          the packet details printed with the -V flag.\n"
@@ -1462,14 +1472,14 @@ main(int argc, char *argv[])
   }
 
   /* If we specified output fields, but not the output field type... */
-  if ((WRITE_FIELDS != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
+  if ((WRITE_FIELDS != output_action && WRITE_ARROW != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
-            "but \"-Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
+            "but \"-Tarrow, -Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
         exit_status = INVALID_OPTION;
         goto clean_exit;
-  } else if (WRITE_FIELDS == output_action && 0 == output_fields_num_fields(output_fields)) {
-        cmdarg_err("\"-Tfields\" was specified, but no fields were "
-                    "specified with \"-e\".");
+  } else if ((WRITE_FIELDS == output_action || WRITE_ARROW == output_action) && 0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-T%s\" was specified, but no fields were "
+                    "specified with \"-e\".", WRITE_ARROW == output_action ? "arrow" : "fields");
 
         exit_status = INVALID_OPTION;
         goto clean_exit;
@@ -2575,6 +2585,14 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      /* dumpcap is still writing the file. */
+      wtap_set_growing(cf->provider.wth);
+#ifndef _WIN32
+      /* Read the packets from the ring dumpcap writes the file through,
+         if it does. */
+      if (cap_session->shm_ring != NULL)
+        wtap_set_shm_ring(cf->provider.wth, cap_session->shm_ring);
+#endif
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
@@ -2651,12 +2669,12 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
 
     while (to_read-- && cf->provider.wth) {
       wtap_cleareof(cf->provider.wth);
       ret = wtap_read(cf->provider.wth, &err, &err_info, &data_offset);
-      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+      reset_epan_mem(cf, edt, create_proto_tree, print_tree_visible());
       if (ret == FALSE) {
         /* read from file failed, tell the capture child to stop */
         sync_pipe_stop(cap_session);
@@ -2953,6 +2971,8 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3072,10 +3092,10 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         if (strcmp(save_file, "-") == 0) {
           /* Write to the standard output. */
           pdh = wtap_dump_open_stdout(out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, &err);
         } else {
           pdh = wtap_dump_open(save_file, out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, &err);
+              snapshot_length, wtap_name_to_compression_type(save_file), &err);
         }
     }
     else {
@@ -3083,10 +3103,10 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         if (strcmp(save_file, "-") == 0) {
           /* Write to the standard output. */
           pdh = wtap_dump_open_stdout_ng(out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, shb_hdrs, idb_inf, nrb_hdrs, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, shb_hdrs, idb_inf, nrb_hdrs, &err);
         } else {
           pdh = wtap_dump_open_ng(save_file, out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, shb_hdrs, idb_inf, nrb_hdrs, &err);
+              snapshot_length, wtap_name_to_compression_type(save_file), shb_hdrs, idb_inf, nrb_hdrs, &err);
         }
     }
 
@@ -3119,6 +3139,9 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
+  /* Decode records on other threads while we dissect them. */
+  wtap_start_read_pipeline(cf->provider.wth, 0);
+
   if (perform_two_pass_analysis) {
     frame_data *fdata;
 
@@ -3227,7 +3250,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
     }
 
     for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
@@ -3309,7 +3332,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
     }
 
     while (wtap_read(cf->provider.wth, &err, &err_info, &data_offset)) {
@@ -3317,7 +3340,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
 
       tshark_debug("tshark: processing packet #%d", framenum);
 
-      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+      reset_epan_mem(cf, edt, create_proto_tree, print_tree_visible());
 
       if (process_packet_single_pass(cf, edt, data_offset, wtap_get_rec(cf->provider.wth),
                                      wtap_get_buf_ptr(cf->provider.wth), tap_flags)) {
@@ -3469,6 +3492,8 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3558,6 +3583,14 @@ write_preamble(capture_file *cf)
     write_fields_preamble(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_ARROW:
+#ifdef _WIN32
+    /* The record batches are binary. */
+    _setmode(fileno(stdout), O_BINARY);
+#endif
+    write_arrow_preamble(output_fields, stdout);
+    return !ferror(stdout);
+
   case WRITE_JSON:
   case WRITE_JSON_RAW:
     write_json_preamble(stdout);
@@ -3937,6 +3970,11 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
     write_ek_proto_tree(output_fields, print_summary, print_hex, protocolfilter,
                         protocolfilter_flags, edt, &cf->cinfo, stdout);
     return !ferror(stdout);
+
+  case WRITE_ARROW:
+    /* Nothing else can be written between the record batches. */
+    write_arrow_proto_tree(output_fields, edt, &cf->cinfo, stdout);
+    return !ferror(stdout);
   }
 
   if (print_hex) {
@@ -3971,6 +4009,10 @@ write_finale(void)
     write_fields_finale(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_ARROW:
+    write_arrow_finale(output_fields, stdout);
+    return !ferror(stdout);
+
   case WRITE_JSON:
   case WRITE_JSON_RAW:
     write_json_finale(stdout);
@@ -4115,6 +4157,25 @@ write_failure_message(const char *filename, int err)
              filename, g_strerror(err));
 }
 
+/*
+ * The protocol tree is "visible", i.e. its items get labels, only if we're
+ * printing packet details. With -T fields and -T arrow we only print the
+ * values of the -e fields, which are primed as interesting, so all the other
+ * items can be left out of the tree unless one of the values is an item's
+ * label.
+ */
+static gboolean print_tree_visible(void)
+{
+  if (!print_packet_info || !print_details)
+    return FALSE;
+
+  if ((output_action == WRITE_FIELDS || output_action == WRITE_ARROW) &&
+      !output_fields_need_visible_tree(output_fields))
+    return FALSE;
+
+  return TRUE;
+}
+
 static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree, gboolean visual)
 {
   if (!epan_auto_reset || (cf->count < epan_auto_reset_count))
@@ -446,6 +446,15 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
         /* Attempt to open the capture file and set up to read from it. */
         switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
             case CF_OK:
+                /* The capture child is still writing the file. */
+                wtap_set_growing(((capture_file *)cap_session->cf)->provider.wth);
+#ifndef _WIN32
+                /* Read the packets from the ring the capture child writes
+                   the file through, if it does. */
+                if (cap_session->shm_ring != NULL)
+                    wtap_set_shm_ring(((capture_file *)cap_session->cf)->provider.wth,
+                                      cap_session->shm_ring);
+#endif
                 break;
             case CF_ERROR:
                 /* Don't unlink (delete) the save file - leave it around,
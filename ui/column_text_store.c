@@ -0,0 +1,443 @@
+/* column_text_store.c
+ * A memory-bounded cache of packet list column text
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui/column_text_store.h"
+
+#define BLOCK_SHIFT     12
+#define BLOCK_ROWS      (1 << BLOCK_SHIFT)
+#define BLOCK_MASK      (BLOCK_ROWS - 1)
+
+/* A block's row references are allocated a page at a time, so that rows
+ * that are far apart, e.g. the few frames that pass a display filter,
+ * don't each cost a whole block's worth of references. */
+#define PAGE_SHIFT      6
+#define PAGE_ROWS       (1 << PAGE_SHIFT)
+#define PAGE_MASK       (PAGE_ROWS - 1)
+#define BLOCK_PAGES     (BLOCK_ROWS / PAGE_ROWS)
+
+#define MIN_TEXT_SIZE   64
+
+/* A row reference with this bit set is a dictionary index. Otherwise it's
+ * an offset into the block's text plus one. Zero means "not stored". */
+#define REF_INTERNED    0x80000000U
+
+#define DICT_MAX_STRINGS    65536
+#define DICT_MAX_BYTES      (4 * 1024 * 1024)
+
+typedef struct {
+    guint32 *pages[BLOCK_PAGES];
+    guint32  num_pages;
+    gchar   *text;
+    guint32  text_len;
+    guint32  text_size;
+    guint64  last_used;
+    int      column;
+    guint32  index;
+} text_block_t;
+
+typedef struct {
+    gboolean       interned;
+    text_block_t **blocks;          /* indexed by row >> BLOCK_SHIFT */
+    guint32        num_blocks;
+
+    /* Dictionary of interned strings. */
+    gchar         *dict_text;
+    gsize          dict_len;
+    gsize          dict_size;
+    guint32       *dict_offsets;    /* by string index */
+    guint32        dict_count;
+    guint32        dict_offsets_size;
+    guint32       *dict_slots;      /* open-addressed, string index + 1 */
+    guint32        dict_mask;
+} text_column_t;
+
+struct _column_text_store_t {
+    text_column_t *columns;
+    int            num_columns;
+    gsize          budget;
+    gsize          size;
+    guint64        tick;
+};
+
+column_text_store_t *
+column_text_store_new(gsize budget)
+{
+    column_text_store_t *store = g_new0(column_text_store_t, 1);
+
+    store->budget = budget;
+    return store;
+}
+
+static void
+free_block(column_text_store_t *store, text_column_t *col, text_block_t *block)
+{
+    guint32 i;
+
+    col->blocks[block->index] = NULL;
+    store->size -= sizeof(text_block_t) + block->text_size;
+    store->size -= block->num_pages * PAGE_ROWS * sizeof(guint32);
+    for (i = 0; i < BLOCK_PAGES; i++) {
+        g_free(block->pages[i]);
+    }
+    g_free(block->text);
+    g_free(block);
+}
+
+/* Returns the row's reference, or 0 if it isn't stored. */
+static guint32
+block_ref(const text_block_t *block, guint32 row)
+{
+    const guint32 *page = block->pages[(row & BLOCK_MASK) >> PAGE_SHIFT];
+
+    return page ? page[row & PAGE_MASK] : 0;
+}
+
+static void
+free_column(column_text_store_t *store, text_column_t *col)
+{
+    guint32 i;
+
+    for (i = 0; i < col->num_blocks; i++) {
+        if (col->blocks[i]) {
+            free_block(store, col, col->blocks[i]);
+        }
+    }
+    store->size -= col->num_blocks * sizeof(text_block_t *);
+    store->size -= col->dict_size + col->dict_offsets_size * sizeof(guint32);
+    if (col->dict_slots) {
+        store->size -= (col->dict_mask + 1) * sizeof(guint32);
+    }
+    g_free(col->blocks);
+    g_free(col->dict_text);
+    g_free(col->dict_offsets);
+    g_free(col->dict_slots);
+    memset(col, 0, sizeof(*col));
+}
+
+void
+column_text_store_free(column_text_store_t *store)
+{
+    if (!store) {
+        return;
+    }
+    column_text_store_clear(store, 0);
+    g_free(store);
+}
+
+void
+column_text_store_set_budget(column_text_store_t *store, gsize budget)
+{
+    store->budget = budget;
+}
+
+void
+column_text_store_clear(column_text_store_t *store, int num_columns)
+{
+    text_column_t *columns = num_columns > 0 ? g_new0(text_column_t, num_columns) : NULL;
+    int i;
+
+    for (i = 0; i < store->num_columns; i++) {
+        if (i < num_columns) {
+            columns[i].interned = store->columns[i].interned;
+        }
+        free_column(store, &store->columns[i]);
+    }
+    g_free(store->columns);
+    store->columns = columns;
+    store->num_columns = MAX(num_columns, 0);
+    store->size = 0;
+}
+
+int
+column_text_store_num_columns(const column_text_store_t *store)
+{
+    return store->num_columns;
+}
+
+void
+column_text_store_clear_column(column_text_store_t *store, int column, gboolean interned)
+{
+    if (column < 0 || column >= store->num_columns) {
+        return;
+    }
+    free_column(store, &store->columns[column]);
+    store->columns[column].interned = interned;
+}
+
+static guint32
+dict_hash(const gchar *str)
+{
+    /* FNV-1a */
+    guint32 hash = 2166136261U;
+
+    for (; *str; str++) {
+        hash = (hash ^ (guint8)*str) * 16777619U;
+    }
+    return hash;
+}
+
+static void
+dict_grow_slots(column_text_store_t *store, text_column_t *col)
+{
+    guint32 old_count = col->dict_slots ? col->dict_mask + 1 : 0;
+    guint32 new_count = old_count ? old_count * 2 : 256;
+    guint32 *slots = g_new0(guint32, new_count);
+    guint32 i, slot;
+
+    for (i = 0; i < col->dict_count; i++) {
+        slot = dict_hash(col->dict_text + col->dict_offsets[i]) & (new_count - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (new_count - 1);
+        }
+        slots[slot] = i + 1;
+    }
+    g_free(col->dict_slots);
+    col->dict_slots = slots;
+    col->dict_mask = new_count - 1;
+    store->size += (new_count - old_count) * sizeof(guint32);
+}
+
+/* Returns the string's index, adding it if there's room, or G_MAXUINT32. */
+static guint32
+dict_intern(column_text_store_t *store, text_column_t *col, const gchar *str)
+{
+    guint32 hash = dict_hash(str);
+    gsize len;
+    guint32 slot, idx;
+
+    if (!col->dict_slots) {
+        dict_grow_slots(store, col);
+    }
+
+    for (slot = hash & col->dict_mask; col->dict_slots[slot]; slot = (slot + 1) & col->dict_mask) {
+        idx = col->dict_slots[slot] - 1;
+        if (strcmp(col->dict_text + col->dict_offsets[idx], str) == 0) {
+            return idx;
+        }
+    }
+
+    len = strlen(str) + 1;
+    if (col->dict_count >= DICT_MAX_STRINGS || col->dict_len + len > DICT_MAX_BYTES) {
+        return G_MAXUINT32;
+    }
+
+    if (col->dict_len + len > col->dict_size) {
+        gsize new_size = MAX(col->dict_size * 2, 4096);
+        while (new_size < col->dict_len + len) {
+            new_size *= 2;
+        }
+        col->dict_text = (gchar *)g_realloc(col->dict_text, new_size);
+        store->size += new_size - col->dict_size;
+        col->dict_size = new_size;
+    }
+    if (col->dict_count == col->dict_offsets_size) {
+        guint32 new_size = MAX(col->dict_offsets_size * 2, 256);
+        col->dict_offsets = (guint32 *)g_realloc(col->dict_offsets, new_size * sizeof(guint32));
+        store->size += (new_size - col->dict_offsets_size) * sizeof(guint32);
+        col->dict_offsets_size = new_size;
+    }
+
+    idx = col->dict_count++;
+    col->dict_offsets[idx] = (guint32)col->dict_len;
+    memcpy(col->dict_text + col->dict_len, str, len);
+    col->dict_len += len;
+    col->dict_slots[slot] = idx + 1;
+
+    /* Keep the table at most half full. */
+    if (col->dict_count * 2 > col->dict_mask + 1) {
+        dict_grow_slots(store, col);
+    }
+    return idx;
+}
+
+static int
+compare_block_use(const void *a, const void *b)
+{
+    const text_block_t *block_a = *(const text_block_t * const *)a;
+    const text_block_t *block_b = *(const text_block_t * const *)b;
+
+    if (block_a->last_used < block_b->last_used) return -1;
+    if (block_a->last_used > block_b->last_used) return 1;
+    return 0;
+}
+
+/* The least a store can use: one block of each column with all of its
+ * references, so that the row being stored always fits. */
+static gsize
+min_budget(const column_text_store_t *store)
+{
+    return store->num_columns * (sizeof(text_block_t) + BLOCK_ROWS * sizeof(guint32) + MIN_TEXT_SIZE);
+}
+
+/* Free the least recently used blocks until we're down to 3/4 of our
+ * budget, so that we don't have to do this for every row. The blocks
+ * holding the row being stored are kept, whatever the budget, so that
+ * its other columns don't have to be dissected again. */
+static void
+evict_blocks(column_text_store_t *store, guint32 keep_index)
+{
+    GPtrArray *blocks = g_ptr_array_new();
+    gsize target = MAX(store->budget, min_budget(store)) / 4 * 3;
+    guint32 i;
+    int c;
+
+    for (c = 0; c < store->num_columns; c++) {
+        text_column_t *col = &store->columns[c];
+        for (i = 0; i < col->num_blocks; i++) {
+            if (col->blocks[i] && i != keep_index) {
+                g_ptr_array_add(blocks, col->blocks[i]);
+            }
+        }
+    }
+
+    qsort(blocks->pdata, blocks->len, sizeof(gpointer), compare_block_use);
+
+    for (i = 0; i < blocks->len && store->size > target; i++) {
+        text_block_t *block = (text_block_t *)g_ptr_array_index(blocks, i);
+        free_block(store, &store->columns[block->column], block);
+    }
+    g_ptr_array_free(blocks, TRUE);
+}
+
+const char *
+column_text_store_get(column_text_store_t *store, int column, guint32 row)
+{
+    text_column_t *col;
+    text_block_t *block;
+    guint32 ref;
+
+    if (column < 0 || column >= store->num_columns) {
+        return NULL;
+    }
+    col = &store->columns[column];
+    if ((row >> BLOCK_SHIFT) >= col->num_blocks || !(block = col->blocks[row >> BLOCK_SHIFT])) {
+        return NULL;
+    }
+    ref = block_ref(block, row);
+    if (!ref) {
+        return NULL;
+    }
+
+    block->last_used = ++store->tick;
+    if (ref & REF_INTERNED) {
+        return col->dict_text + col->dict_offsets[ref & ~REF_INTERNED];
+    }
+    return block->text + ref - 1;
+}
+
+void
+column_text_store_set(column_text_store_t *store, int column, guint32 row, const char *text)
+{
+    text_column_t *col;
+    text_block_t *block;
+    guint32 block_idx = row >> BLOCK_SHIFT;
+    guint32 page_idx = (row & BLOCK_MASK) >> PAGE_SHIFT;
+    guint32 *ref;
+    guint32 idx;
+
+    if (column < 0 || column >= store->num_columns || !text) {
+        return;
+    }
+    col = &store->columns[column];
+
+    if (block_idx >= col->num_blocks) {
+        guint32 num_blocks = MAX(col->num_blocks * 2, block_idx + 1);
+        col->blocks = (text_block_t **)g_realloc(col->blocks, num_blocks * sizeof(text_block_t *));
+        memset(col->blocks + col->num_blocks, 0, (num_blocks - col->num_blocks) * sizeof(text_block_t *));
+        store->size += (num_blocks - col->num_blocks) * sizeof(text_block_t *);
+        col->num_blocks = num_blocks;
+    }
+
+    block = col->blocks[block_idx];
+    if (!block) {
+        block = g_new0(text_block_t, 1);
+        block->column = column;
+        block->index = block_idx;
+        col->blocks[block_idx] = block;
+        store->size += sizeof(text_block_t);
+    }
+    block->last_used = ++store->tick;
+
+    if (!block->pages[page_idx]) {
+        block->pages[page_idx] = g_new0(guint32, PAGE_ROWS);
+        block->num_pages++;
+        store->size += PAGE_ROWS * sizeof(guint32);
+    }
+    ref = &block->pages[page_idx][row & PAGE_MASK];
+    if (*ref) {
+        return;
+    }
+
+    if (col->interned && (idx = dict_intern(store, col, text)) != G_MAXUINT32) {
+        *ref = idx | REF_INTERNED;
+    } else {
+        guint32 len = (guint32)strlen(text) + 1;
+
+        if (block->text_len + len > block->text_size) {
+            guint32 new_size = MAX(block->text_size * 2, MIN_TEXT_SIZE);
+            while (new_size < block->text_len + len) {
+                new_size *= 2;
+            }
+            block->text = (gchar *)g_realloc(block->text, new_size);
+            store->size += new_size - block->text_size;
+            block->text_size = new_size;
+        }
+        memcpy(block->text + block->text_len, text, len);
+        *ref = block->text_len + 1;
+        block->text_len += len;
+    }
+
+    if (store->size > MAX(store->budget, min_budget(store))) {
+        evict_blocks(store, block_idx);
+    }
+}
+
+gboolean
+column_text_store_has_row(const column_text_store_t *store, guint32 row)
+{
+    guint32 block_idx = row >> BLOCK_SHIFT;
+    int c;
+
+    if (store->num_columns < 1) {
+        return FALSE;
+    }
+
+    for (c = 0; c < store->num_columns; c++) {
+        const text_column_t *col = &store->columns[c];
+        if (block_idx >= col->num_blocks || !col->blocks[block_idx] ||
+                !block_ref(col->blocks[block_idx], row)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+gsize
+column_text_store_memory_size(const column_text_store_t *store)
+{
+    return sizeof(column_text_store_t) + store->num_columns * sizeof(text_column_t) + store->size;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
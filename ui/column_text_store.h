@@ -0,0 +1,136 @@
+/* column_text_store.h
+ * A memory-bounded cache of packet list column text
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef __COLUMN_TEXT_STORE_H__
+#define __COLUMN_TEXT_STORE_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Column text is stored column by column. Each column is split into
+ * blocks of 4096 rows, and each block holds a 32-bit reference per row
+ * along with one contiguous buffer for the text of those rows. The
+ * references are allocated 64 rows at a time, so a block that only has
+ * a few rows costs little more than their text.
+ *
+ * A column can also be "interned". Its strings then go into a per-column
+ * dictionary, and each row refers to a dictionary entry. This suits
+ * columns with few distinct values, such as Protocol, Source and
+ * Destination. A dictionary stops growing once it reaches 65536 strings
+ * or 4 MB. Strings that don't fit after that are stored in the block.
+ *
+ * When the store uses more memory than its budget, it frees the blocks
+ * that were used least recently. Their rows have to be dissected again
+ * the next time they're needed. The blocks holding the row being stored
+ * are never freed, so a budget smaller than one block per column acts as
+ * if it were that large.
+ */
+typedef struct _column_text_store_t column_text_store_t;
+
+/** Create an empty store.
+ *
+ * @param budget [in] Approximate number of bytes the store may use.
+ * @return A new store. Free it with column_text_store_free().
+ */
+column_text_store_t *column_text_store_new(gsize budget);
+
+/** Free a store.
+ *
+ * @param store [in] The store to free. May be NULL.
+ */
+void column_text_store_free(column_text_store_t *store);
+
+/** Change the memory budget. Blocks are freed on the next store if the
+ * store is over the new budget.
+ *
+ * @param store [in,out] The store.
+ * @param budget [in] Approximate number of bytes the store may use.
+ */
+void column_text_store_set_budget(column_text_store_t *store, gsize budget);
+
+/** Remove all text and set the number of columns. Columns that remain
+ * keep their interning setting.
+ *
+ * @param store [in,out] The store.
+ * @param num_columns [in] The number of columns.
+ */
+void column_text_store_clear(column_text_store_t *store, int num_columns);
+
+/** The number of columns.
+ *
+ * @param store [in] The store.
+ * @return The number of columns set by column_text_store_clear().
+ */
+int column_text_store_num_columns(const column_text_store_t *store);
+
+/** Remove the text of a single column, e.g. after it's been edited.
+ *
+ * @param store [in,out] The store.
+ * @param column [in] The column.
+ * @param interned [in] Whether the column's strings should be interned.
+ */
+void column_text_store_clear_column(column_text_store_t *store, int column, gboolean interned);
+
+/** Look up the text of a row.
+ *
+ * @param store [in,out] The store.
+ * @param column [in] The column.
+ * @param row [in] The row, e.g. a frame number.
+ * @return The text, or NULL if it isn't in the store. It's valid until
+ * the next call to column_text_store_set() or a clear.
+ */
+const char *column_text_store_get(column_text_store_t *store, int column, guint32 row);
+
+/** Store the text of a row if it isn't already there.
+ *
+ * @param store [in,out] The store.
+ * @param column [in] The column.
+ * @param row [in] The row, e.g. a frame number.
+ * @param text [in] The text. A copy is made.
+ */
+void column_text_store_set(column_text_store_t *store, int column, guint32 row, const char *text);
+
+/** Check whether every column of a row is in the store.
+ *
+ * @param store [in] The store.
+ * @param row [in] The row, e.g. a frame number.
+ * @return TRUE if the store has text for every column of the row.
+ */
+gboolean column_text_store_has_row(const column_text_store_t *store, guint32 row);
+
+/** The amount of memory the store takes up.
+ *
+ * @param store [in] The store.
+ * @return The number of bytes allocated for text, references and
+ * dictionaries.
+ */
+gsize column_text_store_memory_size(const column_text_store_t *store);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __COLUMN_TEXT_STORE_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
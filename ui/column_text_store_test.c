@@ -0,0 +1,238 @@
+/* column_text_store_test.c
+ * Tests for the packet list column text cache
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "ui/column_text_store.h"
+
+#define ROW_TEXT_LEN    100
+
+/* Text that differs from row to row and column to column */
+static void
+row_text(char *buf, int column, guint32 row)
+{
+    g_snprintf(buf, ROW_TEXT_LEN, "column %d row %u", column, row);
+}
+
+static void
+column_text_store_test_get_set(void)
+{
+    column_text_store_t *store = column_text_store_new(G_MAXSIZE);
+    char text[ROW_TEXT_LEN];
+    guint32 row;
+    int c;
+
+    column_text_store_clear(store, 3);
+    column_text_store_clear_column(store, 1, TRUE);
+    g_assert_cmpint(column_text_store_num_columns(store), ==, 3);
+
+    for (row = 1; row <= 10000; row++) {
+        g_assert(!column_text_store_has_row(store, row));
+        for (c = 0; c < 3; c++) {
+            g_assert(column_text_store_get(store, c, row) == NULL);
+            row_text(text, c, row);
+            column_text_store_set(store, c, row, c == 1 ? "TCP" : text);
+        }
+        g_assert(column_text_store_has_row(store, row));
+    }
+
+    for (row = 1; row <= 10000; row++) {
+        for (c = 0; c < 3; c++) {
+            row_text(text, c, row);
+            g_assert_cmpstr(column_text_store_get(store, c, row), ==, c == 1 ? "TCP" : text);
+        }
+    }
+
+    /* Text that's already there isn't replaced. */
+    column_text_store_set(store, 0, 1, "replaced");
+    row_text(text, 0, 1);
+    g_assert_cmpstr(column_text_store_get(store, 0, 1), ==, text);
+
+    /* Out of range columns are ignored. */
+    column_text_store_set(store, 3, 1, "ignored");
+    g_assert(column_text_store_get(store, 3, 1) == NULL);
+    g_assert(column_text_store_get(store, -1, 1) == NULL);
+
+    column_text_store_clear_column(store, 2, FALSE);
+    g_assert(column_text_store_get(store, 2, 1) == NULL);
+    g_assert(!column_text_store_has_row(store, 1));
+    g_assert_cmpstr(column_text_store_get(store, 1, 1), ==, "TCP");
+
+    column_text_store_clear(store, 2);
+    g_assert_cmpint(column_text_store_num_columns(store), ==, 2);
+    g_assert(column_text_store_get(store, 0, 1) == NULL);
+
+    column_text_store_free(store);
+}
+
+/*
+ * Rows that are far apart, e.g. the frames that pass a display filter,
+ * mustn't cost much more than their text.
+ */
+static void
+column_text_store_test_sparse(void)
+{
+    column_text_store_t *store = column_text_store_new(G_MAXSIZE);
+    char text[ROW_TEXT_LEN];
+    guint32 i;
+
+    column_text_store_clear(store, 1);
+    for (i = 0; i < 1000; i++) {
+        row_text(text, 0, i * 5000 + 1);
+        column_text_store_set(store, 0, i * 5000 + 1, text);
+    }
+    g_assert_cmpuint(column_text_store_memory_size(store), <, 1000 * 2048);
+
+    for (i = 0; i < 1000; i++) {
+        row_text(text, 0, i * 5000 + 1);
+        g_assert_cmpstr(column_text_store_get(store, 0, i * 5000 + 1), ==, text);
+        g_assert(column_text_store_get(store, 0, i * 5000 + 2) == NULL);
+    }
+
+    column_text_store_free(store);
+}
+
+/*
+ * Filling the store well past its budget keeps it within the budget,
+ * dropping the rows that were used least recently.
+ */
+static void
+column_text_store_test_budget(void)
+{
+    const gsize budget = 1024 * 1024;
+    column_text_store_t *store = column_text_store_new(budget);
+    char text[ROW_TEXT_LEN];
+    guint32 num_rows = 100000;
+    guint32 row;
+    gboolean evicted = FALSE;
+
+    column_text_store_clear(store, 2);
+    for (row = 1; row <= num_rows; row++) {
+        row_text(text, 0, row);
+        column_text_store_set(store, 0, row, text);
+        row_text(text, 1, row);
+        column_text_store_set(store, 1, row, text);
+        g_assert_cmpuint(column_text_store_memory_size(store), <=, budget + 64 * 1024);
+
+        /* Keep using the first rows. */
+        if (row % 1000 == 0) {
+            row_text(text, 0, 1);
+            g_assert_cmpstr(column_text_store_get(store, 0, 1), ==, text);
+            row_text(text, 1, 1);
+            g_assert_cmpstr(column_text_store_get(store, 1, 1), ==, text);
+        }
+    }
+
+    /* The rows we kept using and the last rows are still there. */
+    g_assert(column_text_store_has_row(store, 1));
+    g_assert(column_text_store_has_row(store, num_rows));
+    row_text(text, 1, num_rows);
+    g_assert_cmpstr(column_text_store_get(store, 1, num_rows), ==, text);
+
+    /* Some of the others aren't. */
+    for (row = 1; row <= num_rows; row++) {
+        if (!column_text_store_has_row(store, row)) {
+            evicted = TRUE;
+            break;
+        }
+    }
+    g_assert(evicted);
+
+    /* Evicted rows can be stored again. */
+    row_text(text, 0, row);
+    column_text_store_set(store, 0, row, text);
+    g_assert_cmpstr(column_text_store_get(store, 0, row), ==, text);
+
+    /* A smaller budget applies from the next store on. */
+    column_text_store_set_budget(store, budget / 2);
+    row_text(text, 1, row);
+    column_text_store_set(store, 1, row, text);
+    g_assert_cmpuint(column_text_store_memory_size(store), <=, budget / 2 + 64 * 1024);
+
+    column_text_store_clear(store, 2);
+    g_assert_cmpuint(column_text_store_memory_size(store), <, 1024);
+
+    column_text_store_free(store);
+}
+
+/*
+ * With no budget at all, storing a row's columns mustn't throw away the
+ * ones that were just stored, and the rows around it stay too.
+ */
+static void
+column_text_store_test_no_budget(void)
+{
+    column_text_store_t *store = column_text_store_new(0);
+    char text[ROW_TEXT_LEN];
+    guint32 row;
+    int c;
+
+    column_text_store_clear(store, 8);
+    for (row = 1; row <= 100; row++) {
+        for (c = 0; c < 8; c++) {
+            row_text(text, c, row);
+            column_text_store_set(store, c, row, text);
+        }
+        g_assert(column_text_store_has_row(store, row));
+    }
+
+    for (row = 1; row <= 100; row++) {
+        g_assert(column_text_store_has_row(store, row));
+        for (c = 0; c < 8; c++) {
+            row_text(text, c, row);
+            g_assert_cmpstr(column_text_store_get(store, c, row), ==, text);
+        }
+    }
+
+    /* Rows far apart push each other out, and the store stays at about
+       one block per column. */
+    for (row = 1; row <= 100 * 5000; row += 5000) {
+        for (c = 0; c < 8; c++) {
+            row_text(text, c, row);
+            column_text_store_set(store, c, row, text);
+        }
+        g_assert(column_text_store_has_row(store, row));
+        g_assert_cmpuint(column_text_store_memory_size(store), <=, 8 * 20 * 1024);
+    }
+    g_assert(!column_text_store_has_row(store, 1));
+
+    column_text_store_free(store);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/ui/column_text_store/get_set", column_text_store_test_get_set);
+    g_test_add_func("/ui/column_text_store/sparse",  column_text_store_test_sparse);
+    g_test_add_func("/ui/column_text_store/budget",  column_text_store_test_budget);
+    g_test_add_func("/ui/column_text_store/no_budget", column_text_store_test_no_budget);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -1458,7 +1458,7 @@ do_file_save(capture_file *cf, gboolean dont_reopen)
          closes the current file and then opens and reloads the saved file,
          so make a copy and free it later. */
       fname = g_strdup(cf->filename);
-      status = cf_save_records(cf, fname, cf->cd_t, cf->iscompressed,
+      status = cf_save_records(cf, fname, cf->cd_t, cf->compression_type,
                                discard_comments, dont_reopen);
       switch (status) {
 
@@ -1717,11 +1717,11 @@ gtk_save_as_file(GtkWidget *w _U_, capture_file *cf, GString *file_name, int *fi
   gtk_widget_show(ft_combo_box);
   g_object_set_data(G_OBJECT(file_save_as_w), E_FILE_TYPE_COMBO_BOX_KEY, ft_combo_box);
 
-  /* compressed - if the file is currently compressed, and the default
+  /* compressed - if the file is currently gzip compressed, and the default
      file type supports compression, turn the checkbox on */
   compressed_cb = gtk_check_button_new_with_label("Compress with gzip");
   gtk_box_pack_start(GTK_BOX(ft_hb), compressed_cb, FALSE, FALSE, 0);
-  if (cf->iscompressed && wtap_dump_can_compress(default_ft))
+  if (cf->compression_type == WTAP_GZIP_COMPRESSED && wtap_dump_can_compress(default_ft))
     gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(compressed_cb), TRUE);
   gtk_widget_show(compressed_cb);
   g_object_set_data(G_OBJECT(file_save_as_w), E_COMPRESSED_CB_KEY, compressed_cb);
@@ -1897,8 +1897,9 @@ file_save_as_cmd(capture_file *cf, gboolean must_support_all_comments,
       }
 #endif
 
-      /* Attempt to save the file */
-      status = cf_save_records(&cfile, file_name->str, file_type, compressed,
+      /* Attempt to save the file; the dialog only offers gzip */
+      status = cf_save_records(&cfile, file_name->str, file_type,
+                             compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
                              discard_comments, dont_reopen);
       switch (status) {
 
@@ -2108,9 +2109,9 @@ file_export_specified_packets_cmd_cb(GtkWidget *w _U_, gpointer data _U_) {
       }
 #endif
 
-      /* Attempt to export the file */
+      /* Attempt to export the file; the dialog only offers gzip */
       status = cf_export_specified_packets(&cfile, file_name->str, &range, file_type,
-                                         compressed);
+                                         compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED);
       switch (status) {
 
       case CF_WRITE_OK:
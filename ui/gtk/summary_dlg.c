@@ -251,9 +251,14 @@ summary_open_cb(GtkWidget *w _U_, gpointer d _U_)
   add_string_to_grid(grid, &row, "Length:", string_buff);
 
   /* format */
-  g_snprintf(string_buff, SUM_STR_MAX, "%s%s",
-             wtap_file_type_subtype_string(summary.file_type),
-             summary.iscompressed? " (gzip compressed)" : "");
+  if (summary.compression_type == WTAP_UNCOMPRESSED) {
+    g_snprintf(string_buff, SUM_STR_MAX, "%s",
+               wtap_file_type_subtype_string(summary.file_type));
+  } else {
+    g_snprintf(string_buff, SUM_STR_MAX, "%s (%s compressed)",
+               wtap_file_type_subtype_string(summary.file_type),
+               wtap_compression_type_description(summary.compression_type));
+  }
   add_string_to_grid(grid, &row, "Format:", string_buff);
 
   /* encapsulation */
@@ -692,9 +697,14 @@ summary_to_texbuff(GtkTextBuffer *buffer)
   gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
   /* format */
-  g_snprintf(string_buff, SUM_STR_MAX, INDENT "Format: %s%s",
-             wtap_file_type_subtype_string(summary.file_type),
-             summary.iscompressed? " (gzip compressed)\n" : "\n");
+  if (summary.compression_type == WTAP_UNCOMPRESSED) {
+    g_snprintf(string_buff, SUM_STR_MAX, INDENT "Format: %s\n",
+               wtap_file_type_subtype_string(summary.file_type));
+  } else {
+    g_snprintf(string_buff, SUM_STR_MAX, INDENT "Format: %s (%s compressed)\n",
+               wtap_file_type_subtype_string(summary.file_type),
+               wtap_compression_type_description(summary.compression_type));
+  }
   gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
   /* encapsulation */
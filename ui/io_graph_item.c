@@ -11,17 +11,16 @@
 
 #include "config.h"
 
+#include <string.h>
 
 #include <epan/epan_dissect.h>
 
 #include "ui/io_graph_item.h"
 
-int get_io_graph_index(packet_info *pinfo, int interval) {
+/* The number of milliseconds since the first packet, or -1 if it's before it. */
+static gint64 get_io_graph_msec(packet_info *pinfo) {
     nstime_t time_delta;
 
-    /*
-     * Find in which interval this is supposed to go and store the interval index as idx
-     */
     time_delta = pinfo->rel_ts;
     if (time_delta.nsecs<0) {
         time_delta.secs--;
@@ -30,7 +29,20 @@ int get_io_graph_index(packet_info *pinfo, int interval) {
     if (time_delta.secs<0) {
         return -1;
     }
-    return (int) ((time_delta.secs*1000 + time_delta.nsecs/1000000) / interval);
+    return (gint64) time_delta.secs*1000 + time_delta.nsecs/1000000;
+}
+
+int get_io_graph_index(packet_info *pinfo, int interval) {
+    gint64 msec;
+
+    /*
+     * Find in which interval this is supposed to go and store the interval index as idx
+     */
+    msec = get_io_graph_msec(pinfo);
+    if (msec < 0) {
+        return -1;
+    }
+    return (int) (msec / interval);
 }
 
 GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_unit_t item_unit)
@@ -124,6 +136,432 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
     return err_str;
 }
 
+/* 2^15 ms buckets are about 33 seconds, which is plenty for any interval
+ * we offer. */
+#define IO_GRAPH_PYRAMID_LEVELS 16
+
+#define IO_GRAPH_CLEAN G_MAXUINT64
+
+/* The most buckets in a block of a level. */
+#define IO_GRAPH_BLOCK_BUCKETS 256
+
+typedef struct {
+    guint64 key;                /* start time, in units of the level's bucket size */
+    io_graph_item_t item;
+} io_graph_bucket_t;
+
+/*
+ * A level is a GPtrArray of blocks, each a non-empty GArray of at most
+ * IO_GRAPH_BLOCK_BUCKETS buckets, with the buckets sorted by key across
+ * all of them. Adding a bucket out of time order, which is common with
+ * merged captures, then only moves the buckets of one block.
+ */
+typedef struct {
+    guint block;
+    guint pos;
+} io_graph_level_pos_t;
+
+struct _io_graph_pyramid_t {
+    int hf_index;
+    io_graph_item_unit_t item_unit;
+    enum ftenum ftype;
+    /* Level n holds 2^n ms buckets sorted by key. */
+    GPtrArray *levels[IO_GRAPH_PYRAMID_LEVELS];
+    /* The time in ms from which each level is out of date. */
+    guint64 dirty_msec[IO_GRAPH_PYRAMID_LEVELS];
+    /* What io_graph_pyramid_get_items last did. */
+    int items_interval;
+    int items_filled;
+    guint64 items_dirty_msec;
+};
+
+/* Add the values of one item to another. */
+static void
+merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *other, enum ftenum ftype, io_graph_item_unit_t item_unit)
+{
+    gboolean new_max = FALSE, new_min = FALSE;
+
+    if (other->first_frame_in_invl != 0 &&
+        (item->first_frame_in_invl == 0 || other->first_frame_in_invl < item->first_frame_in_invl)) {
+        item->first_frame_in_invl = other->first_frame_in_invl;
+    }
+    if (other->last_frame_in_invl > item->last_frame_in_invl) {
+        item->last_frame_in_invl = other->last_frame_in_invl;
+    }
+
+    if (other->fields != 0) {
+        if (item->fields == 0) {
+            new_max = new_min = TRUE;
+        } else {
+            switch (ftype) {
+            case FT_UINT8:
+            case FT_UINT16:
+            case FT_UINT24:
+            case FT_UINT32:
+            case FT_UINT40:
+            case FT_UINT48:
+            case FT_UINT56:
+            case FT_UINT64:
+            case FT_INT8:
+            case FT_INT16:
+            case FT_INT24:
+            case FT_INT32:
+            case FT_INT40:
+            case FT_INT48:
+            case FT_INT56:
+            case FT_INT64:
+                new_max = other->int_max > item->int_max;
+                new_min = other->int_min < item->int_min;
+                break;
+            case FT_FLOAT:
+                new_max = other->float_max > item->float_max;
+                new_min = other->float_min < item->float_min;
+                break;
+            case FT_DOUBLE:
+                new_max = other->double_max > item->double_max;
+                new_min = other->double_min < item->double_min;
+                break;
+            case FT_RELATIVE_TIME:
+                new_max = nstime_cmp(&other->time_max, &item->time_max) > 0;
+                new_min = nstime_cmp(&other->time_min, &item->time_min) < 0;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (new_max) {
+            item->int_max = other->int_max;
+            item->float_max = other->float_max;
+            item->double_max = other->double_max;
+            item->time_max = other->time_max;
+            if (item_unit == IOG_ITEM_UNIT_CALC_MAX) {
+                item->extreme_frame_in_invl = other->extreme_frame_in_invl;
+            }
+        }
+        if (new_min) {
+            item->int_min = other->int_min;
+            item->float_min = other->float_min;
+            item->double_min = other->double_min;
+            item->time_min = other->time_min;
+            if (item_unit == IOG_ITEM_UNIT_CALC_MIN) {
+                item->extreme_frame_in_invl = other->extreme_frame_in_invl;
+            }
+        }
+    }
+
+    item->int_tot += other->int_tot;
+    item->float_tot += other->float_tot;
+    item->double_tot += other->double_tot;
+    nstime_add(&item->time_tot, &other->time_tot);
+    item->fields += other->fields;
+    item->frames += other->frames;
+    item->bytes += other->bytes;
+}
+
+#define IO_GRAPH_BLOCK(level, n) ((GArray *) g_ptr_array_index(level, n))
+#define IO_GRAPH_BLOCK_BUCKET(block, n) (&g_array_index(block, io_graph_bucket_t, n))
+
+/* The bucket at a position, or NULL if it's the end of the level. */
+static io_graph_bucket_t *
+io_graph_level_bucket(const GPtrArray *level, const io_graph_level_pos_t *pos)
+{
+    if (pos->block >= level->len) {
+        return NULL;
+    }
+    return IO_GRAPH_BLOCK_BUCKET(IO_GRAPH_BLOCK(level, pos->block), pos->pos);
+}
+
+static void
+io_graph_level_next(const GPtrArray *level, io_graph_level_pos_t *pos)
+{
+    if (++pos->pos >= IO_GRAPH_BLOCK(level, pos->block)->len) {
+        pos->block++;
+        pos->pos = 0;
+    }
+}
+
+/* The last bucket in a level, or NULL if it's empty. */
+static io_graph_bucket_t *
+io_graph_level_last(const GPtrArray *level)
+{
+    GArray *block;
+
+    if (level->len == 0) {
+        return NULL;
+    }
+    block = IO_GRAPH_BLOCK(level, level->len - 1);
+    return IO_GRAPH_BLOCK_BUCKET(block, block->len - 1);
+}
+
+/* The position of the first bucket in a level whose key is at least key. */
+static void
+io_graph_level_search(const GPtrArray *level, guint64 key, io_graph_level_pos_t *pos)
+{
+    const io_graph_bucket_t *last = io_graph_level_last(level);
+    GArray *block;
+    guint lo, hi, mid;
+
+    /* Packets usually arrive in time order. */
+    if (!last || last->key < key) {
+        pos->block = level->len;
+        pos->pos = 0;
+        return;
+    }
+
+    /* The first block whose last key is at least key... */
+    lo = 0;
+    hi = level->len - 1;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        block = IO_GRAPH_BLOCK(level, mid);
+        if (IO_GRAPH_BLOCK_BUCKET(block, block->len - 1)->key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    pos->block = lo;
+
+    /* ...and the first bucket in it whose key is. */
+    block = IO_GRAPH_BLOCK(level, lo);
+    lo = 0;
+    hi = block->len - 1;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (IO_GRAPH_BLOCK_BUCKET(block, mid)->key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    pos->pos = lo;
+}
+
+/* Add an empty bucket to a level before the given position. */
+static io_graph_bucket_t *
+io_graph_level_insert(GPtrArray *level, const io_graph_level_pos_t *pos, guint64 key)
+{
+    io_graph_bucket_t new_bucket;
+    GArray *block, *upper;
+    guint half;
+
+    new_bucket.key = key;
+    reset_io_graph_items(&new_bucket.item, 1);
+
+    if (pos->block >= level->len) {
+        block = level->len ? IO_GRAPH_BLOCK(level, level->len - 1) : NULL;
+        if (!block || block->len >= IO_GRAPH_BLOCK_BUCKETS) {
+            block = g_array_sized_new(FALSE, FALSE, sizeof(io_graph_bucket_t), IO_GRAPH_BLOCK_BUCKETS);
+            g_ptr_array_add(level, block);
+        }
+        g_array_append_val(block, new_bucket);
+        return IO_GRAPH_BLOCK_BUCKET(block, block->len - 1);
+    }
+
+    block = IO_GRAPH_BLOCK(level, pos->block);
+    g_array_insert_val(block, pos->pos, new_bucket);
+    if (block->len <= IO_GRAPH_BLOCK_BUCKETS) {
+        return IO_GRAPH_BLOCK_BUCKET(block, pos->pos);
+    }
+
+    /* Split it, and put the upper half in a new block right after it. */
+    half = block->len / 2;
+    upper = g_array_sized_new(FALSE, FALSE, sizeof(io_graph_bucket_t), IO_GRAPH_BLOCK_BUCKETS);
+    g_array_append_vals(upper, IO_GRAPH_BLOCK_BUCKET(block, half), block->len - half);
+    g_array_set_size(block, half);
+    g_ptr_array_add(level, NULL);
+    memmove(&level->pdata[pos->block + 2], &level->pdata[pos->block + 1],
+            (level->len - pos->block - 2) * sizeof(gpointer));
+    level->pdata[pos->block + 1] = upper;
+
+    if (pos->pos < half) {
+        return IO_GRAPH_BLOCK_BUCKET(block, pos->pos);
+    }
+    return IO_GRAPH_BLOCK_BUCKET(upper, pos->pos - half);
+}
+
+/* Remove the buckets from a position to the end of a level. */
+static void
+io_graph_level_truncate(GPtrArray *level, const io_graph_level_pos_t *pos)
+{
+    guint keep = pos->block;
+    guint n;
+
+    if (keep < level->len && pos->pos > 0) {
+        g_array_set_size(IO_GRAPH_BLOCK(level, keep), pos->pos);
+        keep++;
+    }
+    for (n = keep; n < level->len; n++) {
+        g_array_free(IO_GRAPH_BLOCK(level, n), TRUE);
+    }
+    g_ptr_array_set_size(level, keep);
+}
+
+/* Bring a level up to date from the one below it. */
+static void
+io_graph_pyramid_build_level(io_graph_pyramid_t *pyramid, int n)
+{
+    GPtrArray *level = pyramid->levels[n];
+    GPtrArray *finer = pyramid->levels[n - 1];
+    io_graph_level_pos_t pos;
+    io_graph_bucket_t *bucket, *last;
+    guint64 key;
+
+    if (pyramid->dirty_msec[n] == IO_GRAPH_CLEAN) {
+        return;
+    }
+
+    key = pyramid->dirty_msec[n] >> n;
+    io_graph_level_search(level, key, &pos);
+    io_graph_level_truncate(level, &pos);
+    last = io_graph_level_last(level);
+
+    io_graph_level_search(finer, key << 1, &pos);
+    for (; (bucket = io_graph_level_bucket(finer, &pos)) != NULL; io_graph_level_next(finer, &pos)) {
+        if (!last || last->key != bucket->key >> 1) {
+            io_graph_level_pos_t end = { level->len, 0 };
+
+            last = io_graph_level_insert(level, &end, bucket->key >> 1);
+        }
+        merge_io_graph_item(&last->item, &bucket->item, pyramid->ftype, pyramid->item_unit);
+    }
+
+    pyramid->dirty_msec[n] = IO_GRAPH_CLEAN;
+}
+
+io_graph_pyramid_t *
+io_graph_pyramid_new(void)
+{
+    io_graph_pyramid_t *pyramid = g_new0(io_graph_pyramid_t, 1);
+    int n;
+
+    for (n = 0; n < IO_GRAPH_PYRAMID_LEVELS; n++) {
+        pyramid->levels[n] = g_ptr_array_new();
+    }
+    io_graph_pyramid_reset(pyramid, -1, IOG_ITEM_UNIT_PACKETS);
+    return pyramid;
+}
+
+void
+io_graph_pyramid_free(io_graph_pyramid_t *pyramid)
+{
+    int n;
+
+    if (!pyramid) {
+        return;
+    }
+    for (n = 0; n < IO_GRAPH_PYRAMID_LEVELS; n++) {
+        io_graph_level_pos_t start = { 0, 0 };
+
+        io_graph_level_truncate(pyramid->levels[n], &start);
+        g_ptr_array_free(pyramid->levels[n], TRUE);
+    }
+    g_free(pyramid);
+}
+
+void
+io_graph_pyramid_reset(io_graph_pyramid_t *pyramid, int hf_index, io_graph_item_unit_t item_unit)
+{
+    int n;
+
+    pyramid->hf_index = hf_index;
+    pyramid->item_unit = item_unit;
+    pyramid->ftype = hf_index >= 0 ? proto_registrar_get_ftype(hf_index) : FT_NONE;
+    for (n = 0; n < IO_GRAPH_PYRAMID_LEVELS; n++) {
+        io_graph_level_pos_t start = { 0, 0 };
+
+        io_graph_level_truncate(pyramid->levels[n], &start);
+        pyramid->dirty_msec[n] = IO_GRAPH_CLEAN;
+    }
+    /* Whatever was filled in before has to be cleared. */
+    pyramid->items_interval = 0;
+    pyramid->items_dirty_msec = IO_GRAPH_CLEAN;
+}
+
+gboolean
+io_graph_pyramid_update(io_graph_pyramid_t *pyramid, packet_info *pinfo, epan_dissect_t *edt)
+{
+    GPtrArray *level = pyramid->levels[0];
+    io_graph_bucket_t *bucket;
+    io_graph_level_pos_t pos;
+    gint64 msec;
+    int n;
+
+    msec = get_io_graph_msec(pinfo);
+    if (msec < 0) {
+        return FALSE;
+    }
+
+    io_graph_level_search(level, (guint64) msec, &pos);
+    bucket = io_graph_level_bucket(level, &pos);
+    if (!bucket || bucket->key != (guint64) msec) {
+        bucket = io_graph_level_insert(level, &pos, (guint64) msec);
+    }
+
+    for (n = 1; n < IO_GRAPH_PYRAMID_LEVELS; n++) {
+        pyramid->dirty_msec[n] = MIN(pyramid->dirty_msec[n], (guint64) msec);
+    }
+    pyramid->items_dirty_msec = MIN(pyramid->items_dirty_msec, (guint64) msec);
+
+    return update_io_graph_item(&bucket->item, 0, pinfo, edt, pyramid->hf_index, pyramid->item_unit, 1);
+}
+
+int
+io_graph_pyramid_get_items(io_graph_pyramid_t *pyramid, int interval, io_graph_item_t *items, int max_items)
+{
+    GPtrArray *level;
+    io_graph_bucket_t *bucket;
+    io_graph_level_pos_t pos;
+    guint64 last_msec, start_msec, msec;
+    int last_idx, start_idx, idx, n;
+
+    if (interval <= 0 || pyramid->levels[0]->len == 0) {
+        reset_io_graph_items(items, pyramid->items_filled);
+        pyramid->items_filled = 0;
+        pyramid->items_interval = interval;
+        pyramid->items_dirty_msec = IO_GRAPH_CLEAN;
+        return -1;
+    }
+
+    last_msec = io_graph_level_last(pyramid->levels[0])->key;
+    last_idx = (int) MIN(last_msec / interval, (guint64) max_items - 1);
+
+    if (interval != pyramid->items_interval) {
+        start_idx = 0;
+    } else if (pyramid->items_dirty_msec != IO_GRAPH_CLEAN) {
+        start_idx = (int) MIN(pyramid->items_dirty_msec / interval, (guint64) max_items);
+    } else {
+        return last_idx;
+    }
+
+    /* The coarsest level whose buckets each fall in exactly one interval. */
+    for (n = 0; n + 1 < IO_GRAPH_PYRAMID_LEVELS && interval % (1 << (n + 1)) == 0; n++) {
+        io_graph_pyramid_build_level(pyramid, n + 1);
+    }
+    level = pyramid->levels[n];
+
+    if (start_idx < pyramid->items_filled) {
+        reset_io_graph_items(&items[start_idx], pyramid->items_filled - start_idx);
+    }
+
+    start_msec = (guint64) start_idx * interval;
+    io_graph_level_search(level, start_msec >> n, &pos);
+    for (; (bucket = io_graph_level_bucket(level, &pos)) != NULL; io_graph_level_next(level, &pos)) {
+        msec = bucket->key << n;
+        idx = (int) MIN(msec / interval, (guint64) max_items);
+        if (idx >= max_items) {
+            break;
+        }
+        merge_io_graph_item(&items[idx], &bucket->item, pyramid->ftype, pyramid->item_unit);
+    }
+
+    pyramid->items_filled = last_idx + 1;
+    pyramid->items_interval = interval;
+    pyramid->items_dirty_msec = IO_GRAPH_CLEAN;
+    return last_idx;
+}
+
 /*
  * Editor modelines
  *
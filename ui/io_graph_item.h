@@ -367,6 +367,65 @@ update_io_graph_item(io_graph_item_t *items, int idx, packet_info *pinfo, epan_d
     return TRUE;
 }
 
+/** A sparse, multi-resolution store of io_graph_item_t's.
+ *
+ * Packets are aggregated into 1 ms buckets. Coarser levels of 2, 4, 8, ...
+ * ms buckets are built from the finer ones the first time they're needed,
+ * and are kept up to date afterwards by rebuilding only what changed. Only
+ * buckets that contain packets are stored, in blocks, so that adding one
+ * out of time order doesn't move all of those after it.
+ *
+ * Any interval that's a whole number of milliseconds can be filled in from
+ * the coarsest level whose bucket size divides it, so changing the interval
+ * doesn't require retapping.
+ *
+ * LOAD spreads each value over the preceding intervals and so depends on
+ * the interval. It can't be stored here.
+ */
+typedef struct _io_graph_pyramid_t io_graph_pyramid_t;
+
+/** Create an empty pyramid.
+ *
+ * @return A new pyramid. Free it with io_graph_pyramid_free().
+ */
+io_graph_pyramid_t *io_graph_pyramid_new(void);
+
+/** Free a pyramid.
+ *
+ * @param pyramid [in] The pyramid to free. May be NULL.
+ */
+void io_graph_pyramid_free(io_graph_pyramid_t *pyramid);
+
+/** Remove everything from a pyramid.
+ *
+ * @param pyramid [in,out] The pyramid to reset.
+ * @param hf_index [in] Header field index for advanced statistics.
+ * @param item_unit [in] The type of unit to calculate. From IOG_ITEM_UNITS.
+ */
+void io_graph_pyramid_reset(io_graph_pyramid_t *pyramid, int hf_index, io_graph_item_unit_t item_unit);
+
+/** Add a packet to a pyramid.
+ *
+ * @param pyramid [in,out] The pyramid to update.
+ * @param pinfo [in] Packet containing update information.
+ * @param edt [in] Dissection information for advanced statistics. May be NULL.
+ * @return TRUE if the update was successful, otherwise FALSE.
+ */
+gboolean io_graph_pyramid_update(io_graph_pyramid_t *pyramid, packet_info *pinfo, epan_dissect_t *edt);
+
+/** Fill in an array of items for an interval from a pyramid.
+ *
+ * Only the items that have changed since the last call are recalculated,
+ * so items must be the same array each time and mustn't be changed by the
+ * caller in between.
+ *
+ * @param pyramid [in,out] The pyramid to read.
+ * @param interval [in] Time interval in milliseconds.
+ * @param items [in,out] Array to fill in.
+ * @param max_items [in] The number of items in the array.
+ * @return The index of the last item, or -1 if the pyramid is empty.
+ */
+int io_graph_pyramid_get_items(io_graph_pyramid_t *pyramid, int interval, io_graph_item_t *items, int max_items);
 
 #ifdef __cplusplus
 }
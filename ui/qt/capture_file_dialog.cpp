@@ -205,8 +205,9 @@ int CaptureFileDialog::selectedFileType() {
     return file_type_;
 }
 
-bool CaptureFileDialog::isCompressed() {
-    return compressed_;
+wtap_compression_type CaptureFileDialog::compressionType() {
+    // The native dialog only has a "Compress with gzip" checkbox.
+    return compressed_ ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED;
 }
 
 int CaptureFileDialog::open(QString &file_name, unsigned int &type) {
@@ -300,7 +301,7 @@ QString CaptureFileDialog::fileExtensionType(int et, bool extension_globs)
          extension = g_slist_next(extension)) {
         QString bare_wc = QString("*.%1").arg((char *)extension->data);
         all_wildcards << bare_wc;
-        if (!bare_wc.endsWith(".gz")) {
+        if (wtap_name_to_compression_type((char *)extension->data) == WTAP_UNCOMPRESSED) {
             nogz_wildcards << bare_wc;
         }
     }
@@ -457,8 +458,8 @@ int CaptureFileDialog::selectedFileType() {
     return type_hash_.value(selectedNameFilter(), -1);
 }
 
-bool CaptureFileDialog::isCompressed() {
-    return compress_.isChecked();
+wtap_compression_type CaptureFileDialog::compressionType() {
+    return (wtap_compression_type) compression_type_.itemData(compression_type_.currentIndex()).toInt();
 }
 
 void CaptureFileDialog::addDisplayFilterEdit() {
@@ -481,15 +482,31 @@ void CaptureFileDialog::addFormatTypeSelector(QVBoxLayout &v_box) {
     v_box.addWidget(&format_type_, 0, Qt::AlignTop);
 }
 
-void CaptureFileDialog::addGzipControls(QVBoxLayout &v_box) {
-    compress_.setText(tr("Compress with g&zip"));
-    if (cap_file_->iscompressed && wtap_dump_can_compress(default_ft_)) {
-        compress_.setChecked(true);
-    } else {
-        compress_.setChecked(false);
+void CaptureFileDialog::addCompressionControls(QVBoxLayout &v_box) {
+    static const wtap_compression_type compression_types[] = {
+        WTAP_GZIP_COMPRESSED,
+        WTAP_ZSTD_COMPRESSED,
+        WTAP_LZ4_COMPRESSED
+    };
+    QLabel *compression_label = new QLabel(tr("Compression:"));
+
+    compression_type_.addItem(tr("Uncompressed"), (int) WTAP_UNCOMPRESSED);
+    for (size_t i = 0; i < sizeof compression_types / sizeof compression_types[0]; i++) {
+        if (wtap_can_write_compression_type(compression_types[i])) {
+            compression_type_.addItem(wtap_compression_type_description(compression_types[i]),
+                                      (int) compression_types[i]);
+        }
     }
-    v_box.addWidget(&compress_, 0, Qt::AlignTop);
-
+    compression_type_.setCurrentIndex(0);
+    if (wtap_dump_can_compress(default_ft_)) {
+        int idx = compression_type_.findData((int) cap_file_->compression_type);
+        if (idx != -1) {
+            compression_type_.setCurrentIndex(idx);
+        }
+    }
+    compression_label->setBuddy(&compression_type_);
+    v_box.addWidget(compression_label, 0, Qt::AlignTop);
+    v_box.addWidget(&compression_type_, 0, Qt::AlignTop);
 }
 
 void CaptureFileDialog::addRangeControls(QVBoxLayout &v_box, packet_range_t *range) {
@@ -551,7 +568,7 @@ check_savability_t CaptureFileDialog::saveAs(QString &file_name, bool must_suppo
     setAcceptMode(QFileDialog::AcceptSave);
     setLabelText(FileType, tr("Save as:"));
 
-    addGzipControls(left_v_box_);
+    addCompressionControls(left_v_box_);
     addHelpButton(HELP_SAVE_DIALOG);
 
     // Grow the dialog to account for the extra widgets.
@@ -578,7 +595,7 @@ check_savability_t CaptureFileDialog::exportSelectedPackets(QString &file_name,
     setLabelText(FileType, tr("Export as:"));
 
     addRangeControls(left_v_box_, range);
-    addGzipControls(right_v_box_);
+    addCompressionControls(right_v_box_);
     button_box = addHelpButton(HELP_EXPORT_FILE_DIALOG);
 
     if (button_box) {
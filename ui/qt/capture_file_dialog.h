@@ -67,7 +67,7 @@ public:
 
     int mergeType();
     int selectedFileType();
-    bool isCompressed();
+    wtap_compression_type compressionType();
 
 private:
     capture_file *cap_file_;
@@ -100,7 +100,7 @@ private:
     QComboBox format_type_;
     QHash<QString, int>type_hash_;
 
-    void addGzipControls(QVBoxLayout &v_box);
+    void addCompressionControls(QVBoxLayout &v_box);
     void addRangeControls(QVBoxLayout &v_box, packet_range_t *range);
     QDialogButtonBox *addHelpButton(topic_action_e help_topic);
 
@@ -108,7 +108,7 @@ private:
 
     int default_ft_;
 
-    QCheckBox compress_;
+    QComboBox compression_type_;
 
     PacketRangeGroupBox packet_range_group_box_;
     QPushButton *save_bt_;
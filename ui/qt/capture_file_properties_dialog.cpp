@@ -157,8 +157,9 @@ QString CaptureFilePropertiesDialog::summaryToHtml()
         << table_row_end;
 
     QString format_str = wtap_file_type_subtype_string(summary.file_type);
-    if (summary.iscompressed) {
-        format_str.append(tr(" (gzip compressed)"));
+    if (summary.compression_type != WTAP_UNCOMPRESSED) {
+        format_str.append(tr(" (%1 compressed)")
+                          .arg(wtap_compression_type_description(summary.compression_type)));
     }
     out << table_row_begin
         << table_vheader_tmpl.arg(tr("Format"))
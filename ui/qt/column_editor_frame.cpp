@@ -148,7 +148,7 @@ void ColumnEditorFrame::on_buttonBox_accepted()
         if (!prefs.gui_use_pref_save) {
             prefs_main_write();
         }
-        emit columnEdited();
+        emit columnEdited(cur_column_);
     }
 
     on_buttonBox_rejected();
@@ -25,7 +25,7 @@ public:
     void editColumn(int column);
 
 signals:
-    void columnEdited();
+    void columnEdited(int column);
     void pushFilterSyntaxStatus(const QString&);
 
 protected:
@@ -1173,14 +1173,19 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 {
     int interval = ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt();
     bool need_retap = false;
+    bool need_recalc = false;
 
     if (uat_model_ != NULL) {
         for (int row = 0; row < uat_model_->rowCount(); row++) {
             IOGraph *iog = ioGraphs_.value(row, NULL);
             if (iog) {
-                iog->setInterval(interval);
+                bool regrouped = iog->setInterval(interval);
                 if (iog->visible()) {
-                    need_retap = true;
+                    if (regrouped) {
+                        need_recalc = true;
+                    } else {
+                        need_retap = true;
+                    }
                 }
             }
         }
@@ -1188,6 +1193,8 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 
     if (need_retap) {
         scheduleRetap(true);
+    } else if (need_recalc) {
+        scheduleRecalc(true);
     }
 
     updateLegend();
@@ -1656,6 +1663,8 @@ IOGraph::IOGraph(QCustomPlot *parent) :
     bars_(NULL),
     val_units_(IOG_ITEM_UNIT_FIRST),
     hf_index_(-1),
+    interval_(0),
+    pyramid_(io_graph_pyramid_new()),
     cur_idx_(-1)
 {
     Q_ASSERT(parent_ != NULL);
@@ -1686,6 +1695,7 @@ IOGraph::~IOGraph() {
     if (bars_) {
         parent_->removePlottable(bars_);
     }
+    io_graph_pyramid_free(pyramid_);
 }
 
 // Construct a full filter string from the display filter and value unit / Y axis.
@@ -1943,6 +1953,7 @@ void IOGraph::clearAllData()
 {
     cur_idx_ = -1;
     reset_io_graph_items(items_, max_io_items_);
+    io_graph_pyramid_reset(pyramid_, hf_index_, val_units_);
     if (graph_) {
         graph_->clearData();
     }
@@ -1960,6 +1971,10 @@ void IOGraph::recalcGraphData(capture_file *cap_file, bool enable_scaling)
     double mavg_cumulated = 0;
     QCPAxis *x_axis = NULL;
 
+    if (val_units_ != IOG_ITEM_UNIT_CALC_LOAD) {
+        cur_idx_ = io_graph_pyramid_get_items(pyramid_, interval_, items_, max_io_items_);
+    }
+
     if (graph_) {
         graph_->clearData();
         x_axis = graph_->keyAxis();
@@ -2140,9 +2155,16 @@ void IOGraph::reloadValueUnitField()
     }
 }
 
-void IOGraph::setInterval(int interval)
+// Returns true if our items could be regrouped into the new interval
+// without retapping.
+bool IOGraph::setInterval(int interval)
 {
     interval_ = interval;
+    if (val_units_ == IOG_ITEM_UNIT_CALC_LOAD) {
+        return false;
+    }
+    cur_idx_ = io_graph_pyramid_get_items(pyramid_, interval_, items_, max_io_items_);
+    return true;
 }
 
 // Get the value at the given interval (idx) for the current value unit.
@@ -2320,7 +2342,24 @@ gboolean IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dissect_t *e
     bool recalc = false;
 
     /* some sanity checks */
-    if ((idx < 0) || (idx >= max_io_items_)) {
+    if (idx < 0) {
+        return FALSE;
+    }
+
+    epan_dissect_t *adv_edt = NULL;
+    /* For ADVANCED mode we need to keep track of some more stuff than just frame and byte counts */
+    if (iog->val_units_ >= IOG_ITEM_UNIT_CALC_SUM) {
+        adv_edt = edt;
+    }
+
+    /* Everything but LOAD goes into the pyramid, including packets past
+     * the last item, which a larger interval might still show. */
+    bool updated = true;
+    if (iog->val_units_ != IOG_ITEM_UNIT_CALC_LOAD) {
+        updated = io_graph_pyramid_update(iog->pyramid_, pinfo, adv_edt);
+    }
+
+    if (idx >= max_io_items_) {
         iog->cur_idx_ = max_io_items_ - 1;
         return FALSE;
     }
@@ -2339,13 +2378,10 @@ gboolean IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dissect_t *e
         iog->start_time_ = nstime_to_sec(&start_nstime);
     }
 
-    epan_dissect_t *adv_edt = NULL;
-    /* For ADVANCED mode we need to keep track of some more stuff than just frame and byte counts */
-    if (iog->val_units_ >= IOG_ITEM_UNIT_CALC_SUM) {
-        adv_edt = edt;
+    if (iog->val_units_ == IOG_ITEM_UNIT_CALC_LOAD) {
+        updated = update_io_graph_item(iog->items_, idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_);
     }
-
-    if (!update_io_graph_item(iog->items_, idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_)) {
+    if (!updated) {
         return FALSE;
     }
 
@@ -62,7 +62,7 @@ public:
     const QString valueUnitField() { return vu_field_; }
     void setValueUnitField(const QString &vu_field);
     unsigned int movingAveragePeriod() { return moving_avg_period_; }
-    void setInterval(int interval);
+    bool setInterval(int interval);
     bool addToLegend();
     bool removeFromLegend();
     QCPGraph *graph() { return graph_; }
@@ -113,7 +113,9 @@ private:
     QString scaled_value_unit_;
 
     // Cached data. We should be able to change the Y axis without retapping as
-    // much as is feasible.
+    // much as is feasible. items_ is filled in from pyramid_ for the current
+    // interval, except for LOAD which is tapped into it directly.
+    io_graph_pyramid_t *pyramid_;
     io_graph_item_t items_[max_io_items_];
     int cur_idx_;
 };
@@ -633,8 +633,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(packet_list_, SIGNAL(editProtocolPreference(preference*,pref_module*)),
             main_ui_->preferenceEditorFrame, SLOT(editPreference(preference*,pref_module*)));
     connect(packet_list_, SIGNAL(editColumn(int)), this, SLOT(showColumnEditor(int)));
-    connect(main_ui_->columnEditorFrame, SIGNAL(columnEdited()),
-            packet_list_, SLOT(columnsChanged()));
+    connect(main_ui_->columnEditorFrame, SIGNAL(columnEdited(int)),
+            packet_list_, SLOT(columnEdited(int)));
     connect(packet_list_, SIGNAL(doubleClicked(QModelIndex)),
             this, SLOT(openPacketDialog()));
     connect(packet_list_, SIGNAL(packetListScrolled(bool)),
@@ -1374,7 +1374,7 @@ bool MainWindow::saveCaptureFile(capture_file *cf, bool dont_reopen) {
                closes the current file and then opens and reloads the saved file,
                so make a copy and free it later. */
             file_name = cf->filename;
-            status = cf_save_records(cf, qUtf8Printable(file_name), cf->cd_t, cf->iscompressed,
+            status = cf_save_records(cf, qUtf8Printable(file_name), cf->cd_t, cf->compression_type,
                                      discard_comments, dont_reopen);
             switch (status) {
 
@@ -1410,7 +1410,7 @@ bool MainWindow::saveCaptureFile(capture_file *cf, bool dont_reopen) {
 bool MainWindow::saveAsCaptureFile(capture_file *cf, bool must_support_comments, bool dont_reopen) {
     QString file_name = "";
     int file_type;
-    gboolean compressed;
+    wtap_compression_type compression_type;
     cf_write_status_t status;
     gchar   *dirname;
     gboolean discard_comments = FALSE;
@@ -1457,9 +1457,9 @@ bool MainWindow::saveAsCaptureFile(capture_file *cf, bool must_support_comments,
             return false;
         }
         file_type = save_as_dlg.selectedFileType();
-        compressed = save_as_dlg.isCompressed();
+        compression_type = save_as_dlg.compressionType();
 
-        fileAddExtension(file_name, file_type, compressed);
+        fileAddExtension(file_name, file_type, compression_type);
 
 //#ifndef _WIN32
 //        /* If the file exists and it's user-immutable or not writable,
@@ -1471,7 +1471,7 @@ bool MainWindow::saveAsCaptureFile(capture_file *cf, bool must_support_comments,
 //#endif
 
         /* Attempt to save the file */
-        status = cf_save_records(cf, qUtf8Printable(file_name), file_type, compressed,
+        status = cf_save_records(cf, qUtf8Printable(file_name), file_type, compression_type,
                                  discard_comments, dont_reopen);
         switch (status) {
 
@@ -1507,7 +1507,7 @@ bool MainWindow::saveAsCaptureFile(capture_file *cf, bool must_support_comments,
 void MainWindow::exportSelectedPackets() {
     QString file_name = "";
     int file_type;
-    gboolean compressed;
+    wtap_compression_type compression_type;
     packet_range_t range;
     cf_write_status_t status;
     gchar   *dirname;
@@ -1581,8 +1581,8 @@ void MainWindow::exportSelectedPackets() {
         }
 
         file_type = esp_dlg.selectedFileType();
-        compressed = esp_dlg.isCompressed();
-        fileAddExtension(file_name, file_type, compressed);
+        compression_type = esp_dlg.compressionType();
+        fileAddExtension(file_name, file_type, compression_type);
 
 //#ifndef _WIN32
 //        /* If the file exists and it's user-immutable or not writable,
@@ -1594,7 +1594,7 @@ void MainWindow::exportSelectedPackets() {
 //#endif
 
         /* Attempt to save the file */
-        status = cf_export_specified_packets(capture_file_.capFile(), qUtf8Printable(file_name), &range, file_type, compressed);
+        status = cf_export_specified_packets(capture_file_.capFile(), qUtf8Printable(file_name), &range, file_type, compression_type);
         switch (status) {
 
         case CF_WRITE_OK:
@@ -1638,8 +1638,9 @@ void MainWindow::exportDissections(export_type_e export_type) {
     ed_dlg.exec();
 }
 
-void MainWindow::fileAddExtension(QString &file_name, int file_type, bool compressed) {
+void MainWindow::fileAddExtension(QString &file_name, int file_type, wtap_compression_type compression_type) {
     QString file_name_lower;
+    QString compressed_suffix;
     GSList  *extensions_list;
     gboolean add_extension;
 
@@ -1649,6 +1650,9 @@ void MainWindow::fileAddExtension(QString &file_name, int file_type, bool compre
      * extensions for the file type.
      */
     file_name_lower = file_name.toLower();
+    if (compression_type != WTAP_UNCOMPRESSED) {
+        compressed_suffix = QString(".") + wtap_compression_type_extension(compression_type);
+    }
     extensions_list = wtap_get_file_extensions_list(file_type, FALSE);
     if (extensions_list != NULL) {
         GSList *extension;
@@ -1669,8 +1673,8 @@ void MainWindow::fileAddExtension(QString &file_name, int file_type, bool compre
                 add_extension = FALSE;
                 break;
             }
-            file_suffix += ".gz";
-            if (file_name_lower.endsWith(file_suffix)) {
+            file_suffix += compressed_suffix;
+            if (!compressed_suffix.isEmpty() && file_name_lower.endsWith(file_suffix)) {
                 /*
                  * The file name has one of the extensions for
                  * this file type.
@@ -1686,9 +1690,7 @@ void MainWindow::fileAddExtension(QString &file_name, int file_type, bool compre
     if (add_extension) {
         if (wtap_default_file_extension(file_type) != NULL) {
             file_name += tr(".") + wtap_default_file_extension(file_type);
-            if (compressed) {
-                file_name += ".gz";
-            }
+            file_name += compressed_suffix;
         }
     }
 }
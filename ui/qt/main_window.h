@@ -212,7 +212,7 @@ private:
     void exportSelectedPackets();
     void exportDissections(export_type_e export_type);
 
-    void fileAddExtension(QString &file_name, int file_type, bool compressed);
+    void fileAddExtension(QString &file_name, int file_type, wtap_compression_type compression_type);
     bool testCaptureFileClose(QString before_what, FileCloseContext context = Default);
     void captureStop();
 
@@ -0,0 +1,352 @@
+/* packet_list_dissector.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later*/
+
+#include "packet_list_dissector.h"
+
+#include "packet_list_model.h"
+#include "packet_list_record.h"
+
+#include <epan/column.h>
+#include <epan/color_filters.h>
+
+#include <QAbstractEventDispatcher>
+#include <QApplication>
+#include <QMutexLocker>
+#include <QWidget>
+
+// How many pages of rows past the viewport to fill in ahead of time.
+static const int prefetch_pages_ = 4;
+// How often to report background colorization progress.
+static const int publish_interval_ = 100; // ms
+
+PacketListDissector::PacketListDissector(PacketListModel *model) :
+    QThread(model),
+    model_(model),
+    cap_file_(NULL),
+    gui_busy_(true),
+    worker_busy_(false),
+    running_(false),
+    quit_(false),
+    wth_(NULL),
+    cf_wth_(NULL),
+    edt_(NULL),
+    edt_epan_(NULL),
+    edt_proto_tree_(false),
+    view_first_(-1),
+    view_last_(-1),
+    prefetch_row_(0),
+    prefetch_end_(0),
+    bg_row_(0),
+    bg_reported_row_(0),
+    publish_pending_(0)
+{
+    memset(&provider_, 0, sizeof provider_);
+    memset(&rec_, 0, sizeof rec_);
+    ws_buffer_init(&buf_, 1500);
+
+    // Every event handled by the GUI thread passes through our event
+    // filter, which makes the GUI thread busy. It becomes idle again
+    // right before its main event loop waits for more events.
+    qApp->installEventFilter(this);
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher) {
+        connect(dispatcher, SIGNAL(aboutToBlock()), this, SLOT(guiIdle()), Qt::DirectConnection);
+        connect(dispatcher, SIGNAL(awake()), this, SLOT(guiBusy()), Qt::DirectConnection);
+    }
+    connect(this, SIGNAL(publishPending()), this, SLOT(publishRows()), Qt::QueuedConnection);
+}
+
+PacketListDissector::~PacketListDissector()
+{
+    qApp->removeEventFilter(this);
+    guiBusy();
+    mutex_.lock();
+    quit_ = true;
+    cond_.wakeAll();
+    mutex_.unlock();
+    wait();
+
+    closeFile();
+    ws_buffer_free(&buf_);
+}
+
+// Start over from the first row, e.g. after the file has been read or
+// the coloring rules or columns have changed.
+void PacketListDissector::restart(capture_file *cap_file)
+{
+    guiBusy();
+
+    QMutexLocker locker(&mutex_);
+    cap_file_ = cap_file;
+    // Pick up new coloring rules and columns.
+    if (edt_) {
+        epan_dissect_free(edt_);
+        edt_ = NULL;
+        edt_epan_ = NULL;
+    }
+    view_first_ = view_last_ = -1;
+    prefetch_row_ = prefetch_end_ = 0;
+    bg_row_ = bg_reported_row_ = 0;
+    running_ = cap_file_ != NULL;
+    publish_timer_.invalidate();
+    if (!isRunning()) {
+        start(QThread::LowPriority);
+    }
+    cond_.wakeAll();
+}
+
+// Stop and close our copy of the file. Must be called before the rows
+// are freed or the file is closed.
+void PacketListDissector::reset()
+{
+    guiBusy();
+
+    QMutexLocker locker(&mutex_);
+    running_ = false;
+    view_first_ = view_last_ = -1;
+    prefetch_row_ = prefetch_end_ = 0;
+    bg_row_ = bg_reported_row_ = 0;
+    closeFile();
+}
+
+void PacketListDissector::setViewport(int first, int last)
+{
+    // We're called for every paint event, which is usually for the same
+    // rows.
+    if (first < 0 || last < first || (first == view_first_ && last == view_last_)) return;
+
+    guiBusy();
+
+    QMutexLocker locker(&mutex_);
+    int page = last - first + 1;
+    view_first_ = first;
+    view_last_ = last;
+    prefetch_row_ = qMax(0, first - page);
+    prefetch_end_ = last + 1 + page * prefetch_pages_;
+    if (cap_file_) {
+        running_ = true;
+        cond_.wakeAll();
+    }
+}
+
+void PacketListDissector::run()
+{
+    QMutexLocker locker(&mutex_);
+
+    while (!quit_) {
+        if (gui_busy_ || !running_) {
+            cond_.wait(&mutex_);
+            continue;
+        }
+
+        // The GUI thread waits for us to finish before it does anything
+        // else, so we have the model and the dissection engine to
+        // ourselves until we clear worker_busy_.
+        worker_busy_ = true;
+        locker.unlock();
+        bool more = dissectNextRow();
+        locker.relock();
+        worker_busy_ = false;
+        if (!more) {
+            running_ = false;
+        }
+        cond_.wakeAll();
+    }
+
+    if (edt_) {
+        epan_dissect_free(edt_);
+        edt_ = NULL;
+    }
+}
+
+bool PacketListDissector::eventFilter(QObject *, QEvent *)
+{
+    guiBusy();
+    return false;
+}
+
+// Only the GUI thread sets gui_busy_, so it can check it without locking.
+void PacketListDissector::guiBusy()
+{
+    if (gui_busy_) return;
+
+    QMutexLocker locker(&mutex_);
+    gui_busy_ = true;
+    while (worker_busy_) {
+        cond_.wait(&mutex_);
+    }
+}
+
+void PacketListDissector::guiIdle()
+{
+    if (!gui_busy_) return;
+
+    // A nested event loop might have been entered from anywhere, e.g.
+    // by a dialog reporting a failure in the middle of a dissection, so
+    // the GUI thread stays busy until it's back in its main one.
+    if (!inMainEventLoop()) return;
+
+    QMutexLocker locker(&mutex_);
+    gui_busy_ = false;
+    cond_.wakeAll();
+}
+
+bool PacketListDissector::inMainEventLoop()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    return QThread::currentThread()->loopLevel() <= 1;
+#else
+    // Nested event loops are run by modal dialogs and popup menus.
+    return !QApplication::activeModalWidget() && !QApplication::activePopupWidget();
+#endif
+}
+
+bool PacketListDissector::openFile()
+{
+    // The file is reopened after it's saved.
+    if (wth_ && cf_wth_ != cap_file_->provider.wth) {
+        closeFile();
+    }
+
+    if (!wth_) {
+        int err;
+        gchar *err_info = NULL;
+
+        // Errors are reported by the GUI thread when it reads the rows
+        // itself.
+        wth_ = wtap_open_offline(cap_file_->filename, cap_file_->open_type, &err, &err_info, TRUE);
+        g_free(err_info);
+        if (!wth_) return false;
+        cf_wth_ = cap_file_->provider.wth;
+    }
+
+    // Custom columns might have been added or removed since we created
+    // edt_, e.g. by resetColumns().
+    bool create_proto_tree = color_filters_used() ||
+                             have_custom_cols(&cap_file_->cinfo) ||
+                             have_field_extractors();
+    if (!edt_ || edt_epan_ != cap_file_->epan || edt_proto_tree_ != create_proto_tree) {
+        if (edt_) epan_dissect_free(edt_);
+        edt_ = epan_dissect_new(cap_file_->epan, create_proto_tree, FALSE /* proto_tree_visible */);
+        edt_epan_ = cap_file_->epan;
+        edt_proto_tree_ = create_proto_tree;
+    }
+
+    return true;
+}
+
+void PacketListDissector::closeFile()
+{
+    if (edt_) {
+        epan_dissect_free(edt_);
+        edt_ = NULL;
+        edt_epan_ = NULL;
+    }
+    if (wth_) {
+        wtap_close(wth_);
+        wth_ = NULL;
+        cf_wth_ = NULL;
+    }
+}
+
+// Rows around the viewport come first, followed by the rest of the list.
+int PacketListDissector::nextRow(bool *fill_columns)
+{
+    const QVector<PacketListRecord *> &rows = model_->visible_rows_;
+
+    while (prefetch_row_ < prefetch_end_ && prefetch_row_ < rows.count()) {
+        int row = prefetch_row_++;
+        if (!rows[row]->colorized() || !rows[row]->columnsCached()) {
+            *fill_columns = true;
+            return row;
+        }
+    }
+    // The column text of the other rows would just be evicted from the
+    // cache again, so we only colorize them.
+    while (bg_row_ < rows.count()) {
+        int row = bg_row_++;
+        if (!rows[row]->colorized()) {
+            *fill_columns = false;
+            return row;
+        }
+    }
+    return -1;
+}
+
+// Returns false if there's nothing left to do.
+bool PacketListDissector::dissectNextRow()
+{
+    if (!cap_file_ || cap_file_->state != FILE_READ_DONE || cap_file_->redissecting) {
+        return false;
+    }
+    if (!openFile()) {
+        return false;
+    }
+
+    bool fill_columns;
+    int row = nextRow(&fill_columns);
+    if (row < 0) {
+        publish(true);
+        return false;
+    }
+
+    PacketListRecord *record = model_->visible_rows_[row];
+    frame_data *fdata = record->frameData();
+    int err;
+    gchar *err_info = NULL;
+
+    if (wtap_seek_read(wth_, fdata->file_off, &rec_, &buf_, &err, &err_info)) {
+        provider_ = cap_file_->provider;
+        provider_.wth = wth_;
+        record->dissectRecord(cap_file_, edt_, &provider_, &rec_, &buf_, fill_columns);
+    } else {
+        // Leave the row to the GUI thread, which reports the error.
+        g_free(err_info);
+    }
+
+    publish(false);
+    return true;
+}
+
+// Let the GUI thread know about our progress without waiting for it.
+void PacketListDissector::publish(bool force)
+{
+    if (!force && publish_timer_.isValid() && publish_timer_.elapsed() < publish_interval_) {
+        return;
+    }
+    publish_timer_.start();
+
+    if (publish_pending_.testAndSetRelaxed(0, 1)) {
+        emit publishPending();
+    }
+}
+
+void PacketListDissector::publishRows()
+{
+    publish_pending_.fetchAndStoreRelaxed(0);
+    guiBusy();
+
+    if (bg_row_ > bg_reported_row_) {
+        int first = bg_reported_row_;
+        bg_reported_row_ = bg_row_;
+        emit bgColorizationProgress(first + 1, bg_reported_row_ + 1);
+    }
+}
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,127 @@
+/* packet_list_dissector.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later*/
+
+#ifndef PACKET_LIST_DISSECTOR_H
+#define PACKET_LIST_DISSECTOR_H
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "cfile.h"
+
+#include <epan/epan_dissect.h>
+#include <wsutil/buffer.h>
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class PacketListModel;
+
+/*
+ * Colorizes packet list rows and fills in their column text in the
+ * background. The rows around the viewport come first. Then the rest of
+ * the list is colorized, without filling in the text, since the column
+ * text cache only has room for part of a large file.
+ *
+ * The dissector has its own wiretap handle and epan_dissect_t, but the
+ * dissection engine isn't thread safe, so it only runs while the GUI
+ * thread is waiting for events in its main event loop. A nested event
+ * loop, such as that of a dialog opened while a packet is being
+ * dissected, doesn't count, as the GUI thread may be in the middle of
+ * using the engine. The GUI thread marks itself busy before it handles
+ * an event and waits for the packet being dissected, if any, to finish.
+ * It is therefore free to use the model and the dissection engine while
+ * it's busy, and the dissector is free to use them while it isn't.
+ *
+ * This only takes the work off the GUI thread's hands while it has
+ * nothing else to do; the two never dissect at the same time.
+ */
+class PacketListDissector : public QThread
+{
+    Q_OBJECT
+public:
+    explicit PacketListDissector(PacketListModel *model);
+    ~PacketListDissector();
+
+    // These must be called from the GUI thread.
+    void restart(capture_file *cap_file);
+    void reset();
+    void setViewport(int first, int last);
+
+signals:
+    void bgColorizationProgress(int first, int last);
+    void publishPending();
+
+protected:
+    void run();
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private:
+    PacketListModel *model_;
+    capture_file *cap_file_;
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    bool gui_busy_;
+    bool worker_busy_;
+    bool running_;
+    bool quit_;
+
+    // Our own copy of the capture file and dissection state. Only used
+    // while the GUI thread is idle or from the GUI thread after it has
+    // marked itself busy.
+    wtap *wth_;
+    wtap *cf_wth_;
+    struct packet_provider_data provider_;
+    epan_dissect_t *edt_;
+    epan_t *edt_epan_;
+    bool edt_proto_tree_;
+    wtap_rec rec_;
+    Buffer buf_;
+
+    int view_first_;
+    int view_last_;
+    int prefetch_row_;
+    int prefetch_end_;
+    int bg_row_;
+    int bg_reported_row_;
+
+    QAtomicInt publish_pending_;
+    QElapsedTimer publish_timer_;
+
+    bool openFile();
+    void closeFile();
+    int nextRow(bool *fill_columns);
+    bool dissectNextRow();
+    void publish(bool force);
+    static bool inMainEventLoop();
+
+private slots:
+    void guiBusy();
+    void guiIdle();
+    void publishRows();
+};
+
+#endif // PACKET_LIST_DISSECTOR_H
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -9,6 +9,7 @@
 #include <algorithm>
 
 #include "packet_list_model.h"
+#include "packet_list_dissector.h"
 
 #include "file.h"
 
@@ -25,11 +26,15 @@
 #include <ui/qt/utils/color_utils.h>
 #include "wireshark_application.h"
 
+#include <QAtomicInt>
 #include <QColor>
-#include <QElapsedTimer>
 #include <QFontMetrics>
+#include <QHash>
 #include <QModelIndex>
 #include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -45,10 +50,14 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
     number_to_row_(QVector<int>()),
     max_row_height_(0),
     max_line_count_(1),
-    idle_dissection_row_(0)
+    sort_generation_(0),
+    sort_pool_(NULL),
+    sort_cancel_(NULL)
 {
+    // setCaptureFile restarts the dissector.
+    dissector_ = new PacketListDissector(this);
     setCaptureFile(cf);
-    PacketListRecord::clearStringPool();
+    PacketListRecord::clearColumnCache();
 
     physical_rows_.reserve(reserved_packets_);
     visible_rows_.reserve(reserved_packets_);
@@ -58,12 +67,14 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
     connect(this, SIGNAL(maxLineCountChanged(QModelIndex)),
             this, SLOT(emitItemHeightChanged(QModelIndex)),
             Qt::QueuedConnection);
-    idle_dissection_timer_ = new QElapsedTimer();
+
+    connect(dissector_, SIGNAL(bgColorizationProgress(int,int)),
+            this, SIGNAL(bgColorizationProgress(int,int)));
 }
 
 PacketListModel::~PacketListModel()
 {
-    delete idle_dissection_timer_;
+    delete dissector_;
 }
 
 void PacketListModel::setCaptureFile(capture_file *cf)
@@ -118,31 +129,61 @@ guint PacketListModel::recreateVisibleRows()
         }
     }
     endInsertRows();
-    idle_dissection_row_ = 0;
+    dissector_->restart(cap_file_);
     return visible_rows_.count();
 }
 
 void PacketListModel::clear() {
+    cancelSort();
+    dissector_->reset();
     beginResetModel();
     qDeleteAll(physical_rows_);
     physical_rows_.resize(0);
     visible_rows_.resize(0);
     new_visible_rows_.resize(0);
     number_to_row_.resize(0);
-    PacketListRecord::clearStringPool();
+    PacketListRecord::clearColumnCache();
     endResetModel();
     max_row_height_ = 0;
     max_line_count_ = 1;
-    idle_dissection_row_ = 0;
+}
+
+// Stop a sort that's in progress before the rows, columns or capture file
+// change, e.g. because the user closed the file while we processed events.
+// Its tasks are finished by the time we return.
+void PacketListModel::cancelSort()
+{
+    sort_generation_++;
+    if (sort_pool_) {
+        sort_cancel_->ref();
+        sort_pool_->waitForDone();
+        sort_pool_ = NULL;
+        sort_cancel_ = NULL;
+    }
 }
 
 void PacketListModel::resetColumns()
 {
+    cancelSort();
     if (cap_file_) {
         PacketListRecord::resetColumns(&cap_file_->cinfo);
     }
     dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
     headerDataChanged(Qt::Horizontal, 0, columnCount() - 1);
+    // Fill in the new columns around the viewport again.
+    dissector_->restart(cap_file_);
+}
+
+// Throw away the text of a single column, e.g. after it's been edited.
+void PacketListModel::resetColumn(int column)
+{
+    if (!cap_file_ || column < 0 || column >= columnCount()) return;
+
+    cancelSort();
+    PacketListRecord::resetColumn(&cap_file_->cinfo, column);
+    dataChanged(index(0, column), index(rowCount() - 1, column));
+    headerDataChanged(Qt::Horizontal, column, column);
+    dissector_->restart(cap_file_);
 }
 
 void PacketListModel::resetColorized()
@@ -151,6 +192,7 @@ void PacketListModel::resetColorized()
         record->resetColorized();
     }
     dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+    dissector_->restart(cap_file_);
 }
 
 void PacketListModel::toggleFrameMark(const QModelIndex &fm_index)
@@ -282,19 +324,208 @@ void PacketListModel::setMaximiumRowHeight(int height)
 // to do in the future.
 
 int PacketListModel::sort_column_;
-int PacketListModel::sort_column_is_numeric_;
 int PacketListModel::text_sort_column_;
 Qt::SortOrder PacketListModel::sort_order_;
 capture_file *PacketListModel::sort_cap_file_;
 
 QElapsedTimer busy_timer_;
 const int busy_timeout_ = 65; // ms, approximately 15 fps
+const int sort_run_size_ = 65536; // rows sorted by one task before merging
+
+// What a row is sorted by, extracted once before sorting so that comparing
+// two rows doesn't have to look at their column strings.
+struct PacketListSortKey {
+    PacketListRecord *record;
+    double value;   // collation rank of the text, or its numeric value
+    bool valid;     // false if a numeric column has no number
+};
+
+class PacketListSortLessThan
+{
+public:
+    PacketListSortLessThan(capture_file *cap_file, int col_fmt, bool by_key, Qt::SortOrder order) :
+        cap_file_(cap_file),
+        col_fmt_(col_fmt),
+        by_key_(by_key),
+        order_(order)
+    {}
+
+    bool operator()(const PacketListSortKey &k1, const PacketListSortKey &k2) const
+    {
+        frame_data *fd1 = k1.record->frameData();
+        frame_data *fd2 = k2.record->frameData();
+        int cmp_val = 0;
+
+        if (!by_key_) {
+            // Column comes directly from frame data
+            cmp_val = frame_data_compare(cap_file_->epan, fd1, fd2, col_fmt_);
+        } else if (k1.valid != k2.valid) {
+            // Rows without a number sort before the others
+            cmp_val = k1.valid ? 1 : -1;
+        } else if (k1.value != k2.value) {
+            cmp_val = k1.value < k2.value ? -1 : 1;
+        }
+
+        if (cmp_val == 0) {
+            // All else being equal, compare frame numbers.
+            cmp_val = frame_data_compare(cap_file_->epan, fd1, fd2, COL_NUMBER);
+        }
+
+        if (order_ == Qt::AscendingOrder) {
+            return cmp_val < 0;
+        } else {
+            return cmp_val > 0;
+        }
+    }
+
+private:
+    capture_file *cap_file_;
+    int col_fmt_;
+    bool by_key_;
+    Qt::SortOrder order_;
+};
+
+class PacketListStringLessThan
+{
+public:
+    PacketListStringLessThan(const char * const *strings) : strings_(strings) {}
+    bool operator()(int s1, int s2) const { return strcmp(strings_[s1], strings_[s2]) < 0; }
+
+private:
+    const char * const *strings_;
+};
+
+// Sorts [begin, end) of src in place if dst is NULL. Otherwise merges the
+// sorted [begin, mid) and [mid, end) of src into dst.
+template <typename T, typename LessThan>
+class PacketListSortTask : public QRunnable
+{
+public:
+    PacketListSortTask(T *src, T *dst, int begin, int mid, int end, LessThan less_than, QAtomicInt *done, QAtomicInt *cancel) :
+        src_(src),
+        dst_(dst),
+        begin_(begin),
+        mid_(mid),
+        end_(end),
+        less_than_(less_than),
+        done_(done),
+        cancel_(cancel)
+    {}
+
+    void run()
+    {
+        if (cancel_->fetchAndAddRelaxed(0) == 0) {
+            if (!dst_) {
+                std::sort(src_ + begin_, src_ + end_, less_than_);
+            } else {
+                std::merge(src_ + begin_, src_ + mid_, src_ + mid_, src_ + end_, dst_ + begin_, less_than_);
+            }
+        }
+        done_->ref();
+    }
+
+private:
+    T *src_;
+    T *dst_;
+    int begin_;
+    int mid_;
+    int end_;
+    LessThan less_than_;
+    QAtomicInt *done_;
+    QAtomicInt *cancel_;
+};
+
+// Merge sort on a pool of threads. Runs of the items are sorted, and then
+// pairs of runs are merged until one is left. Returns false if the user
+// stopped it or it was cancelled, in which case items is left as it was.
+template <typename T, typename LessThan>
+bool PacketListModel::parallelSort(QVector<T> &items, LessThan less_than, gboolean *stop_flag)
+{
+    int count = items.count();
+    if (count < 2) {
+        return true;
+    }
+
+    int num_runs = qMax(1, qMax(QThread::idealThreadCount(), count / sort_run_size_));
+    int run_size = qMax(1, (count + num_runs - 1) / num_runs);
+    num_runs = (count + run_size - 1) / run_size;
+
+    // One task per run, then one per pair of runs in each merge pass.
+    int total = num_runs;
+    for (int runs = num_runs; runs > 1; runs = (runs + 1) / 2) {
+        total += (runs + 1) / 2;
+    }
+
+    QVector<T> merged(count);
+    T *src = items.data();
+    T *dst = merged.data();
+    QThreadPool pool;
+    QAtomicInt done(0);
+    QAtomicInt cancel(0);
+    int generation = sort_generation_;
+
+    sort_pool_ = &pool;
+    sort_cancel_ = &cancel;
+    for (int begin = 0; begin < count; begin += run_size) {
+        int end = qMin(begin + run_size, count);
+        pool.start(new PacketListSortTask<T, LessThan>(src, NULL, begin, end, end, less_than, &done, &cancel));
+    }
+    if (!waitForSortTasks(&pool, &done, total, &cancel, stop_flag, generation)) {
+        return false;
+    }
+
+    for (int width = run_size; width < count; width *= 2) {
+        for (int begin = 0; begin < count; begin += 2 * width) {
+            int mid = qMin(begin + width, count);
+            int end = qMin(begin + 2 * width, count);
+            pool.start(new PacketListSortTask<T, LessThan>(src, dst, begin, mid, end, less_than, &done, &cancel));
+        }
+        if (!waitForSortTasks(&pool, &done, total, &cancel, stop_flag, generation)) {
+            return false;
+        }
+        qSwap(src, dst);
+    }
+    sort_pool_ = NULL;
+    sort_cancel_ = NULL;
+
+    if (src == merged.data()) {
+        items.swap(merged);
+    }
+    return true;
+}
+
+// Wait for the sort tasks that have been started, keeping the UI alive.
+// The tasks hold pointers into the model and capture file, so anything
+// that might change those calls cancelSort(), which finishes the tasks
+// first, and bumps the generation so that we give up.
+bool PacketListModel::waitForSortTasks(QThreadPool *pool, QAtomicInt *done, int total, QAtomicInt *cancel, gboolean *stop_flag, int generation)
+{
+    while (!pool->waitForDone(busy_timeout_)) {
+        emit updateProgressStatus(done->fetchAndAddRelaxed(0) * 100 / total);
+        wsApp->processEvents(QEventLoop::AllEvents, 1);
+        if (*stop_flag || generation != sort_generation_) {
+            cancel->ref();
+            pool->waitForDone();
+            if (sort_pool_ == pool) {
+                sort_pool_ = NULL;
+                sort_cancel_ = NULL;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
 void PacketListModel::sort(int column, Qt::SortOrder order)
 {
     // packet_list_store.c:packet_list_dissect_and_cache_all
     if (!cap_file_ || visible_rows_.count() < 1) return;
     if (column < 0) return;
 
+    // A sort of another column might be in progress.
+    cancelSort();
+    int generation = sort_generation_;
+
     sort_column_ = column;
     text_sort_column_ = PacketListRecord::textColumn(column);
     sort_order_ = order;
@@ -302,37 +533,26 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     gboolean stop_flag = FALSE;
     QString col_title = get_column_title(column);
+    QVector<PacketListSortKey> keys(physical_rows_.count());
+    bool finished;
 
     busy_timer_.start();
     emit pushProgressStatus(tr("Dissecting"), true, true, &stop_flag);
-    int row_num = 0;
-    foreach (PacketListRecord *row, physical_rows_) {
-        row->columnString(sort_cap_file_, column);
-        row_num++;
-        if (busy_timer_.elapsed() > busy_timeout_) {
-            if (stop_flag) {
-                emit popProgressStatus();
-                return;
-            }
-            emit updateProgressStatus(row_num * 100 / physical_rows_.count());
-            // What's the least amount of processing that we can do which will draw
-            // the progress indicator?
-            wsApp->processEvents(QEventLoop::AllEvents, 1);
-            busy_timer_.restart();
-        }
-    }
+    finished = setSortKeys(keys, &stop_flag, generation);
     emit popProgressStatus();
+    if (!finished) return;
 
-    // XXX Use updateProgress instead. We'd have to switch from std::sort to
-    // something we can interrupt.
-    if (!col_title.isEmpty()) {
-        QString busy_msg = tr("Sorting \"%1\"").arg(col_title);
-        emit pushBusyStatus(busy_msg);
-    }
+    QString sort_msg = col_title.isEmpty() ? tr("Sorting") : tr("Sorting \"%1\"").arg(col_title);
+    PacketListSortLessThan less_than(sort_cap_file_, sort_cap_file_->cinfo.columns[sort_column_].col_fmt,
+                                     text_sort_column_ >= 0, sort_order_);
+    emit pushProgressStatus(sort_msg, true, true, &stop_flag);
+    finished = parallelSort(keys, less_than, &stop_flag);
+    emit popProgressStatus();
+    if (!finished) return;
 
-    busy_timer_.restart();
-    sort_column_is_numeric_ = isNumericColumn(sort_column_);
-    std::sort(physical_rows_.begin(), physical_rows_.end(), recordLessThan);
+    for (int i = 0; i < keys.count(); i++) {
+        physical_rows_[i] = keys[i].record;
+    }
 
     beginResetModel();
     visible_rows_.resize(0);
@@ -349,16 +569,101 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
         }
     }
     endResetModel();
-
-    if (!col_title.isEmpty()) {
-        emit popBusyStatus();
-    }
+    dissector_->restart(cap_file_);
 
     if (cap_file_->current_frame) {
         emit goToPacket(cap_file_->current_frame->num);
     }
 }
 
+// Fill in the sort key of each row. Text columns require each packet to be
+// dissected, which can only be done here, one at a time. Each distinct
+// string is then converted to a number or ranked just once.
+// Returns false if the user stopped it or it was cancelled.
+bool PacketListModel::setSortKeys(QVector<PacketListSortKey> &keys, gboolean *stop_flag, int generation)
+{
+    // Packets might be added while we process events. They'll stay at the end.
+    for (int row_num = 0; row_num < keys.count(); row_num++) {
+        keys[row_num].record = physical_rows_[row_num];
+        keys[row_num].value = 0;
+        keys[row_num].valid = true;
+    }
+
+    if (text_sort_column_ < 0) {
+        // Compared using the frame data.
+        return true;
+    }
+
+    // Column text is only valid until the next record is dissected, so
+    // we keep a copy of each distinct string.
+    QHash<QByteArray, int> string_ids;
+    QVector<QByteArray> string_data;
+    QVector<int> row_string_ids(keys.count());
+    for (int row_num = 0; row_num < keys.count(); row_num++) {
+        const char *col_str = keys[row_num].record->columnText(sort_cap_file_, sort_column_);
+        if (!col_str) col_str = "";
+
+        QHash<QByteArray, int>::const_iterator it = string_ids.constFind(QByteArray::fromRawData(col_str, (int) strlen(col_str)));
+        if (it == string_ids.constEnd()) {
+            QByteArray col_data(col_str);
+            it = string_ids.insert(col_data, string_data.count());
+            string_data << col_data;
+        }
+        row_string_ids[row_num] = it.value();
+
+        if (busy_timer_.elapsed() > busy_timeout_) {
+            emit updateProgressStatus(row_num * 100 / keys.count());
+            // What's the least amount of processing that we can do which will draw
+            // the progress indicator?
+            wsApp->processEvents(QEventLoop::AllEvents, 1);
+            // The user might have stopped us, or closed the file or cleared
+            // the list out from under the keys.
+            if (*stop_flag || generation != sort_generation_) {
+                return false;
+            }
+            busy_timer_.restart();
+        }
+    }
+
+    QVector<const char *> strings(string_data.count());
+    for (int i = 0; i < string_data.count(); i++) {
+        strings[i] = string_data[i].constData();
+    }
+
+    QVector<double> string_values(strings.count());
+    QVector<bool> string_valid(strings.count(), true);
+    if (isNumericColumn(sort_column_)) {
+        for (int i = 0; i < strings.count(); i++) {
+            bool ok;
+            string_values[i] = parseNumericColumn(strings[i], &ok);
+            // NaN doesn't compare, so it's not a number as far as we're concerned.
+            string_valid[i] = ok && string_values[i] == string_values[i];
+        }
+    } else {
+        // Sort the distinct strings and give equal ones the same rank.
+        QVector<int> order(strings.count());
+        for (int i = 0; i < order.count(); i++) {
+            order[i] = i;
+        }
+        if (!parallelSort(order, PacketListStringLessThan(strings.constData()), stop_flag)) {
+            return false;
+        }
+        for (int i = 0; i < order.count(); i++) {
+            if (i > 0 && strcmp(strings[order[i]], strings[order[i - 1]]) == 0) {
+                string_values[order[i]] = string_values[order[i - 1]];
+            } else {
+                string_values[order[i]] = i;
+            }
+        }
+    }
+
+    for (int row_num = 0; row_num < keys.count(); row_num++) {
+        keys[row_num].value = string_values[row_string_ids[row_num]];
+        keys[row_num].valid = string_valid[row_string_ids[row_num]];
+    }
+    return true;
+}
+
 bool PacketListModel::isNumericColumn(int column)
 {
     if (column < 0 || sort_cap_file_->cinfo.columns[column].col_fmt != COL_CUSTOM) {
@@ -401,77 +706,14 @@ bool PacketListModel::isNumericColumn(int column)
     return true;
 }
 
-bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
-{
-    int cmp_val = 0;
-
-    // Wherein we try to cram the logic of packet_list_compare_records,
-    // _packet_list_compare_records, and packet_list_compare_custom from
-    // gtk/packet_list_store.c into one function
-
-    if (busy_timer_.elapsed() > busy_timeout_) {
-        // What's the least amount of processing that we can do which will draw
-        // the busy indicator?
-        wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
-        busy_timer_.restart();
-    }
-    if (sort_column_ < 0) {
-        // No column.
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
-    } else if (text_sort_column_ < 0) {
-        // Column comes directly from frame data
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
-    } else  {
-        if (r1->columnString(sort_cap_file_, sort_column_).constData() == r2->columnString(sort_cap_file_, sort_column_).constData()) {
-            cmp_val = 0;
-        } else if (sort_cap_file_->cinfo.columns[sort_column_].col_fmt == COL_CUSTOM) {
-            // Column comes from custom data
-            if (sort_column_is_numeric_) {
-                // Attempt to convert to numbers.
-                // XXX This is slow. Can we avoid doing this?
-                bool ok_r1, ok_r2;
-                double num_r1 = parseNumericColumn(r1->columnString(sort_cap_file_, sort_column_), &ok_r1);
-                double num_r2 = parseNumericColumn(r2->columnString(sort_cap_file_, sort_column_), &ok_r2);
-
-                if (!ok_r1 && !ok_r2) {
-                    cmp_val = 0;
-                } else if (!ok_r1 || (ok_r2 && num_r1 < num_r2)) {
-                    // either r1 is invalid (and sort it before others) or both
-                    // r1 and r2 are valid (sort normally)
-                    cmp_val = -1;
-                } else if (!ok_r2 || (ok_r1 && num_r1 > num_r2)) {
-                    cmp_val = 1;
-                }
-            } else {
-                cmp_val = strcmp(r1->columnString(sort_cap_file_, sort_column_).constData(), r2->columnString(sort_cap_file_, sort_column_).constData());
-            }
-        } else {
-            cmp_val = strcmp(r1->columnString(sort_cap_file_, sort_column_).constData(), r2->columnString(sort_cap_file_, sort_column_).constData());
-        }
-
-        if (cmp_val == 0) {
-            // All else being equal, compare column numbers.
-            cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
-        }
-    }
-
-    if (sort_order_ == Qt::AscendingOrder) {
-        return cmp_val < 0;
-    } else {
-        return cmp_val > 0;
-    }
-}
-
 // Parses a field as a double. Handle values with suffixes ("12ms"), negative
 // values ("-1.23") and fields with multiple occurrences ("1,2"). Marks values
 // that do not contain any numeric value ("Unknown") as invalid.
-double PacketListModel::parseNumericColumn(const QString &val, bool *ok)
+double PacketListModel::parseNumericColumn(const char *val, bool *ok)
 {
-    QByteArray ba = val.toUtf8();
-    const char *strval = ba.constData();
     gchar *end = NULL;
-    double num = g_ascii_strtod(strval, &end);
-    *ok = strval != end;
+    double num = g_ascii_strtod(val, &end);
+    *ok = val != end;
     return num;
 }
 
@@ -632,36 +874,17 @@ void PacketListModel::flushVisibleRows()
     }
 }
 
-// Fill our column string and colorization cache while the application is
-// idle. Try to be as conservative with the CPU and disk as possible.
-static const int idle_dissection_interval_ = 5; // ms
-void PacketListModel::dissectIdle(bool reset)
+// Fill our column string and colorization cache in the background,
+// starting over from the first row.
+void PacketListModel::dissectInBackground()
 {
-    if (reset) {
-//        qDebug() << "=di reset" << idle_dissection_row_;
-        idle_dissection_row_ = 0;
-    } else if (!idle_dissection_timer_->isValid()) {
-        return;
-    }
-
-    idle_dissection_timer_->restart();
-
-    int first = idle_dissection_row_;
-    while (idle_dissection_timer_->elapsed() < idle_dissection_interval_
-           && idle_dissection_row_ < physical_rows_.count()) {
-        ensureRowColorized(idle_dissection_row_);
-        idle_dissection_row_++;
-//        if (idle_dissection_row_ % 1000 == 0) qDebug() << "=di row" << idle_dissection_row_;
-    }
-
-    if (idle_dissection_row_ < physical_rows_.count()) {
-        QTimer::singleShot(idle_dissection_interval_, this, SLOT(dissectIdle()));
-    } else {
-        idle_dissection_timer_->invalidate();
-    }
+    dissector_->restart(cap_file_);
+}
 
-    // report colorization progress
-    bgColorizationProgress(first+1, idle_dissection_row_+1);
+// Fill in the rows around the viewport ahead of time.
+void PacketListModel::setViewportRows(int first, int last)
+{
+    dissector_->setViewport(first, last);
 }
 
 // XXX Pass in cinfo from packet_list_append so that we can fill in
@@ -25,7 +25,12 @@
 
 #include "cfile.h"
 
-class QElapsedTimer;
+class QAtomicInt;
+class QThreadPool;
+
+class PacketListDissector;
+
+struct PacketListSortKey;
 
 class PacketListModel : public QAbstractItemModel
 {
@@ -40,6 +45,7 @@ public:
     int packetNumberToRow(int packet_num) const;
     guint recreateVisibleRows();
     void clear();
+    void cancelSort();
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int columnCount(const QModelIndex & = QModelIndex()) const;
@@ -50,8 +56,10 @@ public:
     gint appendPacket(frame_data *fdata);
     frame_data *getRowFdata(int row);
     void ensureRowColorized(int row);
+    void setViewportRows(int first, int last);
     int visibleIndexOf(frame_data *fdata) const;
     void resetColumns();
+    void resetColumn(int column);
     void resetColorized();
     void toggleFrameMark(const QModelIndex &fm_index);
     void setDisplayedFrameMark(gboolean set);
@@ -79,7 +87,7 @@ signals:
 public slots:
     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     void flushVisibleRows();
-    void dissectIdle(bool reset = false);
+    void dissectInBackground();
 
 private:
     capture_file *cap_file_;
@@ -93,20 +101,30 @@ private:
     int max_line_count_;
 
     static int sort_column_;
-    static int sort_column_is_numeric_;
     static int text_sort_column_;
     static Qt::SortOrder sort_order_;
     static capture_file *sort_cap_file_;
-    static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
-    static double parseNumericColumn(const QString &val, bool *ok);
+    static double parseNumericColumn(const char *val, bool *ok);
+    bool setSortKeys(QVector<PacketListSortKey> &keys, gboolean *stop_flag, int generation);
+    template <typename T, typename LessThan>
+    bool parallelSort(QVector<T> &items, LessThan less_than, gboolean *stop_flag);
+    bool waitForSortTasks(QThreadPool *pool, QAtomicInt *done, int total, QAtomicInt *cancel, gboolean *stop_flag, int generation);
 
-    QElapsedTimer *idle_dissection_timer_;
-    int idle_dissection_row_;
+    // Bumped whenever the rows or the capture file might change under a
+    // sort in progress.
+    int sort_generation_;
+    // The tasks of the sort in progress, if any.
+    QThreadPool *sort_pool_;
+    QAtomicInt *sort_cancel_;
+
+    PacketListDissector *dissector_;
 
     bool isNumericColumn(int column);
 
 private slots:
     void emitItemHeightChanged(const QModelIndex &ih_index);
+
+    friend class PacketListDissector;
 };
 
 #endif // PACKET_LIST_MODEL_H
@@ -17,30 +17,24 @@
 #include <epan/wmem/wmem.h>
 
 #include <epan/color_filters.h>
+#include <epan/prefs.h>
 
 #include "frame_tvbuff.h"
 
-#include <QStringList>
-
-class ColumnTextList : public QList<const char *> {
-public:
-    // Allocate our records using wmem.
-    static void *operator new(size_t size) {
-        return wmem_alloc(wmem_file_scope(), size);
-    }
+#include "ui/column_text_store.h"
 
-    static void operator delete(void *) {}
-};
+#include <QStringList>
 
 QMap<int, int> PacketListRecord::cinfo_column_;
-unsigned PacketListRecord::col_data_ver_ = 1;
+
+// This assumes only one packet list. We might want to move this to
+// PacketListModel.
+column_text_store_t *PacketListRecord::column_store_ = column_text_store_new(128 * 1024 * 1024);
 
 PacketListRecord::PacketListRecord(frame_data *frameData) :
-    col_text_(0),
     fdata_(frameData),
     lines_(1),
     line_count_changed_(false),
-    data_ver_(0),
     colorized_(false),
     conv_(NULL)
 {
@@ -51,33 +45,92 @@ void *PacketListRecord::operator new(size_t size)
     return wmem_alloc(wmem_file_scope(), size);
 }
 
-// We might want to return a const char * instead. This would keep us from
-// creating excessive QByteArrays, e.g. in PacketListModel::recordLessThan.
 const QByteArray PacketListRecord::columnString(capture_file *cap_file, int column, bool colorized)
+{
+    return QByteArray(columnText(cap_file, column, colorized));
+}
+
+const char *PacketListRecord::columnText(capture_file *cap_file, int column, bool colorized)
 {
     // packet_list_store.c:packet_list_get_value
     g_assert(fdata_);
 
-    if (!cap_file || column < 0 || column > cap_file->cinfo.num_cols) {
-        return QByteArray();
+    if (!cap_file || column < 0 || column >= cap_file->cinfo.num_cols) {
+        return NULL;
     }
 
     bool dissect_color = colorized && !colorized_;
-    if (!col_text_ || column >= col_text_->size() || !col_text_->at(column) || data_ver_ != col_data_ver_ || dissect_color) {
+    const char *text = NULL;
+    if (!dissect_color) {
+        text = column_text_store_get(column_store_, column, fdata_->num);
+    }
+    if (!text) {
         dissect(cap_file, dissect_color);
+        text = column_text_store_get(column_store_, column, fdata_->num);
     }
 
-    return col_text_->value(column, QByteArray());
+    return text;
+}
+
+// Strings in these columns are repeated a lot, so we only store each
+// one once.
+static bool internColumn(column_info *cinfo, int column)
+{
+    switch (cinfo->columns[column].col_fmt) {
+    case COL_PROTOCOL:
+    case COL_DEF_SRC:
+    case COL_RES_SRC:
+    case COL_UNRES_SRC:
+    case COL_DEF_DL_SRC:
+    case COL_RES_DL_SRC:
+    case COL_UNRES_DL_SRC:
+    case COL_DEF_NET_SRC:
+    case COL_RES_NET_SRC:
+    case COL_UNRES_NET_SRC:
+    case COL_DEF_DST:
+    case COL_RES_DST:
+    case COL_UNRES_DST:
+    case COL_DEF_DL_DST:
+    case COL_RES_DL_DST:
+    case COL_UNRES_DL_DST:
+    case COL_DEF_NET_DST:
+    case COL_RES_NET_DST:
+    case COL_UNRES_NET_DST:
+        return true;
+    default:
+        return false;
+    }
 }
 
 void PacketListRecord::resetColumns(column_info *cinfo)
 {
-    col_data_ver_++;
+    setCacheSize();
 
     if (!cinfo) {
+        column_text_store_clear(column_store_, 0);
         return;
     }
 
+    mapTextColumns(cinfo);
+    column_text_store_clear(column_store_, cinfo->num_cols);
+    for (int i = 0; i < cinfo->num_cols; i++) {
+        column_text_store_clear_column(column_store_, i, internColumn(cinfo, i));
+    }
+}
+
+// Throw away the text of a single column, e.g. after it's been edited.
+void PacketListRecord::resetColumn(column_info *cinfo, int column)
+{
+    if (!cinfo || column < 0 || column >= cinfo->num_cols) {
+        return;
+    }
+
+    mapTextColumns(cinfo);
+    column_text_store_clear_column(column_store_, column, internColumn(cinfo, column));
+}
+
+void PacketListRecord::mapTextColumns(column_info *cinfo)
+{
     cinfo_column_.clear();
     int i, j;
     for (i = 0, j = 0; i < cinfo->num_cols; i++) {
@@ -88,11 +141,42 @@ void PacketListRecord::resetColumns(column_info *cinfo)
     }
 }
 
+void PacketListRecord::setCacheSize()
+{
+    column_text_store_set_budget(column_store_, (gsize) prefs.gui_packet_list_cache_size * 1024 * 1024);
+}
+
 void PacketListRecord::resetColorized()
 {
     colorized_ = false;
 }
 
+bool PacketListRecord::columnsCached() const
+{
+    return column_text_store_has_row(column_store_, fdata_->num);
+}
+
+void PacketListRecord::dissectRecord(capture_file *cap_file, epan_dissect_t *edt,
+                                     const struct packet_provider_data *prov,
+                                     wtap_rec *rec, Buffer *buf, bool fill_columns)
+{
+    g_assert(fdata_);
+
+    if (!cap_file) {
+        return;
+    }
+
+    bool dissect_columns = fill_columns && !columnsCached();
+    bool dissect_color = !colorized_;
+
+    if (!dissect_columns && !dissect_color) {
+        return;
+    }
+
+    runDissection(cap_file, edt, prov, rec, buf, dissect_color, dissect_columns);
+    epan_dissect_reset(edt);
+}
+
 void PacketListRecord::dissect(capture_file *cap_file, bool dissect_color)
 {
     // packet_list_store.c:packet_list_dissect_and_cache_record
@@ -102,13 +186,12 @@ void PacketListRecord::dissect(capture_file *cap_file, bool dissect_color)
     wtap_rec rec; /* Record metadata */
     Buffer buf;   /* Record data */
 
-    if (!col_text_) col_text_ = new ColumnTextList;
-    gboolean dissect_columns = col_text_->isEmpty() || data_ver_ != col_data_ver_;
-
     if (!cap_file) {
         return;
     }
 
+    gboolean dissect_columns = !columnsCached();
+
     memset(&rec, 0, sizeof rec);
 
     if (dissect_columns) {
@@ -160,49 +243,63 @@ void PacketListRecord::dissect(capture_file *cap_file, bool dissect_color)
                       create_proto_tree,
                       FALSE /* proto_tree_visible */);
 
+    runDissection(cap_file, &edt, &cap_file->provider, &rec, &buf,
+                  dissect_color, dissect_columns);
+
+    epan_dissect_cleanup(&edt);
+    ws_buffer_free(&buf);
+}
+
+void PacketListRecord::runDissection(capture_file *cap_file, epan_dissect_t *edt,
+                                     const struct packet_provider_data *prov,
+                                     wtap_rec *rec, Buffer *buf,
+                                     bool dissect_color, bool dissect_columns)
+{
+    column_info *cinfo = dissect_columns ? &cap_file->cinfo : NULL;
+
     /* Re-color when the coloring rules are changed via the UI. */
     if (dissect_color) {
-        color_filters_prime_edt(&edt);
+        color_filters_prime_edt(edt);
         fdata_->flags.need_colorize = 1;
     }
     if (dissect_columns)
-        col_custom_prime_edt(&edt, cinfo);
+        col_custom_prime_edt(edt, cinfo);
 
     /*
      * XXX - need to catch an OutOfMemoryError exception and
      * attempt to recover from it.
      */
-    epan_dissect_run(&edt, cap_file->cd_t, &rec,
-                     frame_tvbuff_new_buffer(&cap_file->provider, fdata_, &buf),
+    epan_dissect_run(edt, cap_file->cd_t, rec,
+                     frame_tvbuff_new_buffer(prov, fdata_, buf),
                      fdata_, cinfo);
 
     if (dissect_columns) {
         /* "Stringify" non frame_data vals */
-        epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+        epan_dissect_fill_in_columns(edt, FALSE, FALSE /* fill_fd_columns */);
         cacheColumnStrings(cinfo);
     }
 
     if (dissect_color) {
         colorized_ = true;
     }
-    data_ver_ = col_data_ver_;
 
-    packet_info *pi = &edt.pi;
+    packet_info *pi = &edt->pi;
     conv_ = find_conversation_pinfo(pi, 0);
+}
 
-    epan_dissect_cleanup(&edt);
-    ws_buffer_free(&buf);
+void PacketListRecord::clearColumnCache()
+{
+    setCacheSize();
+    column_text_store_clear(column_store_, column_text_store_num_columns(column_store_));
 }
 
-// This assumes only one packet list. We might want to move this to
-// PacketListModel (or replace this with a wmem allocator).
-struct _GStringChunk *PacketListRecord::string_pool_ = g_string_chunk_new(1 * 1024 * 1024);
-void PacketListRecord::clearStringPool()
+// Called at exit, after the packet list is gone.
+void PacketListRecord::freeColumnCache()
 {
-    g_string_chunk_clear(string_pool_);
+    column_text_store_free(column_store_);
+    column_store_ = NULL;
 }
 
-//#define MINIMIZE_STRING_COPYING 1
 void PacketListRecord::cacheColumnStrings(column_info *cinfo)
 {
     // packet_list_store.c:packet_list_change_record(PacketList *packet_list, PacketListRecord *record, gint col, column_info *cinfo)
@@ -210,74 +307,11 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
         return;
     }
 
-    if (col_text_) {
-        col_text_->clear();
-    } else {
-        col_text_ = new ColumnTextList;
-    }
     lines_ = 1;
     line_count_changed_ = false;
 
     for (int column = 0; column < cinfo->num_cols; ++column) {
         int col_lines = 1;
-
-#ifdef MINIMIZE_STRING_COPYING
-        int text_col = cinfo_column_.value(column, -1);
-
-        /* Column based on frame_data or it already contains a value */
-        if (text_col < 0) {
-            col_fill_in_frame_data(fdata_, cinfo, column, FALSE);
-            col_text_->append(cinfo->columns[column].col_data);
-            continue;
-        }
-
-        switch (cinfo->col_fmt[column]) {
-        case COL_PROTOCOL:
-        case COL_INFO:
-        case COL_IF_DIR:
-        case COL_DCE_CALL:
-        case COL_8021Q_VLAN_ID:
-        case COL_EXPERT:
-        case COL_FREQ_CHAN:
-            if (cinfo->columns[column].col_data && cinfo->columns[column].col_data != cinfo->columns[column].col_buf) {
-                /* This is a constant string, so we don't have to copy it */
-                // XXX - ui/gtk/packet_list_store.c uses G_MAXUSHORT. We don't do proper UTF8
-                // truncation in either case.
-                int col_text_len = MIN(qstrlen(cinfo->col_data[column]) + 1, COL_MAX_INFO_LEN);
-                col_text_->append(QByteArray::fromRawData(cinfo->columns[column].col_data, col_text_len));
-                break;
-            }
-            /* !! FALL-THROUGH!! */
-
-        case COL_DEF_SRC:
-        case COL_RES_SRC:        /* COL_DEF_SRC is currently just like COL_RES_SRC */
-        case COL_UNRES_SRC:
-        case COL_DEF_DL_SRC:
-        case COL_RES_DL_SRC:
-        case COL_UNRES_DL_SRC:
-        case COL_DEF_NET_SRC:
-        case COL_RES_NET_SRC:
-        case COL_UNRES_NET_SRC:
-        case COL_DEF_DST:
-        case COL_RES_DST:        /* COL_DEF_DST is currently just like COL_RES_DST */
-        case COL_UNRES_DST:
-        case COL_DEF_DL_DST:
-        case COL_RES_DL_DST:
-        case COL_UNRES_DL_DST:
-        case COL_DEF_NET_DST:
-        case COL_RES_NET_DST:
-        case COL_UNRES_NET_DST:
-        default:
-            if (!get_column_resolved(column) && cinfo->col_expr.col_expr_val[column]) {
-                /* Use the unresolved value in col_expr_val */
-                // XXX Use QContiguousCache?
-                col_text_->append(cinfo->col_expr.col_expr_val[column]);
-            } else {
-                col_text_->append(cinfo->columns[column].col_data);
-            }
-            break;
-        }
-#else // MINIMIZE_STRING_COPYING
         const char *col_str;
         if (!get_column_resolved(column) && cinfo->col_expr.col_expr_val[column]) {
             /* Use the unresolved value in col_expr_val */
@@ -290,12 +324,8 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
             }
             col_str = cinfo->columns[column].col_data;
         }
-        // g_string_chunk_insert_const manages a hash table of pointers to
-        // strings:
-        // https://git.gnome.org/browse/glib/tree/glib/gstringchunk.c
-        // We might be better off adding the equivalent functionality to
-        // wmem_tree.
-        col_text_->append(g_string_chunk_insert_const(string_pool_, col_str));
+        // Columns that are already cached are left alone.
+        column_text_store_set(column_store_, column, fdata_->num, col_str);
         for (int i = 0; col_str[i]; i++) {
             if (col_str[i] == '\n') col_lines++;
         }
@@ -303,7 +333,6 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
             lines_ = col_lines;
             line_count_changed_ = true;
         }
-#endif // MINIMIZE_STRING_COPYING
     }
 }
 
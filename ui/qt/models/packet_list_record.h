@@ -23,9 +23,7 @@
 #include <QVariant>
 
 struct conversation;
-struct _GStringChunk;
-
-class ColumnTextList;
+struct _column_text_store_t;
 
 class PacketListRecord
 {
@@ -38,32 +36,39 @@ public:
 
     // Return the string value for a column. Data is cached if possible.
     const QByteArray columnString(capture_file *cap_file, int column, bool colorized = false);
+    // Like columnString, but without making a copy. The string is valid
+    // until the next record is dissected.
+    const char *columnText(capture_file *cap_file, int column, bool colorized = false);
     frame_data *frameData() const { return fdata_; }
     // packet_list->col_to_text in gtk/packet_list_store.c
     static int textColumn(int column) { return cinfo_column_.value(column, -1); }
     bool colorized() { return colorized_; }
+    // Is our text cached for every column?
+    bool columnsCached() const;
+    // Dissect a record that the caller has already read, using the
+    // caller's provider and epan_dissect_t. Used by PacketListDissector,
+    // which has its own wiretap handle.
+    void dissectRecord(capture_file *cap_file, epan_dissect_t *edt,
+                       const struct packet_provider_data *prov,
+                       wtap_rec *rec, Buffer *buf, bool fill_columns);
     struct conversation *conversation() { return conv_; }
 
     int columnTextSize(const char *str);
     static void resetColumns(column_info *cinfo);
+    static void resetColumn(column_info *cinfo, int column);
     void resetColorized();
     inline int lineCount() { return lines_; }
     inline int lineCountChanged() { return line_count_changed_; }
 
-    static void clearStringPool();
+    static void clearColumnCache();
+    static void freeColumnCache();
 
 private:
-    /** The column text for some columns */
-    ColumnTextList *col_text_;
-
     frame_data *fdata_;
     int lines_;
     bool line_count_changed_;
     static QMap<int, int> cinfo_column_;
 
-    /** Data versions. Used to invalidate col_text_ */
-    static unsigned col_data_ver_;
-    unsigned data_ver_;
     /** Has this record been colorized? */
     bool colorized_;
 
@@ -71,9 +76,16 @@ private:
     struct conversation *conv_;
 
     void dissect(capture_file *cap_file, bool dissect_color = false);
+    void runDissection(capture_file *cap_file, epan_dissect_t *edt,
+                       const struct packet_provider_data *prov,
+                       wtap_rec *rec, Buffer *buf,
+                       bool dissect_color, bool dissect_columns);
     void cacheColumnStrings(column_info *cinfo);
+    static void mapTextColumns(column_info *cinfo);
+    static void setCacheSize();
 
-    static struct _GStringChunk *string_pool_;
+    /** Column text for all records, by frame number */
+    static struct _column_text_store_t *column_store_;
 
 };
 
@@ -594,6 +594,14 @@ void PacketList::paintEvent(QPaintEvent *event)
     // require a new overlay, e.g. page up/down, scrolling, column
     // resizing, etc.
     create_near_overlay_ = true;
+
+    QModelIndex first_idx = indexAt(viewport()->rect().topLeft());
+    if (first_idx.isValid()) {
+        QModelIndex last_idx = indexAt(viewport()->rect().bottomLeft());
+        int last_row = last_idx.isValid() ? last_idx.row() : packet_list_model_->rowCount() - 1;
+        packet_list_model_->setViewportRows(first_idx.row(), last_row);
+    }
+
     QTreeView::paintEvent(event);
 }
 
@@ -780,6 +788,21 @@ void PacketList::columnsChanged()
     columns_changed_ = false;
 }
 
+// A single column in prefs.col_list has been edited.
+void PacketList::columnEdited(int column)
+{
+    if (!cap_file_ || columns_changed_) {
+        columnsChanged();
+        return;
+    }
+
+    col_cleanup(&cap_file_->cinfo);
+    build_column_format_array(&cap_file_->cinfo, prefs.num_cols, FALSE);
+    create_far_overlay_ = true;
+    // The other columns' text is still valid.
+    packet_list_model_->resetColumn(column);
+}
+
 // Fields have changed, update custom columns
 void PacketList::fieldsChanged(capture_file *cf)
 {
@@ -882,11 +905,13 @@ void PacketList::setVerticalAutoScroll(bool enabled)
 void PacketList::captureFileReadFinished()
 {
     packet_list_model_->flushVisibleRows();
-    packet_list_model_->dissectIdle(true);
+    packet_list_model_->dissectInBackground();
 }
 
 void PacketList::freeze()
 {
+    // The frames and their columns are about to change under a sort.
+    packet_list_model_->cancelSort();
     setUpdatesEnabled(false);
     column_state_ = header()->saveState();
     if (currentIndex().isValid()) {
@@ -1372,7 +1397,7 @@ void PacketList::headerMenuTriggered()
         break;
     case caResolveNames:
         set_column_resolved(header_ctx_column_, checked);
-        packet_list_model_->resetColumns();
+        packet_list_model_->resetColumn(header_ctx_column_);
         if (!prefs.gui_use_pref_save) {
             prefs_main_write();
         }
@@ -168,6 +168,7 @@ public slots:
     void redrawVisiblePackets();
     void redrawVisiblePacketsDontSelectCurrent();
     void columnsChanged();
+    void columnEdited(int column);
     void fieldsChanged(capture_file *cf);
     void preferencesChanged();
 
@@ -245,6 +245,8 @@ void ProgressFrame::hide()
 #if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
     show_timer_ = -1;
 #endif
+    // The flag might not outlive the operation it belongs to.
+    stop_flag_ = NULL;
     emit setHidden();
     QFrame::hide();
 #ifdef QWINTASKBARPROGRESS_H
@@ -258,6 +260,11 @@ void ProgressFrame::hide()
 
 void ProgressFrame::on_stopButton_clicked()
 {
+    // Whoever showed us might be polling its own flag rather than
+    // listening for stopLoading, e.g. the packet list while it sorts.
+    if (stop_flag_) {
+        *stop_flag_ = TRUE;
+    }
     emit stopLoading();
 }
 
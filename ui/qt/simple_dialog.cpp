@@ -24,8 +24,10 @@
 #include <QCheckBox>
 #endif
 #include <QMessageBox>
+#include <QMutex>
 #include <QRegExp>
 #include <QTextCodec>
+#include <QThread>
 
 /* Simple dialog function - Displays a dialog box with the supplied message
  * text.
@@ -42,6 +44,8 @@
 
 QList<MessagePair> message_queue_;
 ESD_TYPE_E max_severity_ = ESD_TYPE_INFO;
+// Dissectors can report failures from the packet list's background thread.
+static QMutex message_queue_mutex_;
 
 const char *primary_delimiter_ = "__CB754A38-94A2-4E59-922D-DD87EDC80E22__";
 
@@ -96,7 +100,7 @@ simple_message_box(ESD_TYPE_E type, gboolean *notagain,
 
 #if (QT_VERSION > QT_VERSION_CHECK(5, 2, 0))
     QCheckBox *cb = NULL;
-    if (notagain) {
+    if (notagain && SimpleDialog::isGuiThread()) {
         cb = new QCheckBox();
         cb->setChecked(true);
         cb->setText(QObject::tr("Don't show this message again."));
@@ -183,7 +187,12 @@ SimpleDialog::SimpleDialog(QWidget *parent, ESD_TYPE_E type, int btn_mask, const
         return;
     }
 
-    if (!parent || !wsApp->isInitialized() || wsApp->isReloadingLua()) {
+    if (!parent || !wsApp->isInitialized() || wsApp->isReloadingLua() || !isGuiThread()) {
+        QMutexLocker locker(&message_queue_mutex_);
+        // Widgets can only be used by the GUI thread, so let it know.
+        if (!isGuiThread() && message_queue_.isEmpty()) {
+            QMetaObject::invokeMethod(wsApp, "displayQueuedMessages", Qt::QueuedConnection);
+        }
         message_queue_ << msg_pair;
         if (type > max_severity_) {
             max_severity_ = type;
@@ -248,8 +257,14 @@ SimpleDialog::~SimpleDialog()
 {
 }
 
+bool SimpleDialog::isGuiThread()
+{
+    return !wsApp || QThread::currentThread() == wsApp->thread();
+}
+
 void SimpleDialog::displayQueuedMessages(QWidget *parent)
 {
+    QMutexLocker locker(&message_queue_mutex_);
     if (message_queue_.isEmpty()) {
         return;
     }
@@ -296,6 +311,7 @@ void SimpleDialog::displayQueuedMessages(QWidget *parent)
 
     message_queue_.clear();
     max_severity_ = ESD_TYPE_INFO;
+    locker.unlock();
 
     mb.exec();
 }
@@ -35,6 +35,7 @@ public:
     explicit SimpleDialog(QWidget *parent, ESD_TYPE_E type, int btn_mask, const char *msg_format, va_list ap);
     ~SimpleDialog();
 
+    static bool isGuiThread();
     static void displayQueuedMessages(QWidget *parent = 0);
     void setDetailedText(QString text) { detailed_text_ = text; }
 #if (QT_VERSION > QT_VERSION_CHECK(5, 2, 0))
@@ -44,6 +44,7 @@
 #include "epan/color_filters.h"
 #include "log.h"
 #include "recent_file_status.h"
+#include "simple_dialog.h"
 
 #include "extcap.h"
 #ifdef HAVE_LIBPCAP
@@ -699,6 +700,12 @@ void WiresharkApplication::clearRecentCaptures() {
     emit updateRecentCaptureStatus(NULL, 0, false);
 }
 
+// Messages reported by threads other than ours, which can't show dialogs.
+void WiresharkApplication::displayQueuedMessages()
+{
+    SimpleDialog::displayQueuedMessages(mainWindow());
+}
+
 void WiresharkApplication::cleanup()
 {
     software_update_cleanup();
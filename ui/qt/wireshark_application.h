@@ -200,6 +200,7 @@ signals:
 public slots:
     void clearRecentCaptures();
     void refreshRecentCaptures();
+    void displayQueuedMessages();
 
     void captureEventHandler(CaptureEvent *);
 
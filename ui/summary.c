@@ -136,7 +136,7 @@ summary_fill_in(capture_file *cf, summary_tally *st)
   st->filename = cf->filename;
   st->file_length = cf->f_datalen;
   st->file_type = cf->cd_t;
-  st->iscompressed = cf->iscompressed;
+  st->compression_type = cf->compression_type;
   st->is_tempfile = cf->is_tempfile;
   st->file_encap_type = cf->lnk_t;
   st->packet_encap_types = cf->linktypes;
@@ -53,7 +53,7 @@ typedef struct _summary_tally {
   const char  *filename;
   gint64       file_length;        /**< file length in bytes */
   int          file_type;          /**< wiretap file type */
-  int          iscompressed;       /**< TRUE if file is compressed */
+  wtap_compression_type compression_type; /**< compression type of file, or uncompressed */
   int          file_encap_type;    /**< wiretap encapsulation type for file */
   GArray      *packet_encap_types; /**< wiretap encapsulation types for packets */
   int          snap;               /**< Maximum captured packet length; 0 if not known */
@@ -105,6 +105,8 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
     struct segment current;
     GString    *error_string;
     tcp_scan_t  ts;
+    const guint32 *frames;
+    guint32     num_frames;
 
     g_log(NULL, G_LOG_LEVEL_DEBUG, "graph_segment_list_get()");
 
@@ -129,7 +131,7 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
             ts.direction = COMPARE_ANY_DIR;
     }
 
-    /* rescan all the packets and pick up all interesting tcp headers.
+    /* rescan the stream's packets and pick up all interesting tcp headers.
      * we only filter for TCP here for speed and do the actual compare
      * in the tap listener
      */
@@ -143,7 +145,14 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
         g_string_free(error_string, TRUE);
         exit(1);   /* XXX: fix this */
     }
-    cf_retap_packets(cf);
+    /* The TCP dissector remembers which frames belong to each stream,
+     * so only those need to be dissected again. */
+    frames = get_tcp_stream_frames(tg->stream, &num_frames);
+    if (frames) {
+        cf_retap_frames(cf, &ts, frames, num_frames);
+    } else {
+        cf_retap_packets(cf);
+    }
     remove_tap_listener(&ts);
 }
 
@@ -89,6 +89,7 @@
 #include "ui/qt/coloring_rules_dialog.h"
 #include "ui/qt/endpoint_dialog.h"
 #include "ui/qt/main_window.h"
+#include "ui/qt/models/packet_list_record.h"
 #include "ui/qt/response_time_delay_dialog.h"
 #include "ui/qt/service_response_time_dialog.h"
 #include "ui/qt/simple_dialog.h"
@@ -938,6 +939,7 @@ int main(int argc, char *qt_argv[])
     ret_val = wsApp->exec();
 
     delete main_w;
+    PacketListRecord::freeColumnCache();
     recent_cleanup();
     epan_cleanup();
 
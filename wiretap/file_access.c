@@ -2115,7 +2115,91 @@ wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
+wtap_compression_type
+wtap_name_to_compression_type(const char *filename)
+{
+	const char *extensionp;
+
+	extensionp = strrchr(filename, '.');
+	if (extensionp == NULL)
+		return WTAP_UNCOMPRESSED;
+	extensionp++;
+	if (g_ascii_strcasecmp(extensionp, "gz") == 0)
+		return WTAP_GZIP_COMPRESSED;
+	if (g_ascii_strcasecmp(extensionp, "zst") == 0)
+		return WTAP_ZSTD_COMPRESSED;
+	if (g_ascii_strcasecmp(extensionp, "lz4") == 0)
+		return WTAP_LZ4_COMPRESSED;
+	return WTAP_UNCOMPRESSED;
+}
+
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_UNCOMPRESSED:
+		return TRUE;
+
 #ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return TRUE;
+#endif
+
+	default:
+		return FALSE;
+	}
+}
+
+const char *
+wtap_compression_type_description(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_GZIP_COMPRESSED:
+		return "gzip";
+
+	case WTAP_ZSTD_COMPRESSED:
+		return "Zstandard";
+
+	case WTAP_LZ4_COMPRESSED:
+		return "LZ4";
+
+	default:
+		return NULL;
+	}
+}
+
+const char *
+wtap_compression_type_extension(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_GZIP_COMPRESSED:
+		return "gz";
+
+	case WTAP_ZSTD_COMPRESSED:
+		return "zst";
+
+	case WTAP_LZ4_COMPRESSED:
+		return "lz4";
+
+	default:
+		return NULL;
+	}
+}
+
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
 gboolean
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2163,17 +2247,17 @@ wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment_types)
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
 static int wtap_dump_file_close(wtap_dumper *wdh);
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
                       GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                       GArray* nrb_hdrs, int *err)
 {
@@ -2183,11 +2267,11 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2248,21 +2332,21 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 wtap_dumper *
 wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-	       int snaplen, gboolean compressed, int *err)
+	       int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-		  int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		  int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		  GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2278,7 +2362,7 @@ wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2292,15 +2376,15 @@ wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 wtap_dumper *
 wtap_dump_open_tempfile(char **filenamep, const char *pfx,
 			int file_type_subtype, int encap,
-			int snaplen, gboolean compressed, int *err)
+			int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 			   int file_type_subtype, int encap,
-			   int snaplen, gboolean compressed,
+			   int snaplen, wtap_compression_type compression_type,
 			   GArray* shb_hdrs,
 			   wtapng_iface_descriptions_t *idb_inf,
 			   GArray* nrb_hdrs, int *err)
@@ -2314,7 +2398,7 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	*filenamep = NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2340,7 +2424,7 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2353,21 +2437,21 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 
 wtap_dumper *
 wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-		 gboolean compressed, int *err)
+		 wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-		    gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		    wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		    GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2383,7 +2467,7 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2393,14 +2477,14 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 
 wtap_dumper *
 wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-		      gboolean compressed, int *err)
+		      wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-			 gboolean compressed, GArray* shb_hdrs,
+			 wtap_compression_type compression_type, GArray* shb_hdrs,
 			 wtapng_iface_descriptions_t *idb_inf,
 			 GArray* nrb_hdrs, int *err)
 {
@@ -2434,7 +2518,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 #endif
 
 	wdh = wtap_dump_fdopen_ng(new_fd, file_type_subtype, encap, snaplen,
-	    compressed, shb_hdrs, idb_inf, nrb_hdrs, err);
+	    compression_type, shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL) {
 		/* Failed; close the new FD */
 		ws_close(new_fd);
@@ -2444,7 +2528,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 }
 
 static gboolean
-wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2467,8 +2551,11 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support it, and do we support
+	   it for this file_type_subtype? */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    (!wtap_can_write_compression_type(compression_type) ||
+	     !wtap_dump_can_compress(file_type_subtype))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2478,7 +2565,7 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 }
 
 static wtap_dumper *
-wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean compressed, int *err)
+wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2491,20 +2578,20 @@ wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean comp
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
 
 static gboolean
-wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if (compression_type != WTAP_UNCOMPRESSED) {
 		cant_seek = TRUE;
 	} else {
 		fd = ws_fileno((FILE *)wdh->fh);
@@ -2549,13 +2636,24 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 void
 wtap_dump_flush(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		gzwfile_flush((GZWFILE_T)wdh->fh);
-	} else
+		break;
 #endif
-	{
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		framewfile_flush((FRAMEWFILE_T)wdh->fh);
+		break;
+#endif
+
+	default:
 		fflush((FILE *)wdh->fh);
+		break;
 	}
 }
 
@@ -2621,42 +2719,48 @@ gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh) {
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_open(filename);
-	} else {
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_open(filename, wdh->compression_type);
+#endif
+
+	default:
 		return ws_fopen(filename, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
-{
-	return ws_fopen(filename, "wb");
-}
-#endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_fdopen(fd);
-	} else {
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_fdopen(fd, wdh->compression_type);
+#endif
+
+	default:
 		return ws_fdopen(fd, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
-{
-	return ws_fdopen(fd, "wb");
-}
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean
@@ -2665,7 +2769,7 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 	size_t nwritten;
 
 #ifdef HAVE_ZLIB
-	if (wdh->compressed) {
+	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2675,6 +2779,19 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 			return FALSE;
 		}
 	} else
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	if (wdh->compression_type == WTAP_ZSTD_COMPRESSED ||
+	    wdh->compression_type == WTAP_LZ4_COMPRESSED) {
+		nwritten = framewfile_write((FRAMEWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		/*
+		 * framewfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = framewfile_geterr((FRAMEWFILE_T)wdh->fh);
+			return FALSE;
+		}
+	} else
 #endif
 	{
 		errno = WTAP_ERR_CANT_WRITE;
@@ -2698,23 +2815,31 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_ZLIB
-	if(wdh->compressed)
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_close((GZWFILE_T)wdh->fh);
-	else
 #endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_close((FRAMEWFILE_T)wdh->fh);
+#endif
+
+	default:
 		return fclose((FILE *)wdh->fh);
+	}
 }
 
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == fseek((FILE *)wdh->fh, (long)offset, whence)) {
 			*err = errno;
@@ -2730,12 +2855,10 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == (rval = ftell((FILE *)wdh->fh))) {
 			*err = errno;
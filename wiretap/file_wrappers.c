@@ -34,12 +34,27 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/shm_ring.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
+
 /*
  * See RFC 1952:
  *
@@ -54,6 +69,21 @@
  *      Bzip2 format: http://bzip.org/
  *
  *      Lzip format: http://www.nongnu.org/lzip/
+ *
+ * See
+ *
+ *      https://tools.ietf.org/html/rfc8478
+ *
+ * for a description of the Zstandard format,
+ *
+ *      https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * for a description of the seek table appended to "seekable" Zstandard
+ * files, and
+ *
+ *      https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.
  */
 
 /*
@@ -65,6 +95,12 @@
 const char *compressed_file_extension_table[] = {
 #ifdef HAVE_ZLIB
     "gz",
+#endif
+#ifdef HAVE_ZSTD
+    "zst",
+#endif
+#ifdef HAVE_LZ4
+    "lz4",
 #endif
     NULL
 };
@@ -72,13 +108,25 @@ const char *compressed_file_extension_table[] = {
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
+/*
+ * Largest chunk of a memory-mapped file handed out as the output buffer
+ * at once; offsets within the output buffer have to fit in a guint.
+ */
+#define MAP_WINDOW_SIZE (1U << 30)
+
 /* values for wtap_reader compression */
 typedef enum {
     UNKNOWN,       /* unknown - look for a gzip header */
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_ZLIB
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD,          /* decompress a Zstandard frame */
+#endif
+#ifdef HAVE_LZ4
+    LZ4,           /* decompress an LZ4 frame */
 #endif
 } compression_t;
 
@@ -101,7 +149,7 @@ struct wtap_reader {
     gint64 start;               /* where the gzip data started, for rewinding */
     gint64 raw;                 /* where the raw data started, for seeking */
     compression_t compression;  /* type of compression, if any */
-    gboolean is_compressed;     /* FALSE if completely uncompressed, TRUE otherwise */
+    wtap_compression_type compression_type; /* WTAP_UNCOMPRESSED if completely uncompressed */
 
     /* seek request */
     gint64 skip;                /* amount to skip (already rewound if backwards) */
@@ -115,10 +163,34 @@ struct wtap_reader {
     /* zlib inflate stream */
     z_stream strm;              /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;    /* TRUE if we aren't supposed to check the CRC */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *zstd_dctx;       /* Zstandard decompression context, if needed yet */
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_dctx *lz4_dctx;        /* LZ4 decompression context, if needed yet */
 #endif
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    gboolean random;            /* TRUE if set up for random access */
+
+    /* memory-mapped uncompressed file */
+    guint8 *map;                /* the mapping, or NULL if not mapped */
+    gint64 map_size;            /* size of the mapping */
+    GSList *old_maps;           /* mappings replaced by file_fdreopen(),
+                                   kept until we're closed, as records
+                                   may still be borrowing their data */
+    gboolean growing;           /* TRUE if the file may change while we're
+                                   reading it, so it mustn't be mapped */
+    guint8 *out_buf;            /* the allocated output buffer; out.buf
+                                   points into the mapping while we are
+                                   reading from it */
+    gboolean is_memory;         /* TRUE if the "mapping" is memory we were
+                                   handed, and there's no file behind it */
+
+    /* capture ring shared with dumpcap while it's writing the file */
+    ws_shm_ring_t *shm_ring;    /* the ring, or NULL if none */
 };
 
 /* Current read offset within a buffer. */
@@ -164,6 +236,37 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
     unsigned char *read_ptr;
     ssize_t ret;
 
+    if (buf == &state->out && state->map != NULL) {
+        if (state->raw_pos < state->map_size) {
+            /* Hand out the next part of the mapping as the output
+               buffer, rather than copying it. */
+            buf->buf = state->map + state->raw_pos;
+            buf->next = buf->buf;
+            buf->avail = (guint)MIN(state->map_size - state->raw_pos, MAP_WINDOW_SIZE);
+            state->raw_pos += buf->avail;
+            return 0;
+        }
+
+        /* Memory we were handed doesn't grow. */
+        if (state->is_memory) {
+            state->eof = TRUE;
+            return 0;
+        }
+
+        /* We're past the end of the mapping; the file may have grown
+           since we mapped it, so go back to reading it. */
+        if (buf->buf != state->out_buf) {
+            buf->buf = state->out_buf;
+            buf_reset(buf);
+        }
+        if (state->shm_ring == NULL &&
+            ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+
     /* How much space is left at the end of the buffer?
        XXX - the output buffer actually has state->size * 2 bytes. */
     space_left = state->size - bytes_in_buffer(buf);
@@ -182,6 +285,28 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
+    if (buf == &state->out && state->shm_ring != NULL) {
+        gsize len;
+
+        /* dumpcap is writing the file through a ring it shares with us;
+           if the ring still holds the data, copy it from there rather
+           than reading the file. */
+        len = ws_shm_ring_copy(state->shm_ring, state->raw_pos, read_ptr, to_read);
+        if (len != 0) {
+            state->raw_pos += len;
+            buf->avail += (guint)len;
+            return 0;
+        }
+
+        /* It's been overwritten, or hasn't been written yet; read the
+           file, which has everything dumpcap has written out. */
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+
     ret = ws_read(state->fd, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
@@ -271,7 +396,8 @@ fast_seek_header(FILE_T file, gint64 in_pos, gint64 out_pos,
         item = (struct fast_seek_point *)file->fast_seek->pdata[file->fast_seek->len - 1];
 
     if (!item || item->out < out_pos) {
-        struct fast_seek_point *val = g_new(struct fast_seek_point,1);
+        /* Only zlib seek points need the data, and it's big */
+        struct fast_seek_point *val = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
         val->in = in_pos;
         val->out = out_pos;
         val->compression = compression;
@@ -609,6 +735,335 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Magic numbers at the beginning of Zstandard and LZ4 frames. */
+#define ZSTD_FRAME_MAGIC            0xFD2FB528U
+#define LZ4_FRAME_MAGIC             0x184D2204U
+
+/* Skippable frames, which both formats use for metadata, have one of
+   16 magic numbers, followed by the length of their content. */
+#define SKIPPABLE_FRAME_MAGIC       0x184D2A50U
+#define SKIPPABLE_FRAME_MAGIC_MASK  0xFFFFFFF0U
+
+/*
+ * Make sure there are at least n bytes in the input buffer, moving
+ * what's there to the beginning of the buffer if necessary to make
+ * room.  Returns 0 with fewer than n bytes available only at the end
+ * of the file, or -1 on an error.
+ */
+static int
+gz_need(FILE_T state, guint n)
+{
+    while (state->in.avail < n && !state->eof) {
+        if (state->in.next != state->in.buf) {
+            memmove(state->in.buf, state->in.next, state->in.avail);
+            state->in.next = state->in.buf;
+        }
+        if (fill_in_buffer(state) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+/* Skip n bytes of input, without looking at them. */
+static int
+gz_skip_input(FILE_T state, gint64 n)
+{
+    guint chunk;
+
+    while (n != 0) {
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            if (state->in.avail == 0) {
+                /* EOF */
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+        chunk = (gint64)state->in.avail > n ? (guint)n : state->in.avail;
+        state->in.avail -= chunk;
+        state->in.next += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
+#ifdef HAVE_ZSTD
+/* Footer at the end of a seekable Zstandard file's seek table. */
+#define ZSTD_SEEKABLE_MAGIC         0x8F92EAB1U
+#define ZSTD_SEEKTABLE_FOOTER_SIZE  9
+#define ZSTD_SEEKTABLE_CHECKSUM     0x80    /* entries include checksums */
+#define ZSTD_SEEKTABLE_RESERVED     0x7C
+
+static gboolean
+zstd_pread(FILE_T state, gint64 offset, void *buf, size_t count)
+{
+    if (ws_lseek64(state->fd, offset, SEEK_SET) == -1)
+        return FALSE;
+    return ws_read(state->fd, buf, (unsigned int)count) == (ssize_t)count;
+}
+
+/*
+ * If this is a seekable Zstandard file, the last frame in it is a
+ * skippable frame containing the compressed and decompressed size of
+ * every frame before it; turn that into seek points for all frames,
+ * so that we can seek anywhere in the file without having read it
+ * first.
+ *
+ * in_pos is the offset in the file of the first frame.  We can't use
+ * the table if the file has anything else in it.
+ */
+static void
+zstd_load_seek_table(FILE_T state, gint64 in_pos)
+{
+    ws_statb64 st;
+    guint8 footer[ZSTD_SEEKTABLE_FOOTER_SIZE];
+    guint8 header[8];
+    guint32 num_frames, i;
+    guint entry_size;
+    gint64 table_size, table_start;
+    guint8 *table = NULL, *entry;
+    gint64 in, out;
+    GPtrArray *points;
+    struct fast_seek_point *val;
+
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return;
+    if (st.st_size - in_pos < (gint64)(sizeof header + sizeof footer))
+        return;
+
+    if (!zstd_pread(state, st.st_size - sizeof footer, footer, sizeof footer))
+        goto done;
+    if (pletoh32(&footer[5]) != ZSTD_SEEKABLE_MAGIC ||
+        (footer[4] & ZSTD_SEEKTABLE_RESERVED) != 0)
+        goto done;
+    num_frames = pletoh32(&footer[0]);
+    entry_size = (footer[4] & ZSTD_SEEKTABLE_CHECKSUM) ? 12 : 8;
+    table_size = (gint64)num_frames * entry_size;
+    table_start = st.st_size - (gint64)sizeof footer - table_size;
+    if (table_start - (gint64)sizeof header < in_pos)
+        goto done;
+
+    /* The table has to be all of a skippable frame */
+    if (!zstd_pread(state, table_start - sizeof header, header, sizeof header))
+        goto done;
+    if ((pletoh32(&header[0]) & SKIPPABLE_FRAME_MAGIC_MASK) != SKIPPABLE_FRAME_MAGIC ||
+        pletoh32(&header[4]) != table_size + sizeof footer)
+        goto done;
+
+    table = (guint8 *)g_try_malloc((gsize)table_size);
+    if (table == NULL || !zstd_pread(state, table_start, table, (size_t)table_size))
+        goto done;
+
+    /* The frames have to add up to everything before the table */
+    points = g_ptr_array_sized_new(num_frames);
+    in = in_pos;
+    out = 0;
+    for (i = 0, entry = table; i < num_frames; i++, entry += entry_size) {
+        val = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
+        val->in = in;
+        val->out = out;
+        val->compression = ZSTD;
+        g_ptr_array_add(points, val);
+        in += pletoh32(&entry[0]);
+        out += pletoh32(&entry[4]);
+    }
+    if (in == table_start - (gint64)sizeof header) {
+        for (i = 0; i < points->len; i++) {
+            val = (struct fast_seek_point *)points->pdata[i];
+            /* Empty frames don't give us anywhere new to seek to */
+            if (state->fast_seek->len != 0 &&
+                ((struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1])->out == val->out)
+                g_free(val);
+            else
+                g_ptr_array_add(state->fast_seek, val);
+        }
+    } else {
+        for (i = 0; i < points->len; i++)
+            g_free(points->pdata[i]);
+    }
+    g_ptr_array_free(points, TRUE);
+
+done:
+    g_free(table);
+    /* Put the file back where we're reading it */
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+    }
+}
+
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_outBuffer output;
+    ZSTD_inBuffer input;
+    size_t ret;
+
+    output.dst = buf;
+    output.size = count;
+    output.pos = 0;
+
+    /* fill output buffer up to end of frame or error */
+    for (;;) {
+        input.src = state->in.next;
+        input.size = state->in.avail;
+        input.pos = 0;
+        ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+        state->in.next += input.pos;
+        state->in.avail -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+        if (ret == 0 || output.pos == output.size)
+            break;
+
+        /* get more input */
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                break;
+            if (state->in.avail == 0) {
+                /* EOF */
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                break;
+            }
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = (guint)output.pos;
+
+    /* At the end of the frame, look for another one */
+    if (ret == 0)
+        state->compression = UNKNOWN;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    size_t produced = 0;
+    size_t dst_size, src_size;
+    size_t ret;
+
+    /* fill output buffer up to end of frame or error */
+    for (;;) {
+        dst_size = count - produced;
+        src_size = state->in.avail;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + produced, &dst_size,
+                              state->in.next, &src_size, NULL);
+        state->in.next += src_size;
+        state->in.avail -= (guint)src_size;
+        produced += dst_size;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+        if (ret == 0 || produced == count)
+            break;
+
+        /* get more input */
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                break;
+            if (state->in.avail == 0) {
+                /* EOF */
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                break;
+            }
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = (guint)produced;
+
+    /* At the end of the frame, look for another one */
+    if (ret == 0)
+        state->compression = UNKNOWN;
+}
+#endif /* HAVE_LZ4 */
+
+#ifdef HAVE_SYS_MMAN_H
+/* A mapping replaced by file_fdreopen() */
+typedef struct {
+    void *start;
+    gsize size;
+} file_old_map;
+#endif
+
+/*
+ * Map an uncompressed regular file into memory, so that its data can be
+ * handed out without copying it.  This is only an optimization; if it
+ * can't be done, we just read the file.
+ *
+ * A file that's truncated while it's mapped makes touching the pages past
+ * its new end fatal, so files that may change while we read them, such as
+ * those being captured to, are never mapped; see file_set_growing().
+ */
+static void
+file_map(FILE_T state)
+{
+#ifdef HAVE_SYS_MMAN_H
+    ws_statb64 st;
+    void *map;
+
+    if (state->growing || ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (guint64)st.st_size > G_MAXSIZE)
+        return;
+
+    /*
+     * Map it private and writable, so that anybody who modifies the
+     * data we hand out gets their own copy of the page rather than a
+     * fault; the file itself is never changed.
+     */
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+               state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+#ifdef MADV_SEQUENTIAL
+    (void)madvise(map, (size_t)st.st_size,
+                  state->random ? MADV_RANDOM : MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    (void)madvise(map, (size_t)st.st_size, MADV_HUGEPAGE);
+#endif
+#endif
+    state->map = (guint8 *)map;
+    state->map_size = st.st_size;
+#else
+    (void)state;
+#endif
+}
+
+static void
+file_unmap(FILE_T state)
+{
+#ifdef HAVE_SYS_MMAN_H
+    GSList *item;
+    file_old_map *old_map;
+
+    if (state->map != NULL && !state->is_memory)
+        munmap(state->map, (size_t)state->map_size);
+    for (item = state->old_maps; item != NULL; item = item->next) {
+        old_map = (file_old_map *)item->data;
+        munmap(old_map->start, old_map->size);
+        g_free(old_map);
+    }
+    g_slist_free(state->old_maps);
+    state->old_maps = NULL;
+#endif
+    state->map = NULL;
+    state->map_size = 0;
+}
+
 static int
 gz_head(FILE_T state)
 {
@@ -622,6 +1077,78 @@ gz_head(FILE_T state)
             return 0;
     }
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    /* look for a Zstandard or LZ4 frame */
+    if (state->in.next[0] == 0x28 || state->in.next[0] == 0x04 ||
+        (state->in.next[0] & 0xF0) == 0x50) {
+        guint32 magic;
+        gint64 frame_pos;
+
+        if (gz_need(state, 8) == -1)
+            return -1;
+        magic = state->in.avail >= 4 ? pletoh32(state->in.next) : 0;
+        frame_pos = state->raw_pos - state->in.avail;
+
+        if ((magic & SKIPPABLE_FRAME_MAGIC_MASK) == SKIPPABLE_FRAME_MAGIC &&
+            state->compression_type != WTAP_UNCOMPRESSED && state->in.avail >= 8) {
+            /* metadata, such as a seek table, between frames; skip it */
+            gint64 skip = pletoh32(state->in.next + 4);
+
+            state->in.avail -= 8;
+            state->in.next += 8;
+            if (gz_skip_input(state, skip) == -1)
+                return -1;
+            return 0;
+        }
+#ifdef HAVE_ZSTD
+        if (magic == ZSTD_FRAME_MAGIC) {
+            if (state->zstd_dctx == NULL) {
+                state->zstd_dctx = ZSTD_createDCtx();
+                if (state->zstd_dctx == NULL) {
+                    state->err = ENOMEM;
+                    state->err_info = NULL;
+                    return -1;
+                }
+            } else
+                ZSTD_initDStream(state->zstd_dctx);
+            if (state->fast_seek) {
+                if (state->fast_seek->len == 0 && state->pos == 0)
+                    zstd_load_seek_table(state, frame_pos);
+                fast_seek_header(state, frame_pos, state->pos, ZSTD);
+            }
+            state->compression = ZSTD;
+            state->compression_type = WTAP_ZSTD_COMPRESSED;
+            return 0;
+        }
+#endif /* HAVE_ZSTD */
+#ifdef HAVE_LZ4
+        if (magic == LZ4_FRAME_MAGIC) {
+            if (state->lz4_dctx != NULL) {
+                /* we might not have got to the end of the last frame */
+#if LZ4_VERSION_NUMBER >= 10800
+                LZ4F_resetDecompressionContext(state->lz4_dctx);
+#else
+                LZ4F_freeDecompressionContext(state->lz4_dctx);
+                state->lz4_dctx = NULL;
+#endif
+            }
+            if (state->lz4_dctx == NULL &&
+                LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION))) {
+                state->lz4_dctx = NULL;
+                state->err = ENOMEM;
+                state->err_info = NULL;
+                return -1;
+            }
+            if (state->fast_seek)
+                fast_seek_header(state, frame_pos, state->pos, LZ4);
+            state->compression = LZ4;
+            state->compression_type = WTAP_LZ4_COMPRESSED;
+            return 0;
+        }
+#endif /* HAVE_LZ4 */
+    }
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
     /* look for the gzip magic header bytes 31 and 139 */
     if (state->in.next[0] == 31) {
         state->in.avail--;
@@ -701,7 +1228,7 @@ gz_head(FILE_T state)
             inflateReset(&(state->strm));
             state->strm.adler = crc32(0L, Z_NULL, 0);
             state->compression = ZLIB;
-            state->is_compressed = TRUE;
+            state->compression_type = WTAP_GZIP_COMPRESSED;
 #ifdef Z_BLOCK
             if (state->fast_seek) {
                 struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
@@ -732,6 +1259,7 @@ gz_head(FILE_T state)
        input to output -- this assumes that the output buffer is larger than
        the input buffer, which also assures space for gzungetc() */
     state->raw = state->pos;
+    state->out.buf = state->out_buf;
     state->out.next = state->out.buf;
     /* not a compressed file -- copy everything we've read into the
        input buffer to the output buffer and fall to raw i/o */
@@ -744,6 +1272,10 @@ gz_head(FILE_T state)
         buf_reset(&state->in);
     }
     state->compression = UNCOMPRESSED;
+
+    /* read the rest of it straight from memory if we can */
+    if (state->map == NULL)
+        file_map(state);
     return 0;
 }
 
@@ -764,6 +1296,16 @@ fill_out_buffer(FILE_T state)
     else if (state->compression == ZLIB) {      /* decompress */
         zlib_read(state, state->out.buf, state->size << 1);
     }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {
+        zstd_read(state, state->out.buf, state->size << 1);
+    }
+#endif
+#ifdef HAVE_LZ4
+    else if (state->compression == LZ4) {
+        lz4_read(state, state->out.buf, state->size << 1);
+    }
 #endif
     return 0;
 }
@@ -807,6 +1349,7 @@ gz_skip(FILE_T state, gint64 len)
 static void
 gz_reset(FILE_T state)
 {
+    state->out.buf = state->out_buf;
     buf_reset(&state->out);       /* no output data available */
     state->eof = FALSE;           /* not at end of file */
     state->compression = UNKNOWN; /* look for gzip header */
@@ -837,12 +1380,26 @@ file_fdopen(int fd)
 
     state->fast_seek_cur = NULL;
     state->fast_seek = NULL;
+#ifdef HAVE_ZSTD
+    state->zstd_dctx = NULL;
+#endif
+#ifdef HAVE_LZ4
+    state->lz4_dctx = NULL;
+#endif
+    state->random = FALSE;
+    state->map = NULL;
+    state->map_size = 0;
+    state->old_maps = NULL;
+    state->growing = FALSE;
+    state->out_buf = NULL;
+    state->is_memory = FALSE;
+    state->shm_ring = NULL;
 
     /* open the file with the appropriate mode (or just use fd) */
     state->fd = fd;
 
     /* we don't yet know whether it's compressed */
-    state->is_compressed = FALSE;
+    state->compression_type = WTAP_UNCOMPRESSED;
 
     /* save the current position for rewinding (only if reading) */
     state->start = ws_lseek64(state->fd, 0, SEEK_CUR);
@@ -872,6 +1429,7 @@ file_fdopen(int fd)
     state->in.next = state->in.buf;
     state->in.avail = 0;
     state->out.buf = (unsigned char *)g_try_malloc(((gsize)want) << 1);
+    state->out_buf = state->out.buf;
     state->out.next = state->out.buf;
     state->out.avail = 0;
     state->size = want;
@@ -957,63 +1515,293 @@ file_open(const char *path)
     return ft;
 }
 
+/*
+ * Open a stream that reads len bytes of data already in memory, as if
+ * they were an uncompressed, memory-mapped file.  This needs no buffers
+ * of its own, so it's cheap to open, and it can be pointed at other data
+ * with file_set_memory(); the data must remain valid while it's being
+ * read.
+ */
+FILE_T
+file_open_memory(guint8 *data, gsize len)
+{
+    FILE_T state;
+
+    state = g_new0(struct wtap_reader, 1);
+    state->fd = -1;
+    state->is_memory = TRUE;
+    file_set_memory(state, data, len);
+    return state;
+}
+
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_memory(FILE_T stream, guint8 *data, gsize len)
 {
-    stream->fast_seek = seek;
+    stream->map = data;
+    stream->map_size = (gint64)len;
+    stream->out.buf = data;
+    buf_reset(&stream->out);
+    buf_reset(&stream->in);
+    stream->raw_pos = 0;
+    stream->pos = 0;
+    stream->start = 0;
+    stream->raw = 0;
+    stream->eof = FALSE;
+    stream->compression = UNCOMPRESSED;
+    stream->compression_type = WTAP_UNCOMPRESSED;
+    stream->seek_pending = FALSE;
+    stream->skip = 0;
+    stream->err = 0;
+    stream->err_info = NULL;
 }
 
-gint64
-file_seek(FILE_T file, gint64 offset, int whence, int *err)
+void
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
-    struct fast_seek_point *here;
-    guint n;
+    stream->fast_seek = seek;
+    stream->random = random_flag;
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_RANDOM)
+    if (stream->map != NULL && random_flag)
+        (void)madvise(stream->map, (size_t)stream->map_size, MADV_RANDOM);
+#endif
+}
 
-    if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) {
-        g_assert_not_reached();
 /*
- *err = EINVAL;
- return -1;
-*/
-    }
+ * Fast seek points, as saved by file_fast_seek_save(), use these
+ * codes rather than compression_t values, as the latter depend on
+ * what libraries we were built with.
+ */
+#define FAST_SEEK_SAVE_UNCOMPRESSED         0
+#define FAST_SEEK_SAVE_ZLIB                 1
+#define FAST_SEEK_SAVE_GZIP_AFTER_HEADER    2
+#define FAST_SEEK_SAVE_ZSTD                 3
+#define FAST_SEEK_SAVE_LZ4                  4
 
-    /* Normalize offset to a SEEK_CUR specification */
-    if (whence == SEEK_END) {
-        /* Seek relative to the end of the file; given that we might be
-           reading from a compressed file, we do that by seeking to the
-           end of the file, making an offset relative to the end of
-           the file an offset relative to the current position.
+/* out, in, and the type code */
+#define FAST_SEEK_SAVE_POINT_SIZE           17
+/* bits, Adler checksum, total_out, and the window */
+#define FAST_SEEK_SAVE_ZLIB_SIZE            (1 + 4 + 4 + ZLIB_WINSIZE)
 
-           XXX - we don't actually use this yet, but, for uncompressed
-           files, we could optimize it, if desired, by directly using
-           ws_lseek64(). */
-        if (gz_skip(file, G_MAXINT64) == -1) {
-            *err = file->err;
-            return -1;
-        }
-        if (offset == 0) {
-            /* We are done */
-            return file->pos;
-        }
-    } else if (whence == SEEK_SET)
-        offset -= file->pos;
-    else if (file->seek_pending) {
-        /* There's a forward-skip pending, so file->pos doesn't reflect
-           the actual file position, it represents the position from
-           which we're skipping; update the offset to include that. */
-        offset += file->skip;
-    }
-    file->seek_pending = FALSE;
+/*
+ * Append the fast seek points in seek, which were collected while
+ * reading a file, to buf, in a form that can be given to
+ * file_fast_seek_load() the next time the file is opened.
+ */
+void
+file_fast_seek_save(GPtrArray *seek, GByteArray *buf)
+{
+    guint i;
+    guint8 hdr[FAST_SEEK_SAVE_POINT_SIZE];
 
-    /*
-     * Are we moving at all?
-     */
-    if (offset == 0) {
-        /* No.  Just return the current position. */
-        return file->pos;
-    }
+    for (i = 0; i < seek->len; i++) {
+        struct fast_seek_point *point = (struct fast_seek_point *)seek->pdata[i];
 
-    /*
+        phton64(&hdr[0], (guint64)point->out);
+        phton64(&hdr[8], (guint64)point->in);
+        switch (point->compression) {
+
+#ifdef HAVE_ZLIB
+        case ZLIB:
+        {
+            guint8 zlib_hdr[9];
+
+            hdr[16] = FAST_SEEK_SAVE_ZLIB;
+            g_byte_array_append(buf, hdr, sizeof hdr);
+#ifdef HAVE_INFLATEPRIME
+            zlib_hdr[0] = (guint8)point->data.zlib.bits;
+#else
+            zlib_hdr[0] = 0;
+#endif
+            phton32(&zlib_hdr[1], point->data.zlib.adler);
+            phton32(&zlib_hdr[5], point->data.zlib.total_out);
+            g_byte_array_append(buf, zlib_hdr, sizeof zlib_hdr);
+            g_byte_array_append(buf, point->data.zlib.window, ZLIB_WINSIZE);
+            continue;
+        }
+
+        case GZIP_AFTER_HEADER:
+            hdr[16] = FAST_SEEK_SAVE_GZIP_AFTER_HEADER;
+            break;
+#endif
+
+#ifdef HAVE_ZSTD
+        case ZSTD:
+            hdr[16] = FAST_SEEK_SAVE_ZSTD;
+            break;
+#endif
+
+#ifdef HAVE_LZ4
+        case LZ4:
+            hdr[16] = FAST_SEEK_SAVE_LZ4;
+            break;
+#endif
+
+        default:
+            hdr[16] = FAST_SEEK_SAVE_UNCOMPRESSED;
+            break;
+        }
+        g_byte_array_append(buf, hdr, sizeof hdr);
+    }
+}
+
+/*
+ * Add the fast seek points in data, as saved by file_fast_seek_save(),
+ * to seek, skipping any that aren't past the points it already has.
+ * Returns FALSE, without changing seek, if the data is malformed or
+ * uses a compression type we don't support.
+ */
+gboolean
+file_fast_seek_load(GPtrArray *seek, const guint8 *data, gsize len)
+{
+    GPtrArray *points;
+    struct fast_seek_point *point;
+    gint64 last_out = -1;
+    gsize off = 0;
+    guint i;
+
+    points = g_ptr_array_new();
+    while (off < len) {
+        gint64 out, in;
+        guint8 type;
+
+        if (len - off < FAST_SEEK_SAVE_POINT_SIZE)
+            goto fail;
+        out = (gint64)pntoh64(&data[off]);
+        in = (gint64)pntoh64(&data[off + 8]);
+        type = data[off + 16];
+        off += FAST_SEEK_SAVE_POINT_SIZE;
+        if (out <= last_out)
+            goto fail;
+        last_out = out;
+
+        switch (type) {
+
+        case FAST_SEEK_SAVE_UNCOMPRESSED:
+            point = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
+            point->compression = UNCOMPRESSED;
+            break;
+
+#ifdef HAVE_ZLIB
+        case FAST_SEEK_SAVE_ZLIB:
+            if (len - off < FAST_SEEK_SAVE_ZLIB_SIZE)
+                goto fail;
+#ifndef HAVE_INFLATEPRIME
+            /* We can't use points that start in the middle of a byte */
+            if (data[off] != 0)
+                goto fail;
+#endif
+            point = g_new(struct fast_seek_point, 1);
+            point->compression = ZLIB;
+#ifdef HAVE_INFLATEPRIME
+            point->data.zlib.bits = data[off];
+#endif
+            point->data.zlib.adler = pntoh32(&data[off + 1]);
+            point->data.zlib.total_out = pntoh32(&data[off + 5]);
+            memcpy(point->data.zlib.window, &data[off + 9], ZLIB_WINSIZE);
+            off += FAST_SEEK_SAVE_ZLIB_SIZE;
+            break;
+
+        case FAST_SEEK_SAVE_GZIP_AFTER_HEADER:
+            point = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
+            point->compression = GZIP_AFTER_HEADER;
+            break;
+#endif
+
+#ifdef HAVE_ZSTD
+        case FAST_SEEK_SAVE_ZSTD:
+            point = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
+            point->compression = ZSTD;
+            break;
+#endif
+
+#ifdef HAVE_LZ4
+        case FAST_SEEK_SAVE_LZ4:
+            point = (struct fast_seek_point *)g_malloc(G_STRUCT_OFFSET(struct fast_seek_point, data));
+            point->compression = LZ4;
+            break;
+#endif
+
+        default:
+            goto fail;
+        }
+        point->out = out;
+        point->in = in;
+        g_ptr_array_add(points, point);
+    }
+
+    /* The file's been opened, so we may already have the first points */
+    if (seek->len != 0)
+        last_out = ((struct fast_seek_point *)seek->pdata[seek->len - 1])->out;
+    else
+        last_out = -1;
+    for (i = 0; i < points->len; i++) {
+        point = (struct fast_seek_point *)points->pdata[i];
+        if (point->out > last_out)
+            g_ptr_array_add(seek, point);
+        else
+            g_free(point);
+    }
+    g_ptr_array_free(points, TRUE);
+    return TRUE;
+
+fail:
+    for (i = 0; i < points->len; i++)
+        g_free(points->pdata[i]);
+    g_ptr_array_free(points, TRUE);
+    return FALSE;
+}
+
+gint64
+file_seek(FILE_T file, gint64 offset, int whence, int *err)
+{
+    struct fast_seek_point *here;
+    guint n;
+
+    if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) {
+        g_assert_not_reached();
+/*
+ *err = EINVAL;
+ return -1;
+*/
+    }
+
+    /* Normalize offset to a SEEK_CUR specification */
+    if (whence == SEEK_END) {
+        /* Seek relative to the end of the file; given that we might be
+           reading from a compressed file, we do that by seeking to the
+           end of the file, making an offset relative to the end of
+           the file an offset relative to the current position.
+
+           XXX - we don't actually use this yet, but, for uncompressed
+           files, we could optimize it, if desired, by directly using
+           ws_lseek64(). */
+        if (gz_skip(file, G_MAXINT64) == -1) {
+            *err = file->err;
+            return -1;
+        }
+        if (offset == 0) {
+            /* We are done */
+            return file->pos;
+        }
+    } else if (whence == SEEK_SET)
+        offset -= file->pos;
+    else if (file->seek_pending) {
+        /* There's a forward-skip pending, so file->pos doesn't reflect
+           the actual file position, it represents the position from
+           which we're skipping; update the offset to include that. */
+        offset += file->skip;
+    }
+    file->seek_pending = FALSE;
+
+    /*
+     * Are we moving at all?
+     */
+    if (offset == 0) {
+        /* No.  Just return the current position. */
+        return file->pos;
+    }
+
+    /*
      * Are we seeking backwards?
      */
     if (offset < 0) {
@@ -1097,6 +1885,18 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in;
             off2 = here->out;
         } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            off = here->in;
+            off2 = here->out;
+        } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            off = here->in;
+            off2 = here->out;
+        } else
 #endif
         {
             off2 = (file->pos + offset);
@@ -1149,6 +1949,13 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             strm->adler = crc32(0L, Z_NULL, 0);
             file->compression = ZLIB;
         } else
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+        if (here->compression != UNCOMPRESSED) {
+            /* We're at the start of a frame; let gz_head() set up
+               to decompress it. */
+            file->compression = UNKNOWN;
+        } else
 #endif
             file->compression = here->compression;
 
@@ -1181,9 +1988,14 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         && (file->fast_seek != NULL))
     {
         /*
-         * Yes.  Just seek there within the file.
+         * Yes.  Just seek there within the file.  If it's mapped,
+         * there's nothing to seek; we'll hand out the mapping from
+         * the new position.  If it's being read through a capture
+         * ring, we seek to the new position if we have to read the
+         * file.
          */
-        if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
+        if (file->map == NULL && file->shm_ring == NULL &&
+            ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
             *err = errno;
             return -1;
         }
@@ -1276,7 +2088,13 @@ file_fstat(FILE_T stream, ws_statb64 *statb, int *err)
 gboolean
 file_iscompressed(FILE_T stream)
 {
-    return stream->is_compressed;
+    return stream->compression_type != WTAP_UNCOMPRESSED;
+}
+
+wtap_compression_type
+file_get_compression_type(FILE_T stream)
+{
+    return stream->compression_type;
 }
 
 int
@@ -1340,6 +2158,49 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+const guint8 *
+file_read_ptr(unsigned int len, FILE_T file)
+{
+    gint64 cur;
+    const guint8 *ptr;
+
+    /* only an uncompressed, memory-mapped file can do this */
+    if (file->map == NULL || file->compression != UNCOMPRESSED ||
+        file->err != 0)
+        return NULL;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = FALSE;
+        if (gz_skip(file, file->skip) == -1)
+            return NULL;
+    }
+    if (file->compression != UNCOMPRESSED || file->err != 0)
+        return NULL;
+
+    /*
+     * Everything up to raw_pos has been read into the output buffer,
+     * so the current position in the file is just before whatever's
+     * left in it.
+     */
+    cur = file->raw_pos - file->out.avail;
+    if (cur < 0 || cur + len > file->map_size)
+        return NULL;
+    ptr = file->map + cur;
+
+    if (len <= file->out.avail) {
+        file->out.next += len;
+        file->out.avail -= len;
+    } else {
+        /* Start the output buffer afresh just past the data */
+        file->raw_pos = cur + len;
+        file->out.buf = file->map + file->raw_pos;
+        buf_reset(&file->out);
+    }
+    file->pos += len;
+    return ptr;
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -1525,9 +2386,82 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
     file->fd = fd;
+
+    /*
+     * The file may have been replaced, so the old mapping, and anything
+     * we've buffered from it, no longer reflects its contents.  Records
+     * read earlier may still be borrowing data from the old mapping,
+     * so it's only unmapped when we're closed.
+     */
+    if (file->map != NULL) {
+        file->raw_pos -= file->out.avail;
+        file->out.buf = file->out_buf;
+        buf_reset(&file->out);
+#ifdef HAVE_SYS_MMAN_H
+        {
+            file_old_map *old_map = g_new(file_old_map, 1);
+
+            old_map->start = file->map;
+            old_map->size = (gsize)file->map_size;
+            file->old_maps = g_slist_prepend(file->old_maps, old_map);
+        }
+#endif
+        file->map = NULL;
+        file->map_size = 0;
+        if (file->compression == UNCOMPRESSED)
+            file_map(file);
+    }
     return TRUE;
 }
 
+void
+file_set_growing(FILE_T file)
+{
+    if (file->growing)
+        return;
+    file->growing = TRUE;
+
+    /*
+     * Go back to reading the file if it's already mapped; that's only
+     * been done while it was being opened, so nobody can be borrowing
+     * data from the mapping yet.
+     */
+    if (file->map != NULL && !file->is_memory) {
+        if (file->out.buf != file->out_buf) {
+            file->raw_pos -= file->out.avail;
+            file->out.buf = file->out_buf;
+            buf_reset(&file->out);
+        }
+        file_unmap(file);
+        if (file->shm_ring == NULL &&
+            ws_lseek64(file->fd, file->raw_pos, SEEK_SET) == -1) {
+            file->err = errno;
+            file->err_info = NULL;
+        }
+    }
+}
+
+void
+file_set_shm_ring(FILE_T file, ws_shm_ring_t *ring)
+{
+    if (file->shm_ring == ring)
+        return;
+    if (file->shm_ring != NULL) {
+        file->shm_ring = NULL;
+
+        /* We only seek the file when we have to read it. */
+        if (ws_lseek64(file->fd, file->raw_pos, SEEK_SET) == -1) {
+            file->err = errno;
+            file->err_info = NULL;
+        }
+    }
+
+    /* The ring holds the file as it's written, so it's of no use if
+       we're decompressing it. */
+    if (ring != NULL && file->compression == UNCOMPRESSED)
+        file->shm_ring = ring;
+}
+
 void
 file_close(FILE_T file)
 {
@@ -1538,9 +2472,17 @@ file_close(FILE_T file)
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
 #endif
-        g_free(file->out.buf);
+        g_free(file->out_buf);
         g_free(file->in.buf);
     }
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(file->zstd_dctx);
+#endif
+#ifdef HAVE_LZ4
+    if (file->lz4_dctx != NULL)
+        LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
+    file_unmap(file);
     g_free(file->fast_seek_cur);
     file->err = 0;
     file->err_info = NULL;
@@ -1839,6 +2781,509 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*
+ * Zstandard and LZ4 files are written as a sequence of independent
+ * frames, each holding FRAMEW_FRAME_SIZE bytes of uncompressed data
+ * (except, perhaps, the last one), so that the reader can start
+ * decompressing at the beginning of any frame.  Zstandard files also
+ * get a seek table at the end, in the format of the zstd "seekable"
+ * contrib code, so that the reader doesn't have to decompress the
+ * whole file to find the frames.
+ *
+ * Data is compressed as it's written.  Flushing pushes out what the
+ * compressor has buffered without ending the frame, so a writer that
+ * flushes after every packet doesn't get a frame, with its header and
+ * fresh compression history, for every packet.
+ */
+#define FRAMEW_FRAME_SIZE   (1024U * 1024U)
+
+#ifdef HAVE_LZ4
+/* Most uncompressed data handed to the LZ4 compressor at once. */
+#define FRAMEW_LZ4_CHUNK_SIZE   (64U * 1024U)
+#endif
+
+/* Skippable frame variant used for the Zstandard seek table. */
+#define ZSTD_SEEKTABLE_MAGIC    (SKIPPABLE_FRAME_MAGIC | 0xE)
+
+/* internal frame-compressed file state data structure for writing */
+struct wtap_frame_writer {
+    int fd;                 /* file descriptor */
+    wtap_compression_type compression_type;
+    guint8 *out;            /* compressed output buffer */
+    size_t out_size;        /* size of the compressed output buffer */
+    gboolean in_frame;      /* has the current frame been started? */
+    guint32 frame_in;       /* uncompressed size of the current frame */
+    guint32 frame_out;      /* compressed size of the current frame so far */
+    GArray *frames;         /* compressed and uncompressed frame sizes */
+    int err;                /* error code */
+#ifdef HAVE_ZSTD
+    ZSTD_CStream *zstd_cstream; /* Zstandard compression stream */
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_cctx *lz4_cctx;    /* LZ4 compression context */
+    LZ4F_preferences_t lz4_prefs;
+#endif
+};
+
+/* Entry in the list of frames written so far. */
+struct framew_frame {
+    guint32 compressed_size;
+    guint32 uncompressed_size;
+};
+
+FRAMEWFILE_T
+framewfile_open(const char *path, wtap_compression_type compression_type)
+{
+    int fd;
+    FRAMEWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = framewfile_fdopen(fd, compression_type);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+FRAMEWFILE_T
+framewfile_fdopen(int fd, wtap_compression_type compression_type)
+{
+    FRAMEWFILE_T state;
+
+    switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+#endif
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+#endif
+        break;
+
+    default:
+        errno = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return NULL;
+    }
+
+    /* allocate wtap_frame_writer structure to return */
+    state = (FRAMEWFILE_T)g_try_malloc0(sizeof *state);
+    if (state == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* set up the compressor and allocate an output buffer big enough
+       for anything it produces at once */
+    switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->zstd_cstream = ZSTD_createCStream();
+        state->out_size = ZSTD_CStreamOutSize();
+        if (state->zstd_cstream == NULL)
+            goto nomem;
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        /* no content size, as we don't know it when starting a frame */
+        memset(&state->lz4_prefs, 0, sizeof state->lz4_prefs);
+        state->out_size = LZ4F_compressBound(FRAMEW_LZ4_CHUNK_SIZE, &state->lz4_prefs);
+        if (LZ4F_isError(LZ4F_createCompressionContext(&state->lz4_cctx, LZ4F_VERSION))) {
+            state->lz4_cctx = NULL;
+            goto nomem;
+        }
+        break;
+#endif
+
+    default:
+        break;
+    }
+    state->out = (guint8 *)g_try_malloc(state->out_size);
+    if (state->out == NULL)
+        goto nomem;
+
+    state->fd = fd;
+    state->compression_type = compression_type;
+    state->frames = g_array_new(FALSE, FALSE, sizeof (struct framew_frame));
+    state->err = 0;
+
+    /* return stream */
+    return state;
+
+nomem:
+#ifdef HAVE_ZSTD
+    ZSTD_freeCStream(state->zstd_cstream);
+#endif
+#ifdef HAVE_LZ4
+    if (state->lz4_cctx != NULL)
+        LZ4F_freeCompressionContext(state->lz4_cctx);
+#endif
+    g_free(state);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/* Write out len bytes from buf to the output file.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+framew_write_raw(FRAMEWFILE_T state, const void *buf, size_t len)
+{
+    ssize_t got;
+
+    got = ws_write(state->fd, buf, (unsigned int)len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    return 0;
+}
+
+/* Write out len bytes of compressed data from the output buffer as part
+   of the current frame.  Return -1, and set state->err, on failure;
+   return 0 on success. */
+static int
+framew_write_out(FRAMEWFILE_T state, size_t len)
+{
+    if (len == 0)
+        return 0;
+    if (framew_write_raw(state, state->out, len) == -1)
+        return -1;
+    state->frame_out += (guint32)len;
+    return 0;
+}
+
+/* Start a new frame.  Return -1, and set state->err, on failure; return
+   0 on success. */
+static int
+framew_begin_frame(FRAMEWFILE_T state)
+{
+    size_t ret;
+
+    state->frame_in = 0;
+    state->frame_out = 0;
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        ret = ZSTD_initCStream(state->zstd_cstream, ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        ret = LZ4F_compressBegin(state->lz4_cctx, state->out,
+                                 state->out_size, &state->lz4_prefs);
+        if (LZ4F_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (framew_write_out(state, ret) == -1)
+            return -1;
+        break;
+#endif
+
+    default:
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    state->in_frame = TRUE;
+    return 0;
+}
+
+/* Compress len bytes from buf into the current frame, writing out
+   whatever compressed data the compressor hands back.  Return -1, and
+   set state->err, on failure; return 0 on success. */
+static int
+framew_comp(FRAMEWFILE_T state, const guint8 *buf, guint len)
+{
+    size_t ret;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+    {
+        ZSTD_inBuffer input;
+        ZSTD_outBuffer output;
+
+        input.src = buf;
+        input.size = len;
+        input.pos = 0;
+        while (input.pos < input.size) {
+            output.dst = state->out;
+            output.size = state->out_size;
+            output.pos = 0;
+            ret = ZSTD_compressStream(state->zstd_cstream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return -1;
+            }
+            if (framew_write_out(state, output.pos) == -1)
+                return -1;
+        }
+        break;
+    }
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+    {
+        guint done, n;
+
+        for (done = 0; done < len; done += n) {
+            n = MIN(len - done, FRAMEW_LZ4_CHUNK_SIZE);
+            ret = LZ4F_compressUpdate(state->lz4_cctx, state->out,
+                                      state->out_size, buf + done, n, NULL);
+            if (LZ4F_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return -1;
+            }
+            if (framew_write_out(state, ret) == -1)
+                return -1;
+        }
+        break;
+    }
+#endif
+
+    default:
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    state->frame_in += len;
+    return 0;
+}
+
+/* Write out everything the compressor has buffered for the current
+   frame, ending the frame if end is TRUE.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+framew_flush(FRAMEWFILE_T state, gboolean end)
+{
+    size_t ret;
+    struct framew_frame frame;
+
+    if (!state->in_frame)
+        return 0;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+    {
+        ZSTD_outBuffer output;
+
+        /* ret is the amount still to be written out */
+        do {
+            output.dst = state->out;
+            output.size = state->out_size;
+            output.pos = 0;
+            if (end)
+                ret = ZSTD_endStream(state->zstd_cstream, &output);
+            else
+                ret = ZSTD_flushStream(state->zstd_cstream, &output);
+            if (ZSTD_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return -1;
+            }
+            if (framew_write_out(state, output.pos) == -1)
+                return -1;
+        } while (ret != 0);
+        break;
+    }
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        if (end)
+            ret = LZ4F_compressEnd(state->lz4_cctx, state->out,
+                                   state->out_size, NULL);
+        else
+            ret = LZ4F_flush(state->lz4_cctx, state->out,
+                             state->out_size, NULL);
+        if (LZ4F_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (framew_write_out(state, ret) == -1)
+            return -1;
+        break;
+#endif
+
+    default:
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+
+    if (end) {
+        frame.compressed_size = state->frame_out;
+        frame.uncompressed_size = state->frame_in;
+        g_array_append_val(state->frames, frame);
+        state->in_frame = FALSE;
+    }
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+guint
+framewfile_write(FRAMEWFILE_T state, const void *buf, guint len)
+{
+    const guint8 *p = (const guint8 *)buf;
+    guint put = len;
+    guint n;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* compress into frames, ending each one as it fills up */
+    while (len != 0) {
+        if (!state->in_frame && framew_begin_frame(state) == -1)
+            return 0;
+        n = FRAMEW_FRAME_SIZE - state->frame_in;
+        if (n > len)
+            n = len;
+        if (framew_comp(state, p, n) == -1)
+            return 0;
+        p += n;
+        len -= n;
+        if (state->frame_in == FRAMEW_FRAME_SIZE && framew_flush(state, TRUE) == -1)
+            return 0;
+    }
+
+    /* input was all compressed */
+    return put;
+}
+
+/* Flush out what we've written so far, without ending the current
+   frame.  Returns -1, and sets state->err, on failure; returns 0 on
+   success. */
+int
+framewfile_flush(FRAMEWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    return framew_flush(state, FALSE);
+}
+
+#ifdef HAVE_ZSTD
+static void
+put_le32(guint8 *p, guint32 v)
+{
+    p[0] = (guint8)v;
+    p[1] = (guint8)(v >> 8);
+    p[2] = (guint8)(v >> 16);
+    p[3] = (guint8)(v >> 24);
+}
+
+/* Write out a seek table listing the frames written so far.  Returns -1,
+   and sets state->err, on failure; returns 0 on success. */
+static int
+framew_write_zstd_seek_table(FRAMEWFILE_T state)
+{
+    guint num_frames = state->frames->len;
+    guint table_size = num_frames * 8 + ZSTD_SEEKTABLE_FOOTER_SIZE;
+    guint8 *table, *p;
+    guint i;
+    int ret;
+
+    if (num_frames == 0)
+        return 0;
+
+    table = (guint8 *)g_try_malloc(8 + table_size);
+    if (table == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+    p = table;
+    put_le32(p, ZSTD_SEEKTABLE_MAGIC);
+    put_le32(p + 4, table_size);
+    p += 8;
+    for (i = 0; i < num_frames; i++) {
+        struct framew_frame *frame = &g_array_index(state->frames, struct framew_frame, i);
+
+        put_le32(p, frame->compressed_size);
+        put_le32(p + 4, frame->uncompressed_size);
+        p += 8;
+    }
+    put_le32(p, num_frames);
+    p[4] = 0;       /* no checksums */
+    put_le32(p + 5, ZSTD_SEEKABLE_MAGIC);
+    ret = framew_write_raw(state, table, 8 + table_size);
+    g_free(table);
+    return ret;
+}
+#endif
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+framewfile_close(FRAMEWFILE_T state)
+{
+    int ret = 0;
+
+    /* flush, write the seek table, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (framew_flush(state, TRUE) == -1)
+        ret = state->err;
+#ifdef HAVE_ZSTD
+    if (ret == 0 && state->compression_type == WTAP_ZSTD_COMPRESSED &&
+        framew_write_zstd_seek_table(state) == -1)
+        ret = state->err;
+    ZSTD_freeCStream(state->zstd_cstream);
+#endif
+#ifdef HAVE_LZ4
+    if (state->lz4_cctx != NULL)
+        LZ4F_freeCompressionContext(state->lz4_cctx);
+#endif
+    g_array_free(state->frames, TRUE);
+    g_free(state->out);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+framewfile_geterr(FRAMEWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
@@ -16,13 +16,25 @@
 
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
+extern FILE_T file_open_memory(guint8 *data, gsize len);
+extern void file_set_memory(FILE_T stream, guint8 *data, gsize len);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_fast_seek_save(GPtrArray *seek, GByteArray *buf);
+extern gboolean file_fast_seek_load(GPtrArray *seek, const guint8 *data, gsize len);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC gboolean file_iscompressed(FILE_T stream);
+extern wtap_compression_type file_get_compression_type(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
+/*
+ * Return a pointer to the next count bytes of an uncompressed,
+ * memory-mapped file and skip past them, or NULL if that can't be done
+ * and file_read() should be used instead; the data remains valid until
+ * the file is closed.
+ */
+extern const guint8 *file_read_ptr(unsigned int count, FILE_T file);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
 WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
@@ -33,6 +45,19 @@ extern void file_fdclose(FILE_T file);
 extern int file_fdreopen(FILE_T file, const char *path);
 extern void file_close(FILE_T file);
 
+/*
+ * Read an uncompressed file that dumpcap is writing through a capture
+ * ring from the ring where possible. Setting the ring to NULL stops
+ * using it.
+ */
+extern void file_set_shm_ring(FILE_T file, ws_shm_ring_t *ring);
+
+/*
+ * The file may change or grow while it's being read, so read it rather
+ * than memory-mapping it.
+ */
+extern void file_set_growing(FILE_T file);
+
 #ifdef HAVE_ZLIB
 typedef struct wtap_writer *GZWFILE_T;
 
@@ -44,4 +69,15 @@ extern int gzwfile_close(GZWFILE_T state);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_ZLIB */
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+typedef struct wtap_frame_writer *FRAMEWFILE_T;
+
+extern FRAMEWFILE_T framewfile_open(const char *path, wtap_compression_type compression_type);
+extern FRAMEWFILE_T framewfile_fdopen(int fd, wtap_compression_type compression_type);
+extern guint framewfile_write(FRAMEWFILE_T state, const void *buf, guint len);
+extern int framewfile_flush(FRAMEWFILE_T state);
+extern int framewfile_close(FRAMEWFILE_T state);
+extern int framewfile_geterr(FRAMEWFILE_T state);
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
 #endif /* __FILE_H__ */
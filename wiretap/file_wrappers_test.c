@@ -0,0 +1,370 @@
+/* file_wrappers_test.c
+ * Tests for reading memory-mapped capture files and writing compressed ones
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "wtap.h"
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+/*
+ * The test files are native-byte-order pcap files of Ethernet packets,
+ * which the pcap reader hands out straight from the mapping rather than
+ * copying them.  Byte j of packet i is (i + j + delta), so that packets
+ * from two files with different deltas can be told apart.
+ */
+#define PCAP_FILE_HDR_LEN   24
+#define PCAP_REC_HDR_LEN    16
+#define PACKET_LEN          1000
+#define RECORD_LEN          (PCAP_REC_HDR_LEN + PACKET_LEN)
+
+#define RECORD_OFFSET(i)    (PCAP_FILE_HDR_LEN + (gint64)(i) * RECORD_LEN)
+
+static guint
+page_size(void)
+{
+#ifdef _SC_PAGESIZE
+    long size = sysconf(_SC_PAGESIZE);
+
+    if (size > 0)
+        return (guint)size;
+#endif
+    return 4096;
+}
+
+/* Enough packets that the file is well beyond what's read before it's mapped */
+static guint
+num_packets(void)
+{
+    return 8 * page_size() / RECORD_LEN + 1;
+}
+
+static void
+write_capture(const char *path, guint delta)
+{
+    FILE *fh;
+    guint32 file_hdr[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, 1 };
+    guint32 rec_hdr[4];
+    guint8 packet[PACKET_LEN];
+    guint i, j;
+    size_t written;
+    int ret;
+
+    fh = ws_fopen(path, "wb");
+    g_assert(fh != NULL);
+    written = fwrite(file_hdr, sizeof file_hdr, 1, fh);
+    g_assert(written == 1);
+    for (i = 0; i < num_packets(); i++) {
+        rec_hdr[0] = 1000000000 + i;
+        rec_hdr[1] = 0;
+        rec_hdr[2] = PACKET_LEN;
+        rec_hdr[3] = PACKET_LEN;
+        for (j = 0; j < PACKET_LEN; j++)
+            packet[j] = (guint8)(i + j + delta);
+        written = fwrite(rec_hdr, sizeof rec_hdr, 1, fh);
+        g_assert(written == 1);
+        written = fwrite(packet, sizeof packet, 1, fh);
+        g_assert(written == 1);
+    }
+    ret = fclose(fh);
+    g_assert(ret == 0);
+}
+
+static gboolean
+packet_ok(const guint8 *data, guint i, guint delta)
+{
+    guint j;
+
+    for (j = 0; j < PACKET_LEN; j++) {
+        if (data[j] != (guint8)(i + j + delta))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static char *
+temp_capture(void)
+{
+    GError *error = NULL;
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("wtap_fw_XXXXXX.pcap", &path, &error);
+    g_assert_no_error(error);
+    ws_close(fd);
+    return path;
+}
+
+static void
+file_wrappers_test_sequential(void)
+{
+    char *path = temp_capture();
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    guint i;
+
+    write_capture(path, 0);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+
+    for (i = 0; i < num_packets(); i++) {
+        g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+        g_assert(data_offset == RECORD_OFFSET(i));
+        g_assert(wtap_get_rec(wth)->rec_header.packet_header.caplen == PACKET_LEN);
+        g_assert(packet_ok(wtap_get_buf_ptr(wth), i, 0));
+    }
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(err == 0);
+
+    /* Random access, backwards */
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1500);
+    for (i = num_packets(); i-- > 0; ) {
+        g_assert(wtap_seek_read(wth, RECORD_OFFSET(i), &rec, &buf, &err, &err_info));
+        g_assert(ws_buffer_length(&buf) == PACKET_LEN);
+        g_assert(packet_ok(ws_buffer_start_ptr(&buf), i, 0));
+    }
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+#ifndef _WIN32
+/*
+ * Packets read before the file is replaced and reopened may still be
+ * pointing into the old mapping; they have to stay valid.
+ */
+static void
+file_wrappers_test_reopen(void)
+{
+    char *path = temp_capture();
+    char *new_path = g_strconcat(path, ".new", NULL);
+    wtap *wth;
+    wtap_rec rec;
+    Buffer old_buf, new_buf;
+    const guint8 *old_data;
+    int err;
+    gchar *err_info;
+    guint i;
+    int ret;
+
+    write_capture(path, 0);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&old_buf, 1500);
+    ws_buffer_init(&new_buf, 1500);
+    i = num_packets() - 1;
+    g_assert(wtap_seek_read(wth, RECORD_OFFSET(i), &rec, &old_buf, &err, &err_info));
+    old_data = ws_buffer_start_ptr(&old_buf);
+    g_assert(packet_ok(old_data, i, 0));
+
+    write_capture(new_path, 1);
+    ret = g_rename(new_path, path);
+    g_assert(ret == 0);
+    g_assert(wtap_fdreopen(wth, path, &err));
+
+    g_assert(wtap_seek_read(wth, RECORD_OFFSET(i), &rec, &new_buf, &err, &err_info));
+    g_assert(packet_ok(ws_buffer_start_ptr(&new_buf), i, 1));
+    g_assert(old_data == ws_buffer_start_ptr(&old_buf));
+    g_assert(packet_ok(old_data, i, 0));
+
+    ws_buffer_free(&new_buf);
+    ws_buffer_free(&old_buf);
+    wtap_rec_cleanup(&rec);
+
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(new_path);
+    g_free(path);
+}
+
+/*
+ * A file that may change while it's read, such as a live capture, isn't
+ * mapped; if it's cut short, reading what's no longer there has to fail
+ * with a short read rather than a SIGBUS.
+ */
+static void
+file_wrappers_test_growing(void)
+{
+    char *path = temp_capture();
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    gint64 size = 4 * (gint64)page_size();
+    guint complete = (guint)((size - PCAP_FILE_HDR_LEN) / RECORD_LEN);
+    guint i;
+    int ret;
+
+    /* The file must end in the middle of a record for a short read */
+    g_assert((size - PCAP_FILE_HDR_LEN) % RECORD_LEN != 0);
+
+    write_capture(path, 0);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    wtap_set_growing(wth);
+
+    g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(packet_ok(wtap_get_buf_ptr(wth), 0, 0));
+
+    ret = truncate(path, (off_t)size);
+    g_assert(ret == 0);
+
+    for (i = 1; i < complete; i++) {
+        g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+        g_assert(packet_ok(wtap_get_buf_ptr(wth), i, 0));
+    }
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(err == WTAP_ERR_SHORT_READ);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1500);
+    g_assert(wtap_seek_read(wth, RECORD_OFFSET(complete - 1), &rec, &buf, &err, &err_info));
+    g_assert(packet_ok(ws_buffer_start_ptr(&buf), complete - 1, 0));
+    g_assert(!wtap_seek_read(wth, RECORD_OFFSET(complete + 1), &rec, &buf, &err, &err_info));
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+#endif /* _WIN32 */
+
+#ifdef HAVE_ZSTD
+/*
+ * Flushing a Zstandard file after every packet, as a live capture does,
+ * has to get each packet onto the disk without starting a new frame for
+ * it; the packets here all fit in one frame.
+ */
+static void
+file_wrappers_test_zstd_flush(void)
+{
+    char *path = temp_capture();
+    wtap_dumper *pdh;
+    wtap *wth;
+    wtap_rec rec;
+    guint8 packet[PACKET_LEN];
+    ws_statb64 statb;
+    gint64 last_size = 0;
+    GError *error = NULL;
+    gchar *contents;
+    gsize len;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    guint i, j;
+
+    pdh = wtap_dump_open(path, WTAP_FILE_TYPE_SUBTYPE_PCAP, WTAP_ENCAP_ETHERNET,
+                         65535, WTAP_ZSTD_COMPRESSED, &err);
+    g_assert(pdh != NULL);
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS;
+    rec.rec_header.packet_header.caplen = PACKET_LEN;
+    rec.rec_header.packet_header.len = PACKET_LEN;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_ETHERNET;
+    for (i = 0; i < num_packets(); i++) {
+        rec.ts.secs = 1000000000 + i;
+        for (j = 0; j < PACKET_LEN; j++)
+            packet[j] = (guint8)(i + j);
+        g_assert(wtap_dump(pdh, &rec, packet, &err, &err_info));
+        wtap_dump_flush(pdh);
+
+        g_assert(ws_stat64(path, &statb) == 0);
+        g_assert(statb.st_size > last_size);
+        last_size = statb.st_size;
+    }
+    g_assert(wtap_dump_close(pdh, &err));
+
+    /* The seek table footer: number of frames, descriptor, magic */
+    g_file_get_contents(path, &contents, &len, &error);
+    g_assert_no_error(error);
+    g_assert(len > 9);
+    g_assert(pletoh32(contents + len - 4) == 0x8F92EAB1);
+    g_assert(pletoh32(contents + len - 9) == 1);
+    g_free(contents);
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    g_assert(wtap_get_compression_type(wth) == WTAP_ZSTD_COMPRESSED);
+    for (i = 0; i < num_packets(); i++) {
+        g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+        g_assert(data_offset == RECORD_OFFSET(i));
+        g_assert(packet_ok(wtap_get_buf_ptr(wth), i, 0));
+    }
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(err == 0);
+    wtap_close(wth);
+
+    g_unlink(path);
+    g_free(path);
+}
+#endif /* HAVE_ZSTD */
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+    wtap_init(FALSE);
+
+    g_test_add_func("/wiretap/file_wrappers/sequential", file_wrappers_test_sequential);
+#ifndef _WIN32
+    g_test_add_func("/wiretap/file_wrappers/reopen",     file_wrappers_test_reopen);
+    g_test_add_func("/wiretap/file_wrappers/growing",    file_wrappers_test_growing);
+#endif
+#ifdef HAVE_ZSTD
+    g_test_add_func("/wiretap/file_wrappers/zstd_flush", file_wrappers_test_zstd_flush);
+#endif
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
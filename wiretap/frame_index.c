@@ -0,0 +1,517 @@
+/* frame_index.c
+ * Routines for saving and loading a sidecar index of the records in a
+ * capture file, so that the sequential pass through a large file can
+ * be skipped when it's opened again.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include "frame_index.h"
+
+#include <wsutil/file_util.h>
+#include <wsutil/crc32.h>
+#include <wsutil/pint.h>
+
+/*
+ * The index file is:
+ *
+ *    a header, FRAME_INDEX_HDR_SIZE bytes long;
+ *
+ *    one FRAME_INDEX_REC_SIZE-byte entry per record;
+ *
+ *    the file's fast seek points, as saved by file_fast_seek_save().
+ *
+ * All integers are big-endian.
+ */
+#define FRAME_INDEX_SUFFIX      ".wsidx"
+#define FRAME_INDEX_MAGIC       "WSFRMIDX"
+#define FRAME_INDEX_VERSION     1
+
+/* Offsets of the header fields */
+#define HDR_MAGIC               0
+#define HDR_VERSION             8
+#define HDR_FILE_TYPE_SUBTYPE   12
+#define HDR_FILE_SIZE           16
+#define HDR_FILE_MTIME          24
+#define HDR_FILE_PREFIX_CRC     32
+#define HDR_FILE_ENCAP          36
+#define HDR_FILE_TSPREC         40
+#define HDR_NUM_INTERFACES      44
+#define HDR_START_OFFSET        48
+#define HDR_TAIL_OFFSET         56
+#define HDR_REC_COUNT           64
+#define HDR_REC_SIZE            68
+#define HDR_FAST_SEEK_LEN       72
+#define FRAME_INDEX_HDR_SIZE    80
+
+/* Offsets of the record fields */
+#define REC_DATA_OFFSET         0
+#define REC_TS_SECS             8
+#define REC_TS_NSECS            16
+#define REC_LEN                 20
+#define REC_CAPLEN              24
+#define REC_PKT_ENCAP           28
+#define REC_TYPE                32
+#define REC_TSPREC              34
+#define REC_FLAGS               36
+#define FRAME_INDEX_REC_SIZE    40
+
+#define REC_FLAG_HAS_TS         0x00000001
+#define REC_FLAG_HAS_COMMENT    0x00000002
+
+/* The most records we can keep in a GByteArray */
+#define FRAME_INDEX_MAX_RECS    (G_MAXUINT / FRAME_INDEX_REC_SIZE)
+
+/* How much of the beginning of the capture file is checksummed */
+#define FRAME_INDEX_PREFIX_SIZE 65536
+
+struct wtap_frame_index {
+    gboolean    usable;         /* FALSE if we've found we can't index the file */
+    guint32     num_interfaces; /* number of interfaces when the file was opened */
+    gint64      start_offset;   /* where reading started */
+    gint64      tail_offset;    /* where the last record ended */
+    guint32     count;          /* number of records */
+    GByteArray *records;        /* FRAME_INDEX_REC_SIZE bytes per record */
+};
+
+/*
+ * We only index file types where records can be read with
+ * wtap_seek_read() using nothing but what was set up when the file was
+ * opened, and the non-record data before the first record and after the
+ * last one.
+ */
+static gboolean
+frame_index_supported(wtap *wth)
+{
+    if (wth->ispipe || wth->fast_seek == NULL)
+        return FALSE;
+
+    switch (wth->file_type_subtype) {
+
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_AIX:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS991029:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990417:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990915:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAPNG:
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+static guint32
+frame_index_num_interfaces(wtap *wth)
+{
+    return wth->interface_data != NULL ? wth->interface_data->len : 0;
+}
+
+/*
+ * Get what identifies the version of the capture file the index was
+ * made from: its size, its modification time, and a CRC of the first
+ * FRAME_INDEX_PREFIX_SIZE bytes of it.
+ */
+static gboolean
+frame_index_file_id(const char *filename, gint64 *size, gint64 *mtime,
+                    guint32 *prefix_crc)
+{
+    ws_statb64 statb;
+    guint8 *prefix;
+    int fd;
+    ssize_t nread;
+
+    fd = ws_open(filename, O_RDONLY|O_BINARY, 0000);
+    if (fd == -1)
+        return FALSE;
+    if (ws_fstat64(fd, &statb) == -1) {
+        ws_close(fd);
+        return FALSE;
+    }
+    prefix = (guint8 *)g_malloc(FRAME_INDEX_PREFIX_SIZE);
+    nread = ws_read(fd, prefix, FRAME_INDEX_PREFIX_SIZE);
+    ws_close(fd);
+    if (nread < 0) {
+        g_free(prefix);
+        return FALSE;
+    }
+    *size = (gint64)statb.st_size;
+    *mtime = (gint64)statb.st_mtime;
+    *prefix_crc = crc32_ccitt(prefix, (guint)nread);
+    g_free(prefix);
+    return TRUE;
+}
+
+wtap_frame_index *
+wtap_frame_index_new(wtap *wth)
+{
+    wtap_frame_index *idx;
+
+    if (!frame_index_supported(wth))
+        return NULL;
+
+    idx = g_new(wtap_frame_index, 1);
+    idx->usable = TRUE;
+    idx->num_interfaces = frame_index_num_interfaces(wth);
+    idx->start_offset = wtap_read_tell(wth);
+    idx->tail_offset = idx->start_offset;
+    idx->count = 0;
+    idx->records = g_byte_array_new();
+    return idx;
+}
+
+static void
+frame_index_unusable(wtap_frame_index *idx)
+{
+    idx->usable = FALSE;
+    g_byte_array_set_size(idx->records, 0);
+}
+
+void
+wtap_frame_index_add(wtap_frame_index *idx, wtap *wth, gint64 data_offset)
+{
+    wtap_rec *rec = &wth->rec;
+    guint8 entry[FRAME_INDEX_REC_SIZE];
+    guint32 len, caplen, flags;
+    gint32 pkt_encap;
+
+    if (!idx->usable)
+        return;
+
+    /*
+     * If anything came between this record and the previous one, or
+     * an interface was added, we'd have to process it when loading
+     * the index, so give up.
+     */
+    if ((idx->count != 0 && data_offset != idx->tail_offset) ||
+        frame_index_num_interfaces(wth) != idx->num_interfaces ||
+        idx->count == FRAME_INDEX_MAX_RECS) {
+        frame_index_unusable(idx);
+        return;
+    }
+
+    switch (rec->rec_type) {
+
+    case REC_TYPE_PACKET:
+        len = rec->rec_header.packet_header.len;
+        caplen = rec->rec_header.packet_header.caplen;
+        pkt_encap = rec->rec_header.packet_header.pkt_encap;
+        break;
+
+    case REC_TYPE_SYSCALL:
+        len = rec->rec_header.syscall_header.event_len;
+        caplen = rec->rec_header.syscall_header.event_filelen;
+        pkt_encap = WTAP_ENCAP_UNKNOWN;
+        break;
+
+    default:
+        len = 0;
+        caplen = 0;
+        pkt_encap = WTAP_ENCAP_UNKNOWN;
+        break;
+    }
+    flags = 0;
+    if (rec->presence_flags & WTAP_HAS_TS)
+        flags |= REC_FLAG_HAS_TS;
+    if (rec->opt_comment != NULL)
+        flags |= REC_FLAG_HAS_COMMENT;
+
+    phton64(&entry[REC_DATA_OFFSET], (guint64)data_offset);
+    phton64(&entry[REC_TS_SECS], (guint64)(gint64)rec->ts.secs);
+    phton32(&entry[REC_TS_NSECS], (guint32)rec->ts.nsecs);
+    phton32(&entry[REC_LEN], len);
+    phton32(&entry[REC_CAPLEN], caplen);
+    phton32(&entry[REC_PKT_ENCAP], (guint32)pkt_encap);
+    phton16(&entry[REC_TYPE], (guint16)rec->rec_type);
+    phton16(&entry[REC_TSPREC], (guint16)(gint16)rec->tsprec);
+    phton32(&entry[REC_FLAGS], flags);
+    g_byte_array_append(idx->records, entry, sizeof entry);
+    idx->count++;
+    idx->tail_offset = wtap_read_tell(wth);
+}
+
+static gchar *
+frame_index_filename(const char *filename)
+{
+    return g_strconcat(filename, FRAME_INDEX_SUFFIX, NULL);
+}
+
+gboolean
+wtap_frame_index_save(wtap_frame_index *idx, wtap *wth, const char *filename,
+                      int *err)
+{
+    guint8 hdr[FRAME_INDEX_HDR_SIZE];
+    GByteArray *fast_seek;
+    gint64 file_size, file_mtime;
+    guint32 prefix_crc;
+    gchar *index_filename, *tmp_filename;
+    FILE *fp;
+    gboolean ok;
+
+    *err = 0;
+    if (!idx->usable || frame_index_num_interfaces(wth) != idx->num_interfaces)
+        return FALSE;
+    if (!frame_index_file_id(filename, &file_size, &file_mtime, &prefix_crc)) {
+        *err = errno;
+        return FALSE;
+    }
+
+    fast_seek = g_byte_array_new();
+    file_fast_seek_save(wth->fast_seek, fast_seek);
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(&hdr[HDR_MAGIC], FRAME_INDEX_MAGIC, 8);
+    phton32(&hdr[HDR_VERSION], FRAME_INDEX_VERSION);
+    phton32(&hdr[HDR_FILE_TYPE_SUBTYPE], (guint32)wth->file_type_subtype);
+    phton64(&hdr[HDR_FILE_SIZE], (guint64)file_size);
+    phton64(&hdr[HDR_FILE_MTIME], (guint64)file_mtime);
+    phton32(&hdr[HDR_FILE_PREFIX_CRC], prefix_crc);
+    phton32(&hdr[HDR_FILE_ENCAP], (guint32)wth->file_encap);
+    phton32(&hdr[HDR_FILE_TSPREC], (guint32)wth->file_tsprec);
+    phton32(&hdr[HDR_NUM_INTERFACES], idx->num_interfaces);
+    phton64(&hdr[HDR_START_OFFSET], (guint64)idx->start_offset);
+    phton64(&hdr[HDR_TAIL_OFFSET], (guint64)idx->tail_offset);
+    phton32(&hdr[HDR_REC_COUNT], idx->count);
+    phton32(&hdr[HDR_REC_SIZE], FRAME_INDEX_REC_SIZE);
+    phton64(&hdr[HDR_FAST_SEEK_LEN], (guint64)fast_seek->len);
+
+    /*
+     * Write it to a temporary file and rename that, so that nobody
+     * sees a partially-written index.
+     */
+    index_filename = frame_index_filename(filename);
+    tmp_filename = g_strconcat(index_filename, ".tmp", NULL);
+    fp = ws_fopen(tmp_filename, "wb");
+    if (fp == NULL) {
+        *err = errno;
+        ok = FALSE;
+    } else {
+        ok = fwrite(hdr, 1, sizeof hdr, fp) == sizeof hdr &&
+             fwrite(idx->records->data, 1, idx->records->len, fp) == idx->records->len &&
+             fwrite(fast_seek->data, 1, fast_seek->len, fp) == fast_seek->len;
+        if (!ok)
+            *err = errno;
+        if (fclose(fp) == EOF && ok) {
+            *err = errno;
+            ok = FALSE;
+        }
+        if (ok && ws_rename(tmp_filename, index_filename) == -1) {
+            *err = errno;
+            ok = FALSE;
+        }
+        if (!ok)
+            ws_unlink(tmp_filename);
+    }
+    g_free(tmp_filename);
+    g_free(index_filename);
+    g_byte_array_free(fast_seek, TRUE);
+    return ok;
+}
+
+/*
+ * Read the non-record data that precedes the first record and follows
+ * the last one, as a sequential pass through the file would have.
+ */
+static gboolean
+frame_index_read_ends(wtap_frame_index *idx, wtap *wth)
+{
+    int err = 0;
+    gchar *err_info = NULL;
+    gint64 data_offset;
+
+    if (idx->count != 0 &&
+        (gint64)pntoh64(&idx->records->data[REC_DATA_OFFSET]) != idx->start_offset) {
+        /* There's something before the first record; read through it. */
+        if (!wtap_read(wth, &err, &err_info, &data_offset) ||
+            data_offset != (gint64)pntoh64(&idx->records->data[REC_DATA_OFFSET])) {
+            g_free(err_info);
+            return FALSE;
+        }
+    }
+
+    if (file_seek(wth->fh, idx->tail_offset, SEEK_SET, &err) == -1)
+        return FALSE;
+    if (wtap_read(wth, &err, &err_info, &data_offset)) {
+        /* There's a record after the last one we know about. */
+        return FALSE;
+    }
+    g_free(err_info);
+    return err == 0;
+}
+
+wtap_frame_index *
+wtap_frame_index_load(wtap *wth, const char *filename)
+{
+    gchar *index_filename;
+    FILE *fp;
+    guint8 hdr[FRAME_INDEX_HDR_SIZE];
+    gint64 file_size, file_mtime;
+    guint32 prefix_crc;
+    guint32 count;
+    guint64 fast_seek_len;
+    ws_statb64 statb;
+    wtap_frame_index *idx = NULL;
+    guint8 *fast_seek = NULL;
+    int err;
+
+    if (!frame_index_supported(wth))
+        return NULL;
+    if (!frame_index_file_id(filename, &file_size, &file_mtime, &prefix_crc))
+        return NULL;
+
+    index_filename = frame_index_filename(filename);
+    fp = ws_fopen(index_filename, "rb");
+    g_free(index_filename);
+    if (fp == NULL)
+        return NULL;
+
+    if (fread(hdr, 1, sizeof hdr, fp) != sizeof hdr)
+        goto fail;
+    count = pntoh32(&hdr[HDR_REC_COUNT]);
+    fast_seek_len = pntoh64(&hdr[HDR_FAST_SEEK_LEN]);
+    if (memcmp(&hdr[HDR_MAGIC], FRAME_INDEX_MAGIC, 8) != 0 ||
+        count > FRAME_INDEX_MAX_RECS ||
+        pntoh32(&hdr[HDR_VERSION]) != FRAME_INDEX_VERSION ||
+        pntoh32(&hdr[HDR_REC_SIZE]) != FRAME_INDEX_REC_SIZE ||
+        (int)pntoh32(&hdr[HDR_FILE_TYPE_SUBTYPE]) != wth->file_type_subtype ||
+        (gint64)pntoh64(&hdr[HDR_FILE_SIZE]) != file_size ||
+        (gint64)pntoh64(&hdr[HDR_FILE_MTIME]) != file_mtime ||
+        pntoh32(&hdr[HDR_FILE_PREFIX_CRC]) != prefix_crc ||
+        (int)pntoh32(&hdr[HDR_FILE_ENCAP]) != wth->file_encap ||
+        (int)pntoh32(&hdr[HDR_FILE_TSPREC]) != wth->file_tsprec ||
+        pntoh32(&hdr[HDR_NUM_INTERFACES]) != frame_index_num_interfaces(wth) ||
+        (gint64)pntoh64(&hdr[HDR_START_OFFSET]) != file_tell(wth->fh))
+        goto fail;
+
+    /* Make sure the index is all there before allocating anything for it */
+    if (ws_fstat64(fileno(fp), &statb) == -1 ||
+        (guint64)statb.st_size != FRAME_INDEX_HDR_SIZE +
+            (guint64)count * FRAME_INDEX_REC_SIZE + fast_seek_len)
+        goto fail;
+
+    idx = g_new(wtap_frame_index, 1);
+    idx->usable = TRUE;
+    idx->num_interfaces = pntoh32(&hdr[HDR_NUM_INTERFACES]);
+    idx->start_offset = (gint64)pntoh64(&hdr[HDR_START_OFFSET]);
+    idx->tail_offset = (gint64)pntoh64(&hdr[HDR_TAIL_OFFSET]);
+    idx->count = count;
+    idx->records = g_byte_array_sized_new(count * FRAME_INDEX_REC_SIZE);
+    g_byte_array_set_size(idx->records, count * FRAME_INDEX_REC_SIZE);
+    if (fread(idx->records->data, 1, idx->records->len, fp) != idx->records->len)
+        goto fail;
+    fast_seek = (guint8 *)g_malloc((gsize)fast_seek_len);
+    if (fread(fast_seek, 1, (size_t)fast_seek_len, fp) != fast_seek_len)
+        goto fail;
+    fclose(fp);
+    fp = NULL;
+
+    if (!file_fast_seek_load(wth->fast_seek, fast_seek, (gsize)fast_seek_len))
+        goto fail;
+    g_free(fast_seek);
+    fast_seek = NULL;
+
+    if (!frame_index_read_ends(idx, wth)) {
+        /*
+         * Go back to where we started, so that the caller can read
+         * the file sequentially instead.
+         */
+        file_seek(wth->fh, idx->start_offset, SEEK_SET, &err);
+        goto fail;
+    }
+    return idx;
+
+fail:
+    if (fp != NULL)
+        fclose(fp);
+    g_free(fast_seek);
+    if (idx != NULL)
+        wtap_frame_index_free(idx);
+    return NULL;
+}
+
+guint32
+wtap_frame_index_count(const wtap_frame_index *idx)
+{
+    return idx->count;
+}
+
+gboolean
+wtap_frame_index_get(const wtap_frame_index *idx, guint32 i, wtap_rec *rec,
+                     gint64 *data_offset, gboolean *has_comment)
+{
+    const guint8 *entry;
+    guint32 flags;
+
+    if (i >= idx->count)
+        return FALSE;
+    entry = &idx->records->data[(gsize)i * FRAME_INDEX_REC_SIZE];
+
+    /* The index only has some of the header fields; zero the others. */
+    memset(&rec->rec_header, 0, sizeof rec->rec_header);
+    rec->rec_type = pntoh16(&entry[REC_TYPE]);
+    flags = pntoh32(&entry[REC_FLAGS]);
+    rec->presence_flags = (flags & REC_FLAG_HAS_TS) ? WTAP_HAS_TS : 0;
+    rec->ts.secs = (time_t)(gint64)pntoh64(&entry[REC_TS_SECS]);
+    rec->ts.nsecs = (int)pntoh32(&entry[REC_TS_NSECS]);
+    rec->tsprec = (gint16)pntoh16(&entry[REC_TSPREC]);
+    switch (rec->rec_type) {
+
+    case REC_TYPE_PACKET:
+        rec->rec_header.packet_header.len = pntoh32(&entry[REC_LEN]);
+        rec->rec_header.packet_header.caplen = pntoh32(&entry[REC_CAPLEN]);
+        rec->rec_header.packet_header.pkt_encap = (int)pntoh32(&entry[REC_PKT_ENCAP]);
+        break;
+
+    case REC_TYPE_SYSCALL:
+        rec->rec_header.syscall_header.event_len = pntoh32(&entry[REC_LEN]);
+        rec->rec_header.syscall_header.event_filelen = pntoh32(&entry[REC_CAPLEN]);
+        break;
+    }
+    rec->opt_comment = NULL;
+    rec->has_comment_changed = FALSE;
+    *data_offset = (gint64)pntoh64(&entry[REC_DATA_OFFSET]);
+    *has_comment = (flags & REC_FLAG_HAS_COMMENT) ? TRUE : FALSE;
+    return TRUE;
+}
+
+void
+wtap_frame_index_free(wtap_frame_index *idx)
+{
+    g_byte_array_free(idx->records, TRUE);
+    g_free(idx);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,121 @@
+/* frame_index.h
+ * Definitions for routines for saving and loading a sidecar index of
+ * the records in a capture file.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include "wiretap/wtap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A frame index records, for every record in a capture file, the
+ * information that's gathered by a sequential pass through the file:
+ * its offset, its type, its lengths, and its time stamp.  It also
+ * records the fast seek points for a compressed file.
+ *
+ * It's saved in a sidecar file next to the capture file, with the name
+ * of the capture file followed by ".wsidx", after the first sequential
+ * pass, and, the next time the capture file is opened, it can be loaded
+ * instead of doing that pass.  The index is tied to the size,
+ * modification time, and first 64 KiB of the capture file, and is
+ * ignored if any of those have changed.
+ *
+ * Only pcap and pcapng files can be indexed, and pcapng files only if
+ * all their non-record blocks precede the first record or follow the
+ * last one, as those have to be processed when the index is loaded.
+ */
+typedef struct wtap_frame_index wtap_frame_index;
+
+/** Start building an index for a file as it's read sequentially.
+ *
+ * @param wth The file, which must not have been read from yet
+ * @return The new index, or NULL if the file can't be indexed
+ */
+WS_DLL_PUBLIC wtap_frame_index *wtap_frame_index_new(wtap *wth);
+
+/** Add the record just read with wtap_read() to an index.
+ *
+ * @param idx The index from wtap_frame_index_new()
+ * @param wth The file being read
+ * @param data_offset The offset of the record, as returned by wtap_read()
+ */
+WS_DLL_PUBLIC void wtap_frame_index_add(wtap_frame_index *idx, wtap *wth,
+    gint64 data_offset);
+
+/** Save an index once the whole file has been read.
+ *
+ * @param idx The index from wtap_frame_index_new()
+ * @param wth The file that was read
+ * @param filename The name of the file that was read
+ * @param[out] err Set to an errno value if writing the index failed
+ * @return TRUE if the index was saved, FALSE if it couldn't be
+ *   written or if the file turned out not to be indexable
+ */
+WS_DLL_PUBLIC gboolean wtap_frame_index_save(wtap_frame_index *idx,
+    wtap *wth, const char *filename, int *err);
+
+/** Load the saved index for a file, if there's a valid one.
+ *
+ * If the index is loaded, the fast seek points in it are added to the
+ * file, and the non-record data at the beginning and end of the file
+ * is read, so the file can be used as if the sequential pass through it
+ * had been done.
+ *
+ * @param wth The file, which must not have been read from yet
+ * @param filename The name of the file
+ * @return The index, or NULL if there's no valid index for the file
+ */
+WS_DLL_PUBLIC wtap_frame_index *wtap_frame_index_load(wtap *wth,
+    const char *filename);
+
+/** Get the number of records in an index. */
+WS_DLL_PUBLIC guint32 wtap_frame_index_count(const wtap_frame_index *idx);
+
+/** Get a record from an index.
+ *
+ * @param idx The index from wtap_frame_index_load()
+ * @param i The 0-origin record number
+ * @param[out] rec Filled in with the record's metadata; it has no comment
+ *   or options, and the header fields that aren't in the index, such as
+ *   all of a file-type-specific header, are zeroed. Its options_buf is
+ *   left alone.
+ * @param[out] data_offset Set to the record's offset, as returned by
+ *   wtap_read() and passed to wtap_seek_read()
+ * @param[out] has_comment Set to TRUE if the record has a comment
+ * @return FALSE if i is out of range
+ */
+WS_DLL_PUBLIC gboolean wtap_frame_index_get(const wtap_frame_index *idx,
+    guint32 i, wtap_rec *rec, gint64 *data_offset, gboolean *has_comment);
+
+/** Free an index. */
+WS_DLL_PUBLIC void wtap_frame_index_free(wtap_frame_index *idx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,325 @@
+/* frame_index_test.c
+ * Tests for saving and loading sidecar frame indexes
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "wtap.h"
+#include "frame_index.h"
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+/*
+ * The test files are native-byte-order pcap files of Ethernet packets.
+ * Packet i has the time stamp 1000000000 + i seconds, and byte j of it
+ * is (i + j + delta), so that packets from two files with different
+ * deltas can be told apart.
+ */
+#define PCAP_FILE_HDR_LEN   24
+#define PCAP_REC_HDR_LEN    16
+#define PACKET_LEN          100
+#define RECORD_LEN          (PCAP_REC_HDR_LEN + PACKET_LEN)
+#define NUM_PACKETS         50
+
+#define RECORD_OFFSET(i)    (PCAP_FILE_HDR_LEN + (gint64)(i) * RECORD_LEN)
+
+static void
+write_capture(const char *path, guint num_packets, guint delta)
+{
+    FILE *fh;
+    guint32 file_hdr[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, 1 };
+    guint32 rec_hdr[4];
+    guint8 packet[PACKET_LEN];
+    guint i, j;
+    size_t written;
+    int ret;
+
+    fh = ws_fopen(path, "wb");
+    g_assert(fh != NULL);
+    written = fwrite(file_hdr, sizeof file_hdr, 1, fh);
+    g_assert(written == 1);
+    for (i = 0; i < num_packets; i++) {
+        rec_hdr[0] = 1000000000 + i;
+        rec_hdr[1] = 0;
+        rec_hdr[2] = PACKET_LEN;
+        rec_hdr[3] = PACKET_LEN;
+        for (j = 0; j < PACKET_LEN; j++)
+            packet[j] = (guint8)(i + j + delta);
+        written = fwrite(rec_hdr, sizeof rec_hdr, 1, fh);
+        g_assert(written == 1);
+        written = fwrite(packet, sizeof packet, 1, fh);
+        g_assert(written == 1);
+    }
+    ret = fclose(fh);
+    g_assert(ret == 0);
+}
+
+static gboolean
+packet_ok(const guint8 *data, guint i, guint delta)
+{
+    guint j;
+
+    for (j = 0; j < PACKET_LEN; j++) {
+        if (data[j] != (guint8)(i + j + delta))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static char *
+temp_capture(void)
+{
+    GError *error = NULL;
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("wtap_fi_XXXXXX.pcap", &path, &error);
+    g_assert_no_error(error);
+    ws_close(fd);
+    return path;
+}
+
+static void
+remove_capture(char *path)
+{
+    char *index_path = g_strconcat(path, ".wsidx", NULL);
+
+    g_unlink(index_path);
+    g_unlink(path);
+    g_free(index_path);
+    g_free(path);
+}
+
+static wtap *
+open_capture(const char *path)
+{
+    wtap *wth;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    return wth;
+}
+
+/* Read the file through, saving an index of it. */
+static void
+save_index(const char *path)
+{
+    wtap *wth = open_capture(path);
+    wtap_frame_index *idx;
+    int err;
+    gchar *err_info = NULL;
+    gint64 data_offset;
+    gboolean saved;
+
+    idx = wtap_frame_index_new(wth);
+    g_assert(idx != NULL);
+    while (wtap_read(wth, &err, &err_info, &data_offset))
+        wtap_frame_index_add(idx, wth, data_offset);
+    g_assert(err == 0);
+
+    saved = wtap_frame_index_save(idx, wth, path, &err);
+    g_assert(saved);
+    g_assert(err == 0);
+    wtap_frame_index_free(idx);
+    wtap_close(wth);
+}
+
+/* Check that a file whose index couldn't be loaded can still be read. */
+static void
+check_sequential(wtap *wth, guint num_packets, guint delta)
+{
+    int err;
+    gchar *err_info = NULL;
+    gint64 data_offset;
+    guint i;
+
+    for (i = 0; i < num_packets; i++) {
+        g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+        g_assert(data_offset == RECORD_OFFSET(i));
+        g_assert(packet_ok(wtap_get_buf_ptr(wth), i, delta));
+    }
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(err == 0);
+}
+
+static void
+frame_index_test_load(void)
+{
+    char *path = temp_capture();
+    wtap *wth;
+    wtap_frame_index *idx;
+    wtap_rec rec, index_rec;
+    Buffer buf;
+    gint64 data_offset;
+    gboolean has_comment;
+    int err;
+    gchar *err_info = NULL;
+    guint i;
+
+    write_capture(path, NUM_PACKETS, 0);
+    save_index(path);
+
+    wth = open_capture(path);
+    idx = wtap_frame_index_load(wth, path);
+    g_assert(idx != NULL);
+    g_assert(wtap_frame_index_count(idx) == NUM_PACKETS);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1500);
+    for (i = 0; i < NUM_PACKETS; i++) {
+        /* Whatever the index doesn't fill in has to come back zeroed. */
+        memset(&index_rec.rec_header, 0xff, sizeof index_rec.rec_header);
+        g_assert(wtap_frame_index_get(idx, i, &index_rec, &data_offset, &has_comment));
+        g_assert(data_offset == RECORD_OFFSET(i));
+        g_assert(!has_comment);
+        g_assert(index_rec.rec_type == REC_TYPE_PACKET);
+        g_assert(index_rec.presence_flags == WTAP_HAS_TS);
+        g_assert(index_rec.ts.secs == 1000000000 + i);
+        g_assert(index_rec.ts.nsecs == 0);
+        g_assert(index_rec.rec_header.packet_header.caplen == PACKET_LEN);
+        g_assert(index_rec.rec_header.packet_header.len == PACKET_LEN);
+        g_assert(index_rec.rec_header.packet_header.pkt_encap == WTAP_ENCAP_ETHERNET);
+        g_assert(index_rec.rec_header.packet_header.interface_id == 0);
+        g_assert(index_rec.rec_header.packet_header.drop_count == 0);
+        g_assert(index_rec.rec_header.packet_header.pack_flags == 0);
+        g_assert(index_rec.opt_comment == NULL);
+
+        g_assert(wtap_seek_read(wth, data_offset, &rec, &buf, &err, &err_info));
+        g_assert(packet_ok(ws_buffer_start_ptr(&buf), i, 0));
+    }
+    g_assert(!wtap_frame_index_get(idx, NUM_PACKETS, &index_rec, &data_offset, &has_comment));
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+
+    /* It's as if the file had been read through. */
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert(err == 0);
+
+    wtap_frame_index_free(idx);
+    wtap_close(wth);
+    remove_capture(path);
+}
+
+/* An index of what the file used to be mustn't be used. */
+static void
+frame_index_test_stale(void)
+{
+    char *path = temp_capture();
+    wtap *wth;
+    wtap_frame_index *idx;
+
+    write_capture(path, NUM_PACKETS, 0);
+    save_index(path);
+
+    /* The same size, but different data. */
+    write_capture(path, NUM_PACKETS, 1);
+    wth = open_capture(path);
+    idx = wtap_frame_index_load(wth, path);
+    g_assert(idx == NULL);
+    check_sequential(wth, NUM_PACKETS, 1);
+    wtap_close(wth);
+
+    /* More packets. */
+    write_capture(path, NUM_PACKETS + 1, 1);
+    wth = open_capture(path);
+    idx = wtap_frame_index_load(wth, path);
+    g_assert(idx == NULL);
+    check_sequential(wth, NUM_PACKETS + 1, 1);
+    wtap_close(wth);
+
+    remove_capture(path);
+}
+
+/* Nor can an index that's been cut short. */
+static void
+frame_index_test_truncated(void)
+{
+    char *path = temp_capture();
+    char *index_path = g_strconcat(path, ".wsidx", NULL);
+    wtap *wth;
+    wtap_frame_index *idx;
+    GError *error = NULL;
+    gchar *contents;
+    gsize len;
+
+    write_capture(path, NUM_PACKETS, 0);
+    save_index(path);
+
+    g_file_get_contents(index_path, &contents, &len, &error);
+    g_assert_no_error(error);
+    g_file_set_contents(index_path, contents, (gssize)(len - 1), &error);
+    g_assert_no_error(error);
+    g_free(contents);
+
+    wth = open_capture(path);
+    idx = wtap_frame_index_load(wth, path);
+    g_assert(idx == NULL);
+    check_sequential(wth, NUM_PACKETS, 0);
+    wtap_close(wth);
+
+    g_free(index_path);
+    remove_capture(path);
+}
+
+/* Without an index, there's nothing to load. */
+static void
+frame_index_test_missing(void)
+{
+    char *path = temp_capture();
+    wtap *wth;
+
+    write_capture(path, NUM_PACKETS, 0);
+    wth = open_capture(path);
+    g_assert(wtap_frame_index_load(wth, path) == NULL);
+    check_sequential(wth, NUM_PACKETS, 0);
+    wtap_close(wth);
+
+    remove_capture(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+    wtap_init(FALSE);
+
+    g_test_add_func("/wiretap/frame_index/load",      frame_index_test_load);
+    g_test_add_func("/wiretap/frame_index/stale",     frame_index_test_stale);
+    g_test_add_func("/wiretap/frame_index/truncated", frame_index_test_truncated);
+    g_test_add_func("/wiretap/frame_index/missing",   frame_index_test_missing);
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -53,6 +53,7 @@ static gboolean libpcap_dump(wtap_dumper *wdh, const wtap_rec *rec,
     const guint8 *pd, int *err, gchar **err_info);
 static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
     struct pcaprec_ss990915_hdr *hdr);
+static gboolean libpcap_read_pipeline(wtap *wth, wtap_pipeline_ops *ops);
 static void libpcap_close(wtap *wth);
 
 wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
@@ -260,6 +261,7 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
 	wth->priv = (void *)libpcap;
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
+	wth->subtype_read_pipeline = libpcap_read_pipeline;
 	wth->subtype_close = libpcap_close;
 	wth->file_encap = file_encap;
 	wth->snapshot_length = hdr.snaplen;
@@ -755,55 +757,57 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data; if we won't be modifying it, and the
+	 * file is memory-mapped, just point to it.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return FALSE;	/* failed */
+	if (pcap_read_post_process_modifies_data(wth->file_encap,
+	    libpcap->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
+			return FALSE;	/* failed */
+	} else {
+		if (!wtap_read_packet_bytes_in_place(fh, buf, packet_size,
+		    err, err_info))
+			return FALSE;	/* failed */
+	}
 
 	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
 	    rec, ws_buffer_start_ptr(buf), libpcap->byte_swapped, -1);
 	return TRUE;
 }
 
-/* Read the header of the next packet.
-
-   Return FALSE on an error, TRUE on success. */
-static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
-    struct pcaprec_ss990915_hdr *hdr)
+/* Return the size of a packet header in a file of the given subtype. */
+static int libpcap_header_len(int file_type_subtype)
 {
-	int bytes_to_read;
-	guint32 temp;
-	libpcap_t *libpcap;
-
-	switch (wth->file_type_subtype) {
+	switch (file_type_subtype) {
 
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP:
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_AIX:
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
-		bytes_to_read = sizeof (struct pcaprec_hdr);
-		break;
+		return (int)sizeof (struct pcaprec_hdr);
 
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990417:
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS991029:
-		bytes_to_read = sizeof (struct pcaprec_modified_hdr);
-		break;
+		return (int)sizeof (struct pcaprec_modified_hdr);
 
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990915:
-		bytes_to_read = sizeof (struct pcaprec_ss990915_hdr);
-		break;
+		return (int)sizeof (struct pcaprec_ss990915_hdr);
 
 	case WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA:
-		bytes_to_read = sizeof (struct pcaprec_nokia_hdr);
-		break;
+		return (int)sizeof (struct pcaprec_nokia_hdr);
 
 	default:
 		g_assert_not_reached();
-		bytes_to_read = 0;
+		return 0;
 	}
-	if (!wtap_read_bytes_or_eof(fh, hdr, bytes_to_read, err, err_info))
-		return FALSE;
+}
+
+/* Put the fields of a packet header we've read into host byte order,
+   and undo any swapping of the lengths. */
+static void libpcap_fix_header(libpcap_t *libpcap,
+    struct pcaprec_ss990915_hdr *hdr)
+{
+	guint32 temp;
 
-	libpcap = (libpcap_t *)wth->priv;
 	if (libpcap->byte_swapped) {
 		/* Byte-swap the record header fields. */
 		hdr->hdr.ts_sec = GUINT32_SWAP_LE_BE(hdr->hdr.ts_sec);
@@ -834,7 +838,59 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
 		hdr->hdr.incl_len = temp;
 		break;
 	}
+}
+
+/* Read the header of the next packet.
+
+   Return FALSE on an error, TRUE on success. */
+static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
+    struct pcaprec_ss990915_hdr *hdr)
+{
+	if (!wtap_read_bytes_or_eof(fh, hdr,
+	    libpcap_header_len(wth->file_type_subtype), err, err_info))
+		return FALSE;
+
+	libpcap_fix_header((libpcap_t *)wth->priv, hdr);
+	return TRUE;
+}
+
+/*
+ * Read pipeline support.  Everything needed to find and decode packets
+ * is fixed once the file has been opened, so the wtap itself serves as
+ * the state.
+ */
+static guint32 libpcap_pipeline_record_len(const void *state,
+    const guint8 *header)
+{
+	const wtap *wth = (const wtap *)state;
+	struct pcaprec_ss990915_hdr hdr;
+
+	memcpy(&hdr, header, libpcap_header_len(wth->file_type_subtype));
+	libpcap_fix_header((libpcap_t *)wth->priv, &hdr);
+
+	/* Leave bad packet sizes for libpcap_read_packet() to report. */
+	if (hdr.hdr.incl_len > wtap_max_snaplen_for_encap(wth->file_encap))
+		return 0;
+	return libpcap_header_len(wth->file_type_subtype) + hdr.hdr.incl_len;
+}
+
+static gboolean libpcap_pipeline_decode(wtap *wth, void *state _U_,
+    FILE_T fh, wtap_rec *rec, Buffer *buf, int *err, gchar **err_info)
+{
+	return libpcap_read_packet(wth, fh, rec, buf, err, err_info);
+}
+
+static gboolean libpcap_read_pipeline(wtap *wth, wtap_pipeline_ops *ops)
+{
+	/* ERF records can add interfaces to the file as they're read. */
+	if (wth->file_encap == WTAP_ENCAP_ERF)
+		return FALSE;
 
+	ops->header_len = libpcap_header_len(wth->file_type_subtype);
+	ops->record_len = libpcap_pipeline_record_len;
+	ops->decode = libpcap_pipeline_decode;
+	ops->free_state = NULL;
+	ops->state = wth;
 	return TRUE;
 }
 
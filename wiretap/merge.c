@@ -200,22 +200,284 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Number of records to read ahead from each input file when merging
+ * chronologically; 0 means records are used straight from the wtap.
+ */
+static guint merge_read_ahead_records = 0;
+
+void
+merge_set_read_ahead(guint records)
+{
+    merge_read_ahead_records = records;
+}
+
+/** A record copied out of an input file's wtap by the read-ahead code. */
+typedef struct {
+    wtap_rec        rec;
+    Buffer          data;
+    gboolean        data_in_wth;    /* data left in the wtap's buffer */
+} merge_record_t;
+
+/** Read-ahead ring for a single input file. */
+typedef struct {
+    merge_record_t *recs;           /* ring of buffered records */
+    guint           first;          /* index of the current record */
+    guint           count;          /* number of buffered records */
+    gboolean        at_eof;         /* hit EOF after the buffered records */
+    int             err;            /* error after the buffered records */
+    gchar          *err_info;
+} merge_read_ahead_t;
+
+/**
+ * State for a chronological merge.  The files that have a record
+ * present are kept in a binary min-heap ordered on the time stamp of
+ * that record, so picking the next record costs O(log n) rather than
+ * a scan of every input file.
+ */
+typedef struct {
+    merge_in_file_t    *in_files;
+    guint               in_file_count;
+    guint              *heap;           /* indices into in_files */
+    guint               heap_count;
+    gboolean            primed;         /* heap has been filled */
+    guint               read_ahead;     /* records per file, or 0 */
+    merge_read_ahead_t *ahead;          /* per-file rings, if read_ahead */
+} merge_state_t;
+
+static void
+merge_state_init(merge_state_t *state, merge_in_file_t *in_files,
+                 const guint in_file_count, const guint read_ahead)
+{
+    state->in_files = in_files;
+    state->in_file_count = in_file_count;
+    state->heap = g_new(guint, in_file_count);
+    state->heap_count = 0;
+    state->primed = FALSE;
+    state->read_ahead = read_ahead;
+    state->ahead = read_ahead ? g_new0(merge_read_ahead_t, in_file_count) : NULL;
+}
+
+static void
+merge_state_cleanup(merge_state_t *state)
+{
+    guint i, j;
+
+    if (state->ahead) {
+        for (i = 0; i < state->in_file_count; i++) {
+            merge_read_ahead_t *ahead = &state->ahead[i];
+
+            if (ahead->recs) {
+                for (j = 0; j < state->read_ahead; j++) {
+                    g_free(ahead->recs[j].rec.opt_comment);
+                    wtap_rec_cleanup(&ahead->recs[j].rec);
+                    ws_buffer_free(&ahead->recs[j].data);
+                }
+                g_free(ahead->recs);
+            }
+            g_free(ahead->err_info);
+        }
+        g_free(state->ahead);
+    }
+    g_free(state->heap);
+}
+
+/*
+ * Get the number of bytes of data that go with a record; returns FALSE
+ * for record types whose length only the file type's own code knows.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_rec_data_len(const wtap_rec *rec, guint32 *len)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
+    switch (rec->rec_type) {
+
+    case REC_TYPE_PACKET:
+        *len = rec->rec_header.packet_header.caplen;
+        return TRUE;
+
+    case REC_TYPE_SYSCALL:
+        *len = rec->rec_header.syscall_header.event_filelen;
         return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-        return FALSE;
     }
-    /* either one < two or one == two
-     * either way, return one
-     */
-    return TRUE;
+    return FALSE;
+}
+
+/*
+ * Copy the record the wtap just read into a read-ahead slot.  The
+ * options buffer is only used by the readers, so it isn't copied.
+ * Returns FALSE if the data couldn't be copied and has to stay in the
+ * wtap's buffer, in which case nothing more may be read from the file
+ * until this record has been used.
+ */
+static gboolean
+merge_record_copy(merge_record_t *dst, wtap *wth)
+{
+    wtap_rec *src = wtap_get_rec(wth);
+    Buffer    options_buf = dst->rec.options_buf;
+    guint32   len;
+
+    g_free(dst->rec.opt_comment);
+    dst->rec = *src;
+    dst->rec.opt_comment = g_strdup(src->opt_comment);
+    dst->rec.options_buf = options_buf;
+
+    ws_buffer_clean(&dst->data);
+    dst->data_in_wth = !merge_rec_data_len(src, &len);
+    if (!dst->data_in_wth)
+        ws_buffer_append(&dst->data, wtap_get_buf_ptr(wth), len);
+    return !dst->data_in_wth;
+}
+
+/*
+ * Fill an empty read-ahead ring with up to read_ahead records, reading
+ * them from the file back to back.  An error or EOF is remembered and
+ * reported once the buffered records have been used up.
+ */
+static void
+merge_read_ahead_fill(merge_state_t *state, merge_in_file_t *in_file,
+                      merge_read_ahead_t *ahead)
+{
+    gint64 data_offset;
+    guint  i;
+
+    if (ahead->recs == NULL) {
+        ahead->recs = g_new(merge_record_t, state->read_ahead);
+        for (i = 0; i < state->read_ahead; i++) {
+            wtap_rec_init(&ahead->recs[i].rec);
+            ws_buffer_init(&ahead->recs[i].data, 0);
+        }
+    }
+
+    ahead->first = 0;
+    while (ahead->count < state->read_ahead) {
+        if (!wtap_read(in_file->wth, &ahead->err, &ahead->err_info,
+                       &data_offset)) {
+            if (ahead->err == 0)
+                ahead->at_eof = TRUE;
+            break;
+        }
+        if (!merge_record_copy(&ahead->recs[ahead->count++], in_file->wth))
+            break;
+    }
+}
+
+/*
+ * Move an input file on to its next record, dropping the current one
+ * if there is one, and set its state accordingly.  On a read error
+ * *err and *err_info are set.
+ */
+static in_file_state_e
+merge_in_file_advance(merge_state_t *state, const guint i,
+                      int *err, gchar **err_info)
+{
+    merge_in_file_t    *in_file = &state->in_files[i];
+    merge_read_ahead_t *ahead;
+    gint64              data_offset;
+
+    if (state->ahead == NULL) {
+        if (!wtap_read(in_file->wth, err, err_info, &data_offset))
+            in_file->state = (*err != 0) ? GOT_ERROR : AT_EOF;
+        else
+            in_file->state = RECORD_PRESENT;
+        return in_file->state;
+    }
+
+    ahead = &state->ahead[i];
+    if (in_file->state == RECORD_PRESENT) {
+        ahead->first = (ahead->first + 1) % state->read_ahead;
+        ahead->count--;
+    }
+
+    if (ahead->count == 0 && !ahead->at_eof && ahead->err == 0)
+        merge_read_ahead_fill(state, in_file, ahead);
+
+    if (ahead->count > 0) {
+        in_file->state = RECORD_PRESENT;
+    } else if (ahead->err != 0) {
+        *err = ahead->err;
+        *err_info = ahead->err_info;
+        ahead->err_info = NULL;
+        in_file->state = GOT_ERROR;
+    } else {
+        in_file->state = AT_EOF;
+    }
+    return in_file->state;
+}
+
+/*
+ * The current record of an input file, and its data.
+ */
+static wtap_rec *
+merge_in_file_rec(const merge_state_t *state, const merge_in_file_t *in_file)
+{
+    if (state->ahead) {
+        merge_read_ahead_t *ahead = &state->ahead[in_file - state->in_files];
+        return &ahead->recs[ahead->first].rec;
+    }
+    return wtap_get_rec(in_file->wth);
+}
+
+static guint8 *
+merge_in_file_data(const merge_state_t *state, const merge_in_file_t *in_file)
+{
+    if (state->ahead) {
+        merge_read_ahead_t *ahead = &state->ahead[in_file - state->in_files];
+        merge_record_t     *record = &ahead->recs[ahead->first];
+
+        if (!record->data_in_wth)
+            return ws_buffer_start_ptr(&record->data);
+    }
+    return wtap_get_buf_ptr(in_file->wth);
+}
+
+/*
+ * Returns TRUE if the current record of input file a goes before the
+ * current record of input file b.  Records with no time stamp go before
+ * all records with one (yes, this means you won't get a chronological
+ * merge of those records, but you obviously *can't* get that).  Of those,
+ * the file that was given first goes first, but of records with the same
+ * time stamp, the file that was given last goes first; that's the order
+ * in which merging has always written them.
+ */
+static gboolean
+merge_heap_less(const merge_state_t *state, const guint a, const guint b)
+{
+    wtap_rec *rec_a = merge_in_file_rec(state, &state->in_files[a]);
+    wtap_rec *rec_b = merge_in_file_rec(state, &state->in_files[b]);
+    gboolean  has_ts_a = (rec_a->presence_flags & WTAP_HAS_TS) != 0;
+    gboolean  has_ts_b = (rec_b->presence_flags & WTAP_HAS_TS) != 0;
+    int       cmp;
+
+    if (has_ts_a != has_ts_b)
+        return has_ts_b;
+    if (has_ts_a) {
+        cmp = nstime_cmp(&rec_a->ts, &rec_b->ts);
+        if (cmp != 0)
+            return cmp < 0;
+        return a > b;
+    }
+    return a < b;
+}
+
+static void
+merge_heap_sift_down(merge_state_t *state, guint pos)
+{
+    guint *heap = state->heap;
+    guint  item = heap[pos];
+    guint  child;
+
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= state->heap_count)
+            break;
+        if (child + 1 < state->heap_count &&
+            merge_heap_less(state, heap[child + 1], heap[child]))
+            child++;
+        if (!merge_heap_less(state, heap[child], item))
+            break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = item;
 }
 
 /** Read the next packet, in chronological order, from the set of files to
@@ -230,8 +492,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
- * @param in_file_count number of entries in in_files
- * @param in_files input file array
+ * @param state merge state holding the input files
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -239,78 +500,71 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * all files
  */
 static merge_in_file_t *
-merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+merge_read_packet(merge_state_t *state, int *err, gchar **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-    wtap_rec *rec;
+    guint i;
 
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
+    if (!state->primed) {
+        /*
+         * First call; read a record from each file, and build the heap
+         * out of the files that aren't empty.
+         */
+        for (i = 0; i < state->in_file_count; i++) {
+            switch (merge_in_file_advance(state, i, err, err_info)) {
 
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, err, err_info, &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
+            case RECORD_PRESENT:
+                state->heap[state->heap_count++] = i;
+                break;
 
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = wtap_get_rec(in_files[i].wth);
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
+            case GOT_ERROR:
+                return &state->in_files[i];
+
+            default:
                 break;
             }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
-            }
         }
+        for (i = state->heap_count / 2; i-- > 0; )
+            merge_heap_sift_down(state, i);
+        state->primed = TRUE;
+    } else if (state->heap_count > 0) {
+        /*
+         * The record at the top of the heap was handed out by the last
+         * call; replace it with the next record from the same file, or
+         * drop the file from the heap if it's at EOF.
+         */
+        i = state->heap[0];
+        switch (merge_in_file_advance(state, i, err, err_info)) {
+
+        case GOT_ERROR:
+            return &state->in_files[i];
+
+        case AT_EOF:
+            state->heap[0] = state->heap[--state->heap_count];
+            break;
+
+        default:
+            break;
+        }
+        if (state->heap_count > 0)
+            merge_heap_sift_down(state, 0);
     }
 
-    if (ei == -1) {
+    if (state->heap_count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
-    /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
-
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    i = state->heap[0];
+    state->in_files[i].packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return &state->in_files[i];
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -824,6 +1078,10 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_state_t       state;
+
+    merge_state_init(&state, in_files, in_file_count,
+                     do_append ? 0 : merge_read_ahead_records);
 
     for (;;) {
         *err = 0;
@@ -833,8 +1091,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(&state, err, err_info);
         }
 
         if (in_file == NULL) {
@@ -858,7 +1115,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             break;
         }
 
-        rec = wtap_get_rec(in_file->wth);
+        rec = merge_in_file_rec(&state, in_file);
 
         switch (rec->rec_type) {
 
@@ -896,7 +1153,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             }
         }
 
-        if (!wtap_dump(pdh, rec, wtap_get_buf_ptr(in_file->wth), err, err_info)) {
+        if (!wtap_dump(pdh, rec, merge_in_file_data(&state, in_file), err, err_info)) {
             status = MERGE_ERR_CANT_WRITE_OUTFILE;
             break;
         }
@@ -905,6 +1162,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
+    merge_state_cleanup(&state);
     merge_close_in_files(in_file_count, in_files);
 
     if (status == MERGE_OK || status == MERGE_USER_ABORTED) {
@@ -939,6 +1197,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
  */
 merge_result
 merge_files(const gchar* out_filename, const int file_type,
+            const wtap_compression_type compression_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
             guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
@@ -1000,12 +1259,12 @@ merge_files(const gchar* out_filename, const int file_type,
         merge_debug("merge_files: IDB merge operation complete, got %u IDBs", idb_inf ? idb_inf->interface_data->len : 0);
 
         pdh = wtap_dump_open_ng(out_filename, file_type, frame_type, snaplen,
-                                FALSE /* compressed */, shb_hdrs, idb_inf,
+                                compression_type, shb_hdrs, idb_inf,
                                 NULL, err);
     }
     else {
         pdh = wtap_dump_open(out_filename, file_type, frame_type, snaplen,
-                             FALSE /* compressed */, err);
+                             compression_type, err);
     }
 
     if (pdh == NULL) {
@@ -1104,12 +1363,12 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
 
         pdh = wtap_dump_open_tempfile_ng(out_filenamep, pfx, file_type,
                                          frame_type, snaplen,
-                                         FALSE /* compressed */,
+                                         WTAP_UNCOMPRESSED,
                                          shb_hdrs, idb_inf, NULL, err);
     }
     else {
         pdh = wtap_dump_open_tempfile(out_filenamep, pfx, file_type, frame_type,
-                                      snaplen, FALSE /* compressed */, err);
+                                      snaplen, WTAP_UNCOMPRESSED, err);
     }
 
     if (pdh == NULL) {
@@ -1202,12 +1461,12 @@ merge_files_to_stdout(const int file_type, const char *const *in_filenames,
         merge_debug("merge_files: IDB merge operation complete, got %u IDBs", idb_inf ? idb_inf->interface_data->len : 0);
 
         pdh = wtap_dump_open_stdout_ng(file_type, frame_type, snaplen,
-                                       FALSE /* compressed */, shb_hdrs,
+                                       WTAP_UNCOMPRESSED, shb_hdrs,
                                        idb_inf, NULL, err);
     }
     else {
         pdh = wtap_dump_open_stdout(file_type, frame_type, snaplen,
-                                    FALSE /* compressed */, err);
+                                    WTAP_UNCOMPRESSED, err);
     }
 
     if (pdh == NULL) {
@@ -88,6 +88,22 @@ WS_DLL_PUBLIC const char*
 merge_idb_merge_mode_to_string(const int mode);
 
 
+/** Set how many records to read ahead from each input file when merging
+ * chronologically.
+ *
+ * When merging a large number of files, reading one record at a time from
+ * whichever file has the earliest record makes the reads jump between
+ * files constantly.  With read-ahead enabled, up to this many records are
+ * read from a file in one go and buffered in memory, at the cost of
+ * copying each record once.  Appending files is not affected.
+ *
+ * @param records The number of records to buffer per input file, or 0
+ *   (the default) to disable read-ahead
+ */
+WS_DLL_PUBLIC void
+merge_set_read_ahead(guint records);
+
+
 /** @struct merge_progress_callback_t
  *
  * @brief Callback information for merging.
@@ -114,6 +130,7 @@ typedef struct {
  *
  * @param out_filename The output filename
  * @param file_type The WTAP_FILE_TYPE_SUBTYPE_XXX output file type
+ * @param compression_type The compression to use for the output file
  * @param in_filenames An array of input filenames to merge from
  * @param in_file_count The number of entries in in_filenames
  * @param do_append Whether to append by file order instead of chronological order
@@ -133,6 +150,7 @@ typedef struct {
  */
 WS_DLL_PUBLIC merge_result
 merge_files(const gchar* out_filename, const int file_type,
+            const wtap_compression_type compression_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
             guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
@@ -1949,6 +1949,27 @@ pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
 	return phdr_len;
 }
 
+/*
+ * Returns TRUE if pcap_read_post_process() modifies the packet data,
+ * which means it has to be read into a buffer of its own rather than
+ * being looked at where it lies in a memory-mapped file.
+ */
+gboolean
+pcap_read_post_process_modifies_data(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_SLL:
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 void
 pcap_read_post_process(int file_type, int wtap_encap,
     wtap_rec *rec, guint8 *pd, gboolean bytes_swapped, int fcs_len)
@@ -23,6 +23,9 @@ extern int pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
     guint packet_size, gboolean check_packet_size,
     wtap_rec *rec, int *err, gchar **err_info);
 
+extern gboolean pcap_read_post_process_modifies_data(int wtap_encap,
+    gboolean bytes_swapped);
+
 extern void pcap_read_post_process(int file_type, int wtap_encap,
     wtap_rec *rec, guint8 *pd, gboolean bytes_swapped, int fcs_len);
 
@@ -41,6 +41,8 @@ pcapng_read(wtap *wth, int *err, gchar **err_info,
 static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
                  wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
+static gboolean
+pcapng_read_pipeline(wtap *wth, wtap_pipeline_ops *ops);
 static void
 pcapng_close(wtap *wth);
 
@@ -1233,9 +1235,16 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
     /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
-        return FALSE;
+    if (pcap_read_post_process_modifies_data(iface_info.wtap_encap,
+                                             pn->byte_swapped)) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    packet.cap_len - pseudo_header_len, err, err_info))
+            return FALSE;
+    } else {
+        if (!wtap_read_packet_bytes_in_place(fh, wblock->frame_buffer,
+                                             packet.cap_len - pseudo_header_len, err, err_info))
+            return FALSE;
+    }
     block_read += packet.cap_len - pseudo_header_len;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -1517,9 +1526,16 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
     /* "Simple Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                simple_packet.cap_len, err, err_info))
-        return FALSE;
+    if (pcap_read_post_process_modifies_data(iface_info.wtap_encap,
+                                             pn->byte_swapped)) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    simple_packet.cap_len, err, err_info))
+            return FALSE;
+    } else {
+        if (!wtap_read_packet_bytes_in_place(fh, wblock->frame_buffer,
+                                             simple_packet.cap_len, err, err_info))
+            return FALSE;
+    }
 
     /* jump over potential padding bytes at end of the packet data */
     if ((simple_packet.cap_len % 4) != 0) {
@@ -2212,8 +2228,8 @@ pcapng_read_sysdig_event_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *p
     wblock->rec->rec_header.syscall_header.event_filelen = block_read;
 
     /* "Sysdig Event Block" read event data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                block_read, err, err_info))
+    if (!wtap_read_packet_bytes_in_place(fh, wblock->frame_buffer,
+                                         block_read, err, err_info))
         return FALSE;
 
     /* XXX Read comment? */
@@ -2539,6 +2555,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 
     wth->subtype_read = pcapng_read;
     wth->subtype_seek_read = pcapng_seek_read;
+    wth->subtype_read_pipeline = pcapng_read_pipeline;
     wth->subtype_close = pcapng_close;
     wth->file_type_subtype = WTAP_FILE_TYPE_SUBTYPE_PCAPNG;
 
@@ -2752,6 +2769,98 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
 }
 
 
+/*
+ * Read pipeline support.  Only blocks that hold a record are split off
+ * and decoded on their own; everything else may change the section or
+ * its interfaces, or be handled by a plugin, so the pipeline stops at
+ * it and pcapng_read() reads it.  The state is a copy of our pcapng_t,
+ * with its own copy of the interface list, so that pcapng_read() can go
+ * on adding interfaces while records are decoded.
+ */
+static guint32
+pcapng_pipeline_record_len(const void *state, const guint8 *header)
+{
+    const pcapng_t *pn = (const pcapng_t *)state;
+    pcapng_block_header_t bh;
+
+    memcpy(&bh, header, sizeof bh);
+    if (pn->byte_swapped) {
+        bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
+        bh.block_total_length = GUINT32_SWAP_LE_BE(bh.block_total_length);
+    }
+
+    switch (bh.block_type) {
+
+        case(BLOCK_TYPE_PB):
+        case(BLOCK_TYPE_SPB):
+        case(BLOCK_TYPE_EPB):
+        case(BLOCK_TYPE_SYSDIG_EVENT):
+            break;
+
+        default:
+            return 0;
+    }
+
+    /*
+     * Leave oversized blocks, and blocks whose length doesn't include
+     * their padding, to pcapng_read_block().
+     */
+    if (bh.block_total_length > MAX_BLOCK_SIZE ||
+        (bh.block_total_length % 4) != 0)
+        return 0;
+    return bh.block_total_length;
+}
+
+static gboolean
+pcapng_pipeline_decode(wtap *wth, void *state, FILE_T fh, wtap_rec *rec,
+                       Buffer *buf, int *err, gchar **err_info)
+{
+    wtapng_block_t wblock;
+
+    wblock.frame_buffer = buf;
+    wblock.rec = rec;
+
+    if (pcapng_read_block(wth, fh, (pcapng_t *)state, &wblock, err, err_info) != PCAPNG_BLOCK_OK ||
+        wblock.internal) {
+        wtap_block_free(wblock.block);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+pcapng_pipeline_free_state(void *state)
+{
+    pcapng_t *pn = (pcapng_t *)state;
+
+    g_array_free(pn->interfaces, TRUE);
+    g_free(pn);
+}
+
+static gboolean
+pcapng_read_pipeline(wtap *wth, wtap_pipeline_ops *ops)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    pcapng_t *pn;
+
+    pn = g_new(pcapng_t, 1);
+    *pn = *pcapng;
+    pn->interfaces = g_array_sized_new(FALSE, FALSE, sizeof(interface_info_t),
+                                       pcapng->interfaces->len);
+    g_array_append_vals(pn->interfaces, pcapng->interfaces->data,
+                        pcapng->interfaces->len);
+    pn->add_new_ipv4 = NULL;
+    pn->add_new_ipv6 = NULL;
+
+    ops->header_len = (guint)sizeof(pcapng_block_header_t);
+    ops->record_len = pcapng_pipeline_record_len;
+    ops->decode = pcapng_pipeline_decode;
+    ops->free_state = pcapng_pipeline_free_state;
+    ops->state = pn;
+    return TRUE;
+}
+
+
 /* classic wtap: close capture file */
 static void
 pcapng_close(wtap *wth)
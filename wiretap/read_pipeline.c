@@ -0,0 +1,554 @@
+/* read_pipeline.c
+ * Routines for decoding the records of a capture file on other threads,
+ * ahead of wtap_read().
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+
+#include <wsutil/glib-compat.h>
+
+/*
+ * A read pipeline has three stages:
+ *
+ *    a reader thread, which reads the file sequentially, uses the file
+ *    type's record_len routine to find where each record ends, and
+ *    copies the records into batches;
+ *
+ *    a pool of worker threads, each of which takes a batch and decodes
+ *    its records, with the file type's decode routine, into the
+ *    wtap_recs and Buffers of the batch;
+ *
+ *    wtap_read(), which takes the decoded batches in the order in which
+ *    they were read, and hands out their records one at a time.
+ *
+ * The reader stops at anything the file type can't decode on its own,
+ * such as a pcapng block that adds an interface, and at the end of the
+ * file or an error.  wtap_read() then takes every batch up to that point,
+ * reads the next record with the file type's usual read routine, and
+ * starts the reader again after it.  If a record fails to decode, the
+ * batches read after it are thrown away and the record is read the
+ * usual way, so errors are reported exactly as they would otherwise be.
+ *
+ * A fixed number of batches are passed between the stages through
+ * queues, so the reader can only get so far ahead.  A batch isn't
+ * reused until the call to wtap_read() after the one that returned its
+ * last record, as that record's data may point into the batch.
+ */
+
+#define PIPELINE_BATCH_RECORDS      256
+#define PIPELINE_BATCH_BYTES        (1024 * 1024)
+#define PIPELINE_BATCHES_PER_THREAD 4
+#define PIPELINE_MAX_THREADS        16
+
+/* What the reader is told to do when it's stopped */
+#define PIPELINE_RESUME             GINT_TO_POINTER(1)
+#define PIPELINE_QUIT               GINT_TO_POINTER(2)
+
+typedef struct {
+    gint64      offset;         /* where the record is in the file */
+    gsize       data_off;       /* where it is in the batch's data */
+    guint32     len;            /* how long it is */
+    gboolean    decoded;        /* TRUE if it was decoded successfully */
+    wtap_rec    rec;
+    Buffer      buf;
+} pipeline_record;
+
+typedef struct {
+    guint64     seq;            /* the order in which it was read */
+    guint8      *data;          /* the records, as read from the file */
+    gsize       data_len;
+    gsize       data_size;
+    pipeline_record recs[PIPELINE_BATCH_RECORDS];
+    guint       num_recs;
+    void        *state;         /* the file type's state for decoding */
+    int         file_encap;
+    int         file_tsprec;
+    gint64      raw_end;        /* raw file offset after the batch */
+    gboolean    last;           /* TRUE if the reader stopped after it */
+    gint64      stop_offset;    /* if so, where it stopped */
+} pipeline_batch;
+
+typedef struct wtap_read_pipeline {
+    wtap        *wth;
+    wtap_pipeline_ops ops;
+    int         file_encap;
+    int         file_tsprec;
+
+    GThread     *reader;
+    GThread     **workers;
+    guint       num_workers;
+
+    pipeline_batch *batches;
+    guint       num_batches;
+
+    GAsyncQueue *free_q;        /* batches the reader can fill */
+    GAsyncQueue *work_q;        /* batches to be decoded */
+    GAsyncQueue *done_q;        /* batches that have been decoded */
+    GAsyncQueue *resume_q;      /* what the reader should do next */
+    volatile gint cancel;       /* set to make the reader stop */
+
+    /* Used only by the reader */
+    guint64     read_seq;
+
+    /* Used only by wtap_read() */
+    pipeline_batch **pending;   /* decoded batches, by sequence number */
+    guint64     next_seq;
+    pipeline_batch *cur;
+    guint       cur_rec;
+    gboolean    running;        /* TRUE until we've taken the reader's last batch */
+    gboolean    done;           /* TRUE if we've gone back to reading the usual way */
+    gint64      tell;
+    gint64      so_far;
+} wtap_read_pipeline;
+
+static void
+pipeline_batch_reserve(pipeline_batch *batch, gsize len)
+{
+    if (batch->data_size - batch->data_len >= len)
+        return;
+    batch->data_size = MAX(batch->data_len + len, batch->data_size * 2);
+    batch->data_size = MAX(batch->data_size, PIPELINE_BATCH_BYTES);
+    batch->data = (guint8 *)g_realloc(batch->data, batch->data_size);
+}
+
+/*
+ * Give up whatever memory a record's buffer owns.  This is done by hand
+ * rather than with ws_buffer_free(), because that puts small buffers on
+ * a free list that's not thread-safe; the records' buffers never come
+ * from that list.
+ */
+static void
+pipeline_buffer_release(Buffer *buf)
+{
+    if (buf->allocated != 0)
+        g_free(buf->data);
+    buf->data = NULL;
+    buf->allocated = 0;
+    buf->start = 0;
+    buf->first_free = 0;
+}
+
+/*
+ * Read the record at the current position into a batch.  Returns FALSE
+ * if it's not a record we can decode on its own, or if we hit the end of
+ * the file or an error, leaving the usual read routine to deal with it.
+ */
+static gboolean
+pipeline_read_record(wtap_read_pipeline *p, pipeline_batch *batch,
+                     gint64 offset)
+{
+    FILE_T fh = p->wth->fh;
+    guint hdr_len = p->ops.header_len;
+    guint32 len;
+    pipeline_record *r;
+
+    pipeline_batch_reserve(batch, hdr_len);
+    if (file_read(batch->data + batch->data_len, hdr_len, fh) != (int)hdr_len)
+        return FALSE;
+    len = p->ops.record_len(p->ops.state, batch->data + batch->data_len);
+    if (len < hdr_len)
+        return FALSE;
+    pipeline_batch_reserve(batch, len);
+    if (len > hdr_len &&
+        file_read(batch->data + batch->data_len + hdr_len, len - hdr_len, fh) != (int)(len - hdr_len))
+        return FALSE;
+
+    r = &batch->recs[batch->num_recs++];
+    r->offset = offset;
+    r->data_off = batch->data_len;
+    r->len = len;
+    r->decoded = FALSE;
+    batch->data_len += len;
+    return TRUE;
+}
+
+/* Read batches until we have to stop. */
+static void
+pipeline_read_span(wtap_read_pipeline *p)
+{
+    FILE_T fh = p->wth->fh;
+    pipeline_batch *batch;
+    gint64 offset;
+    gboolean last;
+
+    do {
+        batch = (pipeline_batch *)g_async_queue_pop(p->free_q);
+        batch->seq = p->read_seq++;
+        batch->data_len = 0;
+        batch->num_recs = 0;
+        batch->state = p->ops.state;
+        batch->file_encap = p->file_encap;
+        batch->file_tsprec = p->file_tsprec;
+        batch->last = FALSE;
+        while (batch->num_recs < PIPELINE_BATCH_RECORDS &&
+               batch->data_len < PIPELINE_BATCH_BYTES) {
+            offset = file_tell(fh);
+            if (g_atomic_int_get(&p->cancel) ||
+                !pipeline_read_record(p, batch, offset)) {
+                batch->last = TRUE;
+                batch->stop_offset = offset;
+                break;
+            }
+        }
+        batch->raw_end = file_tell_raw(fh);
+
+        /* Once it's queued, the batch isn't ours to look at. */
+        last = batch->last;
+        g_async_queue_push(batch->num_recs != 0 ? p->work_q : p->done_q, batch);
+    } while (!last);
+}
+
+static gpointer
+pipeline_reader(gpointer data)
+{
+    wtap_read_pipeline *p = (wtap_read_pipeline *)data;
+
+    while (g_async_queue_pop(p->resume_q) == PIPELINE_RESUME)
+        pipeline_read_span(p);
+    return NULL;
+}
+
+static gpointer
+pipeline_worker(gpointer data)
+{
+    wtap_read_pipeline *p = (wtap_read_pipeline *)data;
+    FILE_T fh = file_open_memory(NULL, 0);
+    pipeline_batch *batch;
+    pipeline_record *r;
+    guint i;
+    int err;
+    gchar *err_info;
+
+    /* The pipeline itself tells us to quit. */
+    while ((batch = (pipeline_batch *)g_async_queue_pop(p->work_q)) != (gpointer)p) {
+        for (i = 0; i < batch->num_recs; i++) {
+            r = &batch->recs[i];
+            pipeline_buffer_release(&r->buf);
+            r->rec.rec_header.packet_header.pkt_encap = batch->file_encap;
+            r->rec.tsprec = batch->file_tsprec;
+            file_set_memory(fh, batch->data + r->data_off, r->len);
+            err_info = NULL;
+            r->decoded = p->ops.decode(p->wth, batch->state, fh, &r->rec,
+                                       &r->buf, &err, &err_info) &&
+                         file_tell(fh) == (gint64)r->len;
+            if (!r->decoded) {
+                /* It'll be read again the usual way; don't bother
+                   with the rest. */
+                g_free(err_info);
+                break;
+            }
+        }
+        g_async_queue_push(p->done_q, batch);
+    }
+    file_close(fh);
+    return NULL;
+}
+
+static void
+pipeline_free_state(wtap_read_pipeline *p)
+{
+    if (p->ops.free_state != NULL && p->ops.state != NULL)
+        p->ops.free_state(p->ops.state);
+    p->ops.state = NULL;
+}
+
+static void
+pipeline_recycle(wtap_read_pipeline *p, pipeline_batch *batch)
+{
+    guint i;
+
+    /* Comments of records that were returned belong to the caller. */
+    for (i = 0; i < batch->num_recs; i++) {
+        g_free(batch->recs[i].rec.opt_comment);
+        batch->recs[i].rec.opt_comment = NULL;
+    }
+    g_async_queue_push(p->free_q, batch);
+}
+
+/* Get the next batch in the order in which they were read. */
+static pipeline_batch *
+pipeline_next_batch(wtap_read_pipeline *p)
+{
+    guint slot = (guint)(p->next_seq % p->num_batches);
+    pipeline_batch *batch;
+
+    while (p->pending[slot] == NULL) {
+        batch = (pipeline_batch *)g_async_queue_pop(p->done_q);
+        p->pending[batch->seq % p->num_batches] = batch;
+    }
+    batch = p->pending[slot];
+    p->pending[slot] = NULL;
+    p->next_seq++;
+    if (batch->last)
+        p->running = FALSE;
+    return batch;
+}
+
+/* Stop the reader, throwing away everything it's read ahead. */
+static void
+pipeline_drain(wtap_read_pipeline *p)
+{
+    pipeline_batch *batch;
+
+    if (p->cur != NULL) {
+        pipeline_recycle(p, p->cur);
+        p->cur = NULL;
+    }
+    if (!p->running)
+        return;
+
+    g_atomic_int_set(&p->cancel, 1);
+    do {
+        batch = pipeline_next_batch(p);
+        pipeline_recycle(p, batch);
+    } while (p->running);
+    g_atomic_int_set(&p->cancel, 0);
+}
+
+/* Start the reader again from the current position. */
+static void
+pipeline_resume(wtap_read_pipeline *p)
+{
+    wtap *wth = p->wth;
+
+    if (!wth->subtype_read_pipeline(wth, &p->ops)) {
+        p->done = TRUE;
+        return;
+    }
+    p->file_encap = wth->file_encap;
+    p->file_tsprec = wth->file_tsprec;
+    p->running = TRUE;
+    g_async_queue_push(p->resume_q, PIPELINE_RESUME);
+}
+
+/*
+ * Read the record at offset with the usual read routine.  The reader
+ * must be stopped, so that the sequential stream is ours.
+ */
+static gboolean
+pipeline_read_usual(wtap_read_pipeline *p, gint64 offset, int *err,
+                    gchar **err_info, gint64 *data_offset)
+{
+    wtap *wth = p->wth;
+
+    pipeline_free_state(p);
+    if (file_seek(wth->fh, offset, SEEK_SET, err) == -1 ||
+        !wth->subtype_read(wth, err, err_info, data_offset)) {
+        /* That's the end; don't bother starting again. */
+        p->done = TRUE;
+        return FALSE;
+    }
+    p->tell = file_tell(wth->fh);
+    p->so_far = file_tell_raw(wth->fh);
+    pipeline_resume(p);
+    return TRUE;
+}
+
+gboolean
+read_pipeline_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
+{
+    wtap_read_pipeline *p = wth->read_pipeline;
+    pipeline_record *r;
+    Buffer options_buf;
+    gint64 offset;
+
+    if (p->done)
+        return wth->subtype_read(wth, err, err_info, data_offset);
+
+    /* The previous record's data may be in a batch we're about to give
+       back to the reader. */
+    if (wth->rec_data->allocated == 0)
+        ws_buffer_borrow(wth->rec_data, NULL, 0);
+
+    while (p->cur == NULL || p->cur_rec >= p->cur->num_recs) {
+        if (p->cur != NULL) {
+            /* The previous call returned this batch's last record, so
+               we're done with it. */
+            if (p->cur->last) {
+                offset = p->cur->stop_offset;
+                pipeline_drain(p);
+                return pipeline_read_usual(p, offset, err, err_info,
+                                           data_offset);
+            }
+            pipeline_recycle(p, p->cur);
+        }
+        p->cur = pipeline_next_batch(p);
+        p->cur_rec = 0;
+        p->so_far = p->cur->raw_end;
+    }
+
+    r = &p->cur->recs[p->cur_rec];
+    if (!r->decoded) {
+        offset = r->offset;
+        pipeline_drain(p);
+        return pipeline_read_usual(p, offset, err, err_info, data_offset);
+    }
+
+    /* The options buffer is only used by the readers. */
+    options_buf = wth->rec.options_buf;
+    wth->rec = r->rec;
+    wth->rec.options_buf = options_buf;
+    r->rec.opt_comment = NULL;
+    ws_buffer_borrow(wth->rec_data,
+                     r->buf.data != NULL ? ws_buffer_start_ptr(&r->buf) :
+                                           p->cur->data + r->data_off,
+                     ws_buffer_length(&r->buf));
+    *data_offset = r->offset;
+    p->tell = r->offset + r->len;
+    p->cur_rec++;
+    return TRUE;
+}
+
+gint64
+read_pipeline_so_far(wtap *wth)
+{
+    wtap_read_pipeline *p = wth->read_pipeline;
+
+    return p->done ? file_tell_raw(wth->fh) : p->so_far;
+}
+
+gint64
+read_pipeline_tell(wtap *wth)
+{
+    wtap_read_pipeline *p = wth->read_pipeline;
+
+    return p->done ? file_tell(wth->fh) : p->tell;
+}
+
+void
+read_pipeline_stop(wtap *wth)
+{
+    wtap_read_pipeline *p = wth->read_pipeline;
+    pipeline_record *r;
+    guint i, j;
+
+    if (p == NULL)
+        return;
+
+    pipeline_drain(p);
+    g_async_queue_push(p->resume_q, PIPELINE_QUIT);
+    g_thread_join(p->reader);
+    for (i = 0; i < p->num_workers; i++)
+        g_async_queue_push(p->work_q, p);
+    for (i = 0; i < p->num_workers; i++)
+        g_thread_join(p->workers[i]);
+    pipeline_free_state(p);
+
+    for (i = 0; i < p->num_batches; i++) {
+        for (j = 0; j < PIPELINE_BATCH_RECORDS; j++) {
+            r = &p->batches[i].recs[j];
+            pipeline_buffer_release(&r->buf);
+            pipeline_buffer_release(&r->rec.options_buf);
+        }
+        g_free(p->batches[i].data);
+    }
+    g_async_queue_unref(p->free_q);
+    g_async_queue_unref(p->work_q);
+    g_async_queue_unref(p->done_q);
+    g_async_queue_unref(p->resume_q);
+    g_free(p->workers);
+    g_free(p->pending);
+    g_free(p->batches);
+    g_free(p);
+    wth->read_pipeline = NULL;
+}
+
+static guint
+pipeline_default_threads(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+    guint num_processors = g_get_num_processors();
+
+    /* Leave a processor for whoever's calling wtap_read(). */
+    return num_processors > 2 ? num_processors - 1 : 1;
+#else
+    return 2;
+#endif
+}
+
+gboolean
+wtap_start_read_pipeline(wtap *wth, guint num_threads)
+{
+    wtap_read_pipeline *p;
+    wtap_pipeline_ops ops;
+    guint i;
+
+    if (wth->read_pipeline != NULL)
+        return TRUE;
+    if (wth->fh == NULL || wth->ispipe || wth->subtype_read_pipeline == NULL)
+        return FALSE;
+
+    /*
+     * Reading a compressed file adds fast seek points to the list the
+     * random-access stream uses, so we can't read one on another thread
+     * if it might be read at random at the same time.
+     */
+    if (file_iscompressed(wth->fh) && wth->random_fh != NULL)
+        return FALSE;
+
+    if (!wth->subtype_read_pipeline(wth, &ops))
+        return FALSE;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+#   if !GLIB_CHECK_VERSION(2,24,0)
+    if (!g_thread_get_initialized())
+#   endif
+        g_thread_init(NULL);
+#endif
+
+    if (num_threads == 0)
+        num_threads = pipeline_default_threads();
+    num_threads = MIN(num_threads, PIPELINE_MAX_THREADS);
+
+    p = g_new0(wtap_read_pipeline, 1);
+    p->wth = wth;
+    p->ops = ops;
+    p->file_encap = wth->file_encap;
+    p->file_tsprec = wth->file_tsprec;
+    p->num_batches = num_threads * PIPELINE_BATCHES_PER_THREAD + 2;
+    p->batches = g_new0(pipeline_batch, p->num_batches);
+    p->pending = g_new0(pipeline_batch *, p->num_batches);
+    p->free_q = g_async_queue_new();
+    p->work_q = g_async_queue_new();
+    p->done_q = g_async_queue_new();
+    p->resume_q = g_async_queue_new();
+    for (i = 0; i < p->num_batches; i++)
+        g_async_queue_push(p->free_q, &p->batches[i]);
+    p->tell = file_tell(wth->fh);
+    p->so_far = file_tell_raw(wth->fh);
+
+    p->reader = g_thread_new("wtap read-ahead", pipeline_reader, p);
+    p->num_workers = num_threads;
+    p->workers = g_new(GThread *, num_threads);
+    for (i = 0; i < num_threads; i++)
+        p->workers[i] = g_thread_new("wtap decode", pipeline_worker, p);
+
+    wth->read_pipeline = p;
+    p->running = TRUE;
+    g_async_queue_push(p->resume_q, PIPELINE_RESUME);
+    return TRUE;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
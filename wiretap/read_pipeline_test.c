@@ -0,0 +1,433 @@
+/* read_pipeline_test.c
+ * Tests that decoding records on a pipeline of threads reads a file the
+ * same way as reading it serially
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "wtap.h"
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+/*
+ * The test files are native-byte-order pcap and pcapng files of Ethernet
+ * packets. Packet i has the time stamp 1000000000 + i seconds, a length
+ * that varies from one packet to the next, and byte j of it is
+ * (i * 7 + j), so that every packet can be told apart. There are enough
+ * of them to fill several of the pipeline's batches.
+ */
+#define NUM_PACKETS         2000
+#define PACKET_LEN(i)       (40 + (guint32)(i) * 37 % 1400)
+#define BAD_PACKET          1500
+
+typedef enum {
+    PIPELINE_TEST_GOOD,
+    PIPELINE_TEST_BAD_RECORD,   /* packet BAD_PACKET has a bogus length */
+    PIPELINE_TEST_TRUNCATED     /* the last packet is cut short */
+} pipeline_test_file;
+
+static void
+append_u16(GByteArray *file, guint16 val)
+{
+    g_byte_array_append(file, (const guint8 *)&val, sizeof val);
+}
+
+static void
+append_u32(GByteArray *file, guint32 val)
+{
+    g_byte_array_append(file, (const guint8 *)&val, sizeof val);
+}
+
+static void
+append_packet_data(GByteArray *file, guint i)
+{
+    guint32 j;
+    guint8 byte;
+
+    for (j = 0; j < PACKET_LEN(i); j++) {
+        byte = (guint8)(i * 7 + j);
+        g_byte_array_append(file, &byte, 1);
+    }
+}
+
+static char *
+temp_capture(const char *tmpl)
+{
+    GError *error = NULL;
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp(tmpl, &path, &error);
+    g_assert_no_error(error);
+    ws_close(fd);
+    return path;
+}
+
+static void
+save_capture(const char *path, GByteArray *file, pipeline_test_file kind)
+{
+    GError *error = NULL;
+    gssize len = (gssize)file->len;
+
+    if (kind == PIPELINE_TEST_TRUNCATED)
+        len -= PACKET_LEN(NUM_PACKETS - 1) / 2;
+    g_file_set_contents(path, (const gchar *)file->data, len, &error);
+    g_assert_no_error(error);
+    g_byte_array_free(file, TRUE);
+}
+
+static char *
+write_pcap(pipeline_test_file kind)
+{
+    char *path = temp_capture("wtap_rp_XXXXXX.pcap");
+    GByteArray *file = g_byte_array_new();
+    guint32 caplen;
+    guint i;
+
+    append_u32(file, 0xa1b2c3d4);
+    append_u16(file, 2);
+    append_u16(file, 4);
+    append_u32(file, 0);
+    append_u32(file, 0);
+    append_u32(file, 65535);
+    append_u32(file, 1);
+    for (i = 0; i < NUM_PACKETS; i++) {
+        caplen = PACKET_LEN(i);
+        if (kind == PIPELINE_TEST_BAD_RECORD && i == BAD_PACKET)
+            caplen = 0x00ffffff;
+        append_u32(file, 1000000000 + i);
+        append_u32(file, i);
+        append_u32(file, caplen);
+        append_u32(file, PACKET_LEN(i));
+        append_packet_data(file, i);
+    }
+    save_capture(path, file, kind);
+    return path;
+}
+
+static void
+append_pcapng_idb(GByteArray *file)
+{
+    append_u32(file, 0x00000001);
+    append_u32(file, 20);
+    append_u16(file, 1);
+    append_u16(file, 0);
+    append_u32(file, 65535);
+    append_u32(file, 20);
+}
+
+/*
+ * A pcapng file with a second interface added half way through, which
+ * the pipeline has to stop for.
+ */
+static char *
+write_pcapng(pipeline_test_file kind)
+{
+    char *path = temp_capture("wtap_rp_XXXXXX.pcapng");
+    GByteArray *file = g_byte_array_new();
+    guint64 ts;
+    guint32 padded_len, block_len, caplen;
+    guint i, j;
+    guint8 pad = 0;
+
+    append_u32(file, 0x0a0d0d0a);
+    append_u32(file, 28);
+    append_u32(file, 0x1a2b3c4d);
+    append_u16(file, 1);
+    append_u16(file, 0);
+    append_u32(file, 0xffffffff);
+    append_u32(file, 0xffffffff);
+    append_u32(file, 28);
+    append_pcapng_idb(file);
+    for (i = 0; i < NUM_PACKETS; i++) {
+        if (i == NUM_PACKETS / 2)
+            append_pcapng_idb(file);
+        padded_len = (PACKET_LEN(i) + 3) & ~3U;
+        block_len = 32 + padded_len;
+        caplen = PACKET_LEN(i);
+        if (kind == PIPELINE_TEST_BAD_RECORD && i == BAD_PACKET)
+            caplen = 0x00ffffff;
+        ts = (guint64)(1000000000 + i) * 1000000 + i;
+        append_u32(file, 0x00000006);
+        append_u32(file, block_len);
+        append_u32(file, i < NUM_PACKETS / 2 ? 0 : 1);
+        append_u32(file, (guint32)(ts >> 32));
+        append_u32(file, (guint32)ts);
+        append_u32(file, caplen);
+        append_u32(file, PACKET_LEN(i));
+        append_packet_data(file, i);
+        for (j = PACKET_LEN(i); j < padded_len; j++)
+            g_byte_array_append(file, &pad, 1);
+        append_u32(file, block_len);
+    }
+    save_capture(path, file, kind);
+    return path;
+}
+
+static void
+remove_capture(char *path)
+{
+    g_unlink(path);
+    g_free(path);
+}
+
+static wtap *
+open_capture(const char *path)
+{
+    wtap *wth;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    return wth;
+}
+
+static void
+compare_recs(const wtap_rec *serial, const guint8 *serial_data,
+             const wtap_rec *pipelined, const guint8 *pipelined_data)
+{
+    g_assert(serial->rec_type == pipelined->rec_type);
+    g_assert(serial->presence_flags == pipelined->presence_flags);
+    g_assert(serial->ts.secs == pipelined->ts.secs);
+    g_assert(serial->ts.nsecs == pipelined->ts.nsecs);
+    g_assert(serial->tsprec == pipelined->tsprec);
+    g_assert(serial->rec_header.packet_header.caplen == pipelined->rec_header.packet_header.caplen);
+    g_assert(serial->rec_header.packet_header.len == pipelined->rec_header.packet_header.len);
+    g_assert(serial->rec_header.packet_header.pkt_encap == pipelined->rec_header.packet_header.pkt_encap);
+    g_assert(serial->rec_header.packet_header.interface_id == pipelined->rec_header.packet_header.interface_id);
+    g_assert(memcmp(serial_data, pipelined_data, serial->rec_header.packet_header.caplen) == 0);
+}
+
+/* Check that a packet that was read is the one we wrote. */
+static void
+check_packet(const wtap_rec *rec, const guint8 *data, guint i)
+{
+    guint32 j;
+
+    g_assert(rec->ts.secs == 1000000000 + i);
+    g_assert(rec->rec_header.packet_header.caplen == PACKET_LEN(i));
+    for (j = 0; j < PACKET_LEN(i); j++)
+        g_assert(data[j] == (guint8)(i * 7 + j));
+}
+
+static void
+seek_read_both(wtap *serial, wtap *pipelined, gint64 offset, guint i)
+{
+    wtap_rec serial_rec, pipelined_rec;
+    Buffer serial_buf, pipelined_buf;
+    int err;
+    gchar *err_info = NULL;
+
+    wtap_rec_init(&serial_rec);
+    wtap_rec_init(&pipelined_rec);
+    ws_buffer_init(&serial_buf, 1500);
+    ws_buffer_init(&pipelined_buf, 1500);
+    g_assert(wtap_seek_read(serial, offset, &serial_rec, &serial_buf, &err, &err_info));
+    g_assert(wtap_seek_read(pipelined, offset, &pipelined_rec, &pipelined_buf, &err, &err_info));
+    compare_recs(&serial_rec, ws_buffer_start_ptr(&serial_buf),
+                 &pipelined_rec, ws_buffer_start_ptr(&pipelined_buf));
+    check_packet(&pipelined_rec, ws_buffer_start_ptr(&pipelined_buf), i);
+    ws_buffer_free(&serial_buf);
+    ws_buffer_free(&pipelined_buf);
+    wtap_rec_cleanup(&serial_rec);
+    wtap_rec_cleanup(&pipelined_rec);
+}
+
+/*
+ * Read the file serially and on a pipeline, side by side, and check
+ * that every record, offset and error is the same. If seek_every isn't
+ * 0, an earlier record is read at random after every seek_every records.
+ * Returns the number of records read; the error is returned in *err.
+ */
+static guint
+compare_reads(const char *path, guint num_threads, guint seek_every,
+              int *err)
+{
+    wtap *serial = open_capture(path);
+    wtap *pipelined = open_capture(path);
+    gint64 *offsets = g_new(gint64, NUM_PACKETS);
+    gint64 serial_offset, pipelined_offset;
+    gchar *serial_err_info, *pipelined_err_info;
+    int serial_err, pipelined_err;
+    gboolean serial_ok, pipelined_ok;
+    guint i;
+
+    g_assert(wtap_start_read_pipeline(pipelined, num_threads));
+
+    for (i = 0; ; i++) {
+        serial_err_info = NULL;
+        pipelined_err_info = NULL;
+        serial_ok = wtap_read(serial, &serial_err, &serial_err_info, &serial_offset);
+        pipelined_ok = wtap_read(pipelined, &pipelined_err, &pipelined_err_info, &pipelined_offset);
+        g_assert(serial_ok == pipelined_ok);
+        if (!serial_ok)
+            break;
+
+        g_assert(i < NUM_PACKETS);
+        g_assert(serial_offset == pipelined_offset);
+        g_assert(wtap_read_so_far(pipelined) >= pipelined_offset);
+        compare_recs(wtap_get_rec(serial), wtap_get_buf_ptr(serial),
+                     wtap_get_rec(pipelined), wtap_get_buf_ptr(pipelined));
+        check_packet(wtap_get_rec(pipelined), wtap_get_buf_ptr(pipelined), i);
+        offsets[i] = pipelined_offset;
+
+        if (seek_every != 0 && i % seek_every == seek_every - 1) {
+            seek_read_both(serial, pipelined, offsets[i / 2], i / 2);
+            /* The record we just read must still be there. */
+            check_packet(wtap_get_rec(pipelined), wtap_get_buf_ptr(pipelined), i);
+        }
+    }
+    g_assert(serial_err == pipelined_err);
+    g_assert_cmpstr(serial_err_info, ==, pipelined_err_info);
+    g_free(serial_err_info);
+    g_free(pipelined_err_info);
+    *err = pipelined_err;
+
+    if (pipelined_err == 0) {
+        g_assert(wtap_read_so_far(serial) == wtap_read_so_far(pipelined));
+
+        /* Reading at the end of the file is the same the second time. */
+        serial_err_info = NULL;
+        pipelined_err_info = NULL;
+        g_assert(!wtap_read(serial, &serial_err, &serial_err_info, &serial_offset));
+        g_assert(!wtap_read(pipelined, &pipelined_err, &pipelined_err_info, &pipelined_offset));
+        g_assert(serial_err == 0);
+        g_assert(pipelined_err == 0);
+    }
+
+    /* Records that were read can be read again at random afterwards. */
+    if (i > 0) {
+        seek_read_both(serial, pipelined, offsets[0], 0);
+        seek_read_both(serial, pipelined, offsets[i - 1], i - 1);
+    }
+
+    g_free(offsets);
+    wtap_close(serial);
+    wtap_close(pipelined);
+    return i;
+}
+
+static void
+read_pipeline_test_pcap(void)
+{
+    char *path = write_pcap(PIPELINE_TEST_GOOD);
+    int err;
+
+    g_assert(compare_reads(path, 1, 0, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    g_assert(compare_reads(path, 4, 0, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    remove_capture(path);
+}
+
+static void
+read_pipeline_test_pcapng(void)
+{
+    char *path = write_pcapng(PIPELINE_TEST_GOOD);
+    int err;
+
+    g_assert(compare_reads(path, 1, 0, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    g_assert(compare_reads(path, 4, 0, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    remove_capture(path);
+}
+
+/* Errors are reported after the same records, with the same message. */
+static void
+read_pipeline_test_bad_record(void)
+{
+    char *path;
+    int err;
+
+    path = write_pcap(PIPELINE_TEST_BAD_RECORD);
+    g_assert(compare_reads(path, 4, 0, &err) == BAD_PACKET);
+    g_assert(err == WTAP_ERR_BAD_FILE);
+    remove_capture(path);
+
+    path = write_pcapng(PIPELINE_TEST_BAD_RECORD);
+    g_assert(compare_reads(path, 4, 0, &err) == BAD_PACKET);
+    g_assert(err == WTAP_ERR_BAD_FILE);
+    remove_capture(path);
+}
+
+static void
+read_pipeline_test_short_read(void)
+{
+    char *path;
+    int err;
+
+    path = write_pcap(PIPELINE_TEST_TRUNCATED);
+    g_assert(compare_reads(path, 4, 0, &err) == NUM_PACKETS - 1);
+    g_assert(err == WTAP_ERR_SHORT_READ);
+    remove_capture(path);
+
+    path = write_pcapng(PIPELINE_TEST_TRUNCATED);
+    g_assert(compare_reads(path, 4, 0, &err) == NUM_PACKETS - 1);
+    g_assert(err == WTAP_ERR_SHORT_READ);
+    remove_capture(path);
+}
+
+/* Random reads between sequential ones don't disturb the pipeline. */
+static void
+read_pipeline_test_seek_read(void)
+{
+    char *path;
+    int err;
+
+    path = write_pcap(PIPELINE_TEST_GOOD);
+    g_assert(compare_reads(path, 4, 7, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    remove_capture(path);
+
+    path = write_pcapng(PIPELINE_TEST_GOOD);
+    g_assert(compare_reads(path, 4, 7, &err) == NUM_PACKETS);
+    g_assert(err == 0);
+    remove_capture(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+    wtap_init(FALSE);
+
+    g_test_add_func("/wiretap/read_pipeline/pcap",       read_pipeline_test_pcap);
+    g_test_add_func("/wiretap/read_pipeline/pcapng",     read_pipeline_test_pcapng);
+    g_test_add_func("/wiretap/read_pipeline/bad_record", read_pipeline_test_bad_record);
+    g_test_add_func("/wiretap/read_pipeline/short_read", read_pipeline_test_short_read);
+    g_test_add_func("/wiretap/read_pipeline/seek_read",  read_pipeline_test_seek_read);
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
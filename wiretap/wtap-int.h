@@ -28,6 +28,34 @@ typedef gboolean (*subtype_read_func)(struct wtap*, int*, char**, gint64*);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64, wtap_rec *,
                                            Buffer *, int *, char **);
 
+/**
+ * What the read pipeline needs in order to split a file into records on
+ * one thread and decode them on others.  record_len() is called with the
+ * first header_len bytes of a block and returns the length of the block,
+ * or 0 if the block isn't a record that can be decoded on its own, in
+ * which case the pipeline stops and the block is read with the usual
+ * subtype_read routine.  decode() reads the record from a stream over
+ * the block's bytes; it may be called on several threads at once, so it
+ * must not change the state or the wtap.
+ */
+typedef struct {
+    guint       header_len;
+    guint32     (*record_len)(const void *state, const guint8 *header);
+    gboolean    (*decode)(struct wtap *wth, void *state, FILE_T fh,
+                          wtap_rec *rec, Buffer *buf, int *err,
+                          gchar **err_info);
+    void        (*free_state)(void *state);
+    void        *state;
+} wtap_pipeline_ops;
+
+/**
+ * Fill in the pipeline operations for the file's current position, or
+ * return FALSE if records can't be decoded ahead of time from here.
+ */
+typedef gboolean (*subtype_read_pipeline_func)(struct wtap*, wtap_pipeline_ops *);
+
+struct wtap_read_pipeline;
+
 /**
  * Struct holding data of the currently read file.
  */
@@ -48,6 +76,7 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_read_pipeline_func  subtype_read_pipeline;  /**< NULL if records can't be decoded ahead */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -69,6 +98,7 @@ struct wtap {
     wtap_new_ipv4_callback_t    add_new_ipv4;
     wtap_new_ipv6_callback_t    add_new_ipv6;
     GPtrArray                   *fast_seek;
+    struct wtap_read_pipeline   *read_pipeline;         /**< NULL unless records are being decoded ahead */
 };
 
 struct wtap_dumper;
@@ -88,7 +118,7 @@ struct wtap_dumper {
     int                     file_type_subtype;
     int                     snaplen;
     int                     encap;
-    gboolean                compressed;
+    wtap_compression_type   compression_type;
     gboolean                needs_reload;   /* TRUE if the file requires re-loading after saving with wtap */
     gint64                  bytes_dumped;
 
@@ -309,6 +339,44 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Like wtap_read_packet_bytes(), but, if the file is memory-mapped,
+ * make the Buffer refer to the packet data in the mapping rather than
+ * copying it.  The data remains valid until the file is closed; the
+ * caller must not modify it in place, as it would stay modified if
+ * the packet is read again.
+ */
+WS_DLL_PUBLIC
+gboolean
+wtap_read_packet_bytes_in_place(FILE_T fh, Buffer *buf, guint length,
+    int *err, gchar **err_info);
+
+/*
+ * Return the offset just past the last record wtap_read() returned,
+ * which is where the sequential stream would be if records weren't
+ * being decoded ahead.
+ */
+gint64
+wtap_read_tell(wtap *wth);
+
+/*
+ * The read pipeline, in read_pipeline.c.  While one is running,
+ * wtap_read() gets records from read_pipeline_read() rather than
+ * from the subtype_read routine.
+ */
+gboolean
+read_pipeline_read(wtap *wth, int *err, gchar **err_info,
+    gint64 *data_offset);
+
+gint64
+read_pipeline_so_far(wtap *wth);
+
+gint64
+read_pipeline_tell(wtap *wth);
+
+void
+read_pipeline_stop(wtap *wth);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
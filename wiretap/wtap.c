@@ -85,6 +85,12 @@ wtap_iscompressed(wtap *wth)
 	return file_iscompressed((wth->fh == NULL) ? wth->random_fh : wth->fh);
 }
 
+wtap_compression_type
+wtap_get_compression_type(wtap *wth)
+{
+	return file_get_compression_type((wth->fh == NULL) ? wth->random_fh : wth->fh);
+}
+
 guint
 wtap_snapshot_length(wtap *wth)
 {
@@ -1137,6 +1143,8 @@ wtap_strerror(int err)
 void
 wtap_sequential_close(wtap *wth)
 {
+	read_pipeline_stop(wth);
+
 	if (wth->subtype_sequential_close != NULL)
 		(*wth->subtype_sequential_close)(wth);
 
@@ -1204,6 +1212,25 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_shm_ring(wtap *wth, ws_shm_ring_t *ring)
+{
+	/* The read pipeline reads the file on a thread of its own. */
+	if (wth->read_pipeline != NULL)
+		return;
+	file_set_shm_ring(wth->fh, ring);
+}
+
+void
+wtap_set_growing(wtap *wth)
+{
+	/* The read pipeline reads the file on a thread of its own. */
+	if (wth->fh != NULL && wth->read_pipeline == NULL)
+		file_set_growing(wth->fh);
+	if (wth->random_fh != NULL)
+		file_set_growing(wth->random_fh);
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -1217,6 +1244,8 @@ void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6) {
 gboolean
 wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 {
+	gboolean ok;
+
 	/*
 	 * Set the packet encapsulation to the file's encapsulation
 	 * value; if that's not WTAP_ENCAP_PER_PACKET, it's the
@@ -1232,7 +1261,11 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 
 	*err = 0;
 	*err_info = NULL;
-	if (!wth->subtype_read(wth, err, err_info, data_offset)) {
+	if (wth->read_pipeline != NULL)
+		ok = read_pipeline_read(wth, err, err_info, data_offset);
+	else
+		ok = wth->subtype_read(wth, err, err_info, data_offset);
+	if (!ok) {
 		/*
 		 * If we didn't get an error indication, we read
 		 * the last packet.  See if there's any deferred
@@ -1344,11 +1377,32 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info)
 {
+	/*
+	 * Don't copy data the buffer borrowed from a memory-mapped
+	 * file; we're about to overwrite it.
+	 */
+	if (buf->allocated == 0)
+		ws_buffer_clean(buf);
 	ws_buffer_assure_space(buf, length);
 	return wtap_read_bytes(fh, ws_buffer_start_ptr(buf), length, err,
 	    err_info);
 }
 
+gboolean
+wtap_read_packet_bytes_in_place(FILE_T fh, Buffer *buf, guint length,
+    int *err, gchar **err_info)
+{
+	const guint8 *ptr;
+
+	ptr = file_read_ptr(length, fh);
+	if (ptr == NULL) {
+		/* Not memory-mapped, or not all there; just read it. */
+		return wtap_read_packet_bytes(fh, buf, length, err, err_info);
+	}
+	ws_buffer_borrow(buf, (guint8 *)ptr, length);
+	return TRUE;
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1356,9 +1410,19 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 gint64
 wtap_read_so_far(wtap *wth)
 {
+	if (wth->read_pipeline != NULL)
+		return read_pipeline_so_far(wth);
 	return file_tell_raw(wth->fh);
 }
 
+gint64
+wtap_read_tell(wtap *wth)
+{
+	if (wth->read_pipeline != NULL)
+		return read_pipeline_tell(wth);
+	return file_tell(wth->fh);
+}
+
 wtap_rec *
 wtap_get_rec(wtap *wth)
 {
@@ -13,6 +13,7 @@
 #include <wsutil/buffer.h>
 #include <wsutil/nstime.h>
 #include <wsutil/inet_addr.h>
+#include <wsutil/shm_ring.h>
 #include "wtap_opttypes.h"
 #include "ws_symbol_export.h"
 #include "ws_attributes.h"
@@ -1620,6 +1621,28 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * Read a file that dumpcap is writing through a capture ring from the
+ * ring where it still holds the data, rather than from the file.
+ *
+ * @param wth The wtap handle of the file.
+ * @param ring The ring, or NULL to stop using it. It must stay valid
+ * until it's been set to NULL or the file has been closed.
+ */
+WS_DLL_PUBLIC
+void wtap_set_shm_ring(wtap *wth, ws_shm_ring_t *ring);
+
+/**
+ * Note that a file is still being written, or may otherwise change, while
+ * it's being read, as when it's a live capture being read as it arrives.
+ * Such a file is read rather than memory-mapped, as a mapped file that
+ * shrinks makes touching the mapping fatal.
+ *
+ * @param wth The wtap handle of the file.
+ */
+WS_DLL_PUBLIC
+void wtap_set_growing(wtap *wth);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -1639,6 +1662,24 @@ WS_DLL_PUBLIC
 gboolean wtap_read(wtap *wth, int *err, gchar **err_info,
     gint64 *data_offset);
 
+/** Decode the records of the file on other threads, ahead of wtap_read().
+ *
+ * The records wtap_read() returns, and the errors it reports, are the
+ * same as they would otherwise be; only the work of decoding them is
+ * moved.  This is currently supported only for pcap and pcapng files
+ * that aren't being read from a pipe.  It should be called before the
+ * first call to wtap_read(), and lasts until wtap_sequential_close()
+ * or wtap_close().
+ *
+ * @param wth The file
+ * @param num_threads The number of threads to decode on, or 0 for one
+ *   fewer than the number of processors
+ * @return TRUE if records are being decoded ahead, FALSE if they'll be
+ *   read as usual
+ */
+WS_DLL_PUBLIC
+gboolean wtap_start_read_pipeline(wtap *wth, guint num_threads);
+
 WS_DLL_PUBLIC
 gboolean wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
     Buffer *buf, int *err, gchar **err_info);
@@ -1810,6 +1851,53 @@ WS_DLL_PUBLIC
 void wtap_close(wtap *wth);
 
 /*** dump packets into a capture file ***/
+
+/**
+ * Types of compression for a capture file, including none.
+ */
+typedef enum {
+    WTAP_UNCOMPRESSED,
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,
+    WTAP_LZ4_COMPRESSED
+} wtap_compression_type;
+
+/**
+ * Return the type of compression implied by the extension of a file
+ * name (".gz", ".zst" or ".lz4"), or WTAP_UNCOMPRESSED if it has none
+ * of those extensions.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_name_to_compression_type(const char *filename);
+
+/**
+ * Return the type of compression of the file being read, or
+ * WTAP_UNCOMPRESSED if it isn't compressed.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_get_compression_type(wtap *wth);
+
+/**
+ * Return a description of a type of compression, such as "gzip", for
+ * showing to the user, or NULL for WTAP_UNCOMPRESSED.
+ */
+WS_DLL_PUBLIC
+const char *wtap_compression_type_description(wtap_compression_type compression_type);
+
+/**
+ * Return the file name extension, without the leading ".", for a type
+ * of compression, or NULL for WTAP_UNCOMPRESSED.
+ */
+WS_DLL_PUBLIC
+const char *wtap_compression_type_extension(wtap_compression_type compression_type);
+
+/**
+ * Return TRUE if we can write files with this type of compression,
+ * FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_open(int filetype);
 
@@ -1843,7 +1931,7 @@ gboolean wtap_dump_supports_comment_types(int filetype, guint32 comment_types);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, int *err);
+    int snaplen, wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Opens a new capture file for writing.
@@ -1856,7 +1944,7 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1865,12 +1953,12 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+    int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     int *err);
 
 /**
@@ -1886,7 +1974,7 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1895,13 +1983,13 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for an existing file descriptor.
@@ -1914,7 +2002,7 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1923,12 +2011,12 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for the standard output.
@@ -1940,7 +2028,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1949,7 +2037,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
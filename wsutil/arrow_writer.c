@@ -0,0 +1,1038 @@
+/* arrow_writer.c
+ * Writes record batches in the Apache Arrow IPC streaming format
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "arrow_writer.h"
+
+/*
+ * The stream is a sequence of messages, each of which is a FlatBuffers
+ * encoded header, as described by Message.fbs and Schema.fbs in the
+ * Arrow source, followed by a body that holds the buffers of the
+ * columns. The first message is the schema. See
+ *
+ *	https://arrow.apache.org/docs/format/Columnar.html
+ *
+ * We encode the headers ourselves rather than depend on the Arrow or
+ * FlatBuffers libraries.
+ */
+
+/* MetadataVersion.V5 */
+#define METADATA_VERSION	4
+
+/* MessageHeader union */
+#define HEADER_SCHEMA		1
+#define HEADER_DICTIONARY_BATCH	2
+#define HEADER_RECORD_BATCH	3
+
+/* Type union */
+#define TYPE_INT		2
+#define TYPE_FLOATING_POINT	3
+#define TYPE_BINARY		4
+#define TYPE_UTF8		5
+#define TYPE_BOOL		6
+#define TYPE_TIMESTAMP		10
+#define TYPE_LIST		12
+#define TYPE_FIXED_SIZE_BINARY	15
+#define TYPE_DURATION		18
+
+#define PRECISION_SINGLE	1
+#define PRECISION_DOUBLE	2
+#define TIME_UNIT_NANOSECOND	3
+
+#define CONTINUATION_MARKER	0xFFFFFFFFU
+
+/* Buffers in a message body are padded to a multiple of this. */
+#define BODY_ALIGNMENT		8
+#define BODY_ALIGN(len)		(((len) + BODY_ALIGNMENT - 1) & ~(gsize)(BODY_ALIGNMENT - 1))
+
+#define FB_MAX_SLOTS		8
+
+/*
+ * A minimal FlatBuffers builder. As with the real one, the buffer is
+ * built from the end towards the start, so that objects are written
+ * before the objects that refer to them, and an object's "offset" is
+ * its distance from the end of the buffer.
+ */
+typedef struct {
+	guint8	*buf;
+	gsize	 size;
+	gsize	 head;				/* bytes used at the end of buf */
+	gsize	 minalign;
+	guint32	 slots[FB_MAX_SLOTS];		/* fields of the current table */
+	int	 num_slots;
+	guint32	 object_start;
+} fb_builder_t;
+
+typedef struct {
+	const guint8 *data;
+	gsize	 len;
+} body_buffer_t;
+
+typedef struct {
+	gchar		*name;
+	arrow_type_e	 type;
+	int		 byte_width;		/* of a value, if it has a fixed width */
+	gboolean	 list;
+	gint64		 dict_id;
+
+	/* The current batch */
+	GByteArray	*validity;		/* of the rows */
+	guint		 null_count;
+	GByteArray	*list_offsets;
+	GByteArray	*values;		/* values, bits, binary data or dictionary indices */
+	GByteArray	*value_offsets;		/* of binary values */
+	guint		 num_values;
+	guint		 row_values;		/* values in the current row */
+
+	/* The current batch's dictionary */
+	GByteArray	*dict_data;
+	GByteArray	*dict_offsets;
+	guint32		*dict_slots;		/* open addressing, string index + 1 */
+	guint32		 dict_mask;
+	guint32		 dict_count;
+} arrow_column_t;
+
+struct arrow_writer {
+	FILE		*fh;
+	guint		 batch_rows;
+	gsize		 batch_bytes;
+	GArray		*columns;
+	gboolean	 schema_written;
+	guint		 num_rows;		/* in the current batch */
+	gsize		 num_bytes;		/* approximate size of the current batch */
+
+	fb_builder_t	 fb;
+	GArray		*nodes;			/* FieldNode structs, as pairs of gint64 */
+	GArray		*buffers;		/* Buffer structs, as pairs of gint64 */
+	GArray		*body;			/* body_buffer_t */
+	gint64		 body_len;
+};
+
+static void
+fb_reset(fb_builder_t *fb)
+{
+	fb->head = 0;
+	fb->minalign = 1;
+}
+
+static void
+fb_grow(fb_builder_t *fb, gsize needed)
+{
+	gsize new_size;
+	guint8 *new_buf;
+
+	if (fb->head + needed <= fb->size)
+		return;
+
+	new_size = MAX(fb->size * 2, 1024);
+	while (new_size < fb->head + needed)
+		new_size *= 2;
+	new_buf = (guint8 *)g_malloc(new_size);
+	if (fb->head > 0)
+		memcpy(new_buf + new_size - fb->head, fb->buf + fb->size - fb->head, fb->head);
+	g_free(fb->buf);
+	fb->buf = new_buf;
+	fb->size = new_size;
+}
+
+/* Make room for a value of the given alignment, after "additional" other
+ * bytes have been written, and pad so that it's aligned. */
+static void
+fb_prep(fb_builder_t *fb, gsize align, gsize additional)
+{
+	gsize pad;
+
+	if (align > fb->minalign)
+		fb->minalign = align;
+	pad = (~(fb->head + additional) + 1) & (align - 1);
+	fb_grow(fb, pad + align + additional);
+	memset(fb->buf + fb->size - fb->head - pad, 0, pad);
+	fb->head += pad;
+}
+
+static void
+fb_place(fb_builder_t *fb, const void *data, gsize len)
+{
+	fb->head += len;
+	memcpy(fb->buf + fb->size - fb->head, data, len);
+}
+
+static void
+fb_put_u8(fb_builder_t *fb, guint8 value)
+{
+	fb_place(fb, &value, 1);
+}
+
+static void
+fb_put_u16(fb_builder_t *fb, guint16 value)
+{
+	value = GUINT16_TO_LE(value);
+	fb_place(fb, &value, 2);
+}
+
+static void
+fb_put_u32(fb_builder_t *fb, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	fb_place(fb, &value, 4);
+}
+
+static void
+fb_put_u64(fb_builder_t *fb, guint64 value)
+{
+	value = GUINT64_TO_LE(value);
+	fb_place(fb, &value, 8);
+}
+
+/* An offset is stored relative to where it's stored. */
+static void
+fb_put_offset(fb_builder_t *fb, guint32 offset)
+{
+	fb_prep(fb, 4, 0);
+	fb_put_u32(fb, (guint32)(fb->head + 4 - offset));
+}
+
+static void
+fb_start_table(fb_builder_t *fb, int num_slots)
+{
+	g_assert(num_slots <= FB_MAX_SLOTS);
+	memset(fb->slots, 0, sizeof fb->slots);
+	fb->num_slots = num_slots;
+	fb->object_start = (guint32)fb->head;
+}
+
+static void
+fb_add_u8(fb_builder_t *fb, int slot, guint8 value)
+{
+	fb_prep(fb, 1, 0);
+	fb_put_u8(fb, value);
+	fb->slots[slot] = (guint32)fb->head;
+}
+
+static void
+fb_add_u16(fb_builder_t *fb, int slot, guint16 value)
+{
+	fb_prep(fb, 2, 0);
+	fb_put_u16(fb, value);
+	fb->slots[slot] = (guint32)fb->head;
+}
+
+static void
+fb_add_u32(fb_builder_t *fb, int slot, guint32 value)
+{
+	fb_prep(fb, 4, 0);
+	fb_put_u32(fb, value);
+	fb->slots[slot] = (guint32)fb->head;
+}
+
+static void
+fb_add_u64(fb_builder_t *fb, int slot, guint64 value)
+{
+	fb_prep(fb, 8, 0);
+	fb_put_u64(fb, value);
+	fb->slots[slot] = (guint32)fb->head;
+}
+
+static void
+fb_add_offset(fb_builder_t *fb, int slot, guint32 offset)
+{
+	fb_put_offset(fb, offset);
+	fb->slots[slot] = (guint32)fb->head;
+}
+
+/* Write the table's vtable, which gives the position of each field
+ * relative to the table, and point the table at it. */
+static guint32
+fb_end_table(fb_builder_t *fb)
+{
+	guint32 object, vtable;
+	gint32 soffset;
+	int i;
+
+	fb_prep(fb, 4, 0);
+	fb_put_u32(fb, 0);
+	object = (guint32)fb->head;
+
+	fb_grow(fb, (fb->num_slots + 2) * 2);
+	for (i = fb->num_slots - 1; i >= 0; i--)
+		fb_put_u16(fb, fb->slots[i] ? (guint16)(object - fb->slots[i]) : 0);
+	fb_put_u16(fb, (guint16)(object - fb->object_start));
+	fb_put_u16(fb, (guint16)((fb->num_slots + 2) * 2));
+	vtable = (guint32)fb->head;
+
+	soffset = GINT32_TO_LE((gint32)(vtable - object));
+	memcpy(fb->buf + fb->size - object, &soffset, 4);
+	return object;
+}
+
+static guint32
+fb_create_string(fb_builder_t *fb, const char *str)
+{
+	gsize len = strlen(str);
+
+	fb_prep(fb, 4, len + 1);
+	fb_put_u8(fb, 0);
+	fb_place(fb, str, len);
+	fb_put_u32(fb, (guint32)len);
+	return (guint32)fb->head;
+}
+
+static guint32
+fb_create_offset_vector(fb_builder_t *fb, const guint32 *offsets, guint count)
+{
+	guint i;
+
+	fb_prep(fb, 4, 4 * count);
+	for (i = count; i > 0; i--)
+		fb_put_offset(fb, offsets[i - 1]);
+	fb_put_u32(fb, count);
+	return (guint32)fb->head;
+}
+
+/* A vector of structs made of two longs, i.e. FieldNode or Buffer. */
+static guint32
+fb_create_pair_vector(fb_builder_t *fb, const gint64 *pairs, guint count)
+{
+	guint i;
+
+	fb_prep(fb, 4, 16 * count);
+	fb_prep(fb, 8, 16 * count);
+	for (i = count; i > 0; i--) {
+		fb_put_u64(fb, (guint64)pairs[2 * i - 1]);
+		fb_put_u64(fb, (guint64)pairs[2 * i - 2]);
+	}
+	fb_put_u32(fb, count);
+	return (guint32)fb->head;
+}
+
+static void
+fb_finish(fb_builder_t *fb, guint32 root)
+{
+	fb_prep(fb, fb->minalign, 4);
+	fb_put_offset(fb, root);
+}
+
+static void
+append_u32(GByteArray *array, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	g_byte_array_append(array, (const guint8 *)&value, 4);
+}
+
+static guint32
+get_u32(const GByteArray *array, guint index)
+{
+	guint32 value;
+
+	memcpy(&value, array->data + 4 * index, 4);
+	return GUINT32_FROM_LE(value);
+}
+
+/* Bits are appended one at a time, least significant bit first. */
+static void
+append_bit(GByteArray *bits, guint index, gboolean value)
+{
+	if (index / 8 >= bits->len) {
+		guint8 zero = 0;
+		g_byte_array_append(bits, &zero, 1);
+	}
+	if (value)
+		bits->data[index / 8] |= 1 << (index % 8);
+}
+
+static void
+reset_column(arrow_column_t *col)
+{
+	g_byte_array_set_size(col->validity, 0);
+	col->null_count = 0;
+	g_byte_array_set_size(col->list_offsets, 0);
+	append_u32(col->list_offsets, 0);
+	g_byte_array_set_size(col->values, 0);
+	g_byte_array_set_size(col->value_offsets, 0);
+	append_u32(col->value_offsets, 0);
+	col->num_values = 0;
+
+	g_byte_array_set_size(col->dict_data, 0);
+	g_byte_array_set_size(col->dict_offsets, 0);
+	append_u32(col->dict_offsets, 0);
+	col->dict_count = 0;
+	if (col->dict_slots)
+		memset(col->dict_slots, 0, (col->dict_mask + 1) * sizeof(guint32));
+}
+
+arrow_writer_t *
+arrow_writer_new(FILE *fh, guint batch_rows, gsize batch_bytes)
+{
+	arrow_writer_t *writer = g_new0(arrow_writer_t, 1);
+
+	writer->fh = fh;
+	writer->batch_rows = MAX(batch_rows, 1);
+	writer->batch_bytes = batch_bytes;
+	writer->columns = g_array_new(FALSE, TRUE, sizeof(arrow_column_t));
+	writer->nodes = g_array_new(FALSE, FALSE, sizeof(gint64));
+	writer->buffers = g_array_new(FALSE, FALSE, sizeof(gint64));
+	writer->body = g_array_new(FALSE, FALSE, sizeof(body_buffer_t));
+	return writer;
+}
+
+int
+arrow_writer_add_column(arrow_writer_t *writer, const char *name, arrow_type_e type,
+		int byte_width, gboolean list)
+{
+	arrow_column_t col;
+
+	g_return_val_if_fail(!writer->schema_written, -1);
+
+	memset(&col, 0, sizeof col);
+	col.name = g_strdup(name);
+	col.type = type;
+	col.list = list;
+	col.dict_id = writer->columns->len;
+
+	switch (type) {
+	case ARROW_TYPE_INT8:
+	case ARROW_TYPE_UINT8:
+		col.byte_width = 1;
+		break;
+	case ARROW_TYPE_INT16:
+	case ARROW_TYPE_UINT16:
+		col.byte_width = 2;
+		break;
+	case ARROW_TYPE_INT32:
+	case ARROW_TYPE_UINT32:
+	case ARROW_TYPE_FLOAT:
+	case ARROW_TYPE_STRING:		/* the dictionary index */
+		col.byte_width = 4;
+		break;
+	case ARROW_TYPE_INT64:
+	case ARROW_TYPE_UINT64:
+	case ARROW_TYPE_DOUBLE:
+	case ARROW_TYPE_TIMESTAMP_NS:
+	case ARROW_TYPE_DURATION_NS:
+		col.byte_width = 8;
+		break;
+	case ARROW_TYPE_FIXED_BINARY:
+		col.byte_width = MAX(byte_width, 1);
+		break;
+	case ARROW_TYPE_BOOL:
+	case ARROW_TYPE_BINARY:
+		col.byte_width = 0;
+		break;
+	}
+
+	col.validity = g_byte_array_new();
+	col.list_offsets = g_byte_array_new();
+	col.values = g_byte_array_new();
+	col.value_offsets = g_byte_array_new();
+	col.dict_data = g_byte_array_new();
+	col.dict_offsets = g_byte_array_new();
+	reset_column(&col);
+
+	g_array_append_val(writer->columns, col);
+	return writer->columns->len - 1;
+}
+
+static void
+write_u32(FILE *fh, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	fwrite(&value, 1, 4, fh);
+}
+
+static void
+write_padding(FILE *fh, gsize len)
+{
+	static const guint8 zeros[BODY_ALIGNMENT];
+
+	if (len > 0)
+		fwrite(zeros, 1, len, fh);
+}
+
+/* Write a message whose header is in the builder, followed by its body. */
+static void
+write_message(arrow_writer_t *writer, guint8 header_type, guint32 header)
+{
+	fb_builder_t *fb = &writer->fb;
+	guint32 message;
+	gsize len;
+	guint i;
+
+	fb_start_table(fb, 5);
+	fb_add_u64(fb, 3, (guint64)writer->body_len);	/* bodyLength */
+	fb_add_offset(fb, 2, header);			/* header */
+	fb_add_u16(fb, 0, METADATA_VERSION);		/* version */
+	fb_add_u8(fb, 1, header_type);			/* header_type */
+	message = fb_end_table(fb);
+	fb_finish(fb, message);
+
+	len = fb->head;
+	write_u32(writer->fh, CONTINUATION_MARKER);
+	write_u32(writer->fh, (guint32)BODY_ALIGN(len));
+	fwrite(fb->buf + fb->size - fb->head, 1, len, writer->fh);
+	write_padding(writer->fh, BODY_ALIGN(len) - len);
+
+	for (i = 0; i < writer->body->len; i++) {
+		body_buffer_t *buffer = &g_array_index(writer->body, body_buffer_t, i);
+
+		if (buffer->len > 0) {
+			fwrite(buffer->data, 1, buffer->len, writer->fh);
+			write_padding(writer->fh, BODY_ALIGN(buffer->len) - buffer->len);
+		}
+	}
+}
+
+static void
+start_body(arrow_writer_t *writer)
+{
+	fb_reset(&writer->fb);
+	g_array_set_size(writer->nodes, 0);
+	g_array_set_size(writer->buffers, 0);
+	g_array_set_size(writer->body, 0);
+	writer->body_len = 0;
+}
+
+static void
+add_node(arrow_writer_t *writer, gint64 length, gint64 null_count)
+{
+	g_array_append_val(writer->nodes, length);
+	g_array_append_val(writer->nodes, null_count);
+}
+
+static void
+add_buffer(arrow_writer_t *writer, const guint8 *data, gsize len)
+{
+	body_buffer_t buffer;
+	gint64 offset = writer->body_len;
+	gint64 length = len;
+
+	g_array_append_val(writer->buffers, offset);
+	g_array_append_val(writer->buffers, length);
+	buffer.data = data;
+	buffer.len = len;
+	g_array_append_val(writer->body, buffer);
+	writer->body_len += BODY_ALIGN(len);
+}
+
+static guint32
+build_record_batch(arrow_writer_t *writer, gint64 length)
+{
+	fb_builder_t *fb = &writer->fb;
+	guint32 nodes, buffers;
+
+	nodes = fb_create_pair_vector(fb, (const gint64 *)(void *)writer->nodes->data, writer->nodes->len / 2);
+	buffers = fb_create_pair_vector(fb, (const gint64 *)(void *)writer->buffers->data, writer->buffers->len / 2);
+
+	fb_start_table(fb, 4);
+	fb_add_u64(fb, 0, (guint64)length);	/* length */
+	fb_add_offset(fb, 1, nodes);		/* nodes */
+	fb_add_offset(fb, 2, buffers);		/* buffers */
+	return fb_end_table(fb);
+}
+
+static guint32
+build_type(fb_builder_t *fb, const arrow_column_t *col, guint8 *type_type)
+{
+	guint32 timezone;
+
+	switch (col->type) {
+	case ARROW_TYPE_BOOL:
+		*type_type = TYPE_BOOL;
+		fb_start_table(fb, 0);
+		break;
+	case ARROW_TYPE_INT8:
+	case ARROW_TYPE_INT16:
+	case ARROW_TYPE_INT32:
+	case ARROW_TYPE_INT64:
+	case ARROW_TYPE_UINT8:
+	case ARROW_TYPE_UINT16:
+	case ARROW_TYPE_UINT32:
+	case ARROW_TYPE_UINT64:
+		*type_type = TYPE_INT;
+		fb_start_table(fb, 2);
+		fb_add_u32(fb, 0, col->byte_width * 8);		/* bitWidth */
+		fb_add_u8(fb, 1, col->type <= ARROW_TYPE_INT64);	/* is_signed */
+		break;
+	case ARROW_TYPE_FLOAT:
+	case ARROW_TYPE_DOUBLE:
+		*type_type = TYPE_FLOATING_POINT;
+		fb_start_table(fb, 1);
+		fb_add_u16(fb, 0, col->type == ARROW_TYPE_FLOAT ? PRECISION_SINGLE : PRECISION_DOUBLE);
+		break;
+	case ARROW_TYPE_TIMESTAMP_NS:
+		*type_type = TYPE_TIMESTAMP;
+		timezone = fb_create_string(fb, "UTC");
+		fb_start_table(fb, 2);
+		fb_add_u16(fb, 0, TIME_UNIT_NANOSECOND);	/* unit */
+		fb_add_offset(fb, 1, timezone);			/* timezone */
+		break;
+	case ARROW_TYPE_DURATION_NS:
+		*type_type = TYPE_DURATION;
+		fb_start_table(fb, 1);
+		fb_add_u16(fb, 0, TIME_UNIT_NANOSECOND);	/* unit */
+		break;
+	case ARROW_TYPE_FIXED_BINARY:
+		*type_type = TYPE_FIXED_SIZE_BINARY;
+		fb_start_table(fb, 1);
+		fb_add_u32(fb, 0, col->byte_width);		/* byteWidth */
+		break;
+	case ARROW_TYPE_BINARY:
+		*type_type = TYPE_BINARY;
+		fb_start_table(fb, 0);
+		break;
+	case ARROW_TYPE_STRING:
+	default:
+		*type_type = TYPE_UTF8;
+		fb_start_table(fb, 0);
+		break;
+	}
+	return fb_end_table(fb);
+}
+
+/* Build a column's Field. A list column's Field has a child Field for
+ * its values. */
+static guint32
+build_field(fb_builder_t *fb, const char *name, const arrow_column_t *col, gboolean values)
+{
+	guint32 children, child, type, dictionary = 0, index_type, name_offset;
+	guint8 type_type;
+
+	if (col->list && !values) {
+		child = build_field(fb, "item", col, TRUE);
+		children = fb_create_offset_vector(fb, &child, 1);
+		type_type = TYPE_LIST;
+		fb_start_table(fb, 0);
+		type = fb_end_table(fb);
+	} else {
+		children = fb_create_offset_vector(fb, NULL, 0);
+		type = build_type(fb, col, &type_type);
+		if (col->type == ARROW_TYPE_STRING) {
+			fb_start_table(fb, 2);
+			fb_add_u32(fb, 0, 32);			/* bitWidth */
+			fb_add_u8(fb, 1, 1);			/* is_signed */
+			index_type = fb_end_table(fb);
+
+			fb_start_table(fb, 4);
+			fb_add_u64(fb, 0, (guint64)col->dict_id);	/* id */
+			fb_add_offset(fb, 1, index_type);	/* indexType */
+			fb_add_u8(fb, 2, 0);			/* isOrdered */
+			dictionary = fb_end_table(fb);
+		}
+	}
+	name_offset = fb_create_string(fb, name);
+
+	fb_start_table(fb, 7);
+	fb_add_offset(fb, 0, name_offset);		/* name */
+	fb_add_u8(fb, 1, 1);				/* nullable */
+	fb_add_u8(fb, 2, type_type);			/* type_type */
+	fb_add_offset(fb, 3, type);			/* type */
+	if (dictionary)
+		fb_add_offset(fb, 4, dictionary);	/* dictionary */
+	fb_add_offset(fb, 5, children);			/* children */
+	return fb_end_table(fb);
+}
+
+void
+arrow_writer_write_schema(arrow_writer_t *writer)
+{
+	fb_builder_t *fb = &writer->fb;
+	guint32 *fields, fields_vector, schema;
+	guint i;
+
+	if (writer->schema_written)
+		return;
+	writer->schema_written = TRUE;
+
+	start_body(writer);
+	fields = g_new(guint32, writer->columns->len);
+	for (i = 0; i < writer->columns->len; i++) {
+		arrow_column_t *col = &g_array_index(writer->columns, arrow_column_t, i);
+		fields[i] = build_field(fb, col->name, col, FALSE);
+	}
+	fields_vector = fb_create_offset_vector(fb, fields, writer->columns->len);
+	g_free(fields);
+
+	fb_start_table(fb, 2);
+	fb_add_u16(fb, 0, 0);				/* endianness = Little */
+	fb_add_offset(fb, 1, fields_vector);		/* fields */
+	schema = fb_end_table(fb);
+
+	write_message(writer, HEADER_SCHEMA, schema);
+}
+
+static void
+write_dictionary(arrow_writer_t *writer, arrow_column_t *col)
+{
+	fb_builder_t *fb = &writer->fb;
+	guint32 batch, dictionary;
+
+	start_body(writer);
+	add_node(writer, col->dict_count, 0);
+	add_buffer(writer, NULL, 0);
+	add_buffer(writer, col->dict_offsets->data, col->dict_offsets->len);
+	add_buffer(writer, col->dict_data->data, col->dict_data->len);
+	batch = build_record_batch(writer, col->dict_count);
+
+	/* Each batch has a dictionary of its own, which replaces the
+	 * previous one, so that dictionaries don't grow without bound. */
+	fb_start_table(fb, 3);
+	fb_add_u64(fb, 0, (guint64)col->dict_id);	/* id */
+	fb_add_offset(fb, 1, batch);			/* data */
+	fb_add_u8(fb, 2, 0);				/* isDelta */
+	dictionary = fb_end_table(fb);
+
+	write_message(writer, HEADER_DICTIONARY_BATCH, dictionary);
+}
+
+static void
+write_batch(arrow_writer_t *writer)
+{
+	guint32 batch;
+	guint i;
+
+	if (writer->num_rows == 0)
+		return;
+
+	arrow_writer_write_schema(writer);
+
+	for (i = 0; i < writer->columns->len; i++) {
+		arrow_column_t *col = &g_array_index(writer->columns, arrow_column_t, i);
+
+		if (col->type == ARROW_TYPE_STRING)
+			write_dictionary(writer, col);
+	}
+
+	start_body(writer);
+	for (i = 0; i < writer->columns->len; i++) {
+		arrow_column_t *col = &g_array_index(writer->columns, arrow_column_t, i);
+
+		add_node(writer, writer->num_rows, col->null_count);
+		add_buffer(writer, col->null_count ? col->validity->data : NULL,
+				col->null_count ? col->validity->len : 0);
+		if (col->list) {
+			add_buffer(writer, col->list_offsets->data, col->list_offsets->len);
+			add_node(writer, col->num_values, 0);
+			add_buffer(writer, NULL, 0);
+		}
+		if (col->type == ARROW_TYPE_BINARY)
+			add_buffer(writer, col->value_offsets->data, col->value_offsets->len);
+		add_buffer(writer, col->values->data, col->values->len);
+	}
+	batch = build_record_batch(writer, writer->num_rows);
+	write_message(writer, HEADER_RECORD_BATCH, batch);
+
+	for (i = 0; i < writer->columns->len; i++)
+		reset_column(&g_array_index(writer->columns, arrow_column_t, i));
+	writer->num_rows = 0;
+	writer->num_bytes = 0;
+}
+
+/* Returns the column if it can take another value in the current row. */
+static arrow_column_t *
+start_value(arrow_writer_t *writer, int column)
+{
+	arrow_column_t *col;
+
+	g_return_val_if_fail(column >= 0 && (guint)column < writer->columns->len, NULL);
+
+	col = &g_array_index(writer->columns, arrow_column_t, column);
+	if (!col->list && col->row_values > 0)
+		return NULL;
+	col->row_values++;
+	return col;
+}
+
+static void
+append_fixed(arrow_writer_t *writer, arrow_column_t *col, guint64 value)
+{
+	guint8 u8;
+	guint16 u16;
+	guint32 u32;
+
+	switch (col->byte_width) {
+	case 1:
+		u8 = (guint8)value;
+		g_byte_array_append(col->values, &u8, 1);
+		break;
+	case 2:
+		u16 = GUINT16_TO_LE((guint16)value);
+		g_byte_array_append(col->values, (const guint8 *)&u16, 2);
+		break;
+	case 4:
+		u32 = GUINT32_TO_LE((guint32)value);
+		g_byte_array_append(col->values, (const guint8 *)&u32, 4);
+		break;
+	default:
+		value = GUINT64_TO_LE(value);
+		g_byte_array_append(col->values, (const guint8 *)&value, 8);
+		break;
+	}
+	col->num_values++;
+	writer->num_bytes += col->byte_width;
+}
+
+static gboolean
+is_integer_type(arrow_type_e type)
+{
+	return (type >= ARROW_TYPE_INT8 && type <= ARROW_TYPE_UINT64) ||
+		type == ARROW_TYPE_TIMESTAMP_NS || type == ARROW_TYPE_DURATION_NS;
+}
+
+void
+arrow_writer_append_int(arrow_writer_t *writer, int column, gint64 value)
+{
+	arrow_column_t *col = start_value(writer, column);
+
+	if (!col)
+		return;
+	g_assert(is_integer_type(col->type));
+	append_fixed(writer, col, (guint64)value);
+}
+
+void
+arrow_writer_append_uint(arrow_writer_t *writer, int column, guint64 value)
+{
+	arrow_column_t *col = start_value(writer, column);
+
+	if (!col)
+		return;
+	g_assert(is_integer_type(col->type));
+	append_fixed(writer, col, value);
+}
+
+void
+arrow_writer_append_double(arrow_writer_t *writer, int column, double value)
+{
+	arrow_column_t *col = start_value(writer, column);
+	union {
+		float	f;
+		guint32	u;
+	} f32;
+	union {
+		double	d;
+		guint64	u;
+	} f64;
+
+	if (!col)
+		return;
+	g_assert(col->type == ARROW_TYPE_FLOAT || col->type == ARROW_TYPE_DOUBLE);
+	if (col->type == ARROW_TYPE_FLOAT) {
+		f32.f = (float)value;
+		append_fixed(writer, col, f32.u);
+	} else {
+		f64.d = value;
+		append_fixed(writer, col, f64.u);
+	}
+}
+
+void
+arrow_writer_append_bool(arrow_writer_t *writer, int column, gboolean value)
+{
+	arrow_column_t *col = start_value(writer, column);
+
+	if (!col)
+		return;
+	g_assert(col->type == ARROW_TYPE_BOOL);
+	append_bit(col->values, col->num_values++, value);
+}
+
+static guint32
+dict_hash(const guint8 *data, gsize len)
+{
+	/* FNV-1a */
+	guint32 hash = 2166136261U;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ data[i]) * 16777619U;
+	return hash;
+}
+
+static void
+dict_grow_slots(arrow_column_t *col)
+{
+	guint32 new_count = col->dict_slots ? (col->dict_mask + 1) * 2 : 256;
+	guint32 *slots = g_new0(guint32, new_count);
+	guint32 i, slot, start, end;
+
+	for (i = 0; i < col->dict_count; i++) {
+		start = get_u32(col->dict_offsets, i);
+		end = get_u32(col->dict_offsets, i + 1);
+		slot = dict_hash(col->dict_data->data + start, end - start) & (new_count - 1);
+		while (slots[slot])
+			slot = (slot + 1) & (new_count - 1);
+		slots[slot] = i + 1;
+	}
+	g_free(col->dict_slots);
+	col->dict_slots = slots;
+	col->dict_mask = new_count - 1;
+}
+
+/* Returns the index of a string in the dictionary, adding it if needed. */
+static guint32
+dict_lookup(arrow_writer_t *writer, arrow_column_t *col, const guint8 *data, gsize len)
+{
+	guint32 slot, idx, start, end;
+
+	/* Keep the table at most half full. */
+	if (!col->dict_slots || (col->dict_count + 1) * 2 > col->dict_mask + 1)
+		dict_grow_slots(col);
+
+	for (slot = dict_hash(data, len) & col->dict_mask; col->dict_slots[slot];
+			slot = (slot + 1) & col->dict_mask) {
+		idx = col->dict_slots[slot] - 1;
+		start = get_u32(col->dict_offsets, idx);
+		end = get_u32(col->dict_offsets, idx + 1);
+		if (end - start == len && memcmp(col->dict_data->data + start, data, len) == 0)
+			return idx;
+	}
+
+	g_byte_array_append(col->dict_data, data, (guint)len);
+	append_u32(col->dict_offsets, col->dict_data->len);
+	writer->num_bytes += len + 4;
+	idx = col->dict_count++;
+	col->dict_slots[slot] = idx + 1;
+	return idx;
+}
+
+void
+arrow_writer_append_bytes(arrow_writer_t *writer, int column, const guint8 *data, gsize len)
+{
+	arrow_column_t *col = start_value(writer, column);
+
+	if (!col)
+		return;
+
+	switch (col->type) {
+	case ARROW_TYPE_FIXED_BINARY:
+		if (len != (gsize)col->byte_width) {
+			/* Let arrow_writer_end_row() make it a null. */
+			col->row_values--;
+			return;
+		}
+		g_byte_array_append(col->values, data, (guint)len);
+		col->num_values++;
+		writer->num_bytes += len;
+		break;
+	case ARROW_TYPE_BINARY:
+		g_byte_array_append(col->values, data, (guint)len);
+		append_u32(col->value_offsets, col->values->len);
+		col->num_values++;
+		writer->num_bytes += len + 4;
+		break;
+	case ARROW_TYPE_STRING:
+		append_fixed(writer, col, dict_lookup(writer, col, data, len));
+		break;
+	default:
+		g_assert_not_reached();
+	}
+}
+
+/* Append the placeholder value of a null row. */
+static void
+append_null(arrow_column_t *col)
+{
+	static const guint8 zeros[64];
+	guint width;
+
+	switch (col->type) {
+	case ARROW_TYPE_BOOL:
+		append_bit(col->values, col->num_values, FALSE);
+		break;
+	case ARROW_TYPE_BINARY:
+		append_u32(col->value_offsets, col->values->len);
+		break;
+	default:
+		for (width = col->byte_width; width > sizeof zeros; width -= sizeof zeros)
+			g_byte_array_append(col->values, zeros, sizeof zeros);
+		g_byte_array_append(col->values, zeros, width);
+		break;
+	}
+	col->num_values++;
+}
+
+void
+arrow_writer_end_row(arrow_writer_t *writer)
+{
+	guint i;
+
+	for (i = 0; i < writer->columns->len; i++) {
+		arrow_column_t *col = &g_array_index(writer->columns, arrow_column_t, i);
+		gboolean valid = col->row_values > 0;
+
+		append_bit(col->validity, writer->num_rows, valid);
+		if (!valid) {
+			col->null_count++;
+			if (!col->list)
+				append_null(col);
+		}
+		if (col->list)
+			append_u32(col->list_offsets, col->num_values);
+		col->row_values = 0;
+	}
+	writer->num_rows++;
+
+	if (writer->num_rows >= writer->batch_rows || writer->num_bytes >= writer->batch_bytes)
+		write_batch(writer);
+}
+
+void
+arrow_writer_finish(arrow_writer_t *writer)
+{
+	arrow_writer_write_schema(writer);
+	write_batch(writer);
+
+	/* End-of-stream marker */
+	write_u32(writer->fh, CONTINUATION_MARKER);
+	write_u32(writer->fh, 0);
+}
+
+void
+arrow_writer_free(arrow_writer_t *writer)
+{
+	guint i;
+
+	if (!writer)
+		return;
+
+	for (i = 0; i < writer->columns->len; i++) {
+		arrow_column_t *col = &g_array_index(writer->columns, arrow_column_t, i);
+
+		g_free(col->name);
+		g_byte_array_free(col->validity, TRUE);
+		g_byte_array_free(col->list_offsets, TRUE);
+		g_byte_array_free(col->values, TRUE);
+		g_byte_array_free(col->value_offsets, TRUE);
+		g_byte_array_free(col->dict_data, TRUE);
+		g_byte_array_free(col->dict_offsets, TRUE);
+		g_free(col->dict_slots);
+	}
+	g_array_free(writer->columns, TRUE);
+	g_array_free(writer->nodes, TRUE);
+	g_array_free(writer->buffers, TRUE);
+	g_array_free(writer->body, TRUE);
+	g_free(writer->fb.buf);
+	g_free(writer);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,149 @@
+/* arrow_writer.h
+ * Writes record batches in the Apache Arrow IPC streaming format
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_ARROW_WRITER_H__
+#define __WS_ARROW_WRITER_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A writer for the Apache Arrow IPC streaming format, which columnar
+ * tools such as pyarrow, pandas, Polars and DuckDB can read directly,
+ * e.g. with pyarrow.ipc.open_stream().
+ *
+ * The columns are declared first, after which the schema is written.
+ * Values are then appended row by row. Rows are buffered and written as
+ * a record batch whenever the batch reaches a given number of rows or
+ * bytes, so memory use doesn't grow with the size of the output.
+ *
+ * A column holds at most one value per row, unless it's a list column,
+ * in which case each row holds a list of any number of values. A row
+ * without a value is null.
+ *
+ * String columns are dictionary encoded. Each record batch is preceded
+ * by a dictionary batch that replaces the previous dictionary and holds
+ * the distinct strings of the batch.
+ *
+ * Write errors are left to the caller to check with ferror().
+ */
+typedef struct arrow_writer arrow_writer_t;
+
+typedef enum {
+	ARROW_TYPE_BOOL,
+	ARROW_TYPE_INT8,
+	ARROW_TYPE_INT16,
+	ARROW_TYPE_INT32,
+	ARROW_TYPE_INT64,
+	ARROW_TYPE_UINT8,
+	ARROW_TYPE_UINT16,
+	ARROW_TYPE_UINT32,
+	ARROW_TYPE_UINT64,
+	ARROW_TYPE_FLOAT,
+	ARROW_TYPE_DOUBLE,
+	ARROW_TYPE_TIMESTAMP_NS,	/* nanoseconds since the epoch, UTC */
+	ARROW_TYPE_DURATION_NS,		/* nanoseconds */
+	ARROW_TYPE_FIXED_BINARY,	/* byte strings of a fixed width */
+	ARROW_TYPE_BINARY,
+	ARROW_TYPE_STRING		/* UTF-8, dictionary encoded */
+} arrow_type_e;
+
+/** Create a writer.
+ *
+ * @param fh [in] The stream to write to.
+ * @param batch_rows [in] The maximum number of rows in a record batch.
+ * @param batch_bytes [in] The approximate maximum size of a record batch.
+ * @return A new writer. Free it with arrow_writer_free().
+ */
+WS_DLL_PUBLIC arrow_writer_t *arrow_writer_new(FILE *fh, guint batch_rows, gsize batch_bytes);
+
+/** Add a column. Must be called before arrow_writer_write_schema().
+ *
+ * @param writer [in,out] The writer.
+ * @param name [in] The column name. A copy is made.
+ * @param type [in] The type of the values.
+ * @param byte_width [in] The width of ARROW_TYPE_FIXED_BINARY values.
+ * Ignored for other types.
+ * @param list [in] TRUE if each row holds a list of values.
+ * @return The index of the column.
+ */
+WS_DLL_PUBLIC int arrow_writer_add_column(arrow_writer_t *writer, const char *name,
+		arrow_type_e type, int byte_width, gboolean list);
+
+/** Write the stream's schema, i.e. the columns.
+ *
+ * @param writer [in,out] The writer.
+ */
+WS_DLL_PUBLIC void arrow_writer_write_schema(arrow_writer_t *writer);
+
+/** Append a value of one of the integer, timestamp or duration types
+ * to the current row.
+ */
+WS_DLL_PUBLIC void arrow_writer_append_int(arrow_writer_t *writer, int column, gint64 value);
+
+/** Append a value of one of the unsigned integer types to the current row. */
+WS_DLL_PUBLIC void arrow_writer_append_uint(arrow_writer_t *writer, int column, guint64 value);
+
+/** Append a value of one of the floating point types to the current row. */
+WS_DLL_PUBLIC void arrow_writer_append_double(arrow_writer_t *writer, int column, double value);
+
+/** Append a boolean value to the current row. */
+WS_DLL_PUBLIC void arrow_writer_append_bool(arrow_writer_t *writer, int column, gboolean value);
+
+/** Append a binary, fixed width binary or string value to the current
+ * row. A fixed width value of the wrong length is appended as a null.
+ */
+WS_DLL_PUBLIC void arrow_writer_append_bytes(arrow_writer_t *writer, int column,
+		const guint8 *data, gsize len);
+
+/** Finish the current row. Columns without a value become null. The
+ * batch is written if it's full.
+ *
+ * @param writer [in,out] The writer.
+ */
+WS_DLL_PUBLIC void arrow_writer_end_row(arrow_writer_t *writer);
+
+/** Write any remaining rows and the end-of-stream marker.
+ *
+ * @param writer [in,out] The writer.
+ */
+WS_DLL_PUBLIC void arrow_writer_finish(arrow_writer_t *writer);
+
+/** Free a writer. It doesn't close the stream.
+ *
+ * @param writer [in] The writer to free. May be NULL.
+ */
+WS_DLL_PUBLIC void arrow_writer_free(arrow_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_ARROW_WRITER_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,405 @@
+/* arrow_writer_test.c
+ * Tests for the Apache Arrow IPC stream writer
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "arrow_writer.h"
+
+/*
+ * The stream written by write_test_stream() is compared with a baseline,
+ * test/baseline/arrow-writer.arrow, whose path is given on the command
+ * line. The baseline was checked with pyarrow, which reads it as three
+ * batches of 4, 4 and 2 rows:
+ *
+ *	uint16:   [1, null, 3, 4, null, 6, 7, null, 9, 10]
+ *	int_list: [[0], null, [0, 2], null, [0, 4], [0, 5], null, [0, 7], [0, 8], [0, 9]]
+ *	string:   ["even", "odd", "even", null, "even", "odd", "even", "odd", "even", "odd"]
+ *	str_list: [["a"], ["a", "b"], ["a", "b", "c"], null, ["a"], ...]
+ *	fixed:    [00:00:00:00:00:00, ..., 04:04:04:04:04:04, null, 06:06:06:06:06:06, ...]
+ *	bool:     [false, true, false, true, ...]
+ *	time:     [1500000000000000000, 1500000000000000001, ...]
+ *	double:   [0.0, 0.25, ..., 2.0, null]
+ *	binary:   ["", 00, 00:01, 00:01:02, 00:01:02:03, "", 00, ...]
+ *
+ * To write a new baseline, run "arrow_writer_test -w FILE".
+ */
+
+/* Message header types, from Message.fbs */
+#define HEADER_SCHEMA           1
+#define HEADER_DICTIONARY_BATCH 2
+#define HEADER_RECORD_BATCH     3
+
+#define TEST_ROWS       10
+#define TEST_BATCH_ROWS 4
+
+static const char *baseline_path;
+
+static void
+write_test_stream(FILE *fh)
+{
+	arrow_writer_t *writer = arrow_writer_new(fh, TEST_BATCH_ROWS, 1024 * 1024);
+	static const char *letters[] = { "a", "b", "c", "d" };
+	guint8 bytes[6];
+	int c_uint, c_int_list, c_string, c_str_list, c_fixed, c_bool, c_time, c_double, c_binary;
+	int row, i;
+
+	c_uint     = arrow_writer_add_column(writer, "uint16", ARROW_TYPE_UINT16, 0, FALSE);
+	c_int_list = arrow_writer_add_column(writer, "int_list", ARROW_TYPE_INT32, 0, TRUE);
+	c_string   = arrow_writer_add_column(writer, "string", ARROW_TYPE_STRING, 0, FALSE);
+	c_str_list = arrow_writer_add_column(writer, "str_list", ARROW_TYPE_STRING, 0, TRUE);
+	c_fixed    = arrow_writer_add_column(writer, "fixed", ARROW_TYPE_FIXED_BINARY, 6, FALSE);
+	c_bool     = arrow_writer_add_column(writer, "bool", ARROW_TYPE_BOOL, 0, FALSE);
+	c_time     = arrow_writer_add_column(writer, "time", ARROW_TYPE_TIMESTAMP_NS, 0, FALSE);
+	c_double   = arrow_writer_add_column(writer, "double", ARROW_TYPE_DOUBLE, 0, FALSE);
+	c_binary   = arrow_writer_add_column(writer, "binary", ARROW_TYPE_BINARY, 0, FALSE);
+	arrow_writer_write_schema(writer);
+
+	for (row = 0; row < TEST_ROWS; row++) {
+		if (row % 3 != 1)
+			arrow_writer_append_uint(writer, c_uint, row + 1);
+
+		/* A list without values is null. */
+		if (row != 1 && row != 3 && row != 6) {
+			arrow_writer_append_int(writer, c_int_list, 0);
+			if (row > 1)
+				arrow_writer_append_int(writer, c_int_list, row);
+		}
+
+		if (row != 3)
+			arrow_writer_append_bytes(writer, c_string,
+					(const guint8 *)(row % 2 ? "odd" : "even"), row % 2 ? 3 : 4);
+
+		if (row != 3) {
+			for (i = 0; i <= row % 4; i++)
+				arrow_writer_append_bytes(writer, c_str_list, (const guint8 *)letters[i], 1);
+		}
+
+		/* A value of the wrong width is null. */
+		memset(bytes, row, sizeof bytes);
+		arrow_writer_append_bytes(writer, c_fixed, bytes, row == 5 ? 4 : 6);
+
+		arrow_writer_append_bool(writer, c_bool, row % 2);
+		/* Only the first value of a column that isn't a list is kept. */
+		arrow_writer_append_bool(writer, c_bool, TRUE);
+
+		arrow_writer_append_int(writer, c_time, G_GINT64_CONSTANT(1500000000000000000) + row);
+
+		if (row != 9)
+			arrow_writer_append_double(writer, c_double, row / 4.0);
+
+		arrow_writer_append_bytes(writer, c_binary, (const guint8 *)"\x00\x01\x02\x03", row % 5);
+
+		arrow_writer_end_row(writer);
+	}
+
+	arrow_writer_finish(writer);
+	arrow_writer_free(writer);
+}
+
+static GByteArray *
+stream_bytes(FILE *fh)
+{
+	GByteArray *bytes = g_byte_array_new();
+	guint8 buf[4096];
+	size_t len;
+
+	g_assert(fflush(fh) == 0);
+	rewind(fh);
+	while ((len = fread(buf, 1, sizeof buf, fh)) > 0)
+		g_byte_array_append(bytes, buf, (guint)len);
+	g_assert(!ferror(fh));
+	return bytes;
+}
+
+/*
+ * Just enough of a FlatBuffers reader to find our way through the
+ * stream's messages.
+ */
+static guint32
+fb_u32(const guint8 *p)
+{
+	return GUINT32_FROM_LE(*(const guint32 *)p);
+}
+
+/* Returns a pointer to a field of a table, or NULL if it isn't there. */
+static const guint8 *
+fb_field(const guint8 *table, int slot)
+{
+	const guint8 *vtable = table - (gint32)fb_u32(table);
+	guint16 vtable_len = GUINT16_FROM_LE(*(const guint16 *)vtable);
+	guint16 offset;
+
+	if (4 + 2 * slot >= vtable_len)
+		return NULL;
+	offset = GUINT16_FROM_LE(*(const guint16 *)(vtable + 4 + 2 * slot));
+	return offset ? table + offset : NULL;
+}
+
+static gint64
+fb_i64(const guint8 *table, int slot)
+{
+	const guint8 *p = fb_field(table, slot);
+
+	return p ? (gint64)GUINT64_FROM_LE(*(const guint64 *)p) : 0;
+}
+
+static const guint8 *
+fb_table(const guint8 *table, int slot)
+{
+	const guint8 *p = fb_field(table, slot);
+
+	return p ? p + fb_u32(p) : NULL;
+}
+
+typedef struct {
+	int	header_type;
+	gint64	length;		/* of a record batch, or of a dictionary batch's data */
+	gint64	dict_id;
+} message_t;
+
+/* Split a stream into messages, checking that each one is framed
+ * correctly and that the stream is terminated. */
+static GArray *
+parse_stream(const GByteArray *bytes)
+{
+	GArray *messages = g_array_new(FALSE, TRUE, sizeof(message_t));
+	gsize pos = 0;
+
+	for (;;) {
+		message_t msg;
+		const guint8 *meta, *message, *header;
+		guint32 meta_len;
+		gint64 body_len;
+
+		g_assert(pos + 8 <= bytes->len);
+		g_assert(fb_u32(bytes->data + pos) == 0xFFFFFFFFU);
+		meta_len = fb_u32(bytes->data + pos + 4);
+		pos += 8;
+		if (meta_len == 0)
+			break;
+
+		/* The body has to start on an 8 byte boundary. */
+		g_assert(meta_len % 8 == 0);
+		g_assert(pos + meta_len <= bytes->len);
+		meta = bytes->data + pos;
+		message = meta + fb_u32(meta);
+		header = fb_table(message, 2);
+		g_assert(header != NULL);
+
+		memset(&msg, 0, sizeof msg);
+		msg.header_type = *fb_field(message, 1);
+		if (msg.header_type == HEADER_RECORD_BATCH) {
+			msg.length = fb_i64(header, 0);
+		} else if (msg.header_type == HEADER_DICTIONARY_BATCH) {
+			msg.dict_id = fb_i64(header, 0);
+			msg.length = fb_i64(fb_table(header, 1), 0);
+		}
+		g_array_append_val(messages, msg);
+
+		body_len = fb_i64(message, 3);
+		g_assert(body_len % 8 == 0);
+		pos += meta_len + body_len;
+	}
+
+	/* Nothing follows the end-of-stream marker. */
+	g_assert(pos == bytes->len);
+	return messages;
+}
+
+/* Compare the test stream with the baseline. */
+static void
+arrow_writer_test_baseline(void)
+{
+	FILE *fh;
+	GByteArray *bytes;
+	gchar *baseline;
+	gsize baseline_len;
+	GError *error = NULL;
+
+	if (!baseline_path) {
+		g_test_message("No baseline given");
+		return;
+	}
+
+	fh = tmpfile();
+	g_assert(fh != NULL);
+	write_test_stream(fh);
+	bytes = stream_bytes(fh);
+	fclose(fh);
+
+	g_file_get_contents(baseline_path, &baseline, &baseline_len, &error);
+	g_assert_no_error(error);
+	g_assert_cmpuint(bytes->len, ==, baseline_len);
+	g_assert(memcmp(bytes->data, baseline, baseline_len) == 0);
+
+	g_free(baseline);
+	g_byte_array_free(bytes, TRUE);
+}
+
+/*
+ * The rows are split into batches of TEST_BATCH_ROWS, and each batch is
+ * preceded by a dictionary for each string column.
+ */
+static void
+arrow_writer_test_batches(void)
+{
+	FILE *fh = tmpfile();
+	GByteArray *bytes;
+	GArray *messages;
+	guint i = 0;
+	int rows = 0;
+
+	g_assert(fh != NULL);
+	write_test_stream(fh);
+	bytes = stream_bytes(fh);
+	fclose(fh);
+	messages = parse_stream(bytes);
+
+	g_assert_cmpint(g_array_index(messages, message_t, i++).header_type, ==, HEADER_SCHEMA);
+	while (i < messages->len) {
+		message_t *msg = &g_array_index(messages, message_t, i++);
+
+		g_assert_cmpint(msg->header_type, ==, HEADER_DICTIONARY_BATCH);
+		g_assert_cmpint(msg->dict_id, ==, 2);
+		/* "even" and "odd", or just one of them in the last batch */
+		g_assert_cmpint(msg->length, >=, 1);
+		g_assert_cmpint(msg->length, <=, 2);
+
+		msg = &g_array_index(messages, message_t, i++);
+		g_assert_cmpint(msg->header_type, ==, HEADER_DICTIONARY_BATCH);
+		g_assert_cmpint(msg->dict_id, ==, 3);
+
+		msg = &g_array_index(messages, message_t, i++);
+		g_assert_cmpint(msg->header_type, ==, HEADER_RECORD_BATCH);
+		g_assert_cmpint(msg->length, ==, MIN(TEST_BATCH_ROWS, TEST_ROWS - rows));
+		rows += (int)msg->length;
+	}
+	g_assert_cmpint(rows, ==, TEST_ROWS);
+
+	g_array_free(messages, TRUE);
+	g_byte_array_free(bytes, TRUE);
+}
+
+/* A batch is also written once it reaches the byte limit. */
+static void
+arrow_writer_test_batch_bytes(void)
+{
+	FILE *fh = tmpfile();
+	arrow_writer_t *writer;
+	GByteArray *bytes;
+	GArray *messages;
+	guint8 value[100];
+	int column, row;
+	guint i, batches = 0;
+	gint64 rows = 0;
+
+	g_assert(fh != NULL);
+	writer = arrow_writer_new(fh, 1000000, 1000);
+	column = arrow_writer_add_column(writer, "binary", ARROW_TYPE_BINARY, 0, FALSE);
+	memset(value, 0xa5, sizeof value);
+	for (row = 0; row < 100; row++) {
+		arrow_writer_append_bytes(writer, column, value, sizeof value);
+		arrow_writer_end_row(writer);
+	}
+	arrow_writer_finish(writer);
+	arrow_writer_free(writer);
+
+	bytes = stream_bytes(fh);
+	fclose(fh);
+	messages = parse_stream(bytes);
+
+	g_assert_cmpint(g_array_index(messages, message_t, 0).header_type, ==, HEADER_SCHEMA);
+	for (i = 1; i < messages->len; i++) {
+		message_t *msg = &g_array_index(messages, message_t, i);
+
+		g_assert_cmpint(msg->header_type, ==, HEADER_RECORD_BATCH);
+		g_assert_cmpint(msg->length, <=, 10);
+		rows += msg->length;
+		batches++;
+	}
+	g_assert_cmpint(rows, ==, 100);
+	g_assert_cmpuint(batches, >=, 10);
+
+	g_array_free(messages, TRUE);
+	g_byte_array_free(bytes, TRUE);
+}
+
+/* A stream without rows has just the schema. */
+static void
+arrow_writer_test_empty(void)
+{
+	FILE *fh = tmpfile();
+	arrow_writer_t *writer;
+	GByteArray *bytes;
+	GArray *messages;
+
+	g_assert(fh != NULL);
+	writer = arrow_writer_new(fh, 10, 1024);
+	arrow_writer_add_column(writer, "string", ARROW_TYPE_STRING, 0, TRUE);
+	arrow_writer_finish(writer);
+	arrow_writer_free(writer);
+
+	bytes = stream_bytes(fh);
+	fclose(fh);
+	messages = parse_stream(bytes);
+
+	g_assert_cmpuint(messages->len, ==, 1);
+	g_assert_cmpint(g_array_index(messages, message_t, 0).header_type, ==, HEADER_SCHEMA);
+
+	g_array_free(messages, TRUE);
+	g_byte_array_free(bytes, TRUE);
+}
+
+int
+main(int argc, char **argv)
+{
+	int i;
+
+	g_test_init(&argc, &argv, NULL);
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			FILE *fh = fopen(argv[i + 1], "wb");
+
+			if (!fh) {
+				perror(argv[i + 1]);
+				return 1;
+			}
+			write_test_stream(fh);
+			return fclose(fh) == 0 ? 0 : 1;
+		}
+		baseline_path = argv[i];
+	}
+
+	g_test_add_func("/wsutil/arrow_writer/baseline", arrow_writer_test_baseline);
+	g_test_add_func("/wsutil/arrow_writer/batches", arrow_writer_test_batches);
+	g_test_add_func("/wsutil/arrow_writer/batch_bytes", arrow_writer_test_batch_bytes);
+	g_test_add_func("/wsutil/arrow_writer/empty", arrow_writer_test_empty);
+
+	return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,293 @@
+/* bitmap.c
+ * Compressed bitmaps of 32-bit unsigned integers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "bitmap.h"
+#include "bits_ctz.h"
+
+#define CHUNK_VALUES	65536
+#define ARRAY_MAX	4096			/* more than this, and a chunk is a bitset */
+#define BITSET_WORDS	(CHUNK_VALUES / 64)
+
+typedef struct {
+	guint16 key;				/* upper 16 bits of the chunk's values */
+	guint32 count;				/* number of values in the chunk */
+	guint32 capacity;			/* of the array, if it's an array */
+	union {
+		guint16 *array;			/* sorted lower 16 bits */
+		guint64 *bits;
+	} u;
+} ws_bitmap_chunk;
+
+struct ws_bitmap {
+	ws_bitmap_chunk *chunks;		/* sorted by key */
+	guint num_chunks;
+	guint capacity;
+	guint32 count;
+};
+
+ws_bitmap *
+ws_bitmap_new(void)
+{
+	return g_new0(ws_bitmap, 1);
+}
+
+void
+ws_bitmap_free(ws_bitmap *bitmap)
+{
+	guint i;
+
+	if (!bitmap)
+		return;
+
+	for (i = 0; i < bitmap->num_chunks; i++) {
+		if (bitmap->chunks[i].count > ARRAY_MAX)
+			g_free(bitmap->chunks[i].u.bits);
+		else
+			g_free(bitmap->chunks[i].u.array);
+	}
+	g_free(bitmap->chunks);
+	g_free(bitmap);
+}
+
+/*
+ * Find the chunk with the given key.  If there isn't one, *idx is set to
+ * where it would go.
+ */
+static gboolean
+ws_bitmap_find_chunk(const ws_bitmap *bitmap, guint16 key, guint *idx)
+{
+	guint lo = 0, hi = bitmap->num_chunks, mid;
+
+	/* Values are usually added and looked up in increasing order. */
+	if (hi == 0 || bitmap->chunks[hi - 1].key < key) {
+		*idx = hi;
+		return FALSE;
+	}
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (bitmap->chunks[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*idx = lo;
+	return lo < bitmap->num_chunks && bitmap->chunks[lo].key == key;
+}
+
+/*
+ * Find a value in an array chunk.  If it isn't there, *idx is set to
+ * where it would go.
+ */
+static gboolean
+ws_bitmap_find_in_array(const ws_bitmap_chunk *chunk, guint16 low, guint *idx)
+{
+	guint lo = 0, hi = chunk->count, mid;
+
+	if (hi == 0 || chunk->u.array[hi - 1] < low) {
+		*idx = hi;
+		return FALSE;
+	}
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (chunk->u.array[mid] < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*idx = lo;
+	return chunk->u.array[lo] == low;
+}
+
+static void
+ws_bitmap_array_to_bitset(ws_bitmap_chunk *chunk)
+{
+	guint64 *bits = g_new0(guint64, BITSET_WORDS);
+	guint i;
+
+	for (i = 0; i < chunk->count; i++)
+		bits[chunk->u.array[i] >> 6] |= G_GUINT64_CONSTANT(1) << (chunk->u.array[i] & 63);
+	g_free(chunk->u.array);
+	chunk->u.bits = bits;
+	chunk->capacity = 0;
+}
+
+/* Returns TRUE if the value wasn't already there. */
+static gboolean
+ws_bitmap_chunk_add(ws_bitmap_chunk *chunk, guint16 low)
+{
+	guint64 bit;
+	guint idx;
+
+	if (chunk->count <= ARRAY_MAX) {
+		if (ws_bitmap_find_in_array(chunk, low, &idx))
+			return FALSE;
+		if (chunk->count == ARRAY_MAX) {
+			ws_bitmap_array_to_bitset(chunk);
+		} else {
+			if (chunk->count == chunk->capacity) {
+				chunk->capacity = chunk->capacity ? MIN(chunk->capacity * 2, ARRAY_MAX) : 4;
+				chunk->u.array = (guint16 *)g_realloc(chunk->u.array, chunk->capacity * sizeof(guint16));
+			}
+			memmove(&chunk->u.array[idx + 1], &chunk->u.array[idx],
+				(chunk->count - idx) * sizeof(guint16));
+			chunk->u.array[idx] = low;
+			chunk->count++;
+			return TRUE;
+		}
+	}
+
+	bit = G_GUINT64_CONSTANT(1) << (low & 63);
+	if (chunk->u.bits[low >> 6] & bit)
+		return FALSE;
+	chunk->u.bits[low >> 6] |= bit;
+	chunk->count++;
+	return TRUE;
+}
+
+void
+ws_bitmap_add(ws_bitmap *bitmap, guint32 value)
+{
+	guint16 key = (guint16)(value >> 16);
+	ws_bitmap_chunk *chunk;
+	guint idx;
+
+	if (!ws_bitmap_find_chunk(bitmap, key, &idx)) {
+		if (bitmap->num_chunks == bitmap->capacity) {
+			bitmap->capacity = bitmap->capacity ? bitmap->capacity * 2 : 4;
+			bitmap->chunks = (ws_bitmap_chunk *)g_realloc(bitmap->chunks, bitmap->capacity * sizeof(ws_bitmap_chunk));
+		}
+		memmove(&bitmap->chunks[idx + 1], &bitmap->chunks[idx],
+			(bitmap->num_chunks - idx) * sizeof(ws_bitmap_chunk));
+		bitmap->num_chunks++;
+		chunk = &bitmap->chunks[idx];
+		memset(chunk, 0, sizeof(*chunk));
+		chunk->key = key;
+	}
+	chunk = &bitmap->chunks[idx];
+
+	if (ws_bitmap_chunk_add(chunk, (guint16)value))
+		bitmap->count++;
+}
+
+gboolean
+ws_bitmap_contains(const ws_bitmap *bitmap, guint32 value)
+{
+	const ws_bitmap_chunk *chunk;
+	guint16 low = (guint16)value;
+	guint idx;
+
+	if (!ws_bitmap_find_chunk(bitmap, (guint16)(value >> 16), &idx))
+		return FALSE;
+	chunk = &bitmap->chunks[idx];
+
+	if (chunk->count > ARRAY_MAX)
+		return (chunk->u.bits[low >> 6] >> (low & 63)) & 1;
+	return ws_bitmap_find_in_array(chunk, low, &idx);
+}
+
+guint32
+ws_bitmap_count(const ws_bitmap *bitmap)
+{
+	return bitmap->count;
+}
+
+gsize
+ws_bitmap_memory_size(const ws_bitmap *bitmap)
+{
+	gsize size = sizeof(ws_bitmap) + bitmap->capacity * sizeof(ws_bitmap_chunk);
+	guint i;
+
+	for (i = 0; i < bitmap->num_chunks; i++) {
+		if (bitmap->chunks[i].count > ARRAY_MAX)
+			size += BITSET_WORDS * sizeof(guint64);
+		else
+			size += bitmap->chunks[i].capacity * sizeof(guint16);
+	}
+	return size;
+}
+
+void
+ws_bitmap_shrink(ws_bitmap *bitmap)
+{
+	ws_bitmap_chunk *chunk;
+	guint i;
+
+	for (i = 0; i < bitmap->num_chunks; i++) {
+		chunk = &bitmap->chunks[i];
+		if (chunk->count <= ARRAY_MAX && chunk->capacity > chunk->count) {
+			chunk->capacity = chunk->count;
+			chunk->u.array = (guint16 *)g_realloc(chunk->u.array, chunk->capacity * sizeof(guint16));
+		}
+	}
+	if (bitmap->capacity > bitmap->num_chunks) {
+		bitmap->capacity = bitmap->num_chunks;
+		bitmap->chunks = (ws_bitmap_chunk *)g_realloc(bitmap->chunks, bitmap->capacity * sizeof(ws_bitmap_chunk));
+	}
+}
+
+void
+ws_bitmap_iter_init(ws_bitmap_iter *iter, const ws_bitmap *bitmap)
+{
+	iter->bitmap = bitmap;
+	iter->chunk = 0;
+	iter->pos = 0;
+}
+
+gboolean
+ws_bitmap_iter_next(ws_bitmap_iter *iter, guint32 *value)
+{
+	const ws_bitmap *bitmap = iter->bitmap;
+	const ws_bitmap_chunk *chunk;
+	guint64 word;
+
+	for (; iter->chunk < bitmap->num_chunks; iter->chunk++, iter->pos = 0) {
+		chunk = &bitmap->chunks[iter->chunk];
+
+		if (chunk->count <= ARRAY_MAX) {
+			if (iter->pos < chunk->count) {
+				*value = ((guint32)chunk->key << 16) | chunk->u.array[iter->pos++];
+				return TRUE;
+			}
+			continue;
+		}
+
+		while (iter->pos < CHUNK_VALUES) {
+			word = chunk->u.bits[iter->pos >> 6] >> (iter->pos & 63);
+			if (word == 0) {
+				iter->pos = (iter->pos | 63) + 1;
+				continue;
+			}
+			iter->pos += ws_ctz(word);
+			*value = ((guint32)chunk->key << 16) | iter->pos;
+			iter->pos++;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,80 @@
+/* bitmap.h
+ * Compressed bitmaps of 32-bit unsigned integers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_BITMAP_H__
+#define __WS_BITMAP_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A set of 32-bit unsigned integers, such as frame numbers, stored in
+ * the manner of a "Roaring" bitmap: the values are split into chunks
+ * of 65536 by their upper 16 bits, and each chunk is stored either as
+ * a sorted array of the lower 16 bits of its values, if it has 4096 or
+ * fewer values, or as a 65536-bit bitset, if it has more.  A sparse set
+ * thus takes about 2 bytes per value and a dense one about 1 bit per
+ * value.
+ *
+ * Adding values in increasing order is the fastest way to build one.
+ */
+typedef struct ws_bitmap ws_bitmap;
+
+typedef struct {
+	const ws_bitmap *bitmap;
+	guint chunk;
+	guint pos;
+} ws_bitmap_iter;
+
+WS_DLL_PUBLIC ws_bitmap *ws_bitmap_new(void);
+WS_DLL_PUBLIC void ws_bitmap_free(ws_bitmap *bitmap);
+
+WS_DLL_PUBLIC void ws_bitmap_add(ws_bitmap *bitmap, guint32 value);
+WS_DLL_PUBLIC gboolean ws_bitmap_contains(const ws_bitmap *bitmap, guint32 value);
+
+/* The number of values in the bitmap. */
+WS_DLL_PUBLIC guint32 ws_bitmap_count(const ws_bitmap *bitmap);
+
+/* The amount of memory the bitmap takes up, in bytes. */
+WS_DLL_PUBLIC gsize ws_bitmap_memory_size(const ws_bitmap *bitmap);
+
+/* Give back memory allocated for values that were never added. */
+WS_DLL_PUBLIC void ws_bitmap_shrink(ws_bitmap *bitmap);
+
+/*
+ * Go through the values of the bitmap in increasing order.  The bitmap
+ * mustn't be changed while doing so.
+ */
+WS_DLL_PUBLIC void ws_bitmap_iter_init(ws_bitmap_iter *iter, const ws_bitmap *bitmap);
+WS_DLL_PUBLIC gboolean ws_bitmap_iter_next(ws_bitmap_iter *iter, guint32 *value);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_BITMAP_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,354 @@
+/* bitmap_test.c
+ * Tests for compressed bitmaps of 32-bit unsigned integers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "bitmap.h"
+
+/* These match bitmap.c. */
+#define CHUNK_VALUES    65536
+#define ARRAY_MAX       4096
+
+/*
+ * The bitmaps are checked against a sorted array of the values that were
+ * added, with no duplicates.
+ */
+static gint
+compare_values(gconstpointer a, gconstpointer b)
+{
+    guint32 value_a = *(const guint32 *)a;
+    guint32 value_b = *(const guint32 *)b;
+
+    return value_a < value_b ? -1 : value_a > value_b;
+}
+
+static GArray *
+reference_new(const guint32 *values, guint num_values)
+{
+    GArray *ref = g_array_sized_new(FALSE, FALSE, sizeof(guint32), num_values);
+    guint i, j;
+
+    g_array_append_vals(ref, values, num_values);
+    g_array_sort(ref, compare_values);
+    for (i = 0, j = 0; i < ref->len; i++) {
+        if (j == 0 || g_array_index(ref, guint32, i) != g_array_index(ref, guint32, j - 1))
+            g_array_index(ref, guint32, j++) = g_array_index(ref, guint32, i);
+    }
+    g_array_set_size(ref, j);
+    return ref;
+}
+
+static gboolean
+reference_contains(const GArray *ref, guint32 value)
+{
+    return bsearch(&value, ref->data, ref->len, sizeof(guint32), compare_values) != NULL;
+}
+
+static ws_bitmap *
+bitmap_new_from(const guint32 *values, guint num_values)
+{
+    ws_bitmap *bitmap = ws_bitmap_new();
+    guint i;
+
+    for (i = 0; i < num_values; i++)
+        ws_bitmap_add(bitmap, values[i]);
+    return bitmap;
+}
+
+/*
+ * Check the count, the iteration order, and every value that was added
+ * along with its neighbours.
+ */
+static void
+check_bitmap(const ws_bitmap *bitmap, const GArray *ref)
+{
+    ws_bitmap_iter iter;
+    guint32 value, ref_value;
+    guint i;
+
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, ref->len);
+
+    ws_bitmap_iter_init(&iter, bitmap);
+    for (i = 0; i < ref->len; i++) {
+        ref_value = g_array_index(ref, guint32, i);
+        g_assert(ws_bitmap_iter_next(&iter, &value));
+        g_assert_cmpuint(value, ==, ref_value);
+
+        g_assert(ws_bitmap_contains(bitmap, ref_value));
+        if (ref_value > 0)
+            g_assert(ws_bitmap_contains(bitmap, ref_value - 1) == reference_contains(ref, ref_value - 1));
+        if (ref_value < G_MAXUINT32)
+            g_assert(ws_bitmap_contains(bitmap, ref_value + 1) == reference_contains(ref, ref_value + 1));
+    }
+    g_assert(!ws_bitmap_iter_next(&iter, &value));
+    /* And it stays at the end. */
+    g_assert(!ws_bitmap_iter_next(&iter, &value));
+}
+
+/* Check every value in a chunk, whether or not it was added. */
+static void
+check_chunk(const ws_bitmap *bitmap, const GArray *ref, guint32 key)
+{
+    guint32 value;
+    guint i;
+
+    for (i = 0; i < CHUNK_VALUES; i++) {
+        value = (key << 16) | i;
+        g_assert(ws_bitmap_contains(bitmap, value) == reference_contains(ref, value));
+    }
+}
+
+static void
+bitmap_test_empty(void)
+{
+    ws_bitmap *bitmap = ws_bitmap_new();
+    ws_bitmap_iter iter;
+    guint32 value;
+
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, 0);
+    g_assert(!ws_bitmap_contains(bitmap, 0));
+    g_assert(!ws_bitmap_contains(bitmap, G_MAXUINT32));
+    ws_bitmap_iter_init(&iter, bitmap);
+    g_assert(!ws_bitmap_iter_next(&iter, &value));
+
+    ws_bitmap_shrink(bitmap);
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, 0);
+    ws_bitmap_free(bitmap);
+
+    ws_bitmap_free(NULL);
+}
+
+/* Values at the edges of words, chunks and the range, added backwards. */
+static void
+bitmap_test_boundaries(void)
+{
+    static const guint32 values[] = {
+        0, 1, 63, 64, 65, 127, 128,
+        CHUNK_VALUES - 1, CHUNK_VALUES, CHUNK_VALUES + 1,
+        G_MAXINT32, (guint32)G_MAXINT32 + 1,
+        G_MAXUINT32 - CHUNK_VALUES, G_MAXUINT32 - CHUNK_VALUES + 1,
+        G_MAXUINT32 - 1, G_MAXUINT32,
+    };
+    ws_bitmap *bitmap = ws_bitmap_new();
+    GArray *ref = reference_new(values, G_N_ELEMENTS(values));
+    guint i;
+
+    for (i = G_N_ELEMENTS(values); i-- > 0; )
+        ws_bitmap_add(bitmap, values[i]);
+    /* Adding them again changes nothing. */
+    for (i = 0; i < G_N_ELEMENTS(values); i++)
+        ws_bitmap_add(bitmap, values[i]);
+
+    check_bitmap(bitmap, ref);
+    check_chunk(bitmap, ref, 0);
+    check_chunk(bitmap, ref, G_MAXUINT16);
+
+    ws_bitmap_free(bitmap);
+    g_array_free(ref, TRUE);
+}
+
+/*
+ * A chunk changes from a sorted array to a bitset when it gets more than
+ * ARRAY_MAX values. Fill one to just below, at and just above that, and
+ * all the way, with the values in a scrambled order.
+ */
+static void
+bitmap_test_chunk_sizes(void)
+{
+    static const guint sizes[] = {
+        1, ARRAY_MAX - 1, ARRAY_MAX, ARRAY_MAX + 1, 2 * ARRAY_MAX, CHUNK_VALUES
+    };
+    guint32 *values = g_new(guint32, CHUNK_VALUES);
+    ws_bitmap *bitmap;
+    GArray *ref;
+    gsize size;
+    guint i, j, n;
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        n = sizes[i];
+        /* Spread the values over the chunk, in chunk 1, stepping by a
+           prime so that they aren't added in order. */
+        for (j = 0; j < n; j++)
+            values[j] = CHUNK_VALUES + (guint32)(((guint64)j * 40507 % n) * (CHUNK_VALUES / n));
+
+        bitmap = bitmap_new_from(values, n);
+        ref = reference_new(values, n);
+        g_assert_cmpuint(ref->len, ==, n);
+        check_bitmap(bitmap, ref);
+        check_chunk(bitmap, ref, 0);
+        check_chunk(bitmap, ref, 1);
+        check_chunk(bitmap, ref, 2);
+
+        /* An array takes 2 bytes per value, a bitset 1 bit per value
+           in the chunk. */
+        ws_bitmap_shrink(bitmap);
+        size = ws_bitmap_memory_size(bitmap);
+        if (n <= ARRAY_MAX) {
+            g_assert_cmpuint(size, >=, n * sizeof(guint16));
+            g_assert_cmpuint(size, <, n * sizeof(guint16) + 256);
+        } else {
+            g_assert_cmpuint(size, >=, CHUNK_VALUES / 8);
+            g_assert_cmpuint(size, <, CHUNK_VALUES / 8 + 256);
+        }
+        check_bitmap(bitmap, ref);
+
+        ws_bitmap_free(bitmap);
+        g_array_free(ref, TRUE);
+    }
+    g_free(values);
+}
+
+/*
+ * Random values over several chunks of different densities, compared
+ * with the reference, before and after giving back unused memory.
+ */
+static void
+bitmap_test_random(void)
+{
+    static const guint32 chunk_values[] = { 100, ARRAY_MAX * 3, 20, 60000, 1 };
+    GRand *rand = g_rand_new_with_seed(8);
+    GArray *values = g_array_new(FALSE, FALSE, sizeof(guint32));
+    ws_bitmap *bitmap;
+    GArray *ref;
+    guint32 value;
+    gsize size;
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(chunk_values); i++) {
+        for (j = 0; j < chunk_values[i]; j++) {
+            /* Every other chunk is left empty. */
+            value = (guint32)(2 * i) << 16 | (guint32)g_rand_int_range(rand, 0, CHUNK_VALUES);
+            g_array_append_val(values, value);
+        }
+    }
+
+    bitmap = bitmap_new_from((const guint32 *)values->data, values->len);
+    ref = reference_new((const guint32 *)values->data, values->len);
+    check_bitmap(bitmap, ref);
+    for (i = 0; i < 2 * G_N_ELEMENTS(chunk_values); i++)
+        check_chunk(bitmap, ref, i);
+
+    size = ws_bitmap_memory_size(bitmap);
+    ws_bitmap_shrink(bitmap);
+    g_assert_cmpuint(ws_bitmap_memory_size(bitmap), <=, size);
+    check_bitmap(bitmap, ref);
+
+    /* Values can still be added after shrinking. */
+    for (i = 0; i < 1000; i++) {
+        value = g_rand_int(rand);
+        ws_bitmap_add(bitmap, value);
+        g_array_append_val(values, value);
+    }
+    g_array_free(ref, TRUE);
+    ref = reference_new((const guint32 *)values->data, values->len);
+    check_bitmap(bitmap, ref);
+
+    ws_bitmap_free(bitmap);
+    g_array_free(ref, TRUE);
+    g_array_free(values, TRUE);
+    g_rand_free(rand);
+}
+
+/*
+ * sharkd narrows a cached filter result down by dissecting only the frames
+ * in it, and keeping those that pass; check that walking one bitmap and
+ * looking its values up in another gives the intersection, when the two
+ * cover different numbers of chunks with different densities.
+ */
+static void
+bitmap_test_intersection(void)
+{
+    GArray *values_a = g_array_new(FALSE, FALSE, sizeof(guint32));
+    GArray *values_b = g_array_new(FALSE, FALSE, sizeof(guint32));
+    ws_bitmap *a, *b, *both;
+    ws_bitmap_iter iter;
+    GArray *ref_a, *ref_b, *ref_both;
+    guint32 value;
+    guint i;
+
+    /* Every third value over five chunks, and every value over one and
+       a half chunks starting part way into the first. */
+    for (value = 0; value < 5 * CHUNK_VALUES; value += 3)
+        g_array_append_val(values_a, value);
+    for (value = 1000; value < 1000 + 3 * CHUNK_VALUES / 2; value++)
+        g_array_append_val(values_b, value);
+
+    a = bitmap_new_from((const guint32 *)values_a->data, values_a->len);
+    b = bitmap_new_from((const guint32 *)values_b->data, values_b->len);
+    ref_a = reference_new((const guint32 *)values_a->data, values_a->len);
+    ref_b = reference_new((const guint32 *)values_b->data, values_b->len);
+
+    ref_both = g_array_new(FALSE, FALSE, sizeof(guint32));
+    for (i = 0; i < ref_a->len; i++) {
+        value = g_array_index(ref_a, guint32, i);
+        if (reference_contains(ref_b, value))
+            g_array_append_val(ref_both, value);
+    }
+
+    /* Both ways round. */
+    both = ws_bitmap_new();
+    ws_bitmap_iter_init(&iter, a);
+    while (ws_bitmap_iter_next(&iter, &value)) {
+        if (ws_bitmap_contains(b, value))
+            ws_bitmap_add(both, value);
+    }
+    check_bitmap(both, ref_both);
+    ws_bitmap_free(both);
+
+    both = ws_bitmap_new();
+    ws_bitmap_iter_init(&iter, b);
+    while (ws_bitmap_iter_next(&iter, &value)) {
+        if (ws_bitmap_contains(a, value))
+            ws_bitmap_add(both, value);
+    }
+    check_bitmap(both, ref_both);
+    g_assert_cmpuint(ws_bitmap_count(both), ==, (3 * CHUNK_VALUES / 2 + 2) / 3);
+    ws_bitmap_free(both);
+
+    ws_bitmap_free(a);
+    ws_bitmap_free(b);
+    g_array_free(ref_a, TRUE);
+    g_array_free(ref_b, TRUE);
+    g_array_free(ref_both, TRUE);
+    g_array_free(values_a, TRUE);
+    g_array_free(values_b, TRUE);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wsutil/bitmap/empty",        bitmap_test_empty);
+    g_test_add_func("/wsutil/bitmap/boundaries",   bitmap_test_boundaries);
+    g_test_add_func("/wsutil/bitmap/chunk_sizes",  bitmap_test_chunk_sizes);
+    g_test_add_func("/wsutil/bitmap/random",       bitmap_test_random);
+    g_test_add_func("/wsutil/bitmap/intersection", bitmap_test_intersection);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -45,7 +45,7 @@ ws_buffer_free(Buffer* buffer)
 	g_assert(buffer);
 	if (buffer->allocated == SMALL_BUFFER_SIZE) {
 		g_ptr_array_add(small_buffers, buffer->data);
-	} else {
+	} else if (buffer->allocated != 0) {
 		g_free(buffer->data);
 	}
 	buffer->data = NULL;
@@ -62,6 +62,20 @@ ws_buffer_assure_space(Buffer* buffer, gsize space)
 	gsize available_at_end = buffer->allocated - buffer->first_free;
 	gsize space_used;
 	gboolean space_at_beginning;
+	guint8 *data;
+
+	/* If the data is borrowed, copy it into memory of our own, with
+		the space after it. */
+	if (buffer->allocated == 0) {
+		space_used = buffer->first_free - buffer->start;
+		data = (guint8*)g_malloc(space_used + space);
+		memcpy(data, buffer->data + buffer->start, space_used);
+		buffer->data = data;
+		buffer->allocated = space_used + space;
+		buffer->start = 0;
+		buffer->first_free = space_used;
+		return;
+	}
 
 	/* If we've got the space already, good! */
 	if (space <= available_at_end) {
@@ -103,6 +117,20 @@ ws_buffer_append(Buffer* buffer, guint8 *from, gsize bytes)
 	buffer->first_free += bytes;
 }
 
+void
+ws_buffer_borrow(Buffer* buffer, guint8 *from, gsize bytes)
+{
+	g_assert(buffer);
+	/* Give up the memory we own, if any; we'd have to copy the
+		borrowed data into it as soon as it's written to. */
+	if (buffer->allocated != 0)
+		ws_buffer_free(buffer);
+	buffer->data = from;
+	buffer->allocated = 0;
+	buffer->start = 0;
+	buffer->first_free = bytes;
+}
+
 void
 ws_buffer_remove_start(Buffer* buffer, gsize bytes)
 {
@@ -20,7 +20,7 @@ extern "C" {
 
 typedef struct Buffer {
 	guint8	*data;
-	gsize	allocated;
+	gsize	allocated;	/* 0 if the data is borrowed */
 	gsize	start;
 	gsize	first_free;
 } Buffer;
@@ -35,6 +35,15 @@ WS_DLL_PUBLIC
 void ws_buffer_append(Buffer* buffer, guint8 *from, gsize bytes);
 WS_DLL_PUBLIC
 void ws_buffer_remove_start(Buffer* buffer, gsize bytes);
+/*
+ * Makes the buffer refer to bytes bytes of memory that it doesn't own,
+ * such as part of a memory-mapped file, instead of copying them.  The
+ * memory must stay valid as long as the buffer refers to it; the next
+ * ws_buffer_assure_space() copies the data into memory of the buffer's
+ * own before anything is written to it.
+ */
+WS_DLL_PUBLIC
+void ws_buffer_borrow(Buffer* buffer, guint8 *from, gsize bytes);
 WS_DLL_PUBLIC
 void ws_buffer_cleanup(void);
 
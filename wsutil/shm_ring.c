@@ -0,0 +1,562 @@
+/* shm_ring.c
+ * A ring buffer in shared memory that carries a capture file from
+ * dumpcap to its parent
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_FOPENCOOKIE)
+#define HAVE_SHM_RING
+#define _GNU_SOURCE /* Otherwise memfd_create() and fopencookie() won't be defined */
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#ifdef HAVE_SHM_RING
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ws_attributes.h"
+
+#include "shm_ring.h"
+
+#ifdef HAVE_SHM_RING
+
+#define SHM_RING_MAGIC      0x57535252  /* "WSRR" */
+#define SHM_RING_VERSION    1
+
+/* How much the file writer writes at a time. */
+#define WRITE_CHUNK_SIZE    (1024 * 1024)
+
+/* How long to wait for room before checking again, in case a wakeup
+   got lost. */
+#define WAIT_TIMEOUT_MS     100
+
+/*
+ * The first page of the memfd. The ring follows it. All positions are
+ * offsets in the capture file.
+ */
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint64 size;               /* size of the ring */
+    guint64 head;               /* end of the committed bytes */
+    guint64 reclaim;            /* bytes before this may have been overwritten */
+    guint32 producer_waiting;   /* dumpcap is waiting for room */
+} shm_ring_header;
+
+struct ws_shm_ring {
+    int              mem_fd;
+    int              event_fd;
+    gsize            page_size;
+    gsize            size;
+    shm_ring_header *hdr;
+    guint8          *data;      /* the ring, mapped twice in a row */
+
+    /* The rest is only used by dumpcap. */
+    FILE            *stream;
+    guint64          pos;       /* end of the bytes written to the stream */
+    guint64          tail;      /* end of the bytes written to the file */
+    int              fd;
+    GThread         *writer;
+    GMutex           mutex;     /* protects the rest */
+    GCond            cond;
+    gboolean         writer_waiting;
+    gboolean         closing;
+    guint64          packets_committed;
+    guint64          packets_written;
+    int              write_err;
+};
+
+static ws_shm_ring_t *
+shm_ring_map(int mem_fd, int event_fd, gsize page_size, gsize size, int prot, int *err)
+{
+    ws_shm_ring_t *ring;
+    guint8        *base;
+
+    ring = g_new0(ws_shm_ring_t, 1);
+    ring->mem_fd = mem_fd;
+    ring->event_fd = event_fd;
+    ring->page_size = page_size;
+    ring->size = size;
+    ring->fd = -1;
+    g_mutex_init(&ring->mutex);
+    g_cond_init(&ring->cond);
+
+    ring->hdr = (shm_ring_header *)mmap(NULL, page_size, PROT_READ|PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    if (ring->hdr == MAP_FAILED) {
+        *err = errno;
+        ring->hdr = NULL;
+        ws_shm_ring_free(ring);
+        return NULL;
+    }
+
+    /* Reserve room for two copies of the ring, then map the ring into
+       both halves. */
+    base = (guint8 *)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        *err = errno;
+        ws_shm_ring_free(ring);
+        return NULL;
+    }
+    ring->data = base;
+    if (mmap(base, size, prot, MAP_SHARED|MAP_FIXED, mem_fd, (off_t)page_size) == MAP_FAILED ||
+        mmap(base + size, size, prot, MAP_SHARED|MAP_FIXED, mem_fd, (off_t)page_size) == MAP_FAILED) {
+        *err = errno;
+        ws_shm_ring_free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+static void
+shm_ring_wake_producer(ws_shm_ring_t *ring)
+{
+    guint64 one = 1;
+
+    if (__atomic_load_n(&ring->hdr->producer_waiting, __ATOMIC_SEQ_CST)) {
+        /* This only fails if the counter is about to overflow, in which
+           case the producer is woken up anyway. */
+        if (write(ring->event_fd, &one, sizeof one) < 0) {
+            return;
+        }
+    }
+}
+
+ws_shm_ring_t *
+ws_shm_ring_new(gsize size, int *err)
+{
+    ws_shm_ring_t *ring;
+    gsize          page_size = (gsize)sysconf(_SC_PAGESIZE);
+    int            mem_fd, event_fd;
+
+    size = (size + page_size - 1) & ~(page_size - 1);
+
+    mem_fd = memfd_create("wireshark-capture-ring", MFD_CLOEXEC);
+    if (mem_fd == -1) {
+        *err = errno;
+        return NULL;
+    }
+    if (ftruncate(mem_fd, (off_t)(page_size + size)) == -1) {
+        *err = errno;
+        close(mem_fd);
+        return NULL;
+    }
+    event_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (event_fd == -1) {
+        *err = errno;
+        close(mem_fd);
+        return NULL;
+    }
+
+    /* We only read the ring. */
+    ring = shm_ring_map(mem_fd, event_fd, page_size, size, PROT_READ, err);
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->hdr->size = size;
+    ring->hdr->head = 0;
+    ring->hdr->reclaim = 0;
+    ring->hdr->producer_waiting = 0;
+    ring->hdr->version = SHM_RING_VERSION;
+    ring->hdr->magic = SHM_RING_MAGIC;
+    return ring;
+}
+
+void
+ws_shm_ring_get_fds(ws_shm_ring_t *ring, int *mem_fd, int *event_fd)
+{
+    *mem_fd = ring->mem_fd;
+    *event_fd = ring->event_fd;
+}
+
+gsize
+ws_shm_ring_copy(ws_shm_ring_t *ring, gint64 pos, guint8 *buf, gsize max_len)
+{
+    guint64 head = __atomic_load_n(&ring->hdr->head, __ATOMIC_ACQUIRE);
+    guint64 upos = (guint64)pos;
+    gsize   len;
+
+    if (pos < 0 || upos >= head || max_len == 0) {
+        return 0;
+    }
+    if (upos < __atomic_load_n(&ring->hdr->reclaim, __ATOMIC_ACQUIRE)) {
+        /* Overwritten, or about to be. */
+        return 0;
+    }
+
+    len = (gsize)MIN(head - upos, (guint64)MIN(max_len, ring->size));
+    memcpy(buf, ring->data + (upos % ring->size), len);
+
+    /* dumpcap raises reclaim before it overwrites anything, so if it
+       overwrote any of what we copied, we'll see it here. */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (upos < __atomic_load_n(&ring->hdr->reclaim, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    return len;
+}
+
+ws_shm_ring_t *
+ws_shm_ring_attach(int mem_fd, int event_fd, int *err)
+{
+    ws_shm_ring_t   *ring;
+    shm_ring_header *hdr;
+    gsize            page_size = (gsize)sysconf(_SC_PAGESIZE);
+    struct stat      st;
+    gsize            size;
+
+    /* Don't trust the header any further than the size of the memfd. */
+    if (fstat(mem_fd, &st) == -1) {
+        *err = errno;
+        close(mem_fd);
+        close(event_fd);
+        return NULL;
+    }
+    hdr = (shm_ring_header *)mmap(NULL, page_size, PROT_READ, MAP_SHARED, mem_fd, 0);
+    if (hdr == MAP_FAILED) {
+        *err = errno;
+        close(mem_fd);
+        close(event_fd);
+        return NULL;
+    }
+    size = (gsize)hdr->size;
+    if (hdr->magic != SHM_RING_MAGIC || hdr->version != SHM_RING_VERSION ||
+        size == 0 || size % page_size != 0 || (guint64)st.st_size != page_size + size) {
+        munmap(hdr, page_size);
+        *err = EINVAL;
+        close(mem_fd);
+        close(event_fd);
+        return NULL;
+    }
+    munmap(hdr, page_size);
+
+    ring = shm_ring_map(mem_fd, event_fd, page_size, size, PROT_READ|PROT_WRITE, err);
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->pos = ring->tail = ring->hdr->head;
+    return ring;
+}
+
+/* Wait for the room to write len more bytes, without overwriting bytes
+   that haven't been written to the file. We never wait for the parent:
+   it copies what it reads out of the ring, and checks afterwards whether
+   we overwrote it in the meantime. */
+static int
+shm_ring_reserve(ws_shm_ring_t *ring, gsize len)
+{
+    guint64 reclaim = ring->pos + len > ring->size ? ring->pos + len - ring->size : 0;
+    guint64 count;
+    struct pollfd pfd;
+    int err;
+
+    for (;;) {
+        err = __atomic_load_n(&ring->write_err, __ATOMIC_ACQUIRE);
+        if (err != 0) {
+            return err;
+        }
+
+        if (reclaim <= __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+            /* Tell the parent that what we're about to overwrite is no
+               longer there, before we overwrite it. */
+            if (reclaim > ring->hdr->reclaim) {
+                __atomic_store_n(&ring->hdr->reclaim, reclaim, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            }
+            return 0;
+        }
+
+        /* Wait for the file writer to make room. Check again after
+           saying we're waiting, so we don't miss a wakeup. */
+        __atomic_store_n(&ring->hdr->producer_waiting, 1, __ATOMIC_SEQ_CST);
+        if (reclaim > __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST)) {
+            pfd.fd = ring->event_fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, WAIT_TIMEOUT_MS) > 0) {
+                if (read(ring->event_fd, &count, sizeof count) < 0) {
+                    /* Someone else drained it; that's fine. */
+                }
+            }
+        }
+        __atomic_store_n(&ring->hdr->producer_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+static ssize_t
+shm_ring_stream_write(void *cookie, const char *buf, size_t len)
+{
+    ws_shm_ring_t *ring = (ws_shm_ring_t *)cookie;
+    int            err;
+
+    if (len > ring->size) {
+        errno = EFBIG;
+        return -1;
+    }
+    /* Uncommitted bytes can't be written to the file, so they mustn't
+       fill the ring. */
+    if (ring->pos + len - ring->hdr->head > ring->size) {
+        ws_shm_ring_commit(ring, 0);
+    }
+    err = shm_ring_reserve(ring, len);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    memcpy(ring->data + (ring->pos % ring->size), buf, len);
+    ring->pos += len;
+    return (ssize_t)len;
+}
+
+static int
+shm_ring_stream_close(void *cookie)
+{
+    ws_shm_ring_t *ring = (ws_shm_ring_t *)cookie;
+    int            err;
+
+    ws_shm_ring_commit(ring, 0);
+
+    g_mutex_lock(&ring->mutex);
+    ring->closing = TRUE;
+    g_cond_broadcast(&ring->cond);
+    g_mutex_unlock(&ring->mutex);
+    g_thread_join(ring->writer);
+    ring->writer = NULL;
+    ring->stream = NULL;
+
+    err = ring->write_err;
+    if (close(ring->fd) == -1 && err == 0) {
+        err = errno;
+    }
+    ring->fd = -1;
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+/* Copy the committed bytes to the file. */
+static gpointer
+shm_ring_writer(gpointer data)
+{
+    ws_shm_ring_t *ring = (ws_shm_ring_t *)data;
+    guint64        tail = ring->tail;
+    guint64        head, packets;
+    gsize          len;
+    ssize_t        ret;
+
+    for (;;) {
+        g_mutex_lock(&ring->mutex);
+        while (ring->hdr->head == tail && !ring->closing) {
+            ring->writer_waiting = TRUE;
+            g_cond_wait(&ring->cond, &ring->mutex);
+            ring->writer_waiting = FALSE;
+        }
+        head = ring->hdr->head;
+        packets = ring->packets_committed;
+        g_mutex_unlock(&ring->mutex);
+
+        if (head == tail) {
+            /* We're closing, and everything has been written. */
+            break;
+        }
+
+        while (tail < head) {
+            len = (gsize)MIN(head - tail, WRITE_CHUNK_SIZE);
+            ret = write(ring->fd, ring->data + (tail % ring->size), len);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                g_mutex_lock(&ring->mutex);
+                __atomic_store_n(&ring->write_err, errno, __ATOMIC_RELEASE);
+                g_cond_broadcast(&ring->cond);
+                g_mutex_unlock(&ring->mutex);
+                shm_ring_wake_producer(ring);
+                return NULL;
+            }
+            tail += ret;
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_SEQ_CST);
+            shm_ring_wake_producer(ring);
+        }
+
+        g_mutex_lock(&ring->mutex);
+        ring->packets_written = packets;
+        g_cond_broadcast(&ring->cond);
+        g_mutex_unlock(&ring->mutex);
+    }
+    return NULL;
+}
+
+FILE *
+ws_shm_ring_fdopen(ws_shm_ring_t *ring, int fd)
+{
+    cookie_io_functions_t funcs = {
+        NULL,                       /* read */
+        shm_ring_stream_write,
+        NULL,                       /* seek */
+        shm_ring_stream_close
+    };
+
+    g_assert(ring->stream == NULL);
+
+    ring->stream = fopencookie(ring, "w", funcs);
+    if (ring->stream == NULL) {
+        return NULL;
+    }
+    /* Write straight into the ring, rather than copying into a stdio
+       buffer first. */
+    setvbuf(ring->stream, NULL, _IONBF, 0);
+
+    ring->fd = fd;
+    ring->closing = FALSE;
+    ring->write_err = 0;
+    ring->writer = g_thread_new("Capture file writer", shm_ring_writer, ring);
+    return ring->stream;
+}
+
+void
+ws_shm_ring_commit(ws_shm_ring_t *ring, guint packets)
+{
+    g_mutex_lock(&ring->mutex);
+    __atomic_store_n(&ring->hdr->head, ring->pos, __ATOMIC_RELEASE);
+    ring->packets_committed += packets;
+    if (ring->writer_waiting) {
+        g_cond_signal(&ring->cond);
+    }
+    g_mutex_unlock(&ring->mutex);
+}
+
+guint64
+ws_shm_ring_packets_written(ws_shm_ring_t *ring)
+{
+    guint64 packets;
+
+    g_mutex_lock(&ring->mutex);
+    packets = ring->packets_written;
+    g_mutex_unlock(&ring->mutex);
+    return packets;
+}
+
+int
+ws_shm_ring_sync(ws_shm_ring_t *ring)
+{
+    int err;
+
+    g_mutex_lock(&ring->mutex);
+    while (ring->writer != NULL && ring->write_err == 0 &&
+           __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) != ring->hdr->head) {
+        g_cond_wait(&ring->cond, &ring->mutex);
+    }
+    err = ring->write_err;
+    g_mutex_unlock(&ring->mutex);
+    return err;
+}
+
+void
+ws_shm_ring_free(ws_shm_ring_t *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+    if (ring->data != NULL) {
+        munmap(ring->data, 2 * ring->size);
+    }
+    if (ring->hdr != NULL) {
+        munmap(ring->hdr, ring->page_size);
+    }
+    close(ring->mem_fd);
+    close(ring->event_fd);
+    g_mutex_clear(&ring->mutex);
+    g_cond_clear(&ring->cond);
+    g_free(ring);
+}
+
+#else /* HAVE_SHM_RING */
+
+ws_shm_ring_t *
+ws_shm_ring_new(gsize size _U_, int *err)
+{
+    *err = ENOSYS;
+    return NULL;
+}
+
+void
+ws_shm_ring_get_fds(ws_shm_ring_t *ring _U_, int *mem_fd, int *event_fd)
+{
+    *mem_fd = -1;
+    *event_fd = -1;
+}
+
+gsize
+ws_shm_ring_copy(ws_shm_ring_t *ring _U_, gint64 pos _U_, guint8 *buf _U_, gsize max_len _U_)
+{
+    return 0;
+}
+
+ws_shm_ring_t *
+ws_shm_ring_attach(int mem_fd _U_, int event_fd _U_, int *err)
+{
+    *err = ENOSYS;
+    return NULL;
+}
+
+FILE *
+ws_shm_ring_fdopen(ws_shm_ring_t *ring _U_, int fd _U_)
+{
+    errno = ENOSYS;
+    return NULL;
+}
+
+void
+ws_shm_ring_commit(ws_shm_ring_t *ring _U_, guint packets _U_)
+{
+}
+
+guint64
+ws_shm_ring_packets_written(ws_shm_ring_t *ring _U_)
+{
+    return 0;
+}
+
+int
+ws_shm_ring_sync(ws_shm_ring_t *ring _U_)
+{
+    return ENOSYS;
+}
+
+void
+ws_shm_ring_free(ws_shm_ring_t *ring _U_)
+{
+}
+
+#endif /* HAVE_SHM_RING */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,153 @@
+/* shm_ring.h
+ * A ring buffer in shared memory that carries a capture file from
+ * dumpcap to its parent
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_SHM_RING_H__
+#define __WS_SHM_RING_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The ring holds the bytes of the capture file that dumpcap is writing,
+ * so a position in the ring is an offset in the file. It's a memfd that
+ * is mapped twice in a row, so that any part of the ring that's no larger
+ * than the ring itself is contiguous in memory.
+ *
+ * The parent creates the ring and passes its file descriptors to dumpcap,
+ * which writes the file into the ring through a stdio stream. A thread in
+ * dumpcap copies the ring to the capture file in large writes, so the
+ * capture loop doesn't wait for the file system.
+ *
+ * The parent copies the packets that dumpcap has reported out of the
+ * ring rather than reading them from the file. dumpcap never waits for
+ * the parent: before it overwrites part of the ring, it says so in the
+ * ring's header, and the parent checks that after copying. If the parent
+ * has fallen behind and the bytes it wants have been overwritten, it
+ * reads them from the file instead, which always has them.
+ *
+ * An eventfd wakes dumpcap when the file writer has made room in the
+ * ring again.
+ *
+ * This is only supported on Linux; elsewhere ws_shm_ring_new() fails.
+ */
+typedef struct ws_shm_ring ws_shm_ring_t;
+
+/*
+ * The parent's side.
+ */
+
+/** Create a ring.
+ *
+ * @param size [in] The size of the ring. It's rounded up to a multiple
+ * of the page size.
+ * @param err [out] An errno value if the ring couldn't be created.
+ * @return The ring, or NULL on failure.
+ */
+WS_DLL_PUBLIC ws_shm_ring_t *ws_shm_ring_new(gsize size, int *err);
+
+/** The file descriptors to pass to dumpcap with ws_shm_ring_attach().
+ * They are close-on-exec, so the caller has to clear that flag in the
+ * child process.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_get_fds(ws_shm_ring_t *ring, int *mem_fd, int *event_fd);
+
+/** Copy part of the file out of the ring.
+ *
+ * @param ring [in] The ring.
+ * @param pos [in] The offset in the file.
+ * @param buf [out] Where to copy the bytes.
+ * @param max_len [in] The maximum number of bytes wanted.
+ * @return The number of bytes copied, or 0 if the ring doesn't hold the
+ * bytes at the offset, either because they have been overwritten or
+ * because they haven't been written yet.
+ */
+WS_DLL_PUBLIC gsize ws_shm_ring_copy(ws_shm_ring_t *ring, gint64 pos,
+        guint8 *buf, gsize max_len);
+
+/*
+ * dumpcap's side.
+ */
+
+/** Map a ring created by the parent.
+ *
+ * @param mem_fd [in] The ring's memfd. The ring takes ownership of it.
+ * @param event_fd [in] The ring's eventfd. The ring takes ownership of it.
+ * @param err [out] An errno value if the ring couldn't be mapped.
+ * @return The ring, or NULL on failure.
+ */
+WS_DLL_PUBLIC ws_shm_ring_t *ws_shm_ring_attach(int mem_fd, int event_fd, int *err);
+
+/** Open a stream that writes into the ring, and start copying the ring
+ * to a file. Like fdopen(), fclose() on the stream closes the file
+ * descriptor; it first waits for everything to be written to it.
+ *
+ * Bytes written to the stream are held back until they're committed
+ * with ws_shm_ring_commit().
+ *
+ * @param ring [in] The ring.
+ * @param fd [in] The file to copy the ring to.
+ * @return The stream, or NULL on failure, with errno set.
+ */
+WS_DLL_PUBLIC FILE *ws_shm_ring_fdopen(ws_shm_ring_t *ring, int fd);
+
+/** Make the bytes written to the stream so far available to the file
+ * writer and to the parent.
+ *
+ * @param ring [in] The ring.
+ * @param packets [in] The number of packets in those bytes.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_commit(ws_shm_ring_t *ring, guint packets);
+
+/** The number of committed packets that have been written to the file. */
+WS_DLL_PUBLIC guint64 ws_shm_ring_packets_written(ws_shm_ring_t *ring);
+
+/** Wait for everything committed to be written to the file.
+ *
+ * @return 0, or an errno value if writing to the file failed.
+ */
+WS_DLL_PUBLIC int ws_shm_ring_sync(ws_shm_ring_t *ring);
+
+/*
+ * Both sides.
+ */
+
+/** Unmap a ring and close its file descriptors. Any stream must have
+ * been closed.
+ *
+ * @param ring [in] The ring. May be NULL.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_free(ws_shm_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_SHM_RING_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,559 @@
+/* shm_ring_test.c
+ * Tests for the capture ring shared between dumpcap and its parent
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "shm_ring.h"
+#include "file_util.h"
+
+/* The ring is only supported where shm_ring.c can build it. */
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_FOPENCOOKIE)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * The ring is four pages, and the other sizes are scaled to match, so
+ * that the tests do the same thing whatever the page size is. A page of
+ * 4096 bytes gives a scale of 1; a record doesn't fit the ring a whole
+ * number of times, so records are split where the ring wraps around.
+ */
+#define RING_PAGES      4
+#define SCALE           (ring_size / 16384)
+#define RECORD_LEN      (1000 * SCALE)
+
+/* How long to wait for the producer to answer when it shouldn't, and
+   when it should. */
+#define BLOCKED_MS      200
+#define ANSWER_MS       10000
+
+/* What the test tells the producer to do */
+enum {
+    PRODUCER_WRITE,             /* write and commit len bytes */
+    PRODUCER_WRITE_MANY,        /* write and commit len bytes, count times */
+    PRODUCER_WRITE_UNCOMMITTED, /* write len bytes */
+    PRODUCER_COMMIT,            /* commit what's been written */
+    PRODUCER_SYNC,              /* wait for the file writer */
+    PRODUCER_CLOSE              /* close the stream and exit */
+};
+
+typedef struct {
+    int   op;
+    gsize len;
+    guint count;
+} producer_cmd;
+
+/* A producer, and the pipes the test talks to it through */
+typedef struct {
+    pid_t          pid;         /* the producer, if it's our child */
+    int            cmd_pipe[2];
+    int            answer_pipe[2];
+} producer_t;
+
+static gsize ring_size;
+
+/* Byte i of the file. The period isn't a power of two, so that bytes
+   from the wrong place in the ring can be told apart. */
+static guint8
+file_byte(guint64 i)
+{
+    return (guint8)(i % 251);
+}
+
+static gboolean
+bytes_ok(const guint8 *data, guint64 pos, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++) {
+        if (data[i] != file_byte(pos + i))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+write_all(int fd, const void *buf, gsize len)
+{
+    g_assert(write(fd, buf, len) == (ssize_t)len);
+}
+
+/*
+ * dumpcap's side: attach to the ring, write the file through it as the
+ * test tells us to, and answer each command with 0 or an errno value.
+ */
+static void G_GNUC_NORETURN
+producer_main(int mem_fd, int event_fd, int fd, int cmd_fd, int answer_fd)
+{
+    ws_shm_ring_t *ring;
+    FILE          *stream;
+    producer_cmd   cmd;
+    guint8        *buf;
+    guint64        pos = 0;
+    gsize          i;
+    guint          n;
+    int            err;
+
+    /* Writing to a pipe nobody reads has to fail, not kill us. */
+    signal(SIGPIPE, SIG_IGN);
+
+    ring = ws_shm_ring_attach(mem_fd, event_fd, &err);
+    if (ring == NULL)
+        _exit(1);
+    stream = ws_shm_ring_fdopen(ring, fd);
+    if (stream == NULL)
+        _exit(1);
+    buf = (guint8 *)g_malloc(ring_size);
+
+    while (read(cmd_fd, &cmd, sizeof cmd) == sizeof cmd) {
+        err = 0;
+        switch (cmd.op) {
+
+        case PRODUCER_WRITE:
+        case PRODUCER_WRITE_MANY:
+        case PRODUCER_WRITE_UNCOMMITTED:
+            for (n = 0; n < (cmd.op == PRODUCER_WRITE_MANY ? cmd.count : 1); n++) {
+                for (i = 0; i < cmd.len; i++)
+                    buf[i] = file_byte(pos + i);
+                /* Like dumpcap, check the error indicator: fwrite() on an
+                   unbuffered stream doesn't return a short count when the
+                   ring refuses the bytes. */
+                if (fwrite(buf, 1, cmd.len, stream) != cmd.len || ferror(stream)) {
+                    err = ws_shm_ring_sync(ring);
+                    break;
+                }
+                pos += cmd.len;
+                if (cmd.op != PRODUCER_WRITE_UNCOMMITTED)
+                    ws_shm_ring_commit(ring, 1);
+            }
+            break;
+
+        case PRODUCER_COMMIT:
+            ws_shm_ring_commit(ring, 0);
+            break;
+
+        case PRODUCER_SYNC:
+            err = ws_shm_ring_sync(ring);
+            break;
+
+        case PRODUCER_CLOSE:
+            if (fclose(stream) != 0)
+                err = errno;
+            ws_shm_ring_free(ring);
+            write_all(answer_fd, &err, sizeof err);
+            _exit(0);
+        }
+        write_all(answer_fd, &err, sizeof err);
+    }
+
+    /* The test went away. */
+    _exit(1);
+}
+
+static void
+producer_init(producer_t *producer)
+{
+    producer->pid = 0;
+    g_assert(pipe(producer->cmd_pipe) == 0);
+    g_assert(pipe(producer->answer_pipe) == 0);
+}
+
+/* Fork a producer that writes the file to fd, which it takes over. */
+static void
+producer_start(producer_t *producer, ws_shm_ring_t *ring, int fd)
+{
+    int mem_fd, event_fd;
+
+    ws_shm_ring_get_fds(ring, &mem_fd, &event_fd);
+    producer->pid = fork();
+    g_assert(producer->pid != -1);
+    if (producer->pid == 0) {
+        close(producer->cmd_pipe[1]);
+        close(producer->answer_pipe[0]);
+        producer_main(dup(mem_fd), dup(event_fd), fd,
+                      producer->cmd_pipe[0], producer->answer_pipe[1]);
+    }
+    close(fd);
+    close(producer->cmd_pipe[0]);
+    close(producer->answer_pipe[1]);
+}
+
+static void
+producer_send_many(producer_t *producer, int op, gsize len, guint count)
+{
+    producer_cmd cmd;
+
+    memset(&cmd, 0, sizeof cmd);
+    cmd.op = op;
+    cmd.len = len;
+    cmd.count = count;
+    write_all(producer->cmd_pipe[1], &cmd, sizeof cmd);
+}
+
+static void
+producer_send(producer_t *producer, int op, gsize len)
+{
+    producer_send_many(producer, op, len, 1);
+}
+
+/* Wait for the producer to answer; return FALSE if it doesn't in time. */
+static gboolean
+producer_answered(producer_t *producer, int timeout_ms, int *err)
+{
+    struct pollfd pfd;
+
+    pfd.fd = producer->answer_pipe[0];
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout_ms) != 1)
+        return FALSE;
+    g_assert(read(producer->answer_pipe[0], err, sizeof *err) == sizeof *err);
+    return TRUE;
+}
+
+/* Tell the producer to do something, and check that it did. */
+static void
+producer_do(producer_t *producer, int op, gsize len)
+{
+    int err = -1;
+
+    producer_send(producer, op, len);
+    g_assert(producer_answered(producer, ANSWER_MS, &err));
+    g_assert_cmpint(err, ==, 0);
+}
+
+static void
+producer_finish(producer_t *producer, int expected_err)
+{
+    int err = -1;
+    int status;
+
+    producer_send(producer, PRODUCER_CLOSE, 0);
+    g_assert(producer_answered(producer, ANSWER_MS, &err));
+    g_assert_cmpint(err, ==, expected_err);
+    if (producer->pid != 0) {
+        g_assert(waitpid(producer->pid, &status, 0) == producer->pid);
+        g_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    close(producer->cmd_pipe[1]);
+    close(producer->answer_pipe[0]);
+}
+
+static ws_shm_ring_t *
+ring_new(void)
+{
+    ws_shm_ring_t *ring;
+    int err = 0;
+
+    ring_size = RING_PAGES * (gsize)sysconf(_SC_PAGESIZE);
+    ring = ws_shm_ring_new(ring_size, &err);
+    g_assert_cmpint(err, ==, 0);
+    g_assert(ring != NULL);
+    return ring;
+}
+
+static char *
+temp_file(int *fd)
+{
+    GError *error = NULL;
+    char *path;
+
+    *fd = g_file_open_tmp("wsutil_shm_ring_XXXXXX", &path, &error);
+    g_assert_no_error(error);
+    return path;
+}
+
+/* Check that the file holds len bytes, and they're the right ones. */
+static void
+file_ok(const char *path, gsize len)
+{
+    gchar *contents;
+    gsize length;
+
+    g_assert(g_file_get_contents(path, &contents, &length, NULL));
+    g_assert_cmpuint(length, ==, len);
+    g_assert(bytes_ok((guint8 *)contents, 0, length));
+    g_free(contents);
+}
+
+/*
+ * A reader that keeps up reads everything from the ring, including the
+ * records that wrap around the end of it.
+ */
+static void
+shm_ring_test_wraparound(void)
+{
+    ws_shm_ring_t *ring = ring_new();
+    producer_t producer;
+    guint8 *buf = (guint8 *)g_malloc(ring_size);
+    gsize len;
+    guint64 pos = 0;
+    gboolean wrapped = FALSE;
+    int fd;
+    char *path = temp_file(&fd);
+    int i;
+
+    producer_init(&producer);
+    producer_start(&producer, ring, fd);
+    for (i = 0; i < 100; i++) {
+        producer_do(&producer, PRODUCER_WRITE, RECORD_LEN);
+        len = ws_shm_ring_copy(ring, (gint64)pos, buf, ring_size);
+        g_assert_cmpuint(len, ==, RECORD_LEN);
+        g_assert(bytes_ok(buf, pos, len));
+        if (pos % ring_size + len > ring_size)
+            wrapped = TRUE;
+        pos += len;
+    }
+    g_assert(wrapped);
+
+    /* Nothing has been written past the end yet. */
+    g_assert_cmpuint(ws_shm_ring_copy(ring, (gint64)pos, buf, ring_size), ==, 0);
+
+    producer_finish(&producer, 0);
+    file_ok(path, 100 * RECORD_LEN);
+
+    ws_shm_ring_free(ring);
+    g_free(buf);
+    g_unlink(path);
+    g_free(path);
+}
+
+/*
+ * dumpcap doesn't wait for a reader that has stopped reading, e.g.
+ * because it's busy dissecting or its own output is blocked; the reader
+ * reads what's been overwritten from the file.
+ */
+static void
+shm_ring_test_stalled_reader(void)
+{
+    ws_shm_ring_t *ring = ring_new();
+    producer_t producer;
+    guint8 *buf = (guint8 *)g_malloc(ring_size);
+    gsize len;
+    int err = -1;
+    int fd;
+    char *path = temp_file(&fd);
+    int i;
+
+    producer_init(&producer);
+    producer_start(&producer, ring, fd);
+
+    producer_do(&producer, PRODUCER_WRITE, RECORD_LEN);
+    g_assert_cmpuint(ws_shm_ring_copy(ring, 0, buf, ring_size), ==, RECORD_LEN);
+    g_assert(bytes_ok(buf, 0, RECORD_LEN));
+
+    /* Three times what the ring holds, without waiting for us. */
+    for (i = 1; i < 50; i++) {
+        producer_send(&producer, PRODUCER_WRITE, RECORD_LEN);
+        g_assert(producer_answered(&producer, ANSWER_MS, &err));
+        g_assert_cmpint(err, ==, 0);
+    }
+
+    /* What we were reading is gone from the ring, but not what's been
+       written recently. */
+    g_assert_cmpuint(ws_shm_ring_copy(ring, 0, buf, ring_size), ==, 0);
+    g_assert_cmpuint(ws_shm_ring_copy(ring, RECORD_LEN, buf, ring_size), ==, 0);
+    len = ws_shm_ring_copy(ring, 49 * RECORD_LEN, buf, ring_size);
+    g_assert_cmpuint(len, ==, RECORD_LEN);
+    g_assert(bytes_ok(buf, 49 * RECORD_LEN, len));
+
+    producer_finish(&producer, 0);
+    file_ok(path, 50 * RECORD_LEN);
+
+    ws_shm_ring_free(ring);
+    g_free(buf);
+    g_unlink(path);
+    g_free(path);
+}
+
+/*
+ * dumpcap may be about to overwrite bytes that haven't been committed
+ * yet; the reader mustn't copy them, and reads them from the file,
+ * which already has them.
+ */
+static void
+shm_ring_test_reclaim(void)
+{
+    ws_shm_ring_t *ring = ring_new();
+    producer_t producer;
+    guint8 *buf = (guint8 *)g_malloc(ring_size);
+    gsize len;
+    int fd;
+    char *path = temp_file(&fd);
+    int read_fd;
+
+    producer_init(&producer);
+    producer_start(&producer, ring, fd);
+
+    /* The second write reclaims the start of the ring, but isn't
+       committed. */
+    producer_do(&producer, PRODUCER_WRITE, 10 * RECORD_LEN);
+    producer_do(&producer, PRODUCER_WRITE_UNCOMMITTED, 10 * RECORD_LEN);
+    g_assert_cmpuint(ws_shm_ring_copy(ring, 3 * RECORD_LEN, buf, ring_size), ==, 0);
+
+    /* The file has what's been reclaimed. */
+    read_fd = open(path, O_RDONLY);
+    g_assert(read_fd != -1);
+    g_assert(pread(read_fd, buf, 100, 3 * RECORD_LEN) == 100);
+    g_assert(bytes_ok(buf, 3 * RECORD_LEN, 100));
+    close(read_fd);
+
+    /* The rest of what's been committed is still in the ring. */
+    len = ws_shm_ring_copy(ring, 4 * RECORD_LEN, buf, ring_size);
+    g_assert_cmpuint(len, ==, 6 * RECORD_LEN);
+    g_assert(bytes_ok(buf, 4 * RECORD_LEN, len));
+
+    /* Once it's committed, so is the second write. */
+    producer_do(&producer, PRODUCER_COMMIT, 0);
+    len = ws_shm_ring_copy(ring, 4 * RECORD_LEN, buf, ring_size);
+    g_assert_cmpuint(len, ==, 16 * RECORD_LEN);
+    g_assert(bytes_ok(buf, 4 * RECORD_LEN, len));
+
+    /* A third write reclaims that, too. */
+    producer_do(&producer, PRODUCER_WRITE, 10 * RECORD_LEN);
+    g_assert_cmpuint(ws_shm_ring_copy(ring, 4 * RECORD_LEN, buf, ring_size), ==, 0);
+    len = ws_shm_ring_copy(ring, 14 * RECORD_LEN, buf, ring_size);
+    g_assert_cmpuint(len, ==, 16 * RECORD_LEN);
+    g_assert(bytes_ok(buf, 14 * RECORD_LEN, len));
+
+    producer_finish(&producer, 0);
+    file_ok(path, 30 * RECORD_LEN);
+
+    ws_shm_ring_free(ring);
+    g_free(buf);
+    g_unlink(path);
+    g_free(path);
+}
+
+/*
+ * Copying while dumpcap writes as fast as it can either gets the right
+ * bytes or nothing, never bytes that were overwritten while we copied.
+ */
+static void
+shm_ring_test_concurrent(void)
+{
+    ws_shm_ring_t *ring = ring_new();
+    producer_t producer;
+    guint8 *buf = (guint8 *)g_malloc(ring_size);
+    gsize len;
+    guint64 pos = 0;
+    guint copied = 0;
+    ws_statb64 st;
+    int err = -1;
+    int fd;
+    char *path = temp_file(&fd);
+    const guint count = 20000;
+
+    producer_init(&producer);
+    producer_start(&producer, ring, fd);
+
+    producer_send_many(&producer, PRODUCER_WRITE_MANY, RECORD_LEN / 3, count);
+    while (!producer_answered(&producer, 0, &err)) {
+        len = ws_shm_ring_copy(ring, (gint64)pos, buf, ring_size);
+        if (len != 0) {
+            g_assert(bytes_ok(buf, pos, len));
+            /* Only move on a little, so that we keep copying what's
+               about to be overwritten. */
+            pos += len / 8 + 1;
+            copied++;
+        } else if (ws_stat64(path, &st) == 0 &&
+                   (guint64)st.st_size > pos + ring_size / 2) {
+            /* We've fallen behind; catch up with the file writer, which
+               the ring is never far ahead of, but stay far enough behind
+               that dumpcap is likely to overwrite what we're copying. */
+            pos = (guint64)st.st_size - ring_size / 2;
+        }
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(copied, >, 0);
+
+    producer_finish(&producer, 0);
+    file_ok(path, count * (RECORD_LEN / 3));
+
+    ws_shm_ring_free(ring);
+    g_free(buf);
+    g_unlink(path);
+    g_free(path);
+}
+
+/*
+ * If writing the file fails, dumpcap finds out, rather than waiting for
+ * room that the file writer will never make.
+ */
+static void
+shm_ring_test_write_error(void)
+{
+    ws_shm_ring_t *ring = ring_new();
+    producer_t producer;
+    int file_pipe[2];
+    int err = 0;
+
+    /* Nobody reads the "file". */
+    g_assert(pipe(file_pipe) == 0);
+    close(file_pipe[0]);
+    producer_init(&producer);
+    producer_start(&producer, ring, file_pipe[1]);
+
+    producer_do(&producer, PRODUCER_WRITE, RECORD_LEN);
+    producer_send(&producer, PRODUCER_SYNC, 0);
+    g_assert(producer_answered(&producer, ANSWER_MS, &err));
+    g_assert_cmpint(err, ==, EPIPE);
+
+    /* Writing more fails, too. */
+    producer_send(&producer, PRODUCER_WRITE, RECORD_LEN);
+    g_assert(producer_answered(&producer, ANSWER_MS, &err));
+    g_assert_cmpint(err, ==, EPIPE);
+
+    producer_finish(&producer, EPIPE);
+    ws_shm_ring_free(ring);
+}
+
+#endif /* HAVE_MEMFD_CREATE && HAVE_SYS_EVENTFD_H && HAVE_FOPENCOOKIE */
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_FOPENCOOKIE)
+    g_test_add_func("/wsutil/shm_ring/wraparound",     shm_ring_test_wraparound);
+    g_test_add_func("/wsutil/shm_ring/stalled_reader", shm_ring_test_stalled_reader);
+    g_test_add_func("/wsutil/shm_ring/reclaim",        shm_ring_test_reclaim);
+    g_test_add_func("/wsutil/shm_ring/concurrent",     shm_ring_test_concurrent);
+    g_test_add_func("/wsutil/shm_ring/write_error",    shm_ring_test_write_error);
+#endif
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
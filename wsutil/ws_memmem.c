@@ -0,0 +1,91 @@
+/* ws_memmem.c
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+/* see bug 10798 and ws_mempbrk.c */
+#ifdef __APPLE__
+#if defined(__clang__) && (__clang_major__ >= 6)
+/* allow HAVE_SSE4_2 to be used for clang 6.0+ case because we know it works */
+#else
+/* don't allow it otherwise, for Mac OSX */
+#undef HAVE_SSE4_2
+#endif
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "ws_memmem.h"
+#include "ws_memmem_int.h"
+
+const guint8 *
+ws_memmem_portable(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+	const guint8 *begin;
+	const guint8 *last_possible;
+	size_t last;
+
+	if (needle_len == 0 || needle_len > haystack_len)
+		return NULL;
+
+	if (needle_len == 1)
+		return (const guint8 *)memchr(haystack, needle[0], haystack_len);
+
+	/* Let memchr() skip to the next occurrence of the first byte, then
+	 * reject most false candidates by looking at the last byte before
+	 * comparing the whole needle. */
+	last = needle_len - 1;
+	last_possible = haystack + haystack_len - needle_len;
+	for (begin = haystack; begin <= last_possible; begin++) {
+		begin = (const guint8 *)memchr(begin, needle[0], last_possible - begin + 1);
+		if (begin == NULL)
+			return NULL;
+		if (begin[last] == needle[last] &&
+		    memcmp(begin + 1, needle + 1, needle_len - 2) == 0)
+			return begin;
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_SSE4_2
+/* -1 until the processor has been checked. */
+static int use_sse42 = -1;
+#endif
+
+WS_DLL_PUBLIC const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+#ifdef HAVE_SSE4_2
+	/* A single byte is best left to memchr(). */
+	if (needle_len >= 2 && haystack_len >= needle_len + 15) {
+		if (use_sse42 == -1)
+			use_sse42 = ws_memmem_sse42_supported();
+		if (use_sse42)
+			return ws_memmem_sse42(haystack, haystack_len, needle, needle_len);
+	}
+#endif
+
+	return ws_memmem_portable(haystack, haystack_len, needle, needle_len);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
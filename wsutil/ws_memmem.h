@@ -0,0 +1,29 @@
+/* ws_memmem.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMMEM_H__
+#define __WS_MEMMEM_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+/** Return the first occurrence of needle in haystack, or NULL if it
+ *  isn't found or if needle_len is 0.
+ *
+ *  Candidate positions are found by looking for the first and the last
+ *  byte of the needle, 16 positions at a time on processors with SSE4.2,
+ *  and are then checked with memcmp().
+ *
+ *  There is no variant that looks for several needles in one pass; a
+ *  filter with several "contains" tests searches the data once per test.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+
+#endif /* __WS_MEMMEM_H__ */
@@ -0,0 +1,89 @@
+/* ws_memmem_sse42.c
+ * Substring search with SIMD intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SSE4_2
+
+#include <glib.h>
+#include "ws_cpuid.h"
+
+#include <emmintrin.h>
+#include <string.h>
+#include "ws_memmem.h"
+#include "ws_memmem_int.h"
+#include "bits_ctz.h"
+
+#define cast_128__m128i(p) ((const __m128i *) (const void *) (p))
+
+gboolean
+ws_memmem_sse42_supported(void)
+{
+	return ws_cpuid_sse42() != 0;
+}
+
+/*
+ * Compare 16 candidate positions at a time: a position can only be the
+ * start of the needle if both the byte at that position matches the
+ * first byte of the needle and the byte needle_len - 1 positions further
+ * matches the last one. Only the positions that pass both tests are
+ * compared with memcmp(). Checking two bytes that are far apart makes
+ * false candidates rare, even on text.
+ *
+ * Only SSE2 instructions are used, but this is built and selected along
+ * with the other SSE4.2 code; any processor with SSE4.2 has SSE2.
+ *
+ * The caller makes sure that needle_len >= 2 and that
+ * haystack_len >= needle_len + 15.
+ */
+const guint8 *
+ws_memmem_sse42(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+	const __m128i first = _mm_set1_epi8((char)needle[0]);
+	const __m128i last = _mm_set1_epi8((char)needle[needle_len - 1]);
+	__m128i block_first, block_last;
+	guint32 mask;
+	size_t i, bit;
+
+	for (i = 0; i + needle_len + 15 <= haystack_len; i += 16) {
+		/* _mm_loadu_si128() works with unaligned data, cast safe */
+		block_first = _mm_loadu_si128(cast_128__m128i(haystack + i));
+		block_last = _mm_loadu_si128(cast_128__m128i(haystack + i + needle_len - 1));
+
+		mask = (guint32)_mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpeq_epi8(first, block_first),
+				_mm_cmpeq_epi8(last, block_last)));
+
+		while (mask != 0) {
+			bit = ws_ctz(mask);
+			if (memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2) == 0)
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	/* Fewer than 16 candidate positions are left. */
+	return ws_memmem_portable(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+#endif /* HAVE_SSE4_2 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */